@@ -117,6 +117,87 @@ void bgr555_to_rgb565(void * __restrict__ dst_, const void *  __restrict__ src_,
 	for (; pixels > 0; dst++, src++, pixels--)
 		*dst = do_one(*src);
 }
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define gpick_even(d_, a_, b_) d_ = vuzpq_u16(a_, b_).val[0]
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+// sign extension keeps packs from saturating
+#define gpick_even1(v_) _mm_srai_epi32(_mm_slli_epi32((__m128i)(v_), 16), 16)
+#define gpick_even(d_, a_, b_) \
+  d_ = (gvu16)_mm_packs_epi32(gpick_even1(a_), gpick_even1(b_))
+#endif
+
+#ifdef gpick_even
+#define HAVE_bgr555_to_rgb565_640_to_320
+void bgr555_to_rgb565_640_to_320(void * __restrict__ dst_,
+	const void * __restrict__ src_, int dpixels)
+{
+	const uint16_t * __restrict__ src = src_;
+	uint16_t * __restrict__ dst = dst_;
+	gvu16 c0x07c0 = gdup(0x07c0);
+
+	for (; dpixels >= 8; dpixels -= 8, src += 16, dst += 8)
+	{
+		gvu16 d, s;
+		gpick_even(s, *(const gvu16u *)src, *(const gvu16u *)(src + 8));
+		do_one_simd(d, s, c0x07c0);
+		*(gvu16u *)dst = d;
+		__builtin_prefetch(src + 256/2);
+	}
+	for (; dpixels > 0; dpixels--, src += 2, dst++)
+		*dst = do_one(*src);
+}
+
+// slower than the C version without NEON or SSE2
+#define HAVE_bgr555_to_rgb565_512_to_320
+void bgr555_to_rgb565_512_to_320(void * __restrict__ dst_,
+	const void * __restrict__ src_, int dpixels)
+{
+	const uint16_t * __restrict__ src = src_;
+	uint16_t * __restrict__ dst = dst_;
+	gvu16 c0x07c0 = gdup(0x07c0);
+
+	// convert all 16, then pick the 10 nearest to the dst pixel centers
+	for (; dpixels >= 10; dpixels -= 10, src += 16, dst += 10)
+	{
+		gvu16 d[2];
+		const uint16_t *p = (const uint16_t *)d;
+		do_one_simd(d[0], *(const gvu16u *)src, c0x07c0);
+		do_one_simd(d[1], *(const gvu16u *)(src + 8), c0x07c0);
+		dst[0] = p[0];  dst[1] = p[2];  dst[2] = p[4];
+		dst[3] = p[5];  dst[4] = p[7];  dst[5] = p[8];
+		dst[6] = p[10]; dst[7] = p[12]; dst[8] = p[13];
+		dst[9] = p[15];
+		__builtin_prefetch(src + 256/2);
+	}
+}
+#endif // gpick_even
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_bgr888_to_rgb565_640_to_320
+void bgr888_to_rgb565_640_to_320(void * __restrict__ dst_,
+	const void * __restrict__ src_, int dpixels)
+{
+	const uint8_t * __restrict__ src = src_;
+	uint16_t * __restrict__ dst = dst_;
+
+	for (; dpixels >= 8; dpixels -= 8, src += 16*3, dst += 8)
+	{
+		uint8x16x3_t s = vld3q_u8(src);
+		uint8x8_t r = vuzp_u8(vget_low_u8(s.val[0]), vget_high_u8(s.val[0])).val[0];
+		uint8x8_t g = vuzp_u8(vget_low_u8(s.val[1]), vget_high_u8(s.val[1])).val[0];
+		uint8x8_t b = vuzp_u8(vget_low_u8(s.val[2]), vget_high_u8(s.val[2])).val[0];
+		uint16x8_t d = vshll_n_u8(r, 8);
+		d = vsriq_n_u16(d, vshll_n_u8(g, 8), 5);
+		d = vsriq_n_u16(d, vshll_n_u8(b, 8), 11);
+		vst1q_u16(dst, d);
+		__builtin_prefetch(src + 256*3/2);
+	}
+	for (; dpixels > 0; dpixels--, src += 2*3, dst++)
+		*dst = ((src[0] & 0xf8) << 8) | ((src[1] & 0xfc) << 3) | (src[2] >> 3);
+}
+#endif
 #undef do_one
 #undef do_one_simd
 
@@ -145,12 +226,37 @@ static inline void bgr888_to_rgb888_one(uint8_t * __restrict__ dst,
 
 #ifndef HAVE_bgr888_to_x
 
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) \
+    && __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+#include <arm_neon.h>
+#define CSPACE_NEON_888
+
+static inline uint16x8_t bgr888_to_rgb565_8(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t d = vshll_n_u8(r, 8);
+	d = vsriq_n_u16(d, vshll_n_u8(g, 8), 5);
+	return vsriq_n_u16(d, vshll_n_u8(b, 8), 11);
+}
+#endif
+
 void attr_weak bgr888_to_rgb565(void * __restrict__ dst_,
 		const void * __restrict__ src_, int pixels)
 {
 	const uint8_t * __restrict__ src = src_;
 	uint32_t * __restrict__ dst = dst_;
 
+#ifdef CSPACE_NEON_888
+	for (; pixels >= 16; pixels -= 16, src += 16*3, dst += 8)
+	{
+		uint8x16x3_t s = vld3q_u8(src);
+		uint16_t *d = (uint16_t *)dst;
+		vst1q_u16(d, bgr888_to_rgb565_8(vget_low_u8(s.val[0]),
+			vget_low_u8(s.val[1]), vget_low_u8(s.val[2])));
+		vst1q_u16(d + 8, bgr888_to_rgb565_8(vget_high_u8(s.val[0]),
+			vget_high_u8(s.val[1]), vget_high_u8(s.val[2])));
+		__builtin_prefetch(src + 64*3);
+	}
+#endif
 	for (; pixels >= 2; pixels -= 2, src += 3*2, dst++)
 		*dst = bgr888_to_rgb565_pair(src, 3);
 }
@@ -163,7 +269,18 @@ void bgr888_to_rgb888(void * __restrict__ dst_,
 {
 	const uint8_t * __restrict__ src = src_;
 	uint8_t * __restrict__ dst = dst_;
-	
+
+#ifdef CSPACE_NEON_888
+	for (; pixels >= 16; pixels -= 16, src += 16*3, dst += 16*3)
+	{
+		uint8x16x3_t s = vld3q_u8(src), d;
+		d.val[0] = s.val[2];
+		d.val[1] = s.val[1];
+		d.val[2] = s.val[0];
+		vst3q_u8(dst, d);
+		__builtin_prefetch(src + 64*3);
+	}
+#endif
 	for (; pixels >= 1; pixels--, src += 3, dst += 3)
 		bgr888_to_rgb888_one(dst, src);
 }
@@ -203,6 +320,7 @@ void bgr888_to_xrgb8888(void * __restrict__ dst_,
 }
 
 /* downscale */
+#ifndef HAVE_bgr555_to_rgb565_640_to_320
 void bgr555_to_rgb565_640_to_320(void * __restrict__ dst_,
 	const void * __restrict__ src_, int dpixels)
 {
@@ -214,7 +332,9 @@ void bgr555_to_rgb565_640_to_320(void * __restrict__ dst_,
 		*dst = bgr555_to_rgb565_pair(p);
 	}
 }
+#endif
 
+#ifndef HAVE_bgr888_to_rgb565_640_to_320
 void bgr888_to_rgb565_640_to_320(void * __restrict__ dst_,
 	const void * __restrict__ src_, int dpixels)
 {
@@ -224,6 +344,7 @@ void bgr888_to_rgb565_640_to_320(void * __restrict__ dst_,
 	for (; dpixels >= 2; dpixels -= 2, src += 4*3, dst++)
 		*dst = bgr888_to_rgb565_pair(src, 2*3);
 }
+#endif
 
 void bgr888_to_rgb888_640_to_320(void * __restrict__ dst_,
 	const void * __restrict__ src_, int dpixels)
@@ -255,6 +376,7 @@ void bgr888_to_xrgb8888_640_to_320(void * __restrict__ dst_,
 		*dst = (src[0] << 16) | (src[1] << 8) | src[2];
 }
 
+#ifndef HAVE_bgr555_to_rgb565_512_to_320
 void bgr555_to_rgb565_512_to_320(void * __restrict__ dst_,
 	const void * __restrict__ src_, int dpixels)
 {
@@ -271,6 +393,7 @@ void bgr555_to_rgb565_512_to_320(void * __restrict__ dst_,
 		dst[4] = bgr555_to_rgb565_pair(LE32TOH(src[13] | (src[15] << 16)));
 	}
 }
+#endif
 
 void bgr888_to_rgb565_512_to_320(void * __restrict__ dst_,
 	const void * __restrict__ src_, int dpixels)
@@ -336,11 +459,11 @@ void bgr888_to_xrgb8888_512_to_320(void * __restrict__ dst_,
 /* YUV stuff */
 static int yuv_ry[32], yuv_gy[32], yuv_by[32];
 static unsigned char yuv_u[32 * 2], yuv_v[32 * 2];
+static unsigned char yuv_y[32];
 static struct uyvy { uint32_t y:8; uint32_t vyu:24; } yuv_uyvy[32768];
 
 void bgr_to_uyvy_init(void)
 {
-	unsigned char yuv_y[256];
 	int i, v;
 
 	/* init yuv converter:
@@ -349,10 +472,11 @@ void bgr_to_uyvy_init(void)
 	   u = (int)(8 * 0.565f * (b0 - y0)) + 128;
 	   v = (int)(8 * 0.713f * (r0 - y0)) + 128;
 	   */
+	// same weights as bgr888_to_uyvy(), linear so that SIMD can compute them
 	for (i = 0; i < 32; i++) {
-		yuv_ry[i] = (int)(0.299f * i * 65536.0f + 0.5f);
-		yuv_gy[i] = (int)(0.587f * i * 65536.0f + 0.5f);
-		yuv_by[i] = (int)(0.114f * i * 65536.0f + 0.5f);
+		yuv_ry[i] = 19595 * i;
+		yuv_gy[i] = 38470 * i;
+		yuv_by[i] = 7471 * i;
 	}
 	for (i = -32; i < 32; i++) {
 		v = (int)(8 * 0.565f * i) + 128;
@@ -369,7 +493,7 @@ void bgr_to_uyvy_init(void)
 		yuv_v[i + 32] = v;
 	}
 	// valid Y range seems to be 16..235
-	for (i = 0; i < 256; i++) {
+	for (i = 0; i < 32; i++) {
 		yuv_y[i] = 16 + 219 * i / 32;
 	}
 	// everything combined into one large array for speed
@@ -385,6 +509,136 @@ void bgr_to_uyvy_init(void)
 	}
 }
 
+#if defined(__aarch64__) && __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+#include <arm_neon.h>
+#define CSPACE_A64_UYVY
+
+// the 32/64 entry tables above fit in vqtbl registers
+struct uyvy_tbl {
+	uint8x16x2_t y;
+	uint8x16x4_t u, v;
+};
+
+static void uyvy_tbl_load(struct uyvy_tbl *t)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+		t->y.val[i] = vld1q_u8(yuv_y + i * 16);
+	for (i = 0; i < 4; i++) {
+		t->u.val[i] = vld1q_u8(yuv_u + i * 16);
+		t->v.val[i] = vld1q_u8(yuv_v + i * 16);
+	}
+}
+
+// y = (19595 * r + 38470 * g + 7471 * b) >> 16 for 8 pixels
+static inline uint16x8_t uyvy_y8(uint16x8_t r, uint16x8_t g, uint16x8_t b)
+{
+	uint32x4_t lo = vmull_n_u16(vget_low_u16(r), 19595);
+	uint32x4_t hi = vmull_n_u16(vget_high_u16(r), 19595);
+	lo = vmlal_n_u16(lo, vget_low_u16(g), 38470);
+	hi = vmlal_n_u16(hi, vget_high_u16(g), 38470);
+	lo = vmlal_n_u16(lo, vget_low_u16(b), 7471);
+	hi = vmlal_n_u16(hi, vget_high_u16(b), 7471);
+	return vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+}
+
+static inline void uyvy_store16(uint32_t *dst, uint8x16_t u, uint8x16_t y,
+	uint8x16_t v, int x2)
+{
+	if (x2) {
+		uint8x16x4_t o = {{ u, y, v, y }};
+		vst4q_u8((uint8_t *)dst, o);
+	}
+	else {
+		// chroma of the even pixel of each pair
+		uint8x8x4_t o = {{
+			vget_low_u8(vuzp1q_u8(u, u)), vget_low_u8(vuzp1q_u8(y, y)),
+			vget_low_u8(vuzp1q_u8(v, v)), vget_low_u8(vuzp2q_u8(y, y))
+		}};
+		vst4_u8((uint8_t *)dst, o);
+	}
+}
+
+// returns the pixels done, that many from the row ends are left to C
+static int bgr555_to_uyvy_a64(uint32_t *dst, const uint16_t *src,
+	int pixels, int x2)
+{
+	const uint16x8_t m = vdupq_n_u16(0x1f);
+	const uint8x16_t c32 = vdupq_n_u8(32);
+	struct uyvy_tbl t;
+	int done;
+
+	uyvy_tbl_load(&t);
+	for (done = 0; done + 16 <= pixels; done += 16, src += 16)
+	{
+		uint16x8_t s0 = vld1q_u16(src), s1 = vld1q_u16(src + 8);
+		uint16x8_t r0 = vandq_u16(s0, m), r1 = vandq_u16(s1, m);
+		uint16x8_t g0 = vandq_u16(vshrq_n_u16(s0, 5), m);
+		uint16x8_t g1 = vandq_u16(vshrq_n_u16(s1, 5), m);
+		uint16x8_t b0 = vandq_u16(vshrq_n_u16(s0, 10), m);
+		uint16x8_t b1 = vandq_u16(vshrq_n_u16(s1, 10), m);
+		uint8x16_t y = vcombine_u8(vmovn_u16(uyvy_y8(r0, g0, b0)),
+			vmovn_u16(uyvy_y8(r1, g1, b1)));
+		uint8x16_t r = vcombine_u8(vmovn_u16(r0), vmovn_u16(r1));
+		uint8x16_t b = vcombine_u8(vmovn_u16(b0), vmovn_u16(b1));
+		uint8x16_t u = vqtbl4q_u8(t.u, vaddq_u8(vsubq_u8(b, y), c32));
+		uint8x16_t v = vqtbl4q_u8(t.v, vaddq_u8(vsubq_u8(r, y), c32));
+		uyvy_store16(dst, u, vqtbl2q_u8(t.y, y), v, x2);
+		dst += x2 ? 16 : 8;
+		__builtin_prefetch(src + 128);
+	}
+	return done;
+}
+
+// (c - y) / 8 + 32, rounding towards 0 like C
+static inline uint8x8_t uyvy_cidx8(uint16x8_t c, uint16x8_t y)
+{
+	int16x8_t d = vreinterpretq_s16_u16(vsubq_u16(c, y));
+	d = vaddq_s16(d, vandq_s16(vshrq_n_s16(d, 15), vdupq_n_s16(7)));
+	d = vaddq_s16(vshrq_n_s16(d, 3), vdupq_n_s16(32));
+	return vmovn_u16(vreinterpretq_u16_s16(d));
+}
+
+// 16 + 219 * y / 255
+static inline uint8x8_t uyvy_y888(uint16x8_t y)
+{
+	uint16x8_t t = vmulq_n_u16(y, 219);
+	t = vaddq_u16(t, vaddq_u16(vshrq_n_u16(t, 8), vdupq_n_u16(1)));
+	return vadd_u8(vshrn_n_u16(t, 8), vdup_n_u8(16));
+}
+
+static int bgr888_to_uyvy_a64(uint32_t *dst, const uint8_t *src,
+	int pixels, int x2)
+{
+	struct uyvy_tbl t;
+	int done, h;
+
+	uyvy_tbl_load(&t);
+	for (done = 0; done + 16 <= pixels; done += 16, src += 16*3)
+	{
+		uint8x16x3_t s = vld3q_u8(src);
+		uint8x8_t y8[2], ui[2], vi[2];
+		for (h = 0; h < 2; h++) {
+			uint16x8_t r = vmovl_u8(h ? vget_high_u8(s.val[0]) : vget_low_u8(s.val[0]));
+			uint16x8_t g = vmovl_u8(h ? vget_high_u8(s.val[1]) : vget_low_u8(s.val[1]));
+			uint16x8_t b = vmovl_u8(h ? vget_high_u8(s.val[2]) : vget_low_u8(s.val[2]));
+			uint16x8_t y = uyvy_y8(r, g, b);
+			ui[h] = uyvy_cidx8(b, y);
+			vi[h] = uyvy_cidx8(r, y);
+			y8[h] = uyvy_y888(y);
+		}
+		uyvy_store16(dst,
+			vqtbl4q_u8(t.u, vcombine_u8(ui[0], ui[1])),
+			vcombine_u8(y8[0], y8[1]),
+			vqtbl4q_u8(t.v, vcombine_u8(vi[0], vi[1])), x2);
+		dst += x2 ? 16 : 8;
+		__builtin_prefetch(src + 64*3);
+	}
+	return done;
+}
+#endif
+
 void rgb565_to_uyvy(void *d, const void *s, int pixels)
 {
   unsigned int *dst = d;
@@ -420,6 +674,12 @@ void bgr555_to_uyvy(void *d, const void *s, int pixels, int x2)
 	const uint16_t *src = s;
 	int i;
 
+#ifdef CSPACE_A64_UYVY
+	i = bgr555_to_uyvy_a64(dst, src, pixels, x2);
+	src += i;
+	dst += x2 ? i : i / 2;
+	pixels -= i;
+#endif
 	if (x2) {
 		for (i = pixels; i >= 4; src += 4, dst += 4, i -= 4)
 		{
@@ -466,6 +726,13 @@ void bgr888_to_uyvy(void *d, const void *s, int pixels, int x2)
 	int r0, g0, b0, r1, g1, b1;
 	int y0, y1, u0, u1, v0, v1;
 
+#ifdef CSPACE_A64_UYVY
+	int done = bgr888_to_uyvy_a64(dst, src8, pixels, x2);
+	src8 += done * 3;
+	dst += x2 ? done : done / 2;
+	pixels -= done;
+#endif
+
 	if (x2) {
 		for (; pixels >= 2; src8 += 3*2, pixels -= 2)
 		{
@@ -0,0 +1,158 @@
+/*
+ * Ring buffered begin/end event tracer, see include/evtrace.h
+ *
+ * This work is licensed under the terms of the GNU GPLv2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // pthread_getname_np
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <pthread.h>
+#endif
+#include "evtrace.h"
+
+// 16 bytes each, 4MB
+#define EVT_RING_BITS	18
+#define EVT_RING_SIZE	(1u << EVT_RING_BITS)
+#define EVT_THREADS	16
+
+struct evt_entry {
+	uint64_t ns;
+	uint32_t arg;
+	uint8_t id, ph, tid, pad;
+};
+
+static const char * const evt_names[EVT_COUNT] = {
+	[EVT_EVENT] = "event",
+	[EVT_DMA0] = "dma0 mdec in",	[EVT_DMA1] = "dma1 mdec out",
+	[EVT_DMA2] = "dma2 gpu",	[EVT_DMA3] = "dma3 cdrom",
+	[EVT_DMA4] = "dma4 spu",	[EVT_DMA5] = "dma5",
+	[EVT_DMA6] = "dma6 otc",
+	[EVT_GPU_CMD] = "gpu cmds",	[EVT_GPU_WAIT] = "gpu wait",
+	[EVT_VOUT] = "vout_update",
+	[EVT_SPU] = "do_samples",	[EVT_SPU_WORK] = "spu work",
+	[EVT_CDR_READ] = "cdr read",	[EVT_CDR_CACHE] = "cdr prefetch",
+};
+
+int evtrace_on;
+
+static struct {
+	struct evt_entry *ring;
+	uint32_t pos;
+	uint32_t threads;
+	uint64_t ns_start;
+	char tnames[EVT_THREADS][16];
+} evt;
+
+static __thread int evt_tid = -1;
+
+static uint64_t evt_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int evt_new_tid(void)
+{
+	uint32_t tid = __atomic_fetch_add(&evt.threads, 1, __ATOMIC_RELAXED);
+	if (tid >= EVT_THREADS)
+		return EVT_THREADS - 1; // lumped together, unlikely anyway
+	snprintf(evt.tnames[tid], sizeof(evt.tnames[tid]), "thread %u", tid);
+#ifdef __GLIBC__
+	// pcsxr_sthread_create() names its threads
+	pthread_getname_np(pthread_self(), evt.tnames[tid], sizeof(evt.tnames[tid]));
+#endif
+	return tid;
+}
+
+// lock free, concurrent writers each claim their own slot
+void evtrace_add(int id, int ph, unsigned int arg)
+{
+	struct evt_entry *e;
+	uint32_t pos;
+
+	if (evt_tid < 0)
+		evt_tid = evt_new_tid();
+	pos = __atomic_fetch_add(&evt.pos, 1, __ATOMIC_RELAXED);
+	e = &evt.ring[pos & (EVT_RING_SIZE - 1)];
+	e->ns = evt_now();
+	e->arg = arg;
+	e->id = id;
+	e->ph = ph;
+	e->tid = evt_tid;
+}
+
+int evtrace_start(void)
+{
+	if (evt.ring == NULL) {
+		evt.ring = calloc(EVT_RING_SIZE, sizeof(evt.ring[0]));
+		if (evt.ring == NULL)
+			return -1;
+	}
+	else
+		memset(evt.ring, 0, EVT_RING_SIZE * sizeof(evt.ring[0]));
+	evt.pos = 0;
+	evt.ns_start = evt_now();
+	__atomic_store_n(&evtrace_on, 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void evtrace_stop(void)
+{
+	__atomic_store_n(&evtrace_on, 0, __ATOMIC_RELEASE);
+}
+
+// stops tracing, a writer that already passed the check may still
+// be storing its slot, at worst that event comes out garbled
+int evtrace_dump(const char *path)
+{
+	uint32_t i, n, start, threads;
+	const char *sep = "";
+	FILE *f;
+
+	evtrace_stop();
+	if (evt.ring == NULL)
+		return -1;
+	f = fopen(path, "w");
+	if (f == NULL) {
+		fprintf(stderr, "evtrace: can't open %s\n", path);
+		return -1;
+	}
+
+	n = __atomic_load_n(&evt.pos, __ATOMIC_ACQUIRE);
+	start = n > EVT_RING_SIZE ? n - EVT_RING_SIZE : 0;
+	threads = evt.threads < EVT_THREADS ? evt.threads : EVT_THREADS;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (i = 0; i < threads; i++, sep = ",\n")
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":%u,\"args\":{\"name\":\"%s\"}}", sep, i, evt.tnames[i]);
+	for (i = start; i != n; i++) {
+		const struct evt_entry *e = &evt.ring[i & (EVT_RING_SIZE - 1)];
+		uint64_t ns = e->ns - evt.ns_start;
+
+		if ((e->ph != 'B' && e->ph != 'E') || e->id >= EVT_COUNT
+		    || e->ns < evt.ns_start)
+			continue;
+		fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"psx\",\"ph\":\"%c\","
+			"\"ts\":%u.%03u,\"pid\":1,\"tid\":%u", sep, evt_names[e->id],
+			e->ph, (unsigned int)(ns / 1000), (unsigned int)(ns % 1000), e->tid);
+		if (e->ph == 'B')
+			fprintf(f, ",\"args\":{\"arg\":\"0x%x\"}", e->arg);
+		fputc('}', f);
+		sep = ",\n";
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+
+	printf("evtrace: %u of %u events written to %s\n", n - start, n, path);
+	return 0;
+}
@@ -12,8 +12,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <png.h>
 #include <SDL.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 #include "libpicofe/input.h"
 #include "plugin_lib.h"
@@ -44,6 +48,12 @@ static icon_t game_icons[4];  /* TRIANGLE, CIRCLE, CROSS, SQUARE */
 #define ICON_CROSS    2
 #define ICON_SQUARE   3
 
+/* The PNGs are decoded on a thread to keep them off the startup path,
+ * the overlay is drawn without icons until icons_ready gets set */
+static pthread_t icon_thread;
+static int icon_thread_started;
+static volatile int icons_ready;
+
 #define TOUCH_SCREEN_W 1024
 #define TOUCH_SCREEN_H 768
 
@@ -127,6 +137,9 @@ static int overlay_visible = 1;
 static int initialized = 0;
 static int menu_mode = 0;
 
+/* Bumped whenever what webos_touch_draw_overlay_sdl() would draw changes */
+static unsigned int overlay_serial = 0;
+
 /* Track current screen dimensions for coordinate scaling */
 static int current_screen_w = TOUCH_SCREEN_W;
 static int current_screen_h = TOUCH_SCREEN_H;
@@ -181,63 +194,80 @@ static SDLKey menu_key_to_sdlkey(int menu_key)
     return SDLK_UNKNOWN;
 }
 
-static void draw_rect_sdl(SDL_Surface *surface, int x, int y, int w, int h, Uint16 color)
+/*
+ * The controls are rendered once into a premultiplied RGBA layer and
+ * turned into runs of non-transparent pixels, each pixel stored as a
+ * premultiplied RGB565 color plus an 8 bit inverse alpha. Drawing a frame
+ * is then a single blend pass over those runs; the layer is only
+ * re-rendered when overlay_serial or the screen size changes.
+ */
+typedef struct {
+    unsigned short x, y, len;
+    unsigned int offs;  /* into ovl.color/ovl.ia */
+} ovl_run_t;
+
+static struct {
+    unsigned int serial;
+    int w, h, valid;
+    unsigned char *layer;  /* w * h premultiplied RGBA, zone rects only */
+    ovl_run_t *runs;
+    int run_count, run_alloc;
+    unsigned short *color, *ia;
+    int px_count, px_alloc;
+} ovl;
+
+#define RGB565_R(c) ((((c) >> 11) & 0x1f) << 3)
+#define RGB565_G(c) ((((c) >> 5) & 0x3f) << 2)
+#define RGB565_B(c) (((c) & 0x1f) << 3)
+
+/* Composite a color over a layer pixel */
+static void layer_over(unsigned char *d, int r, int g, int b, int alpha)
 {
-    SDL_Rect rect = { x, y, w, h };
-    SDL_FillRect(surface, &rect, color);
+    int ia = 255 - alpha;
+
+    d[0] = (r * alpha + d[0] * ia) / 255;
+    d[1] = (g * alpha + d[1] * ia) / 255;
+    d[2] = (b * alpha + d[2] * ia) / 255;
+    d[3] = alpha + d[3] * ia / 255;
 }
 
-/* Draw a rectangle with alpha blending */
-static void draw_rect_alpha(SDL_Surface *surface, int x, int y, int w, int h,
-                            int r, int g, int b, int alpha)
+/* Clip a rect to the layer, returns 0 if nothing is left */
+static int layer_clip(int *x, int *y, int *w, int *h)
 {
-    int px, py;
-    Uint16 *dst;
-    int dst_pitch;
-
-    if (x < 0) { w += x; x = 0; }
-    if (y < 0) { h += y; y = 0; }
-    if (x + w > surface->w) w = surface->w - x;
-    if (y + h > surface->h) h = surface->h - y;
-    if (w <= 0 || h <= 0) return;
-
-    dst = (Uint16 *)surface->pixels;
-    dst_pitch = surface->pitch / 2;
-
-    for (py = y; py < y + h; py++) {
-        for (px = x; px < x + w; px++) {
-            Uint16 *pixel = dst + py * dst_pitch + px;
-            Uint16 bg = *pixel;
-
-            int bg_r = ((bg >> 11) & 0x1F) << 3;
-            int bg_g = ((bg >> 5) & 0x3F) << 2;
-            int bg_b = (bg & 0x1F) << 3;
-
-            int out_r = (r * alpha + bg_r * (255 - alpha)) / 255;
-            int out_g = (g * alpha + bg_g * (255 - alpha)) / 255;
-            int out_b = (b * alpha + bg_b * (255 - alpha)) / 255;
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > ovl.w) *w = ovl.w - *x;
+    if (*y + *h > ovl.h) *h = ovl.h - *y;
+    return *w > 0 && *h > 0;
+}
 
-            *pixel = ((out_r >> 3) << 11) | ((out_g >> 2) << 5) | (out_b >> 3);
-        }
-    }
+static void layer_clear(int x, int y, int w, int h)
+{
+    if (!layer_clip(&x, &y, &w, &h))
+        return;
+    for (; h > 0; h--, y++)
+        memset(ovl.layer + (y * ovl.w + x) * 4, 0, w * 4);
 }
 
-static void draw_rect_outline_sdl(SDL_Surface *surface, int x, int y, int w, int h, Uint16 color, int thickness)
+static void layer_rect(int x, int y, int w, int h, int r, int g, int b, int alpha)
 {
-    draw_rect_sdl(surface, x, y, w, thickness, color);
-    draw_rect_sdl(surface, x, y + h - thickness, w, thickness, color);
-    draw_rect_sdl(surface, x, y, thickness, h, color);
-    draw_rect_sdl(surface, x + w - thickness, y, thickness, h, color);
+    int px, py;
+
+    if (!layer_clip(&x, &y, &w, &h))
+        return;
+
+    for (py = y; py < y + h; py++)
+        for (px = x; px < x + w; px++)
+            layer_over(ovl.layer + (py * ovl.w + px) * 4, r, g, b, alpha);
 }
 
-/* Draw outline with alpha blending */
-static void draw_rect_outline_alpha(SDL_Surface *surface, int x, int y, int w, int h,
-                                    int r, int g, int b, int alpha, int thickness)
+static void layer_rect_outline(int x, int y, int w, int h,
+                               int r, int g, int b, int alpha, int thickness)
 {
-    draw_rect_alpha(surface, x, y, w, thickness, r, g, b, alpha);
-    draw_rect_alpha(surface, x, y + h - thickness, w, thickness, r, g, b, alpha);
-    draw_rect_alpha(surface, x, y, thickness, h, r, g, b, alpha);
-    draw_rect_alpha(surface, x + w - thickness, y, thickness, h, r, g, b, alpha);
+    layer_rect(x, y, w, thickness, r, g, b, alpha);
+    layer_rect(x, y + h - thickness, w, thickness, r, g, b, alpha);
+    layer_rect(x, y, thickness, h, r, g, b, alpha);
+    layer_rect(x + w - thickness, y, thickness, h, r, g, b, alpha);
 }
 
 /* Load a PNG file with alpha channel */
@@ -375,10 +405,24 @@ static void load_icons(void)
     }
 }
 
+static void *icon_loader(void *unused)
+{
+    load_icons();
+    __sync_synchronize();
+    icons_ready = 1;
+    return NULL;
+}
+
 /* Free all icons */
 static void free_icons(void)
 {
     int i;
+
+    if (icon_thread_started) {
+        pthread_join(icon_thread, NULL);
+        icon_thread_started = 0;
+    }
+    icons_ready = 0;
     for (i = 0; i < 6; i++) {
         if (menu_icons[i].pixels) {
             free(menu_icons[i].pixels);
@@ -395,84 +439,157 @@ static void free_icons(void)
     }
 }
 
-/* Blit an RGBA icon to an RGB565 surface with alpha blending */
-static void blit_icon(SDL_Surface *surface, icon_t *icon, int dest_x, int dest_y, int dest_w, int dest_h)
+/* Draw a scaled RGBA icon into the layer */
+static void layer_icon(icon_t *icon, int dest_x, int dest_y, int dest_w, int dest_h)
 {
     int x, y;
     int src_x, src_y;
-    Uint16 *dst;
-    int dst_pitch;
 
+    if (!icons_ready)
+        return;
+    __sync_synchronize();
     if (!icon->loaded || !icon->pixels)
         return;
 
-    dst = (Uint16 *)surface->pixels;
-    dst_pitch = surface->pitch / 2;
-
     for (y = 0; y < dest_h; y++) {
         int screen_y = dest_y + y;
-        if (screen_y < 0 || screen_y >= surface->h)
+        if (screen_y < 0 || screen_y >= ovl.h)
             continue;
 
         src_y = y * icon->height / dest_h;
 
         for (x = 0; x < dest_w; x++) {
             int screen_x = dest_x + x;
-            if (screen_x < 0 || screen_x >= surface->w)
+            const unsigned char *src_pixel;
+
+            if (screen_x < 0 || screen_x >= ovl.w)
                 continue;
 
             src_x = x * icon->width / dest_w;
+            src_pixel = icon->pixels + (src_y * icon->width + src_x) * 4;
+            if (src_pixel[3] == 0)
+                continue;  /* Fully transparent */
 
-            unsigned char *src_pixel = icon->pixels + (src_y * icon->width + src_x) * 4;
-            unsigned char r = src_pixel[0];
-            unsigned char g = src_pixel[1];
-            unsigned char b = src_pixel[2];
-            unsigned char a = src_pixel[3];
+            layer_over(ovl.layer + (screen_y * ovl.w + screen_x) * 4,
+                       src_pixel[0], src_pixel[1], src_pixel[2], src_pixel[3]);
+        }
+    }
+}
 
-            if (a == 0)
-                continue;  /* Fully transparent */
+static int ovl_reserve(int runs, int pixels)
+{
+    if (ovl.run_count + runs > ovl.run_alloc) {
+        int n = (ovl.run_count + runs) * 2;
+        ovl_run_t *r = realloc(ovl.runs, n * sizeof(*r));
+        if (!r)
+            return -1;
+        ovl.runs = r;
+        ovl.run_alloc = n;
+    }
+    if (ovl.px_count + pixels > ovl.px_alloc) {
+        int n = (ovl.px_count + pixels) * 2;
+        unsigned short *c, *a;
+
+        c = realloc(ovl.color, n * sizeof(*c));
+        if (!c)
+            return -1;
+        ovl.color = c;
+        a = realloc(ovl.ia, n * sizeof(*a));
+        if (!a)
+            return -1;
+        ovl.ia = a;
+        ovl.px_alloc = n;
+    }
+    return 0;
+}
 
-            Uint16 *dst_pixel = dst + screen_y * dst_pitch + screen_x;
+/* Turn the non-transparent pixels of a layer rect into runs */
+static int layer_to_runs(int x, int y, int w, int h)
+{
+    int px, py, start;
 
-            if (a == 255) {
-                /* Fully opaque */
-                *dst_pixel = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
-            } else {
-                /* Alpha blend */
-                Uint16 bg = *dst_pixel;
-                int bg_r = ((bg >> 11) & 0x1F) << 3;
-                int bg_g = ((bg >> 5) & 0x3F) << 2;
-                int bg_b = (bg & 0x1F) << 3;
+    if (!layer_clip(&x, &y, &w, &h))
+        return 0;
 
-                int out_r = (r * a + bg_r * (255 - a)) / 255;
-                int out_g = (g * a + bg_g * (255 - a)) / 255;
-                int out_b = (b * a + bg_b * (255 - a)) / 255;
+    for (py = y; py < y + h; py++) {
+        const unsigned char *l = ovl.layer + py * ovl.w * 4;
+        for (px = x; px < x + w; ) {
+            ovl_run_t *run;
 
-                *dst_pixel = ((out_r >> 3) << 11) | ((out_g >> 2) << 5) | (out_b >> 3);
+            if (l[px * 4 + 3] == 0) {
+                px++;
+                continue;
+            }
+            for (start = px; px < x + w && l[px * 4 + 3] != 0; px++)
+                ;
+            if (ovl_reserve(1, px - start) != 0)
+                return -1;
+
+            run = &ovl.runs[ovl.run_count++];
+            run->x = start;
+            run->y = py;
+            run->len = px - start;
+            run->offs = ovl.px_count;
+            for (; start < px; start++) {
+                const unsigned char *p = l + start * 4;
+                ovl.color[ovl.px_count] =
+                    ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+                /* rounded down so that color + scaled bg never carries */
+                ovl.ia[ovl.px_count] = (255 - p[3]) * 256 / 255;
+                ovl.px_count++;
             }
         }
     }
+    return 0;
+}
+
+/* Blend one run over the RGB565 screen */
+static void blend_run(unsigned short *dst, const unsigned short *color,
+                      const unsigned short *ia, int len)
+{
+    int i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint16x8_t m5 = vdupq_n_u16(0x1f), m6 = vdupq_n_u16(0x3f);
+
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t bg = vld1q_u16(dst + i), a = vld1q_u16(ia + i);
+        uint16x8_t r = vshrq_n_u16(vmulq_u16(vshrq_n_u16(bg, 11), a), 8);
+        uint16x8_t g = vshrq_n_u16(vmulq_u16(vandq_u16(vshrq_n_u16(bg, 5), m6), a), 8);
+        uint16x8_t b = vshrq_n_u16(vmulq_u16(vandq_u16(bg, m5), a), 8);
+        uint16x8_t o = vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+        vst1q_u16(dst + i, vaddq_u16(o, vld1q_u16(color + i)));
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned int bg = dst[i], a = ia[i];
+        unsigned int r = (bg >> 11) * a >> 8;
+        unsigned int g = ((bg >> 5) & 0x3f) * a >> 8;
+        unsigned int b = (bg & 0x1f) * a >> 8;
+        dst[i] = color[i] + ((r << 11) | (g << 5) | b);
+    }
 }
 
 /* GL version - currently a no-op, touch controls drawn via SDL surface */
 void webos_touch_draw_overlay(void) {}
 
-void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
+/* Render the controls for the current state into the layer and runs */
+static int render_overlay(int screen_w, int screen_h)
 {
     int i;
     float scale_x, scale_y;
-    int screen_w, screen_h;
     const touch_zone_t *zones;
     int num_zones;
 
-    if (!overlay_visible || !initialized || !screen)
-        return;
-
-    screen_w = screen->w;
-    screen_h = screen->h;
-
-    current_screen_w = screen_w;
-    current_screen_h = screen_h;
+    if (ovl.layer == NULL || ovl.w != screen_w || ovl.h != screen_h) {
+        free(ovl.layer);
+        ovl.layer = calloc(screen_w * screen_h, 4);
+        if (!ovl.layer)
+            return -1;
+        ovl.w = screen_w;
+        ovl.h = screen_h;
+    }
+    ovl.run_count = ovl.px_count = 0;
 
     if (menu_mode) {
         zones = menu_touch_zones;
@@ -485,9 +602,6 @@ void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
     scale_x = (float)screen_w / TOUCH_SCREEN_W;
     scale_y = (float)screen_h / TOUCH_SCREEN_H;
 
-    if (SDL_MUSTLOCK(screen))
-        SDL_LockSurface(screen);
-
     for (i = 0; i < num_zones; i++) {
         const touch_zone_t *zone = &zones[i];
         int pressed = 0;
@@ -512,22 +626,28 @@ void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
             continue;
         }
 
+        layer_clear(draw_x, draw_y, draw_w, draw_h);
+
         if (pressed) {
             /* Alpha blended pressed highlight for game mode, solid for menu */
             if (menu_mode) {
-                draw_rect_sdl(screen, draw_x, draw_y, draw_w, draw_h, COLOR_BUTTON_PRESSED);
+                layer_rect(draw_x, draw_y, draw_w, draw_h,
+                           RGB565_R(COLOR_BUTTON_PRESSED), RGB565_G(COLOR_BUTTON_PRESSED),
+                           RGB565_B(COLOR_BUTTON_PRESSED), 255);
             } else {
-                draw_rect_alpha(screen, draw_x, draw_y, draw_w, draw_h,
-                                PRESSED_R, PRESSED_G, PRESSED_B, PRESSED_ALPHA);
+                layer_rect(draw_x, draw_y, draw_w, draw_h,
+                           PRESSED_R, PRESSED_G, PRESSED_B, PRESSED_ALPHA);
             }
         }
 
         /* Draw button outline - alpha blended for game mode, solid for menu */
         if (menu_mode) {
-            draw_rect_outline_sdl(screen, draw_x, draw_y, draw_w, draw_h, COLOR_BUTTON_BORDER, 2);
+            layer_rect_outline(draw_x, draw_y, draw_w, draw_h,
+                               RGB565_R(COLOR_BUTTON_BORDER), RGB565_G(COLOR_BUTTON_BORDER),
+                               RGB565_B(COLOR_BUTTON_BORDER), 255, 2);
         } else {
-            draw_rect_outline_alpha(screen, draw_x, draw_y, draw_w, draw_h,
-                                    BORDER_R, BORDER_G, BORDER_B, BORDER_ALPHA, 2);
+            layer_rect_outline(draw_x, draw_y, draw_w, draw_h,
+                               BORDER_R, BORDER_G, BORDER_B, BORDER_ALPHA, 2);
         }
 
         /* Draw icons for menu buttons */
@@ -559,7 +679,7 @@ void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
             }
 
             if (icon && icon->loaded) {
-                blit_icon(screen, icon, icon_x, icon_y, icon_size, icon_size);
+                layer_icon(icon, icon_x, icon_y, icon_size, icon_size);
             }
         } else {
             /* Draw icons for game action buttons */
@@ -584,9 +704,47 @@ void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
             }
 
             if (icon && icon->loaded) {
-                blit_icon(screen, icon, icon_x, icon_y, icon_size, icon_size);
+                layer_icon(icon, icon_x, icon_y, icon_size, icon_size);
             }
         }
+
+        if (layer_to_runs(draw_x, draw_y, draw_w, draw_h) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+void webos_touch_draw_overlay_sdl(SDL_Surface *screen)
+{
+    unsigned int serial = webos_touch_overlay_serial();
+    unsigned short *dst;
+    int i, pitch;
+
+    if (!overlay_visible || !initialized || !screen)
+        return;
+
+    current_screen_w = screen->w;
+    current_screen_h = screen->h;
+
+    if (!ovl.valid || ovl.serial != serial
+        || ovl.w != screen->w || ovl.h != screen->h) {
+        ovl.serial = serial;
+        ovl.valid = render_overlay(screen->w, screen->h) == 0;
+        if (!ovl.valid) {
+            fprintf(stderr, "WebOS Touch: overlay render failed\n");
+            return;
+        }
+    }
+
+    if (SDL_MUSTLOCK(screen))
+        SDL_LockSurface(screen);
+
+    dst = screen->pixels;
+    pitch = screen->pitch / 2;
+    for (i = 0; i < ovl.run_count; i++) {
+        const ovl_run_t *run = &ovl.runs[i];
+        blend_run(dst + run->y * pitch + run->x, ovl.color + run->offs,
+                  ovl.ia + run->offs, run->len);
     }
 
     if (SDL_MUSTLOCK(screen))
@@ -693,6 +851,7 @@ int webos_touch_event(const SDL_Event *event)
                 return 2;
             }
             finger_zones[finger_id] = zone;
+            overlay_serial++;
 
             if (menu_mode) {
                 /* Menu mode: inject a complete keystroke immediately on tap */
@@ -717,8 +876,11 @@ int webos_touch_event(const SDL_Event *event)
             for (i = 0; i < MAX_FINGERS; i++) {
                 finger_zones[i] = -1;
             }
+            overlay_serial++;
         } else {
             /* Game mode: simple finger tracking (original behavior) */
+            if (finger_zones[finger_id] >= 0)
+                overlay_serial++;
             finger_zones[finger_id] = -1;
             update_buttons();
         }
@@ -736,6 +898,8 @@ int webos_touch_event(const SDL_Event *event)
             x = event->motion.x;
             y = event->motion.y;
             zone = find_zone(x, y);
+            if (finger_zones[finger_id] != zone)
+                overlay_serial++;
             finger_zones[finger_id] = zone;
             update_buttons();
         }
@@ -755,9 +919,17 @@ int webos_touch_get_buttons(void)
 
 void webos_touch_set_overlay_visible(int visible)
 {
+    if (overlay_visible != visible)
+        overlay_serial++;
     overlay_visible = visible;
 }
 
+unsigned int webos_touch_overlay_serial(void)
+{
+    /* icons showing up changes the overlay too */
+    return overlay_serial * 2 + icons_ready;
+}
+
 int webos_touch_init(void)
 {
     int i;
@@ -785,7 +957,11 @@ int webos_touch_init(void)
     initialized = 1;
 
     /* Load menu button icons */
-    load_icons();
+    icons_ready = 0;
+    icon_thread_started =
+        pthread_create(&icon_thread, NULL, icon_loader, NULL) == 0;
+    if (!icon_thread_started)
+        icon_loader(NULL);
 
     printf("WebOS Touch [TapKey]: %d game zones, %d menu zones\n",
            (int)NUM_GAME_ZONES, (int)NUM_MENU_ZONES);
@@ -795,6 +971,11 @@ int webos_touch_init(void)
 void webos_touch_finish(void)
 {
     free_icons();
+    free(ovl.layer);
+    free(ovl.runs);
+    free(ovl.color);
+    free(ovl.ia);
+    memset(&ovl, 0, sizeof(ovl));
     initialized = 0;
 }
 
@@ -809,6 +990,7 @@ void webos_touch_set_menu_mode(int in_menu)
             finger_zones[i] = -1;
         }
         current_buttons = 0;
+        overlay_serial++;
 
         /* Flush any stale touch events when switching modes */
         while (SDL_PeepEvents(&event, 1, SDL_GETEVENT,
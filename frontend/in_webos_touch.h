@@ -39,6 +39,9 @@ void webos_touch_draw_overlay_sdl(SDL_Surface *screen);
 /* Show/hide the overlay */
 void webos_touch_set_overlay_visible(int visible);
 
+/* Changes whenever the overlay needs to be redrawn */
+unsigned int webos_touch_overlay_serial(void);
+
 #endif /* WEBOS */
 
 #endif /* IN_WEBOS_TOUCH_H */
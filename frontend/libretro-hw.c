@@ -0,0 +1,279 @@
+/*
+ * libretro hardware rendered output, see libretro-hw.h
+ *
+ * This work is licensed under the terms of the GNU GPLv2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <string.h>
+#include <glsym/glsym.h>
+#include "libretro-hw.h"
+#include "../libpcsxcore/psxcommon.h"
+
+// vram (or the enhancement buffer) rows as 2 byte luminance+alpha texels,
+// the shader reassembles the 15 or 24 bit pixels from the bytes
+#define LRHW_TEX_W	1024
+#define LRHW_TEX_H	1024
+#define LRHW_ROW_BYTES	(LRHW_TEX_W * 2)
+
+static const char lrhw_vsh[] =
+   "attribute vec2 a_pos;\n"
+   "uniform vec4 u_rect;\n" // dst x, y, w, h
+   "uniform vec2 u_fb;\n"
+   "varying vec2 v_pix;\n"
+   "void main() {\n"
+   "   vec2 p = (u_rect.xy + a_pos * u_rect.zw) / u_fb * 2.0 - 1.0;\n"
+   "   v_pix = a_pos * u_rect.zw;\n"
+   "   gl_Position = vec4(p, 0.0, 1.0);\n"
+   "}\n";
+
+static const char lrhw_fsh[] =
+   "#ifdef GL_ES\n"
+   "precision highp float;\n"
+   "#endif\n"
+   "uniform sampler2D u_tex;\n"
+   "uniform vec4 u_src;\n" // x byte offset, row step, src/dst x ratio, bytes/pixel
+   "uniform float u_wrap;\n"
+   "varying vec2 v_pix;\n"
+   "float vbyte(float ofs, float row) {\n"
+   "   ofs = mod(ofs, u_wrap);\n"
+   "   vec4 c = texture2D(u_tex, vec2((floor(ofs * 0.5) + 0.5) / 1024.0,\n"
+   "                                  (row + 0.5) / 1024.0));\n"
+   "   return floor((mod(ofs, 2.0) < 0.5 ? c.r : c.a) * 255.0 + 0.5);\n"
+   "}\n"
+   "void main() {\n"
+   "   float row = floor(v_pix.y) * u_src.y;\n"
+   "   float ofs = u_src.x + floor(floor(v_pix.x) * u_src.z) * u_src.w;\n"
+   "   vec3 c;\n"
+   "   if (u_src.w > 2.5) {\n"
+   "      c = vec3(vbyte(ofs, row), vbyte(ofs + 1.0, row),\n"
+   "               vbyte(ofs + 2.0, row)) / 255.0;\n"
+   "   } else {\n"
+   "      float v = vbyte(ofs, row) + vbyte(ofs + 1.0, row) * 256.0;\n"
+   "      c = vec3(mod(v, 32.0), mod(floor(v / 32.0), 32.0),\n"
+   "               mod(floor(v / 1024.0), 32.0)) / 31.0;\n"
+   "   }\n"
+   "   gl_FragColor = vec4(c, 1.0);\n"
+   "}\n";
+
+static struct {
+   struct retro_hw_render_callback cb;
+   int ready;
+   GLuint prog, tex;
+   GLint u_rect, u_fb, u_src, u_wrap;
+   // the last frame, for redrawing when the frontend can't dupe
+   struct {
+      int valid, blank;
+      float rect[4], src[4], wrap;
+   } last;
+} hw;
+
+static GLuint lrhw_shader(GLenum type, const char *src)
+{
+   GLuint s = glCreateShader(type);
+   GLint ok = 0;
+   char log[256];
+
+   glShaderSource(s, 1, &src, NULL);
+   glCompileShader(s);
+   glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+   if (!ok) {
+      glGetShaderInfoLog(s, sizeof(log), NULL, log);
+      SysPrintf("lrhw: shader compile failed: %s\n", log);
+      glDeleteShader(s);
+      return 0;
+   }
+   return s;
+}
+
+static void lrhw_context_reset(void)
+{
+   GLuint vs, fs;
+   GLint ok = 0;
+
+   hw.ready = 0;
+   hw.last.valid = 0;
+   rglgen_resolve_symbols(hw.cb.get_proc_address);
+
+   vs = lrhw_shader(GL_VERTEX_SHADER, lrhw_vsh);
+   fs = lrhw_shader(GL_FRAGMENT_SHADER, lrhw_fsh);
+   if (!vs || !fs)
+      return;
+   hw.prog = glCreateProgram();
+   glAttachShader(hw.prog, vs);
+   glAttachShader(hw.prog, fs);
+   glBindAttribLocation(hw.prog, 0, "a_pos");
+   glLinkProgram(hw.prog);
+   glDeleteShader(vs);
+   glDeleteShader(fs);
+   glGetProgramiv(hw.prog, GL_LINK_STATUS, &ok);
+   if (!ok) {
+      SysPrintf("lrhw: shader link failed\n");
+      glDeleteProgram(hw.prog);
+      hw.prog = 0;
+      return;
+   }
+   glUseProgram(hw.prog);
+   glUniform1i(glGetUniformLocation(hw.prog, "u_tex"), 0);
+   hw.u_rect = glGetUniformLocation(hw.prog, "u_rect");
+   hw.u_fb = glGetUniformLocation(hw.prog, "u_fb");
+   hw.u_src = glGetUniformLocation(hw.prog, "u_src");
+   hw.u_wrap = glGetUniformLocation(hw.prog, "u_wrap");
+
+   glGenTextures(1, &hw.tex);
+   glBindTexture(GL_TEXTURE_2D, hw.tex);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, LRHW_TEX_W, LRHW_TEX_H,
+         0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, NULL);
+
+   hw.ready = 1;
+   SysPrintf("lrhw: context ready\n");
+}
+
+static void lrhw_context_destroy(void)
+{
+   // the objects are gone with the context, forget them
+   hw.ready = 0;
+   hw.prog = hw.tex = 0;
+   hw.last.valid = 0;
+}
+
+int lrhw_init(retro_environment_t environ_cb)
+{
+   memset(&hw, 0, sizeof(hw));
+#ifdef HAVE_OPENGLES2
+   hw.cb.context_type = RETRO_HW_CONTEXT_OPENGLES2;
+#else
+   hw.cb.context_type = RETRO_HW_CONTEXT_OPENGL;
+#endif
+   hw.cb.context_reset = lrhw_context_reset;
+   hw.cb.context_destroy = lrhw_context_destroy;
+   hw.cb.depth = false;
+   hw.cb.stencil = false;
+   hw.cb.bottom_left_origin = false;
+   if (!environ_cb(RETRO_ENVIRONMENT_SET_HW_RENDER, &hw.cb)) {
+      SysPrintf("lrhw: SET_HW_RENDER failed, using the software output\n");
+      return -1;
+   }
+   return 0;
+}
+
+void lrhw_deinit(void)
+{
+   memset(&hw, 0, sizeof(hw));
+}
+
+int lrhw_enabled(void)
+{
+   return hw.ready;
+}
+
+static void lrhw_draw(int fb_w, int fb_h)
+{
+   static const GLfloat quad[] = { 0, 0,  1, 0,  0, 1,  1, 1 };
+
+   glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)hw.cb.get_current_framebuffer());
+   glViewport(0, 0, fb_w, fb_h);
+   glDisable(GL_BLEND);
+   glDisable(GL_DEPTH_TEST);
+   glDisable(GL_SCISSOR_TEST);
+   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+   if (hw.last.blank)
+      return;
+
+   glUseProgram(hw.prog);
+   glActiveTexture(GL_TEXTURE0);
+   glBindTexture(GL_TEXTURE_2D, hw.tex);
+   glUniform4fv(hw.u_rect, 1, hw.last.rect);
+   glUniform2f(hw.u_fb, (GLfloat)fb_w, (GLfloat)fb_h);
+   glUniform4fv(hw.u_src, 1, hw.last.src);
+   glUniform1f(hw.u_wrap, hw.last.wrap);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, quad);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glDisableVertexAttribArray(0);
+}
+
+// upload rows [row, row + count), vram rows wrap at 512 (1MB)
+static void lrhw_upload(const unsigned char *vram, int row, int count,
+      int enhres)
+{
+   int n, dst = 0;
+
+   glActiveTexture(GL_TEXTURE0);
+   glBindTexture(GL_TEXTURE_2D, hw.tex);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+   while (count > 0) {
+      n = count;
+      if (!enhres) {
+         row &= 511;
+         if (row + n > 512)
+            n = 512 - row;
+      }
+      if (dst + n > LRHW_TEX_H)
+         n = LRHW_TEX_H - dst;
+      if (n <= 0)
+         break;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dst, LRHW_TEX_W, n,
+            GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, vram + row * LRHW_ROW_BYTES);
+      dst += n;
+      row += n;
+      count -= n;
+   }
+}
+
+void lrhw_flip(const void *vram, int vram_ofs, int bgr24, int x, int y,
+      int src_w, int dst_w, int h, int enhres, int fb_w, int fb_h)
+{
+   int row_step = 1;
+
+   if (!hw.ready)
+      return;
+   hw.last.valid = 1;
+   hw.last.blank = vram == NULL;
+   if (vram != NULL) {
+      // same line doubling detection as the software vout_flip()
+      if (h >= fb_h * 3 / 2) {
+         row_step = 2;
+         h /= 2;
+      }
+      if (h > fb_h)
+         h = fb_h;
+      lrhw_upload(vram, vram_ofs / LRHW_ROW_BYTES, h * row_step, enhres);
+
+      hw.last.rect[0] = x;
+      hw.last.rect[1] = y;
+      hw.last.rect[2] = dst_w;
+      hw.last.rect[3] = h;
+      hw.last.src[0] = vram_ofs % LRHW_ROW_BYTES;
+      hw.last.src[1] = row_step;
+      hw.last.src[2] = (float)src_w / dst_w;
+      hw.last.src[3] = bgr24 ? 3 : 2;
+      // non-enhanced lines wrap around at the vram edge
+      hw.last.wrap = enhres ? 65536.0f : (float)LRHW_ROW_BYTES;
+   }
+   lrhw_draw(fb_w, fb_h);
+}
+
+void lrhw_present(retro_video_refresh_t video_cb, int dirty, int can_dupe,
+      int fb_w, int fb_h)
+{
+   if (!hw.ready || !hw.last.valid) {
+      video_cb(NULL, fb_w, fb_h, 0);
+      return;
+   }
+   if (!dirty) {
+      if (can_dupe) {
+         video_cb(NULL, fb_w, fb_h, 0);
+         return;
+      }
+      // the framebuffer contents are not preserved between frames
+      lrhw_draw(fb_w, fb_h);
+   }
+   video_cb(RETRO_HW_FRAME_BUFFER_VALID, fb_w, fb_h, 0);
+}
@@ -0,0 +1,41 @@
+#ifndef __LIBRETRO_HW_H__
+#define __LIBRETRO_HW_H__
+
+/*
+ * Optional RETRO_ENVIRONMENT_SET_HW_RENDER video output (HAVE_HW_RENDER).
+ * The displayed part of vram is uploaded as is and converted/cropped by a
+ * shader into the frontend's framebuffer, instead of the bgr_to_fb pass.
+ */
+
+#include <libretro.h>
+
+#ifdef HAVE_HW_RENDER
+
+// asks the frontend for a context, 0 on success
+int  lrhw_init(retro_environment_t environ_cb);
+void lrhw_deinit(void);
+// context requested and currently usable
+int  lrhw_enabled(void);
+
+// same arguments as vout_flip, plus how many source pixels (src_w) are
+// shown as how many output pixels (dst_w), fb_w x fb_h is the output size
+void lrhw_flip(const void *vram, int vram_ofs, int bgr24, int x, int y,
+      int src_w, int dst_w, int h, int enhres, int fb_w, int fb_h);
+// to be called from retro_run() instead of the software video_cb
+void lrhw_present(retro_video_refresh_t video_cb, int dirty, int can_dupe,
+      int fb_w, int fb_h);
+
+#else
+
+static inline int  lrhw_init(retro_environment_t environ_cb) { return -1; }
+static inline void lrhw_deinit(void) {}
+static inline int  lrhw_enabled(void) { return 0; }
+static inline void lrhw_flip(const void *vram, int vram_ofs, int bgr24,
+      int x, int y, int src_w, int dst_w, int h, int enhres,
+      int fb_w, int fb_h) {}
+static inline void lrhw_present(retro_video_refresh_t video_cb, int dirty,
+      int can_dupe, int fb_w, int fb_h) {}
+
+#endif
+
+#endif /* __LIBRETRO_HW_H__ */
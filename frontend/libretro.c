@@ -48,6 +48,10 @@
 
 #include <libretro.h>
 #include "libretro_core_options.h"
+#include "libretro-hw.h"
+#if defined(USE_ASYNC_GPU) || defined(USE_ASYNC_MDEC)
+#include "features/features_cpu.h"
+#endif
 
 #ifdef USE_LIBRETRO_VFS
 #include <streams/file_stream_transforms.h>
@@ -293,6 +297,30 @@ static void set_bgr_to_fb_func(int bgr24)
    }
 }
 
+// frontend framebuffers (and vout_buf) known to have black borders for the
+// current mode, so that switching between them doesn't need a memset
+static void *vout_fb_clean[4];
+
+static int vout_fb_is_clean(const void *buf)
+{
+   size_t i;
+   for (i = 0; i < ARRAY_SIZE(vout_fb_clean); i++)
+      if (vout_fb_clean[i] == buf)
+         return 1;
+   return 0;
+}
+
+static void vout_fb_set_clean(void *buf, int forget_others)
+{
+   if (forget_others)
+      memset(vout_fb_clean, 0, sizeof(vout_fb_clean));
+   if (vout_fb_is_clean(buf))
+      return;
+   memmove(vout_fb_clean + 1, vout_fb_clean,
+         sizeof(vout_fb_clean) - sizeof(vout_fb_clean[0]));
+   vout_fb_clean[0] = buf;
+}
+
 static void set_vout_fb(void)
 {
    struct retro_framebuffer fb = { 0 };
@@ -312,10 +340,10 @@ static void set_vout_fb(void)
          current_fmt = fb.format;
       }
       vout_buf_ptr = fb.data;
-      vout_pitch_b = fb.pitch;
-      if (fb.pitch != vout_width * bytes_pp)
+      if (fb.pitch != vout_pitch_b && fb.pitch != vout_width * bytes_pp)
          LogWarn("got unusual pitch %zd for fmt %d resolution %dx%d\n",
                fb.pitch, fb.format, vout_width, vout_height);
+      vout_pitch_b = fb.pitch;
    }
    else
    {
@@ -416,15 +444,32 @@ static void vout_flip(const void *vram_, int vram_ofs, int bgr24,
    int port = 0, hwrapped;
    int sstride = 2048;
 
-   if (vram == NULL || dims_changed || (in_enable_crosshair[0] + in_enable_crosshair[1]) > 0)
+   if (pl_rearmed_cbs.vout_skip)
+      return;
+
+   if (lrhw_enabled())
+   {
+      // converted by a shader, see libretro-hw.c
+      int src_w = w_blit;
+      if (vout_width == 320 && psx_w >= 512-4)
+         src_w = psx_w >= 640-4 ? 640 : 512;
+      lrhw_flip(vram, vram_ofs, bgr24, x, y, src_w, w_blit, h, enhres,
+            vout_width, vout_height);
+      goto out;
+   }
+
+   // the frontend may hand out a different buffer each frame
+   if (vram == NULL || dims_changed || !vout_fb_is_clean(dest)
+       || (in_enable_crosshair[0] + in_enable_crosshair[1]) > 0)
    {
       unsigned char *dest2 = dest;
-      int h2 = h, ll = vout_width * bytes_pp;
+      int h2 = vout_height, ll = vout_width * bytes_pp;
       if (dstride == ll)
          memset(dest2, 0, dstride * vout_height);
       else
          for (; h2-- > 0; dest2 += dstride)
             memset(dest2, 0, ll);
+      vout_fb_set_clean(dest, dims_changed);
       // blanking
       if (vram == NULL)
          goto out;
@@ -738,6 +783,8 @@ static void log_mem_usage(void)
    SysPrintf("mem: %d/%d heap: %d linear: %d/%d stack: %d exe: %d\n",
       (int)mem_used, app_memory, __heap_size, __linear_heap_size - linearSpaceFree(),
       __linear_heap_size, __stacksize__, (int)&__end__ - 0x100000);
+#else
+   psxMemReportUsage();
 #endif
 }
 
@@ -775,6 +822,20 @@ void pl_timing_prepare(int is_pal)
 {
 }
 
+static void update_input(void);
+static bool input_pending;
+
+/* called by the PAD plugin, the input is sampled on the first pad
+ * read of the frame instead of before running it */
+void pl_pad_poll(void)
+{
+   if (!input_pending)
+      return;
+   input_pending = false;
+   input_poll_cb();
+   update_input();
+}
+
 void plat_trigger_vibrate(int pad, int low, int high)
 {
    if (!rumble_cb)
@@ -825,10 +886,52 @@ void pl_gun_byte2(int port, unsigned char byte)
 }
 
 /* sound calls */
+static int snd_skip;
+
+/* collected over a retro_run() and handed to the frontend in one go,
+ * stereo frames, a frame's worth is normally well below the size */
+#define SND_BATCH_MAX 4096
+static int16_t snd_batch[SND_BATCH_MAX * 2 + 2];
+static int snd_batch_len;
+
+static void snd_flush(void)
+{
+   int n = snd_batch_len;
+
+   if (n == 0 || audio_batch_cb == NULL)
+      return;
+   /* nudge the rate by one frame per batch (~0.1%) to keep the
+    * frontend's buffer from slowly running dry or overflowing,
+    * that is well below what can be heard */
+   if (retro_audio_buff_active && n > 1) {
+      if (retro_audio_buff_occupancy < 25) {
+         snd_batch[n * 2]     = snd_batch[n * 2 - 2];
+         snd_batch[n * 2 + 1] = snd_batch[n * 2 - 1];
+         n++;
+      }
+      else if (retro_audio_buff_occupancy > 75)
+         n--;
+   }
+   audio_batch_cb(snd_batch, n);
+   snd_batch_len = 0;
+}
+
 static void snd_feed(void *buf, int bytes)
 {
-   if (audio_batch_cb != NULL)
-      audio_batch_cb(buf, bytes / 4);
+   const int16_t *src = buf;
+   int n = bytes / 4, chunk;
+
+   if (audio_batch_cb == NULL || snd_skip)
+      return;
+   while (n > 0) {
+      if (snd_batch_len == SND_BATCH_MAX)
+         snd_flush();
+      chunk = min(n, SND_BATCH_MAX - snd_batch_len);
+      memcpy(snd_batch + snd_batch_len * 2, src, chunk * 4);
+      snd_batch_len += chunk;
+      src += chunk * 2;
+      n -= chunk;
+   }
 }
 
 void out_register_libretro(struct out_driver *drv)
@@ -1007,6 +1110,9 @@ static bool update_option_visibility(void)
             "pcsx_rearmed_gpu_unai_skipline",
             "pcsx_rearmed_gpu_unai_lighting",
             "pcsx_rearmed_gpu_unai_fast_lighting",
+#ifdef USE_ASYNC_GPU
+            "pcsx_rearmed_gpu_unai_render_threads",
+#endif
          };
 
          option_display.visible = show_advanced_gpu_unai_settings;
@@ -1198,10 +1304,60 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 }
 
 /* savestates */
+// measured once a game is loaded, the layout is fixed from then on
+static size_t serialize_size;
+
+static void *count_open(const char *name, const char *mode)
+{
+   return (void *)name;
+}
+
+static int count_write(void *file, const void *buf, u32 len)
+{
+   *(size_t *)file += len;
+   return len;
+}
+
+static long count_seek(void *file, long offs, int whence)
+{
+   if (whence != SEEK_CUR)
+      return -1;
+   *(size_t *)file += offs;
+   return *(size_t *)file;
+}
+
+static void count_close(void *file)
+{
+}
+
+static void calc_serialize_size(void)
+{
+   static const struct PcsxSaveFuncs count_funcs = {
+      count_open, NULL, count_write, count_seek, count_close
+   };
+   struct PcsxSaveFuncs saved = SaveFuncs;
+   size_t size = 0;
+   int ret;
+
+   serialize_size = 0;
+   SaveFuncs = count_funcs;
+   ret = SaveState((const char *)&size);
+   SaveFuncs = saved;
+   if (ret != 0)
+      return;
+
+   // the only variable part is the dynarec block list (ndrc_freeze()),
+   // have room for the largest one; round up to keep things aligned
+   size += 8 + 4 + 1024 * 4 * 4;
+   serialize_size = (size + 0xfff) & ~0xfff;
+   SysPrintf("savestate size: %u\n", (unsigned int)serialize_size);
+}
+
 size_t retro_serialize_size(void)
 {
-   // it's currently 4380651-4397047 bytes,
-   // but have some reserved for future
+   if (serialize_size)
+      return serialize_size;
+   // no game yet, this used to be the size before it was measured
    return 0x440000;
 }
 
@@ -1210,8 +1366,29 @@ struct save_fp
    char *buf;
    size_t pos;
    int is_write;
+   int is_fast;
 };
 
+// run-ahead states never leave this instance, so they can skip parts
+// that a frame or two of emulation can't change
+static int save_fast;
+
+static int save_is_fast(void)
+{
+#ifdef RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT
+   int ctx = 0;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &ctx))
+      return ctx == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE;
+#endif
+   return 0;
+}
+
+static int save_skip(const struct save_fp *fp, const void *buf, u32 len)
+{
+   // the BIOS image, when it's not HLE
+   return fp->is_fast && !Config.HLE && buf == psxR && len == 0x80000;
+}
+
 static void *save_open(const char *name, const char *mode)
 {
    struct save_fp *fp;
@@ -1226,6 +1403,7 @@ static void *save_open(const char *name, const char *mode)
    fp->buf = (char *)name;
    fp->pos = 0;
    fp->is_write = (mode[0] == 'w' || mode[1] == 'w');
+   fp->is_fast = save_fast;
 
    return fp;
 }
@@ -1235,6 +1413,8 @@ static int save_read(void *file, void *buf, u32 len)
    struct save_fp *fp = file;
    if (fp == NULL || buf == NULL)
       return -1;
+   if (save_skip(fp, buf, len))
+      return len;
 
    memcpy(buf, fp->buf + fp->pos, len);
    fp->pos += len;
@@ -1246,6 +1426,14 @@ static int save_write(void *file, const void *buf, u32 len)
    struct save_fp *fp = file;
    if (fp == NULL || buf == NULL)
       return -1;
+   if (save_skip(fp, buf, len))
+      return len;
+
+   if (fp->pos + len > retro_serialize_size())
+   {
+      fp->pos += len; // reported by save_close()
+      return -1;
+   }
 
    memcpy(fp->buf + fp->pos, buf, len);
    fp->pos += len;
@@ -1280,7 +1468,7 @@ static void save_close(void *file)
 
    if (fp->pos > r_size)
       LogErr("ERROR: save buffer overflow detected\n");
-   else if (fp->is_write && fp->pos < r_size)
+   else if (fp->is_write && !fp->is_fast && fp->pos < r_size)
       // make sure we don't save trash in leftover space
       memset(fp->buf + fp->pos, 0, r_size - fp->pos);
    free(fp);
@@ -1290,6 +1478,7 @@ bool retro_serialize(void *data, size_t size)
 {
    int ret;
    CdromFrontendId = disk_current_index;
+   save_fast = save_is_fast();
    ret = SaveState(data);
    return ret == 0 ? true : false;
 }
@@ -1300,6 +1489,7 @@ bool retro_unserialize(const void *data, size_t size)
 {
    int ret;
    CdromFrontendId = -1;
+   save_fast = save_is_fast();
    ret = LoadState(data);
    if (ret)
       return false;
@@ -1731,11 +1921,19 @@ static void set_retro_memmap(void)
 {
    uint64_t flags_ram = RETRO_MEMDESC_SYSTEM_RAM;
    struct retro_memory_map retromap = { 0 };
+   // all pointing straight at the emulated memory, so the frontend
+   // (achievements, cheats) can read it in place; the selects also take
+   // in the KSEG0/KSEG1 views (0x80000000, 0xa0000000)
    struct retro_memory_descriptor descs[] = {
       { flags_ram, psxM, 0, 0x00000000, 0x5fe00000, 0, 0x200000 },
+      // scratchpad, only reachable through KUSEG/KSEG0
       { flags_ram, psxH, 0, 0x1f800000, 0x7ffffc00, 0, 0x000400 },
-      // not ram but let the frontend patch it if it wants; should be last
-      { flags_ram, psxR, 0, 0x1fc00000, 0x5ff80000, 0, 0x080000 },
+      // the 2MB are mirrored over the first 8MB
+      { flags_ram, psxM, 0, 0x00200000, 0x5fe00000, 0, 0x200000 },
+      { flags_ram, psxM, 0, 0x00400000, 0x5fe00000, 0, 0x200000 },
+      { flags_ram, psxM, 0, 0x00600000, 0x5fe00000, 0, 0x200000 },
+      // should be last
+      { RETRO_MEMDESC_CONST, psxR, 0, 0x1fc00000, 0x5ff80000, 0, 0x080000 },
    };
 
    retromap.descriptors = descs;
@@ -1782,30 +1980,30 @@ static void retro_audio_buff_status_cb(
 
 static void retro_set_audio_buff_status_cb(void)
 {
-   if (frameskip_type == FRAMESKIP_NONE)
+   struct retro_audio_buffer_status_callback buf_status_cb;
+   bool have_status;
+
+   /* also drives the rate correction in snd_flush(), so always wanted */
+   buf_status_cb.callback = retro_audio_buff_status_cb;
+   have_status = environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK,
+                            &buf_status_cb);
+   if (!have_status)
    {
-      environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, NULL);
-      retro_audio_latency = 0;
+      retro_audio_buff_active    = false;
+      retro_audio_buff_occupancy = 0;
+      retro_audio_buff_underrun  = false;
    }
+
+   if (frameskip_type == FRAMESKIP_NONE)
+      retro_audio_latency = 0;
    else
    {
       bool calculate_audio_latency = true;
 
-      if (frameskip_type == FRAMESKIP_FIXED_INTERVAL)
-         environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, NULL);
-      else
+      if (frameskip_type != FRAMESKIP_FIXED_INTERVAL && !have_status)
       {
-         struct retro_audio_buffer_status_callback buf_status_cb;
-         buf_status_cb.callback = retro_audio_buff_status_cb;
-         if (!environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK,
-                         &buf_status_cb))
-         {
-            retro_audio_buff_active    = false;
-            retro_audio_buff_occupancy = 0;
-            retro_audio_buff_underrun  = false;
-            retro_audio_latency        = 0;
-            calculate_audio_latency    = false;
-         }
+         retro_audio_latency     = 0;
+         calculate_audio_latency = false;
       }
 
       if (calculate_audio_latency)
@@ -1829,6 +2027,20 @@ static void retro_set_audio_buff_status_cb(void)
 
 static void update_variables(bool in_flight);
 
+#if defined(USE_ASYNC_GPU) || defined(USE_ASYNC_MDEC)
+// thread count options, "auto" leaves a core for the emu thread
+// and one for the other busy thread (gpu or spu), 1 to 4
+static int get_thread_count(const char *value)
+{
+   int n;
+
+   if (strcmp(value, "auto") != 0)
+      return atoi(value);
+   n = cpu_features_get_core_amount() - 2;
+   return n < 1 ? 1 : n > 4 ? 4 : n;
+}
+#endif
+
 static int get_bool_variable(const char *key)
 {
    struct retro_variable var = { NULL, };
@@ -1899,6 +2111,10 @@ bool retro_load_game(const struct retro_game_info *info)
       LogErr("SET_PIXEL_FORMAT failed\n");
    SysPrintf("Using PIXEL_FORMAT %d\n", current_fmt);
    set_bgr_to_fb_func(0);
+#ifdef HAVE_HW_RENDER
+   if (get_bool_variable("pcsx_rearmed_hw_render") && lrhw_init(environ_cb) == 0)
+      SysPrintf("Requested a hardware rendering context\n");
+#endif
 
    if (info == NULL || info->path == NULL)
    {
@@ -2044,6 +2260,10 @@ bool retro_load_game(const struct retro_game_info *info)
       }
    }
 
+   /* keep the discs of multi-disc sets open once used,
+    * makes swapping back and forth fast */
+   cdrIsoSetPoolSize(disk_count > 1 ? disk_count : 0);
+
    /* set ports to use "standard controller" initially */
    for (i = 0; i < 8; ++i)
       in_type[i] = PSE_PAD_TYPE_STANDARD;
@@ -2070,6 +2290,7 @@ bool retro_load_game(const struct retro_game_info *info)
 
    set_retro_memmap();
    retro_set_audio_buff_status_cb();
+   calc_serialize_size();
    log_mem_usage();
 
    if (check_unsatisfied_libcrypt())
@@ -2306,6 +2527,8 @@ static void update_variables(bool in_flight)
          pl_rearmed_cbs.gpu_neon.allow_interlace = 0;
       else if (strcmp(var.value, "enabled") == 0)
          pl_rearmed_cbs.gpu_neon.allow_interlace = 1;
+      else if (strcmp(var.value, "fields") == 0)
+         pl_rearmed_cbs.gpu_neon.allow_interlace = 3;
       else // auto
          pl_rearmed_cbs.gpu_neon.allow_interlace = 2;
    }
@@ -2342,6 +2565,14 @@ static void update_variables(bool in_flight)
       else
          pl_rearmed_cbs.gpu_neon.enhancement_tex_adj = 0;
    }
+
+#ifdef USE_ASYNC_GPU
+   var.value = NULL;
+   var.key = "pcsx_rearmed_neon_render_threads";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      pl_rearmed_cbs.gpu_neon.render_bands = get_thread_count(var.value);
+#endif
 #endif
 
    var.value = NULL;
@@ -2367,6 +2598,18 @@ static void update_variables(bool in_flight)
          Config.TurboCD = false;
    }
 
+   var.value = NULL;
+   var.key = "pcsx_rearmed_mem_budget";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int budget = strcmp(var.value, "disabled") ? atoi(var.value) : 0;
+      if (budget != Config.MemBudgetMB)
+      {
+         Config.MemBudgetMB = budget;
+         cdra_apply_mem_budget();
+      }
+   }
+
 #if defined(HAVE_CDROM) || defined(USE_ASYNC_CDROM)
    var.value = NULL;
    var.key = "pcsx_rearmed_cd_readahead";
@@ -2374,6 +2617,11 @@ static void update_variables(bool in_flight)
    {
       cdra_set_buf_count(strtol(var.value, NULL, 10));
    }
+
+   var.value = NULL;
+   var.key = "pcsx_rearmed_cd_preload";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      cdra_set_preload(strcmp(var.value, "enabled") == 0);
 #endif
 
    //
@@ -2435,6 +2683,13 @@ static void update_variables(bool in_flight)
    }
 #endif
 
+#ifdef USE_ASYNC_MDEC
+   var.value = NULL;
+   var.key = "pcsx_rearmed_mdec_threads";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      Config.MdecThreads = get_thread_count(var.value);
+#endif
+
    var.value = NULL;
    var.key = "pcsx_rearmed_nosmccheck";
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -2506,6 +2761,16 @@ static void update_variables(bool in_flight)
          Config.PreciseExceptions = 0;
    }
 
+   var.value = NULL;
+   var.key = "pcsx_rearmed_interpreter_predecode";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         Config.PredecodeInt = 1;
+      else
+         Config.PredecodeInt = 0;
+   }
+
    psxCpu->ApplyConfig();
 
    // end of CPU emu config
@@ -2547,6 +2812,12 @@ static void update_variables(bool in_flight)
       else
          spu_config.iUseThread = 0;
    }
+
+   var.value = NULL;
+   var.key = "pcsx_rearmed_spu_thread_workers";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      // 0 is auto, the spu picks a count itself
+      spu_config.iThreadWorkers = atoi(var.value);
 #endif
 
    var.value = NULL;
@@ -2662,6 +2933,17 @@ static void update_variables(bool in_flight)
       else
          pl_rearmed_cbs.thread_rendering = 0;
    }
+
+   var.key = "pcsx_rearmed_gpu_thread_frames";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         pl_rearmed_cbs.thread_frames = 1;
+      else
+         pl_rearmed_cbs.thread_frames = 0;
+   }
 #endif
 
 #ifdef GPU_PEOPS
@@ -2802,6 +3084,14 @@ static void update_variables(bool in_flight)
       else if (strcmp(var.value, "enabled") == 0)
          pl_rearmed_cbs.gpu_unai.blending = 1;
    }
+
+#ifdef USE_ASYNC_GPU
+   var.value = NULL;
+   var.key = "pcsx_rearmed_gpu_unai_render_threads";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      pl_rearmed_cbs.gpu_unai.render_bands = get_thread_count(var.value);
+#endif
 #endif // GPU_UNAI
 
    var.value = NULL;
@@ -3270,6 +3560,31 @@ static void update_input(void)
    }
 }
 
+#if !defined(DRC_DISABLE) && !defined(LIGHTREC)
+// what changed since the last call, to the log only, too long for the osd
+static void log_drc_stats(void)
+{
+   static struct ndrc_stats prev;
+   struct ndrc_stats s;
+
+   if (!log_cb)
+      return;
+   new_dynarec_get_stats(&s);
+   log_cb(RETRO_LOG_INFO, "drc: %u blocks %u bytes, inv smc %u dma %u "
+         "reload %u prot %u, restored %u, lookups %u (ht miss %u, evict %u, "
+         "size %u), thread waits %u, tc %u/%u wraps %u\n",
+         s.compiles - prev.compiles, s.compiled_bytes - prev.compiled_bytes,
+         s.inv_smc - prev.inv_smc, s.inv_dma - prev.inv_dma,
+         s.inv_reload - prev.inv_reload, s.inv_prot - prev.inv_prot,
+         s.restores - prev.restores,
+         s.lookups - prev.lookups, s.ht_misses - prev.ht_misses,
+         s.ht_evictions - prev.ht_evictions, s.ht_size,
+         s.thread_waits - prev.thread_waits, s.tc_used, s.tc_size,
+         s.tc_wraps - prev.tc_wraps);
+   prev = s;
+}
+#endif
+
 static void print_internal_fps(void)
 {
    if (display_internal_fps)
@@ -3301,6 +3616,7 @@ static void print_internal_fps(void)
                pos = snprintf(str, sizeof(str), "DRC: %d ", ndrc_g.did_compile);
                ndrc_g.did_compile = 0;
             }
+            log_drc_stats();
 #endif
             cd_count = cdra_get_buf_count();
             if (cd_count) {
@@ -3393,9 +3709,22 @@ void retro_run(void)
       update_audio_latency = false;
    }
 
-   input_poll_cb();
+   /* Replayed run-ahead/rollback frames are never shown or heard,
+    * the emulation still runs in full so the result is the same */
+   pl_rearmed_cbs.vout_skip = 0;
+   snd_skip = 0;
+#ifdef RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE
+   {
+      int av_enable = 3;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable))
+      {
+         pl_rearmed_cbs.vout_skip = !(av_enable & 1);
+         snd_skip = !(av_enable & 2);
+      }
+   }
+#endif
 
-   update_input();
+   input_pending = true;
 
    bool updated = false;
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
@@ -3404,6 +3733,9 @@ void retro_run(void)
    psxRegs.stop = 0;
    psxCpu->Execute(&psxRegs);
 
+   /* the game didn't read the pad, but the frontend expects a poll */
+   pl_pad_poll();
+
    if (pl_rearmed_cbs.fskip_dirty == 1) {
       if (frameskip_counter < frameskip_interval)
          frameskip_counter++;
@@ -3411,9 +3743,14 @@ void retro_run(void)
          frameskip_counter = 0;
    }
 
-   video_cb((vout_fb_dirty || !vout_can_dupe) ? vout_buf_ptr : NULL,
-       vout_width, vout_height, vout_pitch_b);
+   if (lrhw_enabled())
+      lrhw_present(video_cb, vout_fb_dirty, vout_can_dupe,
+            vout_width, vout_height);
+   else
+      video_cb((vout_fb_dirty || !vout_can_dupe) ? vout_buf_ptr : NULL,
+          vout_width, vout_height, vout_pitch_b);
    vout_fb_dirty = 0;
+   snd_flush();
 
 #ifdef HAVE_CDROM
    int inserted;
@@ -3746,7 +4083,9 @@ void retro_deinit(void)
       ClosePlugins();
       plugins_opened = 0;
    }
+   cdrIsoSetPoolSize(0);
    SysClose();
+   lrhw_deinit();
 #ifdef _3DS
    linearFree(vram_mem);
    vram_mem = NULL;
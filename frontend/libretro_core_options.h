@@ -164,6 +164,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      "pcsx_rearmed_mem_budget",
+      "Low memory mode",
+      NULL,
+      "Caps the dynarec code cache (a quarter of the budget, 4MB minimum) and the CD read-ahead (an eighth), and disables the CD preload unless the disc fits in half of it. For devices with 256MB of RAM or less. The code cache size changes after a core restart.",
+      NULL,
+      "system",
+      {
+         { "disabled", NULL },
+         { "32",  "32MB" },
+         { "64",  "64MB" },
+         { "96",  "96MB" },
+         { "128", "128MB" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
 #if defined(HAVE_CDROM) || defined(USE_ASYNC_CDROM)
 #define V(x) { #x, NULL }
    {
@@ -192,6 +209,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       "12",
    },
 #undef V
+#if !defined(_3DS) && !defined(VITA)
+   {
+      "pcsx_rearmed_cd_preload",
+      "CD preload to RAM",
+      NULL,
+      "Reads the whole disc into RAM in the background while the game runs, requested sectors are read first. "
+      "Needs as much free RAM as the image size (up to ~750MB).",
+      NULL,
+      "system",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+#endif
 #endif
 #ifndef DRC_DISABLE
    {
@@ -220,12 +254,32 @@ struct retro_core_option_v2_definition option_defs_us[] = {
          { "auto", "Auto" },
          { "disabled", NULL },
          { "enabled",  NULL },
+         { "fields",   "Fields (fast)" },
          { NULL, NULL },
       },
       "auto",
    },
 #endif
 #endif // DRC_DISABLE
+#ifdef USE_ASYNC_MDEC
+   {
+      "pcsx_rearmed_mdec_threads",
+      "MDEC Decode Threads",
+      NULL,
+      "Splits the decoding of full motion video between this many threads. Needs a multi-core CPU to be of use.",
+      NULL,
+      "system",
+      {
+         { "auto", "Auto" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { NULL, NULL },
+      },
+      "1",
+   },
+#endif
    {
       "pcsx_rearmed_psxclock",
       "PSX CPU Clock Speed (%)",
@@ -344,6 +398,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      "pcsx_rearmed_gpu_thread_frames",
+      "Threaded Rendering Frame Queue",
+      NULL,
+      "With Threaded Rendering, shows each frame one frame later so that the GPU thread can draw the next one meanwhile. Adds a frame of input lag.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL},
+      },
+      "disabled",
+   },
 #endif
    {
       "pcsx_rearmed_frameskip_type",
@@ -455,6 +523,22 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+#ifdef HAVE_HW_RENDER
+   {
+      "pcsx_rearmed_hw_render",
+      "Hardware Rendered Output",
+      NULL,
+      "Uploads the displayed VRAM area as a texture and converts it on the GPU through an OpenGL context, instead of converting every frame on the CPU. Takes effect on game reload only (libretro limitation).",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+#endif
    {
       "pcsx_rearmed_scale_hires",
       "Hi-Res Downscaling",
@@ -619,6 +703,25 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "enabled",
    },
+#ifdef USE_ASYNC_GPU
+   {
+      "pcsx_rearmed_neon_render_threads",
+      "(GPU) Rendering Threads",
+      "Rendering Threads",
+      "Splits the drawing area into horizontal bands that are rendered in parallel by this many threads. Needs a multi-core CPU to be of use.",
+      NULL,
+      "gpu_neon",
+      {
+         { "auto", "Auto" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { NULL, NULL },
+      },
+      "1",
+   },
+#endif
 #endif /* GPU_NEON */
 #ifdef GPU_PEOPS
    {
@@ -835,6 +938,25 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+#ifdef USE_ASYNC_GPU
+   {
+      "pcsx_rearmed_gpu_unai_render_threads",
+      "(GPU) Rendering Threads",
+      "Rendering Threads",
+      "Splits the drawing area into horizontal bands that are rendered in parallel by this many threads. Needs a multi-core CPU to be of use.",
+      NULL,
+      "gpu_unai",
+      {
+         { "auto", "Auto" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { NULL, NULL },
+      },
+      "1",
+   },
+#endif
 #endif /* GPU_UNAI */
    {
       "pcsx_rearmed_spu_reverb",
@@ -917,6 +1039,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      "pcsx_rearmed_spu_thread_workers",
+      "Threaded SPU Workers",
+      NULL,
+      "With Threaded SPU, splits the voices between this many threads. 'Auto' picks a count from the number of CPU cores.",
+      NULL,
+      "audio",
+      {
+         { "auto", "Auto" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { NULL, NULL },
+      },
+      "auto",
+   },
 #endif // P_HAVE_PTHREAD
    {
       "pcsx_rearmed_show_input_settings",
@@ -1645,6 +1784,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      "pcsx_rearmed_interpreter_predecode",
+      "Predecoded Interpreter",
+      NULL,
+      "Keep decoded instructions of executed code around instead of decoding them on every execution. Speeds up the interpreter on systems where the dynarec can't be used. Has no effect when Exception and Breakpoint Emulation is enabled. [Interpreter only]",
+      NULL,
+      "compat_hack",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
 #ifdef _3DS
 #define V(x) { #x, NULL }
    {
@@ -14,8 +14,9 @@
 #if !defined(_WIN32) && !defined(NO_DYLIB)
 #include <dlfcn.h>
 #endif
-#ifdef HAVE_RTHREADS
+#if defined(HAVE_RTHREADS) || defined(USE_ASYNC_SAVESTATE)
 #include "../frontend/pcsxr-threads.h"
+#include "../include/thread_wakeups.h"
 #endif
 
 #include "main.h"
@@ -30,6 +31,12 @@
 #include "../libpcsxcore/sio.h"
 #include "../libpcsxcore/database.h"
 #include "../libpcsxcore/cdrom-async.h"
+#include "../libpcsxcore/rewind.h"
+#include "../libpcsxcore/psxprof.h"
+#include "../libpcsxcore/psxmem_map.h"
+#include "evtrace.h"
+#include "shm_export.h"
+#include "metrics.h"
 #include "../libpcsxcore/new_dynarec/new_dynarec.h"
 #include "../plugins/cdrcimg/cdrcimg.h"
 #include "../plugins/dfsound/spu_config.h"
@@ -55,8 +62,11 @@
 static void toggle_fast_forward(int force_off);
 static void check_profile(void);
 static void check_memcards(void);
+static void load_drc_cache(void);
+static void emu_suspend(void);
 static int get_gameid_filename(char *buf, int size, const char *fmt, int i);
 static const char *get_home_dir(void);
+static void state_async_finish(void);
 #define MAKE_PATH(buf, dir, fname) \
 	emu_make_path(buf, sizeof(buf), dir, fname)
 
@@ -88,6 +98,7 @@ static void set_default_paths(void)
 	const char *home = get_home_dir();
 	struct stat st;
 	MAKE_PATH(Config.PatchesDir, PATCHES_DIR, NULL);
+	MAKE_PATH(Config.CacheDir, CACHE_DIR, NULL);
 	MAKE_PATH(Config.Mcd1, MEMCARD_DIR, "card1.mcd");
 	MAKE_PATH(Config.Mcd2, MEMCARD_DIR, "card2.mcd");
 	MAKE_PATH(Config.BiosDir, BIOS_DIR, NULL);
@@ -115,21 +126,27 @@ void emu_set_default_config(void)
 	Config.cycle_multiplier = CYCLE_MULT_DEFAULT;
 	Config.GpuListWalking = -1;
 	Config.FractionalFramerate = -1;
+	Config.StateCompression = STATE_COMP_FAST;
+	Config.MdecThreads = 1;
+	Config.MemBudgetMB = 0;
 
 	pl_rearmed_cbs.dithering = 1;
 	pl_rearmed_cbs.gpu_neon.allow_interlace = 2; // auto
 	pl_rearmed_cbs.gpu_neon.enhancement_enable =
 	pl_rearmed_cbs.gpu_neon.enhancement_no_main = 0;
 	pl_rearmed_cbs.gpu_neon.enhancement_tex_adj = 1;
+	pl_rearmed_cbs.gpu_neon.render_bands = 1;
 	pl_rearmed_cbs.gpu_peops.dwActFixes = 1<<7;
 	pl_rearmed_cbs.gpu_unai.old_renderer = 0;
 	pl_rearmed_cbs.gpu_unai.ilace_force = 0;
 	pl_rearmed_cbs.gpu_unai.lighting = 1;
 	pl_rearmed_cbs.gpu_unai.fast_lighting = 0;
 	pl_rearmed_cbs.gpu_unai.blending = 1;
+	pl_rearmed_cbs.gpu_unai.render_bands = 1;
 	memset(&pl_rearmed_cbs.gpu_peopsgl, 0, sizeof(pl_rearmed_cbs.gpu_peopsgl));
 	pl_rearmed_cbs.gpu_peopsgl.iVRamSize = 64;
 	pl_rearmed_cbs.gpu_peopsgl.iTexGarbageCollection = 1;
+	pl_rearmed_cbs.gpu_peopsgl.iTexContentHash = 1;
 
 	spu_config.iUseReverb = 1;
 	spu_config.iUseInterpolation = 1;
@@ -162,6 +179,8 @@ void do_emu_action(void)
 {
 	int ret;
 
+	// the menu and savestates use the display/layer buffer
+	pl_present_sync();
 	emu_action_old = emu_action;
 
 	switch (emu_action) {
@@ -252,6 +271,30 @@ do_state_slot:
 				SysPrintf("writepng %s: %d\n", buf, ret);
 			break;
 		}
+	case SACTION_GPU_RECORD:
+		{
+			static char path[MAXPATHLEN];
+			time_t t = time(NULL);
+			struct tm *tb = localtime(&t);
+			int ti = tb->tm_yday * 1000000 + tb->tm_hour * 10000 +
+				tb->tm_min * 100 + tb->tm_sec;
+
+			if (pl_rearmed_cbs.gpu_record_frames) {
+				// gpulib closes the files on the next vsync
+				pl_rearmed_cbs.gpu_record_frames = 0;
+				snprintf(hud_msg, sizeof(hud_msg), "GPU RECORD STOPPED");
+				break;
+			}
+			get_gameid_filename(path, sizeof(path) - 1,
+				"%s" SCREENSHOTS_DIR "%.32s-%.9s.%d.gpurec", ti);
+			mkdir(path, S_IRWXU | S_IRWXG);
+			strcat(path, "/");
+			pl_rearmed_cbs.gpu_record_path = path;
+			pl_rearmed_cbs.gpu_record_frames = gpu_rec_frames;
+			snprintf(hud_msg, sizeof(hud_msg), "GPU RECORD %d FRAMES",
+				gpu_rec_frames);
+			break;
+		}
 	case SACTION_VOLUME_UP:
 	case SACTION_VOLUME_DOWN:
 		{
@@ -276,6 +319,46 @@ do_state_slot:
 		ret = padToggleAnalog(0);
 		snprintf(hud_msg, sizeof(hud_msg), "ANALOG %s", ret ? "ON" : "OFF");
 		break;
+	case SACTION_REWIND:
+		ret = rewind_step();
+		if (ret == 0)
+			snprintf(hud_msg, sizeof(hud_msg), "REWIND %d", rewind_count());
+		else
+			snprintf(hud_msg, sizeof(hud_msg), "REWIND: NO MORE");
+		break;
+	case SACTION_EVENT_TRACE:
+		{
+			static int tracing;
+			char buf[MAXPATHLEN];
+			time_t t = time(NULL);
+			struct tm *tb = localtime(&t);
+			int ti = tb->tm_yday * 1000000 + tb->tm_hour * 10000 +
+				tb->tm_min * 100 + tb->tm_sec;
+
+			if (!tracing) {
+				tracing = evtrace_start() == 0;
+				snprintf(hud_msg, sizeof(hud_msg), "EVENT TRACE %s",
+					tracing ? "STARTED" : "FAILED");
+				break;
+			}
+			// the ring keeps the last few seconds before the press
+			get_gameid_filename(buf, sizeof(buf),
+				"%s" SCREENSHOTS_DIR "%.32s-%.9s.%d.trace.json", ti);
+			ret = evtrace_dump(buf);
+			tracing = 0;
+			snprintf(hud_msg, sizeof(hud_msg), "EVENT TRACE %s",
+				ret == 0 ? "SAVED" : "FAILED");
+			break;
+		}
+	case SACTION_REWIND_CAPTURE:
+		rewind_capture();
+		return;
+	case SACTION_CPU_BOOST:
+		pl_cpu_boost_apply();
+		return;
+	case SACTION_SUSPEND:
+		emu_suspend();
+		return;
 	default:
 		return;
 	}
@@ -392,10 +475,31 @@ out:
 	fclose(f);
 }
 
+#ifndef NO_FRONTEND
+static int cwcheat_pending;
+
+// cheatpops.db is a big flat file, only scan it when the menu needs it
+void emu_load_cwcheats(void)
+{
+	if (!cwcheat_pending)
+		return;
+	cwcheat_pending = 0;
+	parse_cwcheat();
+}
+#endif
+
 void emu_on_new_cd(int show_hud_msg)
 {
 	ClearAllCheats();
+#ifndef NO_FRONTEND
+	cwcheat_pending = 1;
+#else
 	parse_cwcheat();
+#endif
+#ifndef NO_FRONTEND
+	load_drc_cache();
+	psxMemReportUsage();
+#endif
 
 	if (Config.HLE) {
 		SysPrintf("note: running with HLE BIOS, expect compatibility problems\n");
@@ -451,6 +555,55 @@ int emu_core_preinit(void)
 	return 0;
 }
 
+#ifdef HAVE_RTHREADS
+static void spu_thread_start(int helper)
+{
+	enum pcsxr_thread_type type = helper ? PCSXRT_SPU_HELPER : PCSXRT_SPU;
+	pcsxr_sthread_name_self(type);
+	pcsxr_sthread_apply_self(type);
+}
+#endif
+
+// startup timeline, each phase is logged with its duration until the
+// first frame is out. Nothing is printed unless main() started the clock.
+static struct {
+	unsigned int last, t0;
+	int done;
+} startup;
+
+static unsigned int startup_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+// phase == NULL starts the clock
+void emu_startup_mark(const char *phase)
+{
+	unsigned int now;
+
+	if (startup.done || (startup.last == 0 && phase != NULL))
+		return;
+	now = startup_us() | 1;
+	if (phase == NULL) {
+		startup.t0 = startup.last = now;
+		return;
+	}
+	SysPrintf("startup: %-20s %4u.%u ms, %u ms total\n", phase,
+		(now - startup.last) / 1000, (now - startup.last) / 100 % 10,
+		(now - startup.t0) / 1000);
+	startup.last = now;
+}
+
+void emu_startup_done(void)
+{
+	if (startup.done || startup.last == 0)
+		return;
+	emu_startup_mark("first frame");
+	startup.done = 1;
+}
+
 int emu_core_init(void)
 {
 	SysPrintf("Starting PCSX-ReARMed " REV " (%s)\n", get_build_info());
@@ -468,6 +621,8 @@ int emu_core_init(void)
 
 #ifdef HAVE_RTHREADS
 	pcsxr_sthread_init();
+	pcsxr_sthread_apply_self(PCSXRT_EMU);
+	spu_config.pThreadStart = spu_thread_start;
 #endif
 #ifndef NO_FRONTEND
 	check_profile();
@@ -478,8 +633,10 @@ int emu_core_init(void)
 		SysPrintf("PSX emulator couldn't be initialized.\n");
 		return -1;
 	}
+	emu_startup_mark("core (mem, dynarec)");
 
 	LoadMcds(Config.Mcd1, Config.Mcd2);
+	emu_startup_mark("memcards");
 
 	if (Config.Debug) {
 		StartDebugger();
@@ -558,6 +715,7 @@ static void check_profile(void) {
 	create_profile_dir(CHEATS_DIR);
 	create_profile_dir(PATCHES_DIR);
 	create_profile_dir(CFG_DIR);
+	create_profile_dir(CACHE_DIR);
 	create_profile_dir(SCREENSHOTS_DIR);
 }
 
@@ -581,6 +739,135 @@ static void check_memcards(void)
 	}
 }
 
+// headless runs skip the blit and present, so want some headroom
+#define AUTOTUNE_SPEED 1.1
+
+// -autotune: replays the same frames with each menu_autotune_step() and
+// saves the first one that runs at full speed (or the fastest one) as the
+// game's config, so it's only done on a game's first run
+static int run_autotune(void)
+{
+	char tmp[MAXPATHLEN];
+	double speed, best_speed = 0.0;
+	int step, best = 0, pick = -1;
+
+	if (CdromId[0] == '\0') {
+		SysMessage("-autotune needs a CD image");
+		return -1;
+	}
+	if (menu_have_game_config()) {
+		SysPrintf("autotune: %s already has a game config\n", CdromId);
+		return 0;
+	}
+	MAKE_PATH(tmp, PCSX_DOT_DIR, "autotune.tmp");
+	if (SaveState(tmp) != 0) {
+		SysPrintf("autotune: can't save %s\n", tmp);
+		return -1;
+	}
+
+	for (step = 0; menu_autotune_step(step) == 0; step++) {
+		if (step > 0 && LoadState(tmp) != 0)
+			break;
+		pl_bench_restart();
+		g_emu_want_quit = 0;
+		while (!g_emu_want_quit) {
+			psxRegs.stop = 0;
+			emu_action = SACTION_NONE;
+			psxCpu->Execute(&psxRegs);
+			if (emu_action != SACTION_NONE)
+				do_emu_action();
+		}
+		speed = pl_bench_speed();
+		SysPrintf("autotune step %d: speed %.3f\n", step, speed);
+		if (speed > best_speed) {
+			best_speed = speed;
+			best = step;
+		}
+		if (speed >= AUTOTUNE_SPEED) {
+			pick = step;
+			break;
+		}
+	}
+	remove(tmp);
+
+	if (pick < 0) {
+		SysPrintf("autotune: full speed not reached, using the fastest step\n");
+		pick = best;
+	}
+	SysPrintf("autotune: saving step %d for %s\n", pick, CdromId);
+	return menu_autotune_save(pick);
+}
+
+#ifndef _WIN32
+#include <sys/wait.h>
+
+#define FARM_MAX 64
+
+static pid_t farm_pids[FARM_MAX];
+static int farm_count;
+
+/*
+ * -farm: forks the -bench run into n instances once the plugins and bios
+ * are loaded, so those pages stay shared copy-on-write instead of being
+ * read in by every process. Each instance gets its own core for the emu
+ * thread. Returns the instance number, 0 for the parent.
+ */
+static int farm_fork(int n)
+{
+	int i, instance = 0;
+
+	if (n > FARM_MAX)
+		n = FARM_MAX;
+	psxMemReset(); // bios into psxR, SysReset() won't rewrite it
+	fflush(stdout);
+	fflush(stderr);
+	for (i = 1; i < n; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		if (pid == 0) {
+			instance = i;
+			farm_count = 0;
+			break;
+		}
+		farm_pids[farm_count++] = pid;
+	}
+	pl_bench_set_instance(instance);
+	// one core per instance, no helpers fanning out over the others
+	Config.MdecThreads = 1;
+#ifdef HAVE_RTHREADS
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cores > 0) {
+		for (i = 0; i < PCSXRT_COUNT; i++)
+			pcsxr_tpolicy.cpu[i] = PCSXR_CPU_FREE;
+		pcsxr_tpolicy.cpu[PCSXRT_EMU] = PCSXR_CPU_0 + instance % cores;
+		pcsxr_tpolicy.jobs = 1;
+		pcsxr_tpolicy.enable = 1;
+		pcsxr_sthread_apply_self(PCSXRT_EMU);
+	}
+#endif
+	return instance;
+}
+
+// nonzero if any instance failed
+static int farm_wait(void)
+{
+	int i, status, ret = 0;
+
+	for (i = 0; i < farm_count; i++) {
+		if (waitpid(farm_pids[i], &status, 0) < 0
+		    || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			ret = 1;
+	}
+	return ret;
+}
+#else
+#define farm_fork(n) 0
+#define farm_wait() 0
+#endif
+
 int main(int argc, char *argv[])
 {
 	char file[MAXPATHLEN] = "";
@@ -588,14 +875,25 @@ int main(int argc, char *argv[])
 	char isofilename[MAXPATHLEN];
 	const char *cdfile = NULL;
 	const char *loadst_f = NULL;
+	const char *bench_input = NULL;
+	const char *profile_f = NULL;
+	const char *trace_f = NULL;
+	const char *export_name = NULL;
+	int metrics_port = 0;
+	int bench_frames = 0;
+	int autotune_frames = 0;
+	int farm_instances = 0;
+	int farm_instance = 0;
 	int psxout = 0;
 	int loadst = 0;
 	int i;
 
+	emu_startup_mark(NULL);
 #ifdef WEBOS
 	// WebOS: PDL must be initialized FIRST, before anything else
 	// This lets WebOS control the display buffer and prevents flicker on touch
 	webos_init();
+	emu_startup_mark("webos_init");
 #endif
 
 	emu_core_preinit();
@@ -628,6 +926,38 @@ int main(int argc, char *argv[])
 			if (i+1 >= argc) break;
 			loadst_f = argv[++i];
 		}
+		else if (!strcmp(argv[i], "-bench")) {
+			if (i+1 >= argc) break;
+			bench_frames = atol(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-autotune")) {
+			if (i+1 >= argc) break;
+			autotune_frames = atol(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-farm")) {
+			if (i+1 >= argc) break;
+			farm_instances = atol(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-input")) {
+			if (i+1 >= argc) break;
+			bench_input = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-profile")) {
+			if (i+1 >= argc) break;
+			profile_f = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-trace")) {
+			if (i+1 >= argc) break;
+			trace_f = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-export")) {
+			if (i+1 >= argc) break;
+			export_name = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-metrics")) {
+			if (i+1 >= argc) break;
+			metrics_port = atol(argv[++i]);
+		}
 		else if (!strcmp(argv[i], "-h") ||
 			 !strcmp(argv[i], "-help") ||
 			 !strcmp(argv[i], "--help")) {
@@ -640,6 +970,17 @@ int main(int argc, char *argv[])
 							"\t-psxout\t\tEnable PSX output\n"
 							"\t-load STATENUM\tLoads savestate STATENUM (1-9)\n"
 							"\t-loadf FILE\tLoads savestate from FILE\n"
+							"\t-bench FRAMES\tRuns FRAMES frames headless and prints timing as JSON\n"
+							"\t-autotune FRAMES\tOn a game's first run, benchmarks FRAMES frames with\n"
+							"\t\t\tcheaper and cheaper settings, saves the first full speed\n"
+							"\t\t\tones as the game's config\n"
+							"\t-input FILE\tFeeds recorded pad input from FILE (with -bench/-autotune)\n"
+							"\t-farm N\t\tRuns the -bench in N forked instances, one core each\n"
+							"\t-profile FILE\tSamples the emulated PC, writes a pprof profile to FILE\n"
+							"\t-trace FILE\tTraces events, writes the last ones as Chrome JSON to FILE\n"
+							"\t-export NAME\tPublishes frames and audio in shared memory /NAME\n"
+							"\t\t\tfor an external encoder (USE_SHM_EXPORT)\n"
+							"\t-metrics PORT\tServes Prometheus style metrics over http (USE_METRICS)\n"
 							"\t-h -help\tDisplay this message\n"
 							"\tfile\t\tLoads a PSX EXE file\n"));
 			 return 0;
@@ -666,7 +1007,17 @@ int main(int argc, char *argv[])
 	in_init();
 	pl_init();
 	plat_init();
+	emu_startup_mark("platform init");
 	menu_init(); // loads config
+	emu_startup_mark("menu, config");
+
+	if (autotune_frames > 0)
+		bench_frames = 0;
+	if (bench_frames > 0 || autotune_frames > 0) {
+		if (pl_bench_init(bench_frames + autotune_frames, bench_input) != 0)
+			return 1;
+		spu_config.iNoOutput = 1;
+	}
 
 	// WebOS: Set Video Overlay output (hardware accelerated, avoids touch flicker)
 	webos_set_video_default();
@@ -688,14 +1039,22 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 	pcnt_hook_plugins();
+	emu_startup_mark("plugins load");
+
+	if (farm_instances > 1 && bench_frames > 0)
+		farm_instance = farm_fork(farm_instances);
+	else if (farm_instances > 1)
+		SysPrintf("-farm only works with -bench\n");
 
 	if (OpenPlugins() == -1) {
 		return 1;
 	}
 
 	CheckCdrom();
+	emu_startup_mark("CheckCdrom");
 	plugin_call_rearmed_cbs();
 	SysReset();
+	emu_startup_mark("reset (bios)");
 
 	if (file[0] != '\0') {
 		if (Load(file) != -1)
@@ -722,12 +1081,31 @@ int main(int argc, char *argv[])
 				ret ? "failed to load" : "loaded", loadst);
 		}
 	}
+	else if (bench_frames > 0 || autotune_frames > 0) {
+		SysMessage("-bench needs a CD image, EXE or savestate to run");
+		return 1;
+	}
+
+	if (autotune_frames > 0 && run_autotune() != 0)
+		return 1;
+	if (autotune_frames > 0)
+		g_emu_want_quit = 1;
 	else
 		menu_loop();
 
 #ifndef LIGHTREC_DEBUG
 	pl_start_watchdog();
 #endif
+	if (profile_f && psxProfStart(0) != 0)
+		SysPrintf("-profile: the profiler is not available (USE_PSX_PROFILER)\n");
+	if (trace_f && evtrace_start() != 0)
+		SysPrintf("-trace: the tracer is not available (USE_EVTRACE)\n");
+	if (export_name && shmx_start(export_name) != 0)
+		SysPrintf("-export: not available (USE_SHM_EXPORT) or failed\n");
+	else if (export_name)
+		spu_config.pFeedHook = shmx_audio;
+	if (metrics_port > 0 && metrics_start(metrics_port) != 0)
+		SysPrintf("-metrics: not available (USE_METRICS) or failed\n");
 
 	fprintf(stderr, "PCSX_DEBUG: main() entering emulation loop\n");
 	fflush(stderr);
@@ -744,14 +1122,32 @@ int main(int argc, char *argv[])
 			do_emu_action();
 	}
 
+	if (bench_frames > 0)
+		pl_bench_print();
+	if (profile_f) {
+		psxProfStop();
+		psxProfWrite(profile_f);
+	}
+	if (trace_f)
+		evtrace_dump(trace_f);
+	spu_config.pFeedHook = NULL;
+	shmx_stop();
+	metrics_stop();
 	printf("Exit..\n");
+	if (farm_instance == 0)
+		emu_save_drc_cache();
+	if (ndrc_g.hacks & NDHACK_BLOCK_PROFILE) {
+		MAKE_PATH(path, PCSX_DOT_DIR, "ndrc_profile.txt");
+		new_dynarec_dump_profile(path);
+	}
 	ClosePlugins();
+	state_async_finish();
 	SysClose();
 	menu_finish();
 	plat_finish();
 	webos_finish();
 
-	return 0;
+	return farm_wait();
 }
 
 static void toggle_fast_forward(int force_off)
@@ -813,11 +1209,266 @@ static int get_gameid_filename(char *buf, int size, const char *fmt, int i) {
 	return 0;
 }
 
+static int get_drc_cache_filename(char *buf, int size) {
+	if (CdromId[0] == '\0')
+		return -1;
+	return get_gameid_filename(buf, size,
+		"%s" CACHE_DIR "%.32s-%.9s.drc", 0);
+}
+
+static void load_drc_cache(void)
+{
+	char fname[MAXPATHLEN];
+
+	if (get_drc_cache_filename(fname, sizeof(fname)) == 0)
+		ndrc_cache_load(fname);
+}
+
+// called when a game is closed, before CdromId is lost
+void emu_save_drc_cache(void)
+{
+	char fname[MAXPATHLEN];
+
+	if (Config.Cpu != CPU_DYNAREC)
+		return;
+	if (get_drc_cache_filename(fname, sizeof(fname)) == 0)
+		ndrc_cache_save(fname);
+}
+
 int get_state_filename(char *buf, int size, int i) {
 	return get_gameid_filename(buf, size,
 		"%s" STATES_DIR "%.32s-%.9s.%3.3d", i);
 }
 
+#ifdef USE_ASYNC_SAVESTATE
+#include <fcntl.h>
+#include <zlib.h>
+
+// Snapshotting into memory is quick, but the deflate and the write can
+// stall the game for a good part of a second, so that's left to a thread.
+static struct {
+	sthread_t *thread;
+	slock_t *lock;
+	scond_t *cond;
+	int exit, failed;
+	int pending;		// buf holds a state waiting to be written
+	int slot;
+	int len;
+	char fname[MAXPATHLEN];
+	u8 *buf;
+	// raw copy of the last frame for the thumbnail, pic_w == 0 if none
+	u16 *pic;
+	int pic_w, pic_h, pic_size;
+} sst;
+
+// write to a temp file and rename, so that a crash or power loss mid-way
+// can't leave a truncated state in place of the old one
+static int state_write(const char *fname, const void *buf, int len)
+{
+	char tmp[MAXPATHLEN + 4];
+	gzFile f;
+	int fd, ret = -1;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", fname);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	f = gzdopen(dup(fd), StateWriteMode());
+	if (f != NULL) {
+		if (gzwrite(f, buf, len) == len)
+			ret = 0;
+		if (gzclose(f) != Z_OK)
+			ret = -1;
+	}
+	if (ret == 0)
+		ret = fsync(fd);
+	close(fd);
+	if (ret == 0)
+		ret = rename(tmp, fname);
+	if (ret != 0)
+		unlink(tmp);
+	return ret;
+}
+
+// area average down to a fixed size, the frame is RGB565 already
+static void state_write_thumb(const char *fname)
+{
+	char pname[MAXPATHLEN + 4];
+	static u16 t[STATE_THUMB_W * STATE_THUMB_H];
+	int x, y, i, j, x0, x1, y0, y1, n, r, g, b, ret;
+	const u16 *s;
+
+	snprintf(pname, sizeof(pname), "%s.png", fname);
+	for (y = 0; y < STATE_THUMB_H; y++) {
+		y0 = y * sst.pic_h / STATE_THUMB_H;
+		y1 = (y + 1) * sst.pic_h / STATE_THUMB_H;
+		if (y1 == y0)
+			y1++;
+		for (x = 0; x < STATE_THUMB_W; x++) {
+			x0 = x * sst.pic_w / STATE_THUMB_W;
+			x1 = (x + 1) * sst.pic_w / STATE_THUMB_W;
+			if (x1 == x0)
+				x1++;
+			r = g = b = 0;
+			for (j = y0; j < y1; j++) {
+				s = sst.pic + j * sst.pic_w;
+				for (i = x0; i < x1; i++) {
+					r += s[i] >> 11;
+					g += (s[i] >> 5) & 0x3f;
+					b += s[i] & 0x1f;
+				}
+			}
+			n = (x1 - x0) * (y1 - y0);
+			t[y * STATE_THUMB_W + x] = (r / n << 11) | (g / n << 5) | (b / n);
+		}
+	}
+	ret = writepng(pname, t, STATE_THUMB_W, STATE_THUMB_H);
+	if (ret != 0)
+		SysPrintf("writepng %s: %d\n", pname, ret);
+}
+
+// completion callback, runs on the state thread
+static void state_saved(int slot, const char *fname, int ret)
+{
+	SysPrintf("* %s \"%s\" [%d]\n",
+		ret == 0 ? "saved" : "failed to save", fname, slot);
+}
+
+static STRHEAD_RET_TYPE state_thread(void *unused)
+{
+	int ret;
+
+	slock_lock(sst.lock);
+	while (!sst.exit) {
+		if (!sst.pending) {
+			scond_wait(sst.cond, sst.lock);
+			twake_count(TWAKE_STATE);
+			continue;
+		}
+		// the emu thread leaves buf/fname alone while pending is set
+		slock_unlock(sst.lock);
+		ret = state_write(sst.fname, sst.buf, sst.len);
+		if (ret == 0 && sst.pic_w)
+			state_write_thumb(sst.fname);
+		state_saved(sst.slot, sst.fname, ret);
+		slock_lock(sst.lock);
+		sst.pending = 0;
+		scond_broadcast(sst.cond);
+	}
+	slock_unlock(sst.lock);
+	STRHEAD_RETURN();
+}
+
+static void state_async_free(void)
+{
+	if (sst.cond) { scond_free(sst.cond); sst.cond = NULL; }
+	if (sst.lock) { slock_free(sst.lock); sst.lock = NULL; }
+	free(sst.buf);
+	free(sst.pic);
+	sst.buf = NULL;
+	sst.pic = NULL;
+	sst.pic_size = 0;
+}
+
+static int state_async_start(void)
+{
+	if (sst.failed)
+		return -1;
+	sst.exit = 0;
+	sst.buf = malloc(SAVESTATE_MAX_SIZE);
+	sst.lock = slock_new();
+	sst.cond = scond_new();
+	if (sst.buf && sst.lock && sst.cond)
+		sst.thread = pcsxr_sthread_create(state_thread, PCSXRT_STATE);
+	if (sst.thread == NULL) {
+		SysPrintf("savestate thread init failed.\n");
+		state_async_free();
+		sst.failed = 1;
+		return -1;
+	}
+	return 0;
+}
+
+// waits for a pending write of this slot (or any, if slot < 0)
+static void state_async_wait(int slot)
+{
+	if (sst.thread == NULL)
+		return;
+	slock_lock(sst.lock);
+	while (sst.pending && (slot < 0 || slot == sst.slot))
+		scond_wait(sst.cond, sst.lock);
+	slock_unlock(sst.lock);
+}
+
+// only a copy is made here, the scaling and encoding is left to the thread
+static void state_async_grab_pic(void)
+{
+	void *scrbuf;
+	int w, h, bpp, size;
+
+	sst.pic_w = 0;
+	if (!(g_opts & OPT_STATE_THUMB))
+		return;
+	scrbuf = pl_prepare_screenshot(&w, &h, &bpp);
+	if (scrbuf == NULL || bpp != 16 || w <= 0 || h <= 0)
+		return;
+	size = w * h * 2;
+	if (size > sst.pic_size) {
+		free(sst.pic);
+		sst.pic = malloc(size);
+		sst.pic_size = sst.pic ? size : 0;
+		if (sst.pic == NULL)
+			return;
+	}
+	memcpy(sst.pic, scrbuf, size);
+	sst.pic_w = w;
+	sst.pic_h = h;
+}
+
+static int state_async_save(int slot, const char *fname)
+{
+	int len;
+
+	if (sst.thread == NULL && state_async_start())
+		return -1;
+
+	// only one state in flight, a quick second save waits for the first
+	state_async_wait(-1);
+	len = SaveStateMem(sst.buf, SAVESTATE_MAX_SIZE, 0);
+	if (len < 0)
+		return -1;
+	state_async_grab_pic();
+
+	slock_lock(sst.lock);
+	snprintf(sst.fname, sizeof(sst.fname), "%s", fname);
+	sst.slot = slot;
+	sst.len = len;
+	sst.pending = 1;
+	scond_broadcast(sst.cond);
+	slock_unlock(sst.lock);
+	return 0;
+}
+
+static void state_async_finish(void)
+{
+	if (sst.thread == NULL)
+		return;
+	state_async_wait(-1);
+	slock_lock(sst.lock);
+	sst.exit = 1;
+	scond_broadcast(sst.cond);
+	slock_unlock(sst.lock);
+	sthread_join(sst.thread);
+	sst.thread = NULL;
+	state_async_free();
+}
+#else
+#define state_async_wait(slot)
+static void state_async_finish(void)
+{
+}
+#endif
+
 int emu_check_state(int slot)
 {
 	char fname[MAXPATHLEN];
@@ -827,6 +1478,7 @@ int emu_check_state(int slot)
 	if (ret != 0)
 		return ret;
 
+	state_async_wait(slot);
 	return CheckState(fname);
 }
 
@@ -839,6 +1491,14 @@ int emu_save_state(int slot)
 	if (ret != 0)
 		return ret;
 
+	// a slot save should go with the cards as they are now, in-memory
+	// states (rewind, libretro) leave the write-back coalescing alone
+	FlushMcds();
+#ifdef USE_ASYNC_SAVESTATE
+	// the result is reported by state_saved() later
+	if (state_async_save(slot, fname) == 0)
+		return 0;
+#endif
 	ret = SaveState(fname);
 #if defined(HAVE_PRE_ARMV7) && !defined(_3DS) && !defined(__SWITCH__) /* XXX GPH hack */
 	sync();
@@ -859,9 +1519,179 @@ int emu_load_state(int slot)
 	if (ret != 0)
 		return ret;
 
+	state_async_wait(slot);
 	return LoadState(fname);
 }
 
+// webOS only backgrounds the card and may kill us later when it wants the
+// memory. While hidden, the helper threads, audio, the display and the
+// caches are let go, and the state goes to a resume file that
+// emu_suspend_load() picks up at the next launch if we don't come back.
+static int get_suspend_filename(char *buf, int size)
+{
+	return get_gameid_filename(buf, size,
+		"%s" STATES_DIR "%.32s-%.9s.resume", 0);
+}
+
+// snapshotting into memory is quick, the file is written uncompressed
+// (gzread() passes that through) so nothing is spent on deflate
+static void emu_suspend_save(const char *fname)
+{
+	void *buf;
+	FILE *f;
+	int len;
+
+	buf = malloc(SAVESTATE_MAX_SIZE);
+	if (buf == NULL)
+		return;
+	len = SaveStateMem(buf, SAVESTATE_MAX_SIZE, 0);
+	f = len > 0 ? fopen(fname, "wb") : NULL;
+	if (f != NULL) {
+		if (fwrite(buf, 1, len, f) != len) {
+			fclose(f);
+			remove(fname);
+		}
+		else
+			fclose(f);
+	}
+	free(buf);
+}
+
+static void emu_suspend(void)
+{
+	int thread_rendering = pl_rearmed_cbs.thread_rendering;
+	char fname[MAXPATHLEN];
+	int have_file, ret;
+
+	SysPrintf("suspending\n");
+	state_async_wait(-1);
+	// the freeze also collects what the spu worker has, it idles from here
+	have_file = ready_to_go && get_suspend_filename(fname, sizeof(fname)) == 0;
+	if (have_file)
+		emu_suspend_save(fname);
+
+	// stops the gpu_async thread and frees its buffers
+	pl_rearmed_cbs.thread_rendering = 0;
+	plugin_call_rearmed_cbs();
+	if (GPU_close != NULL)
+		GPU_close();
+	// the cdrom thread with its caches, and the audio device
+	ClosePlugins();
+#ifdef HAVE_RTHREADS
+	// restarted on the first job
+	pcsxr_jobs_shutdown();
+#endif
+
+	if (webos_wait_foreground() != 0)
+		emu_core_ask_exit();
+
+	if (OpenPlugins() == -1)
+		SysMessage("resume: failed to reopen the plugins");
+	pl_rearmed_cbs.thread_rendering = thread_rendering;
+	plugin_call_rearmed_cbs();
+	if (GPU_open != NULL) {
+		ret = GPU_open(&gpuDisp, "PCSX", NULL);
+		if (ret)
+			SysMessage("GPU_open returned %d", ret);
+	}
+	// still running, the file is only for when we get killed
+	if (have_file)
+		remove(fname);
+	SysPrintf("resumed\n");
+}
+
+int emu_suspend_load(void)
+{
+	char fname[MAXPATHLEN];
+	int ret;
+
+	if (get_suspend_filename(fname, sizeof(fname)) != 0)
+		return -1;
+	if (CheckState(fname) != 0)
+		return -1;
+	ret = LoadState(fname);
+	SysPrintf("%s the suspended session \"%s\"\n",
+		ret == 0 ? "resumed" : "failed to resume", fname);
+	// one shot, a broken file must not come back every launch
+	remove(fname);
+	return ret;
+}
+
+// Fast boot: the state right after the CD executable is loaded gets
+// cached, keyed by the build, the BIOS image and the boot affecting
+// settings, so that later launches of the game skip the BIOS run.
+static struct {
+	u32 key;
+	int have_key;
+} boot_snap;
+
+static u32 boot_snap_calc_key(void)
+{
+	const u8 *p = (const u8 *)REV;
+	u32 h = 0x811c9dc5, i, v[4];
+
+	for (; *p; p++)
+		h = (h ^ *p) * 0x01000193;
+	for (i = 0; i < 0x80000; i++)
+		h = (h ^ (u8)psxR[i]) * 0x01000193;
+	v[0] = Config.HLE;
+	v[1] = Config.PsxType;
+	v[2] = Config.Cpu;
+	v[3] = Config.cycle_multiplier;
+	for (p = (const u8 *)v, i = 0; i < sizeof(v); i++)
+		h = (h ^ p[i]) * 0x01000193;
+	return h;
+}
+
+static int get_boot_snap_filename(char *buf, int size)
+{
+	if (CdromId[0] == '\0' || !boot_snap.have_key)
+		return -1;
+	return get_gameid_filename(buf, size,
+		"%s" CACHE_DIR "%.32s-%.9s-%08x.boot", boot_snap.key);
+}
+
+// to be called instead of SysReset() + LoadCdrom(), nonzero if the normal
+// boot has to be done
+int emu_boot_snap_load(void)
+{
+	char fname[MAXPATHLEN];
+
+	boot_snap.have_key = 0;
+	if (!(g_opts & OPT_BOOT_SNAP) || Config.SlowBoot)
+		return -1;
+
+	// BIOS gets loaded here, no code is run
+	pl_timing_prepare(Config.PsxType);
+	FreeCheatSearchResults();
+	FreeCheatSearchMem();
+	psxResetNoBoot();
+	boot_snap.key = boot_snap_calc_key();
+	boot_snap.have_key = 1;
+
+	if (get_boot_snap_filename(fname, sizeof(fname)) != 0
+	    || CheckState(fname) != 0)
+		return -1;
+	if (LoadState(fname) != 0) {
+		SysPrintf("boot snapshot \"%s\" failed to load\n", fname);
+		return -1;
+	}
+	SysPrintf("* fast boot from \"%s\"\n", fname);
+	return 0;
+}
+
+// after a normal boot that followed a failed emu_boot_snap_load()
+void emu_boot_snap_save(void)
+{
+	char fname[MAXPATHLEN];
+
+	if (get_boot_snap_filename(fname, sizeof(fname)) != 0)
+		return;
+	boot_snap.have_key = 0;
+	if (SaveState(fname) == 0)
+		SysPrintf("* boot snapshot saved to \"%s\"\n", fname);
+}
+
 #endif // NO_FRONTEND
 
 static void CALLBACK dummy_lace(void)
@@ -888,6 +1718,9 @@ void SysReset() {
 void SysClose() {
 	EmuShutdown();
 	ReleasePlugins();
+#ifdef HAVE_RTHREADS
+	pcsxr_jobs_shutdown();
+#endif
 
 	StopDebugger();
 }
@@ -951,8 +1784,10 @@ static int _OpenPlugins(void) {
 
 	ret = cdra_open();
 	if (UsingIso() && ret < 0) { SysMessage(_("Error opening CD-ROM plugin!")); return -1; }
+	emu_startup_mark("cdrom open");
 	ret = SPU_open();
 	if (ret < 0) { SysMessage(_("Error opening SPU plugin!")); return -1; }
+	emu_startup_mark("spu open");
 	SPU_registerCallback(SPUirq);
 	SPU_registerScheduleCb(SPUschedule);
 	// pcsx-rearmed: we handle gpu elsewhere
@@ -30,6 +30,7 @@
 #define CHEATS_DIR         PCSX_DOT_DIR "cheats/"
 #define PATCHES_DIR        PCSX_DOT_DIR "patches/"
 #define CFG_DIR            PCSX_DOT_DIR "cfg/"
+#define CACHE_DIR          PCSX_DOT_DIR "cache/"
 #if !defined(PANDORA) && !defined(MIYOO)
 #define BIOS_DIR           PCSX_DOT_DIR "bios/"
 #define SCREENSHOTS_DIR    PCSX_DOT_DIR "screenshots/"
@@ -38,6 +39,10 @@
 #define SCREENSHOTS_DIR    "/screenshots/"
 #endif
 
+// savestate thumbnails go next to the state as <state>.png
+#define STATE_THUMB_W      160
+#define STATE_THUMB_H      120
+
 extern char cfgfile_basename[MAXPATHLEN];
 
 extern int state_slot;
@@ -51,6 +56,10 @@ void emu_core_ask_exit(void);
 
 void emu_set_default_config(void);
 void emu_on_new_cd(int show_hud_msg);
+void emu_load_cwcheats(void);
+void emu_startup_mark(const char *phase);
+void emu_startup_done(void);
+void emu_save_drc_cache(void);
 
 void emu_make_path(char *buf, size_t size, const char *dir, const char *fname);
 void emu_make_data_path(char *buff, const char *end, int size);
@@ -59,6 +68,9 @@ int get_state_filename(char *buf, int size, int i);
 int emu_check_state(int slot);
 int emu_save_state(int slot);
 int emu_load_state(int slot);
+int emu_boot_snap_load(void);
+void emu_boot_snap_save(void);
+int emu_suspend_load(void);
 
 void set_cd_image(const char *fname);
 
@@ -84,11 +96,17 @@ enum sched_action {
 	SACTION_MINIMIZE,
 	SACTION_TOGGLE_FPS,
 	SACTION_TOGGLE_FULLSCREEN,
+	SACTION_GPU_RECORD,
 	SACTION_GUN_TRIGGER = 16,
 	SACTION_GUN_A,
 	SACTION_GUN_B,
 	SACTION_GUN_TRIGGER2,
 	SACTION_ANALOG_TOGGLE,
+	SACTION_REWIND,
+	SACTION_EVENT_TRACE,
+	SACTION_REWIND_CAPTURE,	// internal, not bindable
+	SACTION_CPU_BOOST,	// internal, not bindable
+	SACTION_SUSPEND,	// internal, not bindable
 };
 
 #define SACTION_GUN_MASK (0x0f << SACTION_GUN_TRIGGER)
@@ -39,8 +39,12 @@
 #include "../libpcsxcore/cdriso.h"
 #include "../libpcsxcore/cheat.h"
 #include "../libpcsxcore/ppf.h"
+#include "../libpcsxcore/rewind.h"
 #include "../libpcsxcore/new_dynarec/new_dynarec.h"
 #include "../plugins/dfsound/spu_config.h"
+#ifdef HAVE_RTHREADS
+#include "pcsxr-threads.h"
+#endif
 #include "psemu_plugin_defs.h"
 #include "compiler_features.h"
 #include "arm_features.h"
@@ -103,16 +107,18 @@ typedef enum
 } menu_id;
 
 static int last_vout_w, last_vout_h, last_vout_bpp;
-static int cpu_clock, cpu_clock_st, volume_boost;
+static int cpu_clock, cpu_clock_st, volume_boost, out_rate_sel;
 static int frameskip = 1; // 0 - auto, 1 - off
 static char last_selected_fname[MAXPATHLEN];
 static int config_save_counter, region, in_type_sel1, in_type_sel2;
 static int psx_clock;
 static int memcard1_sel = -1, memcard2_sel = -1;
-static int cd_buf_count;
+static int cd_buf_count, cd_preload;
 extern int g_autostateld_opt;
-static int menu_iopts[8];
+static int menu_iopts[16];
 int g_opts, g_scaler, g_gamma = 100;
+int rewind_mb, rewind_interval = 10;
+int gpu_rec_frames = 60;
 int scanlines, scanline_level = 20;
 int soft_scaling, analog_deadzone; // for Caanoo
 int soft_filter;
@@ -131,6 +137,7 @@ static const char *gpu_plugins[16];
 static const char *spu_plugins[16];
 static const char *memcards[32];
 static int bios_sel, gpu_plugsel, spu_plugsel;
+static void scan_plugins(void);
 
 #ifndef UI_FEATURES_H
 #define MENU_SHOW_VOUTMODE 1
@@ -198,6 +205,81 @@ static int emu_save_load_game(int load, int unused)
 	return ret;
 }
 
+/*
+ * What the cd image filter below dropped, per directory, so revisiting a
+ * big folder doesn't parse every .cue and stat what it references again.
+ * Keyed on the directory mtime (any add/remove/rename bumps it) and entry
+ * count, edits inside an existing .cue are not noticed until then.
+ */
+#define ROMSEL_CACHE_DIRS 8
+
+static struct romsel_cache {
+	char dir[MAXPATHLEN];
+	time_t mtime;
+	int count;
+	int *drop;	// namelist indexes
+	char **names;	// and their names, to be sure
+	int drop_cnt, drop_max;
+} romsel_cache[ROMSEL_CACHE_DIRS];
+static struct romsel_cache *romsel_filling;
+static int romsel_cache_next;
+
+static void romsel_cache_free(struct romsel_cache *c)
+{
+	int i;
+
+	for (i = 0; i < c->drop_cnt; i++)
+		free(c->names[i]);
+	free(c->drop);
+	free(c->names);
+	memset(c, 0, sizeof(*c));
+}
+
+static void romsel_cache_add(struct romsel_cache *c, int index, const char *name)
+{
+	int *drop;
+	char **names;
+
+	if (c->drop_cnt == c->drop_max) {
+		c->drop_max = c->drop_max ? c->drop_max * 2 : 64;
+		drop = realloc(c->drop, c->drop_max * sizeof(c->drop[0]));
+		names = realloc(c->names, c->drop_max * sizeof(c->names[0]));
+		if (drop)
+			c->drop = drop;
+		if (names)
+			c->names = names;
+		if (!drop || !names) {
+			c->drop_max = c->drop_cnt;
+			romsel_filling = NULL;
+			return;
+		}
+	}
+	c->names[c->drop_cnt] = strdup(name);
+	if (c->names[c->drop_cnt] == NULL) {
+		romsel_filling = NULL;
+		return;
+	}
+	c->drop[c->drop_cnt++] = index;
+}
+
+static int namelist_compact(struct dirent **namelist, int count)
+{
+	int i, d;
+
+	for (i = d = 1; i < count; i++)
+		if (namelist[i] != NULL)
+			namelist[d++] = namelist[i];
+	return d;
+}
+
+static void drop_namelist_entry(struct dirent **namelist, int i)
+{
+	if (romsel_filling)
+		romsel_cache_add(romsel_filling, i, namelist[i]->d_name);
+	free(namelist[i]);
+	namelist[i] = NULL;
+}
+
 static void rm_namelist_entry(struct dirent **namelist,
 	int count, const char *name)
 {
@@ -208,19 +290,18 @@ static void rm_namelist_entry(struct dirent **namelist,
 			continue;
 
 		if (strcmp(name, namelist[i]->d_name) == 0) {
-			free(namelist[i]);
-			namelist[i] = NULL;
+			drop_namelist_entry(namelist, i);
 			break;
 		}
 	}
 }
 
-static int optional_cdimg_filter(struct dirent **namelist, int count,
+static int cdimg_filter_scan(struct dirent **namelist, int count,
 	const char *basedir)
 {
 	const char *ext, *p;
 	char buf[256], buf2[257];
-	int i, d, ret, good_cue;
+	int i, ret, good_cue;
 	struct STAT statf;
 	FILE *f;
 
@@ -234,8 +315,7 @@ static int optional_cdimg_filter(struct dirent **namelist, int count,
 		ext = strrchr(namelist[i]->d_name, '.');
 		if (ext == NULL) {
 			// should not happen but whatever
-			free(namelist[i]);
-			namelist[i] = NULL;
+			drop_namelist_entry(namelist, i);
 			continue;
 		}
 		ext++;
@@ -248,8 +328,7 @@ static int optional_cdimg_filter(struct dirent **namelist, int count,
 
 			f = fopen(buf, "r");
 			if (f == NULL) {
-				free(namelist[i]);
-				namelist[i] = NULL;
+				drop_namelist_entry(namelist, i);
 				continue;
 			}
 
@@ -279,8 +358,7 @@ static int optional_cdimg_filter(struct dirent **namelist, int count,
 			fclose(f);
 
 			if (!good_cue) {
-				free(namelist[i]);
-				namelist[i] = NULL;
+				drop_namelist_entry(namelist, i);
 			}
 			continue;
 		}
@@ -289,19 +367,83 @@ static int optional_cdimg_filter(struct dirent **namelist, int count,
 		if (p != NULL) {
 			ret = strtoul(p + 5, NULL, 10);
 			if (ret > 1) {
-				free(namelist[i]);
-				namelist[i] = NULL;
+				drop_namelist_entry(namelist, i);
 				continue;
 			}
 		}
 	}
 
-	// compact namelist
-	for (i = d = 1; i < count; i++)
-		if (namelist[i] != NULL)
-			namelist[d++] = namelist[i];
+	return namelist_compact(namelist, count);
+}
 
-	return d;
+static struct romsel_cache *romsel_cache_find(const char *basedir,
+	const struct STAT *st, int count)
+{
+	int i;
+
+	for (i = 0; i < ROMSEL_CACHE_DIRS; i++) {
+		struct romsel_cache *c = &romsel_cache[i];
+		if (c->dir[0] && strcmp(c->dir, basedir) == 0) {
+			if (c->mtime == st->st_mtime && c->count == count)
+				return c;
+			romsel_cache_free(c);
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int romsel_cache_apply(struct romsel_cache *c,
+	struct dirent **namelist, int count)
+{
+	int i, n;
+
+	for (i = 0; i < c->drop_cnt; i++) {
+		n = c->drop[i];
+		if (n >= count || namelist[n] == NULL
+		    || strcmp(namelist[n]->d_name, c->names[i]) != 0)
+			return -1;
+	}
+	for (i = 0; i < c->drop_cnt; i++) {
+		free(namelist[c->drop[i]]);
+		namelist[c->drop[i]] = NULL;
+	}
+	return 0;
+}
+
+static int optional_cdimg_filter(struct dirent **namelist, int count,
+	const char *basedir)
+{
+	struct romsel_cache *c;
+	int count_all = count;
+	struct STAT st;
+
+	if (count <= 1)
+		return count;
+	if (STAT(basedir, &st) != 0 || strlen(basedir) >= sizeof(c->dir))
+		return cdimg_filter_scan(namelist, count, basedir);
+
+	c = romsel_cache_find(basedir, &st, count);
+	if (c != NULL) {
+		if (romsel_cache_apply(c, namelist, count) == 0)
+			return namelist_compact(namelist, count);
+		romsel_cache_free(c);
+	}
+
+	c = &romsel_cache[romsel_cache_next];
+	romsel_cache_next = (romsel_cache_next + 1) % ROMSEL_CACHE_DIRS;
+	romsel_cache_free(c);
+	romsel_filling = c;
+	count = cdimg_filter_scan(namelist, count, basedir);
+	if (romsel_filling == c) {
+		strcpy(c->dir, basedir);
+		c->mtime = st.st_mtime;
+		c->count = count_all;
+	}
+	else
+		romsel_cache_free(c);
+	romsel_filling = NULL;
+	return count;
 }
 
 // propagate menu settings to the emu vars
@@ -336,8 +478,12 @@ static void menu_sync_config(void)
 	}
 
 	spu_config.iVolume = 768 + 128 * volume_boost;
+	spu_config.iOutRate = out_rate_sel ? 48000 : 0;
 	pl_rearmed_cbs.frameskip = frameskip - 1;
 	pl_timing_prepare(Config.PsxType);
+#ifdef HAVE_RTHREADS
+	pcsxr_sthread_apply_self(PCSXRT_EMU);
+#endif
 }
 
 static void menu_set_defconfig(void)
@@ -348,6 +494,7 @@ static void menu_set_defconfig(void)
 	g_scaler = SCALE_4_3;
 	g_gamma = 100;
 	volume_boost = 0;
+	out_rate_sel = 0;
 #ifdef MIYOO
 	frameskip = 0; // 0 - auto
 #else
@@ -364,6 +511,13 @@ static void menu_set_defconfig(void)
 	plat_target.vout_fullscreen = 0;
 #endif
 	psx_clock = DEFAULT_PSX_CLOCK;
+	rewind_mb = 0;
+	rewind_interval = 10;
+	gpu_rec_frames = 60;
+#ifdef HAVE_RTHREADS
+	memset(&pcsxr_tpolicy, 0, sizeof(pcsxr_tpolicy));
+	pcsxr_tpolicy.enable = 1; // all PCSXR_CPU_AUTO
+#endif
 
 	region = 0;
 	in_type_sel1 = in_type_sel2 = 0;
@@ -420,8 +574,12 @@ static const struct {
 	CE_CONFIG_VAL(GpuListWalking),
 	CE_CONFIG_VAL(FractionalFramerate),
 	CE_CONFIG_VAL(PreciseExceptions),
+	CE_CONFIG_VAL(PredecodeInt),
 	CE_CONFIG_VAL(TurboCD),
 	CE_CONFIG_VAL(SlowBoot),
+	CE_CONFIG_VAL(StateCompression),
+	CE_CONFIG_VAL(MdecThreads),
+	CE_CONFIG_VAL(MemBudgetMB),
 	CE_INTVAL(region),
 	CE_INTVAL_V(g_scaler, 3),
 	CE_INTVAL(g_gamma),
@@ -445,6 +603,10 @@ static const struct {
 	CE_INTVAL(memcard2_sel),
 	CE_INTVAL(g_autostateld_opt),
 	CE_INTVAL(cd_buf_count),
+	CE_INTVAL(cd_preload),
+	CE_INTVAL(rewind_mb),
+	CE_INTVAL(gpu_rec_frames),
+	CE_INTVAL(rewind_interval),
 	CE_INTVAL_N("adev0_axis0", in_adev_axis[0][0]),
 	CE_INTVAL_N("adev0_axis1", in_adev_axis[0][1]),
 	CE_INTVAL_N("adev1_axis0", in_adev_axis[1][0]),
@@ -454,6 +616,7 @@ static const struct {
 	CE_INTVAL_V(frameskip, 4),
 	CE_INTVAL_PV(dithering, 2),
 	CE_INTVAL_P(thread_rendering),
+	CE_INTVAL_P(thread_frames),
 	CE_INTVAL_P(scale_hires),
 	CE_INTVAL_P(gpu_peops.dwActFixes),
 	CE_INTVAL_P(gpu_unai.old_renderer),
@@ -461,10 +624,12 @@ static const struct {
 	CE_INTVAL_P(gpu_unai.lighting),
 	CE_INTVAL_P(gpu_unai.fast_lighting),
 	CE_INTVAL_P(gpu_unai.blending),
+	CE_INTVAL_P(gpu_unai.render_bands),
 	CE_INTVAL_P(gpu_neon.allow_interlace),
 	CE_INTVAL_P(gpu_neon.enhancement_enable),
 	CE_INTVAL_P(gpu_neon.enhancement_no_main),
 	CE_INTVAL_PV(gpu_neon.enhancement_tex_adj, 2),
+	CE_INTVAL_P(gpu_neon.render_bands),
 	CE_INTVAL_P(gpu_peopsgl.bDrawDither),
 	CE_INTVAL_P(gpu_peopsgl.iFilterType),
 	CE_INTVAL_P(gpu_peopsgl.iFrameTexType),
@@ -474,6 +639,10 @@ static const struct {
 	CE_INTVAL_P(gpu_peopsgl.bUseFastMdec),
 	CE_INTVAL_P(gpu_peopsgl.iVRamSize),
 	CE_INTVAL_P(gpu_peopsgl.iTexGarbageCollection),
+	CE_INTVAL_P(gpu_peopsgl.iTexContentHash),
+	CE_INTVAL_P(gpu_peopsgl.iTexConvThread),
+	CE_INTVAL_P(gpu_peopsgl.iUseFBO),
+	CE_INTVAL_P(gpu_peopsgl.iGLThread),
 	CE_INTVAL_P(gpu_peopsgl.dwActFixes),
 	CE_INTVAL_P(screen_centering_type),
 	CE_INTVAL_P(screen_centering_x),
@@ -488,9 +657,26 @@ static const struct {
 	CE_INTVAL(config_save_counter),
 	CE_INTVAL(in_evdev_allow_abs_only),
 	CE_INTVAL(volume_boost),
+	CE_INTVAL(out_rate_sel),
 	CE_INTVAL(psx_clock),
 	CE_INTVAL(ndrc_g.hacks),
 	CE_INTVAL(in_enable_vibration),
+#ifdef HAVE_RTHREADS
+	CE_INTVAL_N("thread_placement", pcsxr_tpolicy.enable),
+	CE_INTVAL_N("thread_priority", pcsxr_tpolicy.prio),
+	CE_INTVAL_N("thread_cpu_emu", pcsxr_tpolicy.cpu[PCSXRT_EMU]),
+	CE_INTVAL_N("thread_cpu_cdr", pcsxr_tpolicy.cpu[PCSXRT_CDR]),
+	CE_INTVAL_N("thread_cpu_drc", pcsxr_tpolicy.cpu[PCSXRT_DRC]),
+	CE_INTVAL_N("thread_cpu_gpu", pcsxr_tpolicy.cpu[PCSXRT_GPU]),
+	CE_INTVAL_N("thread_cpu_gpuband", pcsxr_tpolicy.cpu[PCSXRT_GPU_BAND]),
+	CE_INTVAL_N("thread_cpu_spu", pcsxr_tpolicy.cpu[PCSXRT_SPU]),
+	CE_INTVAL_N("thread_cpu_spuhelp", pcsxr_tpolicy.cpu[PCSXRT_SPU_HELPER]),
+	CE_INTVAL_N("thread_cpu_mcd", pcsxr_tpolicy.cpu[PCSXRT_MCD]),
+	CE_INTVAL_N("thread_cpu_state", pcsxr_tpolicy.cpu[PCSXRT_STATE]),
+	CE_INTVAL_N("thread_cpu_mdec", pcsxr_tpolicy.cpu[PCSXRT_MDEC]),
+	CE_INTVAL_N("thread_cpu_job", pcsxr_tpolicy.cpu[PCSXRT_JOB]),
+	CE_INTVAL_N("thread_jobs", pcsxr_tpolicy.jobs),
+#endif
 };
 
 static char *get_cd_label(void)
@@ -545,6 +731,7 @@ static int menu_write_config(int is_game)
 	}
 
 	cd_buf_count = cdra_get_buf_count();
+	cd_preload = cdra_get_preload();
 
 	for (i = 0; i < ARRAY_SIZE(config_data); i++) {
 		fprintf(f, "%s = ", config_data[i].name);
@@ -708,6 +895,8 @@ int menu_load_config(int is_game)
 
 	keys_load_all(cfg);
 	cdra_set_buf_count(cd_buf_count);
+	cdra_set_preload(cd_preload);
+	rewind_init(rewind_mb << 20);
 	ret = 0;
 fail_read:
 	free(cfg);
@@ -718,6 +907,8 @@ fail:
 	menu_sync_config();
 
 	// sync plugins
+	if (strcmp(Config.Gpu, gpu_plugins[0]) || strcmp(Config.Spu, spu_plugins[0]))
+		scan_plugins();
 	for (i = bios_sel = 0; bioses[i] != NULL; i++)
 		if (strcmp(Config.Bios, bioses[i]) == 0)
 			{ bios_sel = i; break; }
@@ -790,6 +981,35 @@ static void draw_savestate_bg(int slot);
 #define MENU_ALIGN_LEFT
 #include "libpicofe/menu.c"
 
+// the preview saved along with the state, if it's not older than the state
+static int draw_savestate_thumb(const char *fname)
+{
+	static u16 t[STATE_THUMB_W * STATE_THUMB_H];
+	char pname[MAXPATHLEN + 4];
+	struct stat st, pst;
+	int x, y, k, i, j;
+	u16 *d;
+
+	snprintf(pname, sizeof(pname), "%s.png", fname);
+	if (stat(fname, &st) != 0 || stat(pname, &pst) != 0
+	    || pst.st_mtime < st.st_mtime)
+		return 0;
+	if (readpng(t, pname, READPNG_BG, STATE_THUMB_W, STATE_THUMB_H) != 0)
+		return 0;
+
+	k = min(g_menuscreen_w / 2 / STATE_THUMB_W, g_menuscreen_h / STATE_THUMB_H);
+	k = max(k, 1);
+	x = max(0, g_menuscreen_w - STATE_THUMB_W * k) & ~3;
+	y = max(0, g_menuscreen_h / 2 - STATE_THUMB_H * k / 2);
+	memcpy(g_menubg_ptr, g_menubg_src_ptr, g_menuscreen_w * g_menuscreen_h * 2);
+	for (j = 0; j < STATE_THUMB_H * k && y + j < g_menuscreen_h; j++) {
+		d = (u16 *)g_menubg_ptr + g_menuscreen_w * (y + j) + x;
+		for (i = 0; i < STATE_THUMB_W * k && x + i < g_menuscreen_w; i++)
+			d[i] = t[(j / k) * STATE_THUMB_W + i / k];
+	}
+	return 1;
+}
+
 // a bit of black magic here
 static void draw_savestate_bg(int slot)
 {
@@ -805,6 +1025,8 @@ static void draw_savestate_bg(int slot)
 	ret = get_state_filename(fname, sizeof(fname), slot);
 	if (ret != 0)
 		return;
+	if (draw_savestate_thumb(fname))
+		return;
 
 	f = gzopen(fname, "rb");
 	if (f == NULL)
@@ -922,6 +1144,11 @@ me_bind_action emuctrl_actions[] =
 	{ "Volume Down      ", 1 << SACTION_VOLUME_DOWN },
 #endif
 	{ "Analog toggle    ", 1 << SACTION_ANALOG_TOGGLE },
+	{ "Rewind           ", 1 << SACTION_REWIND },
+	{ "GPU record       ", 1 << SACTION_GPU_RECORD },
+#ifdef USE_EVTRACE
+	{ "Event trace      ", 1 << SACTION_EVENT_TRACE },
+#endif
 	{ NULL,                0 }
 };
 
@@ -1440,14 +1667,24 @@ static const char h_gpu_neon_enhanced_hack[] =
 	"Speed hack for above option (glitches some games)";
 static const char h_gpu_neon_enhanced_texadj[] =
 	"Solves some Enh. res. texture issues, some perf hit";
-static const char *men_gpu_interlace[] = { "Off", "On", "Auto", NULL };
+static const char *men_gpu_interlace[] = { "Off", "On", "Auto", "Fields", NULL };
+static const char h_gpu_interlace[] =
+	"Fields: only draw the lines of the field that's\n"
+	"shown next (faster), except when the game reads them";
+#ifdef USE_ASYNC_GPU
+static const char h_gpu_bands[] =
+	"Splits the screen between this many threads";
+#endif
 
 static menu_entry e_menu_plugin_gpu_neon[] =
 {
 	mee_onoff_h   ("Enhanced resolution",        0, pl_rearmed_cbs.gpu_neon.enhancement_enable, 1, h_gpu_neon_enhanced),
 	mee_onoff_h   ("Enhanced res. speed hack",   0, pl_rearmed_cbs.gpu_neon.enhancement_no_main, 1, h_gpu_neon_enhanced_hack),
 	mee_onoff_h   ("Enh. res. texture adjust",   0, pl_rearmed_cbs.gpu_neon.enhancement_tex_adj, 1, h_gpu_neon_enhanced_texadj),
-	mee_enum      ("Enable interlace mode",      0, pl_rearmed_cbs.gpu_neon.allow_interlace, men_gpu_interlace),
+	mee_enum_h    ("Enable interlace mode",      0, pl_rearmed_cbs.gpu_neon.allow_interlace, men_gpu_interlace, h_gpu_interlace),
+#ifdef USE_ASYNC_GPU
+	mee_range_h   ("Rendering threads",          0, pl_rearmed_cbs.gpu_neon.render_bands, 1, 4, h_gpu_bands),
+#endif
 	mee_end,
 };
 
@@ -1455,9 +1692,13 @@ static menu_entry e_menu_plugin_gpu_unai[] =
 {
 	mee_onoff     ("Old renderer",               0, pl_rearmed_cbs.gpu_unai.old_renderer, 1),
 	mee_onoff     ("Skip every 2nd line",        0, pl_rearmed_cbs.gpu_unai.ilace_force, 1),
+	mee_enum_h    ("Enable interlace mode",      0, pl_rearmed_cbs.gpu_neon.allow_interlace, men_gpu_interlace, h_gpu_interlace),
 	mee_onoff     ("Lighting",                   0, pl_rearmed_cbs.gpu_unai.lighting, 1),
 	mee_onoff     ("Fast lighting",              0, pl_rearmed_cbs.gpu_unai.fast_lighting, 1),
 	mee_onoff     ("Blending",                   0, pl_rearmed_cbs.gpu_unai.blending, 1),
+#ifdef USE_ASYNC_GPU
+	mee_range_h   ("Rendering threads",          0, pl_rearmed_cbs.gpu_unai.render_bands, 1, 4, h_gpu_bands),
+#endif
 	mee_end,
 };
 
@@ -1500,6 +1741,10 @@ static menu_entry e_menu_plugin_gpu_peopsgl[] =
 	mee_onoff     ("Use Fast Mdec",              0, pl_rearmed_cbs.gpu_peopsgl.bUseFastMdec, 1),
 	mee_range     ("Texture RAM size (MB)",      0, pl_rearmed_cbs.gpu_peopsgl.iVRamSize, 4, 128),
 	mee_onoff     ("Texture garbage collection", 0, pl_rearmed_cbs.gpu_peopsgl.iTexGarbageCollection, 1),
+	mee_onoff     ("Keep re-uploaded textures",  0, pl_rearmed_cbs.gpu_peopsgl.iTexContentHash, 1),
+	mee_onoff     ("Texture conversion thread",  0, pl_rearmed_cbs.gpu_peopsgl.iTexConvThread, 1),
+	mee_onoff     ("Render to offscreen FBO",    0, pl_rearmed_cbs.gpu_peopsgl.iUseFBO, 1),
+	mee_onoff     ("GL render thread",           0, pl_rearmed_cbs.gpu_peopsgl.iGLThread, 1),
 	mee_label     ("Fixes/hacks:"),
 	mee_onoff     ("FF7 cursor",                 0, pl_rearmed_cbs.gpu_peopsgl.dwActFixes, 1<<0),
 	mee_onoff     ("Direct FB updates",          0, pl_rearmed_cbs.gpu_peopsgl.dwActFixes, 1<<1),
@@ -1519,6 +1764,9 @@ static const char *men_spu_interp[] = { "None", "Simple", "Gaussian", "Cubic", N
 static const char h_spu_volboost[]  = "Large values cause distortion";
 static const char h_spu_tempo[]     = "Slows down audio if emu is too slow\n"
 				      "This is inaccurate and breaks games";
+static const char *men_spu_rate[]   = { "44100", "48000", NULL };
+static const char h_spu_rate[]      = "48000 avoids resampling in the system mixer\n"
+				      "on devices that run it at 48kHz";
 
 static menu_entry e_menu_plugin_spu[] =
 {
@@ -1527,6 +1775,7 @@ static menu_entry e_menu_plugin_spu[] =
 	mee_enum      ("Interpolation",             0, spu_config.iUseInterpolation, men_spu_interp),
 	//mee_onoff     ("Adjust XA pitch",           0, spu_config.iXAPitch, 1),
 	mee_onoff_h   ("Adjust tempo",              0, spu_config.iTempo, 1, h_spu_tempo),
+	mee_enum_h    ("Output rate",               0, out_rate_sel, men_spu_rate, h_spu_rate),
 	mee_end,
 };
 
@@ -1574,6 +1823,8 @@ static const char h_plugin_spu[] = ""
 #endif
 ;
 static const char h_sputhr[]     = "Warning: has some known bugs\n";
+static const char h_gputhr_frm[] = "Shows each frame one frame later for\n"
+				   "better use of the GPU thread";
 // static const char h_gpu_peops[]  = "Configure P.E.Op.S. SoftGL Driver V1.17";
 // static const char h_gpu_peopsgl[]= "Configure P.E.Op.S. MesaGL Driver V1.78";
 // static const char h_gpu_unai[]   = "Configure Unai/PCSX4ALL Team plugin (new)";
@@ -1610,6 +1861,7 @@ static menu_entry e_menu_plugin_options[] =
 	mee_enum_h    ("GPU plugin",                    0, gpu_plugsel, gpu_plugins, h_plugin_gpu),
 #ifdef USE_ASYNC_GPU
 	mee_onoff     ("GPU multithreading",            0, pl_rearmed_cbs.thread_rendering, 1),
+	mee_onoff_h   ("GPU thread frame queue",        0, pl_rearmed_cbs.thread_frames, 1, h_gputhr_frm),
 #endif
 	mee_enum      ("GPU dithering",                 0, pl_rearmed_cbs.dithering, men_gpu_dithering),
 	mee_enum_h    ("SPU plugin",                    0, spu_plugsel, spu_plugins, h_plugin_spu),
@@ -1626,6 +1878,7 @@ static menu_entry e_menu_main2[];
 static int menu_loop_plugin_options(int id, int keys)
 {
 	static int sel = 0;
+	scan_plugins();
 	slowboot_sel = Config.SlowBoot;
 #ifndef C64X_DSP
 	me_enable(e_menu_plugin_options, MA_OPT_SPU_THREAD, spu_config.iThreadAvail);
@@ -1649,6 +1902,12 @@ static const char h_cfg_noch[]    = "Disables game-specific compatibility hacks"
 static const char h_cfg_nosmc[]   = "Will cause crashes when loading, break memcards";
 static const char h_cfg_gteunn[]  = "May cause graphical glitches";
 static const char h_cfg_gteflgs[] = "Will cause graphical glitches";
+static const char h_cfg_lazycc[]  = "Checks for events only on backward branches and block\n"
+				    "exits, interrupts may come a bit late";
+static const char h_cfg_tier[]    = "Runs code in the interpreter until it was used a few\n"
+				    "times, less recompiling in games that stream code";
+static const char h_cfg_bprof[]   = "Counts how often each block is entered, written to\n"
+				    "ndrc_profile.txt on exit";
 #endif
 static const char h_cfg_stalls[]  = "Will cause some games to run too fast";
 
@@ -1659,6 +1918,9 @@ static menu_entry e_menu_speed_hacks[] =
 	mee_onoff_h   ("Disable SMC checks",       0, ndrc_g.hacks, NDHACK_NO_SMC_CHECK, h_cfg_nosmc),
 	mee_onoff_h   ("Assume GTE regs unneeded", 0, ndrc_g.hacks, NDHACK_GTE_UNNEEDED, h_cfg_gteunn),
 	mee_onoff_h   ("Disable GTE flags",        0, ndrc_g.hacks, NDHACK_GTE_NO_FLAGS, h_cfg_gteflgs),
+	mee_onoff_h   ("Fewer event checks",       0, ndrc_g.hacks, NDHACK_LAZY_CC, h_cfg_lazycc),
+	mee_onoff_h   ("Interpret cold code",      0, ndrc_g.hacks, NDHACK_TIERING, h_cfg_tier),
+	mee_onoff_h   ("Profile blocks",           0, ndrc_g.hacks, NDHACK_BLOCK_PROFILE, h_cfg_bprof),
 #endif
 	mee_onoff_h   ("Disable CPU/GTE stalls",   0, menu_iopts[0], 1, h_cfg_stalls),
 	mee_end,
@@ -1673,11 +1935,64 @@ static int menu_loop_speed_hacks(int id, int keys)
 	return 0;
 }
 
+#ifdef HAVE_RTHREADS
+static const char *men_tplace[] = { "Off", "Auto", NULL };
+static const char *men_tprio[]  = { "Normal", "Nice", "Realtime", NULL };
+static const char *men_tcpu[]   = { "Auto", "Free", "CPU 0", "CPU 1", "CPU 2",
+				    "CPU 3", "CPU 4", "CPU 5", "CPU 6", "CPU 7", NULL };
+static const char h_thr_place[] = "Auto pins emulation to the fastest core, gpu and\n"
+				  "spu to the next ones and keeps the rest off them;\n"
+				  "Off leaves it all to the OS (Linux only)";
+static const char h_thr_prio[]  = "Nice raises emu/gpu/spu and lowers background work,\n"
+				  "Realtime uses SCHED_FIFO, both may need permissions";
+static const char h_thr_cpu[]   = "Free lets the OS decide. Helper threads pick this\n"
+				  "up when started next, usually on game load";
+static const char h_thr_jobs[]  = "Shared workers for split up work (MDEC for now),\n"
+				  "0: one less than the cores. Applies on restart";
+
+static menu_entry e_menu_threads[] =
+{
+	mee_enum_h    ("Thread placement", 0, pcsxr_tpolicy.enable, men_tplace, h_thr_place),
+	mee_enum_h    ("Thread priorities",0, pcsxr_tpolicy.prio, men_tprio, h_thr_prio),
+	mee_enum_h    ("Emulation",        0, pcsxr_tpolicy.cpu[PCSXRT_EMU], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("GPU",              0, pcsxr_tpolicy.cpu[PCSXRT_GPU], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("GPU bands",        0, pcsxr_tpolicy.cpu[PCSXRT_GPU_BAND], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("SPU",              0, pcsxr_tpolicy.cpu[PCSXRT_SPU], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("SPU helpers",      0, pcsxr_tpolicy.cpu[PCSXRT_SPU_HELPER], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("Dynarec",          0, pcsxr_tpolicy.cpu[PCSXRT_DRC], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("CD-ROM",           0, pcsxr_tpolicy.cpu[PCSXRT_CDR], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("MDEC",             0, pcsxr_tpolicy.cpu[PCSXRT_MDEC], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("Memory cards",     0, pcsxr_tpolicy.cpu[PCSXRT_MCD], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("Savestates",       0, pcsxr_tpolicy.cpu[PCSXRT_STATE], men_tcpu, h_thr_cpu),
+	mee_enum_h    ("Job workers",      0, pcsxr_tpolicy.cpu[PCSXRT_JOB], men_tcpu, h_thr_cpu),
+	mee_range_h   ("Job worker count", 0, pcsxr_tpolicy.jobs, 0, PCSXR_JOB_WORKERS_MAX, h_thr_jobs),
+	mee_end,
+};
+
+static int menu_loop_threads(int id, int keys)
+{
+	static int sel = 0;
+	me_loop(e_menu_threads, &sel);
+	return 0;
+}
+#endif
+
 static const char *men_autooo[]  = { "Auto", "Off", "On", NULL };
+static const char *men_scomp[]   = { "Fast", "Small", "None", NULL };
 
 static const char h_cfg_cpul[]   = "Shows CPU usage in %";
 static const char h_cfg_spu[]    = "Shows active SPU channels\n"
-				   "(green: normal, red: fmod, blue: noise)";
+				   "(green: normal, red: fmod, blue: noise)\n"
+				   "and SPU time per frame in microseconds";
+static const char h_cfg_perf[]   = "Graph of the last 240 frames: emu (white), gpu (green),\n"
+				   "spu (yellow), cd (red), blit (blue), present (cyan)\n"
+				   "and gpu thread dots, averages in 0.1ms units;\n"
+				   "helper thread wakeups per frame at the top;\n"
+				   "every frame is also logged to $PCSX_PERF_CSV";
+static const char h_cfg_drc[]    = "Dynarec activity per second at the top: compiled\n"
+				   "blocks and KB, invalidated blocks by smc/dma/reload,\n"
+				   "restored blocks, hash lookups/misses/evictions,\n"
+				   "compile thread waits and translation cache fill";
 static const char h_cfg_fl[]     = "Frame Limiter keeps the game from running too fast";
 static const char h_cfg_xa[]     = "Disables XA sound, which can sometimes improve performance";
 static const char h_cfg_cdda[]   = "Disable CD Audio for a performance boost\n"
@@ -1690,35 +2005,80 @@ static const char h_cfg_shacks[] = "Breaks games but may give better performance
 static const char h_cfg_icache[] = "Support F1 games (only when dynarec is off)";
 static const char h_cfg_exc[]    = "Emulate some PSX's debug hw like breakpoints\n"
 				   "and exceptions (slow, interpreter only, keep off)";
+static const char h_cfg_pdint[]  = "Cache decoded instructions when the interpreter\n"
+				   "is used (faster, not used with BP emulation)";
 static const char h_cfg_gpul[]   = "Try enabling this if the game misses some graphics\n"
 				   "causes a performance hit";
 static const char h_cfg_ffps[]   = "Instead of 50/60fps for PAL/NTSC use ~49.75/59.81\n"
 				   "Closer to real hw but doesn't match modern displays.";
 static const char h_cfg_tcd[]    = "Greatly reduce CD load times. Breaks some games.";
+static const char h_cfg_mdect[]  = "Splits video decoding between this many threads";
+static const char h_cfg_cdpre[]  = "Read the whole disc into RAM in the background,\n"
+				    "needs as much free memory as the image size";
+static const char h_cfg_membud[] = "Low memory mode, 0 is off. Caps the dynarec\n"
+				   "cache at 1/4 (needs a restart), CD read-ahead\n"
+				   "at 1/8, no CD preload unless it fits in 1/2";
+static const char h_cfg_rwmb[]   = "Memory for the rewind history, 0 disables rewind\n"
+				   "(bind the \"Rewind\" key in Controls)";
+static const char h_cfg_rwint[]  = "Frames between rewind snapshots, lower is\n"
+				   "finer but holds less history and costs more CPU";
+static const char h_cfg_gpurec[] = "Frames the \"GPU record\" key captures into\n"
+				   "screenshots/, for the gpulib renderer benchmark";
+static const char h_cfg_scomp[]  = "Fast saves quickly into slightly bigger files,\n"
+				   "all kinds of states load regardless of this";
+static const char h_cfg_sthumb[] = "Save a small preview next to each savestate,\n"
+				   "shown in the save/load menus";
+static const char h_cfg_bsnap[]  = "Cache the machine state after the BIOS boot of\n"
+				   "each game and start from it next time\n"
+				   "(not done with the BIOS intro enabled)";
 static const char h_cfg_psxclk[]  = "Over/under-clock the PSX, default is " DEFAULT_PSX_CLOCK_S "\n"
 				    "(adjust this if the game is too slow/too fast/hangs)";
+static const char h_cfg_cpuboost[] = "Overclock the PSX only while the game drops\n"
+				    "frames and there is CPU time to spare";
 
-enum { AMO_XA, AMO_CDDA, AMO_IC, AMO_BP, AMO_CPU, AMO_GPUL, AMO_FFPS, AMO_TCD };
+enum { AMO_XA, AMO_CDDA, AMO_IC, AMO_BP, AMO_PD, AMO_CPU, AMO_GPUL, AMO_FFPS, AMO_TCD, AMO_SCOMP, AMO_MDECT };
 
 static menu_entry e_menu_adv_options[] =
 {
 	mee_onoff_h   ("Show CPU load",          0, g_opts, OPT_SHOWCPU, h_cfg_cpul),
 	mee_onoff_h   ("Show SPU channels",      0, g_opts, OPT_SHOWSPU, h_cfg_spu),
+	mee_onoff_h   ("Show frame time graph",  0, g_opts, OPT_SHOWPERF, h_cfg_perf),
+#ifndef DRC_DISABLE
+	mee_onoff_h   ("Show dynarec stats",     0, g_opts, OPT_SHOWDRC, h_cfg_drc),
+#endif
 	mee_onoff_h   ("Disable Frame Limiter",  0, g_opts, OPT_NO_FRAMELIM, h_cfg_fl),
 	mee_onoff_h   ("Disable XA Decoding",    0, menu_iopts[AMO_XA],   1, h_cfg_xa),
 	mee_onoff_h   ("Disable CD Audio",       0, menu_iopts[AMO_CDDA], 1, h_cfg_cdda),
 	mee_onoff_h   ("ICache emulation",       0, menu_iopts[AMO_IC],   1, h_cfg_icache),
 	mee_onoff_h   ("BP exception emulation", 0, menu_iopts[AMO_BP],   1, h_cfg_exc),
+	mee_onoff_h   ("Predecoded interpreter", 0, menu_iopts[AMO_PD],   1, h_cfg_pdint),
 	mee_enum_h    ("GPU l-list slow walking",0, menu_iopts[AMO_GPUL], men_autooo, h_cfg_gpul),
 	mee_enum_h    ("Fractional framerate",   0, menu_iopts[AMO_FFPS], men_autooo, h_cfg_ffps),
 	mee_onoff_h   ("Turbo CD-ROM ",          0, menu_iopts[AMO_TCD], 1, h_cfg_tcd),
+#ifdef USE_ASYNC_MDEC
+	mee_range_h   ("MDEC decode threads",    0, menu_iopts[AMO_MDECT], 1, 4, h_cfg_mdect),
+#endif
+	mee_enum_h    ("Savestate compression",  0, menu_iopts[AMO_SCOMP], men_scomp, h_cfg_scomp),
+#ifdef USE_ASYNC_SAVESTATE
+	mee_onoff_h   ("Savestate thumbnails",   0, g_opts, OPT_STATE_THUMB, h_cfg_sthumb),
+#endif
+	mee_onoff_h   ("Fast boot snapshots",    0, g_opts, OPT_BOOT_SNAP, h_cfg_bsnap),
 #ifdef USE_ASYNC_CDROM
 	mee_range     ("CD-ROM read-ahead",      0, cd_buf_count, 0, 1024),
+	mee_onoff_h   ("CD-ROM preload to RAM",  0, cd_preload, 1, h_cfg_cdpre),
 #endif
 #if !defined(DRC_DISABLE) || defined(LIGHTREC)
 	mee_onoff_h   ("Disable dynarec (slow!)",0, menu_iopts[AMO_CPU],  1, h_cfg_nodrc),
 #endif
 	mee_range_h   ("PSX CPU clock, %",       0, psx_clock, 1, 500, h_cfg_psxclk),
+	mee_onoff_h   ("Adaptive PSX CPU clock", 0, g_opts, OPT_CPU_BOOST, h_cfg_cpuboost),
+	mee_range_h   ("Memory budget, MB",      0, Config.MemBudgetMB, 0, 256, h_cfg_membud),
+	mee_range_h   ("Rewind buffer, MB",      0, rewind_mb, 0, 256, h_cfg_rwmb),
+	mee_range_h   ("Rewind interval",        0, rewind_interval, 1, 60, h_cfg_rwint),
+	mee_range_h   ("GPU record frames",      0, gpu_rec_frames, 1, 600, h_cfg_gpurec),
+#ifdef HAVE_RTHREADS
+	mee_handler   ("[Threads]",                 menu_loop_threads),
+#endif
 	mee_handler_h ("[Speed hacks]",             menu_loop_speed_hacks, h_cfg_shacks),
 	mee_end,
 };
@@ -1734,14 +2094,18 @@ static int menu_loop_adv_options(int id, int keys)
 		{ &Config.Cdda,    &menu_iopts[AMO_CDDA] },
 		{ &Config.icache_emulation, &menu_iopts[AMO_IC] },
 		{ &Config.PreciseExceptions, &menu_iopts[AMO_BP] },
+		{ &Config.PredecodeInt, &menu_iopts[AMO_PD] },
 		{ &Config.Cpu,     &menu_iopts[AMO_CPU] },
 		{ &Config.TurboCD, &menu_iopts[AMO_TCD] },
+		{ &Config.MdecThreads, &menu_iopts[AMO_MDECT] },
 	};
+	int mem_budget = Config.MemBudgetMB;
 	int i;
 	for (i = 0; i < ARRAY_SIZE(opts); i++)
 		*opts[i].mopt = *opts[i].opt;
 	menu_iopts[AMO_GPUL] = Config.GpuListWalking + 1;
 	menu_iopts[AMO_FFPS] = Config.FractionalFramerate + 1;
+	menu_iopts[AMO_SCOMP] = Config.StateCompression;
 
 	me_loop(e_menu_adv_options, &sel);
 
@@ -1749,7 +2113,13 @@ static int menu_loop_adv_options(int id, int keys)
 		*opts[i].opt = *opts[i].mopt;
 	Config.GpuListWalking = menu_iopts[AMO_GPUL] - 1;
 	Config.FractionalFramerate = menu_iopts[AMO_FFPS] - 1;
+	Config.StateCompression = menu_iopts[AMO_SCOMP];
+	if (mem_budget != Config.MemBudgetMB)
+		cdra_apply_mem_budget();
 	cdra_set_buf_count(cd_buf_count);
+	cdra_set_preload(cd_preload);
+	if (rewind_init(rewind_mb << 20) != 0)
+		rewind_mb = 0;
 
 	return 0;
 }
@@ -2125,6 +2495,7 @@ static int reload_plugins(const char *cdimg)
 {
 	pl_vout_buf = NULL;
 
+	emu_save_drc_cache();
 	ClosePlugins();
 
 	set_cd_image(cdimg);
@@ -2212,7 +2583,9 @@ static int run_cd_image(const char *fname)
 	fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling reload_plugins\n");
 	fflush(stderr);
 	ready_to_go = 0;
+	emu_startup_mark("game selected");
 	reload_plugins(fname);
+	emu_startup_mark("plugins reload");
 
 	// always autodetect, menu_sync_config will override as needed
 	Config.PsxAuto = 1;
@@ -2225,21 +2598,28 @@ static int run_cd_image(const char *fname)
 		menu_update_msg("unsupported/invalid CD image");
 		return -1;
 	}
+	emu_startup_mark("CheckCdrom");
 	if (ppfname)
 		BuildPPFCache(ppfname);
 
-	fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling SysReset\n");
-	fflush(stderr);
-	SysReset();
+	// a patched image boots differently, don't let it share the snapshot
+	if (ppfname || emu_boot_snap_load() != 0) {
+		fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling SysReset\n");
+		fflush(stderr);
+		SysReset();
 
-	// Read main executable directly from CDRom and start it
-	fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling LoadCdrom\n");
-	fflush(stderr);
-	if (LoadCdrom() == -1) {
-		ClosePlugins();
-		menu_update_msg("failed to load CD image");
-		return -1;
+		// Read main executable directly from CDRom and start it
+		fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling LoadCdrom\n");
+		fflush(stderr);
+		if (LoadCdrom() == -1) {
+			ClosePlugins();
+			menu_update_msg("failed to load CD image");
+			return -1;
+		}
+		if (!ppfname)
+			emu_boot_snap_save();
 	}
+	emu_startup_mark("reset (bios, exe)");
 
 	fprintf(stderr, "PCSX_DEBUG: run_cd_image() calling emu_on_new_cd\n");
 	fflush(stderr);
@@ -2248,6 +2628,10 @@ static int run_cd_image(const char *fname)
 	fprintf(stderr, "PCSX_DEBUG: run_cd_image() SUCCESS\n");
 	fflush(stderr);
 
+	// a suspended session that got killed beats the autoload
+	if (emu_suspend_load() == 0)
+		return 0;
+
 	if (autoload_state) {
 		unsigned int newest = 0;
 		int time = 0, slot, newest_slot = -1;
@@ -2273,6 +2657,8 @@ static int run_cd_image(const char *fname)
 	return 0;
 }
 
+static int have_game_config;
+
 int menu_load_cd_image(const char *fname)
 {
 	int prev_gpu, prev_spu;
@@ -2282,7 +2668,8 @@ int menu_load_cd_image(const char *fname)
 
 	prev_gpu = gpu_plugsel;
 	prev_spu = spu_plugsel;
-	if (menu_load_config(1) != 0)
+	have_game_config = menu_load_config(1) == 0;
+	if (!have_game_config)
 		menu_load_config(0);
 
 	// check for plugin changes, have to repeat
@@ -2298,6 +2685,73 @@ int menu_load_cd_image(const char *fname)
 	return 0;
 }
 
+int menu_have_game_config(void)
+{
+	return have_game_config;
+}
+
+// -autotune: each step trades a bit more accuracy for speed than the last,
+// all of them start from the settings that were loaded for the game
+static struct {
+	int frameskip, thread_rendering, interp, psx_clock, cd_buf_count;
+} autotune_base;
+
+static int autotune_apply(int step, int measuring)
+{
+	if (step == 0) {
+		autotune_base.frameskip = frameskip;
+		autotune_base.thread_rendering = pl_rearmed_cbs.thread_rendering;
+		autotune_base.interp = spu_config.iUseInterpolation;
+		autotune_base.psx_clock = psx_clock;
+		autotune_base.cd_buf_count = cd_buf_count;
+	}
+	else if (step > 4)
+		return -1;
+
+	frameskip = autotune_base.frameskip;
+	pl_rearmed_cbs.thread_rendering = autotune_base.thread_rendering;
+	spu_config.iUseInterpolation = autotune_base.interp;
+	psx_clock = autotune_base.psx_clock;
+	cd_buf_count = autotune_base.cd_buf_count;
+
+	if (step >= 1) {
+		pl_rearmed_cbs.thread_rendering = 1;
+		if (cd_buf_count == 0)
+			cd_buf_count = 16;
+	}
+	if (step >= 2 && spu_config.iUseInterpolation > 1)
+		spu_config.iUseInterpolation = 1;
+	// auto frameskip does nothing without the frame limiter,
+	// so measure with one skipped frame and save it as "Auto"
+	if (step >= 3 && frameskip < 2)
+		frameskip = measuring ? 2 : 0;
+	if (step >= 4 && psx_clock > DEFAULT_PSX_CLOCK * 3 / 4)
+		psx_clock = DEFAULT_PSX_CLOCK * 3 / 4;
+
+	cdra_set_buf_count(cd_buf_count);
+	menu_sync_config();
+	psxCpu->ApplyConfig();
+	plugin_call_rearmed_cbs();
+
+	printf("autotune step %d: frameskip %d, gpu thread %d, interpolation %d, "
+		"psx clock %d, cd read-ahead %d\n", step, frameskip - 1,
+		pl_rearmed_cbs.thread_rendering, spu_config.iUseInterpolation,
+		psx_clock, cd_buf_count);
+	return 0;
+}
+
+int menu_autotune_step(int step)
+{
+	return autotune_apply(step, 1);
+}
+
+int menu_autotune_save(int step)
+{
+	if (autotune_apply(step, 0) != 0)
+		return -1;
+	return menu_write_config(1);
+}
+
 static int romsel_run(void)
 {
 	const char *fname;
@@ -2310,6 +2764,7 @@ static int romsel_run(void)
 
 	printf("selected file: %s\n", fname);
 
+	emu_save_drc_cache();
 	ndrc_clear_full();
 
 	return menu_load_cd_image(fname);
@@ -2520,6 +2975,8 @@ void menu_loop(void)
 	me_enable(e_menu_main, MA_MAIN_SAVE_STATE,  ready_to_go && CdromId[0]);
 	me_enable(e_menu_main, MA_MAIN_LOAD_STATE,  ready_to_go && CdromId[0]);
 	me_enable(e_menu_main, MA_MAIN_RESET_GAME,  ready_to_go);
+	if (ready_to_go)
+		emu_load_cwcheats();
 	me_enable(e_menu_main, MA_MAIN_CHEATS,      ready_to_go && NumCheats);
 
 	in_set_config_int(0, IN_CFG_BLOCKING, 1);
@@ -2544,32 +3001,31 @@ static int qsort_strcmp(const void *p1, const void *p2)
 	return strcasecmp(*s1, *s2);
 }
 
-static void scan_bios_plugins(void)
+// dlopen()ing every .so is slow, so this waits until the plugin menu
+// or a config naming an external plugin needs the list
+static void scan_plugins(void)
 {
+#ifndef NO_DYLIB
+	static int scanned;
 	char fname[MAXPATHLEN];
 	struct dirent *ent;
-	int bios_i, gpu_i, spu_i, mc_i;
+	int gpu_i = 1, spu_i = 1;
 	DIR *dir;
 
-	bioses[0] = "HLE";
-	gpu_plugins[0] = "builtin_gpu";
-	spu_plugins[0] = "builtin_spu";
-	memcards[0] = "(none)";
-	bios_i = gpu_i = spu_i = mc_i = 1;
+	if (scanned)
+		return;
+	scanned = 1;
 
-	snprintf(fname, sizeof(fname), "%s/", Config.BiosDir);
+	snprintf(fname, sizeof(fname), "%s/", Config.PluginsDir);
 	dir = opendir(fname);
 	if (dir == NULL) {
-		perror("scan_bios_plugins bios opendir");
-#ifndef NO_DYLIB
-		goto do_plugins;
-#else
-		goto do_memcards;
-#endif
+		perror("scan_plugins opendir");
+		return;
 	}
 
 	while (1) {
-		struct stat st;
+		void *h, *tmp;
+		char *p;
 
 		errno = 0;
 		ent = readdir(dir);
@@ -2578,39 +3034,64 @@ static void scan_bios_plugins(void)
 				perror("readdir");
 			break;
 		}
+		p = strstr(ent->d_name, ".so");
+		if (p == NULL)
+			continue;
 
-		if (ent->d_type != DT_REG && ent->d_type != DT_LNK)
+		snprintf(fname, sizeof(fname), "%s/%s", Config.PluginsDir, ent->d_name);
+		h = dlopen(fname, RTLD_LAZY | RTLD_LOCAL);
+		if (h == NULL) {
+			fprintf(stderr, "%s\n", dlerror());
 			continue;
+		}
 
-		snprintf(fname, sizeof(fname), "%s/%s", Config.BiosDir, ent->d_name);
-		if (stat(fname, &st) != 0
-		    || (st.st_size != 512*1024 && st.st_size != 4*1024*1024)) {
-			printf("bad BIOS file: %s\n", ent->d_name);
+		// now what do we have here?
+		tmp = dlsym(h, "GPUinit");
+		if (tmp) {
+			dlclose(h);
+			if (gpu_i < ARRAY_SIZE(gpu_plugins) - 1)
+				gpu_plugins[gpu_i++] = strdup(ent->d_name);
 			continue;
 		}
 
-		if (bios_i < ARRAY_SIZE(bioses) - 1) {
-			bioses[bios_i++] = strdup(ent->d_name);
+		tmp = dlsym(h, "SPUinit");
+		if (tmp) {
+			dlclose(h);
+			if (spu_i < ARRAY_SIZE(spu_plugins) - 1)
+				spu_plugins[spu_i++] = strdup(ent->d_name);
 			continue;
 		}
 
-		printf("too many BIOSes, dropping \"%s\"\n", ent->d_name);
+		fprintf(stderr, "ignoring unidentified plugin: %s\n", fname);
+		dlclose(h);
 	}
 
 	closedir(dir);
+#endif
+}
 
-#ifndef NO_DYLIB
-do_plugins:
-	snprintf(fname, sizeof(fname), "%s/", Config.PluginsDir);
+static void scan_bios_plugins(void)
+{
+	char fname[MAXPATHLEN];
+	struct dirent *ent;
+	int bios_i, mc_i;
+	DIR *dir;
+
+	bioses[0] = "HLE";
+	gpu_plugins[0] = "builtin_gpu";
+	spu_plugins[0] = "builtin_spu";
+	memcards[0] = "(none)";
+	bios_i = mc_i = 1;
+
+	snprintf(fname, sizeof(fname), "%s/", Config.BiosDir);
 	dir = opendir(fname);
 	if (dir == NULL) {
-		perror("scan_bios_plugins plugins opendir");
+		perror("scan_bios_plugins bios opendir");
 		goto do_memcards;
 	}
 
 	while (1) {
-		void *h, *tmp;
-		char *p;
+		struct stat st;
 
 		errno = 0;
 		ent = readdir(dir);
@@ -2619,40 +3100,26 @@ do_plugins:
 				perror("readdir");
 			break;
 		}
-		p = strstr(ent->d_name, ".so");
-		if (p == NULL)
-			continue;
 
-		snprintf(fname, sizeof(fname), "%s/%s", Config.PluginsDir, ent->d_name);
-		h = dlopen(fname, RTLD_LAZY | RTLD_LOCAL);
-		if (h == NULL) {
-			fprintf(stderr, "%s\n", dlerror());
+		if (ent->d_type != DT_REG && ent->d_type != DT_LNK)
 			continue;
-		}
 
-		// now what do we have here?
-		tmp = dlsym(h, "GPUinit");
-		if (tmp) {
-			dlclose(h);
-			if (gpu_i < ARRAY_SIZE(gpu_plugins) - 1)
-				gpu_plugins[gpu_i++] = strdup(ent->d_name);
+		snprintf(fname, sizeof(fname), "%s/%s", Config.BiosDir, ent->d_name);
+		if (stat(fname, &st) != 0
+		    || (st.st_size != 512*1024 && st.st_size != 4*1024*1024)) {
+			printf("bad BIOS file: %s\n", ent->d_name);
 			continue;
 		}
 
-		tmp = dlsym(h, "SPUinit");
-		if (tmp) {
-			dlclose(h);
-			if (spu_i < ARRAY_SIZE(spu_plugins) - 1)
-				spu_plugins[spu_i++] = strdup(ent->d_name);
+		if (bios_i < ARRAY_SIZE(bioses) - 1) {
+			bioses[bios_i++] = strdup(ent->d_name);
 			continue;
 		}
 
-		fprintf(stderr, "ignoring unidentified plugin: %s\n", fname);
-		dlclose(h);
+		printf("too many BIOSes, dropping \"%s\"\n", ent->d_name);
 	}
 
 	closedir(dir);
-#endif
 
 do_memcards:
 	emu_make_path(fname, sizeof(fname), MEMCARD_DIR, NULL);
@@ -2848,6 +3315,7 @@ void menu_prepare_emu(void)
 		if (ret)
 			fprintf(stderr, "Warning: GPU_open returned %d\n", ret);
 	}
+	emu_startup_mark("gpu open");
 	fprintf(stderr, "PCSX_DEBUG: menu_prepare_emu() DONE\n");
 	fflush(stderr);
 }
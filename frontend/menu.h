@@ -9,6 +9,9 @@ void menu_finish(void);
 void menu_notify_mode_change(int w, int h, int bpp);
 int  menu_load_cd_image(const char *fname);
 int  menu_load_config(int is_game);
+int  menu_have_game_config(void);
+int  menu_autotune_step(int step);
+int  menu_autotune_save(int step);
 
 enum g_opts_opts {
 	OPT_SHOWFPS = 1 << 0,
@@ -17,6 +20,11 @@ enum g_opts_opts {
 	OPT_SHOWSPU = 1 << 3,
 	OPT_TSGUN_NOTRIGGER = 1 << 4,
 	OPT_VSYNC = 1 << 5,
+	OPT_STATE_THUMB = 1 << 6,
+	OPT_SHOWPERF = 1 << 7,
+	OPT_BOOT_SNAP = 1 << 8,
+	OPT_SHOWDRC = 1 << 9,
+	OPT_CPU_BOOST = 1 << 10,
 };
 
 enum g_scaler_opts {
@@ -35,6 +43,8 @@ enum g_soft_filter_opts {
 };
 
 extern int g_opts, g_scaler, g_gamma;
+extern int rewind_mb, rewind_interval;
+extern int gpu_rec_frames;
 extern int scanlines, scanline_level;
 extern int soft_scaling, analog_deadzone;
 extern int soft_filter;
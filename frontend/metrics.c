@@ -0,0 +1,220 @@
+/*
+ * Metrics endpoint, see metrics.h
+ *
+ * This work is licensed under the terms of the GNU GPLv2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "metrics.h"
+#include "../libpcsxcore/socket.h"
+#include "../libpcsxcore/cdrom-async.h"
+#include "../libpcsxcore/new_dynarec/new_dynarec.h"
+#include "../plugins/dfsound/spu_config.h"
+#include "../include/thread_wakeups.h"
+
+extern void SysPrintf(const char *fmt, ...);
+
+#define FRAME_HIST	512 // power of 2
+
+static struct {
+	pthread_t tid;
+	pthread_mutex_t lock;
+	int running, exit;
+	// emu thread only
+	unsigned int cost[FRAME_HIST];
+	unsigned int frames, late;
+	// snapshot, under lock
+	struct {
+		unsigned int cost[FRAME_HIST];
+		unsigned int frames, late, flips_total;
+		float vsps;
+		unsigned int cd_hits, cd_misses, underruns;
+		struct ndrc_stats drc;
+		unsigned int twake[TWAKE_COUNT];
+	} s;
+} mt = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+void metrics_frame(int cost_us, int late)
+{
+	if (!mt.running)
+		return;
+	mt.cost[mt.frames++ & (FRAME_HIST - 1)] = cost_us < 0 ? 0 : cost_us;
+	mt.late += late;
+}
+
+void metrics_second(float vsps, unsigned int flips)
+{
+	if (!mt.running)
+		return;
+	pthread_mutex_lock(&mt.lock);
+	memcpy(mt.s.cost, mt.cost, sizeof(mt.s.cost));
+	mt.s.frames = mt.frames;
+	mt.s.late = mt.late;
+	mt.s.flips_total += flips;
+	mt.s.vsps = vsps;
+	cdra_get_cache_stats(&mt.s.cd_hits, &mt.s.cd_misses);
+	mt.s.underruns = spu_config.iUnderruns;
+	new_dynarec_get_stats(&mt.s.drc);
+	memcpy(mt.s.twake, twake_counts, sizeof(mt.s.twake));
+	pthread_mutex_unlock(&mt.lock);
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+	return x < y ? -1 : x > y;
+}
+
+// user+system time of each of our threads
+static int fill_threads(char *buf, int size)
+{
+	char path[64], line[512], *name, *p;
+	unsigned long utime, stime;
+	long hz = sysconf(_SC_CLK_TCK);
+	struct dirent *de;
+	int len = 0, n;
+	DIR *dir;
+	FILE *f;
+
+	dir = opendir("/proc/self/task");
+	if (dir == NULL)
+		return 0;
+	if (hz <= 0)
+		hz = 100;
+	while ((de = readdir(dir)) != NULL && len < size - 256) {
+		if (de->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "/proc/self/task/%s/stat", de->d_name);
+		f = fopen(path, "r");
+		if (f == NULL)
+			continue;
+		p = fgets(line, sizeof(line), f);
+		fclose(f);
+		// "tid (comm) state ..." with utime, stime the 14th and 15th fields
+		if (p == NULL || (name = strchr(line, '(')) == NULL
+		    || (p = strrchr(line, ')')) == NULL)
+			continue;
+		*p = 0;
+		name++;
+		if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+				&utime, &stime) != 2)
+			continue;
+		n = snprintf(buf + len, size - len,
+			"pcsx_thread_cpu_seconds_total{thread=\"%s\",tid=\"%s\"} %.2f\n",
+			name, de->d_name, (double)(utime + stime) / hz);
+		if (n > 0 && n < size - len)
+			len += n;
+	}
+	closedir(dir);
+	return len;
+}
+
+#define OUT(...) do { \
+	int n_ = snprintf(buf + len, size - len, __VA_ARGS__); \
+	if (n_ > 0 && n_ < size - len) len += n_; \
+} while (0)
+
+static const char * const twake_names[TWAKE_COUNT] = {
+	[TWAKE_CDR] = "cdr", [TWAKE_DRC] = "drc", [TWAKE_GPU] = "gpu",
+	[TWAKE_GPU_BAND] = "gpu_band", [TWAKE_SPU] = "spu",
+	[TWAKE_SPU_HELPER] = "spu_helper", [TWAKE_MCD] = "mcd",
+	[TWAKE_STATE] = "state", [TWAKE_JOB] = "job",
+};
+
+static int metrics_fill(char *buf, int size)
+{
+	static unsigned int sorted[FRAME_HIST];
+	static const int pct[] = { 50, 90, 99 };
+	unsigned int n, i;
+	int len = 0;
+
+	pthread_mutex_lock(&mt.lock);
+	n = mt.s.frames < FRAME_HIST ? mt.s.frames : FRAME_HIST;
+	memcpy(sorted, mt.s.cost, n * sizeof(sorted[0]));
+
+	OUT("# TYPE pcsx_vsyncs_per_second gauge\n");
+	OUT("pcsx_vsyncs_per_second %.2f\n", mt.s.vsps);
+	OUT("# TYPE pcsx_frames_total counter\n");
+	OUT("pcsx_frames_total %u\n", mt.s.frames);
+	OUT("# TYPE pcsx_flips_total counter\n");
+	OUT("pcsx_flips_total %u\n", mt.s.flips_total);
+	OUT("# TYPE pcsx_pacing_misses_total counter\n");
+	OUT("pcsx_pacing_misses_total %u\n", mt.s.late);
+	OUT("# TYPE pcsx_audio_underruns_total counter\n");
+	OUT("pcsx_audio_underruns_total %u\n", mt.s.underruns);
+	OUT("# TYPE pcsx_cdrom_cache_hits_total counter\n");
+	OUT("pcsx_cdrom_cache_hits_total %u\n", mt.s.cd_hits);
+	OUT("# TYPE pcsx_cdrom_cache_misses_total counter\n");
+	OUT("pcsx_cdrom_cache_misses_total %u\n", mt.s.cd_misses);
+	OUT("# TYPE pcsx_drc_compiles_total counter\n");
+	OUT("pcsx_drc_compiles_total %u\n", mt.s.drc.compiles);
+	OUT("# TYPE pcsx_drc_invalidations_total counter\n");
+	OUT("pcsx_drc_invalidations_total{cause=\"smc\"} %u\n", mt.s.drc.inv_smc);
+	OUT("pcsx_drc_invalidations_total{cause=\"dma\"} %u\n", mt.s.drc.inv_dma);
+	OUT("pcsx_drc_invalidations_total{cause=\"reload\"} %u\n", mt.s.drc.inv_reload);
+	OUT("pcsx_drc_invalidations_total{cause=\"prot\"} %u\n", mt.s.drc.inv_prot);
+	OUT("# TYPE pcsx_drc_ht_misses_total counter\n");
+	OUT("pcsx_drc_ht_misses_total %u\n", mt.s.drc.ht_misses);
+	OUT("# TYPE pcsx_drc_tc_used_bytes gauge\n");
+	OUT("pcsx_drc_tc_used_bytes %u\n", mt.s.drc.tc_used);
+	// per frame: rate() of this over rate() of pcsx_frames_total
+	OUT("# TYPE pcsx_thread_wakeups_total counter\n");
+	for (i = 0; i < TWAKE_COUNT; i++)
+		OUT("pcsx_thread_wakeups_total{thread=\"%s\"} %u\n",
+			twake_names[i], mt.s.twake[i]);
+	pthread_mutex_unlock(&mt.lock);
+
+	// over the last FRAME_HIST frames
+	if (n > 0) {
+		qsort(sorted, n, sizeof(sorted[0]), cmp_uint);
+		OUT("# TYPE pcsx_frame_time_us summary\n");
+		for (i = 0; i < sizeof(pct) / sizeof(pct[0]); i++)
+			OUT("pcsx_frame_time_us{quantile=\"0.%02d\"} %u\n", pct[i],
+				sorted[(n - 1) * pct[i] / 100]);
+	}
+	OUT("# TYPE pcsx_thread_cpu_seconds_total counter\n");
+	len += fill_threads(buf + len, size - len);
+	return len;
+}
+
+static void *metrics_thread(void *unused)
+{
+	while (!mt.exit)
+		ServeMetrics(500, metrics_fill);
+	return NULL;
+}
+
+int metrics_start(int port)
+{
+	if (mt.running)
+		return 0;
+	if (StartMetricsServer(port) != 0) {
+		SysPrintf("metrics: can't listen on port %d\n", port);
+		return -1;
+	}
+	mt.exit = 0;
+	mt.running = 1;
+	if (pthread_create(&mt.tid, NULL, metrics_thread, NULL) != 0) {
+		mt.running = 0;
+		StopMetricsServer();
+		return -1;
+	}
+	SysPrintf("metrics: serving on port %d\n", port);
+	return 0;
+}
+
+void metrics_stop(void)
+{
+	if (!mt.running)
+		return;
+	mt.exit = 1;
+	pthread_join(mt.tid, NULL);
+	StopMetricsServer();
+	mt.running = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+/*
+ * Prometheus style text endpoint for unattended units, built with
+ * USE_METRICS and enabled with -metrics PORT. Served from its own thread
+ * through the socket.c server code, the emu thread only fills counters
+ * and a once a second snapshot.
+ */
+
+#ifdef USE_METRICS
+
+int  metrics_start(int port);
+void metrics_stop(void);
+// every vsync: emulation time of the frame, and if it ran behind schedule
+void metrics_frame(int cost_us, int late);
+// once a second, snapshots what is owned by the emu thread
+void metrics_second(float vsps, unsigned int flips);
+
+#else
+
+static inline int  metrics_start(int port) { return -1; }
+static inline void metrics_stop(void) {}
+static inline void metrics_frame(int cost_us, int late) {}
+static inline void metrics_second(float vsps, unsigned int flips) {}
+
+#endif
+
+#endif /* __METRICS_H__ */
@@ -11,6 +11,7 @@
 #include "../deps/libretro-common/rthreads/rthreads.c"
 #include "features/features_cpu.h"
 #include "pcsxr-threads.h"
+#include "../include/thread_wakeups.h"
 
 // pcsxr "extensions"
 extern void SysPrintf(const char *fmt, ...);
@@ -40,6 +41,225 @@ void pcsxr_sthread_init(void)
 #endif
 }
 
+struct pcsxr_thread_policy pcsxr_tpolicy;
+
+static const char * const pcsxr_tnames[PCSXRT_COUNT] = {
+	"pcsxr-cdrom", "pcsxr-drc", "pcsxr-gpu", "pcsxr-gpuband",
+	"pcsxr-spu", "pcsxr-mcd", "pcsxr-state", "pcsxr-mdec",
+	"pcsxr-prof", "pcsxr-spuhelp", "pcsxr-job"
+};
+
+#if defined(__linux__) && !defined(_3DS)
+#include <sched.h>
+#include <sys/resource.h>
+#define HAVE_AFFINITY
+
+static struct {
+	cpu_set_t all;		// what the process was allowed to use at start
+	int order[CPU_SETSIZE];	// fastest first
+	int count;
+	int done;
+	int warned;
+} cpus;
+
+static unsigned int cpu_speed(int cpu)
+{
+	static const char * const files[] = {
+		"/sys/devices/system/cpu/cpu%d/cpu_capacity", // big.LITTLE arm
+		"/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq",
+	};
+	unsigned int val = 0;
+	char path[64];
+	size_t i;
+	FILE *f;
+
+	for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+		snprintf(path, sizeof(path), files[i], cpu);
+		f = fopen(path, "r");
+		if (f == NULL)
+			continue;
+		if (fscanf(f, "%u", &val) != 1)
+			val = 0;
+		fclose(f);
+		if (val)
+			break;
+	}
+	return val;
+}
+
+static void cpus_init(void)
+{
+	unsigned int speed[CPU_SETSIZE];
+	char buf[128];
+	int i, j, n = 0, l = 0;
+
+	cpus.done = 1;
+	if (sched_getaffinity(0, sizeof(cpus.all), &cpus.all) != 0)
+		return;
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (!CPU_ISSET(i, &cpus.all))
+			continue;
+		speed[i] = cpu_speed(i);
+		// insertion sort, stable so equal cpus stay in id order
+		for (j = n; j > 0 && speed[cpus.order[j - 1]] < speed[i]; j--)
+			cpus.order[j] = cpus.order[j - 1];
+		cpus.order[j] = i;
+		n++;
+	}
+	cpus.count = n;
+	for (i = 0; i < n && l < (int)sizeof(buf) - 8; i++)
+		l += snprintf(buf + l, sizeof(buf) - l, " %d", cpus.order[i]);
+	buf[l] = 0;
+	SysPrintf("cpus by speed:%s\n", buf);
+}
+
+// auto placement: the emu thread gets the fastest core, gpu and spu the
+// next ones if there are enough, everything else floats over the rest
+static int auto_cpu(int type)
+{
+	switch (type) {
+	case PCSXRT_EMU:
+		return cpus.order[0];
+	case PCSXRT_GPU:
+		return cpus.order[1];
+	case PCSXRT_SPU:
+		return cpus.count > 2 ? cpus.order[2] : cpus.order[1];
+	default:
+		return -1;
+	}
+}
+
+// 1: latency sensitive, -1: background work
+static int prio_class(int type)
+{
+	switch (type) {
+	case PCSXRT_EMU:
+	case PCSXRT_GPU:
+	case PCSXRT_GPU_BAND:
+	case PCSXRT_SPU:
+	case PCSXRT_SPU_HELPER:
+	case PCSXRT_JOB: // someone is waiting on it
+		return 1;
+	case PCSXRT_DRC:
+	case PCSXRT_MCD:
+	case PCSXRT_STATE:
+	case PCSXRT_PROF:
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+// threads inherit the creator's policy and nice, so everything gets set
+static void apply_priority(int type)
+{
+	struct sched_param param = { 0, };
+	int cls = prio_class(type);
+	int ret = 0, nice_val = 0;
+
+	if (pcsxr_tpolicy.prio == PCSXR_PRIO_RT && cls > 0) {
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+			return;
+		// no rtprio rlimit, try nice instead
+		param.sched_priority = 0;
+		ret = -1;
+	}
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	if (pcsxr_tpolicy.prio != PCSXR_PRIO_NORMAL && cls != 0)
+		nice_val = cls > 0 ? -5 : 5;
+	// per thread on linux
+	if (setpriority(PRIO_PROCESS, 0, nice_val) != 0)
+		ret = -1;
+	if (ret != 0 && !(cpus.warned & 1)) {
+		SysPrintf("thread priority change failed (not permitted?)\n");
+		cpus.warned |= 1;
+	}
+}
+#endif
+
+#ifdef HAVE_AFFINITY
+// -1 for not pinned
+static int policy_cpu(int type)
+{
+	int sel = pcsxr_tpolicy.cpu[type], cpu = -1;
+
+	if (sel == PCSXR_CPU_AUTO && cpus.count > 1)
+		cpu = auto_cpu(type);
+	else if (sel >= PCSXR_CPU_0) {
+		cpu = sel - PCSXR_CPU_0;
+		if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &cpus.all))
+			cpu = -1;
+	}
+	return cpu;
+}
+#endif
+
+// called by the thread itself, as not every platform can do it from outside
+void pcsxr_sthread_apply_self(int type)
+{
+#ifdef HAVE_AFFINITY
+	cpu_set_t set;
+	int cpu, emu_cpu;
+
+	if (!pcsxr_tpolicy.enable || (unsigned int)type > PCSXRT_EMU)
+		return;
+	if (!cpus.done)
+		cpus_init();
+	if (cpus.count == 0)
+		return;
+
+	set = cpus.all;
+	cpu = policy_cpu(type);
+	if (cpu >= 0) {
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+	}
+	else if (pcsxr_tpolicy.cpu[type] >= PCSXR_CPU_0)
+		SysPrintf("%s: cpu %d not available\n",
+			type < PCSXRT_COUNT ? pcsxr_tnames[type] : "emu",
+			pcsxr_tpolicy.cpu[type] - PCSXR_CPU_0);
+	else if (pcsxr_tpolicy.cpu[type] == PCSXR_CPU_AUTO && cpus.count > 1) {
+		// keep off the emu thread's core
+		emu_cpu = policy_cpu(PCSXRT_EMU);
+		if (emu_cpu >= 0)
+			CPU_CLR(emu_cpu, &set);
+	}
+	// always set, "free" threads would inherit a pinned creator's mask
+	if (sched_setaffinity(0, sizeof(set), &set) != 0 && !(cpus.warned & 2)) {
+		SysPrintf("sched_setaffinity failed\n");
+		cpus.warned |= 2;
+	}
+	apply_priority(type);
+#endif
+}
+
+void pcsxr_sthread_name_self(enum pcsxr_thread_type type)
+{
+#if defined(__GLIBC__) || \
+    (defined(__ANDROID_API__) && __ANDROID_API__ >= 26)
+	if ((unsigned int)type < (unsigned int)PCSXRT_COUNT)
+		pthread_setname_np(pthread_self(), pcsxr_tnames[type]);
+#endif
+}
+
+#ifndef _3DS
+struct pcsxr_tstart {
+	void (*func)(void *);
+	enum pcsxr_thread_type type;
+};
+
+static void pcsxr_thread_start(void *arg)
+{
+	struct pcsxr_tstart st = *(struct pcsxr_tstart *)arg;
+
+	free(arg);
+	pcsxr_sthread_name_self(st.type);
+	pcsxr_sthread_apply_self(st.type);
+	st.func(NULL);
+}
+#endif
+
 sthread_t *pcsxr_sthread_create(void (*thread_func)(void *),
 	enum pcsxr_thread_type type)
 {
@@ -58,10 +278,17 @@ sthread_t *pcsxr_sthread_create(void (*thread_func)(void *),
 	switch (type) {
 	case PCSXRT_CDR:
 	case PCSXRT_SPU:
+	case PCSXRT_MCD:
+	case PCSXRT_STATE:
+	case PCSXRT_PROF:
 		core_id = 1;
 		break;
 	case PCSXRT_DRC:
 	case PCSXRT_GPU:
+	case PCSXRT_GPU_BAND:
+	case PCSXRT_MDEC:
+	case PCSXRT_SPU_HELPER:
+	case PCSXRT_JOB:
 		core_id = is_new_3ds ? 2 : 1;
 		break;
 	case PCSXRT_COUNT:
@@ -85,17 +312,181 @@ sthread_t *pcsxr_sthread_create(void (*thread_func)(void *),
 	}
 	h->id = (pthread_t)ctr_thread;
 #else
-	h = sthread_create(thread_func, NULL);
- #if defined(__GLIBC__) || \
-    (defined(__ANDROID_API__) && __ANDROID_API__ >= 26)
-	if (h && (unsigned int)type < (unsigned int)PCSXRT_COUNT)
-	{
-		const char * const pcsxr_tnames[PCSXRT_COUNT] = {
-			"pcsxr-cdrom", "pcsxr-drc", "pcsxr-gpu", "pcsxr-spu"
-		};
-		pthread_setname_np(h->id, pcsxr_tnames[type]);
-	}
- #endif
+	struct pcsxr_tstart *st = malloc(sizeof(*st));
+	if (!st)
+		return NULL;
+	st->func = thread_func;
+	st->type = type;
+	h = sthread_create(pcsxr_thread_start, st);
+	if (!h)
+		free(st);
 #endif
 	return h;
 }
+
+struct pcsxr_batch {
+	void (*func)(void *ctx, int index);
+	void *ctx;
+	int count;
+	int next;	// first unclaimed index
+	int running;	// claimed, not finished
+	int prio;
+	struct pcsxr_batch *link;
+};
+
+static struct {
+	sthread_t *threads[PCSXR_JOB_WORKERS_MAX];
+	slock_t *lock;
+	scond_t *cond_job;
+	scond_t *cond_done;
+	struct pcsxr_batch *queue; // by priority, highest first
+	int count;
+	int tried;
+	int exit;
+} jobs;
+
+static int job_prio(enum pcsxr_thread_type type)
+{
+	switch (type) {
+	case PCSXRT_GPU_BAND:
+	case PCSXRT_SPU_HELPER:
+		return 2;
+	case PCSXRT_MDEC:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// with the lock held, returns with it held
+static void job_claim_run(struct pcsxr_batch *b)
+{
+	struct pcsxr_batch **pp;
+	int i = b->next++;
+
+	if (b->next == b->count) {
+		for (pp = &jobs.queue; *pp != b; pp = &(*pp)->link)
+			;
+		*pp = b->link;
+	}
+	b->running++;
+	slock_unlock(jobs.lock);
+	b->func(b->ctx, i);
+	slock_lock(jobs.lock);
+	if (--b->running == 0 && b->next == b->count)
+		scond_broadcast(jobs.cond_done);
+}
+
+static void job_thread(void *unused)
+{
+	slock_lock(jobs.lock);
+	while (!jobs.exit) {
+		if (jobs.queue == NULL) {
+			scond_wait(jobs.cond_job, jobs.lock);
+			twake_count(TWAKE_JOB);
+			continue;
+		}
+		job_claim_run(jobs.queue);
+	}
+	slock_unlock(jobs.lock);
+}
+
+void pcsxr_jobs_shutdown(void)
+{
+	int i;
+
+	if (jobs.lock) {
+		slock_lock(jobs.lock);
+		jobs.exit = 1;
+		scond_broadcast(jobs.cond_job);
+		slock_unlock(jobs.lock);
+	}
+	for (i = 0; i < PCSXR_JOB_WORKERS_MAX; i++) {
+		if (jobs.threads[i]) {
+			sthread_join(jobs.threads[i]);
+			jobs.threads[i] = NULL;
+		}
+	}
+	if (jobs.cond_done) { scond_free(jobs.cond_done); jobs.cond_done = NULL; }
+	if (jobs.cond_job)  { scond_free(jobs.cond_job); jobs.cond_job = NULL; }
+	if (jobs.lock)      { slock_free(jobs.lock); jobs.lock = NULL; }
+	jobs.queue = NULL;
+	jobs.count = 0;
+	jobs.tried = 0;
+	jobs.exit = 0;
+}
+
+// lazily on first use, so pcsxr_tpolicy.jobs from the config applies
+static void jobs_start(void)
+{
+	int i, count = pcsxr_tpolicy.jobs;
+
+	jobs.tried = 1;
+	if (count <= 0)
+		count = cpu_features_get_core_amount() - 1;
+	if (count > PCSXR_JOB_WORKERS_MAX)
+		count = PCSXR_JOB_WORKERS_MAX;
+	if (count <= 0)
+		return;
+
+	jobs.lock = slock_new();
+	jobs.cond_job = scond_new();
+	jobs.cond_done = scond_new();
+	if (!jobs.lock || !jobs.cond_job || !jobs.cond_done)
+		goto fail;
+	for (i = 0; i < count; i++) {
+		jobs.threads[i] = pcsxr_sthread_create(job_thread, PCSXRT_JOB);
+		if (jobs.threads[i] == NULL)
+			goto fail;
+	}
+	jobs.count = count;
+	SysPrintf("%d job worker(s)\n", count);
+	return;
+
+fail:
+	SysPrintf("job worker init failed\n");
+	pcsxr_jobs_shutdown();
+	jobs.tried = 1;
+}
+
+int pcsxr_jobs_parallelism(void)
+{
+	if (!jobs.tried)
+		jobs_start();
+	return jobs.count + 1;
+}
+
+void pcsxr_jobs_run(void (*func)(void *ctx, int index), void *ctx,
+	int count, enum pcsxr_thread_type type)
+{
+	struct pcsxr_batch b, **pp;
+	int i;
+
+	if (!jobs.tried)
+		jobs_start();
+	if (jobs.count == 0 || count < 2) {
+		for (i = 0; i < count; i++)
+			func(ctx, i);
+		return;
+	}
+
+	b.func = func;
+	b.ctx = ctx;
+	b.count = count;
+	b.next = b.running = 0;
+	b.prio = job_prio(type);
+
+	slock_lock(jobs.lock);
+	for (pp = &jobs.queue; *pp && (*pp)->prio >= b.prio; pp = &(*pp)->link)
+		;
+	b.link = *pp;
+	*pp = &b;
+	scond_broadcast(jobs.cond_job);
+
+	// help with our own batch only, others may be long and lower priority
+	while (b.next < b.count)
+		job_claim_run(&b);
+	while (b.running)
+		scond_wait(jobs.cond_done, jobs.lock);
+	slock_unlock(jobs.lock);
+}
@@ -6,10 +6,35 @@ enum pcsxr_thread_type
 	PCSXRT_CDR = 0,
 	PCSXRT_DRC,
 	PCSXRT_GPU,
+	PCSXRT_GPU_BAND,
 	PCSXRT_SPU,
+	PCSXRT_MCD,
+	PCSXRT_STATE,
+	PCSXRT_MDEC,
+	PCSXRT_PROF,
+	PCSXRT_SPU_HELPER,
+	PCSXRT_JOB,
 	PCSXRT_COUNT // must be last
 };
 
+// the emulation thread for pcsxr_sthread_apply_self() and the policy
+#define PCSXRT_EMU PCSXRT_COUNT
+
+enum { PCSXR_CPU_AUTO = 0, PCSXR_CPU_FREE, PCSXR_CPU_0 }; // cpu n is CPU_0 + n
+enum { PCSXR_PRIO_NORMAL = 0, PCSXR_PRIO_NICE, PCSXR_PRIO_RT };
+
+// applied when a thread starts (Linux only for now), so changes
+// take effect the next time a helper is (re)created
+struct pcsxr_thread_policy
+{
+	int enable;
+	int prio;
+	int cpu[PCSXRT_COUNT + 1];
+	int jobs; // job workers, 0: one less than the cores
+};
+
+#define PCSXR_JOB_WORKERS_MAX 8
+
 #ifndef USE_C11_THREADS
 
 /* use libretro-common rthreads */
@@ -18,9 +43,24 @@ enum pcsxr_thread_type
 #define STRHEAD_RET_TYPE void
 #define STRHEAD_RETURN()
 
+extern struct pcsxr_thread_policy pcsxr_tpolicy;
+
 void pcsxr_sthread_init(void);
 sthread_t *pcsxr_sthread_create(void (*thread_func)(void*),
 	enum pcsxr_thread_type type);
+// for threads not made by pcsxr_sthread_create()
+void pcsxr_sthread_name_self(enum pcsxr_thread_type type);
+void pcsxr_sthread_apply_self(int type);
+
+// shared worker pool: runs func(ctx, 0..count-1) spread over the job
+// workers and the calling thread, returns when all are done. Batches from
+// several threads may be queued at once, the workers take the ones with
+// the higher priority of their type (gpu bands/spu > mdec > rest) first.
+void pcsxr_jobs_run(void (*func)(void *ctx, int index), void *ctx,
+	int count, enum pcsxr_thread_type type);
+// how many threads pcsxr_jobs_run() spreads over, the caller included
+int  pcsxr_jobs_parallelism(void);
+void pcsxr_jobs_shutdown(void);
 
 #else
 
@@ -31,6 +71,15 @@ sthread_t *pcsxr_sthread_create(void (*thread_func)(void*),
 #define STRHEAD_RETURN() return 0
 
 #define pcsxr_sthread_init()
+#define pcsxr_sthread_name_self(type)
+#define pcsxr_sthread_apply_self(type)
+#define pcsxr_jobs_parallelism() 1
+#define pcsxr_jobs_shutdown()
+#define pcsxr_jobs_run(func, ctx, count, type) do { \
+	int i_; \
+	for (i_ = 0; i_ < (count); i_++) \
+		(func)(ctx, i_); \
+} while (0)
 
 #define slock_new() ({ \
 	mtx_t *lock = malloc(sizeof(*lock)); \
@@ -63,7 +112,16 @@ sthread_t *pcsxr_sthread_create(void (*thread_func)(void*),
 #define slock_unlock(lock) mtx_unlock(lock)
 #define scond_free(cond) free(cond)
 #define scond_wait(cond, lock) cnd_wait(cond, lock)
+#define scond_wait_timeout(cond, lock, timeout_us) ({ \
+	struct timespec ts_; \
+	timespec_get(&ts_, TIME_UTC); \
+	ts_.tv_sec += (timeout_us) / 1000000; \
+	ts_.tv_nsec += (timeout_us) % 1000000 * 1000; \
+	if (ts_.tv_nsec >= 1000000000) { ts_.tv_sec++; ts_.tv_nsec -= 1000000000; } \
+	cnd_timedwait(cond, lock, &ts_) == thrd_success; \
+})
 #define scond_signal(cond) cnd_signal(cond)
+#define scond_broadcast(cond) cnd_broadcast(cond)
 #define slock_t mtx_t
 #define scond_t cnd_t
 #define sthread_t thrd_t
@@ -257,6 +257,8 @@ void plat_omap_init(void)
 		fprintf(stderr, "couldn't init fb: %s\n", layer_fb_name);
 		goto fail0;
 	}
+	// fbdev panning is fine from any thread
+	pl_plat_present_thread = 1;
 
 	return;
 
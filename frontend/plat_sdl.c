@@ -144,11 +144,17 @@ static void *shadow_fb, *menubg_img;
 static int vout_fullscreen_old;
 static int forced_clears;
 static int forced_flips;
+#ifdef WEBOS
+// what the touch controls under the overlay were last drawn for
+static unsigned int touch_serial;
+static SDL_Rect touch_rect;
+static int touch_redraws;
+#endif
 static int sdl12_compat;
 static int resized;
 static int in_menu;
 
-static int gl_w_prev, gl_h_prev, gl_quirks_prev;
+static int gl_w_prev, gl_h_prev, gl_quirks_prev, gl_owned_prev;
 static float gl_vertices[] = {
 	-1.0f,  1.0f,  0.0f, // 0    0  1
 	 1.0f,  1.0f,  0.0f, // 1  ^
@@ -217,6 +223,15 @@ static void sdl_event_handler(void *event_)
     }
     return;
   case SDL_ACTIVEEVENT:
+#ifdef WEBOS
+    // card minimized, let go of everything until it's back, see emu_suspend()
+    if ((event->active.state & SDL_APPACTIVE) && !event->active.gain && !in_menu) {
+      extern enum sched_action emu_action, emu_action_old;
+      emu_action = SACTION_SUSPEND;
+      emu_action_old = 0;
+      psxRegs.stop++;
+    }
+#endif
     // no need to redraw?
     return;
   default:
@@ -275,7 +290,13 @@ void plat_init(void)
   if (shadow_size < 1024 * 512 * 2)
     shadow_size = 1024 * 512 * 2;
 
+  // the GL path uploads straight from here, keep rows cacheline/page aligned
+#if defined(_POSIX_C_SOURCE) && (_POSIX_C_SOURCE >= 200112L) && P_HAVE_POSIX_MEMALIGN
+  if (posix_memalign(&shadow_fb, 4096, shadow_size) != 0)
+    shadow_fb = NULL;
+#else
   shadow_fb = malloc(shadow_size);
+#endif
   menubg_img = malloc(shadow_size);
   if (shadow_fb == NULL || menubg_img == NULL) {
     fprintf(stderr, "OOM\n");
@@ -430,13 +451,17 @@ static void gl_resize(void)
   if (plugin_owns_display())
     w = plat_sdl_screen->w, h = plat_sdl_screen->h;
   if (plat_sdl_gl_active) {
-    if (w == gl_w_prev && h == gl_h_prev && gl_quirks == gl_quirks_prev)
+    // gl_flip_v() takes the frame size with every upload, so a new psx
+    // mode is only a new viewport, the context is kept for that
+    if (gl_quirks == gl_quirks_prev && gl_owned_prev == !!plugin_owns_display()
+        && ((w == gl_w_prev && h == gl_h_prev) || !gl_owned_prev))
       return;
     gl_finish_pl();
   }
   plat_sdl_gl_active = (gl_create(window, &gl_quirks, w, h) == 0);
   if (plat_sdl_gl_active)
-    gl_w_prev = w, gl_h_prev = h, gl_quirks_prev = gl_quirks;
+    gl_w_prev = w, gl_h_prev = h, gl_quirks_prev = gl_quirks,
+    gl_owned_prev = !!plugin_owns_display();
   else {
     fprintf(stderr, "warning: could not init GL.\n");
     plat_target.vout_method = 0;
@@ -589,6 +614,8 @@ static void *setup_blit_callbacks(int w, int h)
     pl_plat_hud_print = overlay_hud_print;
   }
   else if (plat_sdl_gl_active) {
+    // the core converts directly into shadow_fb which gl_flip_v() then
+    // uploads into the texture gl_create() allocated once, no extra copy
     return shadow_fb;
   }
   else {
@@ -735,25 +762,34 @@ void *plat_gvideo_flip(void)
       g_layer_w, g_layer_h
     };
 #ifdef WEBOS
-    /* Always clear the underlying screen surface before drawing touch controls.
-     * The YUV overlay (game content) is composited on top, so we only see
-     * plat_sdl_screen in areas not covered by the overlay. Clearing every frame
-     * prevents ghost button artifacts when the overlay size/position changes. */
-    if (SDL_MUSTLOCK(plat_sdl_screen))
-      SDL_LockSurface(plat_sdl_screen);
-    memset(plat_sdl_screen->pixels, 0, plat_sdl_screen->pitch * plat_sdl_screen->h);
-    if (SDL_MUSTLOCK(plat_sdl_screen))
-      SDL_UnlockSurface(plat_sdl_screen);
-    /* Draw touch controls to the screen surface (visible around overlay edges) */
-    webos_touch_draw_overlay_sdl(plat_sdl_screen);
-    /* Position and display the YUV overlay with game content */
-    SDL_DisplayYUVOverlay(plat_sdl_overlay, &dstrect);
-    SDL_Flip(plat_sdl_screen);
-    /* Consume forced_clears/flips since we handle clearing ourselves */
+    /* The display controller scales and composites the YUV overlay (game
+     * content), plat_sdl_screen is only seen around it. That only needs the
+     * touch controls redrawn and flipped when they change, the overlay moves
+     * or a clear was asked for; twice, in case the screen is double buffered. */
+    unsigned int serial = webos_touch_overlay_serial();
+    if (serial != touch_serial || forced_clears > 0 || forced_flips > 0
+        || memcmp(&dstrect, &touch_rect, sizeof(dstrect)) != 0) {
+      touch_serial = serial;
+      touch_rect = dstrect;
+      touch_redraws = 2;
+    }
     if (forced_clears > 0)
       forced_clears--;
     if (forced_flips > 0)
       forced_flips--;
+    if (touch_redraws > 0) {
+      touch_redraws--;
+      if (SDL_MUSTLOCK(plat_sdl_screen))
+        SDL_LockSurface(plat_sdl_screen);
+      memset(plat_sdl_screen->pixels, 0, plat_sdl_screen->pitch * plat_sdl_screen->h);
+      if (SDL_MUSTLOCK(plat_sdl_screen))
+        SDL_UnlockSurface(plat_sdl_screen);
+      webos_touch_draw_overlay_sdl(plat_sdl_screen);
+      SDL_DisplayYUVOverlay(plat_sdl_overlay, &dstrect);
+      SDL_Flip(plat_sdl_screen);
+    }
+    else
+      SDL_DisplayYUVOverlay(plat_sdl_overlay, &dstrect);
 #else
     SDL_DisplayYUVOverlay(plat_sdl_overlay, &dstrect);
 #endif
@@ -764,6 +800,7 @@ void *plat_gvideo_flip(void)
     /* Draw touch controls overlay after the game frame */
     webos_touch_draw_overlay();
     SDL_GL_SwapBuffers();
+    pl_vblank_report();
     /* Consume forced_flips to prevent double flip/draw below */
     if (forced_flips > 0)
       forced_flips--;
@@ -0,0 +1,474 @@
+/*
+ * SDL2 platform code, for desktop and the newer handheld distros.
+ * The frame is converted straight into a streaming texture, scaling is
+ * left to the renderer and pacing to SDL_RENDERER_PRESENTVSYNC.
+ * plat_sdl.c stays the SDL 1.2 one (webOS, older handhelds).
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "libpicofe/input.h"
+#include "libpicofe/in_sdl.h"
+#include "libpicofe/menu.h"
+#include "libpicofe/fonts.h"
+#include "libpicofe/plat.h"
+#include "cspace.h"
+#include "plugin_lib.h"
+#include "plugin.h"
+#include "menu.h"
+#include "main.h"
+#include "plat.h"
+#include "revision.h"
+
+static const struct in_default_bind in_sdl_defbinds[] = {
+  { SDLK_UP,     IN_BINDTYPE_PLAYER12, DKEY_UP },
+  { SDLK_DOWN,   IN_BINDTYPE_PLAYER12, DKEY_DOWN },
+  { SDLK_LEFT,   IN_BINDTYPE_PLAYER12, DKEY_LEFT },
+  { SDLK_RIGHT,  IN_BINDTYPE_PLAYER12, DKEY_RIGHT },
+  { SDLK_d,      IN_BINDTYPE_PLAYER12, DKEY_TRIANGLE },
+  { SDLK_z,      IN_BINDTYPE_PLAYER12, DKEY_CROSS },
+  { SDLK_x,      IN_BINDTYPE_PLAYER12, DKEY_CIRCLE },
+  { SDLK_s,      IN_BINDTYPE_PLAYER12, DKEY_SQUARE },
+  { SDLK_v,      IN_BINDTYPE_PLAYER12, DKEY_START },
+  { SDLK_c,      IN_BINDTYPE_PLAYER12, DKEY_SELECT },
+  { SDLK_w,      IN_BINDTYPE_PLAYER12, DKEY_L1 },
+  { SDLK_r,      IN_BINDTYPE_PLAYER12, DKEY_R1 },
+  { SDLK_e,      IN_BINDTYPE_PLAYER12, DKEY_L2 },
+  { SDLK_t,      IN_BINDTYPE_PLAYER12, DKEY_R2 },
+  { SDLK_ESCAPE, IN_BINDTYPE_EMU, SACTION_ENTER_MENU },
+  { SDLK_F1,     IN_BINDTYPE_EMU, SACTION_SAVE_STATE },
+  { SDLK_F2,     IN_BINDTYPE_EMU, SACTION_LOAD_STATE },
+  { SDLK_F3,     IN_BINDTYPE_EMU, SACTION_PREV_SSLOT },
+  { SDLK_F4,     IN_BINDTYPE_EMU, SACTION_NEXT_SSLOT },
+  { SDLK_F5,     IN_BINDTYPE_EMU, SACTION_TOGGLE_FSKIP },
+  { SDLK_F6,     IN_BINDTYPE_EMU, SACTION_SCREENSHOT },
+  { SDLK_F7,     IN_BINDTYPE_EMU, SACTION_TOGGLE_FPS },
+  { SDLK_F8,     IN_BINDTYPE_EMU, SACTION_SWITCH_DISPMODE },
+  { SDLK_F11,    IN_BINDTYPE_EMU, SACTION_TOGGLE_FULLSCREEN },
+  { SDLK_BACKSPACE, IN_BINDTYPE_EMU, SACTION_FAST_FORWARD },
+  { 0, 0, 0 }
+};
+
+const struct menu_keymap in_sdl_key_map[] =
+{
+  { SDLK_UP,     PBTN_UP },
+  { SDLK_DOWN,   PBTN_DOWN },
+  { SDLK_LEFT,   PBTN_LEFT },
+  { SDLK_RIGHT,  PBTN_RIGHT },
+  { SDLK_RETURN, PBTN_MOK },
+  { SDLK_ESCAPE, PBTN_MBACK },
+  { SDLK_SEMICOLON,    PBTN_MA2 },
+  { SDLK_QUOTE,        PBTN_MA3 },
+  { SDLK_LEFTBRACKET,  PBTN_L },
+  { SDLK_RIGHTBRACKET, PBTN_R },
+};
+
+static const struct in_pdata in_sdl_platform_data = {
+  .defbinds  = in_sdl_defbinds,
+  .key_map   = in_sdl_key_map,
+  .kmap_size = sizeof(in_sdl_key_map) / sizeof(in_sdl_key_map[0]),
+};
+
+static SDL_Window *window;
+static SDL_Renderer *renderer;
+static SDL_Texture *texture;
+// allocated once for the largest mode, a mode change only moves the
+// used tex_w x tex_h corner that's locked, blitted and presented
+#define TEX_MAX_W 1024
+#define TEX_MAX_H 512
+static int tex_w, tex_h, tex_filter = -1;
+static int tex_alloc_w, tex_alloc_h;
+// the texture is locked from the first write of a frame to the flip,
+// streaming locks are write only so everything has to go in one go
+static unsigned short *tex_pixels;
+static int tex_pitch;		// in pixels
+static int tex_cleared;
+
+static int psx_w = 256, psx_h = 240;
+static void *shadow_fb;
+static int fullscreen_old;
+static int in_menu;
+static int vsync_on;
+
+static void quit_cb(void)
+{
+  emu_core_ask_exit();
+}
+
+static void sdl_event_handler(void *event_)
+{
+  SDL_Event *event = event_;
+
+  switch (event->type) {
+  case SDL_QUIT:
+    quit_cb();
+    break;
+  case SDL_WINDOWEVENT:
+    // the renderer scales, the layer is worked out again on every present
+    break;
+  default:
+    break;
+  }
+}
+
+static void get_layer_pos(int *x, int *y, int *w, int *h)
+{
+  *x = g_layer_x;
+  *y = g_layer_y;
+  *w = g_layer_w;
+  *h = g_layer_h;
+}
+
+static void tex_unlock(void)
+{
+  if (tex_pixels == NULL)
+    return;
+  SDL_UnlockTexture(texture);
+  tex_pixels = NULL;
+}
+
+static int tex_lock(void)
+{
+  SDL_Rect rect = { 0, 0, tex_w, tex_h };
+  void *pixels;
+  int pitch;
+
+  if (tex_pixels != NULL)
+    return 0;
+  if (texture == NULL || SDL_LockTexture(texture, &rect, &pixels, &pitch) != 0)
+    return -1;
+  tex_pixels = pixels;
+  tex_pitch = pitch / 2;
+  tex_cleared = 0;
+  return 0;
+}
+
+static void tex_clear(void)
+{
+  unsigned short *dst;
+  int h;
+
+  if (tex_lock() != 0 || tex_cleared)
+    return;
+  for (dst = tex_pixels, h = tex_h; h > 0; dst += tex_pitch, h--)
+    memset(dst, 0, tex_w * 2);
+  tex_cleared = 1;
+}
+
+// clears the whole texture, then leaves the used area locked and cleared
+static void tex_set_area(int w, int h)
+{
+  tex_w = tex_alloc_w;
+  tex_h = tex_alloc_h;
+  tex_clear();
+  tex_unlock();
+  tex_w = w;
+  tex_h = h;
+  tex_clear();
+}
+
+static void tex_resize(int w, int h)
+{
+  // the filter is a property of the texture
+  int filter = plat_target.hwfilter != 0;
+  int alloc_w = w > TEX_MAX_W ? w : TEX_MAX_W;
+  int alloc_h = h > TEX_MAX_H ? h : TEX_MAX_H;
+
+  if (texture != NULL && w == tex_w && h == tex_h && filter == tex_filter)
+    return;
+  tex_unlock();
+  if (texture != NULL && w <= tex_alloc_w && h <= tex_alloc_h
+      && filter == tex_filter) {
+    // same texture, a linear filter would pull in what a larger mode
+    // left next to the new area, so that goes too
+    if (w < tex_w || h < tex_h)
+      tex_set_area(w, h);
+    else {
+      tex_w = w;
+      tex_h = h;
+      tex_clear();
+    }
+    return;
+  }
+  if (texture != NULL)
+    SDL_DestroyTexture(texture);
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, filter ? "nearest" : "linear");
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB565,
+    SDL_TEXTUREACCESS_STREAMING, alloc_w, alloc_h);
+  if (texture == NULL) {
+    fprintf(stderr, "SDL_CreateTexture %dx%d: %s\n", alloc_w, alloc_h,
+      SDL_GetError());
+    return;
+  }
+  tex_alloc_w = alloc_w;
+  tex_alloc_h = alloc_h;
+  tex_filter = filter;
+  // a fresh texture is undefined, keep it black until written
+  tex_set_area(w, h);
+}
+
+static void update_fullscreen(void)
+{
+  if (plat_target.vout_fullscreen == fullscreen_old)
+    return;
+  SDL_SetWindowFullscreen(window,
+    plat_target.vout_fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+  fullscreen_old = plat_target.vout_fullscreen;
+}
+
+static void present(int w, int h)
+{
+  SDL_Rect src = { 0, 0, tex_w, tex_h };
+  SDL_Rect dst;
+  int ww, wh;
+
+  tex_unlock();
+  SDL_GetRendererOutputSize(renderer, &ww, &wh);
+  pl_update_layer_size(w, h, ww, wh);
+  dst.x = g_layer_x;
+  dst.y = g_layer_y;
+  dst.w = g_layer_w;
+  dst.h = g_layer_h;
+
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  SDL_RenderClear(renderer);
+  if (texture != NULL)
+    SDL_RenderCopy(renderer, texture, &src, &dst);
+  SDL_RenderPresent(renderer);
+  if (vsync_on)
+    pl_vblank_report();
+}
+
+static void tex_blit(int doffs, const void *src_, int w, int h,
+                     int sstride, int bgr24)
+{
+  const unsigned short *src = src_;
+  unsigned short *dst;
+
+  if (tex_lock() != 0)
+    return;
+  // the lock doesn't keep what was there, so what's not covered is cleared
+  if (doffs != 0 || w < tex_w || h < tex_h)
+    tex_clear();
+  if (w > tex_w)
+    w = tex_w;
+  if (h > tex_h - doffs / tex_w)
+    h = tex_h - doffs / tex_w;
+  dst = tex_pixels + doffs / tex_w * tex_pitch + doffs % tex_w;
+
+  if (bgr24) {
+    for (; h > 0; dst += tex_pitch, src += sstride, h--)
+      bgr888_to_rgb565(dst, src, w);
+  }
+  else {
+    for (; h > 0; dst += tex_pitch, src += sstride, h--)
+      bgr555_to_rgb565(dst, src, w);
+  }
+}
+
+static void tex_hud_print(int x, int y, const char *str, int bpp)
+{
+  if (tex_lock() != 0)
+    return;
+  basic_text_out16_nf(tex_pixels, tex_pitch, x, y, str);
+}
+
+void plat_init(void)
+{
+  static const char *hwfilters[] = { "linear", "nearest", NULL };
+  SDL_version ver;
+  int shadow_size;
+
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_NOPARACHUTE) != 0) {
+    fprintf(stderr, "SDL_Init: %s\n", SDL_GetError());
+    exit(1);
+  }
+  SDL_GetVersion(&ver);
+  printf("SDL %u.%u.%u\n", ver.major, ver.minor, ver.patch);
+
+  g_menuscreen_w = 640;
+  g_menuscreen_h = 480;
+  g_menuscreen_pp = g_menuscreen_w;
+
+  window = SDL_CreateWindow("PCSX-ReARMed " REV, SDL_WINDOWPOS_UNDEFINED,
+    SDL_WINDOWPOS_UNDEFINED, g_menuscreen_w, g_menuscreen_h,
+    SDL_WINDOW_RESIZABLE);
+  if (window == NULL) {
+    fprintf(stderr, "SDL_CreateWindow: %s\n", SDL_GetError());
+    exit(1);
+  }
+  renderer = SDL_CreateRenderer(window, -1,
+    SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  if (renderer == NULL) {
+    fprintf(stderr, "no accelerated renderer (%s), trying any\n", SDL_GetError());
+    renderer = SDL_CreateRenderer(window, -1, 0);
+  }
+  if (renderer == NULL) {
+    fprintf(stderr, "SDL_CreateRenderer: %s\n", SDL_GetError());
+    exit(1);
+  }
+  {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+      vsync_on = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+      printf("SDL renderer: %s%s\n", info.name, vsync_on ? ", vsync" : "");
+    }
+  }
+
+  shadow_size = g_menuscreen_w * g_menuscreen_h * 2;
+  shadow_fb = malloc(shadow_size);
+  if (shadow_fb == NULL) {
+    fprintf(stderr, "OOM\n");
+    exit(1);
+  }
+  memset(shadow_fb, 0, shadow_size);
+
+  in_menu = 1;
+  fullscreen_old = 0;
+  update_fullscreen();
+
+  in_sdl_init(&in_sdl_platform_data, sdl_event_handler);
+  in_probe();
+  pl_rearmed_cbs.only_16bpp = 1;
+  pl_rearmed_cbs.pl_get_layer_pos = get_layer_pos;
+
+  plat_target.hwfilters = hwfilters;
+}
+
+void plat_finish(void)
+{
+  tex_unlock();
+  if (texture != NULL)
+    SDL_DestroyTexture(texture);
+  texture = NULL;
+  if (renderer != NULL)
+    SDL_DestroyRenderer(renderer);
+  renderer = NULL;
+  if (window != NULL)
+    SDL_DestroyWindow(window);
+  window = NULL;
+  free(shadow_fb);
+  shadow_fb = NULL;
+  SDL_Quit();
+}
+
+void plat_gvideo_open(int is_pal)
+{
+}
+
+void *plat_gvideo_set_mode(int *w, int *h, int *bpp)
+{
+  psx_w = *w;
+  psx_h = *h;
+
+  update_fullscreen();
+  tex_resize(*w, *h);
+
+  pl_plat_clear = tex_clear;
+  pl_plat_blit = tex_blit;
+  pl_plat_hud_print = tex_hud_print;
+  return NULL;
+}
+
+void *plat_gvideo_flip(void)
+{
+  update_fullscreen();
+  if (tex_filter != (plat_target.hwfilter != 0))
+    tex_resize(psx_w, psx_h);
+  present(psx_w, psx_h);
+  return NULL;
+}
+
+void plat_gvideo_close(void)
+{
+  tex_unlock();
+}
+
+void plat_video_menu_enter(int is_rom_loaded)
+{
+  int d;
+
+  in_menu = 1;
+  tex_unlock();
+  // a streaming texture can't be read back for the menu background
+  pl_vout_buf = NULL;
+
+  for (d = 0; d < IN_MAX_DEVS; d++)
+    in_set_config_int(d, IN_CFG_ANALOG_MAP_ULDR, 1);
+}
+
+void plat_video_menu_begin(void)
+{
+  update_fullscreen();
+  tex_resize(g_menuscreen_w, g_menuscreen_h);
+  g_menuscreen_ptr = shadow_fb;
+}
+
+void plat_video_menu_end(void)
+{
+  const unsigned short *src = g_menuscreen_ptr;
+  unsigned short *dst;
+  int h;
+
+  if (tex_lock() == 0) {
+    for (dst = tex_pixels, h = g_menuscreen_h; h > 0;
+         dst += tex_pitch, src += g_menuscreen_pp, h--)
+      memcpy(dst, src, g_menuscreen_w * 2);
+  }
+  present(g_menuscreen_w, g_menuscreen_h);
+  g_menuscreen_ptr = NULL;
+}
+
+void plat_video_menu_leave(void)
+{
+  int d;
+
+  in_menu = 0;
+  memset(shadow_fb, 0, g_menuscreen_w * g_menuscreen_h * 2);
+  update_fullscreen();
+  tex_resize(psx_w, psx_h);
+
+  for (d = 0; d < IN_MAX_DEVS; d++)
+    in_set_config_int(d, IN_CFG_ANALOG_MAP_ULDR, 0);
+}
+
+void plat_video_show_loading(void)
+{
+  const char *msg = "Loading...";
+
+  if (renderer == NULL)
+    return;
+  tex_resize(g_menuscreen_w, g_menuscreen_h);
+  if (tex_lock() != 0)
+    return;
+  tex_clear();
+  basic_text_out16_nf(tex_pixels, tex_pitch, (tex_w - 80) / 2,
+    (tex_h - 8) / 2, msg);
+  present(g_menuscreen_w, g_menuscreen_h);
+}
+
+void *plat_prepare_screenshot(int *w, int *h, int *bpp)
+{
+  fprintf(stderr, "screenshot not implemented in current mode\n");
+  return NULL;
+}
+
+void plat_trigger_vibrate(int pad, int low, int high)
+{
+}
+
+void plat_minimize(void)
+{
+  SDL_MinimizeWindow(window);
+}
+
+// vim:shiftwidth=2:expandtab
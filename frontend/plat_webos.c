@@ -11,7 +11,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <dlfcn.h>
+#include <SDL.h>
 
 static void *libpdl;
 static int pdl_initialized;
@@ -132,15 +134,49 @@ int webos_is_available(void)
  * - YUV overlay mode works but renders on a hardware layer that covers the SDL surface
  * - Software mode renders directly to the SDL screen surface, allowing us to draw
  *   touch controls on top of the game frame
+ *
+ * PCSX_WEBOS_VOUT=overlay selects the YUV overlay instead, which leaves scaling
+ * to the display controller; touch controls are then only visible around the
+ * game image and are redrawn only when they change.
  */
 void webos_set_video_default(void)
 {
+    extern void plat_sdl_set_software_default(void);
+    extern void plat_sdl_set_overlay_default(void);
+    const char *vout;
+
     if (!pdl_initialized)
         return;
 
-    /* Call the platform function to set software mode */
-    extern void plat_sdl_set_software_default(void);
+    vout = getenv("PCSX_WEBOS_VOUT");
+    if (vout != NULL && strcmp(vout, "overlay") == 0) {
+        printf("WebOS: Using the YUV overlay for video output\n");
+        plat_sdl_set_overlay_default();
+        return;
+    }
 
     printf("WebOS: Setting software rendering for touch control overlay support\n");
     plat_sdl_set_software_default();
 }
+
+/*
+ * Block while the app card is minimized
+ * The emulator has released its threads, audio and display by now, so
+ * nothing but this wait runs until the card is brought back.
+ * Returns 1 if the card was closed meanwhile.
+ */
+int webos_wait_foreground(void)
+{
+    SDL_Event event;
+
+    printf("WebOS: card in the background\n");
+    while (SDL_WaitEvent(&event)) {
+        if (event.type == SDL_QUIT)
+            return 1;
+        if (event.type == SDL_ACTIVEEVENT && (event.active.state & SDL_APPACTIVE)
+            && event.active.gain)
+            break;
+    }
+    printf("WebOS: card in the foreground\n");
+    return 0;
+}
@@ -22,6 +22,9 @@ int webos_is_available(void);
 /* Set Video Overlay as default video output (hardware accelerated, avoids touch flicker) */
 void webos_set_video_default(void);
 
+/* Block while the app card is in the background, nonzero if asked to quit */
+int webos_wait_foreground(void);
+
 #else
 
 /* Stubs for non-WebOS builds */
@@ -30,6 +33,7 @@ static inline void webos_finish(void) { }
 static inline void webos_notify_music(int playing) { (void)playing; }
 static inline int webos_is_available(void) { return 0; }
 static inline void webos_set_video_default(void) { }
+static inline int webos_wait_foreground(void) { return 0; }
 
 #endif /* WEBOS */
 
@@ -27,6 +27,7 @@
 long PAD1_readPort(PadDataS *pad) {
 	int pad_index = pad->requestPadIndex;
 
+	pl_pad_poll();
 	pad->controllerType = in_type[pad_index];
 	pad->buttonStatus = ~in_keystate[pad_index];
 
@@ -55,6 +56,7 @@ long PAD1_readPort(PadDataS *pad) {
 long PAD2_readPort(PadDataS *pad) {
 	int pad_index = pad->requestPadIndex;
 
+	pl_pad_poll();
 	pad->controllerType = in_type[pad_index];
 	pad->buttonStatus = ~in_keystate[pad_index];
 
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -17,6 +18,8 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
 
 #include "libpicofe/fonts.h"
 #include "libpicofe/input.h"
@@ -29,14 +32,22 @@
 #include "plat.h"
 #include "pcnt.h"
 #include "pl_gun_ts.h"
+#include "shm_export.h"
+#include "metrics.h"
 #include "cspace.h"
 #include "psemu_plugin_defs.h"
+#include "../plugins/dfsound/spu.h"
 #include "../libpcsxcore/new_dynarec/new_dynarec.h"
 #include "../libpcsxcore/psxmem_map.h"
 #include "../libpcsxcore/gpu.h"
 #include "../libpcsxcore/r3000a.h"
 #include "../libpcsxcore/psxcounters.h"
+#include "../libpcsxcore/cdrom.h"
 #include "arm_features.h"
+#include "../include/thread_wakeups.h"
+#ifdef HAVE_RTHREADS
+#include "pcsxr-threads.h"
+#endif
 
 #ifdef WEBOS
 #include "in_webos_touch.h"
@@ -69,12 +80,30 @@ static int psx_w, psx_h, psx_bpp;
 static int vsync_cnt;
 static int is_pal, frame_interval, frame_interval1024;
 static int vsync_usec_time;
+static struct timeval vblank_tv; // last pl_vblank_report()
+static int vblank_interval;
+static int jitter_avg, jitter_max; // frame time deviation over the last second, usecs
+
+/* $PCSX_INPUT_LAT_CSV logs pad changes and flips on the pacing clock,
+ * for measuring input to display latency */
+static struct {
+	FILE *csv;
+	int tried;
+	unsigned short keys[2];
+} in_lat;
+
+#if defined(CLOCK_MONOTONIC) && defined(TIMER_ABSTIME) && !defined(__APPLE__)
+#define PL_MONOTONIC
+// wake up this early and spin the rest, the scheduler is not that precise
+#define SPIN_TAIL_US 200
+#endif
 
 // platform hooks
 void (*pl_plat_clear)(void);
 void (*pl_plat_blit)(int doffs, const void *src, int w, int h,
 		     int sstride, int bgr24);
 void (*pl_plat_hud_print)(int x, int y, const char *str, int bpp);
+int pl_plat_present_thread; // flip may be called from another thread
 
 
 static __attribute__((noinline)) int get_cpu_ticks(void)
@@ -119,6 +148,20 @@ static void hud_printf(void *fb, int w, int x, int y, const char *texto, ...)
 	hud_print(fb, w, x, y, buffer);
 }
 
+// frame pacing clock, only ever compared against itself
+static void pl_get_time(struct timeval *tv)
+{
+#ifdef PL_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	tv->tv_sec = ts.tv_sec;
+	tv->tv_usec = ts.tv_nsec / 1000;
+#else
+	gettimeofday(tv, 0);
+#endif
+}
+
 static void print_msg(int h, int border)
 {
 	hud_print(pl_vout_buf, pl_vout_w, border + 2, h - HUD_HEIGHT, hud_msg);
@@ -127,8 +170,9 @@ static void print_msg(int h, int border)
 static void print_fps(int h, int border)
 {
 	hud_printf(pl_vout_buf, pl_vout_w, border + 2, h - HUD_HEIGHT,
-		"%2d %4.1f", pl_rearmed_cbs.flips_per_sec,
-		pl_rearmed_cbs.vsps_cur);
+		"%2d %4.1f j%d.%d/%d.%d", pl_rearmed_cbs.flips_per_sec,
+		pl_rearmed_cbs.vsps_cur, jitter_avg / 1000, jitter_avg / 100 % 10,
+		jitter_max / 1000, jitter_max / 100 % 10);
 }
 
 static void print_cpu_usage(int x, int h)
@@ -167,6 +211,182 @@ static __attribute__((noinline)) void draw_active_chans(int vout_w, int vout_h)
 	}
 }
 
+static struct spu_prof spu_prof; // fetched once a frame in pl_frame_limit()
+
+// SPU timing for the last frame, also appended to $PCSX_SPU_PROF_CSV if set
+static void print_spu_prof(int h, int border)
+{
+	static FILE *csv;
+	static int csv_tried;
+	const struct spu_prof p = spu_prof;
+
+	hud_printf(pl_vout_buf, pl_vout_w, border + 2, h - HUD_HEIGHT * 2,
+		"spu c%4u r%4u x%3u o%3u w%4u f%6d", p.chans, p.reverb,
+		p.xa, p.out, p.wait, p.out_fill);
+
+	if (!csv_tried) {
+		const char *path = getenv("PCSX_SPU_PROF_CSV");
+		csv_tried = 1;
+		if (path != NULL && (csv = fopen(path, "w")) != NULL)
+			fprintf(csv, "frame,chans_us,reverb_us,xa_us,out_us,wait_us,out_fill\n");
+	}
+	if (csv != NULL)
+		fprintf(csv, "%u,%u,%u,%u,%u,%u,%d\n", pl_rearmed_cbs.flip_cnt,
+			p.chans, p.reverb, p.xa, p.out, p.wait, p.out_fill);
+}
+
+/* frame time graph */
+enum { PERF_EMU, PERF_GPU, PERF_SPU, PERF_CDR, PERF_BLIT, PERF_PRESENT,
+	PERF_GPU_ASYNC, PERF_CNT };
+#define PERF_FRAMES 240
+#define PERF_GRAPH_H 60 // 2 frame intervals
+
+static struct {
+	unsigned short us[PERF_FRAMES][PERF_CNT];
+	int pos;
+	unsigned int blit_us, present_us; // accumulated by do_vout_flip
+	unsigned int tex[2], tex_prev[2]; // gpu texture cache expansions, last frame
+	FILE *csv;
+	int csv_tried;
+} perf;
+
+static const unsigned short perf_colors[PERF_CNT] =
+	{ 0xffff, 0x07e0, 0xffe0, 0xf800, 0x001f, 0x07ff, 0xf81f };
+
+static unsigned int perf_ticks(void)
+{
+	struct timeval tv;
+
+	if (!pl_rearmed_cbs.perf_on)
+		return 0;
+	pl_get_time(&tv);
+	return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// one column per frame, the emu thread's parts stacked, the gpu thread
+// as a dot, the line is the frame interval
+static void draw_perf_graph(int x, int y)
+{
+	unsigned short *dest, *d;
+	int i, j, c, py, f, top;
+
+	if (pl_vout_buf == NULL || pl_vout_bpp != 16 || y < 0
+	    || x + PERF_FRAMES > pl_vout_w || frame_interval <= 0)
+		return;
+
+	dest = (unsigned short *)pl_vout_buf + y * pl_vout_w + x;
+	for (j = 0; j < PERF_GRAPH_H; j++)
+		memset(dest + j * pl_vout_w, 0, PERF_FRAMES * 2);
+	for (i = 0; i < PERF_FRAMES; i++)
+		dest[(PERF_GRAPH_H / 2) * pl_vout_w + i] = 0x8410;
+
+	for (i = 0; i < PERF_FRAMES; i++) {
+		f = (perf.pos + i) % PERF_FRAMES;
+		d = dest + (PERF_GRAPH_H - 1) * pl_vout_w + i;
+		for (c = 0, py = 0; c < PERF_GPU_ASYNC; c++) {
+			top = py + perf.us[f][c] * PERF_GRAPH_H / 2 / frame_interval;
+			if (top > PERF_GRAPH_H)
+				top = PERF_GRAPH_H;
+			for (; py < top; py++)
+				d[-py * pl_vout_w] = perf_colors[c];
+		}
+		py = perf.us[f][PERF_GPU_ASYNC] * PERF_GRAPH_H / 2 / frame_interval;
+		if (0 < py && py <= PERF_GRAPH_H)
+			d[-(py - 1) * pl_vout_w] = perf_colors[PERF_GPU_ASYNC];
+	}
+}
+
+// averages over the graph, in 0.1ms
+static void print_perf(int h, int border)
+{
+	static const char names[PERF_CNT] = { 'e', 'g', 's', 'c', 'b', 'p', 'a' };
+	unsigned int sum[PERF_CNT] = { 0, };
+	char buf[PERF_CNT * 5 + 24], *b = buf;
+	int i, c, v;
+
+	for (i = 0; i < PERF_FRAMES; i++)
+		for (c = 0; c < PERF_CNT; c++)
+			sum[c] += perf.us[i][c];
+	for (c = 0; c < PERF_CNT; c++) {
+		v = sum[c] / PERF_FRAMES / 100;
+		b += snprintf(b, buf + sizeof(buf) - b, "%c%d ", names[c],
+			v < 999 ? v : 999);
+	}
+	if (pl_rearmed_cbs.gpu_tex_stats != NULL)
+		snprintf(b, buf + sizeof(buf) - b, "t%u+%u",
+			perf.tex[0] < 999 ? perf.tex[0] : 999,
+			perf.tex[1] < 999 ? perf.tex[1] : 999);
+	hud_print(pl_vout_buf, pl_vout_w, border + 2, h - HUD_HEIGHT * 3, buf);
+	draw_perf_graph(border + 2, h - HUD_HEIGHT * 3 - PERF_GRAPH_H - 2);
+}
+
+// new_dynarec_get_stats() deltas over the last second
+static struct ndrc_stats drc_stats, drc_stats_prev;
+
+static void drc_stats_update(void)
+{
+	struct ndrc_stats cur;
+
+	new_dynarec_get_stats(&cur);
+	drc_stats = cur;
+#define D(f) drc_stats.f = cur.f - drc_stats_prev.f
+	D(compiles); D(compiled_bytes); D(restores);
+	D(inv_smc); D(inv_dma); D(inv_reload); D(inv_prot);
+	D(lookups); D(ht_misses); D(ht_evictions);
+	D(thread_waits); D(tc_wraps);
+#undef D
+	drc_stats_prev = cur;
+}
+
+static void print_drc_stats(int border)
+{
+	const struct ndrc_stats *s = &drc_stats;
+
+	hud_printf(pl_vout_buf, pl_vout_w, border + 2, 2,
+		"drc c%4u %4uK i%4u/%4u/%4u r%4u", s->compiles,
+		s->compiled_bytes >> 10, s->inv_smc + s->inv_prot, s->inv_dma,
+		s->inv_reload, s->restores);
+	hud_printf(pl_vout_buf, pl_vout_w, border + 2, 2 + HUD_HEIGHT,
+		"ht %6u/%5u e%4u w%4u tc%3u%% %u", s->lookups, s->ht_misses,
+		s->ht_evictions, s->thread_waits,
+		s->tc_size ? (unsigned int)((uint64_t)s->tc_used * 100 / s->tc_size) : 0,
+		s->tc_wraps);
+}
+
+// helper thread wakeups per vsync over the last second, in 0.1 units
+static unsigned int twake_per_frame[TWAKE_COUNT];
+
+static void twake_update(int vsyncs)
+{
+	static unsigned int prev[TWAKE_COUNT];
+	unsigned int cur;
+	int i;
+
+	for (i = 0; i < TWAKE_COUNT; i++) {
+		cur = twake_counts[i];
+		twake_per_frame[i] = vsyncs > 0 ? (cur - prev[i]) * 10 / vsyncs : 0;
+		prev[i] = cur;
+	}
+}
+
+static void print_twake(int border)
+{
+	static const char names[TWAKE_COUNT] =
+		{ 'c', 'd', 'g', 'b', 's', 'h', 'm', 'v', 'j' };
+	char buf[TWAKE_COUNT * 10 + 8], *b = buf;
+	unsigned int v;
+	int i;
+
+	b += snprintf(b, sizeof(buf), "wake/f");
+	for (i = 0; i < TWAKE_COUNT; i++) {
+		v = twake_per_frame[i] < 9999 ? twake_per_frame[i] : 9999;
+		if (v != 0)
+			b += snprintf(b, buf + sizeof(buf) - b, " %c%u.%u",
+				names[i], v / 10, v % 10);
+	}
+	hud_print(pl_vout_buf, pl_vout_w, border + 2, 2 + HUD_HEIGHT * 2, buf);
+}
+
 static void print_hud(int x, int w, int h)
 {
 	if (h < 192)
@@ -175,8 +395,16 @@ static void print_hud(int x, int w, int h)
 	if (h > pl_vout_h)
 		h = pl_vout_h;
 
-	if (g_opts & OPT_SHOWSPU)
+	if (g_opts & OPT_SHOWSPU) {
 		draw_active_chans(w, h);
+		print_spu_prof(h, x);
+	}
+	if (g_opts & OPT_SHOWPERF) {
+		print_perf(h, x);
+		print_twake(x);
+	}
+	if (g_opts & OPT_SHOWDRC)
+		print_drc_stats(x);
 
 	if (hud_msg[0] != 0)
 		print_msg(h, x);
@@ -274,6 +502,8 @@ static void pl_vout_set_mode(int w, int h, int raw_w, int raw_h, int bpp)
 	const struct cspace_func_type *cspace_f = cspace_funcs;
 	int vout_w, vout_h, vout_bpp;
 
+	pl_present_sync();
+
 	// special h handling, Wipeout likes to change it by 1-6
 	static int vsync_cnt_ms_prev;
 	if ((unsigned int)(vsync_cnt - vsync_cnt_ms_prev) < 5*60)
@@ -346,12 +576,61 @@ static void pl_vout_set_mode(int w, int h, int raw_w, int raw_h, int bpp)
 
 static int flip_clear_counter;
 
+// below this the job handoff costs more than it saves
+#define BLIT_JOB_MIN_PIXELS (640 * 240)
+#define BLIT_JOBS_MAX 4
+
+struct blit_rows {
+	void (*blit)(void *dst, const void *src, int pixels);
+	unsigned char *dest;
+	const unsigned char *vram;
+	unsigned int vram_ofs, vram_mask;
+	int sstride, dpitch; // bytes
+	int pixels, h, count;
+};
+
+static void blit_rows_job(void *ctx, int i)
+{
+	const struct blit_rows *b = ctx;
+	int y = b->h * i / b->count, y1 = b->h * (i + 1) / b->count;
+
+	for (; y < y1; y++)
+		b->blit(b->dest + y * b->dpitch,
+			b->vram + ((b->vram_ofs + y * b->sstride) & b->vram_mask),
+			b->pixels);
+}
+
+// the row loop of a blit, large frames are split in row blocks over the
+// job workers, returns vram_ofs after the last row
+static unsigned int blit_rows(void (*blit)(void *dst, const void *src, int pixels),
+	unsigned char *dest, int dpitch, const unsigned char *vram,
+	unsigned int vram_ofs, unsigned int vram_mask, int sstride, int pixels, int h)
+{
+	struct blit_rows b = { blit, dest, vram, vram_ofs, vram_mask,
+		sstride, dpitch, pixels, h, 1 };
+
+	if (h <= 0)
+		return vram_ofs;
+#ifdef HAVE_RTHREADS
+	if (pixels * h >= BLIT_JOB_MIN_PIXELS) {
+		b.count = pcsxr_jobs_parallelism();
+		if (b.count > BLIT_JOBS_MAX)
+			b.count = BLIT_JOBS_MAX;
+	}
+	if (b.count > 1)
+		pcsxr_jobs_run(blit_rows_job, &b, b.count, PCSXRT_GPU);
+	else
+#endif
+	blit_rows_job(&b, 0);
+	return (vram_ofs + h * sstride) & vram_mask;
+}
+
 void pl_force_clear(void)
 {
 	flip_clear_counter = 2;
 }
 
-static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
+static void do_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 	int x, int y, int w, int h, int dims_changed)
 {
 	void (*blit)(void *dst, const void *src, int bytes);
@@ -363,6 +642,7 @@ static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 	int enhres = w > psx_w;
 	int xoffs = 0, doffs;
 	int hwrapped;
+	unsigned int t0 = perf_ticks(), t1;
 
 	pcnt_start(PCNT_BLIT);
 
@@ -375,6 +655,7 @@ static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 				dstride * h_full * pl_vout_bpp / 8);
 		goto out_hud;
 	}
+	emu_startup_done();
 
 	// offset
 	xoffs = x * pl_vout_scale_w;
@@ -416,10 +697,9 @@ static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 	{
 		hwrapped = (vram_ofs & 2047) + w * 3 - 2048;
 		if (pl_rearmed_cbs.only_16bpp) {
-			for (h1 = h; h1-- > 0; dest += dstride * 2) {
-				blit(dest, vram + vram_ofs, w);
-				vram_ofs = (vram_ofs + sstride) & 0xfffff;
-			}
+			vram_ofs = blit_rows(blit, dest, dstride * 2, vram, vram_ofs,
+				0xfffff, sstride, w, h);
+			dest += dstride * 2 * h;
 
 			if (hwrapped > 0) {
 				// this is super-rare so just fix-up
@@ -436,10 +716,9 @@ static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 			dest -= doffs * 2;
 			dest += (doffs / 8) * 24;
 
-			for (h1 = h; h1-- > 0; dest += dstride * 3) {
-				blit(dest, vram + vram_ofs, w);
-				vram_ofs = (vram_ofs + sstride) & 0xfffff;
-			}
+			vram_ofs = blit_rows(blit, dest, dstride * 3, vram, vram_ofs,
+				0xfffff, sstride, w, h);
+			dest += dstride * 3 * h;
 
 			if (hwrapped > 0) {
 				vram_ofs = (vram_ofs - h * sstride) & 0xff800;
@@ -488,10 +767,9 @@ static void pl_vout_flip(const void *vram_, int vram_ofs, int bgr24,
 	else
 	{
 		unsigned int vram_mask = enhres ? ~0 : 0xfffff;
-		for (h1 = h; h1-- > 0; dest += dstride * 2) {
-			blit(dest, vram + vram_ofs, w);
-			vram_ofs = (vram_ofs + sstride) & vram_mask;
-		}
+		vram_ofs = blit_rows(blit, dest, dstride * 2, vram, vram_ofs,
+			vram_mask, sstride, w, h);
+		dest += dstride * 2 * h;
 
 		hwrapped = (vram_ofs & 2047) + w * 2 - 2048;
 		if (!enhres && hwrapped > 0) {
@@ -512,10 +790,200 @@ out:
 	pcnt_end(PCNT_BLIT);
 
 	// let's flip now
+	t1 = perf_ticks();
 	pl_vout_buf = plat_gvideo_flip();
+	if (t0) {
+		perf.blit_us += t1 - t0;
+		perf.present_us += perf_ticks() - t1;
+	}
 
+	if (in_lat.csv != NULL) {
+		struct timeval now;
+		pl_get_time(&now);
+		fprintf(in_lat.csv, "flip,%lld,%d,,\n",
+			(long long)now.tv_sec * 1000000 + now.tv_usec, vsync_cnt);
+	}
+}
+
+#ifdef USE_ASYNC_PRESENT
+/*
+ * Presentation thread. The frame is copied out of vram into a free slot
+ * and the thread does the conversion, blit and flip, so a slow flip
+ * (vsync wait) no longer stalls emulation. A frame that's not picked up
+ * before the next one arrives is dropped, if nothing new comes the
+ * display just keeps (repeats) the last one. Only for platforms that set
+ * pl_plat_present_thread, which need their flip to work off the main
+ * thread.
+ */
+#define PRESENT_SLOTS 3
+
+struct present_slot {
+	unsigned char *vram;	// 1MB shadow, only the rows in use are valid
+	int vram_ofs, bgr24, x, y, w, h, dims_changed;
+	int blank;
+};
+
+static struct {
+	pthread_t tid;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct present_slot slot[PRESENT_SLOTS];
+	int pending, busy;	// slot index or -1
+	int running, quit;
+	unsigned int dropped;
+} present = { .pending = -1, .busy = -1 };
+
+static void *present_thread(void *unused)
+{
+	struct present_slot *s;
+
+	pthread_mutex_lock(&present.lock);
+	while (1) {
+		while (present.pending < 0 && !present.quit)
+			pthread_cond_wait(&present.cond, &present.lock);
+		if (present.quit)
+			break;
+		present.busy = present.pending;
+		present.pending = -1;
+		pthread_mutex_unlock(&present.lock);
+
+		s = &present.slot[present.busy];
+		do_vout_flip(s->blank ? NULL : s->vram, s->vram_ofs, s->bgr24,
+			s->x, s->y, s->w, s->h, s->dims_changed);
+
+		pthread_mutex_lock(&present.lock);
+		present.busy = -1;
+		pthread_cond_broadcast(&present.cond);
+	}
+	pthread_mutex_unlock(&present.lock);
+	return NULL;
+}
+
+// wait until everything queued is on screen, must be done before
+// anything else touches the display or pl_vout_buf
+void pl_present_sync(void)
+{
+	if (!present.running)
+		return;
+	pthread_mutex_lock(&present.lock);
+	while (present.pending >= 0 || present.busy >= 0)
+		pthread_cond_wait(&present.cond, &present.lock);
+	pthread_mutex_unlock(&present.lock);
+}
+
+static void present_start(void)
+{
+	int i, ret;
+
+	if (!pl_plat_present_thread || present.running)
+		return;
+	for (i = 0; i < PRESENT_SLOTS; i++) {
+		if (present.slot[i].vram == NULL)
+			present.slot[i].vram = malloc(1024 * 1024);
+		if (present.slot[i].vram == NULL) {
+			fprintf(stderr, "present: OOM\n");
+			return;
+		}
+	}
+	pthread_mutex_init(&present.lock, NULL);
+	pthread_cond_init(&present.cond, NULL);
+	present.pending = present.busy = -1;
+	present.quit = 0;
+	ret = pthread_create(&present.tid, NULL, present_thread, NULL);
+	if (ret != 0) {
+		fprintf(stderr, "could not start present thread: %d\n", ret);
+		pthread_cond_destroy(&present.cond);
+		pthread_mutex_destroy(&present.lock);
+		return;
+	}
+	present.running = 1;
+}
+
+static void present_stop(void)
+{
+	if (!present.running)
+		return;
+	pthread_mutex_lock(&present.lock);
+	present.quit = 1;
+	pthread_cond_broadcast(&present.cond);
+	pthread_mutex_unlock(&present.lock);
+	pthread_join(present.tid, NULL);
+	pthread_cond_destroy(&present.cond);
+	pthread_mutex_destroy(&present.lock);
+	present.running = 0;
+	if (present.dropped)
+		printf("present: %u frames dropped\n", present.dropped);
+	present.dropped = 0;
+}
+
+// whole 2048 byte lines, plus one above and below for the 2x filters
+static void copy_rows(unsigned char *dst, const unsigned char *vram,
+	int vram_ofs, int rows)
+{
+	int ofs = (vram_ofs & ~2047) - 2048;
+
+	for (rows += 2; rows-- > 0; ofs += 2048)
+		memcpy(dst + (ofs & 0xfffff), vram + (ofs & 0xfffff), 2048);
+}
+
+static void pl_vout_flip(const void *vram, int vram_ofs, int bgr24,
+	int x, int y, int w, int h, int dims_changed)
+{
+	struct present_slot *s;
+	int i;
+
+	pl_rearmed_cbs.flip_cnt++;
+	// -export gets native resolution frames only
+	if (vram == NULL || w <= psx_w)
+		shmx_video(vram, vram_ofs, bgr24, w, h, vsync_cnt);
+
+	// enhanced resolution buffers are not vram, just do it here
+	if (!present.running || (vram != NULL && w > psx_w)) {
+		pl_present_sync();
+		do_vout_flip(vram, vram_ofs, bgr24, x, y, w, h, dims_changed);
+		return;
+	}
+
+	pthread_mutex_lock(&present.lock);
+	for (i = 0; i < PRESENT_SLOTS; i++)
+		if (i != present.busy && i != present.pending)
+			break;
+	pthread_mutex_unlock(&present.lock);
+
+	s = &present.slot[i];
+	s->blank = vram == NULL;
+	if (!s->blank)
+		// the extra lines cover interlace and 2048 stride cases alike
+		copy_rows(s->vram, vram, vram_ofs, h);
+	s->vram_ofs = vram_ofs;
+	s->bgr24 = bgr24;
+	s->x = x; s->y = y; s->w = w; s->h = h;
+	s->dims_changed = dims_changed;
+
+	pthread_mutex_lock(&present.lock);
+	if (present.pending >= 0) {
+		// not shown yet, keep a dims change for the frame replacing it
+		s->dims_changed |= present.slot[present.pending].dims_changed;
+		present.dropped++;
+	}
+	present.pending = i;
+	pthread_cond_signal(&present.cond);
+	pthread_mutex_unlock(&present.lock);
+}
+#else
+void pl_present_sync(void) {}
+static void present_start(void) {}
+static void present_stop(void) {}
+
+static void pl_vout_flip(const void *vram, int vram_ofs, int bgr24,
+	int x, int y, int w, int h, int dims_changed)
+{
 	pl_rearmed_cbs.flip_cnt++;
+	if (vram == NULL || w <= psx_w)
+		shmx_video(vram, vram_ofs, bgr24, w, h, vsync_cnt);
+	do_vout_flip(vram, vram_ofs, bgr24, x, y, w, h, dims_changed);
 }
+#endif
 
 static int pl_vout_open(void)
 {
@@ -525,8 +993,9 @@ static int pl_vout_open(void)
 	pl_vout_buf = NULL;
 
 	plat_gvideo_open(is_pal);
+	present_start();
 
-	gettimeofday(&now, 0);
+	pl_get_time(&now);
 	vsync_usec_time = now.tv_usec;
 	while (vsync_usec_time >= frame_interval)
 		vsync_usec_time -= frame_interval;
@@ -536,6 +1005,7 @@ static int pl_vout_open(void)
 
 static void pl_vout_close(void)
 {
+	present_stop();
 	plat_gvideo_close();
 }
 
@@ -546,7 +1016,10 @@ static void pl_set_gpu_caps(int caps)
 
 void *pl_prepare_screenshot(int *w, int *h, int *bpp)
 {
-	void *ret = plat_prepare_screenshot(w, h, bpp);
+	void *ret;
+
+	pl_present_sync();
+	ret = plat_prepare_screenshot(w, h, bpp);
 	if (ret != NULL)
 		return ret;
 
@@ -696,13 +1169,23 @@ static void emu_set_action(enum sched_action action_)
 
 	if (action_ == SACTION_NONE)
 		emu_action_old = 0;
-	else if (action_ != emu_action_old)
+	else if (action_ != emu_action_old || action_ == SACTION_REWIND)
+		// rewind keeps stepping back for as long as it's held
 		psxRegs.stop++;
 	emu_action = action_;
 }
 
+static enum sched_action input_action;
+
+/* hotkeys stop the cpu, which must not happen from within a pad read */
+static void apply_input_action(void)
+{
+	emu_set_action(input_action);
+}
+
 static void update_input(void)
 {
+	static int rewind_frames;
 	int actions[IN_BINDTYPE_COUNT] = { 0, };
 	unsigned int emu_act;
 	int in_state_gun;
@@ -721,7 +1204,12 @@ static void update_input(void)
 			;
 		emu_act = which;
 	}
-	emu_set_action(emu_act);
+	else if (rewind_mb && rewind_interval > 0
+		 && ++rewind_frames >= rewind_interval) {
+		rewind_frames = 0;
+		emu_act = SACTION_REWIND_CAPTURE;
+	}
+	input_action = emu_act;
 
 	in_keystate[0] = actions[IN_BINDTYPE_PLAYER12] & 0xffff;
 	in_keystate[1] = (actions[IN_BINDTYPE_PLAYER12] >> 16) & 0xffff;
@@ -760,8 +1248,46 @@ static void update_input(void)
 }
 #else /* MAEMO */
 extern void update_input(void);
+static void apply_input_action(void) {}
 #endif
 
+/* input is sampled on the first pad read of each frame instead of at
+ * the vsync, so the game sees it up to a frame earlier */
+static int input_pending;
+
+static void sample_input(void)
+{
+	struct timeval now;
+
+	update_input();
+
+	if (!in_lat.tried) {
+		const char *path = getenv("PCSX_INPUT_LAT_CSV");
+		in_lat.tried = 1;
+		if (path != NULL && (in_lat.csv = fopen(path, "w")) != NULL)
+			fprintf(in_lat.csv, "event,time_us,vsync,pad1,pad2\n");
+	}
+	if (in_lat.csv == NULL)
+		return;
+	if (in_keystate[0] == in_lat.keys[0] && in_keystate[1] == in_lat.keys[1])
+		return;
+	in_lat.keys[0] = in_keystate[0];
+	in_lat.keys[1] = in_keystate[1];
+	pl_get_time(&now);
+	fprintf(in_lat.csv, "input,%lld,%d,%04x,%04x\n",
+		(long long)now.tv_sec * 1000000 + now.tv_usec, vsync_cnt,
+		in_keystate[0], in_keystate[1]);
+}
+
+/* called by the PAD plugin */
+void pl_pad_poll(void)
+{
+	if (input_pending) {
+		input_pending = 0;
+		sample_input();
+	}
+}
+
 void pl_gun_byte2(int port, unsigned char byte)
 {
 	if (!tsdev || in_type[port] != PSE_PAD_TYPE_GUN || !(byte & 0x10))
@@ -778,38 +1304,437 @@ void pl_gun_byte2(int port, unsigned char byte)
 #define tvdiff(tv, tv_old) \
 	((tv.tv_sec - tv_old.tv_sec) * 1000000 + tv.tv_usec - tv_old.tv_usec)
 
+/* headless benchmark, see -bench in main.c */
+static struct {
+	unsigned int frames, frames_left;
+	int instance; // -farm, -1 when not
+	FILE *input;
+	const char *input_file;
+	struct timeval tv_start;
+#ifdef PCNT
+	unsigned long long pcnt_sum[PCNT_CNT];
+#endif
+} bench;
+
+static int bench_vout_open(void)
+{
+	return 0;
+}
+
+static void bench_vout_set_mode(int w, int h, int raw_w, int raw_h, int bpp)
+{
+}
+
+static void bench_vout_flip(const void *vram, int vram_ofs, int bgr24,
+	int x, int y, int w, int h, int dims_changed)
+{
+	pl_rearmed_cbs.flip_cnt++;
+}
+
+static void bench_vout_close(void)
+{
+}
+
+/* recorded input: a little endian u16 keystate for each of 2 pads per
+ * frame, the last state is held once the stream ends */
+static void bench_input(void)
+{
+	unsigned char buf[4];
+
+	if (bench.input == NULL)
+		return;
+	if (fread(buf, 1, sizeof(buf), bench.input) != sizeof(buf))
+		return;
+	in_keystate[0] = buf[0] | (buf[1] << 8);
+	in_keystate[1] = buf[2] | (buf[3] << 8);
+}
+
+static void bench_frame(void)
+{
+#ifdef PCNT
+	int i;
+
+	pcnt_end(PCNT_ALL);
+	for (i = 0; i < PCNT_CNT; i++)
+		bench.pcnt_sum[i] += pcounters[i];
+	memset(pcounters, 0, sizeof(pcounters));
+#endif
+	if (bench.frames_left == bench.frames)
+		gettimeofday(&bench.tv_start, 0);
+	if (--bench.frames_left == 0)
+		emu_core_ask_exit();
+	bench_input();
+	pcnt_start(PCNT_ALL);
+}
+
+int pl_bench_init(unsigned int frames, const char *input_file)
+{
+	bench.instance = -1;
+	bench.input_file = input_file;
+	if (input_file != NULL) {
+		bench.input = fopen(input_file, "rb");
+		if (bench.input == NULL) {
+			perror(input_file);
+			return -1;
+		}
+	}
+	bench.frames = bench.frames_left = frames + 1;
+
+	pl_rearmed_cbs.pl_vout_open = bench_vout_open;
+	pl_rearmed_cbs.pl_vout_set_mode = bench_vout_set_mode;
+	pl_rearmed_cbs.pl_vout_flip = bench_vout_flip;
+	pl_rearmed_cbs.pl_vout_close = bench_vout_close;
+	pl_rearmed_cbs.frameskip = 0;
+	g_opts |= OPT_NO_FRAMELIM;
+	return 0;
+}
+
+/* another run over the same frames (and input), for -autotune */
+void pl_bench_restart(void)
+{
+	bench.frames_left = bench.frames;
+	pl_rearmed_cbs.flip_cnt = 0;
+	if (bench.input != NULL)
+		rewind(bench.input);
+#ifdef PCNT
+	memset(bench.pcnt_sum, 0, sizeof(bench.pcnt_sum));
+#endif
+}
+
+static double bench_seconds(void)
+{
+	struct timeval now;
+	double secs;
+
+	gettimeofday(&now, 0);
+	secs = tvdiff(now, bench.tv_start) / 1000000.0;
+	return secs > 0.0 ? secs : 1e-6;
+}
+
+/* emulated vs real time of the last run, 1.0 is full speed */
+double pl_bench_speed(void)
+{
+	unsigned int frames = bench.frames - 1 - bench.frames_left;
+
+	return frames / bench_seconds() / psxGetFps();
+}
+
+// after a fork, the inherited input stream shares its file offset
+void pl_bench_set_instance(int instance)
+{
+	bench.instance = instance;
+	if (bench.input != NULL) {
+		fclose(bench.input);
+		bench.input = fopen(bench.input_file, "rb");
+		if (bench.input == NULL)
+			perror(bench.input_file);
+	}
+}
+
+void pl_bench_print(void)
+{
+	unsigned int frames = bench.frames - 1 - bench.frames_left;
+	double secs = bench_seconds();
+
+	printf("{");
+	if (bench.instance >= 0)
+		printf("\"instance\": %d, ", bench.instance);
+	printf("\"frames\": %u, \"flips\": %u, \"seconds\": %.3f, "
+		"\"fps\": %.2f, \"speed\": %.3f",
+		frames, pl_rearmed_cbs.flip_cnt, secs,
+		frames / secs, frames / secs / psxGetFps());
+#ifdef PCNT
+	{
+		unsigned long long *t = bench.pcnt_sum;
+		unsigned long long cpu = t[PCNT_ALL] - t[PCNT_GPU] - t[PCNT_SPU]
+			- t[PCNT_BLIT] - t[PCNT_CDR];
+		printf(", \"time_%s\": {\"cpu_gte\": %llu, \"gte\": %llu, "
+			"\"gpu\": %llu, \"spu\": %llu, \"cd\": %llu, \"blit\": %llu}",
+			PCNT_DIV == 1 ? "us" : "cycles", cpu, t[PCNT_GTE],
+			t[PCNT_GPU], t[PCNT_SPU], t[PCNT_CDR], t[PCNT_BLIT]);
+	}
+#endif
+	printf("}\n");
+	fflush(stdout);
+}
+
+#ifdef PL_MONOTONIC
+static void pl_sleep(const struct timeval *now, int us)
+{
+	struct timespec target, ts;
+
+	target.tv_sec = now->tv_sec;
+	target.tv_nsec = (now->tv_usec + us) * 1000L;
+	while (target.tv_nsec >= 1000000000L) {
+		target.tv_nsec -= 1000000000L;
+		target.tv_sec++;
+	}
+	ts = target;
+	ts.tv_nsec -= SPIN_TAIL_US * 1000L;
+	if (ts.tv_nsec < 0) {
+		ts.tv_nsec += 1000000000L;
+		ts.tv_sec--;
+	}
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+	do
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	while (ts.tv_sec < target.tv_sec
+	       || (ts.tv_sec == target.tv_sec && ts.tv_nsec < target.tv_nsec));
+}
+#else
+#define pl_sleep(now, us) usleep(us)
+#endif
+
+/* to be called by the platform code right after a present that
+ * blocked for vblank, allows the frame limiter to lock onto it */
+void pl_vblank_report(void)
+{
+	struct timeval now;
+	int diff;
+
+	if (frame_interval == 0)
+		return;
+
+	pl_get_time(&now);
+	diff = now.tv_sec - vblank_tv.tv_sec < 2 ? tvdiff(now, vblank_tv) : 0;
+	vblank_tv = now;
+	// missed or doubled vblanks would only confuse the average
+	if (abs(diff - frame_interval) < frame_interval / 4)
+		vblank_interval = vblank_interval ? (vblank_interval * 7 + diff) / 8 : diff;
+	vsync_usec_time = now.tv_usec % frame_interval;
+}
+
+/* moving average emulation time of frames that were and weren't
+ * rendered, in usecs, for skipping a frame before it's late */
+static struct {
+	int cost[2], dev[2];
+} fskip_pred;
+
+static void fskip_pred_update(int rendered, int cost)
+{
+	int *c = &fskip_pred.cost[rendered];
+
+	if (cost < 0 || cost > MAX_LAG_FRAMES * frame_interval)
+		return;
+	if (*c == 0) {
+		*c = cost;
+		return;
+	}
+	fskip_pred.dev[rendered] += (abs(cost - *c) - fskip_pred.dev[rendered]) / 8;
+	*c += (cost - *c) / 8;
+}
+
 /* called on every vsync */
+// cost: the emu thread's busy time for the frame, -1 if unknown
+static void perf_sample(int cost)
+{
+	unsigned short *us = perf.us[perf.pos];
+	unsigned int v[PERF_CNT];
+	int c, emu = cost;
+
+	v[PERF_GPU] = pl_rearmed_cbs.gpu_us;
+	v[PERF_GPU_ASYNC] = pl_rearmed_cbs.gpu_async_us;
+	v[PERF_SPU] = spu_prof.chans + spu_prof.reverb + spu_prof.xa
+		+ spu_prof.out + spu_prof.wait;
+	v[PERF_CDR] = cdrGetReadTime();
+	v[PERF_BLIT] = perf.blit_us;
+	v[PERF_PRESENT] = perf.present_us;
+	pl_rearmed_cbs.gpu_us = pl_rearmed_cbs.gpu_async_us = 0;
+	perf.blit_us = perf.present_us = 0;
+	if (pl_rearmed_cbs.gpu_tex_stats != NULL) {
+		for (c = 0; c < 2; c++) {
+			perf.tex[c] = pl_rearmed_cbs.gpu_tex_stats[c] - perf.tex_prev[c];
+			perf.tex_prev[c] = pl_rearmed_cbs.gpu_tex_stats[c];
+		}
+	}
+
+	emu -= v[PERF_GPU] + v[PERF_SPU] + v[PERF_CDR];
+#ifdef USE_ASYNC_PRESENT
+	if (!present.running)
+#endif
+		emu -= v[PERF_BLIT] + v[PERF_PRESENT];
+	v[PERF_EMU] = emu > 0 ? emu : 0;
+
+	for (c = 0; c < PERF_CNT; c++)
+		us[c] = v[c] < 0xffff ? v[c] : 0xffff;
+	perf.pos = (perf.pos + 1) % PERF_FRAMES;
+
+	if (!perf.csv_tried) {
+		const char *path = getenv("PCSX_PERF_CSV");
+		perf.csv_tried = 1;
+		if (path != NULL && (perf.csv = fopen(path, "w")) != NULL)
+			fprintf(perf.csv, "vsync,total_us,emu_us,gpu_us,spu_us,cdr_us,"
+				"blit_us,present_us,gpu_async_us\n");
+	}
+	if (perf.csv != NULL) {
+		fprintf(perf.csv, "%d,%d", vsync_cnt, cost);
+		for (c = 0; c < PERF_CNT; c++)
+			fprintf(perf.csv, ",%u", v[c]);
+		fputc('\n', perf.csv);
+	}
+}
+
+// Adaptive psx clock: while the game misses frames it could make (its
+// flips come further apart than its usual cadence) and the host has time
+// to spare, the psx cpu runs faster, and goes back once the game keeps up
+// or the host gets busy. Changing the multiplier makes the dynarec start
+// over, so it's applied outside of psxCpu->Execute() and not often.
+#define BOOST_PCT	60	// of the cycle multiplier while boosted
+#define BOOST_WINDOW	240	// vsyncs the game's cadence is taken over
+#define BOOST_HOLD	180	// vsyncs between changes at least
+
+static struct {
+	int want, active;
+	int mult, base;		// Config.cycle_multiplier boosted and not
+	int since_flip, iv_min, iv_win_min;
+	int vsyncs, lags, calm, hold;
+	int cost_avg;
+} boost;
+
+static void cpu_boost_update(int flipped, int cost)
+{
+	int want = boost.want, budget;
+
+	if (boost.active && Config.cycle_multiplier != boost.mult)
+		boost.active = boost.want = 0; // changed in the menu
+	if (!(g_opts & OPT_CPU_BOOST) || pl_rearmed_cbs.fskip_advice
+	    || (g_opts & OPT_NO_FRAMELIM)) {
+		want = 0;
+		boost.lags = boost.calm = 0;
+		goto out;
+	}
+
+	if (cost >= 0)
+		boost.cost_avg += (cost - boost.cost_avg) / 8;
+	boost.since_flip++;
+	if (flipped) {
+		int iv = boost.since_flip;
+		boost.since_flip = 0;
+		// long gaps are static screens and loading, not lag
+		if (boost.iv_min && iv > boost.iv_min && iv <= 2 * boost.iv_min)
+			boost.lags++;
+		else if (boost.iv_min && iv == boost.iv_min)
+			boost.calm++;
+		if (!boost.iv_win_min || iv < boost.iv_win_min)
+			boost.iv_win_min = iv;
+		if (!boost.iv_min || iv < boost.iv_min)
+			boost.iv_min = iv;
+	}
+	if (++boost.vsyncs >= BOOST_WINDOW) {
+		boost.iv_min = boost.iv_win_min;
+		boost.iv_win_min = 0;
+		boost.vsyncs = 0;
+	}
+	if (boost.hold > 0) {
+		boost.hold--;
+		goto out;
+	}
+
+	budget = frame_interval;
+	if (!boost.active) {
+		// the boosted cpu will do more work per frame
+		if (boost.lags >= 4 && boost.cost_avg < budget * BOOST_PCT / 100)
+			want = 1;
+	}
+	else if (boost.cost_avg > budget * 9 / 10 || boost.calm >= 120)
+		want = 0;
+	if (boost.lags + boost.calm >= 120)
+		boost.lags = boost.calm = 0;
+out:
+	boost.want = want;
+#ifndef MAEMO
+	if (boost.want != boost.active && input_action == SACTION_NONE)
+		emu_set_action(SACTION_CPU_BOOST);
+#endif
+}
+
+// from do_emu_action(), outside of psxCpu->Execute()
+void pl_cpu_boost_apply(void)
+{
+	int m;
+
+	if (boost.want == boost.active)
+		return;
+	if (boost.want) {
+		boost.base = Config.cycle_multiplier;
+		m = Config.cycle_multiplier;
+		if (Config.cycle_multiplier_override && m == CYCLE_MULT_DEFAULT)
+			m = Config.cycle_multiplier_override;
+		m = m * BOOST_PCT / 100;
+		if (m == CYCLE_MULT_DEFAULT)
+			m--;
+		Config.cycle_multiplier = boost.mult = m > 10 ? m : 10;
+	}
+	else if (Config.cycle_multiplier == boost.mult)
+		Config.cycle_multiplier = boost.base;
+	boost.active = boost.want;
+	boost.hold = BOOST_HOLD;
+	boost.lags = boost.calm = 0;
+	psxCpu->ApplyConfig();
+}
+
 void pl_frame_limit(void)
 {
-	static struct timeval tv_old, tv_expect;
+	static struct timeval tv_old, tv_expect, tv_wake;
 	static int vsync_cnt_prev, drc_active_vsyncs;
-	struct timeval now;
-	int diff, usadj;
+	static int jitter_sum, jitter_cnt, jitter_top;
+	static unsigned int flip_cnt_prev;
+	static int cost_prev = -1;
+	struct timeval now, wake;
+	int diff, usadj, cost;
 
 	if (g_emu_resetting)
 		return;
 
 	vsync_cnt++;
 
-	/* doing input here because the pad is polled
-	 * thousands of times per frame for some reason */
-	update_input();
+	if (bench.frames_left) {
+		bench_frame();
+		return;
+	}
+
+	shmx_video_dup(vsync_cnt);
+
+	/* the game didn't read the pad this frame, hotkeys must still work */
+	pl_pad_poll();
+	apply_input_action();
+	input_pending = 1;
 
 	pcnt_end(PCNT_ALL);
-	gettimeofday(&now, 0);
+	pl_get_time(&now);
+
+	// the frame emulated before the last one was flipped in the
+	// meantime if it was rendered, that's when its kind becomes known
+	fskip_pred_update(pl_rearmed_cbs.flip_cnt != flip_cnt_prev, cost_prev);
+	cost = now.tv_sec - tv_wake.tv_sec < 2 ? tvdiff(now, tv_wake) : -1;
+	cost_prev = cost;
+	cpu_boost_update(pl_rearmed_cbs.flip_cnt != flip_cnt_prev, cost);
+
+	if (g_opts & (OPT_SHOWSPU | OPT_SHOWPERF))
+		spu_get_prof_info(&spu_prof);
+	if (pl_rearmed_cbs.perf_on)
+		perf_sample(cost);
+	pl_rearmed_cbs.perf_on = (g_opts & OPT_SHOWPERF) != 0;
 
 	if (now.tv_sec != tv_old.tv_sec) {
 		diff = tvdiff(now, tv_old);
 		pl_rearmed_cbs.vsps_cur = 0.0f;
 		if (0 < diff && diff < 2000000)
 			pl_rearmed_cbs.vsps_cur = 1000000.0f * (vsync_cnt - vsync_cnt_prev) / diff;
+		if (g_opts & OPT_SHOWPERF)
+			twake_update(vsync_cnt - vsync_cnt_prev);
 		vsync_cnt_prev = vsync_cnt;
 
 		if (g_opts & OPT_SHOWFPS)
 			pl_rearmed_cbs.flips_per_sec = pl_rearmed_cbs.flip_cnt;
+		metrics_second(pl_rearmed_cbs.vsps_cur, pl_rearmed_cbs.flip_cnt);
 		pl_rearmed_cbs.flip_cnt = 0;
 		if (g_opts & OPT_SHOWCPU)
 			pl_rearmed_cbs.cpu_usage = get_cpu_ticks();
+		jitter_avg = jitter_cnt ? jitter_sum / jitter_cnt : 0;
+		jitter_max = jitter_top;
+		jitter_sum = jitter_cnt = jitter_top = 0;
 
 		if (hud_new_msg > 0) {
 			hud_new_msg--;
@@ -817,8 +1742,10 @@ void pl_frame_limit(void)
 				hud_msg[0] = 0;
 		}
 		tv_old = now;
-		//new_dynarec_print_stats();
+		if (g_opts & OPT_SHOWDRC)
+			drc_stats_update();
 	}
+	flip_cnt_prev = pl_rearmed_cbs.flip_cnt;
 #ifdef PCNT
 	static int ya_vsync_count;
 	if (++ya_vsync_count == PCNT_FRAMES) {
@@ -833,6 +1760,29 @@ void pl_frame_limit(void)
 		tv_expect.tv_usec -= (1000000 << 10);
 		tv_expect.tv_sec++;
 	}
+
+	// pull the schedule towards the display's vblank when it runs at
+	// (nearly) our rate, so that frames don't drift across it
+	if (vblank_interval && abs(vblank_interval - frame_interval) < frame_interval / 128
+	    && now.tv_sec - vblank_tv.tv_sec < 2
+	    && tvdiff(now, vblank_tv) < 2 * frame_interval)
+	{
+		int phase = ((vblank_tv.tv_sec - tv_expect.tv_sec) * 1000000
+			+ vblank_tv.tv_usec - (tv_expect.tv_usec >> 10)) % frame_interval;
+		if (phase > frame_interval / 2)
+			phase -= frame_interval;
+		else if (phase < -frame_interval / 2)
+			phase += frame_interval;
+		tv_expect.tv_usec += (phase << 10) / 16;
+		if (tv_expect.tv_usec < 0) {
+			tv_expect.tv_usec += (1000000 << 10);
+			tv_expect.tv_sec--;
+		}
+		else if (tv_expect.tv_usec >= (1000000 << 10)) {
+			tv_expect.tv_usec -= (1000000 << 10);
+			tv_expect.tv_sec++;
+		}
+	}
 	diff = (tv_expect.tv_sec - now.tv_sec) * 1000000 + (tv_expect.tv_usec >> 10) - now.tv_usec;
 
 	if (diff > MAX_LAG_FRAMES * frame_interval || diff < -MAX_LAG_FRAMES * frame_interval) {
@@ -847,14 +1797,37 @@ void pl_frame_limit(void)
 	}
 
 	if (!(g_opts & OPT_NO_FRAMELIM) && diff > frame_interval) {
-		// yay for working usleep on pandora!
-		//printf("usleep %d\n", diff - frame_interval / 2);
-		usleep(diff - frame_interval);
+		//printf("sleep %d\n", diff - frame_interval);
+		pl_sleep(&now, diff - frame_interval);
+	}
+
+	pl_get_time(&wake);
+	if (g_opts & OPT_SHOWFPS) {
+		int dev = wake.tv_sec - tv_wake.tv_sec < 2
+			? abs(tvdiff(wake, tv_wake) - frame_interval) : INT_MAX;
+		if (dev < MAX_LAG_FRAMES * frame_interval) {
+			jitter_sum += dev;
+			jitter_cnt++;
+			if (dev > jitter_top)
+				jitter_top = dev;
+		}
 	}
+	tv_wake = wake;
+	metrics_frame(cost, diff < -frame_interval);
 
 	if (pl_rearmed_cbs.frameskip) {
+		// time the next frame has before it's late
+		int avail = diff - tvdiff(wake, now);
+		int need = fskip_pred.cost[1] + fskip_pred.dev[1];
+		// skipping only saves the rendering, but that's all the
+		// time there is to save when waiting on the gpu thread
+		int skip_helps = pl_rearmed_cbs.gpu_async_waits != 0
+			|| fskip_pred.cost[0] + fskip_pred.dev[0] < avail;
+
 		if (diff < -frame_interval)
 			pl_rearmed_cbs.fskip_advice = 1;
+		else if (need > avail && skip_helps)
+			pl_rearmed_cbs.fskip_advice = 1;
 		else if (diff >= 0)
 			pl_rearmed_cbs.fskip_advice = 0;
 
@@ -869,6 +1842,7 @@ void pl_frame_limit(void)
 			drc_active_vsyncs = 0;
 		ndrc_g.did_compile = 0;
 	}
+	pl_rearmed_cbs.gpu_async_waits = 0;
 
 	pcnt_start(PCNT_ALL);
 }
@@ -988,12 +1962,17 @@ void pl_start_watchdog(void)
 static void *pl_emu_mmap(unsigned long addr, size_t size,
 	enum psxMapTag tag, int *can_retry_addr)
 {
+	void *ret;
+
 	*can_retry_addr = 1;
-	return plat_mmap(addr, size, 0, 0);
+	ret = plat_mmap(addr, size, 0, 0);
+	psxMapAdviseHuge(ret, size, tag);
+	return ret;
 }
 
 static void pl_emu_munmap(void *ptr, size_t size, enum psxMapTag tag)
 {
+	psxMapForgetHuge(ptr);
 	plat_munmap(ptr, size);
 }
 
@@ -41,11 +41,21 @@ void *pl_prepare_screenshot(int *w, int *h, int *bpp);
 void  pl_init(void);
 void  pl_switch_dispmode(void);
 void  pl_force_clear(void);
+void  pl_present_sync(void);
 
 void  pl_timing_prepare(int is_pal);
 void  pl_frame_limit(void);
+void  pl_cpu_boost_apply(void);
+void  pl_vblank_report(void);
+void  pl_pad_poll(void);
 void  pl_update_layer_size(int w, int h, int fw, int fh);
 
+int   pl_bench_init(unsigned int frames, const char *input_file);
+void  pl_bench_restart(void);
+double pl_bench_speed(void);
+void  pl_bench_print(void);
+void  pl_bench_set_instance(int instance);
+
 // for communication with gpulib
 struct rearmed_cbs {
 	void  (*pl_get_layer_pos)(int *x, int *y, int *w, int *h);
@@ -73,18 +83,30 @@ struct rearmed_cbs {
 	int   fskip_advice;
 	int   fskip_force;
 	int   fskip_dirty;
+	int   vout_skip; // no scanout, for replayed run-ahead/rollback frames
+	unsigned int gpu_async_waits; // emu thread had to wait for the gpu thread
+	// perf graph, gpulib adds the usecs it spends while perf_on is set
+	int perf_on;
+	unsigned int gpu_us, gpu_async_us;
 	unsigned int *gpu_frame_count;
 	unsigned int *gpu_hcnt;
+	const unsigned int *gpu_tex_stats; // set by gpu_neon, texture cache page/partial expansions
+	// gp0/gp1 stream capture for gpulib/test_bench.sh, gpulib starts on
+	// the next vsync and clears gpu_record_frames when done
+	int gpu_record_frames;
+	const char *gpu_record_path;
 	unsigned int flip_cnt; // increment manually if not using pl_vout_flip
 	unsigned int only_16bpp; // platform is 16bpp-only
 	unsigned int thread_rendering;
+	unsigned int thread_frames; // scan out the previous frame, the gpu thread draws the next
 	unsigned int dithering; // 0 off, 1 on, 2 force
 	unsigned int scale_hires;
 	struct {
-		int   allow_interlace; // 0 off, 1 on, 2 guess
+		int   allow_interlace; // 0 off, 1 on, 2 guess, 3 fields (skip the other field)
 		int   enhancement_enable;
 		int   enhancement_no_main;
 		int   enhancement_tex_adj;
+		int   render_bands; // threads sharing the drawing area, 1 is off
 	} gpu_neon;
 	struct {
 		int   dwActFixes;
@@ -97,12 +119,14 @@ struct rearmed_cbs {
 		int lighting;
 		int fast_lighting;
 		int blending;
+		int render_bands; // as gpu_neon.render_bands
 	} gpu_unai;
 	struct {
 		int   dwActFixes;
 		int   bDrawDither, iFilterType, iFrameTexType;
 		int   iUseMask, bOpaquePass, bAdvancedBlend, bUseFastMdec;
-		int   iVRamSize, iTexGarbageCollection;
+		int   iVRamSize, iTexGarbageCollection, iTexContentHash;
+		int   iTexConvThread, iUseFBO, iGLThread;
 	} gpu_peopsgl;
 	// misc
 	int gpu_caps;
@@ -128,6 +152,7 @@ extern void (*pl_plat_clear)(void);
 extern void (*pl_plat_blit)(int doffs, const void *src,
 			    int w, int h, int sstride, int bgr24);
 extern void (*pl_plat_hud_print)(int x, int y, const char *str, int bpp);
+extern int pl_plat_present_thread;
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
@@ -0,0 +1,186 @@
+/*
+ * Shared memory frame and audio export, see shm_export.h
+ *
+ * This work is licensed under the terms of the GNU GPLv2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "shm_export.h"
+
+extern void SysPrintf(const char *fmt, ...);
+
+#define SLOT_SIZE	(sizeof(struct shmx_frame) + SHMX_VIDEO_BYTES)
+#define HEADER_SIZE	4096
+#define TOTAL_SIZE	(HEADER_SIZE + SHMX_VIDEO_SLOTS * SLOT_SIZE + SHMX_AUDIO_BYTES)
+
+static struct {
+	struct shmx_header *hdr;
+	unsigned char *audio;
+	char name[64];
+	// the gpu/present thread flips, the emu thread reports the dups
+	pthread_mutex_t lock;
+	int flipped;
+} shmx = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t shmx_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int shmx_start(const char *name)
+{
+	struct shmx_header *h;
+	void *p;
+	int fd;
+
+	shmx_stop();
+	snprintf(shmx.name, sizeof(shmx.name), "/%s", name);
+	fd = shm_open(shmx.name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(shmx.name);
+		return -1;
+	}
+	if (ftruncate(fd, TOTAL_SIZE) != 0) {
+		perror("shmx: ftruncate");
+		close(fd);
+		shm_unlink(shmx.name);
+		return -1;
+	}
+	p = mmap(NULL, TOTAL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		perror("shmx: mmap");
+		shm_unlink(shmx.name);
+		return -1;
+	}
+
+	h = p;
+	h->version = SHMX_VERSION;
+	h->header_size = HEADER_SIZE;
+	h->slot_size = SLOT_SIZE;
+	h->slots = SHMX_VIDEO_SLOTS;
+	h->audio_offset = HEADER_SIZE + SHMX_VIDEO_SLOTS * SLOT_SIZE;
+	h->audio_size = SHMX_AUDIO_BYTES;
+	// last, a reader may be polling for it
+	__atomic_store_n(&h->magic, SHMX_MAGIC, __ATOMIC_RELEASE);
+	shmx.audio = (unsigned char *)p + h->audio_offset;
+	shmx.hdr = h;
+	SysPrintf("shmx: exporting to shm %s, %u bytes\n", shmx.name,
+		(unsigned int)TOTAL_SIZE);
+	return 0;
+}
+
+void shmx_stop(void)
+{
+	if (shmx.hdr == NULL)
+		return;
+	munmap(shmx.hdr, TOTAL_SIZE);
+	shm_unlink(shmx.name);
+	shmx.hdr = NULL;
+}
+
+static struct shmx_frame *slot_begin(unsigned int n)
+{
+	struct shmx_frame *f = (void *)((unsigned char *)shmx.hdr + HEADER_SIZE
+		+ (n % SHMX_VIDEO_SLOTS) * SLOT_SIZE);
+
+	__atomic_store_n(&f->seq, n * 2 + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return f;
+}
+
+static void slot_end(struct shmx_frame *f, unsigned int n)
+{
+	__atomic_store_n(&f->seq, n * 2 + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&shmx.hdr->frame_seq, n + 1, __ATOMIC_RELEASE);
+}
+
+// the displayed rows only, vram lines are 2048 bytes and wrap at 1MB
+void shmx_video(const void *vram, int vram_ofs, int bgr24, int w, int h,
+	unsigned int vsync)
+{
+	const unsigned char *src = vram;
+	struct shmx_frame *f;
+	unsigned char *dst;
+	unsigned int n;
+	int row_bytes;
+
+	if (shmx.hdr == NULL)
+		return;
+	row_bytes = w * (bgr24 ? 3 : 2);
+	if (row_bytes > 2048)
+		row_bytes = 2048;
+	if (h * row_bytes > SHMX_VIDEO_BYTES)
+		h = SHMX_VIDEO_BYTES / row_bytes;
+
+	pthread_mutex_lock(&shmx.lock);
+	n = shmx.hdr->frame_seq;
+	f = slot_begin(n);
+	f->flags = (vram == NULL ? SHMX_F_BLANK : 0) | (bgr24 ? SHMX_F_BGR24 : 0);
+	f->w = w;
+	f->h = vram == NULL ? 0 : h;
+	f->stride = row_bytes;
+	f->vsync = vsync;
+	f->ns = shmx_now();
+	dst = (unsigned char *)(f + 1);
+	for (; vram != NULL && h-- > 0; vram_ofs += 2048, dst += row_bytes)
+		memcpy(dst, src + (vram_ofs & 0xfffff), row_bytes);
+	slot_end(f, n);
+	shmx.flipped = 1;
+	pthread_mutex_unlock(&shmx.lock);
+}
+
+void shmx_video_dup(unsigned int vsync)
+{
+	struct shmx_frame *f;
+	unsigned int n;
+
+	if (shmx.hdr == NULL)
+		return;
+	pthread_mutex_lock(&shmx.lock);
+	if (!shmx.flipped) {
+		n = shmx.hdr->frame_seq;
+		f = slot_begin(n);
+		f->flags = SHMX_F_DUP;
+		f->w = f->h = f->stride = 0;
+		f->vsync = vsync;
+		f->ns = shmx_now();
+		slot_end(f, n);
+	}
+	shmx.flipped = 0;
+	pthread_mutex_unlock(&shmx.lock);
+}
+
+// single writer (the thread feeding the sound driver)
+void shmx_audio(const void *data, int bytes, int rate)
+{
+	struct shmx_header *h = shmx.hdr;
+	uint64_t wpos;
+	unsigned int ofs, n;
+
+	if (h == NULL || bytes <= 0)
+		return;
+	if (bytes > SHMX_AUDIO_BYTES) {
+		data = (const char *)data + bytes - SHMX_AUDIO_BYTES;
+		bytes = SHMX_AUDIO_BYTES;
+	}
+	h->audio_rate = rate;
+	wpos = h->audio_wpos;
+	ofs = wpos & (SHMX_AUDIO_BYTES - 1);
+	n = SHMX_AUDIO_BYTES - ofs;
+	if (n > (unsigned int)bytes)
+		n = bytes;
+	memcpy(shmx.audio + ofs, data, n);
+	memcpy(shmx.audio, (const char *)data + n, bytes - n);
+	h->audio_ns = shmx_now();
+	__atomic_store_n(&h->audio_wpos, wpos + bytes, __ATOMIC_RELEASE);
+}
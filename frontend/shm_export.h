@@ -0,0 +1,71 @@
+#ifndef __SHM_EXPORT_H__
+#define __SHM_EXPORT_H__
+
+/*
+ * Publishes the finished frames (as they are in vram, before any scaling)
+ * and the spu output into a POSIX shared memory object for an external
+ * encoder to read, see the layout below. Built with USE_SHM_EXPORT,
+ * enabled by -export NAME. The writer never waits for the reader, a slow
+ * reader just sees gaps (frame seq, audio position) it can detect.
+ */
+
+#include <stdint.h>
+
+#define SHMX_MAGIC		0x58534350 // "PCSX"
+#define SHMX_VERSION		1
+#define SHMX_VIDEO_SLOTS	4
+#define SHMX_VIDEO_BYTES	(1024 * 512 * 3)
+#define SHMX_AUDIO_BYTES	(256 * 1024) // power of 2
+
+enum {
+	SHMX_F_DUP   = 1 << 0,	// no new frame this vsync, repeat the last one
+	SHMX_F_BLANK = 1 << 1,	// display off, no pixels
+	SHMX_F_BGR24 = 1 << 2,	// 24bpp rgb bytes, else psx 1555 (r in the low bits)
+};
+
+// seq is odd while the writer is filling the slot, a reader copies the
+// pixels and checks seq didn't change meanwhile
+struct shmx_frame {
+	uint32_t seq;
+	uint32_t flags;
+	uint32_t w, h;		// pixels
+	uint32_t stride;	// bytes
+	uint32_t vsync;		// emulated frame number
+	uint64_t ns;		// CLOCK_MONOTONIC
+};
+
+struct shmx_header {
+	uint32_t magic, version;
+	uint32_t header_size;		// offset of the first slot
+	uint32_t slot_size;		// struct shmx_frame + SHMX_VIDEO_BYTES
+	uint32_t slots;
+	uint32_t audio_offset, audio_size;
+	uint32_t audio_rate;		// s16 stereo interleaved
+	uint32_t frame_seq;		// frames published, slot is seq % slots
+	uint32_t pad;
+	uint64_t audio_wpos;		// bytes written in total, mod audio_size
+	uint64_t audio_ns;		// when audio_wpos was last advanced
+};
+
+#ifdef USE_SHM_EXPORT
+
+int  shmx_start(const char *name);
+void shmx_stop(void);
+void shmx_video(const void *vram, int vram_ofs, int bgr24, int w, int h,
+	unsigned int vsync);
+// vsync without a flip
+void shmx_video_dup(unsigned int vsync);
+void shmx_audio(const void *data, int bytes, int rate);
+
+#else
+
+static inline int  shmx_start(const char *name) { return -1; }
+static inline void shmx_stop(void) {}
+static inline void shmx_video(const void *vram, int vram_ofs, int bgr24,
+	int w, int h, unsigned int vsync) {}
+static inline void shmx_video_dup(unsigned int vsync) {}
+static inline void shmx_audio(const void *data, int bytes, int rate) {}
+
+#endif
+
+#endif /* __SHM_EXPORT_H__ */
@@ -115,6 +115,7 @@ EGLContext eglCreateContext(EGLDisplay dpy, EGLConfig config,
 EGLBoolean eglMakeCurrent(EGLDisplay dpy, EGLSurface draw,
                           EGLSurface read, EGLContext ctx);
 EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface surface);
+EGLContext eglGetCurrentContext(void);
 EGLBoolean eglDestroyContext(EGLDisplay dpy, EGLContext ctx);
 EGLBoolean eglDestroySurface(EGLDisplay dpy, EGLSurface surface);
 EGLint eglGetError(void);
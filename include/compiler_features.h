@@ -9,12 +9,14 @@
 #  define noinline       __attribute__((noinline,noclone))
 # endif
 # define attr_unused     __attribute__((unused))
+# define attr_aligned(n) __attribute__((aligned(n)))
 #else
 # define likely(x)       (x)
 # define unlikely(x)     (x)
 # define preload         (x)
 # define noinline
 # define attr_unused
+# define attr_aligned(n)
 #endif
 
 // doesn't work on Android, mingw...
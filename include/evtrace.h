@@ -0,0 +1,58 @@
+#ifndef __EVTRACE_H__
+#define __EVTRACE_H__
+
+/*
+ * Begin/end events from the emu, gpu, spu and cdrom threads, timestamped
+ * into one ring buffer that can be saved as Chrome/Perfetto trace JSON
+ * (chrome://tracing, ui.perfetto.dev). Built with USE_EVTRACE, off until
+ * evtrace_start(), a single load and branch per site when off.
+ */
+
+enum evtrace_id {
+	EVT_EVENT,	// irq_test() handler, arg: PSXINT_*
+	EVT_DMA0,	// psxDma0..6 started by chcr/pcr writes, arg: madr
+	EVT_DMA1,
+	EVT_DMA2,
+	EVT_DMA3,
+	EVT_DMA4,
+	EVT_DMA5,
+	EVT_DMA6,
+	EVT_GPU_CMD,	// a do_cmd_buffer() or gpu thread batch, arg: words
+	EVT_GPU_WAIT,	// blocked on the gpu thread, arg: wait mode
+	EVT_VOUT,	// vout_update()
+	EVT_SPU,	// do_samples(), arg: samples
+	EVT_SPU_WORK,	// channel work on the spu thread, arg: samples
+	EVT_CDR_READ,	// sector read for the emulated drive, arg: lba
+	EVT_CDR_CACHE,	// cdrom-async prefetch read, arg: lba
+	EVT_COUNT
+};
+
+#ifdef USE_EVTRACE
+
+extern int evtrace_on;
+
+void evtrace_add(int id, int ph, unsigned int arg);
+int  evtrace_start(void);
+void evtrace_stop(void);
+int  evtrace_dump(const char *path);
+
+#define evtrace_begin(id, arg) do { \
+	if (evtrace_on) evtrace_add(id, 'B', arg); \
+} while (0)
+
+#define evtrace_end(id) do { \
+	if (evtrace_on) evtrace_add(id, 'E', 0); \
+} while (0)
+
+#else
+
+#define evtrace_begin(id, arg)
+#define evtrace_end(id)
+
+static inline int  evtrace_start(void) { return -1; }
+static inline void evtrace_stop(void) {}
+static inline int  evtrace_dump(const char *path) { return -1; }
+
+#endif
+
+#endif /* __EVTRACE_H__ */
@@ -7,12 +7,16 @@ enum pcounters {
 	PCNT_SPU,
 	PCNT_BLIT,
 	PCNT_GTE,
+	PCNT_CDR,
 	PCNT_TEST,
 	PCNT_CNT
 };
 
 #ifdef PCNT
 
+#include <stdio.h>
+#include <string.h>
+
 #if defined(__ARM_ARCH_7A__) || defined(ARM1176)
 #define PCNT_DIV 1000
 #else
@@ -20,7 +24,7 @@ enum pcounters {
 #define PCNT_DIV 1
 #endif
 
-static const char *pcnt_names[PCNT_CNT] = { "", "gpu", "spu", "blit", "gte", "test" };
+static const char *pcnt_names[PCNT_CNT] = { "", "gpu", "spu", "blit", "gte", "cdr", "test" };
 
 #define PCNT_FRAMES 10
 
@@ -0,0 +1,34 @@
+#ifndef __THREAD_WAKEUPS_H__
+#define __THREAD_WAKEUPS_H__
+
+/*
+ * How often each kind of helper thread came out of its idle wait. The
+ * helpers park on their own cond var or semaphore without a timeout, so
+ * every count here should be one that brought work along. The frontend
+ * turns these into wakeups per frame (perf hud, metrics). Storage is in
+ * libpcsxcore/psxcommon.c.
+ */
+
+enum twake_id {
+	TWAKE_CDR,	// cdrom-async prefetch
+	TWAKE_DRC,	// ari64 compile thread
+	TWAKE_GPU,	// gpu_async thread
+	TWAKE_GPU_BAND,	// gpu_neon band threads
+	TWAKE_SPU,	// spu worker
+	TWAKE_SPU_HELPER,
+	TWAKE_MCD,	// memcard writeback
+	TWAKE_STATE,	// savestate writer
+	TWAKE_JOB,	// shared job workers
+	TWAKE_COUNT
+};
+
+extern unsigned int twake_counts[TWAKE_COUNT];
+
+#ifdef __GNUC__
+#define twake_count(id) \
+	__atomic_fetch_add(&twake_counts[id], 1, __ATOMIC_RELAXED)
+#else
+#define twake_count(id) twake_counts[id]++
+#endif
+
+#endif /* __THREAD_WAKEUPS_H__ */
@@ -8,6 +8,7 @@ $(shell cd "$(LOCAL_PATH)" && (rm ../include/revision.h_))
 USE_LIBRETRO_VFS ?= 0
 USE_ASYNC_CDROM ?= 1
 USE_ASYNC_GPU ?= 1
+USE_ASYNC_MDEC ?= 1
 USE_RTHREADS ?= 0
 NDRC_THREAD ?= 1
 
@@ -46,7 +47,9 @@ SOURCES_C := $(CORE_DIR)/cdriso.c \
              $(CORE_DIR)/psxhw.c \
              $(CORE_DIR)/psxinterpreter.c \
              $(CORE_DIR)/psxmem.c \
+             $(CORE_DIR)/psxprof.c \
              $(CORE_DIR)/r3000a.c \
+             $(CORE_DIR)/rewind.c \
              $(CORE_DIR)/sio.c \
              $(CORE_DIR)/spu.c \
              $(CORE_DIR)/gpu.c \
@@ -238,6 +241,10 @@ ifeq ($(USE_ASYNC_CDROM),1)
 COREFLAGS += -DUSE_ASYNC_CDROM
 USE_RTHREADS := 1
 endif
+ifeq ($(USE_ASYNC_MDEC),1)
+COREFLAGS += -DUSE_ASYNC_MDEC
+USE_RTHREADS := 1
+endif
 ifeq ($(USE_ASYNC_GPU),1)
 SOURCES_C += $(GPU_DIR)/gpu_async.c
 COREFLAGS += -DUSE_ASYNC_GPU
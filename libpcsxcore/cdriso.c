@@ -29,6 +29,9 @@
 #include <zlib.h>
 #ifdef HAVE_CHD
 #include <libchdr/chd.h>
+// libchdr brings zstd along, so cbin can use it too
+#include <zstd.h>
+#define HAVE_CBIN_ZSTD
 #endif
 
 #ifdef _WIN32
@@ -49,6 +52,11 @@
 #define rewind(f_) rfseek(f_, 0, SEEK_SET)
 #endif
 
+#if P_HAVE_MMAP && !defined(_WIN32) && !defined(USE_LIBRETRO_VFS)
+#include <sys/mman.h>
+#define HAVE_IMG_MMAP
+#endif
+
 #define OFF_T_MSB ((off_t)1 << (sizeof(off_t) * 8 - 1))
 
 unsigned int cdrIsoMultidiskCount;
@@ -66,26 +74,51 @@ static unsigned char cdbuffer[CD_FRAMESIZE_RAW];
 
 static boolean cddaBigEndian = FALSE;
 
+// the open image, for iso_pool_put()
+static char iso_fname[MAXPATHLEN];
+static unsigned int iso_select;
+static int iso_pool_max; // see cdrIsoSetPoolSize()
+
 // compressed image stuff
-static struct {
-	unsigned char buff_raw[16][CD_FRAMESIZE_RAW];
+// several blocks are kept so that interleaved reads (like the readahead
+// thread and the emu running elsewhere) don't inflate the same block again
+#define COMPR_CACHE_BLOCKS 4
+
+static struct compr_state {
+	unsigned char buff_raw[COMPR_CACHE_BLOCKS][16][CD_FRAMESIZE_RAW];
 	unsigned char buff_compressed[CD_FRAMESIZE_RAW * 16 + 100];
 	off_t *index_table;
 	unsigned int index_len;
 	unsigned int block_shift;
-	unsigned int current_block;
+	unsigned int current_block[COMPR_CACHE_BLOCKS];
+	unsigned int block_used[COMPR_CACHE_BLOCKS]; // for lru
+	unsigned int use_counter;
+	unsigned int current_slot;
 	unsigned int sector_in_blk;
+	unsigned int codec;
 } *compr_img;
 
+// block codecs, cbin keeps it in rsv_06[0] of the header
+enum {
+	CODEC_DEFLATE = 0,
+	CODEC_ZSTD = 1,
+};
+
 #ifdef HAVE_CHD
-static struct {
+// decompressed hunks kept around, ~19k each for the usual 8 sector hunks
+#define CHD_CACHE_HUNKS 8
+
+static struct chd_state {
 	unsigned char *buffer;
 	chd_file* chd;
 	const chd_header* header;
 	unsigned int sectors_per_hunk;
-	unsigned int current_hunk[2];
+	unsigned int current_hunk[CHD_CACHE_HUNKS];
+	unsigned int hunk_used[CHD_CACHE_HUNKS]; // for lru
+	unsigned int use_counter;
 	unsigned int current_buffer;
 	unsigned int sector_in_hunk;
+	unsigned int hits, misses;
 } *chd_img;
 #else
 #define chd_img 0
@@ -95,6 +128,9 @@ static int (*cdimg_read_func)(FILE *f, unsigned int base, void *dest, int sector
 static int (*cdimg_read_sub_func)(FILE *f, int sector, void *dest);
 
 static void DecodeRawSubData(unsigned char *subbuffer);
+static void iso_close_current(void);
+static int  iso_pool_put(void);
+static int  iso_pool_take(const char *fname);
 
 struct trackinfo {
 	enum cdrType type;
@@ -880,7 +916,7 @@ static int handlepbp(const char *isofile) {
 		goto fail_io;
 
 	compr_img->block_shift = 4;
-	compr_img->current_block = (unsigned int)-1;
+	memset(compr_img->current_block, 0xff, sizeof(compr_img->current_block));
 
 	compr_img->index_len = (0x100000 - 0x4000) / sizeof(index_entry);
 	compr_img->index_table = malloc((compr_img->index_len + 1) * sizeof(compr_img->index_table[0]));
@@ -933,7 +969,7 @@ static int handlecbin(const char *isofile) {
 		unsigned int block_size;
 		unsigned char ver;		// 1
 		unsigned char align;
-		unsigned char rsv_06[2];
+		unsigned char rsv_06[2];	// [0] - codec (psxcimg)
 	} ciso_hdr;
 	const char *ext = NULL;
 	unsigned int *index_table = NULL;
@@ -955,6 +991,14 @@ static int handlecbin(const char *isofile) {
 		SysPrintf("bad ciso header\n");
 		goto fail_io;
 	}
+	if (ciso_hdr.rsv_06[0] != CODEC_DEFLATE
+#ifdef HAVE_CBIN_ZSTD
+	    && ciso_hdr.rsv_06[0] != CODEC_ZSTD
+#endif
+	   ) {
+		SysPrintf("unsupported cbin codec %d\n", ciso_hdr.rsv_06[0]);
+		goto fail_io;
+	}
 	if (ciso_hdr.header_size != 0 && ciso_hdr.header_size != sizeof(ciso_hdr)) {
 		ret = fseeko(cdHandle, ciso_hdr.header_size, SEEK_SET);
 		if (ret != 0) {
@@ -968,15 +1012,16 @@ static int handlecbin(const char *isofile) {
 		goto fail_io;
 
 	compr_img->block_shift = 0;
-	compr_img->current_block = (unsigned int)-1;
+	compr_img->codec = ciso_hdr.rsv_06[0];
+	memset(compr_img->current_block, 0xff, sizeof(compr_img->current_block));
 
 	compr_img->index_len = ciso_hdr.total_bytes / ciso_hdr.block_size;
 	index_table = malloc((compr_img->index_len + 1) * sizeof(index_table[0]));
 	if (index_table == NULL)
 		goto fail_io;
 
-	ret = fread(index_table, sizeof(index_table[0]), compr_img->index_len, cdHandle);
-	if (ret != compr_img->index_len) {
+	ret = fread(index_table, sizeof(index_table[0]), compr_img->index_len + 1, cdHandle);
+	if (ret != compr_img->index_len + 1) {
 		SysPrintf("failed to read index table\n");
 		goto fail_index;
 	}
@@ -1043,13 +1088,12 @@ static int handlechd(const char *isofile) {
 
 	chd_img->header = chd_get_header(chd_img->chd);
 
-	chd_img->buffer = malloc(chd_img->header->hunkbytes * 2);
+	chd_img->buffer = malloc(chd_img->header->hunkbytes * CHD_CACHE_HUNKS);
 	if (chd_img->buffer == NULL)
 		goto fail_io;
 
 	chd_img->sectors_per_hunk = chd_img->header->hunkbytes / (CD_FRAMESIZE_RAW + SUB_FRAMESIZE);
-	chd_img->current_hunk[0] = (unsigned int)-1;
-	chd_img->current_hunk[1] = (unsigned int)-1;
+	memset(chd_img->current_hunk, 0xff, sizeof(chd_img->current_hunk));
 
 	cddaBigEndian = TRUE;
 
@@ -1242,10 +1286,26 @@ static int uncompress2_pcsx(void *out, unsigned long *out_size, void *in, unsign
 	return ret == 1 ? 0 : ret;
 }
 
+#ifdef HAVE_CBIN_ZSTD
+static int uncompress_zstd(void *out, unsigned long *out_size, void *in, unsigned long in_size)
+{
+	static ZSTD_DCtx *ctx;
+	size_t ret;
+
+	if (ctx == NULL && (ctx = ZSTD_createDCtx()) == NULL)
+		return -1;
+	ret = ZSTD_decompressDCtx(ctx, out, *out_size, in, in_size);
+	if (ZSTD_isError(ret))
+		return -1;
+	*out_size = ret;
+	return 0;
+}
+#endif
+
 static int cdread_compressed(FILE *f, unsigned int base, void *dest, int sector)
 {
 	unsigned long cdbuffer_size, cdbuffer_size_expect;
-	unsigned int size;
+	unsigned int size, slot, i;
 	int is_compressed;
 	off_t start_byte;
 	int ret, block;
@@ -1258,10 +1318,15 @@ static int cdread_compressed(FILE *f, unsigned int base, void *dest, int sector)
 	block = sector >> compr_img->block_shift;
 	compr_img->sector_in_blk = sector & ((1 << compr_img->block_shift) - 1);
 
-	if (block == compr_img->current_block) {
-		//printf("hit sect %d\n", sector);
-		goto finish;
+	for (slot = 0; slot < COMPR_CACHE_BLOCKS; slot++) {
+		if (block == compr_img->current_block[slot]) {
+			//printf("hit sect %d\n", sector);
+			goto finish;
+		}
 	}
+	for (slot = 0, i = 1; i < COMPR_CACHE_BLOCKS; i++)
+		if (compr_img->block_used[i] < compr_img->block_used[slot])
+			slot = i;
 
 	if (sector >= compr_img->index_len * 16) {
 		SysPrintf("sector %d is past img end\n", sector);
@@ -1283,7 +1348,9 @@ static int cdread_compressed(FILE *f, unsigned int base, void *dest, int sector)
 		return -1;
 	}
 
-	if (fread(is_compressed ? compr_img->buff_compressed : compr_img->buff_raw[0],
+	// invalidate the slot in case of a failure below
+	compr_img->current_block[slot] = (unsigned int)-1;
+	if (fread(is_compressed ? compr_img->buff_compressed : compr_img->buff_raw[slot][0],
 				1, size, cdHandle) != size) {
 		SysPrintf("read error for block %d at %lx: ", block, (long)start_byte);
 		perror(NULL);
@@ -1291,9 +1358,14 @@ static int cdread_compressed(FILE *f, unsigned int base, void *dest, int sector)
 	}
 
 	if (is_compressed) {
-		cdbuffer_size_expect = sizeof(compr_img->buff_raw[0]) << compr_img->block_shift;
+		cdbuffer_size_expect = sizeof(compr_img->buff_raw[0][0]) << compr_img->block_shift;
 		cdbuffer_size = cdbuffer_size_expect;
-		ret = uncompress2_pcsx(compr_img->buff_raw[0], &cdbuffer_size, compr_img->buff_compressed, size);
+#ifdef HAVE_CBIN_ZSTD
+		if (compr_img->codec == CODEC_ZSTD)
+			ret = uncompress_zstd(compr_img->buff_raw[slot][0], &cdbuffer_size, compr_img->buff_compressed, size);
+		else
+#endif
+		ret = uncompress2_pcsx(compr_img->buff_raw[slot][0], &cdbuffer_size, compr_img->buff_compressed, size);
 		if (ret != 0) {
 			SysPrintf("uncompress failed with %d for block %d, sector %d\n",
 					ret, block, sector);
@@ -1305,11 +1377,13 @@ static int cdread_compressed(FILE *f, unsigned int base, void *dest, int sector)
 	}
 
 	// done at last!
-	compr_img->current_block = block;
+	compr_img->current_block[slot] = block;
 
 finish:
+	compr_img->current_slot = slot;
+	compr_img->block_used[slot] = ++compr_img->use_counter;
 	if (dest != NULL)
-		memcpy(dest, compr_img->buff_raw[compr_img->sector_in_blk],
+		memcpy(dest, compr_img->buff_raw[slot][compr_img->sector_in_blk],
 			CD_FRAMESIZE_RAW);
 	return CD_FRAMESIZE_RAW;
 }
@@ -1322,6 +1396,30 @@ static unsigned char *chd_get_sector(unsigned int current_buffer, unsigned int s
 		+ sector_in_hunk * (CD_FRAMESIZE_RAW + SUB_FRAMESIZE);
 }
 
+// returns the cache slot holding the hunk, decompressing it into the
+// least recently used one if needed (never the one just used)
+static unsigned int chd_get_hunk(unsigned int hunk)
+{
+	unsigned int i, lru = 0;
+
+	for (i = 0; i < CHD_CACHE_HUNKS; i++) {
+		if (chd_img->current_hunk[i] == hunk) {
+			chd_img->hits++;
+			goto out;
+		}
+		if (chd_img->hunk_used[i] < chd_img->hunk_used[lru])
+			lru = i;
+	}
+	i = lru;
+	chd_img->misses++;
+	chd_read(chd_img->chd, hunk, chd_img->buffer +
+		i * chd_img->header->hunkbytes);
+	chd_img->current_hunk[i] = hunk;
+out:
+	chd_img->hunk_used[i] = ++chd_img->use_counter;
+	return i;
+}
+
 static int cdread_chd(FILE *f, unsigned int base, void *dest, int sector)
 {
 	int hunk;
@@ -1330,17 +1428,7 @@ static int cdread_chd(FILE *f, unsigned int base, void *dest, int sector)
 
 	hunk = sector / chd_img->sectors_per_hunk;
 	chd_img->sector_in_hunk = sector % chd_img->sectors_per_hunk;
-
-	if (hunk == chd_img->current_hunk[0])
-		chd_img->current_buffer = 0;
-	else if (hunk == chd_img->current_hunk[1])
-		chd_img->current_buffer = 1;
-	else
-	{
-		chd_read(chd_img->chd, hunk, chd_img->buffer +
-			chd_img->current_buffer * chd_img->header->hunkbytes);
-		chd_img->current_hunk[chd_img->current_buffer] = hunk;
-	}
+	chd_img->current_buffer = chd_get_hunk(hunk);
 
 	if (dest != NULL)
 		memcpy(dest, chd_get_sector(chd_img->current_buffer, chd_img->sector_in_hunk),
@@ -1359,18 +1447,7 @@ static int cdread_sub_chd(FILE *f, int sector, void *buffer_ptr)
 
 	hunk = sector / chd_img->sectors_per_hunk;
 	sector_in_hunk = sector % chd_img->sectors_per_hunk;
-
-	if (hunk == chd_img->current_hunk[0])
-		buffer = 0;
-	else if (hunk == chd_img->current_hunk[1])
-		buffer = 1;
-	else
-	{
-		buffer = chd_img->current_buffer ^ 1;
-		chd_read(chd_img->chd, hunk, chd_img->buffer +
-			buffer * chd_img->header->hunkbytes);
-		chd_img->current_hunk[buffer] = hunk;
-	}
+	buffer = chd_get_hunk(hunk);
 
 	memcpy(buffer_ptr, chd_get_sector(buffer, sector_in_hunk) + CD_FRAMESIZE_RAW, SUB_FRAMESIZE);
 	return 0;
@@ -1403,8 +1480,71 @@ static void * ISOgetBuffer_normal(void) {
        return cdbuffer + 12;
 }
 
+#ifdef HAVE_IMG_MMAP
+// plain images are mapped whole and sectors read without a dest buffer
+// are handed out in place (private mapping, so ppf patching still works)
+static unsigned char *img_map;
+static off_t img_map_size;
+static unsigned char *img_map_sector = cdbuffer;
+
+static int cdread_mmap(FILE *f, unsigned int base, void *dest, int sector)
+{
+	off_t pos = base + (off_t)sector * CD_FRAMESIZE_RAW;
+	size_t n = CD_FRAMESIZE_RAW;
+
+	if (f != cdHandle) // separate track files of a multifile cue
+		return cdread_normal(f, base, dest, sector);
+	if (pos < 0 || pos >= img_map_size)
+		return -1;
+	if (n > img_map_size - pos)
+		n = img_map_size - pos;
+	if (dest == NULL && n < CD_FRAMESIZE_RAW)
+		dest = cdbuffer; // truncated last sector, don't point past the end
+	if (dest != NULL) {
+		memcpy(dest, img_map + pos, n);
+		if (dest == cdbuffer)
+			img_map_sector = cdbuffer;
+	}
+	else
+		img_map_sector = img_map + pos;
+	return n;
+}
+
+static void * ISOgetBuffer_mmap(void) {
+       return img_map_sector + 12;
+}
+
+static void img_map_open(off_t size)
+{
+	void *p;
+
+	if (size <= 0 || (off_t)(size_t)size != size)
+		return;
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		fileno(cdHandle), 0);
+	if (p == MAP_FAILED) {
+		SysPrintf("cdriso: mmap failed: %s, using stdio\n", strerror(errno));
+		return;
+	}
+	img_map = p;
+	img_map_size = size;
+	img_map_sector = cdbuffer;
+	ISOgetBuffer = ISOgetBuffer_mmap;
+	cdimg_read_func = cdread_mmap;
+}
+
+static void img_map_close(void)
+{
+	if (img_map != NULL)
+		munmap(img_map, img_map_size);
+	img_map = NULL;
+	img_map_size = 0;
+	img_map_sector = cdbuffer;
+}
+#endif
+
 static void * ISOgetBuffer_compr(void) {
-       return compr_img->buff_raw[compr_img->sector_in_blk] + 12;
+       return compr_img->buff_raw[compr_img->current_slot][compr_img->sector_in_blk] + 12;
 }
 
 #ifdef HAVE_CHD
@@ -1446,6 +1586,10 @@ int ISOopen(const char *fname)
 	if (cdHandle || chd_img) {
 		return 0; // it's already open
 	}
+	if (iso_pool_take(fname) == 0) {
+		SysPrintf("Loaded CD Image: %s (kept open)\n", fname);
+		return 0;
+	}
 
 	cdHandle = fopen(fname, "rb");
 	if (cdHandle == NULL) {
@@ -1567,14 +1711,32 @@ int ISOopen(const char *fname)
 		cdimg_read_func = cdread_2048;
 		cdimg_read_sub_func = NULL;
 	}
+#ifdef HAVE_IMG_MMAP
+	else if (cdHandle && cdimg_read_func == cdread_normal)
+		img_map_open(size_main);
+#endif
 
+	strncpy(iso_fname, fname, sizeof(iso_fname) - 1);
+	iso_fname[sizeof(iso_fname) - 1] = '\0';
+	iso_select = cdrIsoMultidiskSelect;
 	return 0;
 }
 
 int ISOclose(void)
+{
+	if (iso_pool_max > 0 && (cdHandle || chd_img) && iso_pool_put() == 0)
+		return 0;
+	iso_close_current();
+	return 0;
+}
+
+static void iso_close_current(void)
 {
 	int i;
 
+#ifdef HAVE_IMG_MMAP
+	img_map_close();
+#endif
 	if (cdHandle != NULL) {
 		fclose(cdHandle);
 		cdHandle = NULL;
@@ -1592,6 +1754,10 @@ int ISOclose(void)
 
 #ifdef HAVE_CHD
 	if (chd_img != NULL) {
+		if (chd_img->hits + chd_img->misses)
+			SysPrintf("chd cache: %u hits, %u misses (%u%%)\n",
+				chd_img->hits, chd_img->misses, chd_img->hits * 100u
+				/ (chd_img->hits + chd_img->misses));
 		chd_close(chd_img->chd);
 		free(chd_img->buffer);
 		free(chd_img);
@@ -1611,10 +1777,186 @@ int ISOclose(void)
 
 	memset(cdbuffer, 0, sizeof(cdbuffer));
 	ISOgetBuffer = ISOgetBuffer_normal;
+	iso_fname[0] = '\0';
+}
+
+// ISOclose() moves the image here instead, with all its handles, caches
+// and parsed metadata, so that switching the discs of a multi-disc game
+// back and forth doesn't have to reopen and reparse (and for chd, refill
+// the hunk cache) every time. The oldest one is closed when it's full.
+#define ISO_POOL_MAX 8
+
+struct iso_state {
+	char fname[MAXPATHLEN];
+	unsigned int select, multidisk_count;
+	FILE *cdHandle, *subHandle;
+	boolean subChanMixed, subChanRaw, multifile, cddaBigEndian;
+	struct compr_state *compr_img;
+#ifdef HAVE_CHD
+	struct chd_state *chd_img;
+#endif
+	int (*read_func)(FILE *f, unsigned int base, void *dest, int sector);
+	int (*read_sub_func)(FILE *f, int sector, void *dest);
+	void * (*get_buffer)(void);
+#ifdef HAVE_IMG_MMAP
+	unsigned char *img_map;
+	off_t img_map_size;
+#endif
+	unsigned char *sbi_sectors;
+	int sbi_len;
+	int numtracks;
+	struct trackinfo ti[MAXTRACKS];
+};
+
+static struct iso_state *iso_pool[ISO_POOL_MAX]; // [0] is the newest
+
+// moves the open image from the globals to s, leaving them closed
+static void iso_state_save(struct iso_state *s)
+{
+	strcpy(s->fname, iso_fname);
+	s->select = iso_select;
+	s->multidisk_count = cdrIsoMultidiskCount;
+	s->cdHandle = cdHandle;
+	s->subHandle = subHandle;
+	s->subChanMixed = subChanMixed;
+	s->subChanRaw = subChanRaw;
+	s->multifile = multifile;
+	s->cddaBigEndian = cddaBigEndian;
+	s->compr_img = compr_img;
+	s->read_func = cdimg_read_func;
+	s->read_sub_func = cdimg_read_sub_func;
+	s->get_buffer = ISOgetBuffer;
+	s->sbi_sectors = sbi_sectors;
+	s->sbi_len = sbi_len;
+	s->numtracks = numtracks;
+	memcpy(s->ti, ti, sizeof(s->ti));
+
+	cdHandle = subHandle = NULL;
+	compr_img = NULL;
+#ifdef HAVE_CHD
+	s->chd_img = chd_img;
+	chd_img = NULL;
+#endif
+#ifdef HAVE_IMG_MMAP
+	s->img_map = img_map;
+	s->img_map_size = img_map_size;
+	img_map = NULL;
+	img_map_size = 0;
+	img_map_sector = cdbuffer;
+#endif
+	sbi_sectors = NULL;
+	sbi_len = 0;
+	numtracks = 0;
+	memset(ti, 0, sizeof(ti));
+	memset(cdbuffer, 0, sizeof(cdbuffer));
+	ISOgetBuffer = ISOgetBuffer_normal;
+	iso_fname[0] = '\0';
+}
+
+static void iso_state_load(const struct iso_state *s)
+{
+	strcpy(iso_fname, s->fname);
+	iso_select = s->select;
+	cdrIsoMultidiskCount = s->multidisk_count;
+	cdHandle = s->cdHandle;
+	subHandle = s->subHandle;
+	subChanMixed = s->subChanMixed;
+	subChanRaw = s->subChanRaw;
+	multifile = s->multifile;
+	cddaBigEndian = s->cddaBigEndian;
+	compr_img = s->compr_img;
+#ifdef HAVE_CHD
+	chd_img = s->chd_img;
+#endif
+#ifdef HAVE_IMG_MMAP
+	img_map = s->img_map;
+	img_map_size = s->img_map_size;
+	img_map_sector = cdbuffer;
+#endif
+	cdimg_read_func = s->read_func;
+	cdimg_read_sub_func = s->read_sub_func;
+	ISOgetBuffer = s->get_buffer;
+	sbi_sectors = s->sbi_sectors;
+	sbi_len = s->sbi_len;
+	numtracks = s->numtracks;
+	memcpy(ti, s->ti, sizeof(ti));
+}
+
+// really closes a parked image, the open one (if any) stays open
+static void iso_state_close(struct iso_state *s)
+{
+	struct iso_state *cur = malloc(sizeof(*cur));
+
+	if (cur == NULL) {
+		// can't get the open one out of the way, leak rather than break it
+		SysPrintf("cdriso: OOM closing a kept image\n");
+		free(s);
+		return;
+	}
+	iso_state_save(cur);
+	iso_state_load(s);
+	iso_close_current();
+	iso_state_load(cur);
+	free(cur);
+	free(s);
+}
 
+static int iso_pool_put(void)
+{
+	struct iso_state *s;
+	int i, n = iso_pool_max;
+
+	if (n > ISO_POOL_MAX)
+		n = ISO_POOL_MAX;
+	if (!iso_fname[0] || (s = malloc(sizeof(*s))) == NULL)
+		return -1;
+	iso_state_save(s);
+	if (iso_pool[n - 1] != NULL) {
+		iso_state_close(iso_pool[n - 1]);
+		iso_pool[n - 1] = NULL;
+	}
+	for (i = n - 1; i > 0; i--)
+		iso_pool[i] = iso_pool[i - 1];
+	iso_pool[0] = s;
 	return 0;
 }
 
+static int iso_pool_take(const char *fname)
+{
+	struct iso_state *s;
+	int i;
+
+	for (i = 0; i < ISO_POOL_MAX; i++) {
+		s = iso_pool[i];
+		if (s == NULL || s->select != cdrIsoMultidiskSelect
+		    || strcmp(s->fname, fname) != 0)
+			continue;
+		for (; i < ISO_POOL_MAX - 1; i++)
+			iso_pool[i] = iso_pool[i + 1];
+		iso_pool[ISO_POOL_MAX - 1] = NULL;
+		iso_state_load(s);
+		free(s);
+		return 0;
+	}
+	return -1;
+}
+
+// how many closed images to keep open, 0 closes them all
+void cdrIsoSetPoolSize(int count)
+{
+	int i;
+
+	if (count > ISO_POOL_MAX)
+		count = ISO_POOL_MAX;
+	iso_pool_max = count;
+	for (i = count; i < ISO_POOL_MAX; i++) {
+		if (iso_pool[i] != NULL) {
+			iso_state_close(iso_pool[i]);
+			iso_pool[i] = NULL;
+		}
+	}
+}
+
 int ISOinit(void)
 {
 	assert(cdHandle == NULL);
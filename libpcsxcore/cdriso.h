@@ -37,6 +37,7 @@ int ISOreadTrack(const unsigned char *time, void *buf);
 int ISOreadCDDA(const unsigned char *time, void *buffer);
 int ISOreadSub(const unsigned char *time, void *buffer);
 int ISOgetStatus(struct CdrStat *stat);
+void cdrIsoSetPoolSize(int count);
 
 extern void * (*ISOgetBuffer)(void);
 
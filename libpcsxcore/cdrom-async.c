@@ -18,6 +18,8 @@
 #include "cdriso.h"
 #include "cdrom.h"
 #include "cdrom-async.h"
+#include "../include/evtrace.h"
+#include "../include/thread_wakeups.h"
 
 #if 0
 #define acdrom_dbg printf
@@ -47,11 +49,29 @@ static int  rcdrom_isMediaInserted(void *stream) { return 0; }
 #include "retro_timers.h"
 #endif
 
+// the cache is set associative so that a seek elsewhere doesn't evict
+// everything, and readahead is done for several recently seen streams,
+// deeper for the ones that keep reading sequentially
+#define CACHE_WAYS 4
+#define MAX_STREAMS 4
+#define STREAM_MIN_DEPTH 8
+// XA/CDDA streams are kept this many sectors ahead (~0.2s at 2x) before
+// any data stream gets read ahead, so a load next to music doesn't gap it
+#define AUDIO_LEAD 32
+
 struct cached_buf {
    u32 lba;
+   u32 used; // for lru
+   u32 has_sub;
    u8 buf[CD_FRAMESIZE_RAW];
    u8 buf_sub[SUB_FRAMESIZE];
 };
+struct ra_stream {
+   u32 lba;   // last requested sector
+   u32 depth; // sectors to read ahead, 0 if unused
+   u32 used;
+   u32 audio; // played as XA/CDDA, see AUDIO_LEAD
+};
 static struct {
    sthread_t *thread;
    slock_t *read_lock;
@@ -59,32 +79,117 @@ static struct {
    scond_t *cond;
    struct cached_buf *buf_cache;
    u32 buf_cnt, thread_exit, do_prefetch, prefetch_failed, have_subchannel;
-   u32 total_lba, prefetch_lba;
+   u32 buf_cnt_req; // buf_cnt before the Config.MemBudgetMB cap
+   // set by the first cdra_readSub(), most games never ask for the
+   // subchannel and then the thread doesn't read it at all
+   u32 sub_wanted;
+   u32 total_lba;
+   u32 sets, ways, nstreams, use_counter, pass_start;
+   u32 hits, misses;
+   struct ra_stream streams[MAX_STREAMS];
+   // optional copy of the whole disc, filled by the thread when it has
+   // nothing else to do and then used before the cache
+   u8 *arena;
+   u32 *arena_resident; // bitmap, followed by one for the subchannel
+   u32 arena_stride, preload, preload_lba, main_waiting;
    int check_eject_delay;
 
-   // single sector cache, not touched by the thread
+   // the sector of the last cdra_readTrack(), buf_local for direct reads,
+   // else it points into the arena or the pinned cache entry (which the
+   // thread won't evict) so cache hits aren't copied again
+   const u8 *buf_ptr;
+   struct cached_buf *pinned;
+   // same for the last cdra_readCDDA(), kept apart so that CDDA play
+   // doesn't unpin the data sector cdra_getBuffer() still refers to
+   const u8 *cdda_ptr;
+   struct cached_buf *pinned_cdda;
+
+   // single sector caches, not touched by the thread
    alignas(64) u8 buf_local[CD_FRAMESIZE_RAW_ALIGNED];
+   alignas(64) u8 cdda_local[CD_FRAMESIZE_RAW_ALIGNED];
 } acdrom;
 
+// these need buf_lock
+static int arena_has(u32 lba)
+{
+   return acdrom.arena && lba < acdrom.total_lba
+      && ((acdrom.arena_resident[lba >> 5] >> (lba & 31)) & 1);
+}
+
+static int arena_has_sub(u32 lba)
+{
+   const u32 *sub_bits = acdrom.arena_resident + (acdrom.total_lba + 31) / 32;
+   return arena_has(lba) && ((sub_bits[lba >> 5] >> (lba & 31)) & 1);
+}
+
+static struct cached_buf *lbacache_find(u32 lba)
+{
+   struct cached_buf *set;
+   u32 w;
+
+   if (!acdrom.sets)
+      return NULL;
+   set = &acdrom.buf_cache[lba % acdrom.sets * acdrom.ways];
+   for (w = 0; w < acdrom.ways; w++)
+      if (set[w].lba == lba)
+         return &set[w];
+   return NULL;
+}
+
+static u32 audio_lead(const struct ra_stream *s)
+{
+   return s->audio ? (s->depth < AUDIO_LEAD ? s->depth : AUDIO_LEAD) : 0;
+}
+
+// the sectors an audio stream is about to play aren't evicted for readahead
+static int audio_lead_has(u32 lba)
+{
+   u32 i;
+
+   for (i = 0; i < acdrom.nstreams; i++) {
+      const struct ra_stream *s = &acdrom.streams[i];
+      if (s->lba <= lba && lba < s->lba + audio_lead(s))
+         return 1;
+   }
+   return 0;
+}
+
+static struct cached_buf *lbacache_victim(u32 lba)
+{
+   struct cached_buf *set = &acdrom.buf_cache[lba % acdrom.sets * acdrom.ways];
+   struct cached_buf *lru = NULL;
+   u32 w;
+
+   for (w = 0; w < acdrom.ways; w++)
+      if (&set[w] != acdrom.pinned && &set[w] != acdrom.pinned_cdda
+          && !audio_lead_has(set[w].lba)
+          && (lru == NULL || set[w].used < lru->used))
+         lru = &set[w];
+   return lru;
+}
+
 static void lbacache_do(u32 lba)
 {
    alignas(64) unsigned char buf[CD_FRAMESIZE_RAW_ALIGNED];
    unsigned char msf[3], buf_sub[SUB_FRAMESIZE];
-   u32 i = lba % acdrom.buf_cnt;
+   int with_sub = acdrom.have_subchannel && acdrom.sub_wanted;
+   struct cached_buf *c;
    int ret;
 
    lba2msf(lba + 150, &msf[0], &msf[1], &msf[2]);
    slock_lock(acdrom.read_lock);
+   evtrace_begin(EVT_CDR_CACHE, lba);
    if (g_cd_handle)
       ret = rcdrom_readSector(g_cd_handle, lba, buf);
    else
       ret = ISOreadTrack(msf, buf);
-   if (acdrom.have_subchannel) {
+   if (with_sub) {
       if (g_cd_handle)
          ret |= rcdrom_readSub(g_cd_handle, lba, buf_sub);
       else
          ret |= ISOreadSub(msf, buf_sub);
    }
+   evtrace_end(EVT_CDR_CACHE);
 
    slock_lock(acdrom.buf_lock);
    slock_unlock(acdrom.read_lock);
@@ -93,6 +198,7 @@ static void lbacache_do(u32 lba)
    if (ret) {
       acdrom.do_prefetch = 0;
       acdrom.prefetch_failed = 1;
+      acdrom.preload_lba = acdrom.total_lba; // don't retry the whole disc
       slock_unlock(acdrom.buf_lock);
       SysPrintf("prefetch: read failed for lba %d: %d\n", lba, ret);
       return;
@@ -100,12 +206,40 @@ static void lbacache_do(u32 lba)
    acdrom.prefetch_failed = 0;
    acdrom.check_eject_delay = 100;
 
-   if (lba != acdrom.buf_cache[i].lba) {
-      acdrom.buf_cache[i].lba = lba;
-      memcpy(acdrom.buf_cache[i].buf, buf, sizeof(acdrom.buf_cache[i].buf));
-      if (acdrom.have_subchannel)
-         memcpy(acdrom.buf_cache[i].buf_sub, buf_sub, sizeof(buf_sub));
+   if (acdrom.arena) {
+      u8 *dst = acdrom.arena + (size_t)lba * acdrom.arena_stride;
+      memcpy(dst, buf, CD_FRAMESIZE_RAW);
+      acdrom.arena_resident[lba >> 5] |= 1u << (lba & 31);
+      if (with_sub) {
+         u32 *sub_bits = acdrom.arena_resident + (acdrom.total_lba + 31) / 32;
+         memcpy(dst + CD_FRAMESIZE_RAW, buf_sub, SUB_FRAMESIZE);
+         sub_bits[lba >> 5] |= 1u << (lba & 31);
+      }
+      slock_unlock(acdrom.buf_lock);
+      return;
    }
+
+   c = lbacache_find(lba);
+   if (c != NULL && with_sub && !c->has_sub) {
+      memcpy(c->buf_sub, buf_sub, sizeof(buf_sub));
+      c->has_sub = 1;
+   }
+   if (c == NULL) {
+      c = lbacache_victim(lba);
+      if (c == NULL || c->used > acdrom.pass_start) {
+         // would evict something prefetched since the last request,
+         // the streams don't fit (in this set), stop before thrashing
+         acdrom.do_prefetch = 0;
+         slock_unlock(acdrom.buf_lock);
+         return;
+      }
+      c->lba = lba;
+      memcpy(c->buf, buf, sizeof(c->buf));
+      c->has_sub = with_sub;
+      if (with_sub)
+         memcpy(c->buf_sub, buf_sub, sizeof(buf_sub));
+   }
+   c->used = ++acdrom.use_counter;
    slock_unlock(acdrom.buf_lock);
 #ifdef HAVE_LIBRETRO
    if (g_cd_handle)
@@ -113,29 +247,146 @@ static void lbacache_do(u32 lba)
 #endif
 }
 
+// buf == buf_local/cdda_local: only point buf_ptr/cdda_ptr at the cached sector
 static int lbacache_get(unsigned int lba, void *buf, void *sub_buf)
 {
-   unsigned int i;
+   struct cached_buf **pinned = NULL;
+   const u8 **ptr = NULL;
+   struct cached_buf *c;
    int ret = 0;
 
-   i = lba % acdrom.buf_cnt;
+   if (buf == acdrom.buf_local)
+      ptr = &acdrom.buf_ptr, pinned = &acdrom.pinned;
+   else if (buf == acdrom.cdda_local)
+      ptr = &acdrom.cdda_ptr, pinned = &acdrom.pinned_cdda;
+
    slock_lock(acdrom.buf_lock);
-   if (lba == acdrom.buf_cache[i].lba) {
-      if (buf)
-         memcpy(buf, acdrom.buf_cache[i].buf, CD_FRAMESIZE_RAW);
+   if (pinned)
+      *pinned = NULL;
+   // the thread may have skipped the subchannel, then it's read directly
+   if (sub_buf ? arena_has_sub(lba) : arena_has(lba)) {
+      const u8 *src = acdrom.arena + (size_t)lba * acdrom.arena_stride;
+      if (ptr)
+         *ptr = src;
+      else if (buf)
+         memcpy(buf, src, CD_FRAMESIZE_RAW);
+      if (sub_buf)
+         memcpy(sub_buf, src + CD_FRAMESIZE_RAW, SUB_FRAMESIZE);
+      ret = 1;
+   }
+   else if ((c = lbacache_find(lba)) != NULL && (!sub_buf || c->has_sub)) {
+      if (ptr) {
+         *ptr = c->buf;
+         *pinned = c;
+      }
+      else if (buf)
+         memcpy(buf, c->buf, CD_FRAMESIZE_RAW);
       if (sub_buf)
-         memcpy(sub_buf, acdrom.buf_cache[i].buf_sub, SUB_FRAMESIZE);
+         memcpy(sub_buf, c->buf_sub, SUB_FRAMESIZE);
       ret = 1;
    }
    slock_unlock(acdrom.buf_lock);
    return ret;
 }
 
+// needs buf_lock. Continues the stream the sector belongs to (growing
+// its depth while it reads forward) or starts one in place of the lru one.
+// All depths together stay within the cache so the streams don't thrash,
+// audio ones get at least AUDIO_LEAD and data ones what's left over.
+static void stream_update(u32 lba, int audio)
+{
+   struct ra_stream *s, *lru = &acdrom.streams[0];
+   u32 min_depth = audio ? AUDIO_LEAD : STREAM_MIN_DEPTH, i, j, max_depth;
+
+   if (audio && min_depth > acdrom.buf_cnt / 2) // leave some for data
+      min_depth = acdrom.buf_cnt / 2 > STREAM_MIN_DEPTH
+         ? acdrom.buf_cnt / 2 : STREAM_MIN_DEPTH;
+   if (min_depth > acdrom.buf_cnt)
+      min_depth = acdrom.buf_cnt;
+   for (i = 0; i < acdrom.nstreams; i++) {
+      s = &acdrom.streams[i];
+      if (s->depth && s->lba <= lba && lba <= s->lba + s->depth) {
+         max_depth = acdrom.buf_cnt * 3 / 4;
+         for (j = 0; j < acdrom.nstreams; j++)
+            if (j != i)
+               max_depth -= acdrom.streams[j].depth < max_depth
+                  ? acdrom.streams[j].depth : max_depth;
+         if (max_depth < min_depth)
+            max_depth = min_depth;
+         if (lba != s->lba)
+            s->depth *= 2;
+         if (s->depth > max_depth)
+            s->depth = max_depth;
+         if (s->depth < min_depth)
+            s->depth = min_depth;
+         s->lba = lba;
+         s->used = ++acdrom.use_counter;
+         s->audio = audio;
+         return;
+      }
+      if (s->used < lru->used)
+         lru = s;
+   }
+   lru->lba = lba;
+   lru->depth = min_depth;
+   lru->used = ++acdrom.use_counter;
+   lru->audio = audio;
+}
+
+// needs buf_lock. First missing sector of the audio leads, else of the
+// most recent stream that has any, ~0 if all caught up
+static u32 stream_next_lba(void)
+{
+   u32 i, done = 0, lba, lba_to;
+
+   for (i = 0; i < acdrom.nstreams; i++) {
+      const struct ra_stream *s = &acdrom.streams[i];
+      lba_to = s->lba + audio_lead(s);
+      if (lba_to > acdrom.total_lba)
+         lba_to = acdrom.total_lba;
+      for (lba = s->lba; lba < lba_to; lba++)
+         if (!arena_has(lba) && lbacache_find(lba) == NULL)
+            return lba;
+   }
+
+   while (done != (1u << acdrom.nstreams) - 1) {
+      struct ra_stream *s = NULL;
+      for (i = 0; i < acdrom.nstreams; i++) {
+         if (done & (1u << i))
+            continue;
+         if (s == NULL || acdrom.streams[i].used > s->used)
+            s = &acdrom.streams[i];
+      }
+      done |= 1u << (s - acdrom.streams);
+
+      lba_to = s->lba + s->depth;
+      if (lba_to > acdrom.total_lba)
+         lba_to = acdrom.total_lba;
+      for (lba = s->lba; lba < lba_to; lba++)
+         if (!arena_has(lba) && lbacache_find(lba) == NULL)
+            return lba;
+   }
+   return ~0u;
+}
+
+// needs buf_lock. Next sector for the background whole disc read.
+// Backs off while the main thread waits for a direct read.
+static u32 preload_next_lba(void)
+{
+   if (!acdrom.arena || acdrom.main_waiting)
+      return ~0u;
+   while (acdrom.preload_lba < acdrom.total_lba && arena_has(acdrom.preload_lba))
+      acdrom.preload_lba++;
+   if (acdrom.preload_lba < acdrom.total_lba)
+      return acdrom.preload_lba;
+   return ~0u;
+}
+
 // note: This has races on some vars but that's ok, main thread can deal
 // with it. Only unsafe buffer accesses and simultaneous reads are prevented.
 static STRHEAD_RET_TYPE cdra_prefetch_thread(void *unused)
 {
-   u32 buf_cnt, lba, lba_to;
+   u32 lba;
 
    slock_lock(acdrom.buf_lock);
    while (!acdrom.thread_exit)
@@ -143,23 +394,19 @@ static STRHEAD_RET_TYPE cdra_prefetch_thread(void *unused)
 #ifdef __GNUC__
       __asm__ __volatile__("":::"memory"); // barrier
 #endif
-      if (!acdrom.do_prefetch)
-         scond_wait(acdrom.cond, acdrom.buf_lock);
-      if (!acdrom.do_prefetch || acdrom.thread_exit)
-         continue;
-
-      buf_cnt = acdrom.buf_cnt;
-      lba = acdrom.prefetch_lba;
-      lba_to = lba + buf_cnt;
-      if (lba_to > acdrom.total_lba)
-         lba_to = acdrom.total_lba;
-      for (; lba < lba_to; lba++) {
-         if (lba != acdrom.buf_cache[lba % buf_cnt].lba)
-            break;
+      lba = ~0u;
+      if (acdrom.do_prefetch) {
+         lba = stream_next_lba();
+         if (lba == ~0u)
+            acdrom.do_prefetch = 0; // caching complete
       }
-      if (lba == lba_to || lba >= acdrom.total_lba) {
-         // caching complete
-         acdrom.do_prefetch = 0;
+      if (lba == ~0u)
+         lba = preload_next_lba();
+      if (lba == ~0u) {
+         if (!acdrom.thread_exit) {
+            scond_wait(acdrom.cond, acdrom.buf_lock);
+            twake_count(TWAKE_CDR);
+         }
          continue;
       }
 
@@ -173,6 +420,10 @@ static STRHEAD_RET_TYPE cdra_prefetch_thread(void *unused)
 
 void cdra_stop_thread(void)
 {
+   if (acdrom.hits + acdrom.misses)
+      SysPrintf("cdrom precache: %u hits, %u misses\n",
+            acdrom.hits, acdrom.misses);
+   acdrom.hits = acdrom.misses = 0;
    acdrom.thread_exit = 1;
    if (acdrom.buf_lock) {
       slock_lock(acdrom.buf_lock);
@@ -185,22 +436,84 @@ void cdra_stop_thread(void)
       sthread_join(acdrom.thread);
       acdrom.thread = NULL;
    }
+   // the cache goes away, cdra_getBuffer() may still be asked for the sector
+   if (acdrom.buf_ptr && acdrom.buf_ptr != acdrom.buf_local)
+      memcpy(acdrom.buf_local, acdrom.buf_ptr, CD_FRAMESIZE_RAW);
+   acdrom.buf_ptr = acdrom.buf_local;
+   acdrom.pinned = NULL;
+   if (acdrom.cdda_ptr && acdrom.cdda_ptr != acdrom.cdda_local)
+      memcpy(acdrom.cdda_local, acdrom.cdda_ptr, CD_FRAMESIZE_RAW);
+   acdrom.cdda_ptr = acdrom.cdda_local;
+   acdrom.pinned_cdda = NULL;
    if (acdrom.cond) { scond_free(acdrom.cond); acdrom.cond = NULL; }
    if (acdrom.buf_lock) { slock_free(acdrom.buf_lock); acdrom.buf_lock = NULL; }
    if (acdrom.read_lock) { slock_free(acdrom.read_lock); acdrom.read_lock = NULL; }
    free(acdrom.buf_cache);
    acdrom.buf_cache = NULL;
+   if (acdrom.arena && acdrom.preload_lba < acdrom.total_lba)
+      SysPrintf("cdrom preload: stopped at %u/%u\n",
+            acdrom.preload_lba, acdrom.total_lba);
+   free(acdrom.arena);
+   free(acdrom.arena_resident);
+   acdrom.arena = NULL;
+   acdrom.arena_resident = NULL;
+}
+
+static void cdra_alloc_arena(void)
+{
+   size_t size;
+
+   acdrom.preload_lba = 0;
+   if (!acdrom.preload || !acdrom.total_lba)
+      return;
+   acdrom.arena_stride = CD_FRAMESIZE_RAW;
+   if (acdrom.have_subchannel)
+      acdrom.arena_stride += SUB_FRAMESIZE;
+   size = (size_t)acdrom.total_lba * acdrom.arena_stride;
+   if (size / acdrom.arena_stride != acdrom.total_lba)
+      return;
+   // a disc is >300MB usually, so this mostly means no preload
+   if (Config.MemBudgetMB > 0 && (size >> 20) > (size_t)Config.MemBudgetMB / 2) {
+      SysPrintf("cdrom preload: %zu MB is over the memory budget, disabled\n",
+            size >> 20);
+      return;
+   }
+   acdrom.arena = malloc(size);
+   acdrom.arena_resident = calloc((acdrom.total_lba + 31) / 32 * 2, sizeof(u32));
+   if (!acdrom.arena || !acdrom.arena_resident) {
+      SysPrintf("cdrom preload: can't allocate %zu MB, disabled\n", size >> 20);
+      free(acdrom.arena);
+      free(acdrom.arena_resident);
+      acdrom.arena = NULL;
+      acdrom.arena_resident = NULL;
+   }
 }
 
 // the thread is optional, if anything fails we can do direct reads
 static void cdra_start_thread(void)
 {
    cdra_stop_thread();
-   acdrom.thread_exit = acdrom.prefetch_lba = acdrom.do_prefetch = 0;
+   acdrom.thread_exit = acdrom.do_prefetch = 0;
    acdrom.prefetch_failed = 0;
-   if (acdrom.buf_cnt == 0)
+   acdrom.use_counter = acdrom.pass_start = 0;
+   memset(acdrom.streams, 0, sizeof(acdrom.streams));
+   acdrom.sets = 0;
+   acdrom.buf_cnt = acdrom.buf_cnt_req;
+   if (Config.MemBudgetMB > 0) {
+      // an eighth of the budget for the read-ahead
+      u32 limit = ((u32)Config.MemBudgetMB << 20) / 8 / sizeof(acdrom.buf_cache[0]);
+      if (acdrom.buf_cnt > limit)
+         acdrom.buf_cnt = limit;
+   }
+   cdra_alloc_arena();
+   if (acdrom.buf_cnt == 0 && !acdrom.arena)
       return;
-   acdrom.buf_cache = calloc(acdrom.buf_cnt, sizeof(acdrom.buf_cache[0]));
+   acdrom.ways = acdrom.buf_cnt >= CACHE_WAYS ? CACHE_WAYS : 1;
+   acdrom.sets = acdrom.buf_cnt / acdrom.ways;
+   // small caches can't hold several windows, keep the plain readahead
+   acdrom.nstreams = acdrom.buf_cnt >= MAX_STREAMS * STREAM_MIN_DEPTH * 2
+      ? MAX_STREAMS : 1;
+   acdrom.buf_cache = calloc(acdrom.buf_cnt + 1, sizeof(acdrom.buf_cache[0]));
    acdrom.buf_lock = slock_new();
    acdrom.read_lock = slock_new();
    acdrom.cond = scond_new();
@@ -212,8 +525,9 @@ static void cdra_start_thread(void)
          acdrom.buf_cache[i].lba = ~0;
    }
    if (acdrom.thread) {
-      SysPrintf("cdrom precache: %d buffers%s\n",
-            acdrom.buf_cnt, acdrom.have_subchannel ? " +sub" : "");
+      SysPrintf("cdrom precache: %d buffers%s%s\n",
+            acdrom.buf_cnt, acdrom.have_subchannel ? " +sub" : "",
+            acdrom.arena ? ", preloading to RAM" : "");
    }
    else {
       SysPrintf("cdrom precache thread init failed.\n");
@@ -266,6 +580,8 @@ void cdra_close(void)
 {
    acdrom_dbg("%s\n", __func__);
    cdra_stop_thread();
+   acdrom.total_lba = 0;
+   acdrom.sub_wanted = 0;
    if (g_cd_handle) {
       rcdrom_close(g_cd_handle);
       g_cd_handle = NULL;
@@ -296,20 +612,20 @@ int cdra_getTD(int track, unsigned char *rt)
    return ret;
 }
 
-int cdra_prefetch(unsigned char m, unsigned char s, unsigned char f)
+int cdra_prefetch(unsigned char m, unsigned char s, unsigned char f, int audio)
 {
    u32 lba = MSF2SECT(m, s, f);
    int ret = 1;
    if (acdrom.cond) {
-      acdrom.prefetch_lba = lba;
+      slock_lock(acdrom.buf_lock);
+      stream_update(lba, audio);
+      acdrom.pass_start = acdrom.use_counter;
+      if (!acdrom.prefetch_failed)
+         ret = arena_has(lba) || lbacache_find(lba) != NULL;
       acdrom.do_prefetch = 1;
       scond_signal(acdrom.cond);
-   }
-   if (acdrom.buf_cache && !acdrom.prefetch_failed) {
-     u32 c = acdrom.buf_cnt;
-     if (c)
-        ret = acdrom.buf_cache[lba % c].lba == lba;
-     acdrom_dbg("p  %d:%02d:%02d %d\n", m, s, f, ret);
+      slock_unlock(acdrom.buf_lock);
+      acdrom_dbg("p%c %d:%02d:%02d %d\n", audio ? 'a' : ' ', m, s, f, ret);
    }
    return ret;
 }
@@ -323,11 +639,15 @@ static int cdra_do_read(const unsigned char *time, int cdda,
    {
       if (acdrom.buf_lock) {
          hit = lbacache_get(lba, buf, buf_sub);
-         if (hit)
+         if (hit) {
+            acdrom.hits++;
             break;
+         }
+         acdrom.misses++;
       }
       if (acdrom.read_lock) {
-         // maybe still prefetching
+         // maybe still prefetching, keep the preload from taking the lock again
+         acdrom.main_waiting = 1;
          slock_lock(acdrom.read_lock);
          read_locked = 1;
          hit = lbacache_get(lba, buf, buf_sub);
@@ -353,8 +673,14 @@ static int cdra_do_read(const unsigned char *time, int cdda,
          SysPrintf("cdrom read failed for lba %d: %d\n", lba, ret);
    }
    while (0);
-   if (read_locked)
+   if (read_locked) {
       slock_unlock(acdrom.read_lock);
+      slock_lock(acdrom.buf_lock);
+      acdrom.main_waiting = 0;
+      if (acdrom.arena)
+         scond_signal(acdrom.cond);
+      slock_unlock(acdrom.buf_lock);
+   }
    if (hit)
       ret = 0;
    acdrom.check_eject_delay = ret ? 0 : 100;
@@ -371,12 +697,16 @@ int cdra_readTrack(const unsigned char *time)
       // just forward to ISOreadTrack to avoid extra copying
       return ISOreadTrack(time, NULL);
    }
+   acdrom.buf_ptr = acdrom.buf_local;
    return cdra_do_read(time, 0, acdrom.buf_local, NULL);
 }
 
-int cdra_readCDDA(const unsigned char *time, void *buffer)
+// the sector is left where it is (prefetch cache, arena or cdda_local),
+// see cdra_getCDDABuffer()
+int cdra_readCDDA(const unsigned char *time)
 {
-   return cdra_do_read(time, 1, buffer, NULL);
+   acdrom.cdda_ptr = acdrom.cdda_local;
+   return cdra_do_read(time, 1, acdrom.cdda_local, NULL);
 }
 
 int cdra_readSub(const unsigned char *time, void *buffer)
@@ -385,6 +715,7 @@ int cdra_readSub(const unsigned char *time, void *buffer)
       return ISOreadSub(time, buffer);
    if (!acdrom.have_subchannel)
       return -1;
+   acdrom.sub_wanted = 1;
    acdrom_dbg("s  %d:%02d:%02d\n", time[0], time[1], time[2]);
    return cdra_do_read(time, 0, NULL, buffer);
 }
@@ -395,7 +726,13 @@ void *cdra_getBuffer(void)
    //acdrom_dbg("%s\n", __func__);
    if (!acdrom.thread && !g_cd_handle)
       return ISOgetBuffer();
-   return acdrom.buf_local + 12;
+   return (void *)((acdrom.buf_ptr ? acdrom.buf_ptr : acdrom.buf_local) + 12);
+}
+
+// raw sector from the last cdra_readCDDA() call, valid until the next one
+const void *cdra_getCDDABuffer(void)
+{
+   return acdrom.cdda_ptr ? acdrom.cdda_ptr : acdrom.cdda_local;
 }
 
 int cdra_getStatus(struct CdrStat *stat)
@@ -409,6 +746,11 @@ int cdra_getStatus(struct CdrStat *stat)
    return ret;
 }
 
+int cdra_has_subchannel(void)
+{
+   return acdrom.have_subchannel;
+}
+
 int cdra_is_physical(void)
 {
    return !!g_cd_handle;
@@ -425,33 +767,78 @@ int cdra_check_eject(int *inserted)
 
 void cdra_set_buf_count(int newcount)
 {
-   if (acdrom.buf_cnt == newcount)
+   if (acdrom.buf_cnt_req == newcount)
       return;
    cdra_stop_thread();
-   acdrom.buf_cnt = newcount;
+   acdrom.buf_cnt_req = newcount;
    cdra_start_thread();
 }
 
 int cdra_get_buf_count(void)
 {
-   return acdrom.buf_cnt;
+   return acdrom.buf_cnt_req;
+}
+
+void cdra_set_preload(int enable)
+{
+   enable = !!enable;
+   if (acdrom.preload == enable)
+      return;
+   cdra_stop_thread();
+   acdrom.preload = enable;
+   cdra_start_thread();
+}
+
+int cdra_get_preload(void)
+{
+   return acdrom.preload;
+}
+
+// re-sizes the caches after a Config.MemBudgetMB change
+void cdra_apply_mem_budget(void)
+{
+   cdra_stop_thread();
+   cdra_start_thread();
+}
+
+// read-ahead buffers plus the preload copy, in bytes
+size_t cdra_get_mem_usage(void)
+{
+   size_t size = 0;
+
+   if (acdrom.buf_cache)
+      size += (acdrom.buf_cnt + 1) * sizeof(acdrom.buf_cache[0]);
+   if (acdrom.arena)
+      size += (size_t)acdrom.total_lba * acdrom.arena_stride;
+   return size;
+}
+
+void cdra_get_cache_stats(unsigned int *hits, unsigned int *misses)
+{
+   *hits = acdrom.hits;
+   *misses = acdrom.misses;
 }
 
+// sectors cached ahead of the most recently read stream
 int cdra_get_buf_cached_approx(void)
 {
-   u32 buf_cnt = acdrom.buf_cnt, lba = acdrom.prefetch_lba;
-   u32 total = acdrom.total_lba;
-   u32 left = buf_cnt;
+   const struct ra_stream *s = NULL;
+   u32 i, lba, lba_to;
    int buf_use = 0;
 
-   if (left > total)
-      left = total;
-   for (; lba < total && left > 0; lba++, left--)
-      if (lba == acdrom.buf_cache[lba % buf_cnt].lba)
-         buf_use++;
-   for (lba = 0; left > 0; lba++, left--)
-      if (lba == acdrom.buf_cache[lba % buf_cnt].lba)
+   if (!acdrom.buf_lock)
+      return 0;
+   slock_lock(acdrom.buf_lock);
+   for (i = 0; i < acdrom.nstreams; i++)
+      if (s == NULL || acdrom.streams[i].used > s->used)
+         s = &acdrom.streams[i];
+   lba_to = s->lba + s->depth;
+   if (lba_to > acdrom.total_lba)
+      lba_to = acdrom.total_lba;
+   for (lba = s->lba; lba < lba_to; lba++)
+      if (arena_has(lba) || lbacache_find(lba) != NULL)
          buf_use++;
+   slock_unlock(acdrom.buf_lock);
 
    return buf_use;
 }
@@ -493,7 +880,7 @@ int cdra_getTD(int track, unsigned char *rt)
    return ISOgetTD(track, rt);
 }
 
-int cdra_prefetch(unsigned char m, unsigned char s, unsigned char f)
+int cdra_prefetch(unsigned char m, unsigned char s, unsigned char f, int audio)
 {
    return 1; // always hit
 }
@@ -504,9 +891,11 @@ int cdra_readTrack(const unsigned char *time)
    return ISOreadTrack(time, NULL);
 }
 
-int cdra_readCDDA(const unsigned char *time, void *buffer)
+alignas(64) static u8 cdda_buf[CD_FRAMESIZE_RAW_ALIGNED];
+
+int cdra_readCDDA(const unsigned char *time)
 {
-   return ISOreadCDDA(time, buffer);
+   return ISOreadCDDA(time, cdda_buf);
 }
 
 int cdra_readSub(const unsigned char *time, void *buffer)
@@ -520,17 +909,32 @@ void *cdra_getBuffer(void)
    return ISOgetBuffer();
 }
 
+// raw sector from the last cdra_readCDDA() call
+const void *cdra_getCDDABuffer(void)
+{
+   return cdda_buf;
+}
+
 int cdra_getStatus(struct CdrStat *stat)
 {
    return ISOgetStatus(stat);
 }
 
 int cdra_is_physical(void) { return 0; }
+int cdra_has_subchannel(void) { return 0; }
 int cdra_check_eject(int *inserted) { return 0; }
 void cdra_stop_thread(void) {}
 void cdra_set_buf_count(int newcount) {}
 int  cdra_get_buf_count(void) { return 0; }
+void cdra_set_preload(int enable) {}
+int  cdra_get_preload(void) { return 0; }
+void cdra_apply_mem_budget(void) {}
 int  cdra_get_buf_cached_approx(void) { return 0; }
+size_t cdra_get_mem_usage(void) { return 0; }
+void cdra_get_cache_stats(unsigned int *hits, unsigned int *misses)
+{
+   *hits = *misses = 0;
+}
 
 #endif
 
@@ -25,18 +25,28 @@ int  cdra_getTN(unsigned char *tn);
 int  cdra_getTD(int track, unsigned char *rt);
 int  cdra_getStatus(struct CdrStat *stat);
 int  cdra_readTrack(const unsigned char *time);
-int  cdra_readCDDA(const unsigned char *time, void *buffer);
+int  cdra_readCDDA(const unsigned char *time);
 int  cdra_readSub(const unsigned char *time, void *buffer);
-int  cdra_prefetch(unsigned char m, unsigned char s, unsigned char f);
+// audio: the sectors will be played as XA/CDDA, their readahead goes first
+int  cdra_prefetch(unsigned char m, unsigned char s, unsigned char f, int audio);
 
 int  cdra_is_physical(void);
+// subchannel Q can be read with cdra_readSub()
+int  cdra_has_subchannel(void);
 int  cdra_check_eject(int *inserted);
 void cdra_stop_thread(void);
 void cdra_set_buf_count(int count);
 int  cdra_get_buf_count(void);
+void cdra_set_preload(int enable);
+int  cdra_get_preload(void);
+void cdra_apply_mem_budget(void);
 int  cdra_get_buf_cached_approx(void);
+size_t cdra_get_mem_usage(void);
+// read cache lookups since the prefetch thread was (re)started
+void cdra_get_cache_stats(unsigned int *hits, unsigned int *misses);
 
 void *cdra_getBuffer(void);
+const void *cdra_getCDDABuffer(void);
 
 #ifdef __cplusplus
 }
@@ -23,6 +23,7 @@
 
 #include <stdalign.h>
 #include <assert.h>
+#include <time.h>
 #include "cdrom.h"
 #include "cdrom-async.h"
 #include "misc.h"
@@ -30,6 +31,8 @@
 #include "psxdma.h"
 #include "psxevents.h"
 #include "arm_features.h"
+#include "pcnt.h"
+#include "evtrace.h"
 
 /* logging */
 #if 0
@@ -51,6 +54,35 @@
 //#define CDR_LOG_CMD
 //#define CDR_LOG_CMD_ACK
 
+// time the emu thread spends in sector reads, for the frontend's perf
+// graph, off until the first cdrGetReadTime() call
+static int read_prof_on;
+static u32 read_prof_us;
+
+static u32 read_prof_ticks(void)
+{
+#ifndef _WIN32
+	struct timespec ts;
+
+	if (!read_prof_on)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	return 0;
+#endif
+}
+
+// usecs since the last call
+u32 cdrGetReadTime(void)
+{
+	u32 ret = read_prof_us;
+
+	read_prof_on = 1;
+	read_prof_us = 0;
+	return ret;
+}
+
 static struct {
 	// unused members maintain savesate compatibility
 	unsigned char unused0;
@@ -126,7 +158,10 @@ static struct {
 	u8 AttenuatorLeftToLeftT, AttenuatorLeftToRightT;
 	u8 AttenuatorRightToRightT, AttenuatorRightToLeftT;
 } cdr;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+// CDDA swapped to host order, on LE the prefetched sector is used as is
 alignas(64) static s16 read_buf[CD_FRAMESIZE_RAW_ALIGNED / 2];
+#endif
 
 struct SubQ {
 	char res0[12];
@@ -423,12 +458,18 @@ static void Find_CurTrack(const u8 *time)
 	}
 }
 
+// with real subchannel data only the sector is remembered and the read
+// and crc check are done by SubqResolve() once something looks at cdr.subq
+static u8 subq_time[3];
+static int subq_pending;
+
 static void generate_subq(const u8 *time)
 {
 	unsigned char start[3], next[3];
 	int this_s, start_s, next_s, pregap;
 	int relative_s;
 
+	subq_pending = 0;
 	if (cdr.CurTrack <= cdr.ResultTN[1])
 		cdra_getTD(cdr.CurTrack, start);
 	else
@@ -478,6 +519,7 @@ static void generate_subq(const u8 *time)
 
 static int ReadTrack(const u8 *time)
 {
+	u32 t0;
 	int ret;
 
 	CDR_LOG("ReadTrack *** %02d:%02d:%02d\n", time[0], time[1], time[2]);
@@ -485,7 +527,13 @@ static int ReadTrack(const u8 *time)
 	if (memcmp(cdr.Prev, time, 3) == 0)
 		return 1;
 
+	pcnt_start(PCNT_CDR);
+	evtrace_begin(EVT_CDR_READ, MSF2SECT(time[0], time[1], time[2]));
+	t0 = read_prof_ticks();
 	ret = cdra_readTrack(time);
+	read_prof_us += read_prof_ticks() - t0;
+	evtrace_end(EVT_CDR_READ);
+	pcnt_end(PCNT_CDR);
 	if (ret == 0)
 		memcpy(cdr.Prev, time, 3);
 	else
@@ -494,15 +542,12 @@ static int ReadTrack(const u8 *time)
 	return ret == 0;
 }
 
-static void UpdateSubq(const u8 *time)
+static void UpdateSubqNow(const u8 *time)
 {
-	int ret = -1, s = MSF2SECT(time[0], time[1], time[2]);
 	struct SubQ subq;
+	int ret = -1;
 	u16 crc;
 
-	if (CheckSBI(s))
-		return;
-
 	if (cdr.CurTrack == 1)
 		ret = cdra_readSub(time, &subq);
 	if (ret == 0) {
@@ -528,12 +573,37 @@ static void UpdateSubq(const u8 *time)
 		cdr.subq.Absolute[0], cdr.subq.Absolute[1], cdr.subq.Absolute[2]);
 }
 
-static void cdrPlayInterrupt_Autopause()
+static void UpdateSubq(const u8 *time)
+{
+	int s = MSF2SECT(time[0], time[1], time[2]);
+
+	if (CheckSBI(s))
+		return;
+
+	if (cdr.CurTrack == 1 && cdra_has_subchannel()) {
+		memcpy(subq_time, time, sizeof(subq_time));
+		subq_pending = 1;
+		return;
+	}
+	subq_pending = 0;
+	UpdateSubqNow(time);
+}
+
+static void SubqResolve(void)
+{
+	if (subq_pending) {
+		subq_pending = 0;
+		UpdateSubqNow(subq_time);
+	}
+}
+
+static void cdrPlayInterrupt_Autopause(const s16 *cdda)
 {
 	u32 abs_lev_max = 0;
 	boolean abs_lev_chselect;
 	u32 i;
 
+	SubqResolve();
 	if ((cdr.Mode & MODE_AUTOPAUSE) && cdr.TrackChanged) {
 		CDR_LOG_I("autopause\n");
 
@@ -558,7 +628,7 @@ static void cdrPlayInterrupt_Autopause()
 		/* 8 is a hack. For accuracy, it should be 588. */
 		for (i = 0; i < 8; i++)
 		{
-			abs_lev_max = MAX_VALUE(abs_lev_max, abs(read_buf[i * 2 + abs_lev_chselect]));
+			abs_lev_max = MAX_VALUE(abs_lev_max, abs(cdda[i * 2 + abs_lev_chselect]));
 		}
 		abs_lev_max = MIN_VALUE(abs_lev_max, 32767);
 		abs_lev_max |= abs_lev_chselect << 15;
@@ -643,7 +713,7 @@ static u32 cdrAlignTimingHack(u32 cycles)
 
 static void cdrUpdateTransferBuf(const u8 *buf);
 static void cdrReadInterrupt(void);
-static void cdrPrepCdda(s16 *buf, int samples);
+static const s16 *cdrPrepCdda(const s16 *buf, int samples);
 
 static void msfiAdd(u8 *msfi, u32 count)
 {
@@ -680,9 +750,11 @@ static int msfiEq(const u8 *a, const u8 *b)
 
 void cdrPlayReadInterrupt(void)
 {
+	const s16 *cdda;
+
 	// this works but causes instability for timing sensitive games
 #if 0
-	int hit = cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2]);
+	int hit = cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2], 1);
 	if (!hit && cdr.PhysCdPropagations < 75/2) {
 		// this propagates the real cdrom delays to the emulated game
 		CDRPLAYREAD_INT(cdReadTime / 2, 0);
@@ -712,19 +784,27 @@ void cdrPlayReadInterrupt(void)
 		cdr.DriveState = DRIVESTATE_PAUSED;
 	}
 	else {
-		cdra_readCDDA(cdr.SetSectorPlay, read_buf);
+		u32 t0 = read_prof_ticks();
+		pcnt_start(PCNT_CDR);
+		evtrace_begin(EVT_CDR_READ, MSF2SECT(cdr.SetSectorPlay[0],
+			cdr.SetSectorPlay[1], cdr.SetSectorPlay[2]));
+		cdra_readCDDA(cdr.SetSectorPlay);
+		evtrace_end(EVT_CDR_READ);
+		pcnt_end(PCNT_CDR);
+		read_prof_us += read_prof_ticks() - t0;
 	}
 
+	// a prefetched sector goes from the cache straight to the SPU
+	cdda = cdrPrepCdda(cdra_getCDDABuffer(), CD_FRAMESIZE_RAW / 4);
+
 	if (!cdr.IrqStat && (cdr.Mode & (MODE_AUTOPAUSE|MODE_REPORT)))
-		cdrPlayInterrupt_Autopause();
+		cdrPlayInterrupt_Autopause(cdda);
 
-	if (cdr.Play && !Config.Cdda) {
-		cdrPrepCdda(read_buf, CD_FRAMESIZE_RAW / 4);
-		SPU_playCDDAchannel(read_buf, CD_FRAMESIZE_RAW, psxRegs.cycle, 0);
-	}
+	if (cdr.Play && !Config.Cdda)
+		SPU_playCDDAchannel((short *)cdda, CD_FRAMESIZE_RAW, psxRegs.cycle, 0);
 
 	msfiAdd(cdr.SetSectorPlay, 1);
-	cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2]);
+	cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2], 1);
 
 	// update for CdlGetlocP/autopause
 	generate_subq(cdr.SetSectorPlay);
@@ -1093,6 +1173,7 @@ void cdrInterrupt(void) {
 			break;
 
 		case CdlGetlocP:
+			SubqResolve();
 			SetResultSize_(8);
 			memcpy(&cdr.Result, &cdr.subq, 8);
 			break;
@@ -1140,7 +1221,7 @@ void cdrInterrupt(void) {
 			memcpy(cdr.SetSectorPlay, cdr.SetSector, 4);
 			cdr.DriveState = DRIVESTATE_SEEK;
 			cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1],
-					cdr.SetSectorPlay[2]);
+					cdr.SetSectorPlay[2], 0);
 			/*
 			Crusaders of Might and Magic = 0.5x-4x
 			- fix cutscene speech start
@@ -1303,8 +1384,9 @@ void cdrInterrupt(void) {
 			cdr.sectorsRead = 0;
 			cdr.DriveState = DRIVESTATE_SEEK;
 			cdr.PhysCdPropagations = 0;
+			// with adpcm on this is likely an xa stream
 			cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1],
-					cdr.SetSectorPlay[2]);
+					cdr.SetSectorPlay[2], !!(cdr.Mode & MODE_STRSND));
 
 			cycles = (cdr.Mode & MODE_SPEED) ? cdReadTime : cdReadTime * 2;
 			cycles += seekTime;
@@ -1349,14 +1431,17 @@ void cdrInterrupt(void) {
 	setIrq(IrqStat, Cmd);
 }
 
-static void cdrPrepCdda(s16 *buf, int samples)
+static const s16 *cdrPrepCdda(const s16 *buf, int samples)
 {
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
 	int i;
 	for (i = 0; i < samples; i++) {
-		buf[i * 2 + 0] = SWAP16(buf[i * 2 + 0]);
-		buf[i * 2 + 1] = SWAP16(buf[i * 2 + 1]);
+		read_buf[i * 2 + 0] = SWAP16(buf[i * 2 + 0]);
+		read_buf[i * 2 + 1] = SWAP16(buf[i * 2 + 1]);
 	}
+	return read_buf;
+#else
+	return buf;
 #endif
 }
 
@@ -1399,6 +1484,12 @@ static void cdrReadInterrupt(void)
 	int read_ok;
 	int is_start;
 
+	// with turbo, data reads skip the (subq only) spin-up events
+	// and go straight to the first sector
+	if (cdr.SubqForwardSectors < SUBQ_FORWARD_SECTORS
+	    && !(cdr.Mode & MODE_STRSND) && canDoTurbo())
+		cdr.SubqForwardSectors = SUBQ_FORWARD_SECTORS;
+
 	memcpy(subqPos, cdr.SetSectorPlay, sizeof(subqPos));
 	msfiAdd(subqPos, cdr.SubqForwardSectors);
 	UpdateSubq(subqPos);
@@ -1484,7 +1575,8 @@ static void cdrReadInterrupt(void)
 		cdrReadInterruptSetResult(cdr.StatP);
 
 	msfiAdd(cdr.SetSectorPlay, 1);
-	cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2]);
+	cdra_prefetch(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1], cdr.SetSectorPlay[2],
+		(cdr.Mode & MODE_STRSND) && cdr.FileChannelSelected);
 
 	CDRPLAYREAD_INT((cdr.Mode & MODE_SPEED) ? (cdReadTime / 2) : cdReadTime, 0);
 }
@@ -1811,6 +1903,9 @@ int cdrFreeze(void *f, int Mode) {
 	u32 tmp;
 	u8 tmpp[3];
 
+	if (Mode == 1)
+		SubqResolve();
+	subq_pending = 0;
 	cdr.freeze_ver = 0x63647203;
 	gzfreeze(&cdr, sizeof(cdr));
 	
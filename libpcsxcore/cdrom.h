@@ -79,6 +79,7 @@ void cdrWrite1(unsigned char rt);
 void cdrWrite2(unsigned char rt);
 void cdrWrite3(unsigned char rt);
 int cdrFreeze(void *f, int Mode);
+u32 cdrGetReadTime(void);
 
 #ifdef __cplusplus
 }
@@ -35,9 +35,14 @@ int NumCodes = 0;
 int NumCodesAllocated = 0;
 
 s8 *prevM = NULL;
-u32 *SearchResults = NULL;
+static u64 *SearchBitmap = NULL;	// a bit per byte of ram, NULL before a search
 int NumSearchResults = 0;
-static int NumSearchResultsAllocated = 0;
+
+static struct cheat_op *CheatOps = NULL;
+static int NumCheatOps = 0;
+static int NumCheatOpsAllocated = 0;
+static s8 *CheatOpsMem = NULL;	// psxM the ops point into
+static int CheatsDirty = 0;		// codes changed, ops need a rebuild
 
 #define ALLOC_INCREMENT		100
 
@@ -62,6 +67,12 @@ void ClearAllCheats() {
 	CheatCodes = NULL;
 	NumCodes = 0;
 	NumCodesAllocated = 0;
+
+	free(CheatOps);
+	CheatOps = NULL;
+	NumCheatOps = 0;
+	NumCheatOpsAllocated = 0;
+	CheatsDirty = 1;
 }
 
 // load cheats from the specific filename
@@ -184,162 +195,252 @@ void SaveCheats(const char *filename) {
 	SysPrintf(_("Cheats saved to: %s\n"), filename);
 }
 
-// apply all enabled cheats
-void ApplyCheats() {
-	int		i, j, k, endindex;
-	int		was_enabled;
-
-	for (i = 0; i < NumCheats; i++) {
-		was_enabled = Cheats[i].WasEnabled;
-		if (!Cheats[i].Enabled) {
-			if (!Cheats[i].WasEnabled)
-				continue;
+// enabled cheats, flattened into what ApplyCheats() runs each frame.
+// Each code is an op at the same position as in its cheat, so a failed
+// condition skips the next code by skipping the next op, same as before
+// (2 code slide/memcpy ops cover their data code with skip too).
+struct cheat_op {
+	u8		*ptr;	// into psxM/psxH for the simple types
+	u32		addr;	// slide/memcpy target
+	u32		src;	// memcpy source
+	u16		val;
+	u8		type;	// CHEAT_*, 0 does nothing
+	u8		skip;	// ops after this one a failed condition skips
+	u8		n;		// slide count
+	u8		size;	// slide write size
+	s8		step, vstep; // slide address and value increments
+};
+
+#define CHEAT_NOP 0
+
+// save the values an enabled cheat overwrites, put them back when disabled
+static void CheatToggle(Cheat *cheat) {
+	int j;
+
+	for (j = cheat->First; j < cheat->First + cheat->n; j++) {
+		u8		type = (uint8_t)(CheatCodes[j].Addr >> 24);
+		u32		addr = (CheatCodes[j].Addr & 0x001FFFFF);
+
+		if (cheat->Enabled) {
+			if (type == CHEAT_CONST16)
+				CheatCodes[j].OldVal = psxMu16(addr);
+			else if (type == CHEAT_CONST8)
+				CheatCodes[j].OldVal = psxMu8(addr);
 		}
-		Cheats[i].WasEnabled = Cheats[i].Enabled;
-
-		// process all cheat codes
-		endindex = Cheats[i].First + Cheats[i].n;
-
-		for (j = Cheats[i].First; j < endindex; j++) {
-			u8		type = (uint8_t)(CheatCodes[j].Addr >> 24);
-			u32		addr = (CheatCodes[j].Addr & 0x001FFFFF);
-			u16		val = CheatCodes[j].Val;
-			u32		taddr;
-
-			if (!was_enabled) {
-				switch (type) {
-					case CHEAT_CONST16:
-						CheatCodes[j].OldVal = psxMu16(addr);
-						break;
-					case CHEAT_CONST8:
-						CheatCodes[j].OldVal = psxMu8(addr);
-						break;
-				}
-			}
-			else if (!Cheats[i].Enabled) {
-				val = CheatCodes[j].OldVal;
-				if (type != CHEAT_CONST16 && type != CHEAT_CONST8)
-					continue;
-			}
-
-			switch (type) {
-				case CHEAT_CONST8:
-					psxMu8ref(addr) = (u8)val;
-					break;
-
-				case CHEAT_CONST16:
-					psxMu16ref(addr) = SWAPu16(val);
-					break;
-
-				case CHEAT_SCRATCHPAD16: // 1F
-					psxHs16ref(addr) = SWAPu16(val);
-					break;
-
-				case CHEAT_INC16:
-					psxMu16ref(addr) = SWAPu16(psxMu16(addr) + val);
-					break;
-
-				case CHEAT_DEC16:
-					psxMu16ref(addr) = SWAPu16(psxMu16(addr) - val);
-					break;
-
-				case CHEAT_INC8:
-					psxMu8ref(addr) += (u8)val;
-					break;
-
-				case CHEAT_DEC8:
-					psxMu8ref(addr) -= (u8)val;
-					break;
-
-				case CHEAT_SLIDE:
-					j++;
-					if (j >= endindex)
-						break;
-
-					type = (uint8_t)(CheatCodes[j].Addr >> 24);
-					taddr = (CheatCodes[j].Addr & 0x001FFFFF);
-					val = CheatCodes[j].Val;
-
-					if (type == CHEAT_CONST8) {
-						for (k = 0; k < ((addr >> 8) & 0xFF); k++) {
-							psxMu8ref(taddr) = (u8)val;
-							taddr += (s8)(addr & 0xFF);
-							val += (s8)(CheatCodes[j - 1].Val & 0xFF);
-						}
-					}
-					else if (type == CHEAT_CONST16) {
-						for (k = 0; k < ((addr >> 8) & 0xFF); k++) {
-							psxMu16ref(taddr) = SWAPu16(val);
-							taddr += (s8)(addr & 0xFF);
-							val += (s8)(CheatCodes[j - 1].Val & 0xFF);
-						}
-					}
-					break;
-
-				case CHEAT_MEMCPY:
-					j++;
-					if (j >= endindex)
-						break;
-
-					taddr = (CheatCodes[j].Addr & 0x001FFFFF);
-					for (k = 0; k < val; k++) {
-						psxMu8ref(taddr + k) = PSXMu8(addr + k);
-					}
+		else {
+			if (type == CHEAT_CONST16)
+				psxMu16ref(addr) = SWAPu16(CheatCodes[j].OldVal);
+			else if (type == CHEAT_CONST8)
+				psxMu8ref(addr) = (u8)CheatCodes[j].OldVal;
+		}
+	}
+	cheat->WasEnabled = cheat->Enabled;
+}
+
+static int CompileCheat(int i, struct cheat_op *op) {
+	int		j, endindex = Cheats[i].First + Cheats[i].n;
+
+	for (j = Cheats[i].First; j < endindex; j++, op++) {
+		u8		type = (uint8_t)(CheatCodes[j].Addr >> 24);
+		u32		addr = (CheatCodes[j].Addr & 0x001FFFFF);
+		int		last = j + 1 >= endindex;
+
+		memset(op, 0, sizeof(*op));
+		op->type = type;
+		op->val = CheatCodes[j].Val;
+		op->ptr = (u8 *)&psxM[addr];
+
+		switch (type) {
+			case CHEAT_CONST8:
+			case CHEAT_CONST16:
+			case CHEAT_INC16:
+			case CHEAT_DEC16:
+			case CHEAT_INC8:
+			case CHEAT_DEC8:
+				break;
+
+			case CHEAT_SCRATCHPAD16:
+				op->ptr = (u8 *)&psxHs16ref(addr);
+				break;
+
+			case CHEAT_EQU8:
+			case CHEAT_NOTEQU8:
+			case CHEAT_LESSTHAN8:
+			case CHEAT_GREATERTHAN8:
+			case CHEAT_EQU16:
+			case CHEAT_NOTEQU16:
+			case CHEAT_LESSTHAN16:
+			case CHEAT_GREATERTHAN16:
+			case CHEAT_BUTTONS1_16:
+				op->skip = !last;
+				break;
+
+			case CHEAT_SLIDE:
+				if (last) {
+					op->type = CHEAT_NOP;
 					break;
+				}
+				type = (uint8_t)(CheatCodes[j + 1].Addr >> 24);
+				op->skip = 1;
+				op->addr = (CheatCodes[j + 1].Addr & 0x001FFFFF);
+				op->val = CheatCodes[j + 1].Val;
+				op->step = (s8)(addr & 0xFF);
+				op->vstep = (s8)(CheatCodes[j].Val & 0xFF);
+				if (type == CHEAT_CONST8 || type == CHEAT_CONST16) {
+					op->n = (addr >> 8) & 0xFF;
+					op->size = type == CHEAT_CONST8 ? 1 : 2;
+				}
+				break;
 
-				case CHEAT_EQU8:
-					if (PSXMu8(addr) != (u8)val)
-						j++; // skip the next code
+			case CHEAT_MEMCPY:
+				if (last) {
+					op->type = CHEAT_NOP;
 					break;
+				}
+				op->skip = 1;
+				op->addr = (CheatCodes[j + 1].Addr & 0x001FFFFF);
+				op->src = addr;
+				break;
 
-				case CHEAT_NOTEQU8:
-					if (PSXMu8(addr) == (u8)val)
-						j++; // skip the next code
-					break;
+			default:
+				SysPrintf("unhandled cheat %d,%d code %08X\n",
+					i, j, CheatCodes[j].Addr);
+				Cheats[i].WasEnabled = Cheats[i].Enabled = 0;
+				return 0;
+		}
+	}
 
-				case CHEAT_LESSTHAN8:
-					if (PSXMu8(addr) >= (u8)val)
-						j++; // skip the next code
-					break;
+	return Cheats[i].n;
+}
 
-				case CHEAT_GREATERTHAN8:
-					if (PSXMu8(addr) <= (u8)val)
-						j++; // skip the next code
-					break;
+static void CompileCheats() {
+	int		i;
 
-				case CHEAT_EQU16:
-					if (PSXMu16(addr) != val)
-						j++; // skip the next code
-					break;
+	if (NumCheatOpsAllocated < NumCodes) {
+		NumCheatOpsAllocated = NumCodes;
+		CheatOps = (struct cheat_op *)realloc(CheatOps,
+			sizeof(CheatOps[0]) * NumCheatOpsAllocated);
+	}
 
-				case CHEAT_NOTEQU16:
-					if (PSXMu16(addr) == val)
-						j++; // skip the next code
-					break;
+	NumCheatOps = 0;
+	for (i = 0; i < NumCheats && CheatOps != NULL; i++) {
+		if (Cheats[i].Enabled)
+			NumCheatOps += CompileCheat(i, CheatOps + NumCheatOps);
+	}
 
-				case CHEAT_LESSTHAN16:
-					if (PSXMu16(addr) >= val)
-						j++; // skip the next code
-					break;
+	CheatOpsMem = psxM;
+	CheatsDirty = 0;
+}
 
-				case CHEAT_GREATERTHAN16:
-					if (PSXMu16(addr) <= val)
-						j++; // skip the next code
-					break;
+// apply all enabled cheats
+void ApplyCheats() {
+	const struct cheat_op *op, *end;
+	int		i, k, changed = CheatsDirty || CheatOpsMem != psxM;
+	u32		taddr;
+	u16		val;
 
-				case CHEAT_BUTTONS1_16: { // D4
-					u16 keys = in_keystate[0];
-					keys = (keys << 8) | (keys >> 8);
-					if (keys != val)
-						j++; // skip the next code
-					break;
+	for (i = 0; i < NumCheats; i++) {
+		if (Cheats[i].Enabled != Cheats[i].WasEnabled) {
+			CheatToggle(&Cheats[i]);
+			changed = 1;
+		}
+	}
+	if (changed)
+		CompileCheats();
+
+	for (op = CheatOps, end = CheatOps + NumCheatOps; op < end; op++) {
+		switch (op->type) {
+			case CHEAT_CONST8:
+				*op->ptr = (u8)op->val;
+				break;
+
+			case CHEAT_CONST16:
+			case CHEAT_SCRATCHPAD16: // 1F
+				*(u16 *)op->ptr = SWAPu16(op->val);
+				break;
+
+			case CHEAT_INC16:
+				*(u16 *)op->ptr = SWAPu16(SWAP16(*(u16 *)op->ptr) + op->val);
+				break;
+
+			case CHEAT_DEC16:
+				*(u16 *)op->ptr = SWAPu16(SWAP16(*(u16 *)op->ptr) - op->val);
+				break;
+
+			case CHEAT_INC8:
+				*op->ptr += (u8)op->val;
+				break;
+
+			case CHEAT_DEC8:
+				*op->ptr -= (u8)op->val;
+				break;
+
+			case CHEAT_SLIDE:
+				taddr = op->addr;
+				val = op->val;
+				for (k = 0; k < op->n; k++) {
+					if (op->size == 1)
+						psxMu8ref(taddr) = (u8)val;
+					else
+						psxMu16ref(taddr) = SWAPu16(val);
+					taddr += op->step;
+					val += op->vstep;
 				}
-
-				default:
-					SysPrintf("unhandled cheat %d,%d code %08X\n",
-						i, j, CheatCodes[j].Addr);
-					Cheats[i].WasEnabled = Cheats[i].Enabled = 0;
-					break;
+				op += op->skip;
+				break;
+
+			case CHEAT_MEMCPY:
+				for (k = 0; k < op->val; k++)
+					psxMu8ref(op->addr + k) = psxMu8(op->src + k);
+				op += op->skip;
+				break;
+
+			case CHEAT_EQU8:
+				if (*op->ptr != (u8)op->val)
+					op += op->skip; // skip the next code
+				break;
+
+			case CHEAT_NOTEQU8:
+				if (*op->ptr == (u8)op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_LESSTHAN8:
+				if (*op->ptr >= (u8)op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_GREATERTHAN8:
+				if (*op->ptr <= (u8)op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_EQU16:
+				if (SWAP16(*(u16 *)op->ptr) != op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_NOTEQU16:
+				if (SWAP16(*(u16 *)op->ptr) == op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_LESSTHAN16:
+				if (SWAP16(*(u16 *)op->ptr) >= op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_GREATERTHAN16:
+				if (SWAP16(*(u16 *)op->ptr) <= op->val)
+					op += op->skip;
+				break;
+
+			case CHEAT_BUTTONS1_16: { // D4
+				u16 keys = in_keystate[0];
+				keys = (keys << 8) | (keys >> 8);
+				if (keys != op->val)
+					op += op->skip;
+				break;
 			}
 		}
 	}
@@ -417,6 +518,7 @@ int AddCheat(const char *descr, char *code) {
 
 	Cheats[NumCheats].Descr = strdup(descr[0] ? descr : _("(Untitled)"));
 	NumCheats++;
+	CheatsDirty = 1;
 	return 0;
 }
 
@@ -432,6 +534,7 @@ void RemoveCheat(int index) {
 	}
 
 	NumCheats--;
+	CheatsDirty = 1;
 }
 
 int EditCheat(int index, const char *descr, char *code) {
@@ -490,18 +593,16 @@ int EditCheat(int index, const char *descr, char *code) {
 	Cheats[index].Descr = strdup(descr[0] ? descr : _("(Untitled)"));
 	Cheats[index].First = prev;
 	Cheats[index].n = NumCodes - prev;
+	CheatsDirty = 1;
 
 	return 0;
 }
 
 void FreeCheatSearchResults() {
-	if (SearchResults != NULL) {
-		free(SearchResults);
-	}
-	SearchResults = NULL;
+	free(SearchBitmap);
+	SearchBitmap = NULL;
 
 	NumSearchResults = 0;
-	NumSearchResultsAllocated = 0;
 }
 
 void FreeCheatSearchMem() {
@@ -524,548 +625,222 @@ static void CheatSearchInitBackupMemory() {
 	}
 }
 
-static void CheatSearchAddResult(u32 addr) {
-	if (NumSearchResults >= NumSearchResultsAllocated) {
-		NumSearchResultsAllocated += ALLOC_INCREMENT;
-
-		if (SearchResults == NULL) {
-			SearchResults = (u32 *)malloc(sizeof(u32) * NumSearchResultsAllocated);
-		}
-		else {
-			SearchResults = (u32 *)realloc(SearchResults, sizeof(u32) * NumSearchResultsAllocated);
-		}
-	}
-
-	SearchResults[NumSearchResults++] = addr;
-}
-
-void CheatSearchEqual8(u8 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i++) {
-			if (PSXMu8(i) == val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
+u32 CheatSearchNextResult(u32 addr) {
+	u64 w;
 
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu8(SearchResults[i]) == val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchEqual16(u16 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 2) {
-			if (PSXMu16(i) == val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu16(SearchResults[i]) == val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchEqual32(u32 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 4) {
-			if (PSXMu32(i) == val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu32(SearchResults[i]) == val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchNotEqual8(u8 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i++) {
-			if (PSXMu8(i) != val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu8(SearchResults[i]) != val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchNotEqual16(u16 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 2) {
-			if (PSXMu16(i) != val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu16(SearchResults[i]) != val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchNotEqual32(u32 val) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 4) {
-			if (PSXMu32(i) != val) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu32(SearchResults[i]) != val) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchRange8(u8 min, u8 max) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i++) {
-			if (PSXMu8(i) >= min && PSXMu8(i) <= max) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu8(SearchResults[i]) >= min && PSXMu8(SearchResults[i]) <= max) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchRange16(u16 min, u16 max) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 2) {
-			if (PSXMu16(i) >= min && PSXMu16(i) <= max) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu16(SearchResults[i]) >= min && PSXMu16(SearchResults[i]) <= max) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
+	if (SearchBitmap == NULL || addr >= 0x200000)
+		return 0x200000;
 
-		NumSearchResults = j;
+	w = SearchBitmap[addr / 64] & (~0ull << (addr & 63));
+	addr &= ~63;
+	while (w == 0) {
+		addr += 64;
+		if (addr >= 0x200000)
+			return 0x200000;
+		w = SearchBitmap[addr / 64];
 	}
+	return addr + __builtin_ctzll(w);
 }
 
-void CheatSearchRange32(u32 min, u32 max) {
-	u32 i, j;
-
-	CheatSearchInitBackupMemory();
-
-	if (SearchResults == NULL) {
-		// search the whole memory
-		for (i = 0; i < 0x200000; i += 4) {
-			if (PSXMu32(i) >= min && PSXMu32(i) <= max) {
-				CheatSearchAddResult(i);
-			}
-		}
-	}
-	else {
-		// only search within the previous results
-		j = 0;
-
-		for (i = 0; i < NumSearchResults; i++) {
-			if (PSXMu32(SearchResults[i]) >= min && PSXMu32(SearchResults[i]) <= max) {
-				SearchResults[j++] = SearchResults[i];
-			}
-		}
-
-		NumSearchResults = j;
-	}
-}
-
-void CheatSearchIncreasedBy8(u8 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PSXMu8(SearchResults[i]) - PrevMu8(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchIncreasedBy16(u16 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PSXMu16(SearchResults[i]) - PrevMu16(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchIncreasedBy32(u32 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PSXMu32(SearchResults[i]) - PrevMu32(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreasedBy8(u8 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu8(SearchResults[i]) - PSXMu8(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreasedBy16(u16 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu16(SearchResults[i]) - PSXMu16(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreasedBy32(u32 val) {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu32(SearchResults[i]) - PSXMu32(SearchResults[i]) == val) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchIncreased8() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu8(SearchResults[i]) < PSXMu8(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchIncreased16() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu16(SearchResults[i]) < PSXMu16(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchIncreased32() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu32(SearchResults[i]) < PSXMu32(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreased8() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu8(SearchResults[i]) > PSXMu8(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreased16() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu16(SearchResults[i]) > PSXMu16(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDecreased32() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu32(SearchResults[i]) > PSXMu32(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDifferent8() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu8(SearchResults[i]) != PSXMu8(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDifferent16() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu16(SearchResults[i]) != PSXMu16(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchDifferent32() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu32(SearchResults[i]) != PSXMu32(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchNoChange8() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
-
-	j = 0;
-
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu8(SearchResults[i]) == PSXMu8(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
-	}
-
-	NumSearchResults = j;
-}
-
-void CheatSearchNoChange16() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
+/*
+ * All the searches are one kernel: dropping the candidates where
+ *  lo <= x <= hi is false (or true with invert), x being the current
+ *  value, current - previous or previous - current. Increased/Decreased
+ *  compare the two instead. The 8/16 bit "by" searches used int math,
+ *  so they don't match wrapped differences, guard is for that.
+ * Candidates are a bit per byte of ram, a 64 byte chunk is a bitmap word.
+ */
+enum {
+	CS_CUR,
+	CS_INC_BY,
+	CS_DEC_BY,
+	CS_INC,
+	CS_DEC,
+};
+
+struct cheat_search {
+	int		size;
+	int		mode;
+	int		invert;
+	u32		lo, span;
+};
+
+static u32 CheatSearchLoad(const s8 *mem, u32 addr, int size) {
+	u32 v = 0;
+	int i;
 
-	j = 0;
+	// unaligned candidates (size changed between searches) still wrap
+	for (i = size - 1; i >= 0; i--)
+		v = (v << 8) | (u8)mem[(addr + i) & 0x1fffff];
+	return v;
+}
+
+static int CheatSearchTest(const struct cheat_search *s, u32 cur, u32 prev) {
+	u32 mask = s->size == 4 ? ~0u : (1u << (s->size * 8)) - 1;
+	u32 x = cur;
+	int m;
+
+	switch (s->mode) {
+		case CS_INC: return cur > prev;
+		case CS_DEC: return cur < prev;
+		case CS_INC_BY: x = cur - prev; break;
+		case CS_DEC_BY: x = prev - cur; break;
+	}
+	m = ((x - s->lo) & mask) <= s->span;
+	if (s->invert)
+		m = !m;
+	if (s->size < 4 && s->mode == CS_INC_BY)
+		m &= cur >= s->lo;
+	if (s->size < 4 && s->mode == CS_DEC_BY)
+		m &= prev >= s->lo;
+	return m;
+}
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__SSE2__)) \
+    && (defined(__GNUC__) || defined(__clang__)) \
+    && __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+#define CHEAT_SEARCH_SIMD
+
+typedef u8  csv_u8  __attribute__((vector_size(16)));
+typedef u16 csv_u16 __attribute__((vector_size(16)));
+typedef u32 csv_u32 __attribute__((vector_size(16)));
+
+// the compare lanes are all ones where they match, so any byte of a lane
+// tells; this one is for 16 bytes of 1 byte lanes, the rest cast to it
+#define CS_VEC(vt, lt, c_, p_) ({ \
+	vt c = (vt)(c_), p = (vt)(p_), x = c, m; \
+	vt lo = (vt){0} + (lt)s->lo, span = (vt){0} + (lt)s->span; \
+	switch (s->mode) { \
+		case CS_INC_BY: x = c - p; break; \
+		case CS_DEC_BY: x = p - c; break; \
+	} \
+	m = (vt)(x - lo <= span); \
+	if (s->mode == CS_INC) m = (vt)(c > p); \
+	if (s->mode == CS_DEC) m = (vt)(c < p); \
+	if (s->invert) m = ~m; \
+	if (s->size < 4 && s->mode == CS_INC_BY) m &= (vt)(c >= lo); \
+	if (s->size < 4 && s->mode == CS_DEC_BY) m &= (vt)(p >= lo); \
+	(csv_u8)m; \
+})
+
+// 8 bytes that are 0 or 1 to 8 bits, byte n to bit n
+static inline u32 CheatSearchPack8(u64 v) {
+	return ((v & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56;
+}
+
+static u64 CheatSearchChunk(const struct cheat_search *s, const s8 *cur,
+		const s8 *prev) {
+	u8 flags[64];
+	u64 w = 0, t;
+	int k;
+
+	for (k = 0; k < 64; k += 16) {
+		csv_u8 vc, vp, vm;
+		memcpy(&vc, cur + k, 16);
+		memcpy(&vp, prev + k, 16);
+		if (s->size == 1)
+			vm = CS_VEC(csv_u8, u8, vc, vp);
+		else if (s->size == 2)
+			vm = CS_VEC(csv_u16, u16, vc, vp);
+		else
+			vm = CS_VEC(csv_u32, u32, vc, vp);
+		memcpy(flags + k, &vm, 16);
+	}
+	for (k = 0; k < 64; k += 8) {
+		memcpy(&t, flags + k, 8);
+		w |= (u64)CheatSearchPack8(t) << k;
+	}
+	return w;
+}
+#endif
+
+static void CheatSearch(const struct cheat_search *s) {
+	static const u64 align[5] = { 0, ~0ull, 0x5555555555555555ull,
+		0, 0x1111111111111111ull };
+	const s8 *prev;
+	u32 i, a;
+	int n = 0;
+
+	if (SearchBitmap == NULL) {
+		if (s->mode != CS_CUR)
+			return; // not possible for the first search
+		SearchBitmap = (u64 *)malloc(0x200000 / 8);
+		if (SearchBitmap == NULL)
+			return;
+		// the whole memory, in steps of the size
+		for (i = 0; i < 0x200000 / 64; i++)
+			SearchBitmap[i] = align[s->size];
+	}
+	prev = prevM ? prevM : psxM;
+
+	for (i = 0; i < 0x200000 / 64; i++) {
+		u64 w = SearchBitmap[i], odd;
+		if (w == 0)
+			continue;
 
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu16(SearchResults[i]) == PSXMu16(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
+		odd = w & ~align[s->size];
+#ifdef CHEAT_SEARCH_SIMD
+		w &= CheatSearchChunk(s, psxM + i * 64, prev + i * 64) | odd;
+#else
+		odd = w;
+#endif
+		// leftover single candidates, bit by bit
+		while (odd) {
+			a = i * 64 + __builtin_ctzll(odd);
+			odd &= odd - 1;
+			if (!CheatSearchTest(s, CheatSearchLoad(psxM, a, s->size),
+					CheatSearchLoad(prev, a, s->size)))
+				w &= ~(1ull << (a & 63));
 		}
+		SearchBitmap[i] = w;
+		n += __builtin_popcountll(w);
 	}
 
-	NumSearchResults = j;
+	NumSearchResults = n;
 }
 
-void CheatSearchNoChange32() {
-	u32 i, j;
-
-	assert(prevM != NULL); // not possible for the first search
+static void CheatSearchValue(int size, int mode, int invert, u32 lo, u32 hi) {
+	struct cheat_search s = { size, mode, invert, lo, hi - lo };
 
-	j = 0;
+	if (mode == CS_CUR)
+		CheatSearchInitBackupMemory();
+	else
+		assert(prevM != NULL); // not possible for the first search
 
-	for (i = 0; i < NumSearchResults; i++) {
-		if (PrevMu32(SearchResults[i]) == PSXMu32(SearchResults[i])) {
-			SearchResults[j++] = SearchResults[i];
-		}
+	if (lo > hi) {
+		// empty range, nothing can match
+		if (SearchBitmap != NULL)
+			memset(SearchBitmap, 0, 0x200000 / 8);
+		NumSearchResults = 0;
+		return;
 	}
-
-	NumSearchResults = j;
-}
+	CheatSearch(&s);
+}
+
+void CheatSearchEqual8(u8 val)		{ CheatSearchValue(1, CS_CUR, 0, val, val); }
+void CheatSearchEqual16(u16 val)	{ CheatSearchValue(2, CS_CUR, 0, val, val); }
+void CheatSearchEqual32(u32 val)	{ CheatSearchValue(4, CS_CUR, 0, val, val); }
+void CheatSearchNotEqual8(u8 val)	{ CheatSearchValue(1, CS_CUR, 1, val, val); }
+void CheatSearchNotEqual16(u16 val)	{ CheatSearchValue(2, CS_CUR, 1, val, val); }
+void CheatSearchNotEqual32(u32 val)	{ CheatSearchValue(4, CS_CUR, 1, val, val); }
+void CheatSearchRange8(u8 min, u8 max)		{ CheatSearchValue(1, CS_CUR, 0, min, max); }
+void CheatSearchRange16(u16 min, u16 max)	{ CheatSearchValue(2, CS_CUR, 0, min, max); }
+void CheatSearchRange32(u32 min, u32 max)	{ CheatSearchValue(4, CS_CUR, 0, min, max); }
+void CheatSearchIncreasedBy8(u8 val)	{ CheatSearchValue(1, CS_INC_BY, 0, val, val); }
+void CheatSearchIncreasedBy16(u16 val)	{ CheatSearchValue(2, CS_INC_BY, 0, val, val); }
+void CheatSearchIncreasedBy32(u32 val)	{ CheatSearchValue(4, CS_INC_BY, 0, val, val); }
+void CheatSearchDecreasedBy8(u8 val)	{ CheatSearchValue(1, CS_DEC_BY, 0, val, val); }
+void CheatSearchDecreasedBy16(u16 val)	{ CheatSearchValue(2, CS_DEC_BY, 0, val, val); }
+void CheatSearchDecreasedBy32(u32 val)	{ CheatSearchValue(4, CS_DEC_BY, 0, val, val); }
+void CheatSearchIncreased8()	{ CheatSearchValue(1, CS_INC, 0, 0, 0); }
+void CheatSearchIncreased16()	{ CheatSearchValue(2, CS_INC, 0, 0, 0); }
+void CheatSearchIncreased32()	{ CheatSearchValue(4, CS_INC, 0, 0, 0); }
+void CheatSearchDecreased8()	{ CheatSearchValue(1, CS_DEC, 0, 0, 0); }
+void CheatSearchDecreased16()	{ CheatSearchValue(2, CS_DEC, 0, 0, 0); }
+void CheatSearchDecreased32()	{ CheatSearchValue(4, CS_DEC, 0, 0, 0); }
+void CheatSearchDifferent8()	{ CheatSearchValue(1, CS_INC_BY, 1, 0, 0); }
+void CheatSearchDifferent16()	{ CheatSearchValue(2, CS_INC_BY, 1, 0, 0); }
+void CheatSearchDifferent32()	{ CheatSearchValue(4, CS_INC_BY, 1, 0, 0); }
+void CheatSearchNoChange8()		{ CheatSearchValue(1, CS_INC_BY, 0, 0, 0); }
+void CheatSearchNoChange16()	{ CheatSearchValue(2, CS_INC_BY, 0, 0, 0); }
+void CheatSearchNoChange32()	{ CheatSearchValue(4, CS_INC_BY, 0, 0, 0); }
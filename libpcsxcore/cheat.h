@@ -51,6 +51,7 @@ int EditCheat(int index, const char *descr, char *code);
 void FreeCheatSearchResults();
 void FreeCheatSearchMem();
 void CheatSearchBackupMemory();
+u32 CheatSearchNextResult(u32 addr); // 0x200000 when none left
 
 void CheatSearchEqual8(u8 val);
 void CheatSearchEqual16(u16 val);
@@ -86,7 +87,6 @@ extern int NumCheats;
 extern int NumCodes;
 
 extern s8 *prevM;
-extern u32 *SearchResults;
 extern int NumSearchResults;
 
 extern int NumCheatsAllocated;
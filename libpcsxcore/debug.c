@@ -19,6 +19,7 @@
 #include "r3000a.h"
 #include "debug.h"
 #include "socket.h"
+#include "psxprof.h"
 
 // XXX: don't care but maybe fix it someday
 #if defined(__GNUC__) && __GNUC__ >= 7
@@ -106,6 +107,13 @@ Basic commands (1xx):
     Breaks on map write32 flow, or stop it if number = 0
 170
     Dumps the execution flow map in an IDC file
+180 [interval]
+    Starts/reset the sampling profiler, sampling every interval us (decimal),
+    or stop it if interval = 0
+181 [number]
+    Gets the number (decimal, 32 by default) most sampled PCs.
+182 [file]
+    Writes the profile in pprof format, to psx.prof by default.
 
 Execution flow control commands (3xx):
 -------------------------------------
@@ -194,6 +202,12 @@ Basic commands acknowledge (2xx):
     Acknolwedge of 16x commands.
 270
     Acknolwedge of 170 command.
+280
+    Acknolwedge of 180 command.
+281 <count>@<PC>
+    Displays one sampled PC, after a "281 <samples>" line with the total.
+282 <message>
+    Profile written.
 
 Execution flow control commands acknowledge (4xx):
 -------------------------------------------------
@@ -228,6 +242,8 @@ Error messages (5xx):
     Non existant breakpoint.
 531, 532, 533 <message>
     Invalid breakpoint address.
+580 <message>
+    Profiler not available or failed.
 */
 
 static int debugger_active = 0, paused = 0, trace = 0, reset = 0, resetting = 0;
@@ -907,6 +923,47 @@ static void ProcessCommands() {
             fclose(sfile);
             sprintf(reply, "270 flow.idc and markcode.idc dumped\r\n");
             break;
+        case 0x180:
+            value = 0;
+            if (arguments) {
+                value = strtol(arguments, 0, 10);
+                if (value == 0) {
+                    psxProfStop();
+                    sprintf(reply, "280 Profiler stopped\r\n");
+                    break;
+                }
+            }
+            if (psxProfStart(value) < 0) {
+                sprintf(reply, "580 Profiler not available\r\n");
+                break;
+            }
+            sprintf(reply, "280 Profiler started\r\n");
+            break;
+        case 0x181: {
+            struct psx_prof_entry top[256];
+            unsigned int total = 0;
+            int n = 32;
+            if (arguments)
+                n = strtol(arguments, 0, 10);
+            if (n <= 0 || n > 256)
+                n = 256;
+            n = psxProfTop(top, n, &total);
+            if (n < 0) {
+                sprintf(reply, "580 No profile\r\n");
+                break;
+            }
+            p = reply + sprintf(reply, "281 %u\r\n", total);
+            for (i = 0; i < n; i++)
+                p += sprintf(p, "281 %u@%08X\r\n", top[i].count, top[i].pc);
+            break;
+        }
+        case 0x182:
+            if (psxProfWrite(arguments ? arguments : "psx.prof") < 0) {
+                sprintf(reply, "580 Failed to write the profile\r\n");
+                break;
+            }
+            sprintf(reply, "282 %s written\r\n", arguments ? arguments : "psx.prof");
+            break;
         case 0x300:
             p = arguments;
             if (arguments) {
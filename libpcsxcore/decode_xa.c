@@ -83,182 +83,99 @@ void ADPCM_InitDecode(ADPCM_Decode_t *decp) {
 #define IK1(fid)	(-K1[fid])
 #endif
 
-static __inline void ADPCM_DecodeBlock16( ADPCM_Decode_t *decp, u8 filter_range, const void *vblockp, short *destp, int inc ) {
+static int headtable[4] = {0,2,8,10};
+
+// The sample unpacking reads the sector directly and vectorizes, the filter
+// is a recurrence so only the independent left/right chains of stereo
+// sectors are interleaved for some ILP.
+
+// 4 bit: sample k of a block is a nibble (shift 12: low, 8: high) of p[k*4]
+static __inline void ADPCM_Expand4( s32 *x, const u8 *p, int shift, int range ) {
+	int i;
+	for (i = 0; i < BLKSIZ; i++)
+		x[i] = (s32)((short)((p[i * 4] << shift) & 0xf000) >> range) << SH;
+}
+
+// 8 bit (level A): nibble pairs of p[k*8] and p[k*8+4], like the 4 bit path
+static __inline void ADPCM_Expand8( s32 *x, const u8 *p, int range ) {
 	int i;
-	int range, filterid;
-	s32 fy0, fy1;
-	const u16 *blockp;
-
-	blockp = (const unsigned short *)vblockp;
-	filterid = (filter_range >>  4) & 0x0f;
-	range    = (filter_range >>  0) & 0x0f;
-
-	fy0 = decp->y0;
-	fy1 = decp->y1;
-
-	for (i = BLKSIZ/4; i; --i) {
-		s32 y;
-		s32 x0, x1, x2, x3;
-
-		y = *blockp++;
-		x3 = (short)( y        & 0xf000) >> range; x3 <<= SH;
-		x2 = (short)((y <<  4) & 0xf000) >> range; x2 <<= SH;
-		x1 = (short)((y <<  8) & 0xf000) >> range; x1 <<= SH;
-		x0 = (short)((y << 12) & 0xf000) >> range; x0 <<= SH;
-
-		x0 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x0;
-		x1 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x1;
-		x2 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x2;
-		x3 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x3;
-
-		XACLAMP( x0, (int)(-32768u<<SH), 32767<<SH ); *destp = x0 >> SH; destp += inc;
-		XACLAMP( x1, (int)(-32768u<<SH), 32767<<SH ); *destp = x1 >> SH; destp += inc;
-		XACLAMP( x2, (int)(-32768u<<SH), 32767<<SH ); *destp = x2 >> SH; destp += inc;
-		XACLAMP( x3, (int)(-32768u<<SH), 32767<<SH ); *destp = x3 >> SH; destp += inc;
+	for (i = 0; i < BLKSIZ; i += 4, p += 8) {
+		x[i+0] = (s32)((short)((p[0] << 12) & 0xf000) >> range) << SH;
+		x[i+1] = (s32)((short)((p[0] <<  8) & 0xf000) >> range) << SH;
+		x[i+2] = (s32)((short)((p[4] << 12) & 0xf000) >> range) << SH;
+		x[i+3] = (s32)((short)((p[4] <<  8) & 0xf000) >> range) << SH;
+	}
+}
+
+static __inline void ADPCM_Expand( s32 *x, const u8 *p, int level_a, int high, u8 filter_range ) {
+	if (level_a)
+		ADPCM_Expand8( x, p, filter_range & 0x0f );
+	else
+		ADPCM_Expand4( x, p, high ? 8 : 12, filter_range & 0x0f );
+}
+
+static __inline void ADPCM_Filter( ADPCM_Decode_t *decp, u8 filter_range, const s32 *x, short *destp ) {
+	int filterid = (filter_range >> 4) & 0x0f;
+	s32 fy0 = decp->y0, fy1 = decp->y1;
+	s32 k0 = IK0(filterid), k1 = IK1(filterid);
+	int i;
+
+	for (i = 0; i < BLKSIZ; i++) {
+		s32 x0 = x[i];
+		x0 -= (k0 * fy0 + k1 * fy1) >> SHC; fy1 = fy0; fy0 = x0;
+		XACLAMP( x0, (int)(-32768u<<SH), 32767<<SH ); destp[i] = x0 >> SH;
 	}
 	decp->y0 = fy0;
 	decp->y1 = fy1;
 }
 
-static int headtable[4] = {0,2,8,10};
+static __inline void ADPCM_FilterStereo( xa_decode_t *xdp, u8 frl, u8 frr,
+	const s32 *xl, const s32 *xr, short *destp ) {
+	int fl = (frl >> 4) & 0x0f, fr = (frr >> 4) & 0x0f;
+	s32 ly0 = xdp->left.y0, ly1 = xdp->left.y1;
+	s32 ry0 = xdp->right.y0, ry1 = xdp->right.y1;
+	s32 lk0 = IK0(fl), lk1 = IK1(fl), rk0 = IK0(fr), rk1 = IK1(fr);
+	int i;
+
+	for (i = 0; i < BLKSIZ; i++) {
+		s32 l = xl[i], r = xr[i];
+		l -= (lk0 * ly0 + lk1 * ly1) >> SHC; ly1 = ly0; ly0 = l;
+		r -= (rk0 * ry0 + rk1 * ry1) >> SHC; ry1 = ry0; ry0 = r;
+		XACLAMP( l, (int)(-32768u<<SH), 32767<<SH ); destp[i*2+0] = l >> SH;
+		XACLAMP( r, (int)(-32768u<<SH), 32767<<SH ); destp[i*2+1] = r >> SH;
+	}
+	xdp->left.y0 = ly0;  xdp->left.y1 = ly1;
+	xdp->right.y0 = ry0; xdp->right.y1 = ry1;
+}
 
 //===========================================
+// 18 sound groups of 16 header and 112 data bytes. Level B/C has 8 blocks
+// per group in the nibbles, stereo is low nibbles left, high nibbles right.
+// Level A is decoded as 4 blocks of nibble pairs, as it always was here.
 static void xa_decode_data( xa_decode_t *xdp, const unsigned char *srcp ) {
-	const u8    *sound_groupsp;
-	const u8    *sound_datap, *sound_datap2;
-	int         i, j, k, nbits;
-	u16			data[4096], *datap;
-	short		*destp;
-
-	destp = xdp->pcm;
-	nbits = xdp->nbits == 4 ? 4 : 2;
-
-	if (xdp->stereo) { // stereo
-		if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-			for (j=0; j < 18; j++) {
-				sound_groupsp = srcp + j * 128;		// sound groups header
-				sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-				for (i=0; i < nbits; i++) {
-    				datap = data;
-    				sound_datap2 = sound_datap + i;
-
-					for (k=0; k < 14; k++, sound_datap2 += 8) {
-        	   				*(datap++) = (u16)sound_datap2[0] |
-        	               			     (u16)(sound_datap2[4] << 8);
-					}
-
-    				ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-        	           				    destp+0, 2 );
-
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-            	          			     (u16)(sound_datap2[4] << 8);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-
-	        		destp += 28*2;
-				}
-    		}
-		} else { // level B/C
-			for (j=0; j < 18; j++) {
-				sound_groupsp = srcp + j * 128;		// sound groups header
-				sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-				for (i=0; i < nbits; i++) {
-	    			datap = data;
-	    			sound_datap2 = sound_datap + i;
-
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                       				    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((u16)(sound_datap2[12] & 0x0f) << 12);
-					}
-	    			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                   				    destp+0, 2 );
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                       	    			((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                       				    ((u16)(sound_datap2[12] >> 4) << 12);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-
-	        		destp += 28*2;
-				}
-	    	}
-		}
-	} else { // mono
-		if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-			for (j=0; j < 18; j++) {
-    			sound_groupsp = srcp + j * 128;		// sound groups header
-    			sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-    			for (i=0; i < nbits; i++) {
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-                       				     (u16)(sound_datap2[4] << 8);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (u16)sound_datap2[0] |
-                       				     (u16)(sound_datap2[4] << 8);
-					}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
-
-					destp += 28;
-				}
-	    	}
-		} else { // level B/C
-			for (j=0; j < 18; j++) {
-	    		sound_groupsp = srcp + j * 128;		// sound groups header
-	    		sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-	    		for (i=0; i < nbits; i++) {
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                       				    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((u16)(sound_datap2[12] & 0x0f) << 12);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-            				*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                       	    		    ((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                        				((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                        				((u16)(sound_datap2[12] >> 4) << 12);
-        			}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
-
-					destp += 28;
-				}
-    		}
+	int level_a = xdp->nbits == 8 && xdp->freq == 37800;
+	int nbits = xdp->nbits == 4 ? 4 : 2;
+	short *destp = xdp->pcm;
+	s32 x0[BLKSIZ], x1[BLKSIZ];
+	int i, j;
+
+	for (j = 0; j < 18; j++) {
+		const u8 *sound_groupsp = srcp + j * 128;	// sound groups header
+		const u8 *sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+		for (i = 0; i < nbits; i++) {
+			u8 fr0 = sound_groupsp[headtable[i]+0];
+			u8 fr1 = sound_groupsp[headtable[i]+1];
+
+			ADPCM_Expand( x0, sound_datap + i, level_a, 0, fr0 );
+			ADPCM_Expand( x1, sound_datap + i, level_a, 1, fr1 );
+			if (xdp->stereo)
+				ADPCM_FilterStereo( xdp, fr0, fr1, x0, x1, destp );
+			else {
+				ADPCM_Filter( &xdp->left, fr0, x0, destp );
+				ADPCM_Filter( &xdp->left, fr1, x1, destp + 28 );
+			}
+			destp += 28*2;
 		}
 	}
 }
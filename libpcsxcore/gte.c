@@ -274,6 +274,53 @@ INLINE u32 DIVIDE(u16 n, u16 d) {
 #include "gte_divider.h"
 #endif // GTE_USE_NATIVE_DIVIDE
 
+// NCCT does 3 vertices at once, one per vector lane
+#if (defined(__aarch64__) || defined(__SSE4_1__)) && \
+    (__GNUC__ >= 5 || defined(__clang__)) && !defined(GTE_NO_SIMD)
+#define GTE_SIMD
+#endif
+
+#ifdef GTE_SIMD
+
+typedef s32 gtev4s32 __attribute__((vector_size(16)));
+typedef u32 gtev4u32 __attribute__((vector_size(16)));
+
+#define V4(x) ((gtev4s32){ (x), (x), (x), (x) })
+
+/*
+ * All is done in 32bit lanes, the 64bit sums of the scalar code are split
+ * into parts that can't overflow. Only lanes 0-2 are meaningful, lane 3
+ * must not contribute flags.
+ */
+
+// (p1 + p2 + p3) >> 12 without overflow in the sum
+static inline gtev4s32 sum12_v(gtev4s32 p1, gtev4s32 p2, gtev4s32 p3) {
+	return (p1 >> 12) + (p2 >> 12) + (p3 >> 12) +
+		(((p1 & 0xfff) + (p2 & 0xfff) + (p3 & 0xfff)) >> 12);
+}
+
+// ((s64)a << 12) + p1 + p2 + p3) >> 12 like A1-A3, truncated to 32 bits
+static inline gtev4s32 sumA_v(gtev4s32 *fl, s32 a, gtev4s32 p1,
+	gtev4s32 p2, gtev4s32 p3, u32 flag_max, u32 flag_min) {
+	gtev4s32 x = sum12_v(p1, p2, p3);
+	gtev4s32 r = (gtev4s32)((gtev4u32)x + (gtev4u32)V4(a));
+#ifndef FLAGLESS
+	gtev4s32 ovf = (~(x ^ V4(a)) & (r ^ V4(a))) >> 31;
+	*fl |= ovf & V4(a < 0 ? (s32)flag_min : (s32)flag_max);
+#endif
+	return r;
+}
+
+static inline gtev4s32 lim_v(gtev4s32 *fl, gtev4s32 v, s32 max, s32 min, u32 flag) {
+	gtev4s32 hi = v > V4(max), lo = v < V4(min);
+#ifndef FLAGLESS
+	*fl |= (hi | lo) & V4((s32)flag);
+#endif
+	return (v & ~(hi | lo)) | (V4(max) & hi) | (V4(min) & lo);
+}
+
+#endif // GTE_SIMD
+
 #ifndef FLAGLESS
 
 const unsigned char gte_cycletab[64] = {
@@ -579,6 +626,57 @@ void gteNCCS(psxCP2Regs *regs) {
 	gteB2 = limC3(gteMAC3 >> 4);
 }
 
+#ifdef GTE_SIMD
+
+void gteNCCT(psxCP2Regs *regs) {
+	gtev4s32 vx = { VX(0), VX(1), VX(2), 0 };
+	gtev4s32 vy = { VY(0), VY(1), VY(2), 0 };
+	gtev4s32 vz = { VZ(0), VZ(1), VZ(2), 0 };
+	gtev4s32 fl = { 0, };
+	gtev4s32 mac1, mac2, mac3, ir1, ir2, ir3, r, g, b;
+	u32 code = (u32)gteCODE << 24;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCCT\n");
+#endif
+	gteFLAG = 0;
+
+	mac1 = sum12_v(V4(gteL11) * vx, V4(gteL12) * vy, V4(gteL13) * vz);
+	mac2 = sum12_v(V4(gteL21) * vx, V4(gteL22) * vy, V4(gteL23) * vz);
+	mac3 = sum12_v(V4(gteL31) * vx, V4(gteL32) * vy, V4(gteL33) * vz);
+	ir1 = lim_v(&fl, mac1, 0x7fff, 0, (1u << 31) | (1u << 24));
+	ir2 = lim_v(&fl, mac2, 0x7fff, 0, (1u << 31) | (1u << 23));
+	ir3 = lim_v(&fl, mac3, 0x7fff, 0, (1u << 22));
+	mac1 = sumA_v(&fl, gteRBK, V4(gteLR1) * ir1, V4(gteLR2) * ir2, V4(gteLR3) * ir3,
+		1u << 30, (1u << 31) | (1u << 27));
+	mac2 = sumA_v(&fl, gteGBK, V4(gteLG1) * ir1, V4(gteLG2) * ir2, V4(gteLG3) * ir3,
+		1u << 29, (1u << 31) | (1u << 26));
+	mac3 = sumA_v(&fl, gteBBK, V4(gteLB1) * ir1, V4(gteLB2) * ir2, V4(gteLB3) * ir3,
+		1u << 28, (1u << 31) | (1u << 25));
+	ir1 = lim_v(&fl, mac1, 0x7fff, 0, (1u << 31) | (1u << 24));
+	ir2 = lim_v(&fl, mac2, 0x7fff, 0, (1u << 31) | (1u << 23));
+	ir3 = lim_v(&fl, mac3, 0x7fff, 0, (1u << 22));
+	mac1 = (V4(gteR) * ir1) >> 8;
+	mac2 = (V4(gteG) * ir2) >> 8;
+	mac3 = (V4(gteB) * ir3) >> 8;
+	r = lim_v(&fl, mac1 >> 4, 0xff, 0, (1u << 21));
+	g = lim_v(&fl, mac2 >> 4, 0xff, 0, (1u << 20));
+	b = lim_v(&fl, mac3 >> 4, 0xff, 0, (1u << 19));
+	gteFLAG |= fl[0] | fl[1] | fl[2];
+
+	gteRGB0 = r[0] | (g[0] << 8) | (b[0] << 16) | code;
+	gteRGB1 = r[1] | (g[1] << 8) | (b[1] << 16) | code;
+	gteRGB2 = r[2] | (g[2] << 8) | (b[2] << 16) | code;
+	gteMAC1 = mac1[2];
+	gteMAC2 = mac2[2];
+	gteMAC3 = mac3[2];
+	gteIR1 = mac1[2];
+	gteIR2 = mac2[2];
+	gteIR3 = mac3[2];
+}
+
+#else
+
 void gteNCCT(psxCP2Regs *regs) {
 	int v;
 	s32 vx, vy, vz;
@@ -620,6 +718,8 @@ void gteNCCT(psxCP2Regs *regs) {
 	gteIR3 = gteMAC3;
 }
 
+#endif // GTE_SIMD
+
 void gteNCDS(psxCP2Regs *regs) {
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCDS\n");
@@ -21,6 +21,7 @@
 #include "../psxinterpreter.h"
 #include "../psxhle.h"
 #include "../psxevents.h"
+#include "../../include/compiler_features.h"
 
 #include "../frontend/main.h"
 
@@ -65,7 +66,7 @@
 #  define GPUSTATUS_POLLING_THRESHOLD 0
 #endif
 
-psxRegisters psxRegs;
+psxRegisters psxRegs attr_aligned(64);
 Rcnt rcnts[4];
 
 void* code_buffer;
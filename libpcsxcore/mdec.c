@@ -87,6 +87,178 @@ static inline void fillrow(int *blk, int val) {
 		= blk[4] = blk[5] = blk[6] = blk[7] = val;
 }
 
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__SSE2__)) \
+    && (defined(__GNUC__) || defined(__clang__)) \
+    && __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ && !defined(NO_MDEC_SIMD)
+#define MDEC_SIMD
+
+/* 
+ * Same math as the C code above (which stays as the reference), done for
+ * 4 columns at a time, so the results are bit-exact. There is no point
+ * skipping the empty columns here, the whole 8x8 block is just 4 vectors
+ * wide per pass, with a transpose in between and after.
+ */
+typedef int32_t gvs32  __attribute__((vector_size(16),aligned(16)));
+typedef int32_t gvs32u __attribute__((vector_size(16),aligned(4)));
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+static inline void gtranspose4(gvs32 *v)
+{
+	int32x4x2_t t0 = vtrnq_s32((int32x4_t)v[0], (int32x4_t)v[1]);
+	int32x4x2_t t1 = vtrnq_s32((int32x4_t)v[2], (int32x4_t)v[3]);
+	v[0] = (gvs32)vcombine_s32(vget_low_s32(t0.val[0]), vget_low_s32(t1.val[0]));
+	v[1] = (gvs32)vcombine_s32(vget_low_s32(t0.val[1]), vget_low_s32(t1.val[1]));
+	v[2] = (gvs32)vcombine_s32(vget_high_s32(t0.val[0]), vget_high_s32(t1.val[0]));
+	v[3] = (gvs32)vcombine_s32(vget_high_s32(t0.val[1]), vget_high_s32(t1.val[1]));
+}
+
+// [a0 a1 a2 a3] -> [a0 a0 a1 a1], [a2 a2 a3 a3]
+static inline void gdup2(gvs32 *lo, gvs32 *hi, gvs32 a)
+{
+	int32x4x2_t t = vzipq_s32((int32x4_t)a, (int32x4_t)a);
+	*lo = (gvs32)t.val[0];
+	*hi = (gvs32)t.val[1];
+}
+
+// 0..0xffff values of 8 pixels
+static inline void gstore16(void *d, gvs32 lo, gvs32 hi)
+{
+	vst1q_u16(d, vcombine_u16(vmovn_u32((uint32x4_t)lo),
+		vmovn_u32((uint32x4_t)hi)));
+}
+
+// 0..255 values of 8 pixels as RGB888
+static inline void gstore24(u8 *d, const gvs32 *r, const gvs32 *g, const gvs32 *b)
+{
+	uint8x8x3_t v;
+	v.val[0] = vmovn_u16(vcombine_u16(vmovn_u32((uint32x4_t)r[0]), vmovn_u32((uint32x4_t)r[1])));
+	v.val[1] = vmovn_u16(vcombine_u16(vmovn_u32((uint32x4_t)g[0]), vmovn_u32((uint32x4_t)g[1])));
+	v.val[2] = vmovn_u16(vcombine_u16(vmovn_u32((uint32x4_t)b[0]), vmovn_u32((uint32x4_t)b[1])));
+	vst3_u8(d, v);
+}
+#else
+#include <emmintrin.h>
+
+static inline void gtranspose4(gvs32 *v)
+{
+	__m128i t0 = _mm_unpacklo_epi32((__m128i)v[0], (__m128i)v[1]);
+	__m128i t1 = _mm_unpacklo_epi32((__m128i)v[2], (__m128i)v[3]);
+	__m128i t2 = _mm_unpackhi_epi32((__m128i)v[0], (__m128i)v[1]);
+	__m128i t3 = _mm_unpackhi_epi32((__m128i)v[2], (__m128i)v[3]);
+	v[0] = (gvs32)_mm_unpacklo_epi64(t0, t1);
+	v[1] = (gvs32)_mm_unpackhi_epi64(t0, t1);
+	v[2] = (gvs32)_mm_unpacklo_epi64(t2, t3);
+	v[3] = (gvs32)_mm_unpackhi_epi64(t2, t3);
+}
+
+static inline void gdup2(gvs32 *lo, gvs32 *hi, gvs32 a)
+{
+	*lo = (gvs32)_mm_unpacklo_epi32((__m128i)a, (__m128i)a);
+	*hi = (gvs32)_mm_unpackhi_epi32((__m128i)a, (__m128i)a);
+}
+
+static inline void gstore16(void *d, gvs32 lo, gvs32 hi)
+{
+	// no unsigned pack in SSE2, so bias to signed and back
+	__m128i v = _mm_packs_epi32((__m128i)(lo - 0x8000), (__m128i)(hi - 0x8000));
+	_mm_storeu_si128(d, _mm_xor_si128(v, _mm_set1_epi16(-0x8000)));
+}
+
+static inline void gstore24(u8 *d, const gvs32 *r, const gvs32 *g, const gvs32 *b)
+{
+	int i;
+	for (i = 0; i < 8; i++, d += 3) {
+		d[0] = r[i >> 2][i & 3];
+		d[1] = g[i >> 2][i & 3];
+		d[2] = b[i >> 2][i & 3];
+	}
+}
+#endif
+
+static inline gvs32 gclamp(gvs32 v, int hi)
+{
+	gvs32 m = v > 0;
+	v &= m;
+	m = v > hi;
+	return (v & ~m) | (m & hi);
+}
+
+// one 1D pass over 4 columns, x[i] holds row i
+static inline void idct_pass_simd(gvs32 *x)
+{
+	gvs32 tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+	gvs32 z5, z10, z11, z12, z13;
+
+	z10 = x[0] + x[4];
+	z11 = x[0] - x[4];
+	z13 = x[2] + x[6];
+	z12 = MULS(x[2] - x[6], FIX_1_414213562) - z13;
+
+	tmp0 = z10 + z13;
+	tmp3 = z10 - z13;
+	tmp1 = z11 + z12;
+	tmp2 = z11 - z12;
+
+	z13 = x[3] + x[5];
+	z10 = x[3] - x[5];
+	z11 = x[1] + x[7];
+	z12 = x[1] - x[7];
+
+	tmp7 = z11 + z13;
+	z5 = (z12 - z10) * FIX_1_847759065;
+	tmp6 = SCALE(z10 * FIX_2_613125930 + z5, AAN_CONST_BITS) - tmp7;
+	tmp5 = MULS(z11 - z13, FIX_1_414213562) - tmp6;
+	tmp4 = SCALE(z12 * FIX_1_082392200 - z5, AAN_CONST_BITS) + tmp5;
+
+	x[0] = tmp0 + tmp7;
+	x[7] = tmp0 - tmp7;
+	x[1] = tmp1 + tmp6;
+	x[6] = tmp1 - tmp6;
+	x[2] = tmp2 + tmp5;
+	x[5] = tmp2 - tmp5;
+	x[4] = tmp3 + tmp4;
+	x[3] = tmp3 - tmp4;
+}
+
+// lo/hi are the left/right halves of the rows
+static inline void transpose8_simd(gvs32 *lo, gvs32 *hi)
+{
+	gvs32 t;
+	int i;
+
+	gtranspose4(lo);
+	gtranspose4(lo + 4);
+	gtranspose4(hi);
+	gtranspose4(hi + 4);
+	for (i = 0; i < 4; i++) {
+		t = lo[4 + i]; lo[4 + i] = hi[i]; hi[i] = t;
+	}
+}
+
+static void idct_simd(int *block)
+{
+	gvs32 lo[8], hi[8];
+	int i;
+
+	for (i = 0; i < DSIZE; i++) {
+		lo[i] = *(gvs32u *)(block + DSIZE * i);
+		hi[i] = *(gvs32u *)(block + DSIZE * i + 4);
+	}
+	idct_pass_simd(lo);
+	idct_pass_simd(hi);
+	transpose8_simd(lo, hi);
+	idct_pass_simd(lo);
+	idct_pass_simd(hi);
+	transpose8_simd(lo, hi);
+	for (i = 0; i < DSIZE; i++) {
+		*(gvs32u *)(block + DSIZE * i) = lo[i];
+		*(gvs32u *)(block + DSIZE * i + 4) = hi[i];
+	}
+}
+#endif // MDEC_SIMD
+
 static void idct(int *block,int used_col) {
 	int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
 	int z5, z10, z11, z12, z13;
@@ -99,6 +271,10 @@ static void idct(int *block,int used_col) {
 		for (i = 0; i < DSIZE2; i++) block[i] = v;
 		return;
 	}
+#ifdef MDEC_SIMD
+	idct_simd(block);
+	return;
+#endif
 
 	// last_col keeps track of the highest column with non zero coefficients
 	ptr = block;
@@ -371,12 +547,77 @@ static inline void putquadrgb15(u16 *image, int *Yblk, int Cr, int Cb) {
 	image[17] = MAKERGB15(CLAMP_SCALE5(Y + R), CLAMP_SCALE5(Y + G), CLAMP_SCALE5(Y + B), A);
 }
 
+#ifdef MDEC_SIMD
+// 2 rows of 8 pixels sharing a chroma row to o[row][r/g/b][half],
+// with each channel clamped to 0..(1 << bits) - 1
+static inline void yuv_rows_simd(gvs32 o[2][3][2], const int *Yblk,
+	const int *Crblk, const int *Cbblk, const int bits)
+{
+	gvs32 cr = *(gvs32u *)Crblk, cb = *(gvs32u *)Cbblk;
+	gvs32 c[3][2], y;
+	int i, j, k;
+
+	gdup2(&c[0][0], &c[0][1], MULR(cr));
+	gdup2(&c[1][0], &c[1][1], MULG2(cb, cr));
+	gdup2(&c[2][0], &c[2][1], MULB(cb));
+	for (j = 0; j < 2; j++) {
+		for (k = 0; k < 2; k++) {
+			y = MULY(*(gvs32u *)(Yblk + j * 8 + k * 4));
+			for (i = 0; i < 3; i++)
+				o[j][i][k] = gclamp(SCALER(y + c[i][k], 28 - bits)
+					+ (1 << (bits - 1)), (1 << bits) - 1);
+		}
+	}
+}
+
+static void yuv2rgb15_simd(int *blk, u16 *image)
+{
+	int A = (mdec.reg0 & MDEC0_STP) ? 0x8000 : 0;
+	gvs32 o[2][3][2], p[2][2];
+	int j, k, x, y;
+
+	for (y = 0; y < 16; y += 2) {
+		for (x = 0; x < 2; x++) {
+			yuv_rows_simd(o, blk + DSIZE2 * (2 + x + (y & 8) / 4) + (y & 7) * 8,
+				blk + y * 4 + x * 4, blk + DSIZE2 + y * 4 + x * 4, 5);
+			for (j = 0; j < 2; j++)
+				for (k = 0; k < 2; k++)
+					p[j][k] = (o[j][2][k] << 10) | (o[j][1][k] << 5)
+						| o[j][0][k] | A;
+			gstore16(image + y * 16 + x * 8, p[0][0], p[0][1]);
+			gstore16(image + y * 16 + 16 + x * 8, p[1][0], p[1][1]);
+		}
+	}
+}
+
+static void yuv2rgb24_simd(int *blk, u8 *image)
+{
+	gvs32 o[2][3][2];
+	int x, y;
+
+	for (y = 0; y < 16; y += 2) {
+		for (x = 0; x < 2; x++) {
+			yuv_rows_simd(o, blk + DSIZE2 * (2 + x + (y & 8) / 4) + (y & 7) * 8,
+				blk + y * 4 + x * 4, blk + DSIZE2 + y * 4 + x * 4, 8);
+			gstore24(image + (y * 16 + x * 8) * 3, o[0][0], o[0][1], o[0][2]);
+			gstore24(image + (y * 16 + 16 + x * 8) * 3, o[1][0], o[1][1], o[1][2]);
+		}
+	}
+}
+#endif // MDEC_SIMD
+
 static inline void yuv2rgb15(int *blk, unsigned short *image) {
 	int x, y;
 	int *Yblk = blk + DSIZE2 * 2;
 	int *Crblk = blk;
 	int *Cbblk = blk + DSIZE2;
 
+#ifdef MDEC_SIMD
+	if (!Config.Mdec) {
+		yuv2rgb15_simd(blk, image);
+		return;
+	}
+#endif
 	if (!Config.Mdec) {
 		for (y = 0; y < 16; y += 2, Crblk += 4, Cbblk += 4, Yblk += 8, image += 24) {
 			if (y == 8) Yblk += DSIZE2;
@@ -436,6 +677,12 @@ static void yuv2rgb24(int *blk, u8 *image) {
 	int *Crblk = blk;
 	int *Cbblk = blk + DSIZE2;
 
+#ifdef MDEC_SIMD
+	if (!Config.Mdec) {
+		yuv2rgb24_simd(blk, image);
+		return;
+	}
+#endif
 	if (!Config.Mdec) {
 		for (y = 0; y < 16; y += 2, Crblk += 4, Cbblk += 4, Yblk += 8, image += 8 * 3 * 3) {
 			if (y == 8) Yblk += DSIZE2;
@@ -484,6 +731,37 @@ u32 mdecRead1(void) {
 	return v;
 }
 
+#ifdef MDEC_TRACE
+/*
+ * PCSX_MDEC_TRACE=file records the decode and quant table uploads for
+ * tools/mdecbench: "MDCT", version, then per dma0 the command word, the
+ * length in words and the data, host endian.
+ */
+#include <stdio.h>
+
+static void mdec_trace(u32 cmd, const void *data, u32 words) {
+	static FILE *f;
+	static int state;
+	u32 hdr[2] = { 0x5443444d, 1 };
+	const char *path;
+
+	if (state == 0) {
+		state = -1;
+		path = getenv("PCSX_MDEC_TRACE");
+		if (path == NULL || (f = fopen(path, "wb")) == NULL)
+			return;
+		fwrite(hdr, 1, sizeof(hdr), f);
+		state = 1;
+	}
+	if (state < 0)
+		return;
+	fwrite(&cmd, 1, sizeof(cmd), f);
+	fwrite(&words, 1, sizeof(words), f);
+	fwrite(data, 1, words * 4, f);
+	fflush(f);
+}
+#endif
+
 void psxDma0(u32 adr, u32 bcr, u32 chcr) {
 	u32 cmd = mdec.reg0, words_max = 0;
 	const void *mem;
@@ -506,6 +784,10 @@ void psxDma0(u32 adr, u32 bcr, u32 chcr) {
 		HW_DMA0_CHCR &= SWAP32(~0x01000000);
 		return;
 	}
+#ifdef MDEC_TRACE
+	if ((cmd >> 28) == 3 || (cmd >> 28) == 4)
+		mdec_trace(cmd, mem, size);
+#endif
 
 	switch (cmd >> 28) {
 		case 0x3: // decode 15/24bpp
@@ -562,11 +844,101 @@ void mdec0Interrupt()
 #define SIZE_OF_24B_BLOCK (16*16*3)
 #define SIZE_OF_16B_BLOCK (16*16*2)
 
+#ifdef USE_ASYNC_MDEC
+/*
+ * Macroblocks don't depend on each other, so once their starts are known
+ * (a cheap walk over the rl codes) the idct and colour conversion of a
+ * DMA's worth of them can be split between threads, each writing its own
+ * blocks straight to the destination. The emu thread takes a share too
+ * and waits for the rest before returning.
+ */
+#include "../frontend/pcsxr-threads.h"
+
+#define MDEC_THREADS_MAX 4
+#define MDEC_JOB_MAX 128 // macroblocks per job
+
+// split over the shared job workers, see pcsxr_jobs_run()
+static struct {
+	const u16 *rl[MDEC_JOB_MAX];
+	u8 *image;
+	int blocks;
+	int rgb24;
+	int count;
+} mdw;
+
+// same walk as rl2blk(), without the decoding
+static const u16 *rl_skip(const u16 *mdec_rl) {
+	int i, k, rl;
+
+	for (i = 0; i < 6; i++) {
+		mdec_rl++;
+		for (k = 0;;) {
+			rl = SWAP16(*mdec_rl); mdec_rl++;
+			if (rl == MDEC_END_OF_DATA) break;
+			k += RLE_RUN(rl) + 1;
+			if (k > 63) break;
+		}
+	}
+	return mdec_rl;
+}
+
+static void mdw_decode(void *unused, int i) {
+	int blk[DSIZE2 * 6];
+
+	for (; i < mdw.blocks; i += mdw.count) {
+		rl2blk(blk, mdw.rl[i]);
+		if (mdw.rgb24)
+			yuv2rgb24(blk, mdw.image + i * SIZE_OF_24B_BLOCK);
+		else
+			yuv2rgb15(blk, (u16 *)(mdw.image + i * SIZE_OF_16B_BLOCK));
+	}
+}
+
+// decodes the whole macroblocks it can, returns how many
+static int mdec_decode_parallel(u8 *image, int blocks, int rgb24) {
+	int bsize = rgb24 ? SIZE_OF_24B_BLOCK : SIZE_OF_16B_BLOCK;
+	const u16 *rl = mdec.rl;
+	int done, i, n;
+
+	mdw.count = Config.MdecThreads;
+	if (mdw.count > MDEC_THREADS_MAX)
+		mdw.count = MDEC_THREADS_MAX;
+	if (mdw.count > pcsxr_jobs_parallelism())
+		mdw.count = pcsxr_jobs_parallelism();
+	if (mdw.count < 2)
+		return 0;
+
+	for (done = 0; blocks - done >= 2; done += n) {
+		n = blocks - done;
+		if (n > MDEC_JOB_MAX)
+			n = MDEC_JOB_MAX;
+		for (i = 0; i < n; i++) {
+			mdw.rl[i] = rl;
+			rl = rl_skip(rl);
+		}
+		mdw.image = image + done * bsize;
+		mdw.blocks = n;
+		mdw.rgb24 = rgb24;
+
+		pcsxr_jobs_run(mdw_decode, NULL, mdw.count, PCSXRT_MDEC);
+		mdec.rl = rl;
+	}
+	return done;
+}
+#endif // USE_ASYNC_MDEC
+
+void mdecShutdown(void) {
+	// the job workers are shared, pcsxr_jobs_shutdown() is the frontend's
+}
+
 void psxDma1(u32 adr, u32 bcr, u32 chcr) {
 	u32 words, words_max = 0;
 	int blk[DSIZE2 * 6];
 	u8 * image;
 	int size;
+#ifdef USE_ASYNC_MDEC
+	int n;
+#endif
 
 	if (chcr != 0x01000200) {
 		log_unhandled("mdec1: invalid dma %08x\n", chcr);
@@ -609,6 +981,11 @@ void psxDma1(u32 adr, u32 bcr, u32 chcr) {
 			mdec.block_buffer_pos = 0;
 		}
 
+#ifdef USE_ASYNC_MDEC
+		n = mdec_decode_parallel(image, size / SIZE_OF_16B_BLOCK, 0);
+		image += n * SIZE_OF_16B_BLOCK;
+		size -= n * SIZE_OF_16B_BLOCK;
+#endif
 		while(size >= SIZE_OF_16B_BLOCK) {
 			mdec.rl = rl2blk(blk, mdec.rl);
 			yuv2rgb15(blk, (u16 *)image);
@@ -638,6 +1015,11 @@ void psxDma1(u32 adr, u32 bcr, u32 chcr) {
 			mdec.block_buffer_pos = 0;
 		}
 
+#ifdef USE_ASYNC_MDEC
+		n = mdec_decode_parallel(image, size / SIZE_OF_24B_BLOCK, 1);
+		image += n * SIZE_OF_24B_BLOCK;
+		size -= n * SIZE_OF_24B_BLOCK;
+#endif
 		while(size >= SIZE_OF_24B_BLOCK) {
 			mdec.rl = rl2blk(blk, mdec.rl);
 			yuv2rgb24(blk, image);
@@ -30,6 +30,7 @@ extern "C" {
 #include "psxdma.h"
 
 void mdecInit();
+void mdecShutdown(void);
 void mdecWrite0(u32 data);
 void mdecWrite1(u32 data);
 u32 mdecRead0();
@@ -26,9 +26,11 @@
 #include <ctype.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/stat.h>
 #include "misc.h"
 #include "cdrom.h"
 #include "cdrom-async.h"
+#include "cdriso.h"
 #include "mdec.h"
 #include "gpu.h"
 #include "ppf.h"
@@ -365,6 +367,122 @@ int LoadCdromFile(const char *filename, EXE_HEADER *head, u8 *time_bcd_out) {
 	return 0;
 }
 
+// CheckCdrom() results per image file, so that later boots don't need to
+// walk the filesystem. One line per image:
+// size mtime region id\texename\tlabel\tpath
+#define DISCINFO_FILE "discinfo.txt"
+#define DISCINFO_MAX_LINE (MAXPATHLEN + 256 + 64)
+
+static int discinfo_key(const char *iso, unsigned long long *size, long long *mtime)
+{
+	struct stat st;
+
+	// all discs of a multi-disc image share the file, so no key for them
+	if (Config.CacheDir[0] == '\0' || iso == NULL || iso[0] == '\0'
+	    || cdra_is_physical() || cdrIsoMultidiskCount > 1
+	    || strpbrk(iso, "\t\n") || stat(iso, &st) != 0)
+		return -1;
+	*size = st.st_size;
+	*mtime = st.st_mtime;
+	return 0;
+}
+
+static FILE *discinfo_open(const char *mode)
+{
+	char fname[MAXPATHLEN + sizeof(DISCINFO_FILE)];
+
+	snprintf(fname, sizeof(fname), "%s" DISCINFO_FILE, Config.CacheDir);
+	return fopen(fname, mode);
+}
+
+// splits "a\tb\tc" in place
+static char *discinfo_field(char **s)
+{
+	char *ret = *s, *p = ret ? strchr(ret, '\t') : NULL;
+
+	if (p)
+		*p++ = 0;
+	*s = p;
+	return ret;
+}
+
+static int discinfo_lookup(char *exename, int *region)
+{
+	char line[DISCINFO_MAX_LINE], *p, *id, *exe, *label;
+	const char *iso = GetIsoFile();
+	unsigned long long size, l_size;
+	long long mtime, l_mtime;
+	int ret = -1, l_region, n;
+	FILE *f;
+
+	if (discinfo_key(iso, &size, &mtime) || !(f = discinfo_open("r")))
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%llu %lld %d %n", &l_size, &l_mtime, &l_region, &n) < 3
+		    || l_size != size || l_mtime != mtime)
+			continue;
+		p = line + n;
+		id = discinfo_field(&p);
+		exe = discinfo_field(&p);
+		label = discinfo_field(&p);
+		if (p == NULL)
+			continue;
+		p[strcspn(p, "\r\n")] = 0;
+		if (strcmp(p, iso) != 0)
+			continue;
+		snprintf(CdromId, sizeof(CdromId), "%s", id);
+		snprintf(CdromLabel, sizeof(CdromLabel), "%s", label);
+		snprintf(exename, 256, "%s", exe);
+		*region = l_region;
+		ret = 0;
+		break;
+	}
+	fclose(f);
+	return ret;
+}
+
+static void discinfo_store(const char *exename, int region)
+{
+	char line[DISCINFO_MAX_LINE], *old = NULL, *p;
+	const char *iso = GetIsoFile();
+	unsigned long long size;
+	size_t len = 0, alloc = 0;
+	long long mtime;
+	FILE *f;
+
+	if (discinfo_key(iso, &size, &mtime)
+	    || strpbrk(exename, "\t\n") || strpbrk(CdromLabel, "\t\n"))
+		return;
+
+	// keep the other images' lines, drop any old one for this image
+	if ((f = discinfo_open("r"))) {
+		while (fgets(line, sizeof(line), f)) {
+			size_t l = strlen(line);
+			p = strrchr(line, '\t');
+			if (p && strcspn(p + 1, "\r\n") == strlen(iso)
+			    && !strncmp(p + 1, iso, strlen(iso)))
+				continue;
+			if (len + l + 1 > alloc) {
+				char *n = realloc(old, alloc = (alloc + l + 1) * 2);
+				if (n == NULL)
+					break;
+				old = n;
+			}
+			memcpy(old + len, line, l);
+			len += l;
+		}
+		fclose(f);
+	}
+	if ((f = discinfo_open("w"))) {
+		if (len)
+			fwrite(old, 1, len, f);
+		fprintf(f, "%llu %lld %d %s\t%s\t%s\t%s\n", size, mtime, region,
+			CdromId, exename, CdromLabel, iso);
+		fclose(f);
+	}
+	free(old);
+}
+
 int CheckCdrom() {
 	struct iso_directory_record *dir;
 	struct CdrStat stat = { 0, 0, };
@@ -386,15 +504,16 @@ int CheckCdrom() {
 		if ((stat.Status & 0x10) || stat.Type == 2 || cdra_readTrack(time))
 			return 0;
 	}
-	if (Config.PsxAuto) {
-		time[0] = 0;
-		time[1] = 2;
-		time[2] = 4;
-		READTRACK();
-		if (strcmp((char *)buf + 12 + 46, "Entertainment Euro pe   ") == 0)
-			lic_region_detected = PSX_TYPE_PAL;
-		// else it'll default to NTSC anyway
-	}
+	if (discinfo_lookup(exename, &lic_region_detected) == 0)
+		goto have_id;
+
+	time[0] = 0;
+	time[1] = 2;
+	time[2] = 4;
+	READTRACK();
+	if (strcmp((char *)buf + 12 + 46, "Entertainment Euro pe   ") == 0)
+		lic_region_detected = PSX_TYPE_PAL;
+	// else it'll default to NTSC anyway
 
 	time[0] = 0;
 	time[1] = 2;
@@ -460,6 +579,8 @@ int CheckCdrom() {
 	if (CdromId[0] == '\0')
 		strcpy(CdromId, "SLUS99999");
 
+	discinfo_store(exename, lic_region_detected);
+have_id:
 	if (Config.PsxAuto) { // autodetect system (pal or ntsc)
 		if (lic_region_detected >= 0)
 			Config.PsxType = lic_region_detected;
@@ -639,9 +760,30 @@ fail_io:
 
 // STATES
 
+// gzopen() mode for writing states, gzread() detects gzip vs uncompressed
+// on its own so old states load whatever the setting
+const char *StateWriteMode(void)
+{
+	switch (Config.StateCompression) {
+	case STATE_COMP_SMALL:
+		return "wb";
+	case STATE_COMP_NONE:
+		return "wbT";
+	default:
+		return "wb1";
+	}
+}
+
 static void *zlib_open(const char *name, const char *mode)
 {
-	return gzopen(name, mode);
+	gzFile f;
+
+	if (mode[0] == 'w')
+		mode = StateWriteMode();
+	f = gzopen(name, mode);
+	if (f != NULL)
+		gzbuffer(f, 64 * 1024);
+	return f;
 }
 
 static int zlib_read(void *file, void *buf, u32 len)
@@ -670,6 +812,27 @@ struct PcsxSaveFuncs SaveFuncs = {
 
 static const char PcsxHeader[32] = "STv4 PCSXra " REV;
 
+// GPU and SPU freeze buffers, kept around since rewind and run-ahead
+// serialize all the time, and a fresh 1MB+ malloc() is usually an mmap
+// that the kernel has to zero and fault in again on every call
+static void *state_scratch(int which, int size)
+{
+	static void *buf[2];
+	static int buf_size[2];
+
+	if (size <= 0)
+		return NULL;
+	if (size > buf_size[which]) {
+		free(buf[which]);
+		buf_size[which] = 0;
+		buf[which] = malloc(size);
+		if (buf[which] == NULL)
+			return NULL;
+		buf_size[which] = size;
+	}
+	return buf[which];
+}
+
 // Savestate Versioning!
 // If you make changes to the savestate version, please increment the value below.
 static const u32 SaveVersion = 0x8b410006;
@@ -702,6 +865,27 @@ struct misc_save_data {
 
 #define EX_SCREENPIC_SIZE (128 * 96 * 3)
 
+// only partial save of psxRegisters to maintain savestate compat,
+// in the order the fields had before the struct got split up by use
+static void psxRegsFreeze(void *f, int Mode)
+{
+	u32 unused = 0;
+
+	gzfreeze(&psxRegs.GPR, sizeof(psxRegs.GPR));
+	gzfreeze(&psxRegs.CP0, sizeof(psxRegs.CP0));
+	gzfreeze(&psxRegs.CP2, sizeof(psxRegs.CP2));
+	gzfreeze(&psxRegs.pc, sizeof(psxRegs.pc));
+	gzfreeze(&psxRegs.code, sizeof(psxRegs.code));
+	gzfreeze(&psxRegs.cycle, sizeof(psxRegs.cycle));
+	gzfreeze(&psxRegs.interrupt, sizeof(psxRegs.interrupt));
+	gzfreeze(psxRegs.intCycle, sizeof(psxRegs.intCycle));
+	gzfreeze(psxRegs.event_cycles, sizeof(psxRegs.event_cycles));
+	gzfreeze(&psxRegs.psxNextCounter, sizeof(psxRegs.psxNextCounter));
+	gzfreeze(&psxRegs.psxNextsCounter, sizeof(psxRegs.psxNextsCounter));
+	gzfreeze(&psxRegs.next_interupt, sizeof(psxRegs.next_interupt));
+	gzfreeze(&unused, sizeof(unused));
+}
+
 int SaveState(const char *file) {
 	struct misc_save_data *misc = (void *)(psxH + 0xf000);
 	struct origin_info oi = { 0, };
@@ -760,26 +944,23 @@ int SaveState(const char *file) {
 	SaveFuncs.write(f, psxM, 0x00200000);
 	SaveFuncs.write(f, psxR, 0x00080000);
 	SaveFuncs.write(f, psxH, 0x00010000);
-	// only partial save of psxRegisters to maintain savestate compat
-	SaveFuncs.write(f, &psxRegs, offsetof(psxRegisters, gteBusyCycle));
+	psxRegsFreeze(f, 1);
 
 	// gpu
-	gpufP = (GPUFreeze_t *)malloc(sizeof(GPUFreeze_t));
+	gpufP = state_scratch(0, sizeof(GPUFreeze_t));
 	if (gpufP == NULL) goto cleanup;
 	gpufP->ulFreezeVersion = 1;
 	memset(gpufP->ulControl, 0, sizeof(gpufP->ulControl));
 	GPU_freeze(1, gpufP);
 	SaveFuncs.write(f, gpufP, sizeof(GPUFreeze_t));
-	free(gpufP); gpufP = NULL;
 
 	// spu
 	SPU_freeze(2, (SPUFreeze_t *)&spufH, psxRegs.cycle);
 	Size = spufH.Size; SaveFuncs.write(f, &Size, 4);
-	spufP = (SPUFreeze_t *) malloc(Size);
+	spufP = state_scratch(1, Size);
 	if (spufP == NULL) goto cleanup;
 	SPU_freeze(1, spufP, psxRegs.cycle);
 	SaveFuncs.write(f, spufP, Size);
-	free(spufP); spufP = NULL;
 
 	sioFreeze(f, 1);
 	cdrFreeze(f, 1);
@@ -844,7 +1025,7 @@ int LoadState(const char *file) {
 	SaveFuncs.read(f, psxM, 0x00200000);
 	SaveFuncs.read(f, psxR, 0x00080000);
 	SaveFuncs.read(f, psxH, 0x00010000);
-	SaveFuncs.read(f, &psxRegs, offsetof(psxRegisters, gteBusyCycle));
+	psxRegsFreeze(f, 0);
 	psxRegs.gteBusyCycle = psxRegs.cycle;
 	psxRegs.branching = 0;
 	psxRegs.biosBranchCheck = ~0;
@@ -868,20 +1049,18 @@ int LoadState(const char *file) {
 		psxBiosFreeze(0);
 
 	// gpu
-	gpufP = (GPUFreeze_t *)malloc(sizeof(GPUFreeze_t));
+	gpufP = state_scratch(0, sizeof(GPUFreeze_t));
 	if (gpufP == NULL) goto cleanup;
 	SaveFuncs.read(f, gpufP, sizeof(GPUFreeze_t));
 	GPU_freeze(0, gpufP);
-	free(gpufP);
 	gpuSyncPluginSR();
 
 	// spu
 	SaveFuncs.read(f, &Size, 4);
-	spufP = (SPUFreeze_t *)malloc(Size);
+	spufP = state_scratch(1, Size);
 	if (spufP == NULL) goto cleanup;
 	SaveFuncs.read(f, spufP, Size);
 	SPU_freeze(0, spufP, psxRegs.cycle);
-	free(spufP);
 
 	sioFreeze(f, 0);
 	cdrFreeze(f, 0);
@@ -935,6 +1114,113 @@ int CheckState(const char *file) {
 	return 0;
 }
 
+// in-memory states (rewind, background saving)
+struct mem_fp {
+	u8 *buf;
+	u32 pos, size;
+	int skip_bios, error;
+};
+
+static int mem_skip(const struct mem_fp *fp, const void *buf, u32 len)
+{
+	// a real BIOS never changes, no point in copying it around
+	return fp->skip_bios && !Config.HLE && buf == psxR && len == 0x80000;
+}
+
+static void *mem_open(const char *name, const char *mode)
+{
+	return (void *)name;
+}
+
+static int mem_read(void *file, void *buf, u32 len)
+{
+	struct mem_fp *fp = file;
+
+	if (mem_skip(fp, buf, len))
+		return len;
+	if (fp->pos + len > fp->size) {
+		fp->error = 1;
+		return -1;
+	}
+	memcpy(buf, fp->buf + fp->pos, len);
+	fp->pos += len;
+	return len;
+}
+
+static int mem_write(void *file, const void *buf, u32 len)
+{
+	struct mem_fp *fp = file;
+
+	if (mem_skip(fp, buf, len))
+		return len;
+	if (fp->pos + len > fp->size) {
+		fp->error = 1;
+		return -1;
+	}
+	memcpy(fp->buf + fp->pos, buf, len);
+	fp->pos += len;
+	return len;
+}
+
+static long mem_seek(void *file, long offs, int whence)
+{
+	struct mem_fp *fp = file;
+
+	switch (whence) {
+	case SEEK_CUR:
+		fp->pos += offs;
+		return fp->pos;
+	case SEEK_SET:
+		fp->pos = offs;
+		return fp->pos;
+	default:
+		return -1;
+	}
+}
+
+static void mem_close(void *file)
+{
+}
+
+static int mem_state(struct mem_fp *fp, int save)
+{
+	static const struct PcsxSaveFuncs mem_funcs = {
+		mem_open, mem_read, mem_write, mem_seek, mem_close
+	};
+	struct PcsxSaveFuncs saved = SaveFuncs;
+	int ret;
+
+	SaveFuncs = mem_funcs;
+	if (save)
+		ret = SaveState((const char *)fp);
+	else
+		ret = LoadState((const char *)fp);
+	SaveFuncs = saved;
+
+	if (fp->error) {
+		SysPrintf("state buffer overflow (%u bytes)\n", fp->size);
+		ret = -1;
+	}
+	return ret;
+}
+
+// returns the state length or -1
+int SaveStateMem(void *buf, u32 size, int skip_bios)
+{
+	struct mem_fp fp = { buf, 0, size, skip_bios, 0 };
+
+	if (mem_state(&fp, 1) != 0)
+		return -1;
+	return fp.pos;
+}
+
+int LoadStateMem(const void *buf, u32 size, int skip_bios)
+{
+	struct mem_fp fp = { (void *)buf, 0, size, skip_bios, 0 };
+
+	return mem_state(&fp, 0);
+}
+
 // remove the leading and trailing spaces in a string
 void trim(char *str) {
 	int pos = 0;
@@ -1026,6 +1312,8 @@ const char *get_build_info(void)
 		"arm64"
 #elif defined(__arm__)
 		"arm"
+#elif defined(__riscv)
+		"rv64"
 #endif
 #ifdef __ARM_ARCH
 		"v" MKSTR(__ARM_ARCH) " "
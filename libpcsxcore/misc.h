@@ -64,9 +64,15 @@ int LoadCdromFile(const char *filename, EXE_HEADER *head, u8 *time_bcd_out);
 int CheckCdrom();
 int Load(const char *ExePath);
 
+// upper bound of the savestate size, with some reserve
+#define SAVESTATE_MAX_SIZE 0x440000
+
 int SaveState(const char *file);
 int LoadState(const char *file);
 int CheckState(const char *file);
+int SaveStateMem(void *buf, u32 size, int skip_bios);
+int LoadStateMem(const void *buf, u32 size, int skip_bios);
+const char *StateWriteMode(void);
 
 void trim(char *str);
 u16 calcCrc(const u8 *d, int len);
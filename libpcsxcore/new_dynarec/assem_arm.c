@@ -2362,6 +2362,15 @@ static void do_miniht_insert(u_int return_address,int rt,int temp) {
   #endif
 }
 
+// for the block profiler, only used at block entry where r0/r1 are free
+static void emit_inc_counter(u_int *counter)
+{
+  emit_movimm((u_int)counter, 0);
+  emit_readword_indexed(0, 0, 1);
+  emit_addimm(1, 1, 1);
+  emit_writeword_indexed(1, 0, 0);
+}
+
 // CPU-architecture-specific initialization
 static void arch_init(void)
 {
@@ -821,33 +821,12 @@ static void emit_cmpimm(u_int rs, u_int imm)
   }
 }
 
-static void emit_cmov_imm(u_int cond0, u_int cond1, u_int imm, u_int rt)
+// rt = cond ? 1 : 0, no need to clear rt before the compare
+static void emit_cset(u_int cond, u_int rt)
 {
-  assert(imm == 0 || imm == 1);
-  assert(cond0 < 0x10);
-  assert(cond1 < 0x10);
-  if (imm) {
-    assem_debug("csinc %s,%s,%s,%s\n",regname[rt],regname[rt],regname[WZR],condname[cond1]);
-    output_w32(0x1a800400 | (cond1 << 12) | rm_rn_rd(WZR, rt, rt));
-  } else {
-    assem_debug("csel %s,%s,%s,%s\n",regname[rt],regname[WZR],regname[rt],condname[cond0]);
-    output_w32(0x1a800000 | (cond0 << 12) | rm_rn_rd(rt, WZR, rt));
-  }
-}
-
-static void emit_cmovne_imm(u_int imm,u_int rt)
-{
-  emit_cmov_imm(COND_NE, COND_EQ, imm, rt);
-}
-
-static void emit_cmovl_imm(u_int imm,u_int rt)
-{
-  emit_cmov_imm(COND_LT, COND_GE, imm, rt);
-}
-
-static void emit_cmovb_imm(int imm,u_int rt)
-{
-  emit_cmov_imm(COND_CC, COND_CS, imm, rt);
+  assert(cond < 0x0e);
+  assem_debug("cset %s,%s\n",regname[rt],condname[cond]);
+  output_w32(0x1a800400 | ((cond ^ 1) << 12) | rm_rn_rd(WZR, WZR, rt));
 }
 
 static void emit_cmoveq_reg(u_int rs,u_int rt)
@@ -894,18 +873,14 @@ static void emit_csinvne_reg(u_int rs1,u_int rs2,u_int rt)
 
 static void emit_slti32(u_int rs,int imm,u_int rt)
 {
-  if(rs!=rt) emit_zeroreg(rt);
   emit_cmpimm(rs,imm);
-  if(rs==rt) emit_movimm(0,rt);
-  emit_cmovl_imm(1,rt);
+  emit_cset(COND_LT,rt);
 }
 
 static void emit_sltiu32(u_int rs,int imm,u_int rt)
 {
-  if(rs!=rt) emit_zeroreg(rt);
   emit_cmpimm(rs,imm);
-  if(rs==rt) emit_movimm(0,rt);
-  emit_cmovb_imm(1,rt);
+  emit_cset(COND_CC,rt);
 }
 
 static void emit_cmp(u_int rs,u_int rt)
@@ -922,36 +897,26 @@ static void emit_cmpcs(u_int rs,u_int rt)
 
 static void emit_set_gz32(u_int rs, u_int rt)
 {
-  //assem_debug("set_gz32\n");
   emit_cmpimm(rs,1);
-  emit_movimm(1,rt);
-  emit_cmovl_imm(0,rt);
+  emit_cset(COND_GE,rt);
 }
 
 static void emit_set_nz32(u_int rs, u_int rt)
 {
-  //assem_debug("set_nz32\n");
-  if(rs!=rt) emit_mov(rs,rt);
   emit_test(rs,rs);
-  emit_cmovne_imm(1,rt);
+  emit_cset(COND_NE,rt);
 }
 
 static void emit_set_if_less32(u_int rs1, u_int rs2, u_int rt)
 {
-  //assem_debug("set if less (%%%s,%%%s),%%%s\n",regname[rs1],regname[rs2],regname[rt]);
-  if(rs1!=rt&&rs2!=rt) emit_zeroreg(rt);
   emit_cmp(rs1,rs2);
-  if(rs1==rt||rs2==rt) emit_movimm(0,rt);
-  emit_cmovl_imm(1,rt);
+  emit_cset(COND_LT,rt);
 }
 
 static void emit_set_if_carry32(u_int rs1, u_int rs2, u_int rt)
 {
-  //assem_debug("set if carry (%%%s,%%%s),%%%s\n",regname[rs1],regname[rs2],regname[rt]);
-  if(rs1!=rt&&rs2!=rt) emit_zeroreg(rt);
   emit_cmp(rs1,rs2);
-  if(rs1==rt||rs2==rt) emit_movimm(0,rt);
-  emit_cmovb_imm(1,rt);
+  emit_cset(COND_CC,rt);
 }
 
 static int can_jump_or_call(const void *a)
@@ -1093,6 +1058,19 @@ static void emit_adrp(void *addr, u_int rt)
   output_w32(0x90000000 | ((offset&0x3)<<29) | (((offset>>2)&0x7ffff)<<5) | rt);
 }
 
+// host pointers, 2 insns instead of 3 when adrp can reach them
+static void emit_movptr(uintptr_t addr, u_int rt)
+{
+  intptr_t offset = (addr & ~0xfffl) - ((intptr_t)out & ~0xfffl);
+  if (-4294967296l <= offset && offset < 4294967296l) {
+    emit_adrp((void *)addr, rt);
+    if (addr & 0xfff)
+      emit_addimm64(rt, addr & 0xfff, rt);
+  }
+  else
+    emit_movimm64(addr, rt);
+}
+
 static void emit_readword_indexed(int offset, u_int rs, u_int rt)
 {
   assem_debug("ldur %s,[%s+%#x]\n",regname[rt],regname64[rs],offset);
@@ -1237,6 +1215,11 @@ static void emit_smull(u_int rs1, u_int rs2, u_int rt)
   output_w32(0x9b200000 | rm_ra_rn_rd(rs2, WZR, rs1, rt));
 }
 
+static void emit_madd(u_int rs1, u_int rs2, u_int rs3, u_int rt)
+{
+  assem_debug("madd %s,%s,%s,%s\n",regname[rt],regname[rs1],regname[rs2],regname[rs3]);
+  output_w32(0x1b000000 | rm_ra_rn_rd(rs2, rs3, rs1, rt));
+}
 static void emit_msub(u_int rs1, u_int rs2, u_int rs3, u_int rt)
 {
   assem_debug("msub %s,%s,%s,%s\n",regname[rt],regname[rs1],regname[rs2],regname[rs3]);
@@ -1409,9 +1392,9 @@ static void emit_movimm_from64(u_int rs_val, u_int rs, uintptr_t rt_val, u_int r
     emit_movimm_from(rs_val, rs, rt_val, rt);
     return;
   }
-  // just move the whole thing. At least on Linux all addresses
-  // seem to be 48bit, so 3 insns - not great not terrible
-  emit_movimm64(rt_val, rt);
+  // psxM/psxH are usually mapped near the tcache, else it's
+  // the whole 48bit thing in 3 insns
+  emit_movptr(rt_val, rt);
 }
 
 // trashes x2
@@ -1597,13 +1580,7 @@ static void inline_readstub(enum stub_type type, int i, u_int addr,
   emit_addimm(cc_use, adj, 2);
   if(is_dynamic) {
     uintptr_t l1 = ((uintptr_t *)mem_rtab)[addr>>12] << 1;
-    intptr_t offset = (l1 & ~0xfffl) - ((intptr_t)out & ~0xfffl);
-    if (-4294967296l <= offset && offset < 4294967296l) {
-      emit_adrp((void *)l1, 1);
-      emit_addimm64(1, l1 & 0xfff, 1);
-    }
-    else
-      emit_movimm64(l1, 1);
+    emit_movptr(l1, 1);
   }
   else
     emit_far_call(do_memhandler_pre);
@@ -1782,6 +1759,66 @@ static void c2op_epilogue(u_int op,u_int reglist)
   save_load_regs_all(0, reglist);
 }
 
+// offsets from the cop2 regs pointer
+#define CP2D_OFS(r) ((r) * 4)
+#define CP2C_OFS(r) ((32 + (r)) * 4)
+
+// flagless NCLIP/AVSZ3/AVSZ4 emitted in place, only x0-x5 are used so
+// only those have to be saved; same results as the gte_nf.c versions
+static void c2op_assemble_inline(u_int op, int i, const struct regstat *i_regs,
+  u_int reglist)
+{
+  reglist &= 0x3f;
+  save_load_regs_all(1, reglist);
+  cop2_do_stall_check(op, i, i_regs, ~0x3fu);
+  emit_addimm64(FP, (u_char *)&psxRegs.CP2D.r[0] - (u_char *)&dynarec_local, 0);
+  switch (op) {
+    case GTE_NCLIP:
+      // MAC0 = SX0*(SY1-SY2) + SX1*(SY2-SY0) + SX2*(SY0-SY1), low 32 bits
+      emit_movswl_indexed(CP2D_OFS(12), 0, 1);     // SX0
+      emit_movswl_indexed(CP2D_OFS(13) + 2, 0, 2); // SY1
+      emit_movswl_indexed(CP2D_OFS(14) + 2, 0, 3); // SY2
+      emit_sub(2, 3, 4);
+      emit_madd(1, 4, WZR, 5);
+      emit_movswl_indexed(CP2D_OFS(13), 0, 1);     // SX1
+      emit_movswl_indexed(CP2D_OFS(12) + 2, 0, 4); // SY0
+      emit_sub(3, 4, 3);
+      emit_madd(1, 3, 5, 5);
+      emit_movswl_indexed(CP2D_OFS(14), 0, 1);     // SX2
+      emit_sub(4, 2, 4);
+      emit_madd(1, 4, 5, 5);
+      emit_writeword_indexed(5, CP2D_OFS(24), 0);  // MAC0
+      break;
+    case GTE_AVSZ3:
+    case GTE_AVSZ4:
+      // MAC0 = ZSF * (sum of SZ), OTZ = clamp(MAC0 >> 12, 0, 0xffff)
+      emit_movzwl_indexed(CP2D_OFS(17), 0, 1);
+      emit_movzwl_indexed(CP2D_OFS(18), 0, 2);
+      emit_add(1, 2, 1);
+      emit_movzwl_indexed(CP2D_OFS(19), 0, 2);
+      emit_add(1, 2, 1);
+      if (op == GTE_AVSZ4) {
+        emit_movzwl_indexed(CP2D_OFS(16), 0, 2);
+        emit_add(1, 2, 1);
+        emit_movswl_indexed(CP2C_OFS(30), 0, 2);   // ZSF4
+      }
+      else
+        emit_movswl_indexed(CP2C_OFS(29), 0, 2);   // ZSF3
+      emit_madd(1, 2, WZR, 3);
+      emit_writeword_indexed(3, CP2D_OFS(24), 0);  // MAC0
+      emit_sarimm(3, 12, 3);
+      emit_bicsar_imm(3, 31, 3);                   // < 0 -> 0
+      emit_cmpimm(3, 0xffff);
+      emit_csinvle_reg(3, WZR, 3);                 // > 0xffff -> ~0
+      emit_writehword_indexed(3, CP2D_OFS(7), 0);  // OTZ
+      break;
+    default:
+      assert(0);
+  }
+  emit_writeword_indexed(WZR, CP2C_OFS(31), 0);    // FLAG
+  save_load_regs_all(0, reglist);
+}
+
 static void c2op_assemble(int i, const struct regstat *i_regs)
 {
   u_int c2op=source[i]&0x3f;
@@ -1802,6 +1839,16 @@ static void c2op_assemble(int i, const struct regstat *i_regs)
     //int shift = (source[i] >> 19) & 1;
     //int lm = (source[i] >> 10) & 1;
     switch(c2op) {
+#if !defined(DRC_DBG) && !defined(PCNT)
+      case GTE_NCLIP:
+      case GTE_AVSZ3:
+      case GTE_AVSZ4:
+        if (!need_flags) {
+          c2op_assemble_inline(c2op, i, i_regs, reglist);
+          return;
+        }
+        // fallthrough
+#endif
       default:
         (void)need_ir;
         c2op_prologue(c2op, i, i_regs, reglist);
@@ -2116,6 +2163,15 @@ static attr_unused void clear_cache_arm64(char *start, char *end)
   __asm__ volatile("isb" : : : "memory");
 }
 
+// for the block profiler, only used at block entry where w0/w1 are free
+static void emit_inc_counter(u_int *counter)
+{
+  emit_movimm64((uintptr_t)counter, 0);
+  emit_readword_indexed(0, 0, 1);
+  emit_addimm(1, 1, 1);
+  emit_writeword_indexed(1, 0, 0);
+}
+
 // CPU-architecture-specific initialization
 static void arch_init(void)
 {
@@ -1,4 +1,5 @@
 #define HOST_IMM8 1
+#define HAVE_UNALIGNED_LDST 1 // normal memory, any alignment
 
 /* calling convention:
    x0 -x17: caller-save
@@ -0,0 +1,2097 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus/PCSX - assem_rv64.c                                       *
+ *   Copyright (C) 2009-2011 Ari64                                         *
+ *   Copyright (C) 2009-2018 Gillou68310                                   *
+ *   Copyright (C) 2021 notaz                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * notes on how arm64 things were mapped:
+ * - all 32bit values live sign extended in the 64bit regs (what the W ops
+ *   produce), guest addresses too, so the generic indexed and dualindexed
+ *   emitters zero extend the address before use
+ * - there are no flags, the compare operands are remembered instead and
+ *   the branch/cmov that consumes them turns them into a compare-and-branch,
+ *   so a flags consumer must directly follow it's setter (see struct rv_flags)
+ * - conditional branches only reach 4K, so an unresolved one is an inverted
+ *   branch over a jal, and a jal too far for a link goes through a slot in
+ *   the extjump stub
+ */
+
+#include "pcnt.h"
+
+static void *get_trampoline(const void *f);
+static void emit_jmp(const void *a);
+
+// host register numbers -> hardware ones, see assem_rv64.h
+static const u_char rv_regs[30] = {
+  10, 11, 12, 13, 14, 15, 16, 17, // a0-a7
+   5,  6,  7, 28,                 // t0-t3
+   9, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, // s1-s11
+   8,  1, 29, 30, 31,  2,  0,     // s0, ra, t4-t6, sp, zero
+};
+
+static attr_unused const char *regname[30] = {
+  "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+  "t0", "t1", "t2", "t3",
+  "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+  "fp", "ra", "t4", "t5", "t6", "sp", "zero"
+};
+
+enum {
+  COND_EQ, COND_NE, COND_CS, COND_CC, COND_MI, COND_PL, COND_VS, COND_VC,
+  COND_HI, COND_LS, COND_GE, COND_LT, COND_GT, COND_LE, COND_AW, COND_NV
+};
+
+static attr_unused const char *condname[16] = {
+  "eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc",
+  "hi", "ls", "ge", "lt", "gt", "le", "aw", "nv"
+};
+
+#define RV_ADD     0x00000033
+#define RV_SUB     0x40000033
+#define RV_SLL     0x00001033
+#define RV_SLT     0x00002033
+#define RV_SLTU    0x00003033
+#define RV_XOR     0x00004033
+#define RV_SRL     0x00005033
+#define RV_SRA     0x40005033
+#define RV_OR      0x00006033
+#define RV_AND     0x00007033
+#define RV_MUL     0x02000033
+#define RV_MULHU   0x02003033
+#define RV_ADDW    0x0000003b
+#define RV_SUBW    0x4000003b
+#define RV_SLLW    0x0000103b
+#define RV_SRLW    0x0000503b
+#define RV_SRAW    0x4000503b
+#define RV_MULW    0x0200003b
+#define RV_DIVW    0x0200403b
+#define RV_DIVUW   0x0200503b
+#define RV_REMW    0x0200603b
+#define RV_REMUW   0x0200703b
+#define RV_ADDI    0x00000013
+#define RV_SLLI    0x00001013
+#define RV_SLTI    0x00002013
+#define RV_SLTIU   0x00003013
+#define RV_XORI    0x00004013
+#define RV_SRLI    0x00005013
+#define RV_SRAI    0x40005013
+#define RV_ORI     0x00006013
+#define RV_ANDI    0x00007013
+#define RV_ADDIW   0x0000001b
+#define RV_SLLIW   0x0000101b
+#define RV_SRLIW   0x0000501b
+#define RV_SRAIW   0x4000501b
+#define RV_LOAD    0x00000003 // | size << 12
+#define RV_STORE   0x00000023
+#define RV_BRANCH  0x00000063 // | cond << 12
+#define RV_JALR    0x00000067
+#define RV_JAL     0x0000006f
+#define RV_LUI     0x00000037
+#define RV_AUIPC   0x00000017
+// Zba/Zbb, only used when the compiler is told they are there
+#define RV_ADDUW   0x0800003b
+#define RV_SH3ADD  0x20006033
+#define RV_SH3ADDUW 0x2000603b
+#define RV_ANDN    0x40007033
+#define RV_CLZW    0x6000101b
+#define RV_RORIW   0x6000501b
+#define RV_SEXTH   0x60501013
+
+enum { LS_B, LS_H, LS_W, LS_D, LS_BU, LS_HU };
+enum { BR_EQ = 0, BR_NE = 1, BR_LT = 4, BR_GE = 5, BR_LTU = 6, BR_GEU = 7 };
+
+static attr_unused const char *ldname[8] = { "lb", "lh", "lw", "ld", "lbu", "lhu", "lwu", "?" };
+static attr_unused const char *stname[4] = { "sb", "sh", "sw", "sd" };
+static attr_unused const char *brname[8] = { "beq", "bne", "?", "?", "blt", "bge", "bltu", "bgeu" };
+
+static u_int rv_reg(u_int r)
+{
+  assert(r < ARRAY_SIZE(rv_regs));
+  return rv_regs[r];
+}
+
+static u_int rs2_rs1_rd(u_int rs2, u_int rs1, u_int rd)
+{
+  return (rv_reg(rs2) << 20) | (rv_reg(rs1) << 15) | (rv_reg(rd) << 7);
+}
+
+static int is_imm12(intptr_t imm)
+{
+  return -2048 <= imm && imm < 2048;
+}
+
+static u_int imm12_rs1_rd(int imm, u_int rs1, u_int rd)
+{
+  assert(is_imm12(imm));
+  return ((imm & 0xfff) << 20) | (rv_reg(rs1) << 15) | (rv_reg(rd) << 7);
+}
+
+static u_int imm12_rs2_rs1(int imm, u_int rs2, u_int rs1)
+{
+  assert(is_imm12(imm));
+  return ((imm & 0xfe0) << 20) | (rv_reg(rs2) << 20) | (rv_reg(rs1) << 15)
+    | ((imm & 0x1f) << 7);
+}
+
+static u_int imm13_b(intptr_t ofs)
+{
+  assert(-4096 <= ofs && ofs < 4096 && !(ofs & 1));
+  return ((ofs & 0x1000) << 19) | ((ofs & 0x7e0) << 20)
+    | ((ofs & 0x1e) << 7) | ((ofs & 0x800) >> 4);
+}
+
+static u_int imm21_j(intptr_t ofs)
+{
+  assert(-1048576 <= ofs && ofs < 1048576 && !(ofs & 1));
+  return ((ofs & 0x100000) << 11) | ((ofs & 0x7fe) << 20)
+    | ((ofs & 0x800) << 9) | (ofs & 0xff000);
+}
+
+static int b_offset(u_int insn)
+{
+  u_int ofs = ((insn >> 19) & 0x1000) | ((insn >> 20) & 0x7e0)
+    | ((insn >> 7) & 0x1e) | ((insn << 4) & 0x800);
+  return (signed int)(ofs << 19) >> 19;
+}
+
+static int j_offset(u_int insn)
+{
+  u_int ofs = ((insn >> 11) & 0x100000) | ((insn >> 20) & 0x7fe)
+    | ((insn >> 9) & 0x800) | (insn & 0xff000);
+  return (signed int)(ofs << 11) >> 11;
+}
+
+// auipc+addi/jalr/ld pair split of a pc relative offset
+static void split_hi_lo(intptr_t ofs, u_int *hi, int *lo)
+{
+  assert(-2147483648l <= ofs && ofs < 2147481600l);
+  *hi = (u_int)(ofs + 0x800) & 0xfffff000;
+  *lo = (int)(ofs - (int)*hi);
+}
+
+static void pair_offset_patch(u_int *ptr, intptr_t ofs)
+{
+  u_int hi;
+  int lo;
+  split_hi_lo(ofs, &hi, &lo);
+  ptr[0] = (ptr[0] & 0xfff) | hi;
+  ptr[1] = (ptr[1] & 0x000fffff) | ((u_int)lo << 20);
+}
+
+/* Linker */
+
+// which insn actually branches, skipping what emit_jcc() put in front
+static u_int *find_jump_insn(void *addr)
+{
+  u_int *ptr = NDRC_WRITE_OFFSET(addr);
+  int i;
+  for (i = 0; i < 3; i++, ptr++) {
+    u_int op = *ptr & 0x7f;
+    if (op != 0x13 && op != 0x1b && op != 0x33 && op != 0x3b && op != 0x37)
+      break;
+  }
+  if ((*ptr & 0x7f) == 0x63 && b_offset(*ptr) == 8 && (ptr[1] & 0xfff) == RV_JAL)
+    ptr++; // inverted branch over a jal
+  return (u_int *)((u_char *)addr + ((u_char *)ptr - (u_char *)NDRC_WRITE_OFFSET(addr)));
+}
+
+static void check_extjump2(void *src);
+
+static void set_jump_target_far1(u_int *insn_, void *target)
+{
+  u_int *insn = NDRC_WRITE_OFFSET(insn_);
+  intptr_t offset = (u_char *)target - (u_char *)insn_;
+  assert((*insn & 0xfff) == RV_JAL); // jal zero
+  if (offset < -1048576 || offset >= 1048576) {
+    // too far for jal (tcache is 16M), go through the extjump stub's
+    // far slot, the jal must be pointing to that stub at this point
+    u_int *stub = (u_int *)((u_char *)insn_ + j_offset(*insn));
+    u_int *slot = stub + 6;
+    check_extjump2(stub);
+    pair_offset_patch(NDRC_WRITE_OFFSET(slot), (u_char *)target - (u_char *)slot);
+    new_dyna_clear_cache(NDRC_WRITE_OFFSET(slot), NDRC_WRITE_OFFSET(slot + 2));
+    offset = (u_char *)slot - (u_char *)insn_;
+  }
+  *insn = RV_JAL | imm21_j(offset);
+}
+
+static void set_jump_target(void *addr, void *target)
+{
+  u_int *insn_ = find_jump_insn(addr);
+  u_int *ptr = NDRC_WRITE_OFFSET(insn_);
+  intptr_t offset = (u_char *)target - (u_char *)insn_;
+
+  if ((*ptr & 0x7f) == 0x6f) { // jal
+    set_jump_target_far1(insn_, target);
+  }
+  else if ((*ptr & 0x7f) == 0x63) { // b<cond>
+    // only known near targets get these, the rest was made a b<!cond> + jal
+    assert(-4096 <= offset && offset < 4096);
+    *ptr = (*ptr & 0x01fff07f) | imm13_b(offset);
+  }
+  else if ((*ptr & 0x7f) == 0x17 && (ptr[1] & 0x707f) == RV_ADDI) { // auipc+addi
+    // generated by do_miniht_insert
+    pair_offset_patch(ptr, offset);
+  }
+  else
+    abort(); // should not happen
+}
+
+// from a pointer to external jump stub (which was produced by emit_extjump2)
+// find where the jumping insn is
+static void *find_extjump_insn(void *stub)
+{
+  u_int *ptr = (u_int *)stub + 2;
+  assert((ptr[0] & 0xfff) == (RV_AUIPC | (11 << 7))); // auipc a1
+  intptr_t offset = (signed int)(ptr[0] & 0xfffff000) + ((signed int)ptr[1] >> 20);
+  return (u_char *)ptr + offset;
+}
+
+// Allocate a specific ARM register.
+static void alloc_arm_reg(struct regstat *cur,int i,signed char reg,int hr)
+{
+  int n;
+  int dirty=0;
+
+  // see if it's already allocated (and dealloc it)
+  for(n=0;n<HOST_REGS;n++)
+  {
+    if(n!=EXCLUDE_REG&&cur->regmap[n]==reg) {
+      dirty=(cur->dirty>>n)&1;
+      cur->regmap[n]=-1;
+    }
+  }
+
+  cur->regmap[hr]=reg;
+  cur->dirty&=~(1<<hr);
+  cur->dirty|=dirty<<hr;
+  cur->isconst&=~(1<<hr);
+}
+
+// Alloc cycle count into dedicated register
+static void alloc_cc(struct regstat *cur, int i)
+{
+  alloc_arm_reg(cur, i, CCREG, HOST_CCREG);
+}
+
+static void alloc_cc_optional(struct regstat *cur, int i)
+{
+  if (cur->regmap[HOST_CCREG] < 0) {
+    alloc_arm_reg(cur, i, CCREG, HOST_CCREG);
+    cur->noevict &= ~(1u << HOST_CCREG);
+  }
+}
+
+/* Special alloc */
+
+
+/* Assembler */
+
+static void output_w32(u_int word)
+{
+  *((u_int *)NDRC_WRITE_OFFSET(out)) = word;
+  out += 4;
+}
+
+static void emit_rtype(u_int op, attr_unused const char *name,
+  u_int rs1, u_int rs2, u_int rd)
+{
+  assem_debug("%s %s,%s,%s\n", name, regname[rd], regname[rs1], regname[rs2]);
+  output_w32(op | rs2_rs1_rd(rs2, rs1, rd));
+}
+
+static void emit_itype(u_int op, attr_unused const char *name,
+  u_int rs1, int imm, u_int rd)
+{
+  assem_debug("%s %s,%s,%d\n", name, regname[rd], regname[rs1], imm);
+  output_w32(op | imm12_rs1_rd(imm, rs1, rd));
+}
+
+static void emit_load(u_int size, u_int rt, int ofs, u_int rs)
+{
+  assem_debug("%s %s,%d(%s)\n", ldname[size], regname[rt], ofs, regname[rs]);
+  output_w32(RV_LOAD | (size << 12) | imm12_rs1_rd(ofs, rs, rt));
+}
+
+static void emit_store(u_int size, u_int rt, int ofs, u_int rs)
+{
+  assem_debug("%s %s,%d(%s)\n", stname[size], regname[rt], ofs, regname[rs]);
+  output_w32(RV_STORE | (size << 12) | imm12_rs2_rs1(ofs, rt, rs));
+}
+
+static void emit_bcc(u_int br, u_int rs1, u_int rs2, intptr_t ofs)
+{
+  assem_debug("%s %s,%s,.%+ld\n", brname[br], regname[rs1], regname[rs2], (long)ofs);
+  output_w32(RV_BRANCH | (br << 12) | imm13_b(ofs)
+    | (rv_reg(rs2) << 20) | (rv_reg(rs1) << 15));
+}
+
+static void emit_lui(u_int imm, u_int rt)
+{
+  assem_debug("lui %s,%#x\n", regname[rt], imm >> 12);
+  output_w32(RV_LUI | (imm & 0xfffff000) | (rv_reg(rt) << 7));
+}
+
+static void emit_auipc(u_int imm, u_int rt)
+{
+  assem_debug("auipc %s,%#x\n", regname[rt], imm >> 12);
+  output_w32(RV_AUIPC | (imm & 0xfffff000) | (rv_reg(rt) << 7));
+}
+
+static void emit_jalr(u_int rd, int ofs, u_int rs)
+{
+  assem_debug("jalr %s,%d(%s)\n", regname[rd], ofs, regname[rs]);
+  output_w32(RV_JALR | imm12_rs1_rd(ofs, rs, rd));
+}
+
+static void emit_mov(u_int rs, u_int rt)
+{
+  emit_itype(RV_ADDI, "mv", rs, 0, rt);
+}
+#define emit_mov64 emit_mov
+
+static void emit_zeroreg(u_int rt)
+{
+  emit_itype(RV_ADDI, "li", ZR, 0, rt);
+}
+
+static void emit_movimm(u_int imm, u_int rt)
+{
+  u_int hi = (imm + 0x800) & 0xfffff000;
+  int lo = (int)(imm - hi);
+  if (hi == 0)
+    emit_itype(RV_ADDI, "li", ZR, lo, rt);
+  else {
+    emit_lui(hi, rt);
+    if (lo)
+      emit_itype(RV_ADDIW, "addiw", rt, lo, rt);
+  }
+}
+
+static void emit_shlimm64(u_int rs, u_int imm, u_int rt)
+{
+  emit_itype(RV_SLLI, "slli", rs, imm, rt);
+}
+
+static void emit_shrimm64(u_int rs, u_int imm, u_int rt)
+{
+  emit_itype(RV_SRLI, "srli", rs, imm, rt);
+}
+
+static void emit_movimm64(uint64_t imm, u_int rt)
+{
+  int64_t v = imm;
+  int lo = (signed int)((u_int)imm << 20) >> 20;
+  int shift;
+  if (v == (int32_t)v) {
+    emit_movimm(imm, rt);
+    return;
+  }
+  v = (v - lo) >> 12;
+  shift = 12 + __builtin_ctzll(v);
+  v >>= shift - 12;
+  emit_movimm64(v, rt);
+  emit_shlimm64(rt, shift, rt);
+  if (lo)
+    emit_itype(RV_ADDI, "addi", rt, lo, rt);
+}
+
+// host pointers, 2 insns when auipc can reach them
+static void emit_movptr(uintptr_t addr, u_int rt)
+{
+  intptr_t offset = (u_char *)addr - out;
+  if (-2147483648l <= offset && offset < 2147481600l) {
+    u_int hi;
+    int lo;
+    split_hi_lo(offset, &hi, &lo);
+    emit_auipc(hi, rt);
+    if (lo)
+      emit_itype(RV_ADDI, "addi", rt, lo, rt);
+  }
+  else
+    emit_movimm64(addr, rt);
+}
+
+// rt = (u32)rs
+static void emit_zext32(u_int rs, u_int rt)
+{
+#ifdef __riscv_zba
+  emit_rtype(RV_ADDUW, "add.uw", rs, ZR, rt);
+#else
+  emit_shlimm64(rs, 32, rt);
+  emit_shrimm64(rt, 32, rt);
+#endif
+}
+
+// rt = rbase + (u32)rs, rt must not be rbase without Zba
+static void emit_add_zext(u_int rbase, u_int rs, u_int rt)
+{
+#ifdef __riscv_zba
+  emit_rtype(RV_ADDUW, "add.uw", rs, rbase, rt);
+#else
+  assert(rt != rbase);
+  emit_zext32(rs, rt);
+  emit_rtype(RV_ADD, "add", rt, rbase, rt);
+#endif
+}
+
+static int fp_ofs(void *addr)
+{
+  intptr_t offset = (u_char *)addr - (u_char *)&dynarec_local;
+  assert(0 <= offset && offset < 2048);
+  return offset;
+}
+
+static void emit_readword(void *addr, u_int rt)
+{
+  emit_load(LS_W, rt, fp_ofs(addr), FP);
+}
+
+static void emit_readdword(void *addr, u_int rt)
+{
+  emit_load(LS_D, rt, fp_ofs(addr), FP);
+}
+#define emit_readptr emit_readdword
+
+static void emit_readshword(void *addr, u_int rt)
+{
+  emit_load(LS_H, rt, fp_ofs(addr), FP);
+}
+
+static void emit_loadreg(u_int r, u_int hr)
+{
+  int is64 = 0;
+  if (r == 0)
+    emit_zeroreg(hr);
+  else {
+    void *addr;
+    switch (r) {
+    //case HIREG: addr = &hi; break;
+    //case LOREG: addr = &lo; break;
+    case CCREG: addr = &cycle_count; break;
+    case INVCP: addr = &invc_ptr; is64 = 1; break;
+    case ROREG: addr = &ram_offset; is64 = 1; break;
+    default:
+      assert(r < 34);
+      addr = &psxRegs.GPR.r[r];
+      break;
+    }
+    if (is64)
+      emit_readdword(addr, hr);
+    else
+      emit_readword(addr, hr);
+  }
+}
+
+static void emit_writeword(u_int rt, void *addr)
+{
+  emit_store(LS_W, rt, fp_ofs(addr), FP);
+}
+
+static void emit_writedword(u_int rt, void *addr)
+{
+  emit_store(LS_D, rt, fp_ofs(addr), FP);
+}
+
+static void emit_storereg(u_int r, u_int hr)
+{
+  assert(r < 64);
+  void *addr;
+  switch (r) {
+  //case HIREG: addr = &hi; break;
+  //case LOREG: addr = &lo; break;
+  case CCREG: addr = &cycle_count; break;
+  default: assert(r < 34u); addr = &psxRegs.GPR.r[r]; break;
+  }
+  emit_writeword(hr, addr);
+}
+
+/* flags */
+
+// what arm64 would have in NZCV, evaluated by the consumer
+static struct rv_flags {
+  u_char type;
+  u_char a, b;
+  int imm;
+} rv_flags;
+
+enum {
+  FL_NONE,
+  FL_CMP,  // a - b
+  FL_CMPI, // a - imm
+  FL_RES,  // result in a, V clear, C unknown
+  FL_OVF,  // 32bit result in a, exact 64bit one in FLA
+};
+
+static void set_flags(u_int type, u_int a, u_int b, int imm)
+{
+  rv_flags.type = type;
+  rv_flags.a = a;
+  rv_flags.b = b;
+  rv_flags.imm = imm;
+}
+
+// b<*br> *r1,*r2 is taken when cond is true, setup insns may use SCR
+static u_int emit_cond_setup(u_int cond, u_int *r1, u_int *r2)
+{
+  u_int a = rv_flags.a, b = rv_flags.b, br = BR_NE;
+  int imm = rv_flags.imm;
+  *r1 = *r2 = ZR; // never
+
+  assert(cond < COND_AW);
+  if (rv_flags.type == FL_CMPI) {
+    switch (cond & ~1) {
+    case COND_MI:
+      if (imm == 0) {
+        *r1 = a; br = BR_LT;
+        break;
+      }
+      if (is_imm12(-(intptr_t)imm))
+        emit_itype(RV_ADDIW, "addiw", a, -imm, SCR);
+      else {
+        emit_movimm(imm, SCR);
+        emit_rtype(RV_SUBW, "subw", a, SCR, SCR);
+      }
+      *r1 = SCR; br = BR_LT;
+      break;
+    case COND_VS:
+      if (imm > 0) { // a < INT_MIN + imm
+        emit_movimm(0x80000000u + imm, SCR);
+        *r1 = a; *r2 = SCR; br = BR_LT;
+      }
+      else if (imm < 0) { // a > INT_MAX + imm
+        emit_movimm(0x7fffffffu + imm, SCR);
+        *r1 = SCR; *r2 = a; br = BR_LT;
+      }
+      break;
+    default:
+      b = ZR;
+      if (imm != 0) {
+        emit_movimm(imm, SCR);
+        b = SCR;
+      }
+      goto cmp;
+    }
+  }
+  else if (rv_flags.type == FL_CMP) {
+cmp:
+    switch (cond & ~1) {
+    case COND_EQ: *r1 = a; *r2 = b; br = BR_EQ;  break;
+    case COND_CS: *r1 = a; *r2 = b; br = BR_GEU; break;
+    case COND_HI: *r1 = b; *r2 = a; br = BR_LTU; break;
+    case COND_GE: *r1 = a; *r2 = b; br = BR_GE;  break;
+    case COND_GT: *r1 = b; *r2 = a; br = BR_LT;  break;
+    case COND_MI:
+      emit_rtype(RV_SUBW, "subw", a, b, SCR);
+      *r1 = SCR; br = BR_LT;
+      break;
+    case COND_VS:
+      // no overflow: a - b as 32bit + b gives a back
+      emit_rtype(RV_SUBW, "subw", a, b, SCR);
+      emit_rtype(RV_ADD, "add", SCR, b, SCR);
+      *r1 = SCR; *r2 = a; br = BR_NE;
+      break;
+    }
+  }
+  else if (rv_flags.type == FL_RES || rv_flags.type == FL_OVF) {
+    u_int e = rv_flags.type == FL_OVF ? FLA : a;
+    switch (cond & ~1) {
+    case COND_EQ: *r1 = a; br = BR_EQ; break;
+    case COND_MI: *r1 = a; br = BR_LT; break;
+    case COND_GE: *r1 = e; br = BR_GE; break;
+    case COND_GT: *r2 = e; br = BR_LT; break;
+    case COND_VS:
+      if (rv_flags.type == FL_OVF) {
+        *r1 = FLA; *r2 = a; br = BR_NE;
+      }
+      break;
+    default:
+      assert(0); // no carry here
+    }
+  }
+  else
+    assert(0);
+  if (cond & 1)
+    br ^= 1;
+  return br;
+}
+
+static void emit_test(u_int rs, u_int rt)
+{
+  emit_rtype(RV_AND, "and", rs, rt, FLA);
+  set_flags(FL_RES, FLA, 0, 0);
+}
+
+static void emit_testimm(u_int rs, u_int imm)
+{
+  if (is_imm12((int)imm))
+    emit_itype(RV_ANDI, "andi", rs, imm, FLA);
+  else {
+    emit_movimm(imm, SCR);
+    emit_rtype(RV_AND, "and", rs, SCR, FLA);
+  }
+  set_flags(FL_RES, FLA, 0, 0);
+}
+
+static void emit_cmp(u_int rs, u_int rt)
+{
+  set_flags(FL_CMP, rs, rt, 0);
+}
+
+static void emit_cmpimm(u_int rs, u_int imm)
+{
+  set_flags(FL_CMPI, rs, 0, imm);
+}
+
+// if cs: flags = rs - rt, else carry clear; only carry is used after this
+static void emit_cmpcs(u_int rs, u_int rt)
+{
+  assert(rv_flags.type == FL_CMP || rv_flags.type == FL_CMPI);
+  if (rv_flags.type == FL_CMPI)
+    emit_movimm(rv_flags.imm, FLB);
+  else
+    emit_mov(rv_flags.b, FLB);
+  emit_mov(rv_flags.a, FLA);
+  emit_bcc(BR_LTU, FLA, FLB, 12);
+  emit_mov(rs, FLA);
+  emit_mov(rt, FLB);
+  set_flags(FL_CMP, FLA, FLB, 0);
+}
+
+static void emit_add(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_ADDW, "addw", rs1, rs2, rt);
+}
+
+static void emit_add64(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_ADD, "add", rs1, rs2, rt);
+}
+#define emit_adds_ptr emit_add64 // nothing looks at the flags
+
+static void emit_adds(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_ADD, "add", rs1, rs2, FLA);
+  emit_rtype(RV_ADDW, "addw", rs1, rs2, rt);
+  set_flags(FL_OVF, rt, 0, 0);
+}
+
+static void emit_neg(u_int rs, u_int rt)
+{
+  emit_rtype(RV_SUBW, "negw", ZR, rs, rt);
+}
+
+static void emit_negs(u_int rs, u_int rt)
+{
+  emit_rtype(RV_SUB, "neg", ZR, rs, FLA);
+  emit_rtype(RV_SUBW, "negw", ZR, rs, rt);
+  set_flags(FL_OVF, rt, 0, 0);
+}
+
+static void emit_sub(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_SUBW, "subw", rs1, rs2, rt);
+}
+
+static void emit_subs(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_SUB, "sub", rs1, rs2, FLA);
+  emit_rtype(RV_SUBW, "subw", rs1, rs2, rt);
+  set_flags(FL_OVF, rt, 0, 0);
+}
+
+static void emit_not(u_int rs,u_int rt)
+{
+  emit_itype(RV_XORI, "xori", rs, -1, rt);
+}
+
+static void emit_and(u_int rs1,u_int rs2,u_int rt)
+{
+  emit_rtype(RV_AND, "and", rs1, rs2, rt);
+}
+
+static void emit_or(u_int rs1,u_int rs2,u_int rt)
+{
+  emit_rtype(RV_OR, "or", rs1, rs2, rt);
+}
+
+static void emit_xor(u_int rs1,u_int rs2,u_int rt)
+{
+  emit_rtype(RV_XOR, "xor", rs1, rs2, rt);
+}
+
+// rt = rs1 & ~rs2, rs2 is destroyed without Zbb
+static void emit_bic(u_int rs1, u_int rs2, u_int rt)
+{
+#ifdef __riscv_zbb
+  emit_rtype(RV_ANDN, "andn", rs1, rs2, rt);
+#else
+  emit_not(rs2, rs2);
+  emit_and(rs1, rs2, rt);
+#endif
+}
+
+static void emit_shlimm(u_int rs,u_int imm,u_int rt)
+{
+  emit_itype(RV_SLLIW, "slliw", rs, imm, rt);
+}
+
+static void emit_shrimm(u_int rs,u_int imm,u_int rt)
+{
+  emit_itype(RV_SRLIW, "srliw", rs, imm, rt);
+}
+
+static void emit_sarimm(u_int rs,u_int imm,u_int rt)
+{
+  emit_itype(RV_SRAIW, "sraiw", rs, imm, rt);
+}
+
+static void emit_rorimm(u_int rs,u_int imm,u_int rt)
+{
+  if (imm == 0) {
+    emit_itype(RV_ADDIW, "sext.w", rs, 0, rt);
+    return;
+  }
+#ifdef __riscv_zbb
+  emit_itype(RV_RORIW, "roriw", rs, imm, rt);
+#else
+  emit_shrimm(rs, imm, SCR);
+  emit_shlimm(rs, 32 - imm, rt);
+  emit_or(rt, SCR, rt);
+#endif
+}
+
+static void emit_signextend16(u_int rs, u_int rt)
+{
+#ifdef __riscv_zbb
+  assem_debug("sext.h %s,%s\n", regname[rt], regname[rs]);
+  output_w32(RV_SEXTH | imm12_rs1_rd(0, rs, rt));
+#else
+  emit_shlimm(rs, 16, rt);
+  emit_sarimm(rt, 16, rt);
+#endif
+}
+
+static void emit_shl(u_int rs,u_int rshift,u_int rt)
+{
+  emit_rtype(RV_SLLW, "sllw", rs, rshift, rt);
+}
+
+static void emit_shr(u_int rs,u_int rshift,u_int rt)
+{
+  emit_rtype(RV_SRLW, "srlw", rs, rshift, rt);
+}
+
+static void emit_sar(u_int rs,u_int rshift,u_int rt)
+{
+  emit_rtype(RV_SRAW, "sraw", rs, rshift, rt);
+}
+
+static void emit_orrshr_imm(u_int rs,u_int imm,u_int rt)
+{
+  emit_shrimm(rs, imm, SCR);
+  emit_or(rt, SCR, rt);
+}
+
+static void emit_xorsar_imm(u_int rs1, u_int rs2, u_int imm, u_int rt)
+{
+  emit_sarimm(rs2, imm, SCR);
+  emit_xor(rs1, SCR, rt);
+}
+
+static void emit_addimm(u_int rs, uintptr_t imm, u_int rt)
+{
+  if (imm == 0) {
+    emit_mov(rs, rt);
+    return;
+  }
+  if (is_imm12((int)imm))
+    emit_itype(RV_ADDIW, "addiw", rs, imm, rt);
+  else {
+    emit_movimm(imm, SCR);
+    emit_add(rs, SCR, rt);
+  }
+}
+
+static void emit_addimm64(u_int rs, uintptr_t imm, u_int rt)
+{
+  if (is_imm12(imm))
+    emit_itype(RV_ADDI, "addi", rs, imm, rt);
+  else {
+    emit_movimm64(imm, SCR);
+    emit_add64(rs, SCR, rt);
+  }
+}
+
+static void emit_addimm_ptr(u_int rs, uintptr_t imm, u_int rt)
+{
+  emit_addimm64(rs, imm, rt);
+}
+
+static void emit_addimm_and_set_flags(int imm, u_int rt)
+{
+  if (is_imm12(imm))
+    emit_itype(RV_ADDIW, "addiw", rt, imm, rt);
+  else {
+    emit_movimm(imm, SCR);
+    emit_add(rt, SCR, rt);
+  }
+  set_flags(FL_RES, rt, 0, 0);
+}
+
+static void emit_addimm_and_set_flags3(u_int rs, int imm, u_int rt)
+{
+  if (is_imm12(imm)) {
+    emit_itype(RV_ADDI, "addi", rs, imm, FLA);
+    emit_itype(RV_ADDIW, "addiw", rs, imm, rt);
+  }
+  else {
+    emit_movimm(imm, SCR);
+    emit_add64(rs, SCR, FLA);
+    emit_add(rs, SCR, rt);
+  }
+  set_flags(FL_OVF, rt, 0, 0);
+}
+
+static void emit_logicop_imm(u_int op, u_int rop, attr_unused const char *name,
+  u_int rs, u_int imm, u_int rt)
+{
+  if (is_imm12((int)imm))
+    emit_itype(op, name, rs, imm, rt);
+  else {
+    emit_movimm(imm, SCR);
+    emit_rtype(rop, name, rs, SCR, rt);
+  }
+}
+
+static void emit_andimm(u_int rs, u_int imm, u_int rt)
+{
+  if (imm == 0)
+    emit_zeroreg(rt);
+  else
+    emit_logicop_imm(RV_ANDI, RV_AND, "and", rs, imm, rt);
+}
+
+static void emit_orimm(u_int rs, u_int imm, u_int rt)
+{
+  if (imm == 0) {
+    if (rs != rt)
+      emit_mov(rs, rt);
+  }
+  else
+    emit_logicop_imm(RV_ORI, RV_OR, "or", rs, imm, rt);
+}
+
+static void emit_xorimm(u_int rs, u_int imm, u_int rt)
+{
+  if (imm == 0) {
+    if (rs != rt)
+      emit_mov(rs, rt);
+  }
+  else
+    emit_logicop_imm(RV_XORI, RV_XOR, "xor", rs, imm, rt);
+}
+
+// rt = cond ? rs : rt
+static void emit_cmov_reg(u_int cond, u_int rs, u_int rt)
+{
+  u_int r1, r2, br = emit_cond_setup(cond, &r1, &r2);
+  emit_bcc(br ^ 1, r1, r2, 8);
+  emit_mov(rs, rt);
+}
+
+static void emit_cmovne_reg(u_int rs,u_int rt)
+{
+  emit_cmov_reg(COND_NE, rs, rt);
+}
+
+static void emit_cmovl_reg(u_int rs,u_int rt)
+{
+  emit_cmov_reg(COND_LT, rs, rt);
+}
+
+static void emit_cmovb_reg(u_int rs,u_int rt)
+{
+  emit_cmov_reg(COND_CC, rs, rt);
+}
+
+static void emit_cmovs_reg(u_int rs,u_int rt)
+{
+  emit_cmov_reg(COND_MI, rs, rt);
+}
+
+static void emit_slti32(u_int rs,int imm,u_int rt)
+{
+  if (is_imm12(imm))
+    emit_itype(RV_SLTI, "slti", rs, imm, rt);
+  else {
+    emit_movimm(imm, SCR);
+    emit_rtype(RV_SLT, "slt", rs, SCR, rt);
+  }
+}
+
+// the sign extension keeps the unsigned order of 32bit values
+static void emit_sltiu32(u_int rs,int imm,u_int rt)
+{
+  if (is_imm12(imm))
+    emit_itype(RV_SLTIU, "sltiu", rs, imm, rt);
+  else {
+    emit_movimm(imm, SCR);
+    emit_rtype(RV_SLTU, "sltu", rs, SCR, rt);
+  }
+}
+
+static void emit_set_gz32(u_int rs, u_int rt)
+{
+  emit_rtype(RV_SLT, "sgtz", ZR, rs, rt);
+}
+
+static void emit_set_nz32(u_int rs, u_int rt)
+{
+  emit_rtype(RV_SLTU, "snez", ZR, rs, rt);
+}
+
+static void emit_set_if_less32(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_SLT, "slt", rs1, rs2, rt);
+}
+
+static void emit_set_if_carry32(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_SLTU, "sltu", rs1, rs2, rt);
+}
+
+static int can_jump_or_call(const void *a)
+{
+  intptr_t diff = (u_char *)a - out;
+  return (-2147483648l <= diff && diff < 2147479552l);
+}
+
+// beyond jal: auipc+jalr, using rt for the address
+static void emit_jalr_far(const void *a, u_int rd, u_int rt)
+{
+  u_int hi;
+  int lo;
+  split_hi_lo((u_char *)a - out, &hi, &lo);
+  emit_auipc(hi, rt);
+  emit_jalr(rd, lo, rt);
+}
+
+static void emit_call(const void *a)
+{
+  intptr_t diff = (u_char *)a - out;
+  assem_debug("call %p%s\n", log_addr(a), func_name(a));
+  assert(!(diff & 3));
+  if (-1048576 <= diff && diff < 1048576)
+    output_w32(RV_JAL | imm21_j(diff) | (rv_reg(LR) << 7));
+  else
+    emit_jalr_far(a, LR, LR);
+}
+
+// jal if it reaches, placeholders (a < 3) always get one
+static int jmp_size(const void *a, const u_char *from)
+{
+  intptr_t diff = (u_char *)a - from;
+  if ((uintptr_t)a < 3 || (-1048576 <= diff && diff < 1048576))
+    return 4;
+  return 8;
+}
+
+static void emit_jmp(const void *a)
+{
+  intptr_t diff = (u_char *)a - out;
+  assem_debug("j %p%s\n", log_addr(a), func_name(a));
+  if ((uintptr_t)a < 3) // a jump that will be patched later
+    output_w32(RV_JAL);
+  else if (jmp_size(a, out) == 4)
+    output_w32(RV_JAL | imm21_j(diff));
+  else {
+    if (!can_jump_or_call(a))
+      a = get_trampoline(a);
+    emit_jalr_far(a, ZR, SCR);
+  }
+}
+
+static void emit_jcc(u_int cond, const void *a)
+{
+  u_int r1, r2, br = emit_cond_setup(cond, &r1, &r2);
+  intptr_t diff = (u_char *)a - out;
+  assem_debug("b%s %p\n", condname[cond], log_addr(a));
+  if ((uintptr_t)a >= 3 && -4096 <= diff && diff < 4096)
+    emit_bcc(br, r1, r2, diff);
+  else {
+    if ((uintptr_t)a >= 3 && !can_jump_or_call(a))
+      a = get_trampoline(a);
+    emit_bcc(br ^ 1, r1, r2, 4 + jmp_size(a, out + 4));
+    emit_jmp(a);
+  }
+}
+
+static void emit_jne(const void *a)
+{
+  emit_jcc(COND_NE, a);
+}
+
+static void emit_jeq(const void *a)
+{
+  emit_jcc(COND_EQ, a);
+}
+
+static void emit_js(const void *a)
+{
+  emit_jcc(COND_MI, a);
+}
+
+static void emit_jns(const void *a)
+{
+  emit_jcc(COND_PL, a);
+}
+
+static void emit_jl(const void *a)
+{
+  emit_jcc(COND_LT, a);
+}
+
+static void emit_jge(const void *a)
+{
+  emit_jcc(COND_GE, a);
+}
+
+static void emit_jo(const void *a)
+{
+  emit_jcc(COND_VS, a);
+}
+
+static void emit_jno(const void *a)
+{
+  emit_jcc(COND_VC, a);
+}
+
+static void emit_jc(const void *a)
+{
+  emit_jcc(COND_CS, a);
+}
+
+static void *emit_cbz(u_int r, const void *a)
+{
+  void *ret = out;
+  set_flags(FL_RES, r, 0, 0);
+  emit_jcc(COND_EQ, a);
+  return ret;
+}
+
+static void emit_jmpreg(u_int r)
+{
+  emit_jalr(ZR, 0, r);
+}
+
+static void emit_ret(void)
+{
+  emit_jmpreg(LR);
+}
+
+// patched by set_jump_target
+static void emit_adr(void *addr, u_int rt)
+{
+  u_int hi;
+  int lo;
+  split_hi_lo((u_char *)addr - out, &hi, &lo);
+  emit_auipc(hi, rt);
+  emit_itype(RV_ADDI, "addi", rt, lo, rt);
+}
+
+// guest address accesses, the address is zero extended first
+static void emit_readword_indexed(int offset, u_int rs, u_int rt)
+{
+  emit_zext32(rs, rt);
+  emit_load(LS_W, rt, offset, rt);
+}
+
+static void emit_movsbl_indexed(int offset, u_int rs, u_int rt)
+{
+  emit_zext32(rs, rt);
+  emit_load(LS_B, rt, offset, rt);
+}
+
+static void emit_movswl_indexed(int offset, u_int rs, u_int rt)
+{
+  emit_zext32(rs, rt);
+  emit_load(LS_H, rt, offset, rt);
+}
+
+static void emit_movzbl_indexed(int offset, u_int rs, u_int rt)
+{
+  emit_zext32(rs, rt);
+  emit_load(LS_BU, rt, offset, rt);
+}
+
+static void emit_movzwl_indexed(int offset, u_int rs, u_int rt)
+{
+  emit_zext32(rs, rt);
+  emit_load(LS_HU, rt, offset, rt);
+}
+
+static void emit_writeword_indexed(u_int rt, int offset, u_int rs)
+{
+  emit_zext32(rs, SCR);
+  emit_store(LS_W, rt, offset, SCR);
+}
+
+static void emit_writehword_indexed(u_int rt, int offset, u_int rs)
+{
+  emit_zext32(rs, SCR);
+  emit_store(LS_H, rt, offset, SCR);
+}
+
+static void emit_writebyte_indexed(u_int rt, int offset, u_int rs)
+{
+  emit_zext32(rs, SCR);
+  emit_store(LS_B, rt, offset, SCR);
+}
+
+// rs1 is a host pointer, rs2 a guest address
+static void emit_ld_dualindexed(u_int size, u_int rs1, u_int rs2, u_int rt)
+{
+  u_int a = rt != rs1 ? rt : SCR;
+  emit_add_zext(rs1, rs2, a);
+  emit_load(size, rt, 0, a);
+}
+
+static void emit_st_dualindexed(u_int size, u_int rs1, u_int rs2, u_int rt)
+{
+  emit_add_zext(rs1, rs2, SCR);
+  emit_store(size, rt, 0, SCR);
+}
+
+static void emit_strb_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_st_dualindexed(LS_B, rs1, rs2, rt);
+}
+
+static void emit_strh_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_st_dualindexed(LS_H, rs1, rs2, rt);
+}
+
+static void emit_str_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_st_dualindexed(LS_W, rs1, rs2, rt);
+}
+
+static void emit_ldrb_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_ld_dualindexed(LS_BU, rs1, rs2, rt);
+}
+
+static void emit_ldrsb_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_ld_dualindexed(LS_B, rs1, rs2, rt);
+}
+
+static void emit_ldrh_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_ld_dualindexed(LS_HU, rs1, rs2, rt);
+}
+
+static void emit_ldrsh_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_ld_dualindexed(LS_H, rs1, rs2, rt);
+}
+
+static void emit_ldr_dualindexed(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_ld_dualindexed(LS_W, rs1, rs2, rt);
+}
+
+// rt = ((uintptr_t *)rs1)[(u32)rs2]
+static void emit_readdword_dualindexedx8(u_int rs1, u_int rs2, u_int rt)
+{
+  u_int a = rt != rs1 ? rt : SCR;
+#ifdef __riscv_zba
+  emit_rtype(RV_SH3ADDUW, "sh3add.uw", rs2, rs1, a);
+#else
+  emit_shlimm64(rs2, 32, a);
+  emit_shrimm64(a, 29, a);
+  emit_add64(a, rs1, a);
+#endif
+  emit_load(LS_D, rt, 0, a);
+}
+#define emit_readptr_dualindexedx_ptrlen emit_readdword_dualindexedx8
+
+static void emit_mul(u_int rs1, u_int rs2, u_int rt)
+{
+  emit_rtype(RV_MULW, "mulw", rs1, rs2, rt);
+}
+
+static void emit_clz(u_int rs, u_int rt)
+{
+#ifdef __riscv_zbb
+  assem_debug("clzw %s,%s\n", regname[rt], regname[rs]);
+  output_w32(RV_CLZW | imm12_rs1_rd(0, rs, rt));
+#else
+  // only MTC2 to LZCR needs this, so a plain loop
+  emit_shlimm64(rs, 32, SCR);
+  emit_movimm(32, rt);
+  emit_bcc(BR_EQ, SCR, ZR, 6*4);
+  emit_zeroreg(rt);
+  emit_bcc(BR_LT, SCR, ZR, 4*4);
+  emit_itype(RV_ADDI, "addi", rt, 1, rt);
+  emit_shlimm64(SCR, 1, SCR);
+  assem_debug("j .-12\n");
+  output_w32(RV_JAL | imm21_j(-3*4));
+#endif
+}
+
+// special case for checking invalid_code
+static void emit_ldrb_indexedsr12_reg(u_int rbase, u_int r, u_int rt)
+{
+  emit_shrimm(r, 12, rt);
+  emit_add64(rbase, rt, rt);
+  emit_load(LS_BU, rt, 0, rt);
+}
+
+// special for loadlr_assemble, rs2 is destroyed
+static void emit_bic_lsl(u_int rs1,u_int rs2,u_int shift,u_int rt)
+{
+  emit_shl(rs2, shift, rs2);
+  emit_bic(rs1, rs2, rt);
+}
+
+static void emit_bic_lsr(u_int rs1,u_int rs2,u_int shift,u_int rt)
+{
+  emit_shr(rs2, shift, rs2);
+  emit_bic(rs1, rs2, rt);
+}
+
+static void save_load_regs_all(int is_store, u_int reglist)
+{
+  int ofs = 0;
+  u_int r;
+  for (r = 0; reglist; r++, reglist >>= 1) {
+    if (!(reglist & 1))
+      continue;
+    if (is_store)
+      emit_store(LS_D, r, SSP_CALLEE_REGS + ofs, SP);
+    else
+      emit_load(LS_D, r, SSP_CALLEE_REGS + ofs, SP);
+    ofs += 8;
+  }
+  assert(ofs <= SSP_CALLER_REGS);
+}
+
+// Save registers before function call
+static void save_regs(u_int reglist)
+{
+  reglist &= CALLER_SAVE_REGS; // only save the caller-save registers
+  save_load_regs_all(1, reglist);
+}
+
+// Restore registers after function call
+static void restore_regs(u_int reglist)
+{
+  reglist &= CALLER_SAVE_REGS;
+  save_load_regs_all(0, reglist);
+}
+
+/* Stubs/epilogue */
+
+static void literal_pool(int n)
+{
+  (void)literals;
+}
+
+static void literal_pool_jumpover(int n)
+{
+}
+
+// parsed by find_extjump_insn, check_extjump2, set_jump_target_far1:
+//  +0  lui a0; addiw a0   target vaddr
+//  +8  auipc a1; addi a1  the jal to patch
+//  +16 auipc ra; jalr ra  dyna_linker, which finds the stub from ra
+//  +24 auipc t4; jr t4    far slot, for links jal can't reach
+static void emit_extjump(u_char *addr, u_int target)
+{
+  u_int hi = (target + 0x800) & 0xfffff000;
+  u_char *stub = out;
+  u_int *insn;
+
+  // the jal must point to the stub for set_jump_target_far1
+  set_jump_target(addr, out);
+  insn = find_jump_insn(addr);
+  assert((*(u_int *)NDRC_WRITE_OFFSET(insn) & 0xfff) == RV_JAL);
+
+  emit_lui(hi, 0);
+  emit_itype(RV_ADDIW, "addiw", 0, (int)(target - hi), 0);
+  emit_adr(insn, 1);
+  emit_jalr_far(can_jump_or_call(dyna_linker) ? (void *)dyna_linker
+    : get_trampoline(dyna_linker), LR, LR);
+  emit_jalr_far(stub, ZR, SCR);
+}
+
+static void check_extjump2(void *src)
+{
+  u_int *ptr = src;
+  assert((ptr[0] & 0xfff) == (RV_LUI | (10 << 7))); // lui a0, #val
+  (void)ptr;
+}
+
+// put rt_val into rt, potentially making use of rs with value rs_val
+static void emit_movimm_from(u_int rs_val, u_int rs, u_int rt_val, u_int rt)
+{
+  int diff = rt_val - rs_val;
+  if (is_imm12(diff))
+    emit_addimm(rs, diff, rt);
+  else if (is_imm12((int)(rs_val ^ rt_val)))
+    emit_xorimm(rs, rs_val ^ rt_val, rt);
+  else
+    emit_movimm(rt_val, rt);
+}
+
+// return 1 if the above function can do it's job cheaply
+static int is_similar_value(u_int v1, u_int v2)
+{
+  int diff = v1 - v2;
+  return is_imm12(diff) || is_imm12((int)(v1 ^ v2));
+}
+
+static void emit_movimm_from64(u_int rs_val, u_int rs, uintptr_t rt_val, u_int rt)
+{
+  intptr_t diff = rt_val - (uintptr_t)rs_val;
+  if (rt_val < 0x80000000ull) {
+    emit_movimm_from(rs_val, rs, rt_val, rt);
+    return;
+  }
+  // directly mapped RAM is at 0x80000000, just past what a sign
+  // extended 32bit value can reach
+  if (is_imm12(diff)) {
+    emit_zext32(rs, rt);
+    if (diff)
+      emit_addimm64(rt, diff, rt);
+    return;
+  }
+  emit_movptr(rt_val, rt);
+}
+
+// trashes a2
+static void pass_args64(u_int a0, u_int a1)
+{
+  if(a0==1&&a1==0) {
+    // must swap
+    emit_mov64(a0,2); emit_mov64(a1,1); emit_mov64(2,0);
+  }
+  else if(a0!=0&&a1==0) {
+    emit_mov64(a1,1);
+    if (a0>=0) emit_mov64(a0,0);
+  }
+  else {
+    if(a0>=0&&a0!=0) emit_mov64(a0,0);
+    if(a1>=0&&a1!=1) emit_mov64(a1,1);
+  }
+}
+
+static void loadstore_extend(enum stub_type type, u_int rs, u_int rt)
+{
+  switch(type) {
+    case LOADB_STUB:
+      emit_shlimm64(rs, 56, rt);
+      emit_itype(RV_SRAI, "srai", rt, 56, rt);
+      break;
+    case LOADBU_STUB:
+    case STOREB_STUB:
+      emit_itype(RV_ANDI, "andi", rs, 0xff, rt);
+      break;
+    case LOADH_STUB:
+      emit_signextend16(rs, rt);
+      break;
+    case LOADHU_STUB:
+    case STOREH_STUB:
+      emit_shlimm64(rs, 48, rt);
+      emit_shrimm64(rt, 48, rt);
+      break;
+    case LOADW_STUB:
+    case STOREW_STUB:
+      if (rs != rt) emit_mov(rs, rt);
+      break;
+    default:
+      assert(0);
+  }
+}
+
+#include "pcsxmem.h"
+//#include "pcsxmem_inline.c"
+
+// mem_rtab/mem_wtab lookup: temp2 = shifted entry, branch if it's a handler
+static void *emit_memtab_lookup(void *tab, u_int rs, u_int temp, u_int temp2)
+{
+  void *handler_jump;
+  emit_readptr(tab, temp);
+  emit_shrimm(rs, 12, temp2);
+  emit_readdword_dualindexedx8(temp, temp2, temp2);
+  set_flags(FL_RES, temp2, 0, 0);
+  handler_jump = out;
+  emit_js(0);
+  emit_shlimm64(temp2, 1, temp2);
+  return handler_jump;
+}
+
+static void do_readstub(int n)
+{
+  assem_debug("do_readstub %x\n",start+stubs[n].a*4);
+  set_jump_target(stubs[n].addr, out);
+  enum stub_type type = stubs[n].type;
+  int i = stubs[n].a;
+  int rs = stubs[n].b;
+  const struct regstat *i_regs = (void *)stubs[n].c;
+  int adj = (int)stubs[n].d;
+  u_int reglist = stubs[n].e;
+  const signed char *i_regmap = i_regs->regmap;
+  int rt;
+  if(dops[i].itype==C2LS||dops[i].itype==LOADLR) {
+    rt=get_reg(i_regmap,FTEMP);
+  }else{
+    rt=get_reg(i_regmap,dops[i].rt1);
+  }
+  assert(rs>=0);
+  int r,temp=-1,temp2=HOST_TEMPREG,regs_saved=0;
+  void *restore_jump = NULL, *handler_jump = NULL;
+  reglist|=(1<<rs);
+  for (r = 0; r < HOST_CCREG; r++) {
+    if (r != EXCLUDE_REG && ((1 << r) & reglist) == 0) {
+      temp = r;
+      break;
+    }
+  }
+  if(rt>=0&&dops[i].rt1!=0)
+    reglist&=~(1<<rt);
+  if(temp==-1) {
+    save_regs(reglist);
+    regs_saved=1;
+    temp=(rs==0)?2:0;
+  }
+  if((regs_saved||(reglist&2)==0)&&temp!=1&&rs!=1)
+    temp2=1;
+  handler_jump = emit_memtab_lookup(&mem_rtab, rs, temp, temp2);
+  if(dops[i].itype==C2LS||(rt>=0&&dops[i].rt1!=0)) {
+    switch(type) {
+      case LOADB_STUB:  emit_ldrsb_dualindexed(temp2,rs,rt); break;
+      case LOADBU_STUB: emit_ldrb_dualindexed(temp2,rs,rt); break;
+      case LOADH_STUB:  emit_ldrsh_dualindexed(temp2,rs,rt); break;
+      case LOADHU_STUB: emit_ldrh_dualindexed(temp2,rs,rt); break;
+      case LOADW_STUB:  emit_ldr_dualindexed(temp2,rs,rt); break;
+      default:          assert(0);
+    }
+  }
+  if(regs_saved) {
+    restore_jump=out;
+    emit_jmp(0); // jump to reg restore
+  }
+  else
+    emit_jmp(stubs[n].retaddr); // return address
+  set_jump_target(handler_jump, out);
+  emit_shlimm64(temp2, 1, temp2);
+
+  if(!regs_saved)
+    save_regs(reglist);
+  void *handler=NULL;
+  if(type==LOADB_STUB||type==LOADBU_STUB)
+    handler=jump_handler_read8;
+  if(type==LOADH_STUB||type==LOADHU_STUB)
+    handler=jump_handler_read16;
+  if(type==LOADW_STUB)
+    handler=jump_handler_read32;
+  assert(handler);
+  pass_args64(rs,temp2);
+  int cc, cc_use;
+  cc = cc_use = get_reg(i_regmap, CCREG);
+  if (cc < 0)
+    emit_loadreg(CCREG, (cc_use = 2));
+  emit_addimm(cc_use, adj, 2);
+
+  emit_far_call(handler);
+
+  if(dops[i].itype==C2LS||(rt>=0&&dops[i].rt1!=0)) {
+    loadstore_extend(type,0,rt);
+  }
+  if(restore_jump)
+    set_jump_target(restore_jump, out);
+  restore_regs(reglist);
+  emit_jmp(stubs[n].retaddr);
+}
+
+static void inline_readstub(enum stub_type type, int i, u_int addr,
+  const signed char regmap[], int target, int adj, u_int reglist)
+{
+  int ra = cinfo[i].addr;
+  int rt = get_reg(regmap, target);
+  assert(ra >= 0);
+  u_int is_dynamic=0;
+  uintptr_t host_addr = 0;
+  void *handler;
+  int cc, cc_use;
+  cc = cc_use = get_reg(regmap, CCREG);
+  handler = get_direct_memhandler(mem_rtab, addr, type, &host_addr);
+  if (handler == NULL) {
+    static const u_char sizes[] = {
+      [LOADB_STUB] = LS_B, [LOADBU_STUB] = LS_BU, [LOADH_STUB] = LS_H,
+      [LOADHU_STUB] = LS_HU, [LOADW_STUB] = LS_W,
+    };
+    if(rt<0||dops[i].rt1==0)
+      return;
+    assert(type == LOADB_STUB || type == LOADBU_STUB || type == LOADH_STUB
+        || type == LOADHU_STUB || type == LOADW_STUB);
+    // ra becomes a host pointer here, not zero extended again
+    if (addr != host_addr)
+      emit_movimm_from64(addr, ra, host_addr, ra);
+    else
+      emit_zext32(ra, ra);
+    emit_load(sizes[type], rt, 0, ra);
+    return;
+  }
+  is_dynamic = pcsxmem_is_handler_dynamic(addr);
+  if (is_dynamic) {
+    if(type==LOADB_STUB||type==LOADBU_STUB)
+      handler=jump_handler_read8;
+    if(type==LOADH_STUB||type==LOADHU_STUB)
+      handler=jump_handler_read16;
+    if(type==LOADW_STUB)
+      handler=jump_handler_read32;
+  }
+
+  // call a memhandler
+  if(rt>=0&&dops[i].rt1!=0)
+    reglist&=~(1<<rt);
+  save_regs(reglist);
+  if(target==0)
+    emit_movimm(addr,0);
+  else if(ra!=0)
+    emit_mov(ra,0);
+  if (cc < 0)
+    emit_loadreg(CCREG, (cc_use = 2));
+  emit_addimm(cc_use, adj, 2);
+  if(is_dynamic) {
+    uintptr_t l1 = ((uintptr_t *)mem_rtab)[addr>>12] << 1;
+    emit_movptr(l1, 1);
+  }
+  else
+    emit_far_call(do_memhandler_pre);
+
+  emit_far_call(handler);
+
+  if(rt>=0&&dops[i].rt1!=0)
+    loadstore_extend(type, 0, rt);
+  restore_regs(reglist);
+}
+
+static void do_writestub(int n)
+{
+  assem_debug("do_writestub %x\n",start+stubs[n].a*4);
+  set_jump_target(stubs[n].addr, out);
+  enum stub_type type=stubs[n].type;
+  int i=stubs[n].a;
+  int rs=stubs[n].b;
+  struct regstat *i_regs=(struct regstat *)stubs[n].c;
+  int adj = (int)stubs[n].d;
+  u_int reglist=stubs[n].e;
+  signed char *i_regmap=i_regs->regmap;
+  int rt,r;
+  if(dops[i].itype==C2LS) {
+    rt=get_reg(i_regmap,r=FTEMP);
+  }else{
+    rt=get_reg(i_regmap,r=dops[i].rs2);
+  }
+  assert(rs>=0);
+  assert(rt>=0);
+  int rtmp,temp=-1,temp2,regs_saved=0;
+  void *restore_jump = NULL, *handler_jump = NULL;
+  int reglist2=reglist|(1<<rs)|(1<<rt);
+  for (rtmp = 0; rtmp < HOST_CCREG; rtmp++) {
+    if (rtmp != EXCLUDE_REG && ((1 << rtmp) & reglist) == 0) {
+      temp = rtmp;
+      break;
+    }
+  }
+  if(temp==-1) {
+    save_regs(reglist);
+    regs_saved=1;
+    for(rtmp=0;rtmp<=3;rtmp++)
+      if(rtmp!=rs&&rtmp!=rt)
+        {temp=rtmp;break;}
+  }
+  if((regs_saved||(reglist2&8)==0)&&temp!=3&&rs!=3&&rt!=3)
+    temp2=3;
+  else {
+    host_tempreg_acquire();
+    temp2=HOST_TEMPREG;
+  }
+  handler_jump = emit_memtab_lookup(&mem_wtab, rs, temp, temp2);
+  switch(type) {
+    case STOREB_STUB: emit_strb_dualindexed(temp2,rs,rt); break;
+    case STOREH_STUB: emit_strh_dualindexed(temp2,rs,rt); break;
+    case STOREW_STUB: emit_str_dualindexed(temp2,rs,rt); break;
+    default:          assert(0);
+  }
+  if(regs_saved) {
+    restore_jump=out;
+    emit_jmp(0); // jump to reg restore
+  }
+  else
+    emit_jmp(stubs[n].retaddr); // return address (invcode check)
+  set_jump_target(handler_jump, out);
+  emit_shlimm64(temp2, 1, temp2);
+
+  if(!regs_saved)
+    save_regs(reglist);
+  void *handler=NULL;
+  switch(type) {
+    case STOREB_STUB: handler=jump_handler_write8; break;
+    case STOREH_STUB: handler=jump_handler_write16; break;
+    case STOREW_STUB: handler=jump_handler_write32; break;
+    default:          assert(0);
+  }
+  assert(handler);
+  pass_args(rs,rt);
+  if(temp2!=3) {
+    emit_mov64(temp2,3);
+    host_tempreg_release();
+  }
+  int cc, cc_use;
+  cc = cc_use = get_reg(i_regmap, CCREG);
+  if (cc < 0)
+    emit_loadreg(CCREG, (cc_use = 2));
+  emit_addimm(cc_use, adj, 2);
+
+  emit_far_call(handler);
+
+  // new cycle_count returned in a2
+  emit_addimm(2, -adj, cc_use);
+  if (cc < 0)
+    emit_storereg(CCREG, cc_use);
+  if (restore_jump)
+    set_jump_target(restore_jump, out);
+  restore_regs(reglist);
+  emit_jmp(stubs[n].retaddr);
+}
+
+static void inline_writestub(enum stub_type type, int i, u_int addr,
+  const signed char regmap[], int target, int adj, u_int reglist)
+{
+  int ra = cinfo[i].addr;
+  int rt = get_reg(regmap,target);
+  assert(ra >= 0);
+  assert(rt >= 0);
+  uintptr_t host_addr = 0;
+  void *handler = get_direct_memhandler(mem_wtab, addr, type, &host_addr);
+  if (handler == NULL) {
+    if (addr != host_addr)
+      emit_movimm_from64(addr, ra, host_addr, ra);
+    else
+      emit_zext32(ra, ra);
+    switch (type) {
+      case STOREB_STUB: emit_store(LS_B, rt, 0, ra); break;
+      case STOREH_STUB: emit_store(LS_H, rt, 0, ra); break;
+      case STOREW_STUB: emit_store(LS_W, rt, 0, ra); break;
+      default:          assert(0);
+    }
+    return;
+  }
+
+  // call a memhandler
+  save_regs(reglist);
+  emit_writeword(ra, &address); // some handlers still need it
+  loadstore_extend(type, rt, 0);
+  int cc, cc_use;
+  cc = cc_use = get_reg(regmap, CCREG);
+  if (cc < 0)
+    emit_loadreg(CCREG, (cc_use = 2));
+  emit_addimm(cc_use, adj, 2);
+
+  emit_far_call(do_memhandler_pre);
+  emit_far_call(handler);
+  emit_far_call(do_memhandler_post);
+  emit_addimm(2, -adj, cc_use);
+  if (cc < 0)
+    emit_storereg(CCREG, cc_use);
+  restore_regs(reglist);
+}
+
+/* Special assem */
+
+static void c2op_prologue(u_int op, int i, const struct regstat *i_regs, u_int reglist)
+{
+  save_load_regs_all(1, reglist);
+  cop2_do_stall_check(op, i, i_regs, 0);
+#ifdef PCNT
+  emit_movimm(op, 0);
+  emit_far_call(pcnt_gte_start);
+#endif
+  // pointer to cop2 regs
+  emit_addimm64(FP, (u_char *)&psxRegs.CP2D.r[0] - (u_char *)&dynarec_local, 0);
+}
+
+static void c2op_epilogue(u_int op,u_int reglist)
+{
+#ifdef PCNT
+  emit_movimm(op, 0);
+  emit_far_call(pcnt_gte_end);
+#endif
+  save_load_regs_all(0, reglist);
+}
+
+// offsets from the cop2 regs pointer
+#define CP2D_OFS(r) ((r) * 4)
+#define CP2C_OFS(r) ((32 + (r)) * 4)
+
+// flagless NCLIP/AVSZ3/AVSZ4 emitted in place, only a0-a5 are used so
+// only those have to be saved; same results as the gte_nf.c versions
+static void c2op_assemble_inline(u_int op, int i, const struct regstat *i_regs,
+  u_int reglist)
+{
+  reglist &= 0x3f;
+  save_load_regs_all(1, reglist);
+  cop2_do_stall_check(op, i, i_regs, ~0x3fu);
+  emit_addimm64(FP, (u_char *)&psxRegs.CP2D.r[0] - (u_char *)&dynarec_local, 0);
+  switch (op) {
+    case GTE_NCLIP:
+      // MAC0 = SX0*(SY1-SY2) + SX1*(SY2-SY0) + SX2*(SY0-SY1), low 32 bits
+      emit_load(LS_H, 1, CP2D_OFS(12), 0);     // SX0
+      emit_load(LS_H, 2, CP2D_OFS(13) + 2, 0); // SY1
+      emit_load(LS_H, 3, CP2D_OFS(14) + 2, 0); // SY2
+      emit_sub(2, 3, 4);
+      emit_mul(1, 4, 5);
+      emit_load(LS_H, 1, CP2D_OFS(13), 0);     // SX1
+      emit_load(LS_H, 4, CP2D_OFS(12) + 2, 0); // SY0
+      emit_sub(3, 4, 3);
+      emit_mul(1, 3, 3);
+      emit_add(5, 3, 5);
+      emit_load(LS_H, 1, CP2D_OFS(14), 0);     // SX2
+      emit_sub(4, 2, 4);
+      emit_mul(1, 4, 4);
+      emit_add(5, 4, 5);
+      emit_store(LS_W, 5, CP2D_OFS(24), 0);    // MAC0
+      break;
+    case GTE_AVSZ3:
+    case GTE_AVSZ4:
+      // MAC0 = ZSF * (sum of SZ), OTZ = clamp(MAC0 >> 12, 0, 0xffff)
+      emit_load(LS_HU, 1, CP2D_OFS(17), 0);
+      emit_load(LS_HU, 2, CP2D_OFS(18), 0);
+      emit_add(1, 2, 1);
+      emit_load(LS_HU, 2, CP2D_OFS(19), 0);
+      emit_add(1, 2, 1);
+      if (op == GTE_AVSZ4) {
+        emit_load(LS_HU, 2, CP2D_OFS(16), 0);
+        emit_add(1, 2, 1);
+        emit_load(LS_H, 2, CP2C_OFS(30), 0);   // ZSF4
+      }
+      else
+        emit_load(LS_H, 2, CP2C_OFS(29), 0);   // ZSF3
+      emit_mul(1, 2, 3);
+      emit_store(LS_W, 3, CP2D_OFS(24), 0);    // MAC0
+      emit_sarimm(3, 12, 3);
+      emit_bcc(BR_GE, 3, ZR, 8);
+      emit_zeroreg(3);                         // < 0 -> 0
+      emit_lui(0x10000, 4);
+      emit_bcc(BR_LT, 3, 4, 8);
+      emit_movimm(~0, 3);                      // > 0xffff -> ~0
+      emit_store(LS_H, 3, CP2D_OFS(7), 0);     // OTZ
+      break;
+    default:
+      assert(0);
+  }
+  emit_store(LS_W, ZR, CP2C_OFS(31), 0);       // FLAG
+  save_load_regs_all(0, reglist);
+}
+
+static void c2op_assemble(int i, const struct regstat *i_regs)
+{
+  u_int c2op=source[i]&0x3f;
+  u_int hr,reglist_full=0,reglist;
+  int need_flags,need_ir;
+  for(hr=0;hr<HOST_REGS;hr++) {
+    if(i_regs->regmap[hr]>=0) reglist_full|=1<<hr;
+  }
+  reglist=reglist_full&CALLER_SAVE_REGS;
+
+  if (gte_handlers[c2op]!=NULL) {
+    need_flags=!(gte_unneeded[i+1]>>63); // +1 because of how liveness detection works
+    need_ir=(gte_unneeded[i+1]&0xe00)!=0xe00;
+    assem_debug("gte op %08x, unneeded %016lx, need_flags %d, need_ir %d\n",
+      source[i],gte_unneeded[i+1],need_flags,need_ir);
+    if(HACK_ENABLED(NDHACK_GTE_NO_FLAGS))
+      need_flags=0;
+    switch(c2op) {
+#if !defined(DRC_DBG) && !defined(PCNT)
+      case GTE_NCLIP:
+      case GTE_AVSZ3:
+      case GTE_AVSZ4:
+        if (!need_flags) {
+          c2op_assemble_inline(c2op, i, i_regs, reglist);
+          return;
+        }
+        // fallthrough
+#endif
+      default:
+        (void)need_ir;
+        c2op_prologue(c2op, i, i_regs, reglist);
+        emit_movimm(source[i],1); // opcode
+        emit_writeword(1,&psxRegs.code);
+        emit_far_call(need_flags?gte_handlers[c2op]:gte_handlers_nf[c2op]);
+        break;
+    }
+    c2op_epilogue(c2op,reglist);
+  }
+}
+
+static void c2op_ctc2_31_assemble(signed char sl, signed char temp)
+{
+  //value = value & 0x7ffff000;
+  //if (value & 0x7f87e000) value |= 0x80000000;
+  emit_movimm(0x7f87e000, SCR);
+  emit_and(sl, SCR, SCR);
+  emit_andimm(sl, 0x7ffff000, temp);
+  emit_bcc(BR_EQ, SCR, ZR, 12);
+  emit_lui(0x80000000, SCR);
+  emit_or(temp, SCR, temp);
+}
+
+// IR copr saturated to 0..0xf80, >> 7
+static void do_mfc2_31_one(u_int copr,signed char temp)
+{
+  emit_readshword(&reg_cop2d[copr],temp);
+  emit_bcc(BR_GE, temp, ZR, 8);
+  emit_zeroreg(temp);
+  emit_sarimm(temp, 7, temp);
+  emit_sltiu32(temp, 0x20, SCR);
+  emit_bcc(BR_NE, SCR, ZR, 8);
+  emit_movimm(0x1f, temp);
+}
+
+static void c2op_mfc2_29_assemble(signed char tl, signed char temp)
+{
+  if (temp < 0) {
+    host_tempreg_acquire();
+    temp = HOST_TEMPREG;
+  }
+  do_mfc2_31_one(9,temp);
+  emit_mov(temp,tl);
+  do_mfc2_31_one(10,temp);
+  emit_shlimm(temp,5,temp);
+  emit_or(tl,temp,tl);
+  do_mfc2_31_one(11,temp);
+  emit_shlimm(temp,10,temp);
+  emit_or(tl,temp,tl);
+  emit_writeword(tl,&reg_cop2d[29]);
+
+  if (temp == HOST_TEMPREG)
+    host_tempreg_release();
+}
+
+// lr = n < 0 ? 1 : -1, the DIV by 0 quotient
+static void emit_div0_quotient(u_int n, u_int lr)
+{
+  emit_rtype(RV_SLT, "sltz", n, ZR, lr);
+  emit_shlimm(lr, 1, lr);
+  emit_itype(RV_ADDIW, "addiw", lr, -1, lr);
+}
+
+static void multdiv_assemble_rv64(int i, const struct regstat *i_regs)
+{
+  //  case 0x18: MULT
+  //  case 0x19: MULTU
+  //  case 0x1A: DIV
+  //  case 0x1B: DIVU
+  if(dops[i].rs1&&dops[i].rs2)
+  {
+    switch(dops[i].opcode2)
+    {
+    case 0x18: // MULT
+    case 0x19: // MULTU
+      {
+        signed char m1=get_reg(i_regs->regmap,dops[i].rs1);
+        signed char m2=get_reg(i_regs->regmap,dops[i].rs2);
+        signed char hi=get_reg(i_regs->regmap,HIREG);
+        signed char lo=get_reg(i_regs->regmap,LOREG);
+        assert(m1>=0);
+        assert(m2>=0);
+        assert(hi>=0);
+        assert(lo>=0);
+
+        if(dops[i].opcode2==0x18) // MULT
+          emit_rtype(RV_MUL, "mul", m1, m2, hi);
+        else {                    // MULTU
+          // the high half of (m1 << 32) * (m2 << 32) is the u32 product
+          emit_shlimm64(m1, 32, SCR);
+          emit_shlimm64(m2, 32, hi);
+          emit_rtype(RV_MULHU, "mulhu", SCR, hi, hi);
+        }
+
+        emit_itype(RV_ADDIW, "sext.w", hi, 0, lo);
+        emit_itype(RV_SRAI, "srai", hi, 32, hi);
+        break;
+      }
+    case 0x1A: // DIV
+    case 0x1B: // DIVU
+      {
+        signed char numerator=get_reg(i_regs->regmap,dops[i].rs1);
+        signed char denominator=get_reg(i_regs->regmap,dops[i].rs2);
+        signed char quotient=get_reg(i_regs->regmap,LOREG);
+        signed char remainder=get_reg(i_regs->regmap,HIREG);
+        assert(numerator>=0);
+        assert(denominator>=0);
+        assert(quotient>=0);
+        assert(remainder>=0);
+
+        // rv div 0 results are -1 and the numerator, like on the psx
+        // except the negative numerator DIV quotient
+        if (dops[i].opcode2 == 0x1A) { // DIV
+          emit_rtype(RV_DIVW, "divw", numerator, denominator, quotient);
+          emit_rtype(RV_REMW, "remw", numerator, denominator, remainder);
+          emit_bcc(BR_NE, denominator, ZR, 4*4);
+          emit_div0_quotient(numerator, quotient);
+        }
+        else {                         // DIVU
+          emit_rtype(RV_DIVUW, "divuw", numerator, denominator, quotient);
+          emit_rtype(RV_REMUW, "remuw", numerator, denominator, remainder);
+        }
+        break;
+      }
+    default:
+      assert(0);
+    }
+  }
+  else
+  {
+    signed char hr=get_reg(i_regs->regmap,HIREG);
+    signed char lr=get_reg(i_regs->regmap,LOREG);
+    if ((dops[i].opcode2==0x1A || dops[i].opcode2==0x1B) && dops[i].rs2==0) // div 0
+    {
+      if (dops[i].rs1) {
+        signed char numerator = get_reg(i_regs->regmap, dops[i].rs1);
+        assert(numerator >= 0);
+        if (hr >= 0)
+          emit_mov(numerator,hr);
+        if (lr >= 0) {
+          if (dops[i].opcode2 == 0x1A) // DIV
+            emit_div0_quotient(numerator, lr);
+          else
+            emit_movimm(~0,lr);
+        }
+      }
+      else {
+        if (hr >= 0) emit_zeroreg(hr);
+        if (lr >= 0) emit_movimm(~0,lr);
+      }
+    }
+    else if ((dops[i].opcode2==0x1A || dops[i].opcode2==0x1B) && dops[i].rs1==0)
+    {
+      signed char denominator = get_reg(i_regs->regmap, dops[i].rs2);
+      assert(denominator >= 0);
+      if (hr >= 0) emit_zeroreg(hr);
+      if (lr >= 0) {
+        emit_itype(RV_SLTIU, "seqz", denominator, 1, lr);
+        emit_neg(lr, lr);
+      }
+    }
+    else
+    {
+      // Multiply by zero is zero.
+      if (hr >= 0) emit_zeroreg(hr);
+      if (lr >= 0) emit_zeroreg(lr);
+    }
+  }
+}
+#define multdiv_assemble multdiv_assemble_rv64
+
+static void do_jump_vaddr(u_int rs)
+{
+  if (rs != 0)
+    emit_mov(rs, 0);
+  emit_readptr(&hash_table_ptr, 1);
+  emit_far_call(ndrc_get_addr_ht);
+  emit_jmpreg(0);
+}
+
+static void do_preload_rhash(u_int r) {
+  // Don't need this for ARM.  On x86, this puts the value 0xf8 into the
+  // register.  On ARM the hash can be done with a single instruction (below)
+}
+
+static void do_preload_rhtbl(u_int ht) {
+  emit_addimm64(FP, (u_char *)&mini_ht - (u_char *)&dynarec_local, ht);
+}
+
+static void do_rhash(u_int rs,u_int rh) {
+  emit_andimm(rs, 0xf8, rh);
+}
+
+static void do_miniht_load(int ht, u_int rh) {
+  emit_add64(ht, rh, ht);
+  emit_load(LS_W, rh, 0, ht);
+}
+
+static void do_miniht_jump(u_int rs, u_int rh, u_int ht) {
+  emit_cmp(rh, rs);
+  void *jaddr = out;
+  emit_jeq(0);
+  do_jump_vaddr(rs);
+
+  set_jump_target(jaddr, out);
+  emit_load(LS_D, ht, 8, ht);
+  emit_jmpreg(ht);
+}
+
+// the auipc+addi is patched by set_jump_target
+static void do_miniht_insert(u_int return_address,u_int rt,int temp) {
+  emit_movimm(return_address,rt);
+  add_to_linker(out,return_address,1);
+  emit_adr(out,temp);
+  emit_writedword(temp,&mini_ht[(return_address&0xFF)>>3][1]);
+  emit_writeword(rt,&mini_ht[(return_address&0xFF)>>3][0]);
+}
+
+// for the block profiler, only used at block entry where a0/a1 are free
+static void emit_inc_counter(u_int *counter)
+{
+  emit_movptr((uintptr_t)counter, 0);
+  emit_load(LS_W, 1, 0, 0);
+  emit_itype(RV_ADDIW, "addiw", 1, 1, 1);
+  emit_store(LS_W, 1, 0, 0);
+}
+
+// CPU-architecture-specific initialization
+static void arch_init(void)
+{
+  struct tramp_insns *ops = NDRC_WRITE_OFFSET(ndrc->tramp.ops);
+  size_t i;
+  assert(ARRAY_SIZE(ndrc->tramp.ops) <= ARRAY_SIZE(ndrc->tramp.f));
+  start_tcache_write(ops, (u_char *)ops + sizeof(ndrc->tramp.ops));
+  for (i = 0; i < ARRAY_SIZE(ndrc->tramp.ops); i++) {
+    intptr_t diff = (u_char *)&ndrc->tramp.f[i] - (u_char *)&ndrc->tramp.ops[i];
+    u_int hi;
+    int lo;
+    split_hi_lo(diff, &hi, &lo);
+    ops[i].auipc = RV_AUIPC | hi | (rv_reg(SCR) << 7);          // auipc t4, %hi(f[i])
+    ops[i].ld = RV_LOAD | (LS_D << 12) | imm12_rs1_rd(lo, SCR, SCR); // ld t4, %lo(f[i])(t4)
+    ops[i].jr = RV_JALR | imm12_rs1_rd(0, SCR, ZR);             // jr t4
+    ops[i].pad = 0;
+  }
+  end_tcache_write(ops, (u_char *)ops + sizeof(ndrc->tramp.ops));
+}
+
+// vim:shiftwidth=2:expandtab
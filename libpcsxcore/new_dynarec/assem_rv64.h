@@ -0,0 +1,65 @@
+#define HOST_IMM8 1
+
+/* calling convention:
+   a0-a7, t0-t6: caller-save
+   s0-s11      : callee-save
+   gp, tp      : not touched
+
+   host register numbers used by the recompiler are not the hardware
+   ones, rv_regs[] in assem_rv64.c maps them:
+   0-7: a0-a7, 8-11: t0-t3, 12: s1, 13-22: s2-s11, 23: s0 (FP),
+   24: ra, 25-27: t4-t6, 28: sp, 29: zero */
+
+#define HOST_REGS 23
+#define EXCLUDE_REG -1
+
+#define ZR 29
+#define SP 28
+
+// backend scratch, never allocated: SCR for long jumps, address
+// calculation and immediates, FLA/FLB hold the emulated flag state
+#define FLB 27
+#define FLA 26
+#define SCR 25
+
+#define LR 24
+#define HOST_TEMPREG LR
+
+// Note: FP is set to &dynarec_local when executing generated code.
+// Thus the local variables are actually global and not on the stack.
+#define FP 23
+#define rFP s0
+
+#define HOST_CCREG 22
+#define rCC s11
+
+#define CALLER_SAVE_REGS 0x00000fff
+#define PREFERRED_REG_FIRST 12
+#define PREFERRED_REG_LAST  21
+
+#define DRC_DBG_REGMASK 3 // others done by do_insn_cmp_rv64
+#define do_insn_cmp do_insn_cmp_rv64
+
+// stack space
+#define SSP_CALLEE_REGS (8*14) // new_dyna_start caller's
+#define SSP_CALLER_REGS (8*14) // a0-a7, t0-t3, ra for do_insn_cmp_rv64, pad
+#define SSP_ALL (SSP_CALLEE_REGS+SSP_CALLER_REGS)
+
+#define TARGET_SIZE_2 24 // 2^24 = 16 megabytes
+
+#ifndef __ASSEMBLER__
+
+extern char *invc_ptr;
+
+struct tramp_insns
+{
+  u_int auipc;
+  u_int ld;
+  u_int jr;
+  u_int pad;
+};
+
+void do_memhandler_pre();
+void do_memhandler_post();
+
+#endif // !__ASSEMBLY__
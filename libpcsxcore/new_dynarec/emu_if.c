@@ -24,6 +24,7 @@
 #include "../gte.h"
 #if defined(NDRC_THREAD) && !defined(DRC_DISABLE) && !defined(LIGHTREC)
 #include "../../frontend/pcsxr-threads.h"
+#include "../../include/thread_wakeups.h"
 #include "features/features_cpu.h"
 #include "retro_timers.h"
 #endif
@@ -91,11 +92,62 @@ void ndrc_clear_full(void)
 	new_dynarec_clear_full();
 }
 
+#define NDRC_CACHE_MAX_BLOCKS (1024 * 16)
+static const char ndrc_cache_header[8] = "ndrcch1";
+
+void ndrc_cache_save(const char *fname)
+{
+	int32_t size;
+	void *buf;
+	FILE *f;
+
+	ari64_thread_sync();
+	buf = malloc(NDRC_CACHE_MAX_BLOCKS * 16);
+	if (buf == NULL)
+		return;
+	size = new_dynarec_save_cache(buf, NDRC_CACHE_MAX_BLOCKS * 16);
+	if (size > 0 && (f = fopen(fname, "wb"))) {
+		fwrite(ndrc_cache_header, 1, sizeof(ndrc_cache_header), f);
+		fwrite(&size, 1, sizeof(size), f);
+		fwrite(buf, 1, size, f);
+		fclose(f);
+	}
+	free(buf);
+	// this list belongs to the game that's being closed
+	new_dynarec_load_cache(NULL, 0);
+}
+
+void ndrc_cache_load(const char *fname)
+{
+	char header[8];
+	int32_t size = 0;
+	void *buf = NULL;
+	FILE *f;
+
+	ari64_thread_sync();
+	f = fopen(fname, "rb");
+	if (f == NULL)
+		goto out;
+	if (fread(header, 1, sizeof(header), f) != sizeof(header)
+	    || memcmp(header, ndrc_cache_header, sizeof(header))
+	    || fread(&size, 1, sizeof(size), f) != sizeof(size)
+	    || size <= 0 || size > NDRC_CACHE_MAX_BLOCKS * 16
+	    || (buf = malloc(size)) == NULL
+	    || fread(buf, 1, size, f) != size)
+		size = 0;
+	fclose(f);
+out:
+	new_dynarec_load_cache(buf, size);
+	free(buf);
+}
+
 #if !defined(DRC_DISABLE) && !defined(LIGHTREC)
 #include "linkage_offsets.h"
 
 static void ari64_thread_init(void);
 static int  ari64_thread_check_range(unsigned int start, unsigned int end);
+static void ari64_interpret_cold(struct psxRegisters *regs,
+	enum blockExecCaller block_caller);
 
 void pcsx_mtc0(psxRegisters *regs, u32 reg, u32 val)
 {
@@ -229,6 +281,7 @@ static void ari64_execute_until(psxRegisters *regs)
 	evprintf("+exec %08x, %u->%u (%d)\n", regs->pc, regs->cycle,
 		regs->next_interupt, regs->next_interupt - regs->cycle);
 
+	new_dynarec_sync_point();
 	new_dyna_start(drc_local);
 
 	evprintf("-exec %08x, %u->%u (%d) stop %d \n", regs->pc, regs->cycle,
@@ -241,6 +294,8 @@ static void ari64_execute(struct psxRegisters *regs)
 		schedule_timeslice(regs);
 		ari64_execute_until(regs);
 		evprintf("drc left @%08x\n", regs->pc);
+		if (ndrc_g.tier_interp)
+			ari64_interpret_cold(regs, EXEC_CALLER_OTHER);
 	}
 }
 
@@ -251,6 +306,8 @@ static void ari64_execute_block(struct psxRegisters *regs, enum blockExecCaller
 
 	regs->next_interupt = regs->cycle + 1;
 	ari64_execute_until(regs);
+	if (ndrc_g.tier_interp)
+		ari64_interpret_cold(regs, caller);
 
 	if (caller == EXEC_CALLER_BOOT)
 		regs->stop--;
@@ -272,8 +329,13 @@ static void ari64_clear(u32 addr, u32 size)
 
 static void ari64_on_ext_change(int ram_replaced, int other_cpu_emu_exec)
 {
-	if (ram_replaced)
-		ari64_reset();
+	if (ram_replaced) {
+		// unlike a reset, the old code is usually still in place
+		ari64_thread_sync();
+		new_dyna_pcsx_mem_reset();
+		new_dynarec_invalidate_changed();
+		new_dyna_pcsx_mem_load_state();
+	}
 	else if (other_cpu_emu_exec)
 		new_dyna_pcsx_mem_load_state();
 }
@@ -317,30 +379,6 @@ static void ari64_apply_config()
 		ari64_thread_init();
 }
 
-#ifdef NDRC_THREAD
-static void clear_local_cache(void)
-{
-#if defined(__arm__) || defined(__aarch64__)
-	if (ndrc_g.thread.dirty_start) {
-		// see "Ensuring the visibility of updates to instructions"
-		// in v7/v8 reference manuals (DDI0406, DDI0487 etc.)
-#if defined(__aarch64__) || defined(HAVE_ARMV8)
-		// the actual clean/invalidate is broadcast to all cores,
-		// the manual only prescribes an isb
-		__asm__ volatile("isb");
-//#elif defined(_3DS)
-//		ctr_invalidate_icache();
-#else
-		// while on v6 this is always required, on v7 it depends on
-		// "Multiprocessing Extensions" being present, but that is difficult
-		// to detect so do it always for now
-		new_dyna_clear_cache(ndrc_g.thread.dirty_start, ndrc_g.thread.dirty_end);
-#endif
-		ndrc_g.thread.dirty_start = ndrc_g.thread.dirty_end = 0;
-	}
-#endif
-}
-
 static void mixed_execute_block(struct psxRegisters *regs, enum blockExecCaller caller)
 {
 	psxInt.ExecuteBlock(regs, caller);
@@ -366,10 +404,54 @@ static R3000Acpu psxMixedCpu = {
 	NULL /* ApplyConfig */,	NULL /* Shutdown */
 };
 
+// the dynarec left at a block that is not worth compiling yet
+// (NDHACK_TIERING), run it in the interpreter instead
+static noinline void ari64_interpret_cold(struct psxRegisters *regs,
+	enum blockExecCaller block_caller)
+{
+	ndrc_g.tier_interp = 0;
+	psxInt.Notify(R3000ACPU_NOTIFY_AFTER_LOAD, NULL);
+	assert(psxCpu == &psxRec);
+	psxCpu = &psxMixedCpu;
+	mixed_execute_block(regs, block_caller);
+	psxCpu = &psxRec;
+	psxInt.Notify(R3000ACPU_NOTIFY_BEFORE_SAVE, NULL);
+	ari64_on_ext_change(0, 1);
+}
+
+#ifdef NDRC_THREAD
+static void clear_local_cache(void)
+{
+#if defined(__arm__) || defined(__aarch64__) || defined(__riscv)
+	if (ndrc_g.thread.dirty_start) {
+		// see "Ensuring the visibility of updates to instructions"
+		// in v7/v8 reference manuals (DDI0406, DDI0487 etc.)
+#if defined(__aarch64__) || defined(HAVE_ARMV8)
+		// the actual clean/invalidate is broadcast to all cores,
+		// the manual only prescribes an isb
+		__asm__ volatile("isb");
+#elif defined(__riscv)
+		// __clear_cache() on the compile thread already asked the kernel
+		// to flush all harts, this one just has to sync it's fetch
+		__asm__ volatile("fence.i" ::: "memory");
+//#elif defined(_3DS)
+//		ctr_invalidate_icache();
+#else
+		// while on v6 this is always required, on v7 it depends on
+		// "Multiprocessing Extensions" being present, but that is difficult
+		// to detect so do it always for now
+		new_dyna_clear_cache(ndrc_g.thread.dirty_start, ndrc_g.thread.dirty_end);
+#endif
+		ndrc_g.thread.dirty_start = ndrc_g.thread.dirty_end = 0;
+	}
+#endif
+}
+
 static noinline void ari64_execute_threaded_slow(struct psxRegisters *regs,
 	enum blockExecCaller block_caller)
 {
 	if (ndrc_g.thread.busy_addr == ~0u) {
+		ndrc_g.stats.thread_waits++;
 		memcpy(ndrc_smrv_regs, regs->GPR.r, sizeof(ndrc_smrv_regs));
 		slock_lock(ndrc_g.thread.lock);
 		ndrc_g.thread.busy_addr = regs->pc;
@@ -411,11 +493,12 @@ static void ari64_execute_threaded_once(struct psxRegisters *regs,
 	enum blockExecCaller block_caller)
 {
 	void *drc_local = (char *)regs - LO_psxRegs;
-	struct ht_entry *hash_table =
-		*(void **)((char *)drc_local + LO_hash_table_ptr);
+	struct ht_entry *hash_table;
 	void *target;
 
 	if (likely(ndrc_g.thread.busy_addr == ~0u)) {
+		new_dynarec_sync_point();
+		hash_table = *(void **)((char *)drc_local + LO_hash_table_ptr);
 		target = ndrc_get_addr_ht_param(hash_table, regs->pc,
 				ndrc_cm_no_compile);
 		if (target) {
@@ -470,15 +553,9 @@ static void ari64_thread_sync(void)
 	}
 }
 
-static int ari64_thread_check_range(unsigned int start, unsigned int end)
+static int thread_range_hit(u32 addr, u32 start, u32 end)
 {
-	u32 addr = ndrc_g.thread.busy_addr;
-	if (addr == ~0u)
-		return 0;
-
 	addr &= 0x1fffffff;
-	start &= 0x1fffffff;
-	end &= 0x1fffffff;
 	if (addr >= end)
 		return 0;
 	if (addr + MAXBLOCK * 4 <= start)
@@ -488,26 +565,65 @@ static int ari64_thread_check_range(unsigned int start, unsigned int end)
 	return 1;
 }
 
+static int ari64_thread_check_range(unsigned int start, unsigned int end)
+{
+	u32 addr = ndrc_g.thread.busy_addr;
+	int i, n;
+
+	if (addr == ~0u)
+		return 0;
+
+	start &= 0x1fffffff;
+	end &= 0x1fffffff;
+	if (thread_range_hit(addr, start, end))
+		return 1;
+	// the successors are compiled under the same busy_addr
+	n = *(volatile int *)&ndrc_g.thread.spec_count;
+	for (i = 0; i < n && i < NDRC_SPEC_MAX; i++)
+		if (thread_range_hit(ndrc_g.thread.spec_addrs[i], start, end))
+			return 1;
+	return 0;
+}
+
 static STRHEAD_RET_TYPE ari64_compile_thread(void *unused)
 {
-	struct ht_entry *hash_table =
-		*(void **)((char *)dynarec_local + LO_hash_table_ptr);
+	struct ht_entry *hash_table;
 	void *target;
 	u32 addr;
+	int i, n;
 
 	slock_lock(ndrc_g.thread.lock);
 	while (!ndrc_g.thread.exit)
 	{
 		addr = *(volatile unsigned int *)&ndrc_g.thread.busy_addr;
-		if (addr == ~0u)
+		if (addr == ~0u) {
 			scond_wait(ndrc_g.thread.cond, ndrc_g.thread.lock);
+			twake_count(TWAKE_DRC);
+		}
 		addr = *(volatile unsigned int *)&ndrc_g.thread.busy_addr;
 		if (addr == ~0u || ndrc_g.thread.exit)
 			continue;
 
+		// may have been regrown by new_dynarec_sync_point()
+		hash_table = *(void **)((char *)dynarec_local + LO_hash_table_ptr);
+
+		ndrc_g.thread.spec_count = 0;
 		target = ndrc_get_addr_ht_param(hash_table, addr,
 				ndrc_cm_compile_in_thread);
 		//printf("c  %08x -> %p\n", addr, target);
+
+		// the emu thread is interpreting anyway, also do whatever
+		// this block links to and is missing so that it doesn't have
+		// to come back here right away (only one level deep)
+		n = target ? ndrc_g.thread.spec_count : 0;
+		for (i = 0; i < n && !ndrc_g.thread.exit; i++) {
+			addr = ndrc_g.thread.spec_addrs[i];
+			if (ndrc_get_addr_ht_param(hash_table, addr, ndrc_cm_no_compile))
+				continue;
+			ndrc_get_addr_ht_param(hash_table, addr,
+				ndrc_cm_compile_in_thread);
+		}
+		ndrc_g.thread.spec_count = 0;
 		ndrc_g.thread.busy_addr = ~0u;
 	}
 	slock_unlock(ndrc_g.thread.lock);
@@ -654,6 +770,7 @@ void new_dyna_start(void *context) {}
 void new_dynarec_cleanup() {}
 void new_dynarec_clear_full() {}
 void new_dynarec_invalidate_all_pages() {}
+void new_dynarec_invalidate_changed() {}
 void new_dynarec_invalidate_range(unsigned int start, unsigned int end) {}
 void new_dyna_pcsx_mem_init(void) {}
 void new_dyna_pcsx_mem_reset(void) {}
@@ -662,6 +779,10 @@ void new_dyna_pcsx_mem_isolate(int enable) {}
 void new_dyna_pcsx_mem_shutdown(void) {}
 int  new_dynarec_save_blocks(void *save, int size) { return 0; }
 void new_dynarec_load_blocks(const void *save, int size) {}
+int  new_dynarec_save_cache(void *save, int size) { return 0; }
+int  new_dynarec_dump_profile(const char *fname) { return -1; }
+void new_dynarec_load_cache(const void *save, int size) {}
+void new_dynarec_get_stats(struct ndrc_stats *stats) { memset(stats, 0, sizeof(*stats)); }
 
 #endif // DRC_DISABLE
 
@@ -701,13 +822,32 @@ static u32 memcheck_read(u32 a)
 	return *(u32 *)(psxM + (a & 0x1ffffc));
 }
 
+// compared registers in tracelog order: gpr, cp0, cp2d, cp2c, pc..interrupt
+#define DBG_REG_COUNT (34 + 32*3 + 4)
+
+static u32 *dbg_reg(psxRegisters *regs, int i)
+{
+	if (i < 34)
+		return &regs->GPR.r[i];
+	if (i < 34 + 32)
+		return &regs->CP0.r[i - 34];
+	if (i < 34 + 32*2)
+		return &regs->CP2D.r[i - 34 - 32];
+	if (i < 34 + 32*3)
+		return &regs->CP2C.r[i - 34 - 32*2];
+	switch (i - 34 - 32*3) {
+	case 0:  return &regs->pc;
+	case 1:  return &regs->code;
+	case 2:  return &regs->cycle;
+	default: return &regs->interrupt;
+	}
+}
+
 #if 0
 void do_insn_trace(void)
 {
 	static psxRegisters oldregs;
 	static u32 event_cycles_o[PSXINT_COUNT];
-	u32 *allregs_p = (void *)&psxRegs;
-	u32 *allregs_o = (void *)&oldregs;
 	u32 io_data;
 	int i;
 	u8 byte;
@@ -718,11 +858,11 @@ void do_insn_trace(void)
 
 	// log reg changes
 	oldregs.code = psxRegs.code; // don't care
-	for (i = 0; i < offsetof(psxRegisters, intCycle) / 4; i++) {
-		if (allregs_p[i] != allregs_o[i]) {
+	for (i = 0; i < DBG_REG_COUNT; i++) {
+		if (*dbg_reg(&psxRegs, i) != *dbg_reg(&oldregs, i)) {
 			fwrite(&i, 1, 1, f);
-			fwrite(&allregs_p[i], 1, 4, f);
-			allregs_o[i] = allregs_p[i];
+			fwrite(dbg_reg(&psxRegs, i), 1, 4, f);
+			*dbg_reg(&oldregs, i) = *dbg_reg(&psxRegs, i);
 		}
 	}
 	// log event changes
@@ -763,7 +903,7 @@ void do_insn_trace(void)
 }
 #endif
 
-static const char *regnames[offsetof(psxRegisters, intCycle) / 4] = {
+static const char *regnames[DBG_REG_COUNT] = {
 	"r0",  "r1",  "r2",  "r3",  "r4",  "r5",  "r6",  "r7",
 	"r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15",
 	"r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23",
@@ -815,8 +955,6 @@ void do_insn_cmp(void)
 	static u32 mem_addr, mem_val;
 	static u32 irq_test_cycle_intr;
 	static u32 handler_cycle_intr;
-	u32 *allregs_p = (void *)&psxRegs;
-	u32 *allregs_e = (void *)&rregs;
 	u32 badregs_mask = 0;
 	static u32 ppc, failcount;
 	static u32 badregs_mask_prev;
@@ -853,8 +991,8 @@ void do_insn_cmp(void)
 			fread(&mem_val, 1, 4, f);
 			continue;
 		}
-		assert(code < offsetof(psxRegisters, intCycle) / 4);
-		fread(&allregs_e[code], 1, 4, f);
+		assert(code < DBG_REG_COUNT);
+		fread(dbg_reg(&rregs, code), 1, 4, f);
 	}
 
 	if (ret <= 0) {
@@ -890,14 +1028,18 @@ void do_insn_cmp(void)
 		fatal = 1;
 	}
 
-	if (!fatal && !memcmp(&psxRegs, &rregs, offsetof(psxRegisters, intCycle))) {
+	for (i = 0; i < DBG_REG_COUNT; i++)
+		if (*dbg_reg(&psxRegs, i) != *dbg_reg(&rregs, i))
+			break;
+	if (!fatal && i == DBG_REG_COUNT) {
 		failcount = 0;
 		goto ok;
 	}
 
-	for (i = 0; i < offsetof(psxRegisters, intCycle) / 4; i++) {
-		if (allregs_p[i] != allregs_e[i]) {
-			miss_log_add(i, allregs_p[i], allregs_e[i], psxRegs.pc, psxRegs.cycle);
+	for (i = 0; i < DBG_REG_COUNT; i++) {
+		if (*dbg_reg(&psxRegs, i) != *dbg_reg(&rregs, i)) {
+			miss_log_add(i, *dbg_reg(&psxRegs, i), *dbg_reg(&rregs, i),
+				psxRegs.pc, psxRegs.cycle);
 			bad++;
 			if (i >= 32)
 				fatal = 1;
@@ -926,8 +1068,9 @@ void do_insn_cmp(void)
 			miss_log[miss_log_i].val_expect, miss_log[miss_log_i].pc, miss_log[miss_log_i].cycle);
 	printf("-- %d\n", bad);
 	for (i = 0; i < 8; i++)
-		printf("r%d=%08x r%2d=%08x r%2d=%08x r%2d=%08x\n", i, allregs_p[i],
-			i+8, allregs_p[i+8], i+16, allregs_p[i+16], i+24, allregs_p[i+24]);
+		printf("r%d=%08x r%2d=%08x r%2d=%08x r%2d=%08x\n", i, psxRegs.GPR.r[i],
+			i+8, psxRegs.GPR.r[i+8], i+16, psxRegs.GPR.r[i+16],
+			i+24, psxRegs.GPR.r[i+24]);
 	printf("PC: %08x/%08x, cycle %u, next %u\n", psxRegs.pc, ppc,
 		psxRegs.cycle, psxRegs.next_interupt);
 	//dump_mem("/tmp/psxram.dump", psxM, 0x200000);
@@ -5,26 +5,25 @@
 #define LO_last_count		(LO_cycle_count + 4)
 #define LO_address		(LO_last_count + 4)
 #define LO_hack_addr		(LO_address + 4)
-#define LO_psxRegs		(LO_hack_addr + 4)
+#define LO_psxRegs		128  // cacheline aligned, as are its blocks below
 #define LO_lo			(LO_psxRegs + 128)
 #define LO_hi			(LO_lo + 4)
-#define LO_reg_cop0		(LO_hi + 4)
-#define LO_reg_cop2d		(LO_reg_cop0 + 128)
-#define LO_reg_cop2c		(LO_reg_cop2d + 128)
-#define LO_PC			(LO_reg_cop2c + 128)
+#define LO_PC			(LO_hi + 4)
 #define LO_pcaddr		(LO_PC)
 #define LO_code			(LO_PC + 4)
 #define LO_cycle		(LO_code + 4)
 #define LO_interrupt		(LO_cycle + 4)
-#define LO_intCycle		(LO_interrupt + 4)
-#define LO_next_interupt	(LO_intCycle + 4*2*31)
-#define LO_unused		(LO_next_interupt + 4)
-#define LO_gteBusyCycle		(LO_unused + 4)
+#define LO_next_interupt	(LO_interrupt + 4)
+#define LO_gteBusyCycle		(LO_next_interupt + 4)
 #define LO_muldivBusyCycle	(LO_gteBusyCycle + 4)
 #define LO_psxRegs_subCycle	(LO_muldivBusyCycle + 4)
 #define LO_psxRegs_biuReg	(LO_psxRegs_subCycle + 4*2)
 #define LO_stop            	(LO_psxRegs_biuReg + 4)
-#define LO_psxRegs_end		(LO_stop + 4*9)
+#define LO_reg_cop0		(LO_stop + 4*4)
+#define LO_intCycle		(LO_reg_cop0 + 128)
+#define LO_reg_cop2d		(LO_intCycle + 4*80)
+#define LO_reg_cop2c		(LO_reg_cop2d + 128)
+#define LO_psxRegs_end		(LO_reg_cop2c + 128)
 #define LO_rcnts		(LO_psxRegs_end)
 #define LO_rcnts_end		(LO_rcnts + 7*4*4)
 #define LO_inv_code_start	(LO_rcnts_end)
@@ -25,6 +25,10 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#ifdef NDRC_SMC_PROTECT
+#include <signal.h>
+#include <pthread.h>
+#endif
 #ifdef __MACH__
 #include <libkern/OSCacheControl.h>
 #endif
@@ -40,6 +44,7 @@ static Jit g_jit;
 #include "../psxhle.h"
 #include "../psxinterpreter.h"
 #include "../psxcounters.h"
+#include "../psxmem_map.h"
 #include "../gte.h"
 #include "emu_if.h" // emulator interface
 #include "linkage_offsets.h"
@@ -104,8 +109,13 @@ extern uintptr_t mini_ht[32][2];
 #ifdef __aarch64__
 #include "assem_arm64.h"
 #endif
+#ifdef __riscv
+#include "assem_rv64.h"
+#endif
 
 #define RAM_SIZE 0x200000
+#define HASH_TABLE_MIN 65536
+#define HASH_TABLE_MAX (1u << 18)
 #define MAX_OUTPUT_BLOCK_SIZE 262144
 #define EXPIRITY_OFFSET (MAX_OUTPUT_BLOCK_SIZE * 2)
 #define PAGE_COUNT 1024
@@ -137,6 +147,9 @@ struct ndrc_mem
 };
 
 static struct ndrc_mem *ndrc;
+// the part of translation_cache in use, 1 << TARGET_SIZE_2 unless
+// Config.MemBudgetMB asks for less, the rest of it is never touched
+static u_int tc_size = 1u << TARGET_SIZE_2;
 #ifndef BASE_ADDR_DYNAMIC
 // reserve .bss space with upto 64k page size in mind
 static char ndrc_bss[((sizeof(*ndrc) + 65535) & ~65535) + 65536];
@@ -267,6 +280,8 @@ static struct decoded_insn
   u_char is_exception:1;  // unconditional, also interp. fallback
   u_char may_except:1;    // might generate an exception
   u_char ls_type:2;       // load/store type (ls_width_type LS_*)
+  u_char lr_head:1;       // first of a lwl/lwr or swl/swr pair on one word
+  u_char lr_tail:1;       // second of such a pair
 } dops[MAXBLOCK];
 
 enum ls_width_type {
@@ -285,7 +300,17 @@ static struct compile_info
 
   static u_char *out;
   static char invalid_code[0x100000];
-  static struct ht_entry hash_table[65536];
+  // grown by hash_table_maybe_grow() when the code footprint is large
+  static struct ht_entry hash_table_initial[HASH_TABLE_MIN];
+  static struct ht_entry *hash_table = hash_table_initial;
+  static u_int hash_table_mask = HASH_TABLE_MIN - 1;
+  static u_int hash_table_evict_base;
+#ifdef NDRC_JUMP_CACHE
+  // one entry per word of the kseg0 ram view (0x80000000-0x801fffff), what
+  // almost all indirect jumps target; filled by ndrc_get_addr_ht_param(),
+  // entries go away together with their hash_table ones
+  static void *jump_cache[0x200000 / 4];
+#endif
   static struct block_info *blocks[PAGE_COUNT];
   static struct jump_info *jumps[PAGE_COUNT];
   static u_int start;
@@ -319,12 +344,25 @@ static struct compile_info
   static int is_delayslot;
   static char shadow[1048576]  __attribute__((aligned(16)));
   static void *copy;
-  static u_int expirep;
+  static u_int expirep[2];   // per tc generation
+  static u_char *tc_out[2];  // emit pointer of the inactive generation
+  static u_int tc_gen;       // generation 'out' currently points into
+  static u_int *tenure_set;  // vaddrs of blocks that survived a nursery wrap
+  static struct {
+    u_int compiles[2];       // per generation
+    u_int expired_live;      // clean blocks dropped by pass10
+    u_int wraps[2];
+  } tc_stats;
   static u_int stop_after_jal;
   static u_int ni_count;
   static u_int err_print_count;
   static u_int f1_hack;
   static u_int vsync_hack;
+  static u_int poll_loop;
+  // area known to have no clean blocks, like inv_code_start/end, but
+  // for DMA/bulk writes, mirror masked, inclusive; grown while the
+  // writes keep landing next to each other (streamed overlays, etc)
+  static u_int inv_bulk_start = ~0, inv_bulk_end = ~0;
 #ifdef STAT_PRINT
   static int stat_bc_direct;
   static int stat_bc_pre;
@@ -422,6 +460,8 @@ static void ndrc_write_invalidate_many(u_int addr, u_int end);
 
 static int new_recompile_block(u_int addr);
 static void invalidate_block(struct block_info *block);
+static void cache_blocks_compile(u_int vaddr);
+static u_int *get_source_start(u_int addr, u_int *limit);
 static void exception_assemble(int i, const struct regstat *i_regs, int ccadj_);
 
 // Needed by assembler
@@ -490,7 +530,7 @@ static void mprotect_w_x(void *start, void *end, int is_x)
 
 void new_dyna_clear_cache(void *start, void *end)
 {
-#if defined(__arm__) || defined(__aarch64__)
+#if defined(__arm__) || defined(__aarch64__) || defined(__riscv)
   size_t len = (char *)end - (char *)start;
   #if   defined(__BLACKBERRY_QNX__)
   msync(start, len, MS_SYNC | MS_CACHE_ONLY | MS_INVALIDATE_ICACHE);
@@ -669,7 +709,7 @@ static u_int get_page_prev(u_int vaddr)
 
 static struct ht_entry *hash_table_get_p(struct ht_entry *ht, u_int vaddr)
 {
-  return &ht[((vaddr >> 16) ^ vaddr) & 0xFFFF];
+  return &ht[((vaddr >> 2) ^ (vaddr >> 16)) & hash_table_mask];
 }
 
 static struct ht_entry *hash_table_get(u_int vaddr)
@@ -679,26 +719,91 @@ static struct ht_entry *hash_table_get(u_int vaddr)
 
 #define HASH_TABLE_BAD 0xbac
 
-static void hash_table_clear(void)
+static void hash_table_init(struct ht_entry *ht)
 {
   struct ht_entry *ht_bin;
-  int i, j;
-  for (i = 0; i < ARRAY_SIZE(hash_table); i++) {
-    for (j = 0; j < ARRAY_SIZE(hash_table[i].vaddr); j++) {
-      hash_table[i].vaddr[j] = ~0;
-      hash_table[i].tcaddr[j] = (void *)(uintptr_t)HASH_TABLE_BAD;
+  u_int i, j;
+  for (i = 0; i <= hash_table_mask; i++) {
+    for (j = 0; j < ARRAY_SIZE(ht[i].vaddr); j++) {
+      ht[i].vaddr[j] = ~0;
+      ht[i].tcaddr[j] = (void *)(uintptr_t)HASH_TABLE_BAD;
     }
   }
   // don't allow ~0 to hit
-  ht_bin = hash_table_get(~0);
+  ht_bin = hash_table_get_p(ht, ~0);
   for (j = 0; j < ARRAY_SIZE(ht_bin->vaddr); j++)
     ht_bin->vaddr[j] = 1;
 }
 
+static void hash_table_clear(void)
+{
+  hash_table_init(hash_table);
+  hash_table_evict_base = ndrc_g.stats.ht_evictions;
+#ifdef NDRC_JUMP_CACHE
+  memset(jump_cache, 0, sizeof(jump_cache));
+#endif
+}
+
+// Entries only cache what get_addr() finds in blocks[], so a bigger table
+// can be filled from the old one and anything that doesn't fit dropped.
+// Only at points where no lookup is in progress, nothing keeps bin
+// pointers and the compiled code reloads hash_table_ptr every time.
+static void hash_table_maybe_grow(void)
+{
+  struct ht_entry *old = hash_table, *ht, *ht_bin;
+  u_int i, j, used = 0, old_mask = hash_table_mask;
+
+  if (ndrc_g.stats.ht_evictions - hash_table_evict_base < (old_mask + 1) / 4)
+    return;
+  hash_table_evict_base = ndrc_g.stats.ht_evictions;
+  if (old_mask + 1 >= HASH_TABLE_MAX)
+    return;
+  for (i = 0; i <= old_mask; i++)
+    used += (old[i].vaddr[0] != ~0u) + (old[i].vaddr[1] != ~0u);
+  // many evictions but a mostly empty table is just churn
+  if (used < (old_mask + 1) * 2 / 4 * 3)
+    return;
+
+  ht = malloc((old_mask + 1) * 2 * sizeof(ht[0]));
+  if (ht == NULL)
+    return;
+  hash_table_mask = old_mask * 2 + 1;
+  hash_table_init(ht);
+  for (i = 0; i <= old_mask; i++) {
+    // older entries first so that [0] stays the most recent one
+    for (j = ARRAY_SIZE(old[i].vaddr); j-- > 0; ) {
+      u_int vaddr = old[i].vaddr[j];
+      if (vaddr == ~0u || old[i].tcaddr[j] == (void *)(uintptr_t)HASH_TABLE_BAD)
+        continue;
+      ht_bin = hash_table_get_p(ht, vaddr);
+      ht_bin->vaddr[1] = ht_bin->vaddr[0];
+      ht_bin->tcaddr[1] = ht_bin->tcaddr[0];
+      ht_bin->vaddr[0] = vaddr;
+      ht_bin->tcaddr[0] = old[i].tcaddr[j];
+    }
+  }
+  hash_table = ht;
+  hash_table_ptr = ht;
+  if (old != hash_table_initial)
+    free(old);
+  SysPrintf("drc: hash table grown to %u entries (%u used)\n",
+    (hash_table_mask + 1) * 2, used);
+}
+
+static void jump_cache_set(u_int vaddr, void *tcaddr)
+{
+#ifdef NDRC_JUMP_CACHE
+  if ((vaddr & 0xffe00000) == 0x80000000)
+    jump_cache[(vaddr & 0x1fffff) >> 2] = tcaddr;
+#endif
+}
+
 static void hash_table_add(u_int vaddr, void *tcaddr)
 {
   struct ht_entry *ht_bin = hash_table_get(vaddr);
   assert(tcaddr);
+  if (ht_bin->vaddr[1] != ~0u && ht_bin->vaddr[1] != vaddr)
+    ndrc_g.stats.ht_evictions++;
   ht_bin->vaddr[1] = ht_bin->vaddr[0];
   ht_bin->tcaddr[1] = ht_bin->tcaddr[0];
   ht_bin->vaddr[0] = vaddr;
@@ -709,6 +814,7 @@ static void hash_table_remove(int vaddr)
 {
   //printf("remove hash: %x\n",vaddr);
   struct ht_entry *ht_bin = hash_table_get(vaddr);
+  jump_cache_set(vaddr, NULL);
   if (ht_bin->vaddr[1] == vaddr) {
     ht_bin->vaddr[1] = ~0;
     ht_bin->tcaddr[1] = (void *)(uintptr_t)HASH_TABLE_BAD;
@@ -734,6 +840,46 @@ static void mini_ht_clear(void)
 #endif
 }
 
+#ifdef NDRC_SMC_PROTECT
+// Alternative to the invalid_code[] checks in compiled stores: ram pages
+// with clean blocks are made read-only and a write fault (from anywhere,
+// compiled code, the interpreter, DMA) invalidates the page and makes it
+// writable again. Blocks compiled in this mode have no store checks, so
+// the mode can only change together with new_dynarec_clear_full(). Not
+// used with the compile thread, the handler can't sync with it.
+static struct {
+  int ok;                   // handler installed, 4K host pages
+  int block;                // the block being compiled relies on it
+  pthread_t emu_thread;
+  u_char ro[RAM_SIZE >> 12];
+  volatile u_char pending[RAM_SIZE >> 12]; // unprotected by other threads
+  volatile int pending_any;
+  struct sigaction old_sa;
+} smc_prot;
+
+static int smc_prot_usable(void)
+{
+  return smc_prot.ok && !ndrc_g.thread.handle
+    && !HACK_ENABLED(NDHACK_NO_SMC_CHECK);
+}
+
+static void smc_prot_page(u_int page, int ro)
+{
+  if (smc_prot.ro[page] == ro)
+    return;
+  if (mprotect(psxM + (page << 12), 0x1000,
+               ro ? PROT_READ : (PROT_READ | PROT_WRITE)) == 0)
+    smc_prot.ro[page] = ro;
+}
+
+static void smc_prot_all(int ro)
+{
+  u_int page;
+  for (page = 0; page < ARRAY_SIZE(smc_prot.ro); page++)
+    smc_prot_page(page, ro);
+}
+#endif
+
 static void mark_invalid_code(u_int vaddr, u_int len, char invalid)
 {
   u_int vaddr_m = vaddr & 0x1fffffff;
@@ -745,14 +891,83 @@ static void mark_invalid_code(u_int vaddr, u_int len, char invalid)
       invalid_code[(i|j|0x80000000u) >> 12] =
       invalid_code[(i|j|0xa0000000u) >> 12] = invalid;
     }
+#ifdef NDRC_SMC_PROTECT
+    if (i < 0x800000 && (invalid || smc_prot_usable()))
+      smc_prot_page((i & (RAM_SIZE - 1)) >> 12, !invalid);
+#endif
   }
   if (!invalid && vaddr + len > inv_code_start && vaddr <= inv_code_end)
     inv_code_start = inv_code_end = ~0;
+  if (!invalid && pmmask(vaddr) + len > inv_bulk_start
+      && pmmask(vaddr) <= inv_bulk_end)
+    inv_bulk_start = inv_bulk_end = ~0;
+}
+
+// The tcache is split in two generations, each recycled FIFO-style by
+// pass10_expire_blocks(). New code goes to the nursery. Blocks that are
+// still clean when the nursery wraps over them are remembered, and if they
+// are needed again they get compiled into the (much less busy) tenured
+// region. Host code can't be moved, so promotion is a recompile.
+#define TC_GEN_NURSERY 0
+#define TC_GEN_TENURED 1
+#define TC_TENURED_START (tc_size / 4 * 3)
+#define TC_TENURED_END \
+  (min(tc_size, sizeof(ndrc->translation_cache)) & ~(MAX_OUTPUT_BLOCK_SIZE - 1))
+#define TENURE_SET_SIZE 4096
+
+static u_int tc_gen_start(u_int gen)
+{
+  return gen == TC_GEN_TENURED ? TC_TENURED_START : 0;
+}
+
+static u_int tc_gen_end(u_int gen)
+{
+  return gen == TC_GEN_TENURED ? TC_TENURED_END : TC_TENURED_START;
+}
+
+static u_int tc_gen_of(u_int tc_offs)
+{
+  return tc_offs >= TC_TENURED_START ? TC_GEN_TENURED : TC_GEN_NURSERY;
+}
+
+static void tc_set_gen(u_int gen)
+{
+  if (gen == tc_gen)
+    return;
+  tc_out[tc_gen] = out;
+  out = tc_out[gen];
+  tc_gen = gen;
+}
+
+static u_int tenure_hash(u_int vaddr)
+{
+  return ((vaddr >> 2) ^ (vaddr >> 14)) & (TENURE_SET_SIZE - 1);
+}
+
+static int is_tenured(u_int vaddr)
+{
+  return tenure_set != NULL && tenure_set[tenure_hash(vaddr)] == vaddr;
+}
+
+static void tenure_add(u_int vaddr)
+{
+  if (tenure_set == NULL) {
+    tenure_set = malloc(TENURE_SET_SIZE * sizeof(tenure_set[0]));
+    if (tenure_set == NULL)
+      return;
+    memset(tenure_set, 0xff, TENURE_SET_SIZE * sizeof(tenure_set[0]));
+  }
+  tenure_set[tenure_hash(vaddr)] = vaddr;
 }
 
 static int doesnt_expire_soon(u_char *tcaddr)
 {
-  u_int diff = (u_int)(tcaddr - out) & ((1u << TARGET_SIZE_2) - 1u);
+  u_int offs = tcaddr - ndrc->translation_cache;
+  u_int gen = tc_gen_of(offs);
+  u_char *gen_out = gen == tc_gen ? out : tc_out[gen];
+  u_int diff = offs - (gen_out - ndrc->translation_cache);
+  if ((int)diff < 0)
+    diff += tc_gen_end(gen) - tc_gen_start(gen);
   return diff > EXPIRITY_OFFSET + MAX_OUTPUT_BLOCK_SIZE;
 }
 
@@ -806,6 +1021,7 @@ static void *try_restore_block(u_int vaddr, u_int start_page, u_int end_page)
       hash_table_add(vaddr, found_clean);
       mark_invalid_code(block->start, block->len, 0);
       stat_inc(stat_bc_restore);
+      ndrc_g.stats.restores++;
       inv_debug("INV: restored %08x %p (%d)\n", vaddr, found_clean, block->jump_in_cnt);
       return found_clean;
     }
@@ -833,6 +1049,58 @@ static noinline u_int generate_exception(u_int pc)
   return (psxRegs.pc = 0x80000080);
 }
 
+// NDHACK_TIERING: ram code runs in the interpreter until it was entered
+// TIER_THRESHOLD times, so blocks that run once or twice (loaders, overlay
+// init, code that is rewritten right away) are never compiled. Pages that
+// keep getting invalidated need more runs before their code is compiled.
+#define TIER_HASH_BITS 14
+#define TIER_THRESHOLD 4
+static u_char tier_count[1 << TIER_HASH_BITS];
+static u_char tier_page_inv[RAM_SIZE >> 12];
+
+static u_int tier_hash(u_int vaddr)
+{
+  return ((vaddr >> 2) ^ (vaddr >> 16)) & ((1 << TIER_HASH_BITS) - 1);
+}
+
+static int tier_interpret(u_int vaddr)
+{
+  u_int h, need;
+
+  if (!HACK_ENABLED(NDHACK_TIERING) || ndrc_g.thread.handle
+      || (vaddr & 0x1fffffff) >= 0x800000)
+    return 0;
+  h = tier_hash(vaddr);
+  need = TIER_THRESHOLD << min(tier_page_inv[(vaddr & (RAM_SIZE-1)) >> 12] / 16, 4);
+  if (tier_count[h] >= need)
+    return 0;
+  tier_count[h]++;
+  return 1;
+}
+
+static void tier_block_invalidated(u_int vaddr, int smc)
+{
+  u_int i, page = (vaddr & (RAM_SIZE-1)) >> 12;
+
+  if ((vaddr & 0x1fffffff) >= 0x800000)
+    return;
+  tier_count[tier_hash(vaddr)] = 0;
+  if (!smc)
+    return;
+  if (tier_page_inv[page] == 255) {
+    // decay so that pages that calmed down get compiled sooner again
+    for (i = 0; i < ARRAY_SIZE(tier_page_inv); i++)
+      tier_page_inv[i] >>= 1;
+  }
+  tier_page_inv[page]++;
+}
+
+static void tier_clear(void)
+{
+  memset(tier_count, 0, sizeof(tier_count));
+  memset(tier_page_inv, 0, sizeof(tier_page_inv));
+}
+
 // Get address from virtual address
 // This is called from the recompiled JR/JALR instructions
 static void noinline *get_addr(struct ht_entry *ht, const u_int vaddr,
@@ -866,6 +1134,11 @@ static void noinline *get_addr(struct ht_entry *ht, const u_int vaddr,
 
   if (compile_mode == ndrc_cm_no_compile)
     return NULL;
+  if (compile_mode == ndrc_cm_compile_live && tier_interpret(vaddr)) {
+    psxRegs.pc = vaddr;
+    ndrc_g.tier_interp = 1;
+    return new_dyna_leave;
+  }
 #ifdef NDRC_THREAD
   if (ndrc_g.thread.handle && compile_mode == ndrc_cm_compile_live) {
     psxRegs.pc = vaddr;
@@ -875,6 +1148,7 @@ static void noinline *get_addr(struct ht_entry *ht, const u_int vaddr,
 #endif
   memcpy(ndrc_smrv_regs, psxRegs.GPR.r, sizeof(ndrc_smrv_regs));
 
+  cache_blocks_compile(vaddr);
   int r = new_recompile_block(vaddr);
   if (likely(r == 0))
     return ndrc_get_addr_ht(vaddr, ht);
@@ -892,9 +1166,24 @@ void *ndrc_get_addr_ht_param(struct ht_entry *ht, unsigned int vaddr,
   //check_for_block_changes(vaddr, vaddr + MAXBLOCK);
   const struct ht_entry *ht_bin = hash_table_get_p(ht, vaddr);
   u_int vaddr_a = vaddr & ~3;
+  ndrc_g.stats.lookups++;
+#ifdef NDRC_JUMP_CACHE
+  if ((vaddr & 0xffe00000) == 0x80000000) {
+    void *tcaddr = jump_cache[(vaddr & 0x1fffff) >> 2];
+    if (tcaddr)
+      return tcaddr;
+  }
+#endif
   stat_inc(stat_ht_lookups);
-  if (ht_bin->vaddr[0] == vaddr_a) return ht_bin->tcaddr[0];
-  if (ht_bin->vaddr[1] == vaddr_a) return ht_bin->tcaddr[1];
+  if (ht_bin->vaddr[0] == vaddr_a) {
+    jump_cache_set(vaddr, ht_bin->tcaddr[0]);
+    return ht_bin->tcaddr[0];
+  }
+  if (ht_bin->vaddr[1] == vaddr_a) {
+    jump_cache_set(vaddr, ht_bin->tcaddr[1]);
+    return ht_bin->tcaddr[1];
+  }
+  ndrc_g.stats.ht_misses++;
   return get_addr(ht, vaddr, compile_mode);
 }
 
@@ -1306,13 +1595,15 @@ static const struct {
   FUNCNAME(pcsx_mtc0),
   FUNCNAME(pcsx_mtc0_ds),
   FUNCNAME(execI),
-#ifdef __aarch64__
+#if defined(__aarch64__) || defined(__riscv)
   FUNCNAME(do_memhandler_pre),
   FUNCNAME(do_memhandler_post),
 #endif
 #ifdef DRC_DBG
-# ifdef __aarch64__
+# if defined(__aarch64__)
   FUNCNAME(do_insn_cmp_arm64),
+# elif defined(__riscv)
+  FUNCNAME(do_insn_cmp_rv64),
 # else
   FUNCNAME(do_insn_cmp),
 # endif
@@ -1379,17 +1670,21 @@ static const char *fpofs_name(u_int ofs)
 #ifdef __aarch64__
 #include "assem_arm64.c"
 #endif
+#ifdef __riscv
+#include "assem_rv64.c"
+#endif
 
 static void *get_trampoline(const void *f)
 {
   struct ndrc_tramp *tramp = NDRC_WRITE_OFFSET(&ndrc->tramp);
   size_t i;
 
-  for (i = 0; i < ARRAY_SIZE(tramp->f); i++) {
+  // ops[] can be the shorter one, depends on the insns per trampoline
+  for (i = 0; i < ARRAY_SIZE(tramp->ops); i++) {
     if (tramp->f[i] == f || tramp->f[i] == NULL)
       break;
   }
-  if (i == ARRAY_SIZE(tramp->f)) {
+  if (i == ARRAY_SIZE(tramp->ops)) {
     SysPrintf("trampoline table is full, last func %p\n", f);
     abort();
   }
@@ -1508,6 +1803,12 @@ static int blocks_remove_matching_addrs(struct block_info **head,
   while (*head) {
     if ((((*head)->tc_offs ^ base_offs) >> shift) == 0) {
       inv_debug("EXP: rm block %08x (tc_offs %x)\n", (*head)->start, (*head)->tc_offs);
+      if (!(*head)->is_dirty) {
+        // survived a whole wrap without being overwritten
+        if (tc_gen_of((*head)->tc_offs) == TC_GEN_NURSERY)
+          tenure_add((*head)->start);
+        tc_stats.expired_live++;
+      }
       invalidate_block(*head);
       next = (*head)->next;
       free(*head);
@@ -1584,6 +1885,7 @@ static void invalidate_block(struct block_info *block)
   u_int i;
 
   block->is_dirty = 1;
+  tier_block_invalidated(block->start, 0);
   unlink_jumps_vaddr_range(block->start, block->start + block->len);
   for (i = 0; i < block->jump_in_cnt; i++)
     hash_table_remove(block->jump_in[i].vaddr);
@@ -1602,6 +1904,8 @@ static int invalidate_range(u_int start, u_int end,
   u_int page;
   int hit = 0;
 
+  psx_heat(start, PSX_HEAT_INVAL);
+
   // additional area without code (to supplement invalid_code[]), [start, end)
   // avoids excessive ndrc_write_invalidate*() calls
   inv_start = start_m & ~0xfff;
@@ -1628,6 +1932,7 @@ static int invalidate_range(u_int start, u_int end,
 
       hit++;
       invalidate_block(block);
+      tier_block_invalidated(block->start, 1);
       stat_inc(stat_inv_hits);
     }
   }
@@ -1657,7 +1962,21 @@ static int invalidate_range(u_int start, u_int end,
 
 void new_dynarec_invalidate_range(unsigned int start, unsigned int end)
 {
-  invalidate_range(start, end, NULL, NULL);
+  u32 inv_start, inv_end;
+
+  ndrc_g.stats.inv_dma += invalidate_range(start, end, &inv_start, &inv_end);
+  inv_start = pmmask(inv_start);
+  inv_end = pmmask(inv_end);
+  if (inv_bulk_start != ~0 && inv_start <= inv_bulk_end + 1
+      && inv_bulk_start <= inv_end + 1) {
+    // touches the previous range, both are free of code, so merge
+    inv_bulk_start = min(inv_bulk_start, inv_start);
+    inv_bulk_end = max(inv_bulk_end, inv_end);
+  }
+  else {
+    inv_bulk_start = inv_start;
+    inv_bulk_end = inv_end;
+  }
 }
 
 // check if the range may need invalidation (must be thread-safe)
@@ -1669,6 +1988,8 @@ int new_dynarec_quick_check_range(unsigned int start, unsigned int end)
 
   if (inv_code_start <= start && end <= inv_code_end)
     return 0;
+  if (inv_bulk_start <= pmmask(start) && pmmask(end - 1) <= inv_bulk_end)
+    return 0;
   for (page = start_page; page <= end_page; page++) {
     if (blocks[page]) {
       //SysPrintf("quick hit %x-%x\n", start, end);
@@ -1694,7 +2015,7 @@ static void ndrc_write_invalidate_many(u_int start, u_int end)
   check_for_block_changes(start, end);
 #endif
   stat_inc(stat_inv_addr_calls);
-  (void)ret;
+  ndrc_g.stats.inv_smc += ret;
 }
 
 void ndrc_write_invalidate_one(u_int addr)
@@ -1702,6 +2023,96 @@ void ndrc_write_invalidate_one(u_int addr)
   ndrc_write_invalidate_many(addr, addr + 4);
 }
 
+#ifdef NDRC_SMC_PROTECT
+static int pgsize(void);
+
+static void smc_prot_invalidate(u_int page)
+{
+  u_int start = 0x80000000 | (page << 12);
+  ndrc_g.stats.inv_prot += invalidate_range(start, start + 0x1000, NULL, NULL);
+  // whatever is left can't be smc checked anyway ("hack" blocks)
+  smc_prot_page(page, 0);
+}
+
+static void smc_prot_handler(int sig, siginfo_t *si, void *uc)
+{
+  size_t ofs = (u_char *)si->si_addr - (u_char *)psxM;
+  u_int page = ofs >> 12;
+
+  if (psxM == NULL || ofs >= RAM_SIZE || !smc_prot.ro[page]) {
+    // not ours
+    if (smc_prot.old_sa.sa_flags & SA_SIGINFO)
+      smc_prot.old_sa.sa_sigaction(sig, si, uc);
+    else if (smc_prot.old_sa.sa_handler != SIG_DFL
+             && smc_prot.old_sa.sa_handler != SIG_IGN)
+      smc_prot.old_sa.sa_handler(sig);
+    else {
+      // the faulting insn runs again and gets the default action
+      sigaction(SIGSEGV, &smc_prot.old_sa, NULL);
+    }
+    return;
+  }
+  if (pthread_equal(pthread_self(), smc_prot.emu_thread))
+    smc_prot_invalidate(page);
+  else {
+    // like the mdec threads, the emu thread invalidates it later
+    if (mprotect(psxM + (page << 12), 0x1000, PROT_READ | PROT_WRITE) == 0)
+      smc_prot.ro[page] = 0;
+    smc_prot.pending[page] = 1;
+    smc_prot.pending_any = 1;
+  }
+}
+
+static void smc_prot_init(void)
+{
+  struct sigaction sa;
+
+  if (pgsize() != 4096 || (u_long)psxM & 4095) {
+    SysPrintf("drc: no smc page protection with this page size\n");
+    return;
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = smc_prot_handler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGSEGV, &sa, &smc_prot.old_sa) != 0) {
+    SysPrintf("drc: sigaction failed: %s\n", strerror(errno));
+    return;
+  }
+  smc_prot.emu_thread = pthread_self();
+  smc_prot.ok = 1;
+}
+
+static void smc_prot_finish(void)
+{
+  if (!smc_prot.ok)
+    return;
+  smc_prot_all(0);
+  sigaction(SIGSEGV, &smc_prot.old_sa, NULL);
+  smc_prot.ok = 0;
+}
+#endif
+
+// deferred work, called before entering compiled code while nothing else
+// (the compile thread included) is looking at the dynarec state
+void new_dynarec_sync_point(void)
+{
+#ifdef NDRC_SMC_PROTECT
+  // invalidate what other threads wrote into protected pages
+  if (unlikely(smc_prot.pending_any)) {
+    u_int page;
+    smc_prot.pending_any = 0;
+    for (page = 0; page < ARRAY_SIZE(smc_prot.pending); page++) {
+      if (smc_prot.pending[page]) {
+        smc_prot.pending[page] = 0;
+        smc_prot_invalidate(page);
+      }
+    }
+  }
+#endif
+  hash_table_maybe_grow();
+}
+
 // This is called when loading a save state.
 // Anything could have changed, so invalidate everything.
 void new_dynarec_invalidate_all_pages(void)
@@ -1715,6 +2126,7 @@ void new_dynarec_invalidate_all_pages(void)
       if (!block->source) // hack block?
         continue;
       invalidate_block(block);
+      ndrc_g.stats.inv_reload++;
     }
   }
 
@@ -1722,6 +2134,31 @@ void new_dynarec_invalidate_all_pages(void)
   mini_ht_clear();
 }
 
+// RAM was replaced (savestate load): only drop the blocks whose code is
+// no longer there, everything else stays compiled and linked
+void new_dynarec_invalidate_changed(void)
+{
+  struct block_info *block;
+  u_int page, dropped = 0;
+
+  for (page = 0; page < ARRAY_SIZE(blocks); page++) {
+    for (block = blocks[page]; block != NULL; block = block->next) {
+      if (block->is_dirty || !block->source)
+        continue;
+      if (memcmp(block->source, block->copy, block->len) == 0)
+        continue;
+      invalidate_block(block);
+      dropped++;
+    }
+  }
+  inv_debug("INV: state load dropped %u blocks\n", dropped);
+  ndrc_g.stats.inv_reload += dropped;
+
+  if (dropped)
+    do_clear_cache();
+  mini_ht_clear();
+}
+
 // Add an entry to jump_out after making a link
 // stub should point to stub code by emit_extjump()
 static void ndrc_add_jump_out(u_int vaddr, void *stub)
@@ -1759,8 +2196,8 @@ void ndrc_patch_link(u_int vaddr, void *insn, void *stub, void *target)
   set_jump_target_far1(insn, target);
   ndrc_add_jump_out(vaddr, stub);
 
-#if defined(__aarch64__) || defined(NO_WRITE_EXEC)
-  // arm64: no syscall concerns, dyna_linker lacks stale detection
+#if defined(__aarch64__) || defined(__riscv) || defined(NO_WRITE_EXEC)
+  // arm64/rv64: no syscall concerns, dyna_linker lacks stale detection
   // w^x: have to do costly permission switching anyway
   new_dyna_clear_cache(NDRC_WRITE_OFFSET(insn), NDRC_WRITE_OFFSET(insn_end));
 #endif
@@ -3239,6 +3676,41 @@ static void load_assemble(int i, const struct regstat *i_regs, int ccadj_)
    host_tempreg_release();
 }
 
+#ifdef HAVE_UNALIGNED_LDST
+// A lwl/lwr (swl/swr) pair marked by pass2a_unneeded. When the whole word
+// is in RAM the head does one unaligned access and the tail skips its own,
+// anything else goes through the usual split sequence.
+static int lr_pair_fused(int i)
+{
+  int h = dops[i].lr_tail ? i - 1 : i;
+  int k, s;
+  if (!dops[i].lr_head && !dops[i].lr_tail)
+    return 0;
+  // both halves must take the same path
+  for (k = h; k <= h + 1; k++) {
+    u_int cmask = dops[k].itype == LOADLR ? regs[k].wasconst : regs[k].isconst;
+    s = get_reg(regs[k].regmap, dops[k].rs1);
+    if (s >= 0 && ((cmask >> s) & 1))
+      return 0;
+    if (dops[k].itype == LOADLR) {
+      if (get_reg_w(regs[k].regmap, dops[k].rt1) < 0
+          || get_reg_temp(regs[k].regmap) < 0)
+        return 0;
+    }
+    else if (get_reg(regs[k].regmap, FTEMP) < 0)
+      return 0;
+  }
+  return 1;
+}
+
+// V set if the word at addr+ofs is all in RAM
+static void emit_lr_pair_ram_check(int addr, int ofs, int t)
+{
+  emit_addimm(addr, ofs, t);
+  emit_cmpimm(t, RAM_SIZE - 3);
+}
+#endif
+
 #ifndef loadlr_assemble
 static void loadlr_assemble(int i, const struct regstat *i_regs, int ccadj_)
 {
@@ -3246,6 +3718,7 @@ static void loadlr_assemble(int i, const struct regstat *i_regs, int ccadj_)
   int s,tl,temp,temp2;
   int offset;
   void *jaddr=0;
+  void *fused_done=0;
   int memtarget=0,c=0;
   int offset_reg = -1;
   int fastio_reg_override = -1;
@@ -3263,6 +3736,27 @@ static void loadlr_assemble(int i, const struct regstat *i_regs, int ccadj_)
       memtarget=((signed int)(constmap[i][s]+offset))<(signed int)0x80000000+RAM_SIZE;
     }
   }
+#ifdef HAVE_UNALIGNED_LDST
+  if (!c && lr_pair_fused(i)) {
+    emit_lr_pair_ram_check(addr, (dops[i].opcode & 4) ? 0 : -3, temp);
+    if (dops[i].lr_tail) {
+      // the head loaded all of it
+      fused_done = out;
+      emit_jo(0);
+    }
+    else {
+      void *split = out;
+      emit_jno(0);
+      if (ram_offset)
+        offset_reg = get_ro_reg(i_regs, 0);
+      do_load_word(temp, tl, offset_reg);
+      offset_reg = -1;
+      fused_done = out;
+      emit_jmp(0);
+      set_jump_target(split, out);
+    }
+  }
+#endif
   if(!c) {
     emit_shlimm(addr,3,temp);
     if (dops[i].opcode==0x22||dops[i].opcode==0x26) {
@@ -3317,6 +3811,8 @@ static void loadlr_assemble(int i, const struct regstat *i_regs, int ccadj_)
   if (dops[i].opcode==0x1A||dops[i].opcode==0x1B) { // LDL/LDR
     assert(0);
   }
+  if (fused_done)
+    set_jump_target(fused_done, out);
 }
 #endif
 
@@ -3356,6 +3852,10 @@ static void do_store_smc_check(int i, const struct regstat *i_regs, u_int reglis
 {
   if (HACK_ENABLED(NDHACK_NO_SMC_CHECK))
     return;
+#ifdef NDRC_SMC_PROTECT
+  if (smc_prot.block)
+    return;
+#endif
   // this can't be used any more since we started to check exact
   // block boundaries in invalidate_range()
   //if (i_regs->waswritten & (1<<dops[i].rs1))
@@ -3511,6 +4011,7 @@ static void storelr_assemble(int i, const struct regstat *i_regs, int ccadj_)
   void *jaddr=0;
   void *case1, *case23, *case3;
   void *done0, *done1, *done2;
+  void *fused_done=0;
   int memtarget=0,c=0;
   int offset_reg = -1;
   u_int addr_const = ~0;
@@ -3528,6 +4029,28 @@ static void storelr_assemble(int i, const struct regstat *i_regs, int ccadj_)
   assert(tl>=0);
   assert(addr >= 0);
   reglist |= 1u << addr;
+#ifdef HAVE_UNALIGNED_LDST
+  if (!c && lr_pair_fused(i)) {
+    int ft = get_reg(i_regs->regmap, FTEMP);
+    emit_lr_pair_ram_check(addr, (dops[i].opcode & 4) ? 0 : -3, ft);
+    if (dops[i].lr_tail) {
+      // the head stored all of it, only the smc check is left
+      fused_done = out;
+      emit_jo(0);
+    }
+    else {
+      void *split = out;
+      emit_jno(0);
+      if (ram_offset)
+        offset_reg = get_ro_reg(i_regs, 0);
+      do_store_word(ft, 0, tl, offset_reg, 1);
+      offset_reg = -1;
+      fused_done = out;
+      emit_jmp(0);
+      set_jump_target(split, out);
+    }
+  }
+#endif
   if(!c) {
     emit_cmpimm(addr, RAM_SIZE);
     jaddr=out;
@@ -3614,6 +4137,8 @@ static void storelr_assemble(int i, const struct regstat *i_regs, int ccadj_)
     host_tempreg_release();
   if (!c || !memtarget)
     add_stub_r(STORELR_STUB,jaddr,out,i,addr,i_regs,ccadj_,reglist);
+  if (fused_done)
+    set_jump_target(fused_done, out);
   if (!c || is_ram_addr(addr_const))
     do_store_smc_check(i, i_regs, reglist, addr);
 }
@@ -3959,7 +4484,7 @@ static void cop2_put_dreg(u_int copr,signed char sl,signed char temp)
       break;
     case 30:
       emit_xorsar_imm(sl,sl,31,temp);
-#if defined(HAVE_ARMV5) || defined(__aarch64__)
+#if defined(HAVE_ARMV5) || defined(__aarch64__) || defined(__riscv)
       emit_clz(temp,temp);
 #else
       emit_movs(temp,HOST_TEMPREG);
@@ -4478,6 +5003,21 @@ static void ds_assemble(int i, const struct regstat *i_regs)
   is_delayslot = 0;
 }
 
+#ifdef NDRC_THREAD
+// remember a not yet compiled exit for the compile thread to try next
+static void spec_add(u_int vaddr)
+{
+  int i, n = ndrc_g.thread.spec_count;
+  if (n >= NDRC_SPEC_MAX)
+    return;
+  for (i = 0; i < n; i++)
+    if (ndrc_g.thread.spec_addrs[i] == vaddr)
+      return;
+  ndrc_g.thread.spec_addrs[n] = vaddr;
+  ndrc_g.thread.spec_count = n + 1;
+}
+#endif
+
 // Is the branch target a valid internal jump?
 static int internal_branch(int addr)
 {
@@ -4816,22 +5356,15 @@ static void wb_dirtys(const signed char i_regmap[], u_int i_dirty)
 // This writes the registers not written by store_regs_bt
 static void wb_needed_dirtys(const signed char i_regmap[], u_int i_dirty, int addr)
 {
-  int hr;
   int t=(addr-start)>>2;
+  u_int mask = 0;
+  int hr;
+  // wb_dirtys does the rest, it may pair the stores
   for(hr=0;hr<HOST_REGS;hr++) {
-    if(hr!=EXCLUDE_REG) {
-      if(i_regmap[hr]>0) {
-        if(i_regmap[hr]!=CCREG) {
-          if(i_regmap[hr]==regs[t].regmap_entry[hr] && ((regs[t].dirty>>hr)&1)) {
-            if((i_dirty>>hr)&1) {
-              assert(i_regmap[hr]<64);
-              emit_storereg(i_regmap[hr],hr);
-            }
-          }
-        }
-      }
-    }
+    if(i_regmap[hr]==regs[t].regmap_entry[hr] && ((regs[t].dirty>>hr)&1))
+      mask |= 1u << hr;
   }
+  wb_dirtys(i_regmap, i_dirty & mask);
 }
 
 // Load all registers (except cycle count)
@@ -4885,20 +5418,21 @@ static void store_regs_bt(signed char i_regmap[],uint64_t i_dirty,int addr)
   if(internal_branch(addr))
   {
     int t=(addr-start)>>2;
+    u_int mask = 0;
     int hr;
     for(hr=0;hr<HOST_REGS;hr++) {
-      if(hr!=EXCLUDE_REG) {
-        if(i_regmap[hr]>0 && i_regmap[hr]!=CCREG) {
-          if(i_regmap[hr]!=regs[t].regmap_entry[hr] || !((regs[t].dirty>>hr)&1)) {
-            if((i_dirty>>hr)&1) {
-              assert(i_regmap[hr]<64);
-              if(!((unneeded_reg[t]>>i_regmap[hr])&1))
-                emit_storereg(i_regmap[hr],hr);
-            }
+      if(hr!=EXCLUDE_REG && i_regmap[hr]>0 && i_regmap[hr]!=CCREG) {
+        if(i_regmap[hr]!=regs[t].regmap_entry[hr] || !((regs[t].dirty>>hr)&1)) {
+          if((i_dirty>>hr)&1) {
+            assert(i_regmap[hr]<64);
+            if(!((unneeded_reg[t]>>i_regmap[hr])&1))
+              mask |= 1u << hr;
           }
         }
       }
     }
+    // wb_dirtys may pair the stores
+    wb_dirtys(i_regmap, mask);
   }
   else
   {
@@ -4913,6 +5447,7 @@ static void load_regs_bt(signed char i_regmap[],uint64_t i_dirty,int addr)
   //if(addr>=start && addr<(start+slen*4))
   if(internal_branch(addr))
   {
+    signed char regmap_sel[HOST_REGS];
     int t=(addr-start)>>2;
     int hr;
     // Store the cycle count before loading something else
@@ -4922,20 +5457,14 @@ static void load_regs_bt(signed char i_regmap[],uint64_t i_dirty,int addr)
     if(regs[t].regmap_entry[HOST_CCREG]!=CCREG) {
       emit_storereg(CCREG,HOST_CCREG);
     }
-    // Load 32-bit regs
+    // Load 32-bit regs, through load_all_regs so they may get paired
     for(hr=0;hr<HOST_REGS;hr++) {
-      if(hr!=EXCLUDE_REG&&regs[t].regmap_entry[hr]>=0&&regs[t].regmap_entry[hr]<TEMPREG) {
-        if(i_regmap[hr]!=regs[t].regmap_entry[hr]) {
-          if(regs[t].regmap_entry[hr]==0) {
-            emit_zeroreg(hr);
-          }
-          else if(regs[t].regmap_entry[hr]!=CCREG)
-          {
-            emit_loadreg(regs[t].regmap_entry[hr],hr);
-          }
-        }
-      }
+      regmap_sel[hr] = -1;
+      if(regs[t].regmap_entry[hr]>=0&&regs[t].regmap_entry[hr]<TEMPREG)
+        if(i_regmap[hr]!=regs[t].regmap_entry[hr])
+          regmap_sel[hr] = regs[t].regmap_entry[hr];
     }
+    load_all_regs(regmap_sel);
   }
 }
 
@@ -5145,6 +5674,11 @@ static void do_cc(int i, const signed char i_regmap[], int *adj,
   {
     *adj=0;
   }
+  // a forward branch within the block can't loop, the cycles are still
+  // added by the caller but the event check waits for the next backward
+  // branch or the block exit
+  if (t > i && *adj && !invert && HACK_ENABLED(NDHACK_LAZY_CC))
+    return;
   count = cinfo[i].ccadj;
   count_plus2 = count + CLOCK_ADJUST(2);
   if(taken==TAKEN && i==(cinfo[i].ba-start)>>2 && source[i+1]==0) {
@@ -5606,6 +6140,30 @@ static void vsync_hack_assemble(int i, int ld_ofs, int cc)
   host_tempreg_release();
 }
 
+// the loop is known to spin until the next event, skip straight to it
+static void poll_loop_assemble(int i, int ld, int cc)
+{
+  void *t_exit = NULL;
+  int b;
+  if (!(poll_loop & 0x8000)) {
+    b = get_reg(branch_regs[i].regmap, dops[ld].rs1);
+    if (b < 0)
+      return;
+    assem_debug("; poll loop\n");
+    host_tempreg_acquire();
+    emit_addimm(b, cinfo[ld].imm, HOST_TEMPREG);
+    emit_cmpimm(HOST_TEMPREG, RAM_SIZE); // kseg0 RAM only
+    host_tempreg_release();
+    t_exit = out;
+    emit_jno(0);
+  }
+  else
+    assem_debug("; poll loop (const)\n");
+  emit_zeroreg(cc);
+  if (t_exit)
+    set_jump_target(t_exit, out);
+}
+
 static void cjump_assemble(int i, const struct regstat *i_regs)
 {
   const signed char *i_regmap = i_regs->regmap;
@@ -5620,10 +6178,11 @@ static void cjump_assemble(int i, const struct regstat *i_regs)
   if(i==(cinfo[i].ba-start)>>2) assem_debug("idle loop\n");
   if(!match) invert=1;
   if (vsync_hack && (vsync_hack >> 16) == i) invert=1;
+  if (poll_loop && (poll_loop >> 16) == i) invert=1;
   #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
   if(i>(cinfo[i].ba-start)>>2) invert=1;
   #endif
-  #ifdef __aarch64__
+  #if defined(__aarch64__) || defined(__riscv)
   invert=1; // because of near cond. branches
   #endif
 
@@ -5756,6 +6315,8 @@ static void cjump_assemble(int i, const struct regstat *i_regs)
         if(taken) set_jump_target(taken, out);
         if (vsync_hack && (vsync_hack >> 16) == i)
           vsync_hack_assemble(i, vsync_hack & 0xffff, cc);
+        if (poll_loop && (poll_loop >> 16) == i)
+          poll_loop_assemble(i, poll_loop & 0x7fff, cc);
         #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
         if (match && (!internal || !dops[(cinfo[i].ba-start)>>2].is_ds)) {
           if(adj) {
@@ -5918,7 +6479,7 @@ static void sjump_assemble(int i, const struct regstat *i_regs)
   #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
   if(i>(cinfo[i].ba-start)>>2) invert=1;
   #endif
-  #ifdef __aarch64__
+  #if defined(__aarch64__) || defined(__riscv)
   invert=1; // because of near cond. branches
   #endif
 
@@ -6308,10 +6869,17 @@ static noinline void new_dynarec_test(void)
   size_t i;
 
   // check structure linkage
-  if ((u_char *)rcnts - (u_char *)&psxRegs != sizeof(psxRegs))
+  #define PSXREGS_OFS(f) ((u_char *)&psxRegs.f - (u_char *)&psxRegs)
+  if ((u_char *)rcnts - (u_char *)&psxRegs != sizeof(psxRegs)
+      || PSXREGS_OFS(next_interupt) != LO_next_interupt - LO_psxRegs
+      || PSXREGS_OFS(stop) != LO_stop - LO_psxRegs
+      || PSXREGS_OFS(CP0) != LO_reg_cop0 - LO_psxRegs
+      || PSXREGS_OFS(intCycle) != LO_intCycle - LO_psxRegs
+      || PSXREGS_OFS(CP2D) != LO_reg_cop2d - LO_psxRegs)
   {
     SysPrintf("linkage_arm* miscompilation/breakage detected.\n");
   }
+  #undef PSXREGS_OFS
 
   SysPrintf("(%p) testing if we can run recompiled code @%p...\n",
     new_dynarec_test, out);
@@ -6348,16 +6916,27 @@ void new_dynarec_clear_full(void)
   int n;
   out = ndrc->translation_cache;
   memset(invalid_code,1,sizeof(invalid_code));
+#ifdef NDRC_SMC_PROTECT
+  smc_prot_all(0);
+#endif
   memset(shadow,0,sizeof(shadow));
   hash_table_clear();
   mini_ht_clear();
+  tier_clear();
   copy=shadow;
-  expirep = EXPIRITY_OFFSET;
+  tc_gen = TC_GEN_NURSERY;
+  tc_out[TC_GEN_NURSERY] = ndrc->translation_cache;
+  tc_out[TC_GEN_TENURED] = ndrc->translation_cache + TC_TENURED_START;
+  expirep[TC_GEN_NURSERY] = EXPIRITY_OFFSET;
+  expirep[TC_GEN_TENURED] = TC_TENURED_START + EXPIRITY_OFFSET;
+  if (tenure_set)
+    memset(tenure_set, 0xff, TENURE_SET_SIZE * sizeof(tenure_set[0]));
   literalcount=0;
   stop_after_jal=0;
   ni_count=0;
   err_print_count=0;
   inv_code_start=inv_code_end=~0;
+  inv_bulk_start = inv_bulk_end = ~0;
   hack_addr=0;
   f1_hack=0;
   for (n = 0; n < ARRAY_SIZE(blocks); n++)
@@ -6393,8 +6972,16 @@ static int pgsize(void)
 void new_dynarec_init(void)
 {
   int align = pgsize() - 1;
-  SysPrintf("Init new dynarec, ndrc size %x, pgsize %d\n",
-    (int)sizeof(*ndrc), align + 1);
+  tc_size = 1u << TARGET_SIZE_2;
+  if (Config.MemBudgetMB > 0) {
+    // a quarter of the budget, whole MBs so both generations stay made
+    // of MAX_OUTPUT_BLOCK_SIZE chunks, 4M minimum for the tenured part
+    u_int limit = max(Config.MemBudgetMB / 4, 4) << 20;
+    if (limit < tc_size)
+      tc_size = limit;
+  }
+  SysPrintf("Init new dynarec, ndrc size %x, pgsize %d, tcache %uK\n",
+    (int)sizeof(*ndrc), align + 1, (u_int)TC_TENURED_END >> 10);
 
 #ifdef BASE_ADDR_DYNAMIC
   #ifdef VITA
@@ -6444,6 +7031,8 @@ void new_dynarec_init(void)
     SysPrintf("mmap() failed: %s\n", strerror(errno));
     abort();
   }
+  // the aligned desired_addr allows transparent huge pages
+  psxMapAdviseHuge(ndrc, sizeof(*ndrc), MAP_TAG_TCACHE);
   #ifdef TC_WRITE_OFFSET
   ndrc_write_ofs = (char *)mw - (char *)ndrc;
   #endif
@@ -6473,6 +7062,9 @@ void new_dynarec_init(void)
   ram_offset = (uintptr_t)psxM - 0x80000000;
   if (ram_offset != 0)
     SysPrintf("RAM is not directly mapped\n");
+#ifdef NDRC_SMC_PROTECT
+  smc_prot_init();
+#endif
   SysPrintf("Mapped (RAM/scrp/ROM/LUTs/TC):\n");
   SysPrintf("%p/%p/%p/%p/%p\n", psxM, psxH, psxR, mem_rtab, out);
 }
@@ -6480,6 +7072,14 @@ void new_dynarec_init(void)
 void new_dynarec_cleanup(void)
 {
   int n;
+#ifdef NDRC_SMC_PROTECT
+  smc_prot_finish();
+#endif
+  if (hash_table != hash_table_initial) {
+    free(hash_table);
+    hash_table = hash_table_ptr = hash_table_initial;
+    hash_table_mask = HASH_TABLE_MIN - 1;
+  }
 #ifdef BASE_ADDR_DYNAMIC
   #ifdef VITA
   // sceBlock is managed by retroarch's bootstrap code
@@ -6489,6 +7089,7 @@ void new_dynarec_cleanup(void)
   jitClose(&g_jit);
   ndrc = NULL;
   #else
+  psxMapForgetHuge(ndrc);
   if (munmap(ndrc, sizeof(*ndrc)) < 0)
     SysPrintf("munmap() failed\n");
   ndrc = NULL;
@@ -6502,6 +7103,14 @@ void new_dynarec_cleanup(void)
   }
   stat_clear(stat_blocks);
   stat_clear(stat_links);
+  new_dynarec_load_cache(NULL, 0);
+  free(tenure_set);
+  tenure_set = NULL;
+  if (tc_stats.compiles[0] + tc_stats.compiles[1])
+    SysPrintf("drc: tc %u+%u compiles (nursery+tenured), %u live blocks "
+      "expired, %u/%u wraps\n", tc_stats.compiles[0], tc_stats.compiles[1],
+      tc_stats.expired_live, tc_stats.wraps[0], tc_stats.wraps[1]);
+  memset(&tc_stats, 0, sizeof(tc_stats));
   new_dynarec_print_stats();
 }
 
@@ -6650,6 +7259,152 @@ void new_dynarec_load_blocks(const void *save, int size)
   memcpy(&psxRegs.GPR, regs_save, sizeof(regs_save));
 }
 
+// Persistent block cache.
+// Unlike the savestate list above, this is meant to outlive the session:
+// it records where blocks were and a hash of their source, and once code
+// with a matching hash shows up in RAM again, all known blocks of that page
+// are compiled in one go instead of trickling in one miss at a time.
+// Host code itself is not stored as it's full of absolute pointers.
+struct cache_block {
+  uint32_t addr;
+  uint32_t len;     // 0 - already consumed
+  uint32_t hash;
+  uint32_t regflags;
+};
+
+static struct cache_block *cache_blocks;
+static int cache_block_count;
+static struct {
+  u_int first;
+  u_int count;
+} cache_pages[PAGE_COUNT];
+
+static uint32_t source_hash(const u_int *src, u_int len)
+{
+  uint32_t h = 0x811c9dc5;
+  u_int i;
+  for (i = 0; i < len / 4; i++)
+    h = (h ^ src[i]) * 0x01000193;
+  return h;
+}
+
+static int cache_block_cmp(const void *p1_, const void *p2_)
+{
+  const struct cache_block *p1 = p1_, *p2 = p2_;
+  u_int pg1 = get_page(p1->addr), pg2 = get_page(p2->addr);
+  if (pg1 != pg2)
+    return pg1 < pg2 ? -1 : 1;
+  return p1->addr < p2->addr ? -1 : (p1->addr > p2->addr);
+}
+
+static noinline void cache_blocks_compile(u_int vaddr)
+{
+  u_int page = get_page(vaddr);
+  u_int regs_save[32];
+  u_int i, r, limit, compiled = 0;
+  uint32_t f;
+
+  if (cache_pages[page].count == 0)
+    return;
+
+  memcpy(regs_save, ndrc_smrv_regs, sizeof(regs_save));
+  for (i = cache_pages[page].first;
+       i < cache_pages[page].first + cache_pages[page].count; i++)
+  {
+    struct cache_block *cb = &cache_blocks[i];
+    const u_int *src;
+    if (cb->len == 0)
+      continue;
+    if (cb->addr == vaddr) {
+      // the caller is about to compile this one anyway
+      cb->len = 0;
+      continue;
+    }
+    src = get_source_start(cb->addr, &limit);
+    if (src == NULL || cb->addr + cb->len > limit) {
+      cb->len = 0;
+      continue;
+    }
+    if (source_hash(src, cb->len) != cb->hash)
+      continue; // different code here now, may still show up later
+    cb->len = 0;
+    if (ndrc_get_addr_ht_param(hash_table, cb->addr, ndrc_cm_no_compile))
+      continue;
+
+    for (r = 1; r < 32; r++)
+      ndrc_smrv_regs[r] = 0x80000000;
+    for (f = cb->regflags, r = 0; f; f >>= 1, r++)
+      if (f & 1)
+        ndrc_smrv_regs[r] = 0x1f800000;
+    if (new_recompile_block(cb->addr) == 0)
+      compiled++;
+  }
+  memcpy(ndrc_smrv_regs, regs_save, sizeof(regs_save));
+  if (compiled)
+    inv_debug("cache: page %03x: %u blocks precompiled\n", page, compiled);
+}
+
+int new_dynarec_save_cache(void *save, int size)
+{
+  struct cache_block *cblocks = save;
+  int maxcount = size / sizeof(cblocks[0]);
+  struct block_info *block;
+  int p, i, o = 0;
+
+  for (p = 0; p < ARRAY_SIZE(blocks); p++) {
+    for (block = blocks[p]; block != NULL && o < maxcount; block = block->next) {
+      if (block->is_dirty || !block->source)
+        continue;
+      cblocks[o].addr = block->start;
+      cblocks[o].len = block->len;
+      cblocks[o].hash = source_hash(block->source, block->len);
+      cblocks[o].regflags = block->reg_sv_flags;
+      o++;
+    }
+  }
+  // keep what this session didn't get to
+  for (i = 0; i < cache_block_count && o < maxcount; i++)
+    if (cache_blocks[i].len != 0)
+      cblocks[o++] = cache_blocks[i];
+
+  return o * sizeof(cblocks[0]);
+}
+
+void new_dynarec_load_cache(const void *save, int size)
+{
+  int count = size / sizeof(cache_blocks[0]);
+  u_int limit, page;
+  int i, o;
+
+  free(cache_blocks);
+  cache_blocks = NULL;
+  cache_block_count = 0;
+  memset(cache_pages, 0, sizeof(cache_pages));
+  if (count <= 0)
+    return;
+
+  cache_blocks = malloc(count * sizeof(cache_blocks[0]));
+  if (cache_blocks == NULL)
+    return;
+  memcpy(cache_blocks, save, count * sizeof(cache_blocks[0]));
+  for (i = o = 0; i < count; i++) {
+    const struct cache_block *cb = &cache_blocks[i];
+    if ((cb->addr & 3) || cb->len == 0 || (cb->len & 3) || cb->len > MAXBLOCK * 4)
+      continue;
+    if (get_source_start(cb->addr, &limit) == NULL || cb->addr + cb->len > limit)
+      continue;
+    cache_blocks[o++] = *cb;
+  }
+  qsort(cache_blocks, o, sizeof(cache_blocks[0]), cache_block_cmp);
+  for (i = 0; i < o; i++) {
+    page = get_page(cache_blocks[i].addr);
+    if (cache_pages[page].count++ == 0)
+      cache_pages[page].first = i;
+  }
+  cache_block_count = o;
+  SysPrintf("drc: %d cached block entries\n", o);
+}
+
 void new_dynarec_print_stats(void)
 {
 #ifdef STAT_PRINT
@@ -6664,6 +7419,14 @@ void new_dynarec_print_stats(void)
 #endif
 }
 
+void new_dynarec_get_stats(struct ndrc_stats *stats)
+{
+  *stats = ndrc_g.stats;
+  stats->ht_size = (hash_table_mask + 1) * 2;
+  stats->tc_used = out - ndrc->translation_cache;
+  stats->tc_size = TC_TENURED_END;
+}
+
 static void force_intcall(int i)
 {
   memset(&dops[i], 0, sizeof(dops[i]));
@@ -6718,12 +7481,88 @@ static noinline void do_vsync(int i)
   vsync_hack = (j << 16) | (cinfo[t].imm & 0xffff);
 }
 
+// A short loop that only loads from RAM and tests the result, like
+// "while (!vsync_flag);". Nothing it reads can change before the next
+// event, so once it's taken it may as well jump there. Outputs must not
+// feed the next iteration, and only one load is allowed so that a
+// single address check covers it.
+static int is_poll_loop(int t, int j)
+{
+  uint64_t written = 0, defined = 0;
+  u_int addr;
+  int k, r, ld = -1, lui;
+
+  for (k = t; k < j; k++) {
+    switch (dops[k].itype) {
+      case NOP:
+        continue;
+      case LOAD:
+        if (ld >= 0)
+          return -1;
+        ld = k;
+        break;
+      case ALU: case IMM16: case SHIFTIMM:
+        break;
+      default:
+        return -1;
+    }
+    written |= 1ull << dops[k].rt1;
+  }
+  for (k = t; k <= j; k++) {
+    if (dops[k].itype == NOP)
+      continue;
+    r = dops[k].rs1;
+    if (r && ((written >> r) & 1) && !((defined >> r) & 1))
+      return -1;
+    r = dops[k].rs2;
+    if (r && ((written >> r) & 1) && !((defined >> r) & 1))
+      return -1;
+    defined |= 1ull << dops[k].rt1;
+  }
+  if (ld < 0 || !dops[ld].rt1)
+    return -1;
+  if (!((written >> dops[ld].rs1) & 1))
+    return ld;
+  // lui base, hi; lw x, lo(base)
+  for (k = ld - 1; k >= t; k--)
+    if (dops[k].itype != NOP && dops[k].rt1 == dops[ld].rs1)
+      break;
+  if (k < t || dops[k].opcode != 0x0f)
+    return -1;
+  lui = k;
+  addr = (cinfo[lui].imm << 16) + cinfo[ld].imm;
+  return is_ram_addr(addr) ? (ld | 0x8000) : -1;
+}
+
+static void find_poll_loop(void)
+{
+  int j, t, ld;
+
+  for (j = 1; j < slen - 1; j++) {
+    // beq/bne back into the block with a nop in the delay slot
+    if (dops[j].itype != CJUMP || (dops[j].opcode & 0x3e) != 4
+        || source[j+1] != 0 || cinfo[j].ba < start)
+      continue;
+    t = (cinfo[j].ba - start) / 4;
+    if (t >= j || j - t > 8 || dops[t].is_ds)
+      continue;
+    ld = is_poll_loop(t, j);
+    if (ld >= 0) {
+      assem_debug("poll loop @%08x\n", start + t*4);
+      poll_loop = (j << 16) | ld;
+      break;
+    }
+  }
+}
+
 static int apply_hacks(void)
 {
   int i;
   vsync_hack = 0;
+  poll_loop = 0;
   if (HACK_ENABLED(NDHACK_NO_COMPAT_HACKS))
     return 0;
+  find_poll_loop();
   /* special hack(s) */
   for (i = 0; i < slen - 4; i++)
   {
@@ -7463,6 +8302,21 @@ static noinline void pass2a_unneeded(void)
           break;
       }
     }
+#ifdef HAVE_UNALIGNED_LDST
+    // lwl/lwr (swl/swr) on one word, see lr_pair_fused()
+    if ((dops[i].itype == LOADLR || dops[i].itype == STORELR) && i < slen - 1
+        && !dops[i].lr_tail && !dops[i].is_ds && !dops[i+1].bt
+        && dops[i+1].opcode == (dops[i].opcode ^ 4)
+        && dops[i+1].rs1 == dops[i].rs1 && dops[i].rs1 != 0
+        && cinfo[i].imm - cinfo[i+1].imm == ((dops[i].opcode & 4) ? -3 : 3)
+        && (dops[i].itype == STORELR ? dops[i+1].rs2 == dops[i].rs2
+            : dops[i+1].rt1 == dops[i].rt1 && dops[i].rt1 != 0
+              && dops[i].rt1 != dops[i].rs1))
+    {
+      dops[i].lr_head = 1;
+      dops[i+1].lr_tail = 1;
+    }
+#endif
     // rm redundant stack loads (unoptimized code, assuming no io mem access through sp)
     if (i > 0 && dops[i].is_load && dops[i].rs1 == 29 && dops[i].ls_type == LS_32
         && dops[i-1].is_store && dops[i-1].rs1 == 29 && dops[i-1].ls_type == LS_32
@@ -9108,21 +9962,27 @@ static noinline void pass6_clean_registers(int istart, int iend, int wr)
   }
 }
 
+// only the generation that was just written to is expired,
+// both are made of whole MAX_OUTPUT_BLOCK_SIZE chunks
 static noinline void pass10_expire_blocks(void)
 {
   u_int step = MAX_OUTPUT_BLOCK_SIZE / PAGE_COUNT / 2;
-  // not sizeof(ndrc->translation_cache) due to vita hack
-  u_int step_mask = ((1u << TARGET_SIZE_2) - 1u) & ~(step - 1u);
-  u_int end = (out - ndrc->translation_cache + EXPIRITY_OFFSET) & step_mask;
+  u_int gen_start = tc_gen_start(tc_gen), gen_end = tc_gen_end(tc_gen);
+  u_int end = out - ndrc->translation_cache + EXPIRITY_OFFSET;
   u_int base_shift = __builtin_ctz(MAX_OUTPUT_BLOCK_SIZE);
+  u_int ep = expirep[tc_gen];
   int hit;
 
-  for (; expirep != end; expirep = ((expirep + step) & step_mask))
+  if (end >= gen_end)
+    end -= gen_end - gen_start;
+  end &= ~(step - 1u);
+
+  for (; ep != end; ep = (ep + step < gen_end ? ep + step : gen_start))
   {
-    u_int base_offs = expirep & ~(MAX_OUTPUT_BLOCK_SIZE - 1);
-    u_int block_i = expirep / step & (PAGE_COUNT - 1);
-    u_int phase = (expirep >> (base_shift - 1)) & 1u;
-    if (!(expirep & (MAX_OUTPUT_BLOCK_SIZE / 2 - 1))) {
+    u_int base_offs = ep & ~(MAX_OUTPUT_BLOCK_SIZE - 1);
+    u_int block_i = ep / step & (PAGE_COUNT - 1);
+    u_int phase = (ep >> (base_shift - 1)) & 1u;
+    if (!(ep & (MAX_OUTPUT_BLOCK_SIZE / 2 - 1))) {
       inv_debug("EXP: base_offs %x/%lx phase %u\n", base_offs,
         (long)(out - ndrc->translation_cache), phase);
     }
@@ -9137,6 +9997,87 @@ static noinline void pass10_expire_blocks(void)
     else
       unlink_jumps_tc_range(jumps[block_i], base_offs, base_shift);
   }
+  expirep[tc_gen] = ep;
+}
+
+// block profiler, see NDHACK_BLOCK_PROFILE
+// entries are never freed so that generated code can point at them
+struct block_prof
+{
+  u_int vaddr;     // ~0 - unused
+  u_int execs;     // incremented by generated code on each block entry
+  u_int compiles;
+  u_int host_size; // of the last compile
+};
+
+#define BLOCK_PROF_SIZE 16384
+static struct block_prof *block_prof;
+
+static struct block_prof *block_prof_get(u_int vaddr)
+{
+  u_int i, n, h = ((vaddr >> 2) ^ (vaddr >> 17)) & (BLOCK_PROF_SIZE - 1);
+  if (block_prof == NULL) {
+    block_prof = malloc(BLOCK_PROF_SIZE * sizeof(block_prof[0]));
+    if (block_prof == NULL)
+      return NULL;
+    memset(block_prof, 0, BLOCK_PROF_SIZE * sizeof(block_prof[0]));
+    for (i = 0; i < BLOCK_PROF_SIZE; i++)
+      block_prof[i].vaddr = ~0;
+  }
+  for (n = 0; n < 16; n++, h = (h + 1) & (BLOCK_PROF_SIZE - 1)) {
+    if (block_prof[h].vaddr == vaddr)
+      return &block_prof[h];
+    if (block_prof[h].vaddr == ~0) {
+      block_prof[h].vaddr = vaddr;
+      return &block_prof[h];
+    }
+  }
+  return NULL; // full, leave this block uncounted
+}
+
+static int block_prof_cmp(const void *p1_, const void *p2_)
+{
+  const struct block_prof *p1 = p1_, *p2 = p2_;
+  if (p1->execs != p2->execs)
+    return p1->execs < p2->execs ? 1 : -1;
+  return p1->vaddr < p2->vaddr ? -1 : (p1->vaddr > p2->vaddr);
+}
+
+int new_dynarec_dump_profile(const char *fname)
+{
+  struct block_prof *sorted;
+  unsigned long long total = 0;
+  int i, count;
+  FILE *f;
+
+  if (block_prof == NULL)
+    return -1;
+  sorted = malloc(BLOCK_PROF_SIZE * sizeof(sorted[0]));
+  if (sorted == NULL)
+    return -1;
+  for (i = count = 0; i < BLOCK_PROF_SIZE; i++) {
+    if (block_prof[i].vaddr == ~0)
+      continue;
+    sorted[count++] = block_prof[i];
+    total += block_prof[i].execs;
+  }
+  qsort(sorted, count, sizeof(sorted[0]), block_prof_cmp);
+
+  f = fopen(fname, "w");
+  if (f == NULL) {
+    free(sorted);
+    return -1;
+  }
+  fprintf(f, "# %d blocks, %llu entries total\n", count, total);
+  fprintf(f, "# vaddr    host_bytes  entries  %%  compiles\n");
+  for (i = 0; i < count; i++)
+    fprintf(f, "%08x %10u %10u %5.2f %6u\n", sorted[i].vaddr,
+      sorted[i].host_size, sorted[i].execs,
+      total ? sorted[i].execs * 100.0 / total : 0.0, sorted[i].compiles);
+  fclose(f);
+  free(sorted);
+  SysPrintf("drc: block profile (%d blocks) written to %s\n", count, fname);
+  return 0;
 }
 
 static struct block_info *new_block_info(u_int start, u_int len,
@@ -9196,6 +10137,11 @@ static int noinline new_recompile_block(u_int addr)
 
   start = addr;
   ndrc_g.did_compile++;
+#ifdef NDRC_SMC_PROTECT
+  smc_prot.block = smc_prot_usable();
+#endif
+  tc_set_gen(is_tenured(addr) ? TC_GEN_TENURED : TC_GEN_NURSERY);
+  tc_stats.compiles[tc_gen]++;
   if (Config.HLE && start == 0x80001000) // hlecall
   {
     void *beginning = start_block();
@@ -9515,8 +10461,13 @@ static int noinline new_recompile_block(u_int addr)
         set_jump_target(link_addr[i].addr, addr);
         ndrc_add_jump_out(link_addr[i].target,stub);
       }
-      else
+      else {
         set_jump_target(link_addr[i].addr, stub);
+#ifdef NDRC_THREAD
+        if (ndrc_g.thread.handle)
+          spec_add(link_addr[i].target);
+#endif
+      }
     }
     else
     {
@@ -9554,6 +10505,10 @@ static int noinline new_recompile_block(u_int addr)
     new_block_info(start, slen * 4, source, copy, beginning, jump_in_count);
   block->reg_sv_flags = state_rflags;
 
+  struct block_prof *prof = NULL;
+  if (HACK_ENABLED(NDHACK_BLOCK_PROFILE))
+    prof = block_prof_get(start);
+
   int jump_in_i = 0;
   for (i = 0; i < slen; i++)
   {
@@ -9564,6 +10519,8 @@ static int noinline new_recompile_block(u_int addr)
 
       literal_pool(256);
       void *entry = out;
+      if (prof)
+        emit_inc_counter(&prof->execs);
       load_regs_entry(i);
       if (entry == out)
         entry = instr_addr[i];
@@ -9584,16 +10541,25 @@ static int noinline new_recompile_block(u_int addr)
   if(((u_int)out)&7) emit_addnop(13);
   #endif
   assert(out - (u_char *)beginning < MAX_OUTPUT_BLOCK_SIZE);
+  if (prof) {
+    prof->compiles++;
+    prof->host_size = out - (u_char *)beginning;
+  }
   //printf("shadow buffer: %p-%p\n",copy,(u_char *)copy+slen*4);
   memcpy(copy, source, source_len);
   copy += source_len;
 
   end_block(beginning);
+  ndrc_g.stats.compiles++;
+  ndrc_g.stats.compiled_bytes += out - (u_char *)beginning;
 
-  // If we're within 256K of the end of the buffer,
-  // start over from the beginning. (Is 256K enough?)
-  if (out > ndrc->translation_cache + sizeof(ndrc->translation_cache) - MAX_OUTPUT_BLOCK_SIZE)
-    out = ndrc->translation_cache;
+  // If we're within 256K of the end of the generation's region,
+  // start over from its beginning. (Is 256K enough?)
+  if (out > ndrc->translation_cache + tc_gen_end(tc_gen) - MAX_OUTPUT_BLOCK_SIZE) {
+    out = ndrc->translation_cache + tc_gen_start(tc_gen);
+    tc_stats.wraps[tc_gen]++;
+    ndrc_g.stats.tc_wraps++;
+  }
 
   // Trap writes to any of the pages we compiled
   mark_invalid_code(start, slen*4, 0);
@@ -1,6 +1,7 @@
 #define NEW_DYNAREC 1
 
 #define MAXBLOCK 2048 // in mips instructions
+#define NDRC_SPEC_MAX 4 // successors the compile thread may precompile
 
 #define NDHACK_NO_SMC_CHECK	(1<<0)
 #define NDHACK_GTE_UNNEEDED	(1<<1)
@@ -10,6 +11,30 @@
 #define NDHACK_NO_COMPAT_HACKS	(1<<5)
 #define NDHACK_THREAD_FORCE   	(1<<6)
 #define NDHACK_THREAD_FORCE_ON	(1<<7)
+#define NDHACK_BLOCK_PROFILE	(1<<8) // not a hack, count block entries,
+				// "Profile blocks" in the menu, dumped on exit
+#define NDHACK_LAZY_CC		(1<<9) // event checks only on backward branches/exits
+#define NDHACK_TIERING		(1<<10) // interpret blocks until they run a few times
+
+// cumulative, see new_dynarec_get_stats()
+struct ndrc_stats
+{
+	unsigned int compiles;		// blocks compiled
+	unsigned int compiled_bytes;	// host code emitted for them
+	unsigned int restores;		// dirty blocks found unchanged and reused
+	unsigned int inv_smc;		// blocks invalidated by stores from psx code
+	unsigned int inv_dma;		// .. by DMA and other psxCpu->Clear() calls
+	unsigned int inv_reload;	// .. by savestate loads / ram replacement
+	unsigned int inv_prot;		// .. by writes to protected pages (any source)
+	unsigned int lookups;		// indirect jumps that missed the mini_ht
+	unsigned int ht_misses;		// .. and also the hash table (and jump cache)
+	unsigned int ht_evictions;	// hash table entries pushed out by collisions
+	unsigned int ht_size;		// hash table entries (grows with evictions)
+	unsigned int thread_waits;	// compile thread handoffs to the interpreter
+	unsigned int tc_used;		// translation cache bytes emitted into so far
+	unsigned int tc_size;		//  (a generation wraps when it gets full)
+	unsigned int tc_wraps;
+};
 
 struct ndrc_globals
 {
@@ -18,6 +43,7 @@ struct ndrc_globals
 	int hacks_old;
 	int did_compile;
 	int cycle_multiplier_old;
+	int tier_interp; // left to interpret a cold block at psxRegs.pc
 	struct {
 		void *handle;
 		void *lock;
@@ -25,8 +51,13 @@ struct ndrc_globals
 		void *dirty_start;
 		void *dirty_end;
 		unsigned int busy_addr; // 0 is valid, ~0 == none
+		// uncompiled direct branch targets of the busy_addr block,
+		// compiled right after it while the interpreter still runs
+		unsigned int spec_addrs[NDRC_SPEC_MAX];
+		int spec_count;
 		int exit;
 	} thread;
+	struct ndrc_stats stats;
 };
 extern struct ndrc_globals ndrc_g;
 
@@ -35,11 +66,17 @@ void new_dynarec_cleanup(void);
 void new_dynarec_clear_full(void);
 int  new_dynarec_save_blocks(void *save, int size);
 void new_dynarec_load_blocks(const void *save, int size);
+int  new_dynarec_save_cache(void *save, int size);
+void new_dynarec_load_cache(const void *save, int size);
 void new_dynarec_print_stats(void);
+void new_dynarec_get_stats(struct ndrc_stats *stats);
+int  new_dynarec_dump_profile(const char *fname);
 
 int  new_dynarec_quick_check_range(unsigned int start, unsigned int end);
 void new_dynarec_invalidate_range(unsigned int start, unsigned int end);
 void new_dynarec_invalidate_all_pages(void);
+void new_dynarec_invalidate_changed(void);
+void new_dynarec_sync_point(void);
 void new_dyna_clear_cache(void *start, void *end);
 
 void new_dyna_start(void *context);
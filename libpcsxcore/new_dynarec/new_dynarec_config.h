@@ -11,6 +11,8 @@
 //#define BASE_ADDR_DYNAMIC 1
 //#define TC_WRITE_OFFSET 1
 //#define NDRC_CACHE_FLUSH_ALL 1
+//#define NDRC_JUMP_CACHE 1      // direct-mapped kseg0 ram -> host code lookup
+//#define NDRC_SMC_PROTECT 1     // read-only code pages instead of store checks
 
 #if defined(__MACH__) || defined(HAVE_LIBNX)
 #define NO_WRITE_EXEC 1
@@ -24,3 +26,6 @@
 #if defined(_3DS)
 #define NDRC_CACHE_FLUSH_ALL 1
 #endif
+#if !defined(_3DS) && !defined(VITA) && !defined(NDRC_NO_JUMP_CACHE)
+#define NDRC_JUMP_CACHE 1
+#endif
@@ -10,7 +10,6 @@
 static int pcsx_direct_read(int type, u_int addr, int cc_adj, int cc, int rs, int rt)
 {
   if ((addr & 0xfffff000) == 0x1f801000) {
-    u_int t;
     switch (addr & 0xffff) {
       case 0x1120: // rcnt2 count
         if (rt < 0) goto dont_care;
@@ -28,18 +27,8 @@ static int pcsx_direct_read(int type, u_int addr, int cc_adj, int cc, int rs, in
         emit_shrne_imm(rt, 3, rt);
         mov_loadtype_adj(type!=LOADW_STUB?type:LOADH_STUB, rt, rt);
         goto hit;
-      case 0x1104:
-      case 0x1114:
-      case 0x1124: // rcnt mode
-        if (rt < 0) return 0;
-        t = (addr >> 4) & 3;
-        emit_readword(&rcnts[t].mode, rt);
-        host_tempreg_acquire();
-        emit_andimm(rt, ~0x1800, HOST_TEMPREG);
-        emit_writeword(HOST_TEMPREG, &rcnts[t].mode);
-        host_tempreg_release();
-        mov_loadtype_adj(type, rt, rt);
-        goto hit;
+      // rcnt mode reads go to psxRcntRmode(), which catches up the
+      // counters psxcounters.c doesn't schedule
     }
   }
   else {
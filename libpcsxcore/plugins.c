@@ -217,6 +217,16 @@ static unsigned char buf[256];
 
 static unsigned char stdpar[8] = { 0x41, 0x5a, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
 
+// the 0x42 response of each non-multitap pad as built by PADstartPoll_(),
+// the input is sampled once per frame so polls later in the same frame
+// can serve it as is instead of rereading the port and rebuilding it
+static struct {
+	int valid;
+	u32 frame;
+	int type, mode, size;
+	unsigned char data[8];
+} padResp[8];
+
 //response for request 44, 45, 46, 47, 4C, 4D
 static const u8 resp45[8]    = {0xF3, 0x5A, 0x01, 0x02, 0x00, 0x02, 0x01, 0x00};
 static const u8 resp46_00[8] = {0xF3, 0x5A, 0x00, 0x00, 0x01, 0x02, 0x00, 0x0A};
@@ -605,6 +615,32 @@ static void PADstartPoll_(PadDataS *pad) {
 	}
 }
 
+static int PADrespCached(int index)
+{
+	const PadDataS *pad = &pads[index];
+
+	if (!padResp[index].valid || padResp[index].frame != frame_counter
+	    || padResp[index].type != in_type[index]
+	    || padResp[index].mode != pad->ds.padMode || pad->portMultitap)
+		return 0;
+	memcpy(buf, padResp[index].data, padResp[index].size);
+	respSize = padResp[index].size;
+	return 1;
+}
+
+static void PADrespSave(int index)
+{
+	// the gun position depends on the current display mode
+	padResp[index].valid = in_type[index] != PSE_PAD_TYPE_GUNCON
+		&& (size_t)respSize <= sizeof(padResp[index].data);
+	padResp[index].frame = frame_counter;
+	padResp[index].type = in_type[index];
+	padResp[index].mode = pads[index].ds.padMode;
+	padResp[index].size = respSize;
+	if (padResp[index].valid)
+		memcpy(padResp[index].data, buf, respSize);
+}
+
 static void PADpoll_dualshock(int port, unsigned char value, int pos)
 {
 	switch (pos) {
@@ -703,6 +739,8 @@ unsigned char PAD1_startPoll(int unused) {
 
 	reqPos = 0;
 	pads[0].requestPadIndex = 0;
+	if (PADrespCached(0))
+		return 0xff;
 	PAD1_readPort(&pads[0]);
 
 	pads[0].multitapLongModeEnabled = 0;
@@ -711,6 +749,7 @@ unsigned char PAD1_startPoll(int unused) {
 
 	if (!pads[0].portMultitap || !pads[0].multitapLongModeEnabled) {
 		PADstartPoll_(&pads[0]);
+		PADrespSave(0);
 	} else {
 		// a multitap is plugged and enabled: refresh pads 1-3
 		for (i = 1; i < 4; i++) {
@@ -732,6 +771,8 @@ unsigned char PAD2_startPoll(int pad) {
 
 	reqPos = 0;
 	pads[pad_index].requestPadIndex = pad_index;
+	if (PADrespCached(pad_index))
+		return 0xff;
 	PAD2_readPort(&pads[pad_index]);
 
 	pads[pad_index].multitapLongModeEnabled = 0;
@@ -740,6 +781,7 @@ unsigned char PAD2_startPoll(int pad) {
 
 	if (!pads[pad_index].portMultitap || !pads[pad_index].multitapLongModeEnabled) {
 		PADstartPoll_(&pads[pad_index]);
+		PADrespSave(pad_index);
 	} else {
 		for (i = 1; i < 4; i++) {
 			pads[pad_index + i].requestPadIndex = pad_index + i;
@@ -757,6 +799,7 @@ static void PAD_init(void) {
 	size_t p;
 
 	memset(pads, 0, sizeof(pads));
+	memset(padResp, 0, sizeof(padResp));
 	for (p = 0; p < sizeof(pads) / sizeof(pads[0]); p++) {
 		memset(pads[p].ds.cmd4dConfig, 0xff, sizeof(pads[p].ds.cmd4dConfig));
 	}
@@ -765,6 +808,8 @@ static void PAD_init(void) {
 int padFreeze(void *f, int Mode) {
 	size_t i;
 
+	memset(padResp, 0, sizeof(padResp));
+
 	for (i = 0; i < sizeof(pads) / sizeof(pads[0]); i++) {
 		pads[i].saveSize = sizeof(pads[i]);
 		gzfreeze(&pads[i], sizeof(pads[i]));
@@ -33,52 +33,26 @@ typedef struct tagPPF_DATA {
 	struct tagPPF_DATA	*pNext;
 } PPF_DATA;
 
-typedef struct tagPPF_CACHE {
-	s32					addr;
-	struct tagPPF_DATA	*pNext;
-} PPF_CACHE;
+// the parsed patch list is compiled into a per-sector index: a bitmap
+// (in ppf.h so that unpatched sectors cost a bit test), the number of
+// patched sectors before each bitmap byte, and for each patched sector
+// its merged byte runs
+struct ppf_run {
+	u16					pos; // relative to CheckPPFCache's buffer
+	u16					len;
+	u32					data;
+};
 
-static PPF_CACHE		*ppfCache = NULL;
 static PPF_DATA			*ppfHead = NULL, *ppfLast = NULL;
-static int				iPPFNum = 0;
-
-// using a linked data list, and address array
-static void FillPPFCache() {
-	PPF_DATA		*p;
-	PPF_CACHE		*pc;
-	s32				lastaddr;
-
-	p = ppfHead;
-	lastaddr = -1;
-	iPPFNum = 0;
-
-	while (p != NULL) {
-		if (p->addr != lastaddr) iPPFNum++;
-		lastaddr = p->addr;
-		p = p->pNext;
-	}
-
-	if (iPPFNum <= 0) return;
 
-	pc = ppfCache = (PPF_CACHE *)malloc(iPPFNum * sizeof(PPF_CACHE));
-	if (pc == NULL) return;
+unsigned char			*ppf_sectors;
+int						ppf_len;
+static u32				*ppf_rank;
+static u32				*ppf_first; // first run of each patched sector, +1 end
+static struct ppf_run	*ppf_runs;
+static u8				*ppf_data;
 
-	iPPFNum--;
-	p = ppfHead;
-	lastaddr = -1;
-
-	while (p != NULL) {
-		if (p->addr != lastaddr) {
-			pc->addr = p->addr;
-			pc->pNext = p;
-			pc++;
-		}
-		lastaddr = p->addr;
-		p = p->pNext;
-	}
-}
-
-void FreePPFCache() {
+static void FreePPFList() {
 	PPF_DATA *p = ppfHead;
 	void *pn;
 
@@ -89,51 +63,100 @@ void FreePPFCache() {
 	}
 	ppfHead = NULL;
 	ppfLast = NULL;
-
-	if (ppfCache != NULL) free(ppfCache);
-	ppfCache = NULL;
 }
 
-void CheckPPFCache(unsigned char *pB, unsigned char m, unsigned char s, unsigned char f) {
-	PPF_CACHE *pcstart, *pcend, *pcpos;
-	int addr = MSF2SECT(m, s, f), pos, anz, start;
-
-	if (ppfCache == NULL) return;
+static void FreePPFIndex() {
+	free(ppf_sectors); ppf_sectors = NULL;
+	free(ppf_rank); ppf_rank = NULL;
+	free(ppf_first); ppf_first = NULL;
+	free(ppf_runs); ppf_runs = NULL;
+	free(ppf_data); ppf_data = NULL;
+	ppf_len = 0;
+}
 
-	pcstart = ppfCache;
-	if (addr < pcstart->addr) return;
-	pcend = ppfCache + iPPFNum;
-	if (addr > pcend->addr) return;
+// the list is sorted by sector, later entries for the same bytes win
+static void FillPPFCache() {
+	u8				img[DATA_SIZE], mask[DATA_SIZE];
+	u32				nsect = 0, nruns = 0, ndata = 0;
+	s32				maxaddr = -1, addr;
+	PPF_DATA		*p, *ps;
+	int				pos, anz, start, i, n;
+
+	for (p = ppfHead; p != NULL; p = p->pNext) {
+		if (p->addr < 0) continue;
+		if (p->addr != maxaddr) nsect++;
+		maxaddr = p->addr;
+		nruns++;
+		ndata += p->anz;
+	}
+	if (nsect == 0) return;
+
+	ppf_len = maxaddr / 8 + 1;
+	ppf_sectors = calloc(ppf_len, 1);
+	ppf_rank = malloc(ppf_len * sizeof(ppf_rank[0]));
+	ppf_first = malloc((nsect + 1) * sizeof(ppf_first[0]));
+	ppf_runs = malloc(nruns * sizeof(ppf_runs[0]));
+	ppf_data = malloc(ndata);
+	if (!ppf_sectors || !ppf_rank || !ppf_first || !ppf_runs || !ppf_data) {
+		SysPrintf(_("PPF: out of memory\n"));
+		FreePPFIndex();
+		return;
+	}
 
-	while (1) {
-		if (addr == pcend->addr) { pcpos = pcend; break; }
+	nsect = nruns = ndata = 0;
+	for (p = ppfHead; p != NULL; p = ps) {
+		addr = p->addr;
+		if (addr < 0) { ps = p->pNext; continue; }
 
-		pcpos = pcstart + (pcend - pcstart) / 2;
-		if (pcpos == pcstart) break;
-		if (addr < pcpos->addr) {
-			pcend = pcpos;
-			continue;
+		memset(mask, 0, sizeof(mask));
+		for (ps = p; ps != NULL && ps->addr == addr; ps = ps->pNext) {
+			pos = ps->pos - (CD_FRAMESIZE_RAW - DATA_SIZE);
+			anz = ps->anz;
+			if (pos < 0) { start = -pos; pos = 0; anz -= start; }
+			else start = 0;
+			if (anz <= 0) continue;
+			memcpy(img + pos, (unsigned char *)(ps + 1) + start, anz);
+			memset(mask + pos, 1, anz);
 		}
-		if (addr > pcpos->addr) {
-			pcstart = pcpos;
-			continue;
+
+		ppf_sectors[addr >> 3] |= 1 << (addr & 7);
+		ppf_first[nsect++] = nruns;
+		for (i = 0; i < DATA_SIZE; ) {
+			if (!mask[i]) { i++; continue; }
+			for (n = i; n < DATA_SIZE && mask[n]; n++)
+				;
+			ppf_runs[nruns].pos = i;
+			ppf_runs[nruns].len = n - i;
+			ppf_runs[nruns].data = ndata;
+			memcpy(ppf_data + ndata, img + i, n - i);
+			ndata += n - i;
+			nruns++;
+			i = n;
 		}
-		break;
 	}
+	ppf_first[nsect] = nruns;
 
-	if (addr == pcpos->addr) {
-		PPF_DATA *p = pcpos->pNext;
-		while (p != NULL && p->addr == addr) {
-			pos = p->pos - (CD_FRAMESIZE_RAW - DATA_SIZE);
-			anz = p->anz;
-			if (pos < 0) { start = -pos; pos = 0; anz -= start; }
-			else start = 0;
-			memcpy(pB + pos, (unsigned char *)(p + 1) + start, anz);
-			p = p->pNext;
-		}
+	for (i = 0, n = 0; i < ppf_len; i++) {
+		ppf_rank[i] = n;
+		n += __builtin_popcount(ppf_sectors[i]);
 	}
 }
 
+void FreePPFCache() {
+	FreePPFList();
+	FreePPFIndex();
+}
+
+void ApplyPPF(unsigned char *pB, int addr) {
+	u32 k = ppf_rank[addr >> 3]
+		+ __builtin_popcount(ppf_sectors[addr >> 3] & ((1u << (addr & 7)) - 1));
+	const struct ppf_run *r = &ppf_runs[ppf_first[k]];
+	const struct ppf_run *r_end = &ppf_runs[ppf_first[k + 1]];
+
+	for (; r < r_end; r++)
+		memcpy(pB + r->pos, ppf_data + r->data, r->len);
+}
+
 static void AddToPPF(s32 ladr, s32 pos, s32 anz, unsigned char *ppfmem) {
 	if (ppfHead == NULL) {
 		ppfHead = (PPF_DATA *)malloc(sizeof(PPF_DATA) + anz);
@@ -143,7 +166,6 @@ static void AddToPPF(s32 ladr, s32 pos, s32 anz, unsigned char *ppfmem) {
 		ppfHead->pos = pos;
 		ppfHead->anz = anz;
 		memcpy(ppfHead + 1, ppfmem, anz);
-		iPPFNum = 1;
 		ppfLast = ppfHead;
 	} else {
 		PPF_DATA *p = ppfHead;
@@ -175,7 +197,6 @@ static void AddToPPF(s32 ladr, s32 pos, s32 anz, unsigned char *ppfmem) {
 		padd->pos = pos;
 		padd->anz = anz;
 		memcpy(padd + 1, ppfmem, anz);
-		iPPFNum++;
 		if (plast == NULL) ppfHead = padd;
 		else plast->pNext = padd;
 
@@ -191,7 +212,7 @@ void BuildPPFCache(const char *fname) {
 	unsigned char	ppfmem[512];
 	char			szPPF[MAXPATHLEN * 2];
 	int				count, seekpos, pos;
-	u32				anz; // use 32-bit to avoid stupid overflows
+	u32				anz, reclen; // use 32-bit to avoid stupid overflows
 	s32				ladr, off, anx;
 
 	FreePPFCache();
@@ -322,8 +343,8 @@ void BuildPPFCache(const char *fname) {
 				goto fail_io;
 		}
 
-		anz = fgetc(ppffile);
-		if (fread(ppfmem, 1, anz, ppffile) != anz)
+		anz = reclen = fgetc(ppffile);
+		if (anz > 255 || fread(ppfmem, 1, anz, ppffile) != anz)
 			goto fail_io;
 
 		ladr = pos / CD_FRAMESIZE_RAW;
@@ -337,18 +358,20 @@ void BuildPPFCache(const char *fname) {
 
 		AddToPPF(ladr, off, anz, ppfmem); // add to link list
 
+		// anz may have been cut by a sector split above
 		if (method == 2) {
-			if (undo) anz += anz;
-			anz += 4;
+			if (undo) reclen += reclen;
+			reclen += 4;
 		}
 
-		seekpos = seekpos + 5 + anz;
-		count = count - 5 - anz;
+		seekpos = seekpos + 5 + reclen;
+		count = count - 5 - reclen;
 	} while (count != 0); // loop til end
 
 	fclose(ppffile);
 
-	FillPPFCache(); // build address array
+	FillPPFCache(); // build the sector index
+	FreePPFList();
 
 	SysPrintf(_("Loaded PPF %d.0 patch: %s.\n"), method + 1, fname);
 	return;
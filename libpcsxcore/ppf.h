@@ -25,7 +25,7 @@ extern "C" {
 
 void BuildPPFCache(const char *fname);
 void FreePPFCache();
-void CheckPPFCache(unsigned char *pB, unsigned char m, unsigned char s, unsigned char f);
+void ApplyPPF(unsigned char *pB, int addr);
 
 int LoadSBI(const char *fname, int sector_count);
 void UnloadSBI(void);
@@ -45,6 +45,20 @@ static inline int CheckSBI(int s)
 	return (sbi_sectors[s >> 3] >> (s & 7)) & 1;
 }
 
+extern unsigned char *ppf_sectors;
+extern int ppf_len;
+
+// pB is the sector without the 12 byte sync
+static inline void CheckPPFCache(unsigned char *pB, unsigned char m, unsigned char s, unsigned char f)
+{
+	int addr = MSF2SECT(m, s, f);
+
+	if ((unsigned int)(addr >> 3) >= (unsigned int)ppf_len)
+		return;
+	if ((ppf_sectors[addr >> 3] >> (addr & 7)) & 1)
+		ApplyPPF(pB, addr);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -375,6 +375,32 @@ static void storeRam32(u32 addr, u32 d)
 	*((u32 *)psxM + ((addr & 0x1fffff) >> 2)) = SWAP32(d);
 }
 
+// host pointer for a psx range that lies in one ram mirror, INVALID_PTR
+// when it doesn't (rom, scratchpad, wraps around, isolated cache), callers
+// then fall back to going through PSXM() byte by byte
+static u8 *ram_range(u32 addr, u32 len)
+{
+	u32 seg = addr >> 29, p = addr & 0x1fffffff;
+
+	if ((seg != 0 && seg != 4 && seg != 5) || p >= 0x800000 || cache_isolated)
+		return INVALID_PTR;
+	p &= 0x1fffff;
+	if (len > 0x200000 - p)
+		return INVALID_PTR;
+	return (u8 *)psxM + p;
+}
+
+// strlen() that stops at the end of the ram mirror, -1 if it gets there
+static s32 ram_strlen(u32 addr)
+{
+	const u8 *p = ram_range(addr, 1), *e;
+
+	if (p == INVALID_PTR)
+		return -1;
+	e = memchr(p, 0, 0x200000 - (addr & 0x1fffff));
+	return e ? e - p : -1;
+}
+
 static void mips_return(u32 val)
 {
 	v0 = val;
@@ -740,8 +766,9 @@ void psxBios_longjmp() { // 0x14
 }
 
 void psxBios_strcat() { // 0x15
-	u8 *p2 = (u8 *)Ra1;
+	u8 *p2 = (u8 *)Ra1, *dh;
 	u32 p1 = a0;
+	s32 l1, l2;
 
 	PSXBIOS_LOG("psxBios_%s %s (%x), %s (%x)\n", biosA0n[0x15], Ra0, a0, Ra1, a1);
 	if (a0 == 0 || a1 == 0 || p2 == INVALID_PTR)
@@ -749,6 +776,14 @@ void psxBios_strcat() { // 0x15
 		mips_return_c(0, 6);
 		return;
 	}
+	l1 = ram_strlen(a0);
+	l2 = ram_strlen(a1);
+	if (l1 >= 0 && l2 >= 0 && (dh = ram_range(a0 + l1, l2 + 1)) != INVALID_PTR) {
+		memmove(dh, p2, l2 + 1);
+		psxCpu->Clear(a0 + l1, (l2 + 4) / 4);
+		mips_return_c(a0, 22 + l1 * 4);
+		return;
+	}
 	while (loadRam8(p1)) {
 		use_cycles(4);
 		p1++;
@@ -876,6 +911,7 @@ void psxBios_strncmp() { // 0x18
 
 void psxBios_strcpy() { // 0x19
 	char *p1 = (char *)Ra0, *p2 = (char *)Ra1;
+	s32 len;
 	PSXBIOS_LOG("psxBios_%s %x, %s (%x)\n", biosA0n[0x19], a0, p2, a1);
 	if (a0 == 0 || a1 == 0)
 	{
@@ -883,7 +919,13 @@ void psxBios_strcpy() { // 0x19
 		pc0 = ra;
 		return;
 	}
-	while ((*p1++ = *p2++) != '\0');
+	len = ram_strlen(a1);
+	if (len >= 0 && ram_range(a0, len + 1) != INVALID_PTR) {
+		memmove(p1, p2, len + 1);
+		psxCpu->Clear(a0, (len + 4) / 4);
+	}
+	else
+		while ((*p1++ = *p2++) != '\0');
 
 	v0 = a0; pc0 = ra;
 }
@@ -912,13 +954,17 @@ void psxBios_strncpy() { // 0x1a
 
 void psxBios_strlen() { // 0x1b
 	char *p = (char *)Ra0;
+	s32 len;
 	v0 = 0;
 	if (a0 == 0)
 	{
 		pc0 = ra;
 		return;
 	}
-	while (*p++) v0++;
+	if ((len = ram_strlen(a0)) >= 0)
+		v0 = len;
+	else
+		while (*p++) v0++;
 	pc0 = ra;
 }
 
@@ -1056,9 +1102,12 @@ void psxBios_tolower() { // 0x26
 
 static void do_memset(u32 dst, u32 v, s32 len)
 {
+	u8 *dh = ram_range(dst, len);
 	u32 d = dst;
 	s32 l = len;
-	while (l-- > 0) {
+	if (dh != INVALID_PTR)
+		memset(dh, v, len);
+	else while (l-- > 0) {
 		u8 *db = PSXM(d);
 		if (db != INVALID_PTR)
 			*db = v;
@@ -1069,9 +1118,20 @@ static void do_memset(u32 dst, u32 v, s32 len)
 
 static void do_memcpy(u32 dst, u32 src, s32 len)
 {
+	u8 *dh = ram_range(dst, len);
+	const u8 *sh = ram_range(src, len);
 	u32 d = dst, s = src;
 	s32 l = len;
-	while (l-- > 0) {
+	if (dh != INVALID_PTR && sh != INVALID_PTR) {
+		// the bios copies forwards a byte at a time, overlapping
+		// dst > src repeats the pattern and some code relies on that
+		if (dh > sh && dh < sh + len)
+			while (l-- > 0)
+				*dh++ = *sh++;
+		else
+			memmove(dh, sh, len);
+	}
+	else while (l-- > 0) {
 		const u8 *sb = PSXM(s);
 		u8 *db = PSXM(d);
 		if (db != INVALID_PTR && sb != INVALID_PTR)
@@ -1178,6 +1238,12 @@ void psxBios_memmove() { // 0x2c
 	v1 = a0;
 	if ((s32)a2 > 0 && a0 > a1 && a0 < a1 + a2) {
 		u32 dst = a0, len = a2 + 1;
+		u8 *dh = ram_range(a0, len);
+		const u8 *sh = ram_range(a1, len);
+		if (dh != INVALID_PTR && sh != INVALID_PTR) {
+			memmove(dh, sh, len);
+			a2 = -1; // regs end up as the loop below leaves them
+		}
 		a0 += a2;
 		a1 += a2;
 		while ((s32)a2 >= 0) { // BUG: copies one more byte here
@@ -23,8 +23,11 @@
 
 #include "cheat.h"
 #include "ppf.h"
+#include "rewind.h"
+#include "../include/thread_wakeups.h"
 
 PcsxConfig Config;
+unsigned int twake_counts[TWAKE_COUNT];
 
 int EmuInit() {
 	return psxInit();
@@ -43,6 +46,8 @@ void EmuShutdown() {
 	FreeCheatSearchMem();
 
 	FreePPFCache();
+	ShutdownMcds();
+	rewind_free();
 
 	psxShutdown();
 }
@@ -116,6 +116,7 @@ typedef struct {
 	char BiosDir[MAXPATHLEN];
 	char PluginsDir[MAXPATHLEN];
 	char PatchesDir[MAXPATHLEN];
+	char CacheDir[MAXPATHLEN];
 	boolean Xa;
 	boolean Mdec;
 	boolean PsxAuto;
@@ -128,6 +129,7 @@ typedef struct {
 	boolean icache_emulation;
 	boolean DisableStalls;
 	boolean PreciseExceptions;
+	boolean PredecodeInt; // predecoded interpreter, see psxinterpreter.c
 	boolean TurboCD;
 	int cycle_multiplier; // 100 for 1.0
 	int cycle_multiplier_override;
@@ -136,6 +138,9 @@ typedef struct {
 	s8 FractionalFramerate; // ~49.75 and ~59.81 instead of 50 and 60
 	u8 Cpu; // CPU_DYNAREC or CPU_INTERPRETER
 	u8 PsxType; // PSX_TYPE_NTSC or PSX_TYPE_PAL
+	u8 StateCompression; // STATE_COMP_*
+	u8 MdecThreads; // 1 decodes on the emu thread only
+	int MemBudgetMB; // low memory mode, 0 or the MB the caches get to share
 	struct {
 		boolean cdr_read_timing;
 		boolean gpu_slow_list_walking;
@@ -174,6 +179,12 @@ enum {
 	CPU_INTERPRETER
 }; // CPU Types
 
+enum {
+	STATE_COMP_FAST = 0,	// deflate level 1
+	STATE_COMP_SMALL,	// zlib's default level
+	STATE_COMP_NONE
+}; // savestate compression
+
 int EmuInit();
 void EmuReset();
 void EmuShutdown();
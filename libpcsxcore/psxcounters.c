@@ -233,6 +233,30 @@ void _psxRcntWmode( u32 index, u32 value )
 
 /******************************************************************************/
 
+// A free running counter that can't raise an irq only changes the mode
+// flags at its target/overflow, and wrapping at 0x10000 doesn't change
+// what reads return. Those are caught up on mode read instead of being
+// scheduled. Count to target counters must stay scheduled as the asm
+// read handlers rely on cycleStart being current, and so do the clk/5
+// and hsync ones (rcnt0/1_read_count_m1, no 16bit wrap) even when free
+// running.
+static inline
+int rcntLazy( u32 index )
+{
+    u32 mode = rcnts[index].mode;
+
+    if( mode & RcCountToTarget )
+        return 0;
+    if( index == 0 && (mode & Rc0PixelClock) )
+        return 0;
+    if( index == 1 && (mode & Rc1HSyncClock) )
+        return 0;
+    if( (mode & (RcIrqOnTarget | RcIrqOnOverflow)) &&
+        ((mode & RcIrqRegenerate) || !rcnts[index].irqState) )
+        return 0;
+    return 1;
+}
+
 static
 void psxRcntSet()
 {
@@ -244,6 +268,9 @@ void psxRcntSet()
 
     for( i = 0; i < CounterQuantity; ++i )
     {
+        if( i < 3 && rcntLazy( i ) )
+            continue;
+
         countToUpdate = rcnts[i].cycle - (psxRegs.psxNextsCounter - rcnts[i].cycleStart);
 
         if( countToUpdate < 0 )
@@ -348,13 +375,20 @@ static void scheduleRcntBase(void)
     }
 }
 
-void psxRcntUpdate()
+static
+void rcntCatchUp( u32 index, u32 cycle )
 {
-    u32 cycle, cycles_passed;
+    u32 cycles_passed;
 
-    cycle = psxRegs.cycle;
+    if( index != 0 )
+    {
+        while( cycle - rcnts[index].cycleStart >= rcnts[index].cycle )
+        {
+            psxRcntReset( index );
+        }
+        return;
+    }
 
-    // rcnt 0.
     cycles_passed = cycle - rcnts[0].cycleStart;
     while( cycles_passed >= rcnts[0].cycle )
     {
@@ -371,18 +405,17 @@ void psxRcntUpdate()
 
         cycles_passed = cycle - rcnts[0].cycleStart;
     }
+}
 
-    // rcnt 1.
-    while( cycle - rcnts[1].cycleStart >= rcnts[1].cycle )
-    {
-        psxRcntReset( 1 );
-    }
+void psxRcntUpdate()
+{
+    u32 cycle;
 
-    // rcnt 2.
-    while( cycle - rcnts[2].cycleStart >= rcnts[2].cycle )
-    {
-        psxRcntReset( 2 );
-    }
+    cycle = psxRegs.cycle;
+
+    rcntCatchUp( 0, cycle );
+    rcntCatchUp( 1, cycle );
+    rcntCatchUp( 2, cycle );
 
     // rcnt base.
     if( cycle - rcnts[3].cycleStart >= rcnts[3].cycle )
@@ -535,6 +568,9 @@ u32 psxRcntRmode( u32 index )
 {
     u16 mode;
 
+    if( rcntLazy( index ) )
+        rcntCatchUp( index, psxRegs.cycle );
+
     mode = rcnts[index].mode;
     rcnts[index].mode &= 0xe7ff;
 
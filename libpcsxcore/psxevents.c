@@ -1,10 +1,12 @@
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include "r3000a.h"
 #include "cdrom.h"
 #include "psxdma.h"
 #include "mdec.h"
 #include "psxevents.h"
+#include "../include/evtrace.h"
 
 //#define evprintf printf
 #define evprintf(...)
@@ -19,10 +21,99 @@ static psxRegisters *cp0TOpsxRegs(psxCP0Regs *cp0)
 #endif
 }
 
-u32 schedule_timeslice(psxRegisters *regs)
+/*
+ * Pending events ordered by deadline (binary min-heap). Entries are removed
+ * lazily: regs->interrupt and regs->event_cycles[] stay authoritative and an
+ * entry is stale once its event gets cleared or rescheduled.
+ */
+#define EVQ_SIZE 64
+
+static struct evq_ent {
+	u32 cycle;
+	u32 e;
+} evq[EVQ_SIZE];
+static u32 evq_len;
+#ifdef PSXEVENTS_STATS
+static u32 ev_fired[PSXINT_COUNT];
+#define ev_fired_count(e) ev_fired[e]++
+#else
+#define ev_fired_count(e)
+#endif
+
+static int evq_before(const struct evq_ent *a, const struct evq_ent *b)
+{
+	return (s32)(a->cycle - b->cycle) < 0;
+}
+
+static int evq_valid(const psxRegisters *regs, const struct evq_ent *ent)
+{
+	return ((regs->interrupt >> ent->e) & 1)
+		&& regs->event_cycles[ent->e] == ent->cycle;
+}
+
+static void evq_insert(u32 e, u32 cycle)
 {
-	u32 i, c = regs->cycle;
-	u32 irqs = regs->interrupt;
+	struct evq_ent ent = { cycle, e };
+	u32 i = evq_len++;
+
+	while (i > 0) {
+		u32 parent = (i - 1) / 2;
+		if (!evq_before(&ent, &evq[parent]))
+			break;
+		evq[i] = evq[parent];
+		i = parent;
+	}
+	evq[i] = ent;
+}
+
+static void evq_pop(void)
+{
+	struct evq_ent last;
+	u32 i = 0, child;
+
+	if (--evq_len == 0)
+		return;
+	last = evq[evq_len];
+	while ((child = i * 2 + 1) < evq_len) {
+		if (child + 1 < evq_len && evq_before(&evq[child + 1], &evq[child]))
+			child++;
+		if (!evq_before(&evq[child], &last))
+			break;
+		evq[i] = evq[child];
+		i = child;
+	}
+	evq[i] = last;
+}
+
+static void evq_rebuild(const psxRegisters *regs)
+{
+	u32 i, irqs = regs->interrupt;
+
+	evq_len = 0;
+	for (i = 0; irqs != 0; i++, irqs >>= 1)
+		if (irqs & 1)
+			evq_insert(i, regs->event_cycles[i]);
+}
+
+// called by set_event_raw_abs() after event_cycles[e] is updated
+void events_queue(u32 e, u32 abs)
+{
+	if (evq_len < EVQ_SIZE)
+		evq_insert(e, abs);
+	else
+		evq_rebuild(&psxRegs);
+}
+
+static void evq_drop_stale(const psxRegisters *regs)
+{
+	while (evq_len && !evq_valid(regs, &evq[0]))
+		evq_pop();
+}
+
+// slow path for when something already due is still pending
+static s32 scan_timeslice(const psxRegisters *regs, u32 c)
+{
+	u32 i, irqs = regs->interrupt;
 	s32 min, dif;
 
 	min = PSXCLK;
@@ -34,6 +125,23 @@ u32 schedule_timeslice(psxRegisters *regs)
 		if (0 < dif && dif < min)
 			min = dif;
 	}
+	return min;
+}
+
+u32 schedule_timeslice(psxRegisters *regs)
+{
+	u32 c = regs->cycle;
+	s32 min, dif;
+
+	min = PSXCLK;
+	evq_drop_stale(regs);
+	if (evq_len) {
+		dif = evq[0].cycle - c;
+		if (dif <= 0)
+			min = scan_timeslice(regs, c);
+		else if (dif < min)
+			min = dif;
+	}
 	regs->next_interupt = c + min;
 	return regs->next_interupt;
 }
@@ -65,15 +173,27 @@ void irq_test(psxCP0Regs *cp0)
 {
 	psxRegisters *regs = cp0TOpsxRegs(cp0);
 	u32 cycle = regs->cycle;
-	u32 irq, irq_bits;
+	u32 irq, irq_bits = 0;
 
-	for (irq = 0, irq_bits = regs->interrupt; irq_bits != 0; irq++, irq_bits >>= 1) {
+	for (;;) {
+		evq_drop_stale(regs);
+		if (!evq_len || (s32)(cycle - evq[0].cycle) < 0)
+			break;
+		irq_bits |= 1u << evq[0].e;
+		evq_pop();
+	}
+
+	// fire in source order, not deadline order, like it always was
+	for (irq = 0; irq_bits != 0; irq++, irq_bits >>= 1) {
 		if (!(irq_bits & 1))
 			continue;
 		if ((s32)(cycle - regs->event_cycles[irq]) >= 0) {
 			// note: irq_funcs() also modify regs->interrupt
 			regs->interrupt &= ~(1u << irq);
+			ev_fired_count(irq);
+			evtrace_begin(EVT_EVENT, irq);
 			irq_funcs[irq]();
+			evtrace_end(EVT_EVENT);
 		}
 	}
 
@@ -107,4 +227,34 @@ void events_restore(void)
 	psxRegs.event_cycles[PSXINT_RCNT] = psxRegs.psxNextsCounter + psxRegs.psxNextCounter;
 	psxRegs.interrupt |=  1 << PSXINT_RCNT;
 	psxRegs.interrupt &= (1 << PSXINT_COUNT) - 1;
+	evq_rebuild(&psxRegs);
 }
+
+void events_reset(void)
+{
+	evq_len = 0;
+#ifdef PSXEVENTS_STATS
+	memset(ev_fired, 0, sizeof(ev_fired));
+#endif
+}
+
+#ifdef PSXEVENTS_STATS
+void events_print_stats(void)
+{
+	static const char * const names[PSXINT_COUNT] = {
+		[PSXINT_SIO] = "sio",		[PSXINT_CDR] = "cdr",
+		[PSXINT_CDREAD] = "cdread",	[PSXINT_GPUDMA] = "gpudma",
+		[PSXINT_MDECOUTDMA] = "mdecout",	[PSXINT_SPUDMA] = "spudma",
+		[PSXINT_SPU_IRQ] = "spuirq",	[PSXINT_MDECINDMA] = "mdecin",
+		[PSXINT_GPUOTCDMA] = "gpuotc",	[PSXINT_CDRDMA] = "cdrdma",
+		[PSXINT_NEWDRC_CHECK] = "drcchk", [PSXINT_RCNT] = "rcnt",
+		[PSXINT_CDRLID] = "cdrlid",	[PSXINT_IRQ10] = "irq10",
+		[PSXINT_SPU_UPDATE] = "spuupd",
+	};
+	int i;
+
+	for (i = 0; i < PSXINT_COUNT; i++)
+		if (ev_fired[i])
+			SysPrintf("event %-8s fired %u\n", names[i], ev_fired[i]);
+}
+#endif
@@ -22,10 +22,13 @@ enum {
 	PSXINT_COUNT
 };
 
+void events_queue(u32 e, u32 abs);
+
 #define set_event_raw_abs(e, abs) { \
 	u32 abs_ = abs; \
 	s32 di_ = psxRegs.next_interupt - abs_; \
 	psxRegs.event_cycles[e] = abs_; \
+	events_queue(e, abs_); \
 	if (di_ > 0) { \
 		/*printf("%u: next_interupt %u -> %u\n", psxRegs.cycle, psxRegs.next_interupt, abs_);*/ \
 		psxRegs.next_interupt = abs_; \
@@ -46,5 +49,9 @@ u32  schedule_timeslice(struct psxRegisters *regs);
 void irq_test(union psxCP0Regs_ *cp0);
 void gen_interupt(union psxCP0Regs_ *cp0);
 void events_restore(void);
+void events_reset(void);
+#ifdef PSXEVENTS_STATS
+void events_print_stats(void); // how often each event fired since reset
+#endif
 
 #endif // __PSXEVENTS_H__
@@ -27,10 +27,17 @@
 #include "cdrom.h"
 #include "gpu.h"
 #include "../include/compiler_features.h"
+#include "../include/evtrace.h"
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
+
+static void psxHwInitTables(void);
 
 void psxHwReset() {
 	memset(psxH, 0, 0x10000);
 
+	psxHwInitTables();
+
 	mdecInit(); // initialize mdec decoder
 	cdrReset();
 	psxRcntInit();
@@ -75,8 +82,11 @@ void psxHwWriteChcr##n(u32 value) \
 	if ((value ^ old) & 0x01000000) { \
 		if (!(value & 0x01000000)) \
 			abort_func; \
-		else if (HW_DMA_PCR & SWAPu32(8u << (n * 4))) \
+		else if (HW_DMA_PCR & SWAPu32(8u << (n * 4))) { \
+			evtrace_begin(EVT_DMA##n, SWAPu32(HW_DMA##n##_MADR)); \
 			psxDma##n(SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR), value); \
+			evtrace_end(EVT_DMA##n); \
+		} \
 	} \
 }
 
@@ -97,8 +107,11 @@ void psxHwWriteDmaPcr32(u32 value)
 		return;
 	#define DO(n) \
 	chcr = SWAPu32(HW_DMA##n##_CHCR); \
-	if ((on & (8u << 4*n)) && (chcr & 0x01000000)) \
-		psxDma##n(SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR), chcr)
+	if ((on & (8u << 4*n)) && (chcr & 0x01000000)) { \
+		evtrace_begin(EVT_DMA##n, SWAPu32(HW_DMA##n##_MADR)); \
+		psxDma##n(SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR), chcr); \
+		evtrace_end(EVT_DMA##n); \
+	}
 	DO(0);
 	DO(1);
 	// breaks Kyuutenkai. Probably needs better timing or
@@ -158,9 +171,265 @@ u32 sio1ReadStat16(void)
 	return 0xa0;
 }
 
+/*
+ * 16 and 32 bit accesses to 0x1000-0x1fff go through per register
+ * handler tables instead of a switch. Anything not in them is plain
+ * memory at psxH.
+ */
+typedef u32  (*hw_read_f)(u32 add);
+typedef void (*hw_write_f)(u32 add, u32 value);
+
+static hw_read_f  hw_read16_tab[0x1000 / 2];
+static hw_read_f  hw_read32_tab[0x1000 / 4];
+static hw_write_f hw_write16_tab[0x1000 / 2];
+static hw_write_f hw_write32_tab[0x1000 / 4];
+
+#define HW_R16(a) hw_read16_tab[((a) & 0xfff) >> 1]
+#define HW_R32(a) hw_read32_tab[((a) & 0xfff) >> 2]
+#define HW_W16(a) hw_write16_tab[((a) & 0xfff) >> 1]
+#define HW_W32(a) hw_write32_tab[((a) & 0xfff) >> 2]
+
+#ifdef PSXHW_STATS
+// access counts by width (0: 8, 1: 16, 2: 32) and register
+static u32 hw_stats[3][0x1000];
+#define HW_STAT(w, a) hw_stats[w][(a) & 0xfff]++
+
+void psxHwPrintStats(void)
+{
+	static const char w[3] = { 'b', 'h', 'w' };
+	int i, j, best;
+	u32 n;
+
+	SysPrintf("hw register accesses:\n");
+	for (j = 0; j < 16; j++) {
+		best = -1;
+		n = 0;
+		for (i = 0; i < 3 * 0x1000; i++) {
+			if (hw_stats[i >> 12][i & 0xfff] > n) {
+				n = hw_stats[i >> 12][i & 0xfff];
+				best = i;
+			}
+		}
+		if (best < 0)
+			break;
+		SysPrintf("  %c %08x %10u\n", w[best >> 12],
+			0x1f801000 + (best & 0xfff), n);
+		hw_stats[best >> 12][best & 0xfff] = 0;
+	}
+	memset(hw_stats, 0, sizeof(hw_stats));
+}
+#else
+#define HW_STAT(w, a)
+#endif
+
+static u32 hwr_sio_data(u32 add) { return sioRead8(); }
+static u32 hwr_sio_stat(u32 add) { return sioReadStat16(); }
+static u32 hwr_sio_mode(u32 add) { return sioReadMode16(); }
+static u32 hwr_sio_ctrl(u32 add) { return sioReadCtrl16(); }
+static u32 hwr_sio_baud(u32 add) { return sioReadBaud16(); }
+static u32 hwr_sio1_stat(u32 add) { return sio1ReadStat16(); }
+static u32 hwr_rcnt_count0(u32 add) { return psxRcntRcount0(); }
+static u32 hwr_rcnt_count1(u32 add) { return psxRcntRcount1(); }
+static u32 hwr_rcnt_count2(u32 add) { return psxRcntRcount2(); }
+static u32 hwr_rcnt_mode(u32 add) { return psxRcntRmode((add >> 4) & 3); }
+static u32 hwr_rcnt_target(u32 add) { return psxRcntRtarget((add >> 4) & 3); }
+static u32 hwr_gpu_data(u32 add) { return GPU_readData(); }
+static u32 hwr_gpu_stat(u32 add) { return psxHwReadGpuSR(); }
+static u32 hwr_mdec0(u32 add) { return mdecRead0(); }
+static u32 hwr_mdec1(u32 add) { return mdecRead1(); }
+
+static u32 hwr_spu16(u32 add)
+{
+	return SPU_readRegister(0x1f800000 | (add & 0xffff), psxRegs.cycle);
+}
+
+static u32 hwr_spu32(u32 add)
+{
+	u32 a = 0x1f800000 | (add & 0xffff);
+	return SPU_readRegister(a, psxRegs.cycle)
+		| (SPU_readRegister(a + 2, psxRegs.cycle) << 16);
+}
+
+static u32 hwr_mem16(u32 add) { return psxHu16(add); }
+static u32 hwr_mem32(u32 add) { return psxHu32(add); }
+
+static u32 hwr_unh16(u32 add)
+{
+	log_unhandled("unhandled r16 %08x @%08x\n", add, psxRegs.pc);
+	return psxHu16(add);
+}
+
+static u32 hwr_unh32(u32 add)
+{
+	log_unhandled("unhandled r32 %08x @%08x\n", add, psxRegs.pc);
+	return psxHu32(add);
+}
+
+static void hww_sio_data(u32 add, u32 value) { sioWrite8(value); }
+static void hww_sio_stat(u32 add, u32 value) { sioWriteStat16(value); }
+static void hww_sio_mode(u32 add, u32 value) { sioWriteMode16(value); }
+static void hww_sio_ctrl(u32 add, u32 value) { sioWriteCtrl16(value); }
+static void hww_sio_baud(u32 add, u32 value) { sioWriteBaud16(value); }
+static void hww_istat(u32 add, u32 value) { psxHwWriteIstat(value); }
+static void hww_imask(u32 add, u32 value) { psxHwWriteImask(value); }
+static void hww_chcr0(u32 add, u32 value) { psxHwWriteChcr0(value); }
+static void hww_chcr1(u32 add, u32 value) { psxHwWriteChcr1(value); }
+static void hww_chcr2(u32 add, u32 value) { psxHwWriteChcr2(value); }
+static void hww_chcr3(u32 add, u32 value) { psxHwWriteChcr3(value); }
+static void hww_chcr4(u32 add, u32 value) { psxHwWriteChcr4(value); }
+static void hww_chcr6(u32 add, u32 value) { psxHwWriteChcr6(value); }
+static void hww_dma_pcr(u32 add, u32 value) { psxHwWriteDmaPcr32(value); }
+static void hww_dma_icr(u32 add, u32 value) { psxHwWriteDmaIcr32(value); }
+static void hww_gpu_data(u32 add, u32 value) { GPU_writeData(value); }
+static void hww_gpu_stat(u32 add, u32 value) { psxHwWriteGpuSR(value); }
+
+static void hww_rcnt_count(u32 add, u32 value)
+{
+	psxRcntWcount((add >> 4) & 3, value & 0xffff);
+}
+
+static void hww_rcnt_mode(u32 add, u32 value)
+{
+	psxRcntWmode((add >> 4) & 3, value);
+}
+
+static void hww_rcnt_target(u32 add, u32 value)
+{
+	psxRcntWtarget((add >> 4) & 3, value & 0xffff);
+}
+
+static void hww_mdec0(u32 add, u32 value)
+{
+	mdecWrite0(value);
+	psxHu32ref(add) = SWAPu32(value);
+}
+
+static void hww_mdec1(u32 add, u32 value)
+{
+	mdecWrite1(value);
+	psxHu32ref(add) = SWAPu32(value);
+}
+
+static void hww_spu16(u32 add, u32 value)
+{
+	SPU_writeRegister(0x1f800000 | (add & 0xffff), value, psxRegs.cycle);
+}
+
+static void hww_spu32(u32 add, u32 value)
+{
+	u32 a = 0x1f800000 | (add & 0xffff);
+	SPU_writeRegister(a, value & 0xffff, psxRegs.cycle);
+	SPU_writeRegister(a + 2, value >> 16, psxRegs.cycle);
+}
+
+static void hww_mem16(u32 add, u32 value) { psxHu16ref(add) = SWAPu16(value); }
+static void hww_mem32(u32 add, u32 value) { psxHu32ref(add) = SWAPu32(value); }
+
+// forced write32 with no immediate effect
+static void hww_mem16_32(u32 add, u32 value) { psxHu32ref(add) = SWAPu32(value); }
+
+static void hww_unh16(u32 add, u32 value)
+{
+	log_unhandled("unhandled w16 %08x %08x @%08x\n", add, value, psxRegs.pc);
+	psxHu16ref(add) = SWAPu16(value);
+}
+
+static void hww_unh32(u32 add, u32 value)
+{
+	log_unhandled("unhandled w32 %08x %08x @%08x\n", add, value, psxRegs.pc);
+	psxHu32ref(add) = SWAPu32(value);
+}
+
+static void psxHwInitTables(void)
+{
+	static const u16 r16_unh[] = {
+		0x1042, 0x1046, 0x104c, 0x1050, 0x1058, 0x105a, 0x105c,
+		0x1800, 0x1802, 0x1810, 0x1812, 0x1814, 0x1816,
+		0x1820, 0x1822, 0x1824, 0x1826,
+	};
+	static const u16 r32_unh[] = {
+		0x1048, 0x104c, 0x1050, 0x1054, 0x1058, 0x105c, 0x1800,
+	};
+	static const u16 w16_mem32[] = {
+		0x1014, 0x1060, 0x1080, 0x1090, 0x10a0, 0x10b0, 0x10c0, 0x10d0, 0x10e0,
+	};
+	static const u16 w16_unh[] = {
+		0x1800, 0x1802, 0x1810, 0x1812, 0x1814, 0x1816,
+		0x1820, 0x1822, 0x1824, 0x1826,
+	};
+	static const u16 w32_unh[] = {
+		0x1044, 0x1048, 0x104c, 0x1050, 0x1054, 0x1058, 0x105c, 0x1800,
+	};
+	u32 a, i;
+
+	for (a = 0x1000; a < 0x2000; a += 2) {
+		HW_R16(a) = a >= 0x1c00 ? hwr_spu16 : hwr_mem16;
+		HW_W16(a) = a >= 0x1c00 ? hww_spu16
+			: a < 0x1800 ? hww_unh16 : hww_mem16;
+	}
+	for (a = 0x1000; a < 0x2000; a += 4) {
+		HW_R32(a) = a >= 0x1c00 ? hwr_spu32 : hwr_mem32;
+		HW_W32(a) = a >= 0x1c00 ? hww_spu32 : hww_mem32;
+	}
+	for (i = 0; i < ARRAY_SIZE(r16_unh); i++)
+		HW_R16(r16_unh[i]) = hwr_unh16;
+	for (i = 0; i < ARRAY_SIZE(r32_unh); i++)
+		HW_R32(r32_unh[i]) = hwr_unh32;
+	for (i = 0; i < ARRAY_SIZE(w16_mem32); i++)
+		HW_W16(w16_mem32[i]) = hww_mem16_32;
+	for (i = 0; i < ARRAY_SIZE(w16_unh); i++)
+		HW_W16(w16_unh[i]) = hww_unh16;
+	for (i = 0; i < ARRAY_SIZE(w32_unh); i++)
+		HW_W32(w32_unh[i]) = hww_unh32;
+
+	HW_R16(0x1040) = HW_R32(0x1040) = hwr_sio_data;
+	HW_R16(0x1044) = HW_R32(0x1044) = hwr_sio_stat;
+	HW_R16(0x1048) = hwr_sio_mode;
+	HW_R16(0x104a) = hwr_sio_ctrl;
+	HW_R16(0x104e) = hwr_sio_baud;
+	HW_R16(0x1054) = hwr_sio1_stat;
+	HW_R32(0x1810) = hwr_gpu_data;
+	HW_R32(0x1814) = hwr_gpu_stat;
+	HW_R32(0x1820) = hwr_mdec0;
+	HW_R32(0x1824) = hwr_mdec1;
+
+	HW_W16(0x1040) = HW_W32(0x1040) = hww_sio_data;
+	HW_W16(0x1044) = hww_sio_stat;
+	HW_W16(0x1048) = hww_sio_mode;
+	HW_W16(0x104a) = hww_sio_ctrl;
+	HW_W16(0x104e) = hww_sio_baud;
+	HW_W16(0x1070) = HW_W32(0x1070) = hww_istat;
+	HW_W16(0x1074) = HW_W32(0x1074) = hww_imask;
+	HW_W32(0x1810) = hww_gpu_data;
+	HW_W32(0x1814) = hww_gpu_stat;
+	HW_W32(0x1820) = hww_mdec0;
+	HW_W32(0x1824) = hww_mdec1;
+
+	for (a = 0x1100; a <= 0x1120; a += 0x10) {
+		HW_R16(a + 0) = HW_R32(a + 0) = a == 0x1100 ? hwr_rcnt_count0
+			: a == 0x1110 ? hwr_rcnt_count1 : hwr_rcnt_count2;
+		HW_R16(a + 4) = HW_R32(a + 4) = hwr_rcnt_mode;
+		HW_R16(a + 8) = HW_R32(a + 8) = hwr_rcnt_target;
+		HW_W16(a + 0) = HW_W32(a + 0) = hww_rcnt_count;
+		HW_W16(a + 4) = HW_W32(a + 4) = hww_rcnt_mode;
+		HW_W16(a + 8) = HW_W32(a + 8) = hww_rcnt_target;
+	}
+
+	// chcr, writes to the upper half are forced write32 too
+	HW_W16(0x1088) = HW_W16(0x108c) = HW_W32(0x1088) = HW_W32(0x108c) = hww_chcr0;
+	HW_W16(0x1098) = HW_W16(0x109c) = HW_W32(0x1098) = HW_W32(0x109c) = hww_chcr1;
+	HW_W16(0x10a8) = HW_W16(0x10ac) = HW_W32(0x10a8) = HW_W32(0x10ac) = hww_chcr2;
+	HW_W16(0x10b8) = HW_W16(0x10bc) = HW_W32(0x10b8) = HW_W32(0x10bc) = hww_chcr3;
+	HW_W16(0x10c8) = HW_W16(0x10cc) = HW_W32(0x10c8) = HW_W32(0x10cc) = hww_chcr4;
+	HW_W16(0x10e8) = HW_W16(0x10ec) = HW_W32(0x10e8) = HW_W32(0x10ec) = hww_chcr6;
+	HW_W16(0x10f0) = HW_W32(0x10f0) = hww_dma_pcr;
+	HW_W16(0x10f4) = HW_W32(0x10f4) = hww_dma_icr;
+}
+
 u8 psxHwRead8(u32 add) {
 	u8 hard;
 
+	HW_STAT(0, add);
 	switch (add & 0xffff) {
 	case 0x1040: hard = sioRead8(); break;
 	case 0x1800: hard = cdrRead0(); break;
@@ -213,98 +482,23 @@ u8 psxHwRead8(u32 add) {
 }
 
 u16 psxHwRead16(u32 add) {
-	unsigned short hard;
-
-	switch (add & 0xffff) {
-	case 0x1040: hard = sioRead8(); break;
-	case 0x1044: hard = sioReadStat16(); break;
-	case 0x1048: hard = sioReadMode16(); break;
-	case 0x104a: hard = sioReadCtrl16(); break;
-	case 0x104e: hard = sioReadBaud16(); break;
-	case 0x1054: hard = sio1ReadStat16(); break;
-	case 0x1100: hard = psxRcntRcount0(); break;
-	case 0x1104: hard = psxRcntRmode(0); break;
-	case 0x1108: hard = psxRcntRtarget(0); break;
-	case 0x1110: hard = psxRcntRcount1(); break;
-	case 0x1114: hard = psxRcntRmode(1); break;
-	case 0x1118: hard = psxRcntRtarget(1); break;
-	case 0x1120: hard = psxRcntRcount2(); break;
-	case 0x1124: hard = psxRcntRmode(2); break;
-	case 0x1128: hard = psxRcntRtarget(2); break;
-
-	case 0x1042:
-	case 0x1046:
-	case 0x104c:
-	case 0x1050:
-	case 0x1058:
-	case 0x105a:
-	case 0x105c:
-	case 0x1800:
-	case 0x1802:
-	case 0x1810:
-	case 0x1812:
-	case 0x1814:
-	case 0x1816:
-	case 0x1820:
-	case 0x1822:
-	case 0x1824:
-	case 0x1826:
-		log_unhandled("unhandled r16 %08x @%08x\n", add, psxRegs.pc);
-		// falthrough
-	default:
-		if (0x1f801c00 <= add && add < 0x1f802000) {
-			hard = SPU_readRegister(add, psxRegs.cycle);
-			break;
-		}
-		hard = psxHu16(add);
+	if ((u16)add - 0x1000u < 0x1000u) {
+		HW_STAT(1, add);
+		return HW_R16(add)(add);
 	}
-	
-	//printf("r16 %08x     %04x @%08x\n", add, hard, psxRegs.pc);
-	return hard;
+	return psxHu16(add);
 }
 
 u32 psxHwRead32(u32 add) {
-	u32 hard;
-
-	switch (add & 0xffff) {
-	case 0x1040: hard = sioRead8(); break;
-	case 0x1044: hard = sioReadStat16(); break;
-	case 0x1100: hard = psxRcntRcount0(); break;
-	case 0x1104: hard = psxRcntRmode(0); break;
-	case 0x1108: hard = psxRcntRtarget(0); break;
-	case 0x1110: hard = psxRcntRcount1(); break;
-	case 0x1114: hard = psxRcntRmode(1); break;
-	case 0x1118: hard = psxRcntRtarget(1); break;
-	case 0x1120: hard = psxRcntRcount2(); break;
-	case 0x1124: hard = psxRcntRmode(2); break;
-	case 0x1128: hard = psxRcntRtarget(2); break;
-	case 0x1810: hard = GPU_readData(); break;
-	case 0x1814: hard = psxHwReadGpuSR(); break;
-	case 0x1820: hard = mdecRead0(); break;
-	case 0x1824: hard = mdecRead1(); break;
-
-	case 0x1048:
-	case 0x104c:
-	case 0x1050:
-	case 0x1054:
-	case 0x1058:
-	case 0x105c:
-	case 0x1800:
-		log_unhandled("unhandled r32 %08x @%08x\n", add, psxRegs.pc);
-		// falthrough
-	default:
-		if (0x1f801c00 <= add && add < 0x1f802000) {
-			hard = SPU_readRegister(add, psxRegs.cycle);
-			hard |= SPU_readRegister(add + 2, psxRegs.cycle) << 16;
-			break;
-		}
-		hard = psxHu32(add);
+	if ((u16)add - 0x1000u < 0x1000u) {
+		HW_STAT(2, add);
+		return HW_R32(add)(add);
 	}
-	//printf("r32 %08x %08x @%08x\n", add, hard, psxRegs.pc);
-	return hard;
+	return psxHu32(add);
 }
 
 void psxHwWrite8(u32 add, u32 value) {
+	HW_STAT(0, add);
 	switch (add & 0xffff) {
 	case 0x1040: sioWrite8(value); return;
 	case 0x10f6:
@@ -331,130 +525,19 @@ void psxHwWrite8(u32 add, u32 value) {
 }
 
 void psxHwWrite16(u32 add, u32 value) {
-	switch (add & 0xffff) {
-	case 0x1040: sioWrite8(value); return;
-	case 0x1044: sioWriteStat16(value); return;
-	case 0x1048: sioWriteMode16(value); return;
-	case 0x104a: sioWriteCtrl16(value); return;
-	case 0x104e: sioWriteBaud16(value); return;
-	case 0x1070: psxHwWriteIstat(value); return;
-	case 0x1074: psxHwWriteImask(value); return;
-	case 0x1100: psxRcntWcount(0, value); return;
-	case 0x1104: psxRcntWmode(0, value); return;
-	case 0x1108: psxRcntWtarget(0, value); return;
-	case 0x1110: psxRcntWcount(1, value); return;
-	case 0x1114: psxRcntWmode(1, value); return;
-	case 0x1118: psxRcntWtarget(1, value); return;
-	case 0x1120: psxRcntWcount(2, value); return;
-	case 0x1124: psxRcntWmode(2, value); return;
-	case 0x1128: psxRcntWtarget(2, value); return;
-
-	// forced write32:
-	case 0x1088: // DMA0 chcr (MDEC in DMA)
-	case 0x108c: psxHwWriteChcr0(value); return;
-	case 0x1098: // DMA1 chcr (MDEC out DMA)
-	case 0x109c: psxHwWriteChcr1(value); return;
-	case 0x10a8: // DMA2 chcr (GPU DMA)
-	case 0x10ac: psxHwWriteChcr2(value); return;
-	case 0x10b8: // DMA3 chcr (CDROM DMA)
-	case 0x10bc: psxHwWriteChcr3(value); return;
-	case 0x10c8: // DMA4 chcr (SPU DMA)
-	case 0x10cc: psxHwWriteChcr4(value); return;
-	case 0x10e8: // DMA6 chcr (OT clear)
-	case 0x10ec: psxHwWriteChcr6(value); return;
-	case 0x10f0: psxHwWriteDmaPcr32(value); return;
-	case 0x10f4: psxHwWriteDmaIcr32(value); return;
-
-	// forced write32 with no immediate effect:
-	case 0x1014:
-	case 0x1060:
-	case 0x1080:
-	case 0x1090:
-	case 0x10a0:
-	case 0x10b0:
-	case 0x10c0:
-	case 0x10d0:
-	case 0x10e0:
-		psxHu32ref(add) = SWAPu32(value);
+	if ((u16)add - 0x1000u < 0x1000u) {
+		HW_STAT(1, add);
+		HW_W16(add)(add, value);
 		return;
-
-	case 0x1800:
-	case 0x1802:
-	case 0x1810:
-	case 0x1812:
-	case 0x1814:
-	case 0x1816:
-	case 0x1820:
-	case 0x1822:
-	case 0x1824:
-	case 0x1826:
-		log_unhandled("unhandled w16 %08x @%08x\n", add, psxRegs.pc);
-		break;
-
-	default:
-		if (0x1f801c00 <= add && add < 0x1f802000) {
-			SPU_writeRegister(add, value, psxRegs.cycle);
-			return;
-		}
-		else if (0x1f801000 <= add && add < 0x1f801800)
-			log_unhandled("unhandled w16 %08x %08x @%08x\n",
-				add, value, psxRegs.pc);
 	}
 	psxHu16ref(add) = SWAPu16(value);
 }
 
 void psxHwWrite32(u32 add, u32 value) {
-	switch (add & 0xffff) {
-	case 0x1040: sioWrite8(value); return;
-	case 0x1070: psxHwWriteIstat(value); return;
-	case 0x1074: psxHwWriteImask(value); return;
-	case 0x1088: // DMA0 chcr (MDEC in DMA)
-	case 0x108c: psxHwWriteChcr0(value); return;
-	case 0x1098: // DMA1 chcr (MDEC out DMA)
-	case 0x109c: psxHwWriteChcr1(value); return;
-	case 0x10a8: // DMA2 chcr (GPU DMA)
-	case 0x10ac: psxHwWriteChcr2(value); return;
-	case 0x10b8: // DMA3 chcr (CDROM DMA)
-	case 0x10bc: psxHwWriteChcr3(value); return;
-	case 0x10c8: // DMA4 chcr (SPU DMA)
-	case 0x10cc: psxHwWriteChcr4(value); return;
-	case 0x10e8: // DMA6 chcr (OT clear)
-	case 0x10ec: psxHwWriteChcr6(value); return;
-	case 0x10f0: psxHwWriteDmaPcr32(value); return;
-	case 0x10f4: psxHwWriteDmaIcr32(value); return;
-
-	case 0x1810: GPU_writeData(value); return;
-	case 0x1814: psxHwWriteGpuSR(value); return;
-	case 0x1820: mdecWrite0(value); break;
-	case 0x1824: mdecWrite1(value); break;
-
-	case 0x1100: psxRcntWcount(0, value & 0xffff); return;
-	case 0x1104: psxRcntWmode(0, value); return;
-	case 0x1108: psxRcntWtarget(0, value & 0xffff); return;
-	case 0x1110: psxRcntWcount(1, value & 0xffff); return;
-	case 0x1114: psxRcntWmode(1, value); return;
-	case 0x1118: psxRcntWtarget(1, value & 0xffff); return;
-	case 0x1120: psxRcntWcount(2, value & 0xffff); return;
-	case 0x1124: psxRcntWmode(2, value); return;
-	case 0x1128: psxRcntWtarget(2, value & 0xffff); return;
-
-	case 0x1044:
-	case 0x1048:
-	case 0x104c:
-	case 0x1050:
-	case 0x1054:
-	case 0x1058:
-	case 0x105c:
-	case 0x1800:
-		log_unhandled("unhandled w32 %08x %08x @%08x\n", add, value, psxRegs.pc);
-		break;
-
-	default:
-		if (0x1f801c00 <= add && add < 0x1f802000) {
-			SPU_writeRegister(add, value&0xffff, psxRegs.cycle);
-			SPU_writeRegister(add + 2, value>>16, psxRegs.cycle);
-			return;
-		}
+	if ((u16)add - 0x1000u < 0x1000u) {
+		HW_STAT(2, add);
+		HW_W32(add)(add, value);
+		return;
 	}
 	psxHu32ref(add) = SWAPu32(value);
 }
@@ -82,6 +82,9 @@ void psxHwWrite16(u32 add, u32 value);
 void psxHwWrite32(u32 add, u32 value);
 u32 sio1ReadStat16(void);
 int psxHwFreeze(void *f, int Mode);
+#ifdef PSXHW_STATS
+void psxHwPrintStats(void); // most accessed registers since the last call
+#endif
 
 void psxHwWriteIstat(u32 value);
 void psxHwWriteImask(u32 value);
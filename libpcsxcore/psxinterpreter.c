@@ -1029,9 +1029,48 @@ OP(psxCOP1) {
 	log_unhandled("COP1 %08x @%08x\n", code, regs_->pc - 4);
 }
 
+#ifdef GTE_TRACE
+/*
+ * PCSX_GTE_TRACE=file records the inputs of the first GTE_TRACE_MAX cop2
+ * ops the interpreter runs, for tools/gtebench: "GTET", version, record
+ * size, then per op the opcode and all 64 cop2 registers, host endian.
+ */
+#include <stdio.h>
+
+#define GTE_TRACE_MAX 200000
+
+static void gte_trace(const psxCP2Regs *cp2, u32 code) {
+	static FILE *f;
+	static int state, count;
+	u32 hdr[3] = { 0x54455447, 1, 4 + sizeof(*cp2) };
+	const char *path;
+
+	if (state == 0) {
+		state = -1;
+		path = getenv("PCSX_GTE_TRACE");
+		if (path == NULL || (f = fopen(path, "wb")) == NULL)
+			return;
+		fwrite(hdr, 1, sizeof(hdr), f);
+		state = 1;
+	}
+	if (state < 0)
+		return;
+	fwrite(&code, 1, sizeof(code), f);
+	fwrite(cp2, 1, sizeof(*cp2), f);
+	if (++count == GTE_TRACE_MAX) {
+		fclose(f);
+		SysPrintf("gte trace: %d ops written\n", count);
+		state = -1;
+	}
+}
+#endif
+
 OP(psxCOP2) {
 	u32 rt = _Rt_, rd = _Rd_, rs = _Rs_;
 	if (rs & 0x10) {
+#ifdef GTE_TRACE
+		gte_trace(&regs_->CP2, code);
+#endif
 		psxCP2[_Funct_](&regs_->CP2);
 		return;
 	}
@@ -1169,6 +1208,119 @@ void (*psxCP2[64])(struct psxCP2Regs *regs) = {
 
 ///////////////////////////////////////////
 
+/*
+ * Predecoded mode: for every word of RAM/BIOS that gets executed keep
+ * the final handler (SPECIAL already resolved) and the opcode, so that
+ * the main loop can skip the memory LUT and the table walk. Pages are
+ * allocated on first execution and entries are dropped through ->Clear(),
+ * the same hook the dynarecs use.
+ */
+typedef void (INT_ATTR *psxOpFunc)(psxRegisters *regs_, u32 code);
+
+struct pd_insn {
+	psxOpFunc func; // NULL - not decoded
+	u32 code;
+};
+
+#define PD_PAGE_INSNS (0x1000 / 4)
+#define PD_RAM_PAGES  (0x200000 >> 12)
+#define PD_BIOS_PAGES (0x80000 >> 12)
+
+static struct pd_insn *pdPages[PD_RAM_PAGES + PD_BIOS_PAGES];
+static int pdEnabled;
+
+static int pdPageIndex(u32 addr) {
+	u32 seg = addr >> 29, a = addr & 0x1fffffff;
+
+	if (seg != 0 && seg != 4 && seg != 5)
+		return -1;
+	if (a < 0x800000)
+		return (a & 0x1fffff) >> 12;
+	if (a - 0x1fc00000 < 0x80000)
+		return PD_RAM_PAGES + ((a - 0x1fc00000) >> 12);
+	return -1;
+}
+
+static struct pd_insn *pdLookup(u32 pc) {
+	struct pd_insn *page;
+	int i = pdPageIndex(pc);
+
+	if (i < 0)
+		return NULL;
+	page = pdPages[i];
+	if (unlikely(page == NULL)) {
+		page = pdPages[i] = calloc(PD_PAGE_INSNS, sizeof(page[0]));
+		if (page == NULL)
+			return NULL;
+	}
+	return &page[(pc & 0xfff) >> 2];
+}
+
+// coprocessor handlers change with SR, see setupCop()
+OP(pdCOPx) {
+	psxBSC[code >> 26](regs_, code);
+}
+
+static psxOpFunc pdResolve(u32 code) {
+	switch (code >> 26) {
+		case 0x00: return psxSPC[code & 0x3f];
+		case 0x11:
+		case 0x12:
+		case 0x13: return pdCOPx;
+	}
+	return psxBSC[code >> 26];
+}
+
+static void pdFlush(void) {
+	int i;
+	for (i = 0; i < sizeof(pdPages) / sizeof(pdPages[0]); i++) {
+		free(pdPages[i]);
+		pdPages[i] = NULL;
+	}
+}
+
+// Size is in words
+static void pdClear(u32 addr, u32 size) {
+	addr &= ~3;
+	while (size > 0) {
+		u32 n = (0x1000 - (addr & 0xfff)) >> 2;
+		int i = pdPageIndex(addr);
+		if (n > size)
+			n = size;
+		if (i >= 0 && pdPages[i] != NULL)
+			memset(&pdPages[i][(addr & 0xfff) >> 2], 0, n * sizeof(pdPages[i][0]));
+		addr += n * 4;
+		size -= n;
+	}
+}
+
+static inline void execIpd(u8 **memRLUT, psxRegisters *regs) {
+	u32 pc = regs->pc, code;
+	struct pd_insn *pd;
+
+	addCycle(regs);
+	dloadStep(regs);
+
+	regs->pc += 4;
+	pd = pdLookup(pc);
+	// the icache may hold stale code, so it has to be consulted every time
+	if (likely(pd != NULL && pd->func != NULL) && fetch != fetchICache) {
+		regs->code = pd->code;
+		pd->func(regs, pd->code);
+		return;
+	}
+	regs->code = code = fetch(regs, memRLUT, pc);
+	if (pd == NULL) {
+		psxBSC[code >> 26](regs, code);
+		return;
+	}
+	if (pd->func == NULL || pd->code != code) {
+		pd->code = code;
+		pd->func = pdResolve(code);
+	}
+	pd->func(regs, code);
+}
+
 static int intInit() {
 	intApplyConfig();
 	return 0;
@@ -1204,6 +1356,114 @@ static inline void execIbp(u8 **memRLUT, psxRegisters *regs) {
 	psxBSC[regs->code >> 26](regs, regs->code);
 }
 
+#if defined(__GNUC__) && !defined(__STRICT_ANSI__)
+#define HAVE_INT_CG
+
+// Computed goto loop for the plain (no icache, no precise exceptions)
+// mode. pc, the cycle counters and the code word stay in locals across
+// the common alu ops, which are handled right here. Anything else is
+// called through psxBSC[] as usual, with the state written back first
+// and reloaded after, so the handlers see no difference.
+static void intExecuteCg_(psxRegisters *regs_, int block) {
+	static const void * const ops[64] = {
+		[0 ... 63] = &&op_call,
+		[0x00] = &&op_special,
+		[0x09] = &&op_addiu, [0x0a] = &&op_slti, [0x0b] = &&op_sltiu,
+		[0x0c] = &&op_andi,  [0x0d] = &&op_ori,  [0x0e] = &&op_xori,
+		[0x0f] = &&op_lui,
+	};
+	static const void * const spc[64] = {
+		[0 ... 63] = &&op_call,
+		[0x00] = &&op_sll,  [0x02] = &&op_srl,  [0x03] = &&op_sra,
+		[0x04] = &&op_sllv, [0x06] = &&op_srlv, [0x07] = &&op_srav,
+		[0x11] = &&op_mthi, [0x13] = &&op_mtlo,
+		[0x21] = &&op_addu, [0x23] = &&op_subu,
+		[0x24] = &&op_and,  [0x25] = &&op_or,   [0x26] = &&op_xor,
+		[0x27] = &&op_nor,  [0x2a] = &&op_slt,  [0x2b] = &&op_sltu,
+	};
+	u8 **memRLUT = psxMemRLUT;
+	u32 pc, code, cycle, subCycle;
+	const u32 step = regs_->subCycleStep;
+	u32 *p;
+
+	if (block)
+		regs_->branchSeen = 0;
+	else if (regs_->stop)
+		return;
+
+	pc = regs_->pc;
+	cycle = regs_->cycle;
+	subCycle = regs_->subCycle;
+
+next:
+	subCycle += step;
+	cycle += subCycle >> 16;
+	subCycle &= 0xffff;
+	dloadStep(regs_);
+
+	p = (u32 *)psxm_lut(pc & ~0x3, 0, memRLUT);
+	if (likely(p != INVALID_PTR))
+		code = SWAP32(*p);
+	else {
+		regs_->pc = pc + 4;
+		regs_->cycle = cycle;
+		regs_->subCycle = subCycle;
+		code = fetchNoCache(regs_, memRLUT, pc); // the exception sets pc
+		pc = regs_->pc - 4;
+	}
+	pc += 4;
+	goto *ops[code >> 26];
+
+op_special: goto *spc[code & 0x3f];
+
+op_addiu: dloadRt(regs_, _Rt_, _u32(_rRs_) + _Imm_);     goto next;
+op_slti:  dloadRt(regs_, _Rt_, _i32(_rRs_) < _Imm_);     goto next;
+op_sltiu: dloadRt(regs_, _Rt_, _u32(_rRs_) < ((u32)_Imm_)); goto next;
+op_andi:  dloadRt(regs_, _Rt_, _u32(_rRs_) & _ImmU_);    goto next;
+op_ori:   dloadRt(regs_, _Rt_, _u32(_rRs_) | _ImmU_);    goto next;
+op_xori:  dloadRt(regs_, _Rt_, _u32(_rRs_) ^ _ImmU_);    goto next;
+op_lui:   dloadRt(regs_, _Rt_, code << 16);              goto next;
+
+op_sll:   dloadRt(regs_, _Rd_, _u32(_rRt_) << _Sa_);     goto next;
+op_srl:   dloadRt(regs_, _Rd_, _u32(_rRt_) >> _Sa_);     goto next;
+op_sra:   dloadRt(regs_, _Rd_, _i32(_rRt_) >> _Sa_);     goto next;
+op_sllv:  dloadRt(regs_, _Rd_, _u32(_rRt_) << (_u32(_rRs_) & 0x1F)); goto next;
+op_srlv:  dloadRt(regs_, _Rd_, _u32(_rRt_) >> (_u32(_rRs_) & 0x1F)); goto next;
+op_srav:  dloadRt(regs_, _Rd_, _i32(_rRt_) >> (_u32(_rRs_) & 0x1F)); goto next;
+op_mthi:  _rHi_ = _rRs_;                                 goto next;
+op_mtlo:  _rLo_ = _rRs_;                                 goto next;
+op_addu:  dloadRt(regs_, _Rd_, _u32(_rRs_) + _u32(_rRt_)); goto next;
+op_subu:  dloadRt(regs_, _Rd_, _u32(_rRs_) - _u32(_rRt_)); goto next;
+op_and:   dloadRt(regs_, _Rd_, _u32(_rRs_) & _u32(_rRt_)); goto next;
+op_or:    dloadRt(regs_, _Rd_, _u32(_rRs_) | _u32(_rRt_)); goto next;
+op_xor:   dloadRt(regs_, _Rd_, _u32(_rRs_) ^ _u32(_rRt_)); goto next;
+op_nor:   dloadRt(regs_, _Rd_, ~_u32(_rRs_ | _u32(_rRt_))); goto next;
+op_slt:   dloadRt(regs_, _Rd_, _i32(_rRs_) < _i32(_rRt_)); goto next;
+op_sltu:  dloadRt(regs_, _Rd_, _u32(_rRs_) < _u32(_rRt_)); goto next;
+
+op_call:
+	regs_->pc = pc;
+	regs_->cycle = cycle;
+	regs_->subCycle = subCycle;
+	regs_->code = code;
+	psxBSC[code >> 26](regs_, code);
+	if (block ? regs_->branchSeen : regs_->stop)
+		return;
+	pc = regs_->pc;
+	cycle = regs_->cycle;
+	subCycle = regs_->subCycle;
+	goto next;
+}
+
+static void intExecuteCg(psxRegisters *regs) {
+	intExecuteCg_(regs, 0);
+}
+
+static void intExecuteBlockCg(psxRegisters *regs, enum blockExecCaller caller) {
+	intExecuteCg_(regs, 1);
+}
+#endif
+
 static void intExecute(psxRegisters *regs) {
 	u8 **memRLUT = psxMemRLUT;
 
@@ -1234,7 +1494,24 @@ static void intExecuteBlockBp(psxRegisters *regs, enum blockExecCaller caller) {
 		execIbp(memRLUT, regs);
 }
 
+static void intExecutePd(psxRegisters *regs) {
+	u8 **memRLUT = psxMemRLUT;
+
+	while (!regs->stop)
+		execIpd(memRLUT, regs);
+}
+
+static void intExecuteBlockPd(psxRegisters *regs, enum blockExecCaller caller) {
+	u8 **memRLUT = psxMemRLUT;
+
+	regs->branchSeen = 0;
+	while (!regs->branchSeen)
+		execIpd(memRLUT, regs);
+}
+
 static void intClear(u32 Addr, u32 Size) {
+	if (pdEnabled)
+		pdClear(Addr, Size);
 }
 
 static void intNotify(enum R3000Anote note, void *data) {
@@ -1246,6 +1523,7 @@ static void intNotify(enum R3000Anote note, void *data) {
 		dloadClear(&psxRegs);
 		psxRegs.subCycle = 0;
 		setupCop(psxRegs.CP0.n.SR);
+		pdFlush();
 		// fallthrough
 	case R3000ACPU_NOTIFY_CACHE_ISOLATED: // Armored Core?
 		if (fetch == fetchICache)
@@ -1353,6 +1631,22 @@ void intApplyConfig() {
 	else
 		fetch = fetchICache;
 
+#ifdef HAVE_INT_CG
+	if (fetch == fetchNoCache && !Config.PreciseExceptions) {
+		psxInt.Execute = intExecuteCg;
+		psxInt.ExecuteBlock = intExecuteBlockCg;
+	}
+#endif
+
+	// handlers may have changed, so start over
+	pdFlush();
+	pdEnabled = Config.PredecodeInt && !Config.PreciseExceptions
+		&& psxCpu == &psxInt;
+	if (pdEnabled) {
+		psxInt.Execute = intExecutePd;
+		psxInt.ExecuteBlock = intExecuteBlockPd;
+	}
+
 	cycle_mult = Config.cycle_multiplier_override && Config.cycle_multiplier == CYCLE_MULT_DEFAULT
 		? Config.cycle_multiplier_override : Config.cycle_multiplier;
 	psxRegs.subCycleStep = 0x10000 * cycle_mult / 100;
@@ -1360,6 +1654,8 @@ void intApplyConfig() {
 
 static void intShutdown() {
 	dloadClear(&psxRegs);
+	pdFlush();
+	pdEnabled = 0;
 }
 
 // single step (may do several ops in case of a branch or load delay)
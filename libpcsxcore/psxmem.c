@@ -33,6 +33,8 @@
 
 #include "lightrec/mem.h"
 #include "memmap.h"
+#include "cdrom-async.h"
+#include "new_dynarec/new_dynarec.h"
 
 #ifdef USE_LIBRETRO_VFS
 #include <streams/file_stream_transforms.h>
@@ -42,6 +44,54 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+// large mappings, for psxMapReportHuge() and the MAP_HUGETLB unmap size
+static struct {
+	void *ptr;
+	size_t size;
+	enum psxMapTag tag;
+	int hugetlb;
+} bigMaps[8];
+
+static void bigMapAdd(void *ptr, size_t size, enum psxMapTag tag, int hugetlb)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(bigMaps) / sizeof(bigMaps[0]); i++) {
+		if (bigMaps[i].ptr == NULL || bigMaps[i].ptr == ptr) {
+			bigMaps[i].ptr = ptr;
+			bigMaps[i].size = size;
+			bigMaps[i].tag = tag;
+			bigMaps[i].hugetlb = hugetlb;
+			return;
+		}
+	}
+}
+
+static int bigMapFind(const void *ptr)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(bigMaps) / sizeof(bigMaps[0]); i++)
+		if (ptr != NULL && bigMaps[i].ptr == ptr)
+			return i;
+	return -1;
+}
+
+void psxMapAdviseHuge(void *ptr, size_t size, enum psxMapTag tag)
+{
+	if (ptr == NULL || ptr == MAP_FAILED || size < HUGE_PAGE_SIZE / 2)
+		return;
+#if P_HAVE_MMAP && defined(MADV_HUGEPAGE)
+	// only the 2M aligned parts can actually use them
+	if (size >= HUGE_PAGE_SIZE)
+		madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	if (bigMapFind(ptr) < 0)
+		bigMapAdd(ptr, size, tag, 0);
+}
+
 static void * psxMapDefault(unsigned long addr, size_t size,
 			    enum psxMapTag tag, int *can_retry_addr)
 {
@@ -54,21 +104,34 @@ static void * psxMapDefault(unsigned long addr, size_t size,
 	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
 
 	*can_retry_addr = 1;
+#ifdef MAP_HUGETLB
+	// explicit huge pages only work if the admin reserved some
+	// (vm.nr_hugepages), so they are opt-in
+	if (size >= HUGE_PAGE_SIZE && getenv("PCSX_HUGETLB")) {
+		size_t hsize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+		ptr = mmap((void *)(uintptr_t)addr, hsize,
+			    PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (ptr != MAP_FAILED) {
+			bigMapAdd(ptr, size, tag, 1);
+			return ptr;
+		}
+		SysPrintf("psxMap: MAP_HUGETLB failed for %zu bytes\n", size);
+	}
+#endif
 	ptr = mmap((void *)(uintptr_t)addr, size,
 		    PROT_READ | PROT_WRITE, flags, -1, 0);
 #ifdef MADV_HUGEPAGE
-	if (size >= 2*1024*1024) {
-		if (ptr != MAP_FAILED && ((uintptr_t)ptr & (2*1024*1024 - 1))) {
+	if (size >= HUGE_PAGE_SIZE) {
+		if (ptr != MAP_FAILED && ((uintptr_t)ptr & (HUGE_PAGE_SIZE - 1))) {
 			// try to manually realign assuming decreasing addr alloc
 			munmap(ptr, size);
-			addr = (uintptr_t)ptr & ~(2*1024*1024 - 1);
+			addr = (uintptr_t)ptr & ~(HUGE_PAGE_SIZE - 1);
 			ptr = mmap((void *)(uintptr_t)addr, size,
 				PROT_READ | PROT_WRITE, flags, -1, 0);
 		}
-		if (ptr != MAP_FAILED)
-			madvise(ptr, size, MADV_HUGEPAGE);
 	}
 #endif
+	psxMapAdviseHuge(ptr, size, tag);
 	return ptr;
 #endif
 }
@@ -78,6 +141,11 @@ static void psxUnmapDefault(void *ptr, size_t size, enum psxMapTag tag)
 #if !P_HAVE_MMAP
 	free(ptr);
 #else
+	int i = bigMapFind(ptr);
+
+	// hugetlb mappings have to be unmapped in whole huge pages
+	if (i >= 0 && bigMaps[i].hugetlb)
+		size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
 	munmap(ptr, size);
 #endif
 }
@@ -128,6 +196,93 @@ void *psxMap(unsigned long addr, size_t size, int is_fixed,
 void psxUnmap(void *ptr, size_t size, enum psxMapTag tag)
 {
 	psxUnmapHook(ptr, size, tag);
+	psxMapForgetHuge(ptr);
+}
+
+void psxMapForgetHuge(void *ptr)
+{
+	int i = bigMapFind(ptr);
+
+	if (i >= 0)
+		bigMaps[i].ptr = NULL;
+}
+
+// sums AnonHugePages of the smaps entries overlapping [start, end)
+static long hugeKb(FILE *f, uintptr_t start, uintptr_t end)
+{
+	unsigned long vs, ve, kb;
+	int inside = 0;
+	long total = 0;
+	char line[256];
+
+	rewind(f);
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lx-%lx ", &vs, &ve) == 2)
+			inside = vs < end && ve > start;
+		else if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+			total += kb;
+	}
+	return total;
+}
+
+void psxMapReportHuge(void)
+{
+	static const char * const names[] = { "other", "ram", "vram", "luts", "tcache" };
+	FILE *f = NULL;
+	size_t i;
+
+#ifdef __linux__
+	f = fopen("/proc/self/smaps", "r");
+#endif
+	for (i = 0; i < sizeof(bigMaps) / sizeof(bigMaps[0]); i++) {
+		uintptr_t p = (uintptr_t)bigMaps[i].ptr;
+		const char *name;
+
+		if (p == 0)
+			continue;
+		name = (size_t)bigMaps[i].tag < sizeof(names) / sizeof(names[0])
+			? names[bigMaps[i].tag] : "?";
+		if (bigMaps[i].hugetlb)
+			SysPrintf("huge pages: %-6s %p %7zuK hugetlb\n", name,
+				bigMaps[i].ptr, bigMaps[i].size >> 10);
+		else if (f != NULL)
+			SysPrintf("huge pages: %-6s %p %7zuK %ldK thp\n", name,
+				bigMaps[i].ptr, bigMaps[i].size >> 10,
+				hugeKb(f, p, p + bigMaps[i].size));
+	}
+	if (f != NULL)
+		fclose(f);
+}
+
+void psxMemReportUsage(void)
+{
+	// psxM with the 64K for psxP, psxH, psxR
+	size_t ram = 0x00210000 + 0x10000 + 0x80000;
+	size_t luts = psxMemRLUT ? 2 * 0x10000 * sizeof(void *) : 0;
+	size_t vram = 0, i;
+	struct ndrc_stats st;
+
+	for (i = 0; i < sizeof(bigMaps) / sizeof(bigMaps[0]); i++)
+		if (bigMaps[i].ptr != NULL && bigMaps[i].tag == MAP_TAG_VRAM)
+			vram += bigMaps[i].size;
+	new_dynarec_get_stats(&st);
+	SysPrintf("mem: ram+bios %zuK luts %zuK vram %zuK tcache %uK cdrom %zuK\n",
+		ram >> 10, luts >> 10, vram >> 10, st.tc_size >> 10,
+		cdra_get_mem_usage() >> 10);
+	if (Config.MemBudgetMB > 0)
+		SysPrintf("mem: low memory mode, %d MB budget\n", Config.MemBudgetMB);
+#ifdef __linux__
+	{
+		FILE *f = fopen("/proc/self/status", "r");
+		char line[128];
+
+		while (f != NULL && fgets(line, sizeof(line), f))
+			if (!strncmp(line, "VmRSS:", 6) || !strncmp(line, "VmHWM:", 6))
+				SysPrintf("mem: %s", line);
+		if (f != NULL)
+			fclose(f);
+	}
+#endif
 }
 
 s8 *psxM = NULL; // Kernel & User Memory (2 Meg)
@@ -256,12 +411,19 @@ int psxMemInit(void)
 	return 0;
 }
 
+static int hugeReported;
+
 void psxMemReset() {
 	FILE *f = NULL;
 	char bios[1024];
 
 	memset(psxM, 0, 0x00200000);
 	memset(psxP, 0xff, 0x00010000);
+	if (!hugeReported) {
+		// everything is mapped and ram just got touched
+		psxMapReportHuge();
+		hugeReported = 1;
+	}
 
 	Config.HLE = TRUE;
 
@@ -272,11 +434,19 @@ void psxMemReset() {
 		if (f == NULL) {
 			SysMessage(_("Could not open BIOS:\"%s\". Enabling HLE Bios!\n"), bios);
 		} else {
-			if (fread(psxR, 1, 0x80000, f) == 0x80000) {
+			// an unchanged bios is not written again so that the pages
+			// stay shared with the other instances after a -farm fork
+			u8 *buf = malloc(0x80000);
+			u8 *dst = buf ? buf : (u8 *)psxR;
+
+			if (fread(dst, 1, 0x80000, f) == 0x80000) {
+				if (buf && memcmp(psxR, buf, 0x80000) != 0)
+					memcpy(psxR, buf, 0x80000);
 				Config.HLE = FALSE;
 			} else {
 				SysMessage(_("The selected BIOS:\"%s\" is of wrong size. Enabling HLE Bios!\n"), bios);
 			}
+			free(buf);
 			fclose(f);
 		}
 	}
@@ -284,7 +454,63 @@ void psxMemReset() {
 		memset(psxR, 0, 0x80000);
 }
 
+#ifdef PSXMEM_HEATMAP
+
+#define HEAT_RAM	(0x200000 >> 8)
+#define HEAT_SCRATCH	(0x400 >> 8)
+#define HEAT_IO		(0x1000 >> 8)
+#define HEAT_REGIONS	(HEAT_RAM + HEAT_SCRATCH + HEAT_IO)
+
+static u32 heat[PSX_HEAT_TYPES][HEAT_REGIONS];
+
+void psxHeatCount(u32 mem, int type)
+{
+	u32 a = mem & 0x1fffffff;
+	u32 i;
+
+	if (a < 0x800000)
+		i = (a & 0x1fffff) >> 8;
+	else if (a - 0x1f800000 < 0x400)
+		i = HEAT_RAM + ((a & 0x3ff) >> 8);
+	else if (a - 0x1f801000 < 0x1000)
+		i = HEAT_RAM + HEAT_SCRATCH + ((a & 0xfff) >> 8);
+	else
+		return;
+	heat[type][i]++;
+}
+
+int psxHeatDump(const char *fname)
+{
+	// all fields little endian u32 after the magic, then the counts
+	// as heat[type][region]
+	u32 hdr[6] = { 1, 256, HEAT_RAM, HEAT_SCRATCH, HEAT_IO, PSX_HEAT_TYPES };
+	u32 i, *p = &heat[0][0];
+	FILE *f;
+
+	f = fopen(fname, "wb");
+	if (f == NULL) {
+		SysPrintf("heatmap: can't write %s\n", fname);
+		return -1;
+	}
+	for (i = 0; i < sizeof(hdr) / 4; i++)
+		hdr[i] = SWAP32(hdr[i]);
+	for (i = 0; i < sizeof(heat) / 4; i++)
+		p[i] = SWAP32(p[i]);
+	fwrite("PSXHEAT", 1, 8, f);
+	fwrite(hdr, 1, sizeof(hdr), f);
+	fwrite(heat, 1, sizeof(heat), f);
+	fclose(f);
+	memset(heat, 0, sizeof(heat));
+	SysPrintf("heatmap: wrote %s\n", fname);
+	return 0;
+}
+
+#endif
+
 void psxMemShutdown() {
+#ifdef PSXMEM_HEATMAP
+	psxHeatDump("psxheat.bin");
+#endif
 	if (LIGHTREC_CUSTOM_MAP)
 		lightrec_free_mmap();
 	else
@@ -317,10 +543,22 @@ void psxMemOnIsolate(int enable)
 			: R3000ACPU_NOTIFY_CACHE_UNISOLATED, NULL);
 }
 
+// RAM is always 2MB mirrored over the first 8MB of KUSEG/KSEG0/KSEG1,
+// and makes up most accesses, so it skips the hw test and the LUT
+static inline int is_ram(u32 mem)
+{
+	u32 s = mem >> 23;
+	return s == 0 || s == 0x100 || s == 0x140;
+}
+
 u8 psxMemRead8(u32 mem) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_READ);
+	if (is_ram(mem) && !Config.Debug)
+		return psxMu8(mem);
+
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if ((mem & 0xffff) < 0x400)
@@ -346,6 +584,10 @@ u16 psxMemRead16(u32 mem) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_READ);
+	if (is_ram(mem) && !Config.Debug)
+		return psxMu16(mem);
+
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if ((mem & 0xffff) < 0x400)
@@ -371,6 +613,10 @@ u32 psxMemRead32(u32 mem) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_READ);
+	if (is_ram(mem) && !Config.Debug)
+		return psxMu32(mem);
+
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if ((mem & 0xffff) < 0x400)
@@ -398,6 +644,13 @@ void psxMemWrite8(u32 mem, u32 value) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_WRITE);
+	if (is_ram(mem) && !cache_isolated && !Config.Debug) {
+		psxMu8ref(mem) = value;
+		psxCpu->Clear((mem & (~3)), 1);
+		return;
+	}
+
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if ((mem & 0xffff) < 0x400)
@@ -410,9 +663,7 @@ void psxMemWrite8(u32 mem, u32 value) {
 			if (Config.Debug)
 				DebugCheckBP((mem & 0xffffff) | 0x80000000, W1);
 			*(u8 *)p = value;
-#ifndef DRC_DISABLE
 			psxCpu->Clear((mem & (~3)), 1);
-#endif
 		} else {
 #ifdef PSXMEM_LOG
 			PSXMEM_LOG("err sb %8.8lx\n", mem);
@@ -425,6 +676,13 @@ void psxMemWrite16(u32 mem, u32 value) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_WRITE);
+	if (is_ram(mem) && !cache_isolated && !Config.Debug) {
+		psxMu16ref(mem) = SWAPu16(value);
+		psxCpu->Clear((mem & (~3)), 1);
+		return;
+	}
+
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if ((mem & 0xffff) < 0x400)
@@ -437,9 +695,7 @@ void psxMemWrite16(u32 mem, u32 value) {
 			if (Config.Debug)
 				DebugCheckBP((mem & 0xffffff) | 0x80000000, W2);
 			*(u16 *)p = SWAPu16(value);
-#ifndef DRC_DISABLE
 			psxCpu->Clear((mem & (~3)), 1);
-#endif
 		} else {
 #ifdef PSXMEM_LOG
 			PSXMEM_LOG("err sh %8.8lx\n", mem);
@@ -452,6 +708,13 @@ void psxMemWrite32(u32 mem, u32 value) {
 	char *p;
 	u32 t;
 
+	psx_heat(mem, PSX_HEAT_WRITE);
+	if (is_ram(mem) && !cache_isolated && !Config.Debug) {
+		psxMu32ref(mem) = SWAPu32(value);
+		psxCpu->Clear(mem, 1);
+		return;
+	}
+
 //	if ((mem&0x1fffff) == 0x71E18 || value == 0x48088800) SysPrintf("t2fix!!\n");
 	t = mem >> 16;
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
@@ -465,9 +728,7 @@ void psxMemWrite32(u32 mem, u32 value) {
 			if (Config.Debug)
 				DebugCheckBP((mem & 0xffffff) | 0x80000000, W4);
 			*(u32 *)p = SWAPu32(value);
-#ifndef DRC_DISABLE
 			psxCpu->Clear(mem, 1);
-#endif
 		} else {
 			if (mem == 0xfffe0130) {
 				psxRegs.biuReg = value;
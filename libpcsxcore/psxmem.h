@@ -183,6 +183,24 @@ void psxMemWrite16(u32 mem, u32 value);
 void psxMemWrite32(u32 mem, u32 value);
 void *psxMemPointer(u32 mem);
 
+// build with -DPSXMEM_HEATMAP to count accesses per 256 byte region of
+// RAM, scratchpad and the I/O window, dumped on psxMemShutdown(). See
+// tools/psxheat.c for the file layout.
+enum psx_heat_type {
+	PSX_HEAT_READ = 0,
+	PSX_HEAT_WRITE,
+	PSX_HEAT_INVAL, // dynarec code invalidation requests
+	PSX_HEAT_TYPES
+};
+
+#ifdef PSXMEM_HEATMAP
+void psxHeatCount(u32 mem, int type);
+int  psxHeatDump(const char *fname);
+#define psx_heat(mem, type) psxHeatCount(mem, type)
+#else
+#define psx_heat(mem, type)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,7 @@ enum psxMapTag {
 	MAP_TAG_RAM,
 	MAP_TAG_VRAM,
 	MAP_TAG_LUTS,
+	MAP_TAG_TCACHE,
 };
 
 extern void *(*psxMapHook)(unsigned long addr, size_t size,
@@ -37,6 +38,15 @@ void *psxMap(unsigned long addr, size_t size, int is_fixed,
 		enum psxMapTag tag);
 void psxUnmap(void *ptr, size_t size, enum psxMapTag tag);
 
+// madvise(MADV_HUGEPAGE) for a large mapping not made by the default
+// psxMapHook, and remember it for psxMapReportHuge()
+void psxMapAdviseHuge(void *ptr, size_t size, enum psxMapTag tag);
+void psxMapForgetHuge(void *ptr);
+// print how much of the large mappings is backed by huge pages
+void psxMapReportHuge(void);
+// core memory use by subsystem, the process RSS where available
+void psxMemReportUsage(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,240 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ***************************************************************************/
+
+/*
+ * Sampling profiler for the emulated code. A thread looks at psxRegs.pc
+ * every interval_us and counts the values in a hash table. The interpreter
+ * keeps pc exact, the dynarecs only write it back when they leave a block
+ * or run events, so there a sample is "the block that ran last", weighted
+ * by how often events happen in it. Good enough to find the hot loops.
+ * Samples where neither pc nor cycle moved (menu, pause) are not counted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psxcommon.h"
+#include "r3000a.h"
+#include "psxprof.h"
+
+#ifdef USE_PSX_PROFILER
+
+#include <stdint.h>
+#include "../frontend/pcsxr-threads.h"
+#ifdef HAVE_LIBRETRO
+#include "retro_timers.h"
+#else
+#include <unistd.h>
+#endif
+
+#define PROF_HASH_BITS		16
+#define PROF_HASH_SIZE		(1u << PROF_HASH_BITS)
+// new pcs are dropped past this, keeps the probe loops short
+#define PROF_HASH_FILL		(PROF_HASH_SIZE / 4 * 3)
+#define PROF_DEFAULT_US		1000
+
+static struct {
+	struct psx_prof_entry *hash;
+	sthread_t *thread;
+	slock_t *lock;
+	unsigned int total, dropped, used;
+	int interval_us;
+	volatile int stop;
+} prof;
+
+static void prof_add(u32 pc)
+{
+	u32 h = ((pc >> 2) * 0x9e3779b1u) >> (32 - PROF_HASH_BITS);
+	struct psx_prof_entry *e;
+
+	for (;; h = (h + 1) & (PROF_HASH_SIZE - 1)) {
+		e = &prof.hash[h];
+		if (e->count == 0)
+			break;
+		if (e->pc == pc) {
+			e->count++;
+			return;
+		}
+	}
+	if (prof.used >= PROF_HASH_FILL) {
+		prof.dropped++;
+		return;
+	}
+	e->pc = pc;
+	e->count = 1;
+	prof.used++;
+}
+
+static STRHEAD_RET_TYPE prof_thread(void *unused)
+{
+	u32 last_pc = ~0u, last_cycle = 0;
+
+	while (!prof.stop) {
+		u32 pc = *(volatile u32 *)&psxRegs.pc;
+		u32 cycle = *(volatile u32 *)&psxRegs.cycle;
+
+		if (pc != last_pc || cycle != last_cycle) {
+			slock_lock(prof.lock);
+			prof_add(pc);
+			prof.total++;
+			slock_unlock(prof.lock);
+			last_pc = pc;
+			last_cycle = cycle;
+		}
+#ifdef HAVE_LIBRETRO
+		retro_sleep(prof.interval_us >= 1000 ? prof.interval_us / 1000 : 1);
+#else
+		usleep(prof.interval_us);
+#endif
+	}
+	STRHEAD_RETURN();
+}
+
+int psxProfStart(int interval_us)
+{
+	psxProfStop();
+
+	if (prof.lock == NULL && (prof.lock = slock_new()) == NULL)
+		return -1;
+	if (prof.hash == NULL) {
+		prof.hash = calloc(PROF_HASH_SIZE, sizeof(prof.hash[0]));
+		if (prof.hash == NULL)
+			return -1;
+	}
+	else
+		memset(prof.hash, 0, PROF_HASH_SIZE * sizeof(prof.hash[0]));
+	prof.total = prof.dropped = prof.used = 0;
+	prof.interval_us = interval_us > 0 ? interval_us : PROF_DEFAULT_US;
+	prof.stop = 0;
+
+	prof.thread = pcsxr_sthread_create(prof_thread, PCSXRT_PROF);
+	if (prof.thread == NULL) {
+		SysPrintf("psxprof: failed to create the thread\n");
+		return -1;
+	}
+	SysPrintf("psxprof: sampling every %d us\n", prof.interval_us);
+	return 0;
+}
+
+void psxProfStop(void)
+{
+	if (prof.thread == NULL)
+		return;
+	prof.stop = 1;
+	sthread_join(prof.thread);
+	prof.thread = NULL;
+	SysPrintf("psxprof: %u samples, %u pcs, %u dropped\n",
+		prof.total, prof.used, prof.dropped);
+}
+
+int psxProfRunning(void)
+{
+	return prof.thread != NULL;
+}
+
+static int prof_cmp(const void *a_, const void *b_)
+{
+	const struct psx_prof_entry *a = a_, *b = b_;
+	if (a->count != b->count)
+		return a->count < b->count ? 1 : -1;
+	return a->pc < b->pc ? -1 : a->pc > b->pc;
+}
+
+// sorted copy of the used entries, the sampler may keep running meanwhile
+static struct psx_prof_entry *prof_snapshot(unsigned int *count,
+	unsigned int *total)
+{
+	struct psx_prof_entry *s;
+	unsigned int i, n = 0;
+
+	if (prof.hash == NULL)
+		return NULL;
+	s = malloc(PROF_HASH_SIZE * sizeof(s[0]));
+	if (s == NULL)
+		return NULL;
+	if (prof.lock)
+		slock_lock(prof.lock);
+	for (i = 0; i < PROF_HASH_SIZE; i++)
+		if (prof.hash[i].count)
+			s[n++] = prof.hash[i];
+	if (total)
+		*total = prof.total;
+	if (prof.lock)
+		slock_unlock(prof.lock);
+
+	qsort(s, n, sizeof(s[0]), prof_cmp);
+	*count = n;
+	return s;
+}
+
+int psxProfTop(struct psx_prof_entry *out, int n, unsigned int *total)
+{
+	struct psx_prof_entry *s;
+	unsigned int count;
+
+	s = prof_snapshot(&count, total);
+	if (s == NULL)
+		return -1;
+	if ((unsigned int)n > count)
+		n = count;
+	memcpy(out, s, n * sizeof(out[0]));
+	free(s);
+	return n;
+}
+
+int psxProfWrite(const char *path)
+{
+	uintptr_t hdr[5] = { 0, 3, 0, 0, 0 };
+	uintptr_t rec[3], trailer[3] = { 0, 1, 0 };
+	struct psx_prof_entry *s;
+	unsigned int i, count;
+	FILE *f;
+
+	s = prof_snapshot(&count, NULL);
+	if (s == NULL)
+		return -1;
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		SysPrintf("psxprof: can't open %s\n", path);
+		free(s);
+		return -1;
+	}
+
+	// words are host sized, pprof figures that out from the header
+	hdr[3] = prof.interval_us;
+	fwrite(hdr, sizeof(hdr), 1, f);
+	for (i = 0; i < count; i++) {
+		rec[0] = s[i].count;
+		rec[1] = 1;
+		rec[2] = s[i].pc;
+		fwrite(rec, sizeof(rec), 1, f);
+	}
+	fwrite(trailer, sizeof(trailer), 1, f);
+	fprintf(f, "00000000-00200000 r-xp 00000000 00:00 0 psx_ram\n");
+	fprintf(f, "80000000-80200000 r-xp 00000000 00:00 0 psx_ram\n");
+	fprintf(f, "bfc00000-bfc80000 r-xp 00000000 00:00 0 psx_bios\n");
+	fclose(f);
+	free(s);
+
+	SysPrintf("psxprof: %u pcs written to %s\n", count, path);
+	return 0;
+}
+
+#else // !USE_PSX_PROFILER
+
+int  psxProfStart(int interval_us) { return -1; }
+void psxProfStop(void) {}
+int  psxProfRunning(void) { return 0; }
+int  psxProfTop(struct psx_prof_entry *out, int n, unsigned int *total) { return -1; }
+int  psxProfWrite(const char *path) { return -1; }
+
+#endif
@@ -0,0 +1,38 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ***************************************************************************/
+
+#ifndef __PSXPROF_H__
+#define __PSXPROF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct psx_prof_entry {
+	unsigned int pc;
+	unsigned int count;
+};
+
+// without USE_PSX_PROFILER these fail with -1 (psxProfRunning says 0)
+// interval_us <= 0 picks the default, starting again clears the histogram
+int  psxProfStart(int interval_us);
+void psxProfStop(void);
+int  psxProfRunning(void);
+// fills up to n entries, most hit first, returns how many were filled
+int  psxProfTop(struct psx_prof_entry *out, int n, unsigned int *total);
+// legacy gperftools CPU profile, "pprof --text <elf> <file>" reads it
+int  psxProfWrite(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
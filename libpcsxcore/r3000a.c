@@ -28,6 +28,7 @@
 #include "psxinterpreter.h"
 #include "psxbios.h"
 #include "psxevents.h"
+#include "psxhw.h"
 #include "../include/compiler_features.h"
 #include <assert.h>
 
@@ -37,7 +38,7 @@
 
 R3000Acpu *psxCpu = NULL;
 #ifdef DRC_DISABLE
-psxRegisters psxRegs;
+psxRegisters psxRegs attr_aligned(64);
 #endif
 
 int psxInit() {
@@ -58,13 +59,14 @@ int psxInit() {
 	return psxCpu->Init();
 }
 
-void psxReset() {
-	boolean introBypassed = FALSE;
+// everything psxReset() does before the BIOS gets to run
+void psxResetNoBoot() {
 	boolean oldhle = Config.HLE;
 
 	psxMemReset();
 
 	memset(&psxRegs, 0, sizeof(psxRegs));
+	events_reset();
 
 	psxRegs.pc = 0xbfc00000; // Start in bootstrap
 
@@ -85,6 +87,17 @@ void psxReset() {
 
 	psxHwReset();
 	psxBiosInit();
+}
+
+// HLE never runs BIOS code: psxBiosInit() has set up the kernel tables,
+// psxBiosSetupBootState() the hw/gpu/spu state the shell would leave and
+// the frontend's LoadCdrom() then jumps straight to the game's exe.
+// With a real BIOS only the kernel init runs, BiosBootBypass() skips the
+// shell (logos, region check) unless SlowBoot is set.
+void psxReset() {
+	boolean introBypassed = FALSE;
+
+	psxResetNoBoot();
 
 	if (!Config.HLE) {
 		psxExecuteBios();
@@ -97,9 +110,16 @@ void psxReset() {
 }
 
 void psxShutdown() {
+#ifdef PSXEVENTS_STATS
+	events_print_stats();
+#endif
+#ifdef PSXHW_STATS
+	psxHwPrintStats();
+#endif
 	psxBiosShutdown();
 
 	psxCpu->Shutdown();
+	mdecShutdown();
 
 	psxMemShutdown();
 }
@@ -183,25 +183,13 @@ typedef struct psxCP2Regs {
 typedef struct psxRegisters {
 	// note: some cores like lightrec don't keep their data here,
 	// so use R3000ACPU_NOTIFY_BEFORE_SAVE to sync
+	// what every instruction or block touches, 3 cachelines
 	psxGPRRegs GPR;		/* General Purpose Registers */
-	psxCP0Regs CP0;		/* Coprocessor0 Registers */
-	union {
-		struct {
-			psxCP2Data CP2D; 	/* Cop2 data registers */
-			psxCP2Ctrl CP2C; 	/* Cop2 control registers */
-		};
-		psxCP2Regs CP2;
-	};
 	u32 pc;				/* Program counter */
 	u32 code;			/* The instruction */
 	u32 cycle;
 	u32 interrupt;
-	struct { u32 sCycle, cycle; } intCycle[20];
-	u32 event_cycles[20];
-	u32 psxNextCounter;
-	u32 psxNextsCounter;
 	u32 next_interupt;  /* cycle */
-	u32 unused;
 	u32 gteBusyCycle;
 	u32 muldivBusyCycle;
 	u32 subCycle;       /* interpreter cycle counting */
@@ -214,12 +202,28 @@ typedef struct psxRegisters {
 	u8  dloadReg[2];
 	u8  unused2[2];
 	u32 dloadVal[2];
+	// cacheline aligned from here, see LO_psxRegs
+	psxCP0Regs CP0;		/* Coprocessor0 Registers */
+	// event scheduler and rarely used state
+	struct { u32 sCycle, cycle; } intCycle[20];
+	u32 event_cycles[20];
+	u32 psxNextCounter;
+	u32 psxNextsCounter;
 	u32 biosBranchCheck;
 	u32 cpuInRecursion;
 	u32 gpuIdleAfter;
-	u32 unused3[2];
+	u32 unused3[15];
+	// gte, only touched by cop2 ops
+	union {
+		struct {
+			psxCP2Data CP2D; 	/* Cop2 data registers */
+			psxCP2Ctrl CP2C; 	/* Cop2 control registers */
+		};
+		psxCP2Regs CP2;
+	};
 	// warning: changing anything in psxRegisters requires update of all
-	// asm in libpcsxcore/new_dynarec/ and may break savestates
+	// asm in libpcsxcore/new_dynarec/, savestates use the older order
+	// kept by psxRegsFreeze() in misc.c
 } psxRegisters;
 
 extern psxRegisters psxRegs;
@@ -227,9 +231,12 @@ extern psxRegisters psxRegs;
 /* new_dynarec stuff */
 void ndrc_freeze(void *f, int mode);
 void ndrc_clear_full(void);
+void ndrc_cache_save(const char *fname);
+void ndrc_cache_load(const char *fname);
 
 int  psxInit();
 void psxReset();
+void psxResetNoBoot();
 void psxShutdown();
 void psxException(u32 code, enum R3000Abdt bdt, psxCP0Regs *cp0);
 void psxBranchTest();
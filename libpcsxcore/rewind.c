@@ -0,0 +1,255 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ***************************************************************************/
+
+/*
+ * Rewind history. Full savestates are taken into memory, only the newest
+ * one is kept as is, older ones are stored as a packed XOR against their
+ * successor in a ring arena. Stepping back unpacks the newest delta over
+ * the kept state and loads the result.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psxcommon.h"
+#include "misc.h"
+#include "rewind.h"
+
+#define REWIND_STATE_MAX	SAVESTATE_MAX_SIZE
+#define REWIND_MAX_ENTRIES	4096
+// worst case delta_pack() output
+#define PACK_MAX(words)		((words) * 4 + 8)
+#define PAGE_WORDS		(4096 / 4)
+
+struct rw_entry {
+	u32 offs, size;		// packed delta in the arena
+	u32 len;		// length of the state it restores
+};
+
+static struct {
+	u8 *arena;
+	u32 arena_size;
+	u32 head;
+	struct rw_entry ent[REWIND_MAX_ENTRIES];
+	int first, count;
+	// bytes past *_len are always zero
+	u8 *last, *cur;
+	u32 last_len, cur_len;
+	int have_last, at_last;
+	char id[sizeof(CdromId)];
+} rw;
+
+static int rw_state(u8 *buf, u32 *len, int save)
+{
+	int ret;
+
+	if (!save)
+		return LoadStateMem(buf, REWIND_STATE_MAX, 1);
+
+	ret = SaveStateMem(buf, REWIND_STATE_MAX, 1);
+	if (ret < 0)
+		return -1;
+	if ((u32)ret < *len)
+		memset(buf + ret, 0, *len - ret);
+	*len = ret;
+	return 0;
+}
+
+// Tracking writes isn't possible with the dynarecs storing to RAM directly,
+// but most 4K pages of a state don't change between snapshots, and a page
+// memcmp() is much cheaper than walking it a word at a time.
+static u32 skip_equal(const u32 *a, const u32 *b, u32 i, u32 words)
+{
+	while (i < words && (i & (PAGE_WORDS - 1)) && a[i] == b[i])
+		i++;
+	while (!(i & (PAGE_WORDS - 1)) && i + PAGE_WORDS <= words
+	       && memcmp(a + i, b + i, PAGE_WORDS * 4) == 0)
+		i += PAGE_WORDS;
+	while (i < words && a[i] == b[i])
+		i++;
+	return i;
+}
+
+// a ^ b as [zero words][literal words][literals...] records. A literal run
+// is only ended by 4+ zero words, which pay for the next record header,
+// so the output never exceeds PACK_MAX(words).
+static u32 delta_pack(u32 *out, const u32 *a, const u32 *b, u32 words)
+{
+	u32 *o = out;
+	u32 i = 0, z, l, j;
+
+	while (i < words) {
+		z = skip_equal(a, b, i, words);
+		for (l = z; l < words; l = j + 1) {
+			for (j = l; j < words && j - l < 4 && a[j] == b[j]; j++)
+				;
+			if (j - l == 4)
+				break;
+			if (j == words) {
+				l = j;
+				break;
+			}
+		}
+		*o++ = z - i;
+		*o++ = l - z;
+		for (; z < l; z++)
+			*o++ = a[z] ^ b[z];
+		i = l;
+	}
+	return o - out;
+}
+
+static void delta_apply(u32 *dst, const u32 *in, u32 words)
+{
+	const u32 *end = in + words;
+	u32 pos = 0, n;
+
+	while (in < end) {
+		pos += *in++;
+		for (n = *in++; n > 0; n--)
+			dst[pos++] ^= *in++;
+	}
+}
+
+static void drop_oldest(void)
+{
+	rw.first = (rw.first + 1) % REWIND_MAX_ENTRIES;
+	rw.count--;
+}
+
+// make room for 'need' bytes, returns the arena offset
+static u32 rw_alloc(u32 need)
+{
+	u32 start = rw.head;
+
+	if (rw.count == REWIND_MAX_ENTRIES)
+		drop_oldest();
+	if (start + need > rw.arena_size) {
+		// wrap, whatever is past the head is older than what's at 0
+		while (rw.count && rw.ent[rw.first].offs >= rw.head)
+			drop_oldest();
+		start = 0;
+	}
+	while (rw.count && rw.ent[rw.first].offs >= start
+	       && rw.ent[rw.first].offs < start + need)
+		drop_oldest();
+	return start;
+}
+
+void rewind_reset(void)
+{
+	rw.head = rw.first = rw.count = 0;
+	rw.have_last = rw.at_last = 0;
+}
+
+void rewind_free(void)
+{
+	free(rw.arena);
+	free(rw.last);
+	free(rw.cur);
+	rw.arena = rw.last = rw.cur = NULL;
+	rw.arena_size = rw.last_len = rw.cur_len = 0;
+	rewind_reset();
+}
+
+int rewind_init(unsigned int size)
+{
+	// must hold a worst case delta with room to spare
+	if (size && size < 2 * PACK_MAX(REWIND_STATE_MAX / 4))
+		size = 2 * PACK_MAX(REWIND_STATE_MAX / 4);
+	size &= ~3;
+	if (size == rw.arena_size)
+		return 0;
+
+	rewind_free();
+	if (size == 0)
+		return 0;
+
+	rw.arena = malloc(size);
+	rw.last = calloc(1, REWIND_STATE_MAX);
+	rw.cur = calloc(1, REWIND_STATE_MAX);
+	if (rw.arena == NULL || rw.last == NULL || rw.cur == NULL) {
+		SysPrintf("rewind: OOM for %u bytes\n", size);
+		rewind_free();
+		return -1;
+	}
+	rw.arena_size = size;
+	return 0;
+}
+
+int rewind_capture(void)
+{
+	struct rw_entry *e;
+	u32 words, u;
+	u8 *p;
+
+	if (rw.arena == NULL)
+		return -1;
+	if (memcmp(rw.id, CdromId, sizeof(rw.id)) != 0) {
+		// another game, the history is of no use
+		rewind_reset();
+		memcpy(rw.id, CdromId, sizeof(rw.id));
+	}
+
+	if (rw_state(rw.cur, &rw.cur_len, 1) != 0)
+		return -1;
+
+	if (rw.have_last) {
+		u = rw.last_len > rw.cur_len ? rw.last_len : rw.cur_len;
+		words = (u + 3) / 4;
+		u = rw_alloc(PACK_MAX(words));
+		e = &rw.ent[(rw.first + rw.count) % REWIND_MAX_ENTRIES];
+		e->offs = u;
+		e->size = delta_pack((u32 *)(rw.arena + e->offs),
+			(u32 *)rw.last, (u32 *)rw.cur, words) * 4;
+		e->len = rw.last_len;
+		rw.head = e->offs + e->size;
+		rw.count++;
+	}
+
+	p = rw.last; rw.last = rw.cur; rw.cur = p;
+	u = rw.last_len; rw.last_len = rw.cur_len; rw.cur_len = u;
+	rw.have_last = 1;
+	rw.at_last = 0;
+	return 0;
+}
+
+int rewind_step(void)
+{
+	struct rw_entry *e;
+
+	if (!rw.have_last)
+		return -1;
+
+	if (rw.at_last) {
+		if (rw.count == 0)
+			return -1;
+		e = &rw.ent[(rw.first + rw.count - 1) % REWIND_MAX_ENTRIES];
+		delta_apply((u32 *)rw.last, (u32 *)(rw.arena + e->offs),
+			e->size / 4);
+		rw.last_len = e->len;
+		rw.head = e->offs;
+		rw.count--;
+	}
+
+	if (rw_state(rw.last, &rw.last_len, 0) != 0) {
+		rewind_reset();
+		return -1;
+	}
+	rw.at_last = 1;
+	return 0;
+}
+
+int rewind_count(void)
+{
+	return rw.count;
+}
@@ -0,0 +1,31 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ***************************************************************************/
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// size 0 frees the history
+int  rewind_init(unsigned int size);
+void rewind_free(void);
+void rewind_reset(void);
+int  rewind_capture(void);
+int  rewind_step(void);
+int  rewind_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -340,6 +340,7 @@ void LoadMcd(int mcd, char *str) {
 	if (mcd != 1 && mcd != 2)
 		return;
 
+	FlushMcds();
 	if (mcd == 1) {
 		data = Mcd1Data;
 		cardh1[1] |= 8; // mark as new
@@ -412,12 +413,9 @@ void LoadMcds(char *mcd1, char *mcd2) {
 	LoadMcd(2, mcd2);
 }
 
-void SaveMcd(char *mcd, char *data, uint32_t adr, int size) {
+static void SaveMcdFile(const char *mcd, char *data, uint32_t adr, int size) {
 	FILE *f;
 
-	if (mcd == NULL || *mcd == 0 || strcmp(mcd, "none") == 0)
-		return;
-
 	f = fopen(mcd, "r+b");
 	if (f != NULL) {
 		struct stat buf;
@@ -446,7 +444,190 @@ void SaveMcd(char *mcd, char *data, uint32_t adr, int size) {
 	}
 #endif
 
-	ConvertMcd(mcd, data);
+	ConvertMcd((char *)mcd, data);
+}
+
+#ifdef USE_ASYNC_MCD
+#include <time.h>
+#include "../frontend/pcsxr-threads.h"
+#include "../include/thread_wakeups.h"
+
+// Games write the card in long bursts of 128 byte frames, so writes only
+// mark 8K blocks dirty and a thread writes them out (runs of dirty blocks
+// at once) after the card has been left alone for a while.
+#define MCD_BLOCK_SIZE		(1024 * 8)
+#define MCD_BLOCKS			(MCD_SIZE / MCD_BLOCK_SIZE)
+#define MCD_QUIET_US		500000
+#define MCD_MAX_DELAY_S		3
+
+static struct {
+	sthread_t *thread;
+	slock_t *lock;		// dirty state
+	slock_t *io_lock;	// file writes and buf
+	scond_t *cond;
+	int exit, failed;
+	struct {
+		char path[MAXPATHLEN];
+		u32 dirty;
+		time_t since;
+	} card[2];
+	char buf[MCD_SIZE];
+} mcd_wb;
+
+// needs io_lock
+static void mcd_wb_flush(int i) {
+	char *data = i ? Mcd2Data : Mcd1Data;
+	char path[MAXPATHLEN];
+	u32 dirty;
+	int b, e;
+
+	slock_lock(mcd_wb.lock);
+	dirty = mcd_wb.card[i].dirty;
+	mcd_wb.card[i].dirty = 0;
+	strcpy(path, mcd_wb.card[i].path);
+	for (b = 0; b < MCD_BLOCKS; b++)
+		if (dirty & (1u << b))
+			memcpy(mcd_wb.buf + b * MCD_BLOCK_SIZE,
+				data + b * MCD_BLOCK_SIZE, MCD_BLOCK_SIZE);
+	slock_unlock(mcd_wb.lock);
+
+	for (b = 0; b < MCD_BLOCKS; b = e) {
+		e = b + 1;
+		if (!(dirty & (1u << b)))
+			continue;
+		while (e < MCD_BLOCKS && (dirty & (1u << e)))
+			e++;
+		SaveMcdFile(path, mcd_wb.buf, b * MCD_BLOCK_SIZE,
+			(e - b) * MCD_BLOCK_SIZE);
+	}
+}
+
+static STRHEAD_RET_TYPE mcd_wb_thread(void *unused) {
+	time_t since;
+	int i, pending;
+
+	slock_lock(mcd_wb.lock);
+	while (!mcd_wb.exit) {
+		pending = 0;
+		since = time(NULL);
+		for (i = 0; i < 2; i++) {
+			if (!mcd_wb.card[i].dirty)
+				continue;
+			pending = 1;
+			if (mcd_wb.card[i].since < since)
+				since = mcd_wb.card[i].since;
+		}
+		if (!pending) {
+			scond_wait(mcd_wb.cond, mcd_wb.lock);
+			twake_count(TWAKE_MCD);
+			continue;
+		}
+		// a write restarts the wait, unless it's been going on for too long
+		if (scond_wait_timeout(mcd_wb.cond, mcd_wb.lock, MCD_QUIET_US)
+		    && time(NULL) - since < MCD_MAX_DELAY_S)
+			continue;
+		if (mcd_wb.exit)
+			break;
+
+		slock_unlock(mcd_wb.lock);
+		slock_lock(mcd_wb.io_lock);
+		mcd_wb_flush(0);
+		mcd_wb_flush(1);
+		slock_unlock(mcd_wb.io_lock);
+		slock_lock(mcd_wb.lock);
+	}
+	slock_unlock(mcd_wb.lock);
+	STRHEAD_RETURN();
+}
+
+static void mcd_wb_free(void) {
+	if (mcd_wb.cond) { scond_free(mcd_wb.cond); mcd_wb.cond = NULL; }
+	if (mcd_wb.io_lock) { slock_free(mcd_wb.io_lock); mcd_wb.io_lock = NULL; }
+	if (mcd_wb.lock) { slock_free(mcd_wb.lock); mcd_wb.lock = NULL; }
+}
+
+static int mcd_wb_start(void) {
+	if (mcd_wb.failed)
+		return -1;
+	mcd_wb.exit = 0;
+	mcd_wb.lock = slock_new();
+	mcd_wb.io_lock = slock_new();
+	mcd_wb.cond = scond_new();
+	if (mcd_wb.lock && mcd_wb.io_lock && mcd_wb.cond)
+		mcd_wb.thread = pcsxr_sthread_create(mcd_wb_thread, PCSXRT_MCD);
+	if (mcd_wb.thread == NULL) {
+		SysPrintf("memcard write-back thread init failed.\n");
+		mcd_wb_free();
+		mcd_wb.failed = 1;
+		return -1;
+	}
+	return 0;
+}
+
+static int mcd_wb_queue(const char *mcd, char *data, uint32_t adr, int size) {
+	int i = data == Mcd1Data ? 0 : (data == Mcd2Data ? 1 : -1);
+	u32 mask;
+
+	if (i < 0 || size <= 0 || adr + size > MCD_SIZE
+	    || strlen(mcd) >= sizeof(mcd_wb.card[0].path))
+		return -1;
+	if (mcd_wb.thread == NULL && mcd_wb_start())
+		return -1;
+
+	mask = (2u << ((adr + size - 1) / MCD_BLOCK_SIZE)) - (1u << (adr / MCD_BLOCK_SIZE));
+	slock_lock(mcd_wb.lock);
+	if (mcd_wb.card[i].dirty && strcmp(mcd_wb.card[i].path, mcd)) {
+		// the card file was changed with writes still pending
+		slock_unlock(mcd_wb.lock);
+		FlushMcds();
+		slock_lock(mcd_wb.lock);
+	}
+	if (!mcd_wb.card[i].dirty) {
+		strcpy(mcd_wb.card[i].path, mcd);
+		mcd_wb.card[i].since = time(NULL);
+	}
+	mcd_wb.card[i].dirty |= mask;
+	scond_signal(mcd_wb.cond);
+	slock_unlock(mcd_wb.lock);
+	return 0;
+}
+
+// writes out everything still pending, before a savestate or shutdown
+void FlushMcds(void) {
+	if (mcd_wb.io_lock == NULL)
+		return;
+	slock_lock(mcd_wb.io_lock);
+	mcd_wb_flush(0);
+	mcd_wb_flush(1);
+	slock_unlock(mcd_wb.io_lock);
+}
+
+void ShutdownMcds(void) {
+	if (mcd_wb.thread) {
+		slock_lock(mcd_wb.lock);
+		mcd_wb.exit = 1;
+		scond_signal(mcd_wb.cond);
+		slock_unlock(mcd_wb.lock);
+		sthread_join(mcd_wb.thread);
+		mcd_wb.thread = NULL;
+	}
+	FlushMcds();
+	mcd_wb_free();
+}
+#else
+void FlushMcds(void) {}
+void ShutdownMcds(void) {}
+#endif
+
+void SaveMcd(char *mcd, char *data, uint32_t adr, int size) {
+	if (mcd == NULL || *mcd == 0 || strcmp(mcd, "none") == 0)
+		return;
+
+#ifdef USE_ASYNC_MCD
+	if (mcd_wb_queue(mcd, data, adr, size) == 0)
+		return;
+#endif
+	SaveMcdFile(mcd, data, adr, size);
 }
 
 void CreateMcd(char *mcd) {
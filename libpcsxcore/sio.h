@@ -54,6 +54,8 @@ int sioFreeze(void *f, int Mode);
 void LoadMcd(int mcd, char *str);
 void LoadMcds(char *mcd1, char *mcd2);
 void SaveMcd(char *mcd, char *data, uint32_t adr, int size);
+void FlushMcds(void);
+void ShutdownMcds(void);
 void CreateMcd(char *mcd);
 void ConvertMcd(char *mcd, char *data);
 
@@ -29,12 +29,17 @@ void WriteSocket(char * buffer, int len) {}
 void SetsBlock() {}
 void SetsNonblock() {}
 
+int StartMetricsServer(int port) { return -1; }
+void StopMetricsServer() {}
+int ServeMetrics(int timeout_ms, int (*fill)(char *buf, int size)) { return 0; }
+
 #else // NO_SOCKET
 
 #ifdef _WIN32
 #include <winsock2.h>
 #endif
 
+#include <stdio.h>
 #include "psxcommon.h"
 #include "socket.h"
 
@@ -45,6 +50,7 @@ void SetsNonblock() {}
 #include <netinet/in.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/select.h>
 #endif
 
 static int server_socket = 0;
@@ -268,4 +274,114 @@ void SetsNonblock() {
     fcntl(server_socket, F_SETFL, flags | O_NONBLOCK);
 #endif
 }
+
+static int metrics_socket = -1;
+
+static void close_socket(int s) {
+#ifdef _WIN32
+    shutdown(s, SD_BOTH);
+    closesocket(s);
+#else
+    shutdown(s, SHUT_RDWR);
+    close(s);
+#endif
+}
+
+static int wait_readable(int s, int timeout_ms) {
+    struct timeval tv;
+    fd_set fds;
+
+    FD_ZERO(&fds);
+    FD_SET(s, &fds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = timeout_ms % 1000 * 1000;
+    return select(s + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+int StartMetricsServer(int port) {
+    struct sockaddr_in addr;
+    int one = 1;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+
+    if (WSAStartup(MAKEWORD(2, 0), &wsaData) != 0)
+        return -1;
+#endif
+    metrics_socket = socket(AF_INET, SOCK_STREAM, 0);
+#ifdef _WIN32
+    if (metrics_socket == INVALID_SOCKET) {
+        metrics_socket = -1;
+        return -1;
+    }
+#else
+    if (metrics_socket == -1)
+        return -1;
+#endif
+    setsockopt(metrics_socket, SOL_SOCKET, SO_REUSEADDR, (void *)&one, sizeof(one));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(metrics_socket, (struct sockaddr *) &addr, sizeof(addr)) < 0
+        || listen(metrics_socket, 4) != 0) {
+        close_socket(metrics_socket);
+        metrics_socket = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void StopMetricsServer() {
+    if (metrics_socket == -1)
+        return;
+    close_socket(metrics_socket);
+    metrics_socket = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int ServeMetrics(int timeout_ms, int (*fill)(char *buf, int size)) {
+    static char body[32768];
+    char head[256];
+    int c, r, got = 0, len, tries;
+
+    if (metrics_socket == -1 || !wait_readable(metrics_socket, timeout_ms))
+        return 0;
+    c = accept(metrics_socket, 0, 0);
+#ifdef _WIN32
+    if (c == INVALID_SOCKET)
+        return 0;
+#else
+    if (c == -1)
+        return 0;
+#endif
+
+    // whatever path is asked for, just consume the request head
+    for (tries = 0; tries < 10 && got < (int)sizeof(head) - 1; tries++) {
+        if (!wait_readable(c, 100))
+            break;
+        r = recv(c, head + got, sizeof(head) - 1 - got, 0);
+        if (r <= 0)
+            break;
+        got += r;
+        head[got] = 0;
+        if (strstr(head, "\r\n\r\n"))
+            break;
+    }
+
+    len = fill(body, sizeof(body));
+    r = snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %d\r\nConnection: close\r\n\r\n", len);
+    send(c, head, r, 0);
+    send(c, body, len, 0);
+    close_socket(c);
+
+    return 1;
+}
 #endif // NO_SOCKET
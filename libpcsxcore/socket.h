@@ -37,6 +37,13 @@ void WriteSocket(char * buffer, int len);
 void SetsBlock();
 void SetsNonblock();
 
+// plain http text endpoint (prometheus format) on its own port, separate
+// from the debugger connection. ServeMetrics() waits up to timeout_ms for
+// a scrape and answers it with what fill() puts in buf, ret 1 if it did
+int StartMetricsServer(int port);
+void StopMetricsServer();
+int ServeMetrics(int timeout_ms, int (*fill)(char *buf, int size));
+
 #ifdef __cplusplus
 }
 #endif
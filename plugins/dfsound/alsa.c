@@ -15,30 +15,153 @@
  *                                                                         *
  ***************************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // pthread_setname_np
+#endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #define ALSA_PCM_NEW_HW_PARAMS_API
 #define ALSA_PCM_NEW_SW_PARAMS_API
 #include <alsa/asoundlib.h>
 #include "out.h"
 
+// ALSA_PERIOD (frames) and ALSA_PERIODS size the device buffer, which is
+// most of the latency. With ALSA_THREAD=1 a thread (realtime if allowed)
+// keeps the device topped up from the ring, so a few short periods do and
+// ~25ms total is possible; otherwise the device is only written when the
+// spu feeds once a frame and has to hold well over a frame itself.
+#define PERIOD_DEF		1024
+#define PERIODS_DEF		4
+#define PERIOD_DEF_THREAD	256
+#define PERIODS_DEF_THREAD	3
+
+#define RING_LEN		(8192 * 2)	// shorts
+#define BARRIER()		__sync_synchronize()
+
 static snd_pcm_t *handle = NULL;
-static snd_pcm_uframes_t buffer_size;
+static snd_pcm_uframes_t buffer_size, period_size;
+static snd_pcm_sframes_t (*pcm_write)(snd_pcm_t *pcm, const void *buf,
+	snd_pcm_uframes_t frames);
+
+// single producer (alsa_feed) / single consumer (ring_drain) ring,
+// each side only ever writes its own position
+static short ring[RING_LEN];
+static volatile int ring_r, ring_w;
+static volatile int hw_queued;		// frames, as last seen by ring_drain
+static struct out_resampler rs;
+static int target_fill;			// frames queued before a feed
+
+static struct {
+ pthread_t tid;
+ int running;
+ volatile int exit;
+} th;
 
 static void alsa_finish(void);
 
+static int env_int(const char *name, int def)
+{
+ const char *v = getenv(name);
+ return v != NULL && atoi(v) > 0 ? atoi(v) : def;
+}
+
+static int ring_used(void)
+{
+ int n = ring_w - ring_r;
+ if (n < 0) n += RING_LEN;
+ return n;
+}
+
+// moves what fits from the ring to the device, only ever called by one
+// thread at a time (the feeding one or the output thread)
+static int ring_drain(void)
+{
+ snd_pcm_sframes_t avail, ret;
+ int r = ring_r, n, l, done = 0;
+
+ avail = snd_pcm_avail_update(handle);
+ if (avail < 0) {
+  // xrun or suspend, start over with what's in the ring
+  snd_pcm_recover(handle, avail, 1);
+  avail = snd_pcm_avail_update(handle);
+  if (avail < 0)
+   return -1;
+ }
+
+ BARRIER(); // data written before ring_w was
+ n = ring_used() / 2;
+ if (n > avail) n = avail;
+ while (n > 0) {
+  l = (RING_LEN - r) / 2;
+  if (l > n) l = n;
+  ret = pcm_write(handle, ring + r, l);
+  if (ret < 0) {
+   snd_pcm_recover(handle, ret, 1);
+   break;
+  }
+  r += ret * 2;
+  if (r >= RING_LEN) r = 0;
+  n -= ret;
+  done += ret;
+  if (ret < l)
+   break;
+ }
+ BARRIER(); // done reading before the space is handed back
+ ring_r = r;
+ avail -= done;
+ hw_queued = avail < buffer_size ? buffer_size - avail : 0;
+ return done;
+}
+
+static void *alsa_thread(void *unused)
+{
+ static const short silence[512 * 2];
+ struct sched_param param = { 0, };
+ int period_us = period_size * 1000000 / out_rate;
+
+ param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 2;
+ if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+  printf("alsa: no realtime priority for the output thread\n");
+#ifdef __GLIBC__
+ pthread_setname_np(pthread_self(), "pcsx-alsa");
+#endif
+
+ while (!th.exit) {
+  if (ring_drain() < 0) {
+   usleep(period_us);
+   continue;
+  }
+  // the spu came late, a period of silence is better than an xrun
+  if (hw_queued < period_size && ring_used() == 0) {
+   int n = period_size < 512 ? period_size : 512;
+   if (pcm_write(handle, silence, n) < 0)
+    snd_pcm_prepare(handle);
+   continue;
+  }
+  if (ring_used() == 0)
+   usleep(period_us / 2);
+  else
+   snd_pcm_wait(handle, period_us / 1000 + 1);
+ }
+ return NULL;
+}
+
 // SETUP SOUND
 static int alsa_init(void)
 {
  snd_pcm_hw_params_t *hwparams;
- snd_pcm_status_t *status;
+ snd_pcm_sw_params_t *swparams;
  snd_ctl_t *ctl_handle = NULL;
  snd_ctl_card_info_t *info;
- unsigned int pspeed;
+ snd_pcm_uframes_t period;
+ unsigned int pspeed, periods;
  int pchannels;
  int format;
- unsigned int buffer_time = 100000;
- unsigned int period_time = buffer_time / 4;
+ int use_thread;
  const char *alsa_name = "default";
  const char *name;
  int retval = -1;
@@ -47,6 +170,9 @@ static int alsa_init(void)
  name = getenv("ALSA_NAME");
  if (name != NULL)
   alsa_name = name;
+ use_thread = env_int("ALSA_THREAD", 0);
+ period = env_int("ALSA_PERIOD", use_thread ? PERIOD_DEF_THREAD : PERIOD_DEF);
+ periods = env_int("ALSA_PERIODS", use_thread ? PERIODS_DEF_THREAD : PERIODS_DEF);
 
  snd_ctl_card_info_alloca(&info);
  if ((err = snd_ctl_open(&ctl_handle, alsa_name, 0)) < 0) {
@@ -73,7 +199,7 @@ static int alsa_init(void)
 
  pchannels=2;
 
- pspeed = 44100;
+ pspeed = out_rate;
  format = SND_PCM_FORMAT_S16;
 
  if ((err = snd_pcm_open(&handle, alsa_name, 
@@ -97,7 +223,14 @@ static int alsa_init(void)
    goto out;
   }
 
- if((err=snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED))<0)
+ // mmap saves the copy into the kernel's buffer, not every device has it
+ pcm_write = snd_pcm_mmap_writei;
+ if((err=snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_MMAP_INTERLEAVED))<0)
+  {
+   pcm_write = snd_pcm_writei;
+   err = snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED);
+  }
+ if(err<0)
   {
    printf("Access type not available: %s\n", snd_strerror(err));
    goto out;
@@ -120,16 +253,17 @@ static int alsa_init(void)
    printf("Rate not available: %s\n", snd_strerror(err));
    goto out;
   }
+ out_rate = pspeed;
 
- if((err=snd_pcm_hw_params_set_buffer_time_near(handle, hwparams, &buffer_time, 0))<0)
+ if((err=snd_pcm_hw_params_set_period_size_near(handle, hwparams, &period, 0))<0)
   {
-   printf("Buffer time error: %s\n", snd_strerror(err));
+   printf("Period size error: %s\n", snd_strerror(err));
    goto out;
   }
 
- if((err=snd_pcm_hw_params_set_period_time_near(handle, hwparams, &period_time, 0))<0)
+ if((err=snd_pcm_hw_params_set_periods_near(handle, hwparams, &periods, 0))<0)
   {
-   printf("Period time error: %s\n", snd_strerror(err));
+   printf("Period count error: %s\n", snd_strerror(err));
    goto out;
   }
 
@@ -138,15 +272,33 @@ static int alsa_init(void)
    printf("Unable to install hw params: %s\n", snd_strerror(err));
    goto out;
   }
-
- snd_pcm_status_alloca(&status);
- if((err=snd_pcm_status(handle, status))<0)
+ snd_pcm_hw_params_get_buffer_size(hwparams, &buffer_size);
+ snd_pcm_hw_params_get_period_size(hwparams, &period_size, 0);
+
+ // start once half the buffer is there, wake up per period
+ snd_pcm_sw_params_alloca(&swparams);
+ if((err=snd_pcm_sw_params_current(handle, swparams))<0
+    || (err=snd_pcm_sw_params_set_start_threshold(handle, swparams, buffer_size / 2))<0
+    || (err=snd_pcm_sw_params_set_avail_min(handle, swparams, period_size))<0
+    || (err=snd_pcm_sw_params(handle, swparams))<0)
   {
-   printf("Unable to get status: %s\n", snd_strerror(err));
+   printf("Unable to install sw params: %s\n", snd_strerror(err));
    goto out;
   }
 
- buffer_size = snd_pcm_status_get_avail(status);
+ ring_r = ring_w = 0;
+ hw_queued = 0;
+ memset(&rs, 0, sizeof(rs));
+ // the thread keeps the device full, a period in the ring covers its
+ // wakeup; fed once a frame the device drains by a frame in between
+ target_fill = use_thread ? buffer_size + period_size : buffer_size / 2;
+
+ th.running = th.exit = 0;
+ if (use_thread && pthread_create(&th.tid, NULL, alsa_thread, NULL) == 0)
+  th.running = 1;
+ printf("alsa: %u x %lu frames, %s%s, %d ms\n", periods,
+  (unsigned long)period_size, pcm_write == snd_pcm_mmap_writei ? "mmap" : "rw",
+  th.running ? ", thread" : "", (int)(target_fill * 1000 / out_rate));
  retval = 0;
 
 out:
@@ -158,6 +310,12 @@ out:
 // REMOVE SOUND
 static void alsa_finish(void)
 {
+ if (th.running)
+  {
+   th.exit = 1;
+   pthread_join(th.tid, NULL);
+   th.running = 0;
+  }
  if(handle != NULL)
   {
    snd_pcm_drop(handle);
@@ -167,49 +325,42 @@ static void alsa_finish(void)
 }
 
 // GET BYTES BUFFERED
-static int alsa_busy(void)
+static int alsa_fill(void)
 {
- int l;
+ return ring_used() * 2 + hw_queued * 4;
+}
 
+static int alsa_busy(void)
+{
  if (handle == NULL)                                 // failed to open?
   return 1;
- l = snd_pcm_avail(handle);
- if (l < 0) return 0;
- if (l < buffer_size / 2)                            // can we write in at least the half of fragments?
-      l = 1;                                         // -> no? wait
- else l = 0;                                         // -> else go on
-
- return l;
+ return alsa_fill() / 4 >= target_fill;
 }
 
 // FEED SOUND DATA
 static void alsa_feed(void *pSound, int lBytes)
 {
- char sbuf[4096];
+ int frames = lBytes / 4;
+ int used, space, w;
 
- if (handle == NULL) return;
+ if (handle == NULL || frames <= 0) return;
 
- if (snd_pcm_state(handle) == SND_PCM_STATE_XRUN)
-  {
-   memset(sbuf, 0, sizeof(sbuf));
-   snd_pcm_prepare(handle);
-   snd_pcm_writei(handle, sbuf, sizeof(sbuf) / 4);
-   snd_pcm_writei(handle, sbuf, sizeof(sbuf) / 4);
-   snd_pcm_writei(handle, sbuf, sizeof(sbuf) / 4);
-  }
- else
-  {
-   int l = snd_pcm_avail(handle);
-   if (l < lBytes / 4)
-    {
-     if (l == 0)
-      return;
+ // the queue the rate control holds around target_fill, the device part
+ // is as old as the last drain but that's per period at worst
+ used = ring_used() / 2 + hw_queued;
+ if (used > target_fill * 4)                          // after a stall
+  return;
 
-     lBytes = l * 4;
-    }
-  }
+ // keep one frame free so that full != empty
+ space = (RING_LEN - ring_used()) / 2 - 1;
+ w = out_resample(&rs, ring, RING_LEN, ring_w, space, pSound, frames,
+  out_rate_step(used, target_fill));
+
+ BARRIER(); // samples must be visible before the new position
+ ring_w = w;
 
- snd_pcm_writei(handle, pSound, lBytes / 4);
+ if (!th.running)
+  ring_drain();
 }
 
 void out_register_alsa(struct out_driver *drv)
@@ -219,4 +370,5 @@ void out_register_alsa(struct out_driver *drv)
 	drv->finish = alsa_finish;
 	drv->busy = alsa_busy;
 	drv->feed = alsa_feed;
+	drv->fill = alsa_fill;
 }
@@ -21,6 +21,7 @@
 
 #include "externals.h"
 #include "registers.h"
+#include "spu_trace.h"
 
 static void set_dma_end(int iSize, unsigned int cycles)
 {
@@ -41,6 +42,7 @@ void CALLBACK SPUreadDMAMem(unsigned short *pusPSXMem, int iSize,
  unsigned int addr = spu.spuAddr, irq_addr = regAreaGet(H_SPUirqAddr) << 3;
  int i, irq_after;
 
+ spu_trace(SPUT_DMA_R, 0, cycles, iSize, NULL, 0);
  do_samples_if_needed(cycles, 1, 2);
  irq_after = (irq_addr - addr) & 0x7ffff;
 
@@ -68,6 +70,7 @@ void CALLBACK SPUwriteDMAMem(unsigned short *pusPSXMem, int iSize,
  unsigned int addr = spu.spuAddr, irq_addr = regAreaGet(H_SPUirqAddr) << 3;
  int i, irq_after;
  
+ spu_trace(SPUT_DMA_W, 0, cycles, 0, pusPSXMem, iSize * 2);
  do_samples_if_needed(cycles + iSize*2 * 4, 1, 2);
  irq_after = (irq_addr - addr) & 0x7ffff;
  spu.bMemDirty = 1;
@@ -86,6 +89,10 @@ void CALLBACK SPUwriteDMAMem(unsigned short *pusPSXMem, int iSize,
    addr &= 0x7fffe;
   }
  }
+ if (spu.spuAddr < addr)
+  spu_irq_scan_invalidate(spu.spuAddr, addr);
+ else
+  spu_irq_scan_invalidate(0, 0x80000);
  if ((spu.spuCtrl & CTRL_IRQ) && irq_after < iSize * 2) {
   log_unhandled("%u wdma spu irq: %x/%x-%x (%u)\n",
     cycles, irq_addr, spu.spuAddr, addr, irq_after);
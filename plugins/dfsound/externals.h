@@ -95,35 +95,58 @@ typedef struct
               
 struct xa_decode;
 
+// [from, to) has no stop/loop block, 'to' is one if 'end' is set
+typedef struct
+{
+ unsigned char *   from;
+ unsigned char *   to;
+ int               end;
+} IRQSCAN;
+
 ///////////////////////////////////////////////////////////
 
 // MAIN CHANNEL STRUCT
+// what the mixer touches per sample comes first and fits a 64 byte
+// line, the rest is only looked at per block or on register writes.
+// Voices are allocated line aligned, see SPUinit()
 typedef struct
 {
- int               iSBPos;                             // mixing stuff
- int               spos;
- int               sinc;
- int               sinc_inv;
-
- unsigned char *   pCurr;                              // current pos in sound mem
- unsigned char *   pLoop;                              // loop ptr in sound mem
-
- unsigned int      bReverb:1;                          // can we do reverb on this channel? must have ctrl register bit, to get active
- unsigned int      bRVBActive:1;                       // reverb active flag
- unsigned int      bNoise:1;                           // noise active flag
- unsigned int      bFMod:2;                            // freq mod (0=off, 1=sound channel, 2=freq channel)
- unsigned int      prevflags:3;                        // flags from previous block
- unsigned int      bIgnoreLoop:1;                      // Ignore loop
- unsigned int      bStarting:1;                        // starting after keyon
  union {
   struct {
-   int             iLeftVolume;                        // left volume
-   int             iRightVolume;                       // right volume
+   int               iSBPos;                           // mixing stuff
+   int               spos;
+   int               sinc;
+   int               sinc_inv;
+
+   unsigned char *   pCurr;                            // current pos in sound mem
+   unsigned char *   pLoop;                            // loop ptr in sound mem
+
+   unsigned int      bReverb:1;                        // can we do reverb on this channel? must have ctrl register bit, to get active
+   unsigned int      bRVBActive:1;                     // reverb active flag
+   unsigned int      bNoise:1;                         // noise active flag
+   unsigned int      bFMod:2;                          // freq mod (0=off, 1=sound channel, 2=freq channel)
+   unsigned int      prevflags:3;                      // flags from previous block
+   unsigned int      bIgnoreLoop:1;                    // Ignore loop
+   unsigned int      bStarting:1;                      // starting after keyon
+   union {
+    struct {
+     int             iLeftVolume;                      // left volume
+     int             iRightVolume;                     // right volume
+    };
+    int              iVolume[2];
+   };
+   ADSRInfoEx        ADSRX;
+   int               iRawPitch;                        // raw pitch (0...3fff)
+  };
+  unsigned int _pad0[64/4];
+ };
+ union {
+  struct {
+   unsigned int      silent_ns;                        // samples not yet skipped while silent
+   IRQSCAN           irq_scan[2];                      // block runs seen by the irq prediction
   };
-  int              iVolume[2];
+  unsigned int _pad1[64/4];
  };
- ADSRInfoEx        ADSRX;
- int               iRawPitch;                          // raw pitch (0...3fff)
 } SPUCHAN;
 
 ///////////////////////////////////////////////////////////
@@ -241,6 +264,7 @@ typedef struct
  short         * pS;
 
  SPUCHAN       * s_chan;
+ void          * s_chan_mem;                           // s_chan before alignment
  REVERBInfo    * rvb;
 
  int           * SSumLR;
@@ -288,8 +312,10 @@ extern SPUInfo spu;
 
 void do_samples(unsigned int cycles_to, int force_no_thread);
 void schedule_next_irq(void);
+void spu_irq_scan_invalidate(unsigned int start, unsigned int end);
 void check_irq_io(unsigned int addr);
 void do_irq_io(int cycles_after);
+void sync_silent_chan(int ch);
 
 #define do_samples_if_needed(c, no_thread, samples) \
  do { \
@@ -24,6 +24,7 @@
 #include "externals.h"
 #include "registers.h"
 #include "spu.h"
+#include "spu_trace.h"
 #include "psemu_plugin_defs.h"
 
 ////////////////////////////////////////////////////////////////////////
@@ -329,7 +330,10 @@ long DoFreeze(unsigned int ulFreezeMode, SPUFreeze_t * pF,
                                                        
  if(ulFreezeMode!=0) return 0;                         // bad mode? bye
 
+ spu_trace(SPUT_LOAD, 0, cycles, 0, pF, sizeof(SPUFreeze_t)+sizeof(SPUOSSFreeze_t));
+
  memcpy(spu.spuMem, pF->SPURam, 0x80000);              // get ram
+ spu_irq_scan_invalidate(0, 0x80000);
  memcpy(spu.regArea, pF->SPUPorts, 0x200);
  spu.bMemDirty = 1;
  spu.spuCtrl = regAreaGet(H_SPUctrl);
@@ -46,7 +46,7 @@ extern int errno;
 
 static int oss_init(void)
 {
- int pspeed=44100;
+ int pspeed=out_rate;
  int pstereo;
  int format;
  int myfrag;
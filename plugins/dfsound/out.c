@@ -1,11 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "out.h"
+#include "spu_config.h"
 
 #define MAX_OUT_DRIVERS 5
 
+// max rate adjustment, in 1/65536 (~0.4%), inaudible as a pitch change
+#define RATE_ADJ_MAX	256
+
 static struct out_driver out_drivers[MAX_OUT_DRIVERS];
 struct out_driver *out_current;
+int out_rate = 44100;
 static int driver_count;
 
 #define REGISTER_DRIVER(d) { \
@@ -37,9 +43,13 @@ void SetupSound(void)
 #endif
 	}
 
-	for (i = 0; i < driver_count; i++)
+	for (i = 0; i < driver_count; i++) {
+		if (spu_config.iNoOutput && strcmp(out_drivers[i].name, "none"))
+			continue;
+		out_rate = spu_config.iOutRate > 0 ? spu_config.iOutRate : 44100;
 		if (out_drivers[i].init() == 0)
 			break;
+	}
 
 	if (i < 0 || i >= driver_count) {
 		printf("the impossible happened\n");
@@ -49,3 +59,37 @@ void SetupSound(void)
 	out_current = &out_drivers[i];
 }
 
+
+int out_rate_step(int used, int target)
+{
+	int step = (long long)(used - target) * RATE_ADJ_MAX / target;
+
+	if (step > RATE_ADJ_MAX) step = RATE_ADJ_MAX;
+	if (step < -RATE_ADJ_MAX) step = -RATE_ADJ_MAX;
+	return 0x10000 + step;
+}
+
+int out_resample(struct out_resampler *rs, short *ring, int ring_len, int w,
+	int space, const short *src, int frames, int step)
+{
+	int i;
+
+	if (frames <= 0)
+		return w;
+	for (; (rs->pos >> 16) < frames && space > 0; rs->pos += step, space--) {
+		int i0 = (rs->pos >> 16) - 1, f = (rs->pos & 0xffff) >> 1;
+		const short *a = i0 < 0 ? rs->last_frame : src + i0 * 2;
+		const short *b = src + (i0 + 1) * 2;
+
+		ring[w]     = a[0] + (((b[0] - a[0]) * f) >> 15);
+		ring[w + 1] = a[1] + (((b[1] - a[1]) * f) >> 15);
+		w += 2;
+		if (w >= ring_len) w = 0;
+	}
+	i = frames - 1;
+	rs->last_frame[0] = src[i * 2];
+	rs->last_frame[1] = src[i * 2 + 1];
+	rs->pos -= frames << 16;
+	if (rs->pos < 0) rs->pos = 0; // ran out of space
+	return w;
+}
@@ -7,9 +7,25 @@ struct out_driver {
 	void (*finish)(void);
 	int (*busy)(void);
 	void (*feed)(void *data, int bytes);
+	int (*fill)(void);	// optional, bytes queued
 };
 
 extern struct out_driver *out_current;
+extern int out_rate;	// drivers open at this rate and may change it
+
+// linear resampler for drivers that hold their queue around a target
+// fill by stepping through the input slightly faster or slower
+struct out_resampler {
+	short last_frame[2];	// input frame 0 is the last one of the previous call
+	int pos;		// 16.16 in input frames
+};
+
+// step for out_resample(), from the fill before the feed
+int  out_rate_step(int used, int target);
+// s16 stereo into a ring of ring_len shorts, at most space frames from
+// position w, returns the new write position
+int  out_resample(struct out_resampler *rs, short *ring, int ring_len, int w,
+	int space, const short *src, int frames, int step);
 
 void SetupSound(void);
 
@@ -192,6 +192,7 @@ static int pulse_init(void)
      // Set sample spec ////////////////////////////////////////////////////////
      device.spec.format = PA_SAMPLE_S16NE;
      device.spec.channels = 2;
+     settings.frequency = out_rate;
      device.spec.rate = settings.frequency;
 
      pa_buffer_attr buffer_attributes;
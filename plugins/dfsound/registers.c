@@ -23,6 +23,7 @@
 #include "registers.h"
 #include "spu_config.h"
 #include "spu.h"
+#include "spu_trace.h"
 
 static void SoundOn(int start,int end,unsigned short val);
 static void SoundOff(int start,int end,unsigned short val);
@@ -52,6 +53,8 @@ void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val,
  int r = reg & 0xffe;
  int rofs = (r - 0xc00) >> 1;
  int changed = spu.regArea[rofs] != val;
+
+ spu_trace(SPUT_WREG, val, cycles, reg, NULL, 0);
  spu.regArea[rofs] = val;
 
  if (!changed && (ignore_dupe[rofs >> 5] & (1u << (rofs & 0x1f))))
@@ -60,11 +63,22 @@ void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val,
  if (val == 0 && (r & 0xff8) == 0xd88)
   return;
 
- do_samples_if_needed(cycles, 0, 16);
-
  if(r>=0x0c00 && r<0x0d80)                             // some channel info?
   {
    int ch=(r>>4)-0xc0;                                 // calc channel
+
+   // voices that aren't playing don't affect the output, no need to
+   // break up the rendering for them, unless it's their pitch/loop
+   // and they may be advancing towards an irq
+   if ((spu.dwChannelsAudible | spu.dwNewChannel) & (1<<ch))
+    do_samples_if_needed(cycles, 0, 16);
+   else if ((r & 0x0f) == 4 || (r & 0x0f) == 14) {
+    if (spu.spuCtrl & CTRL_IRQ)
+     do_samples_if_needed(cycles, 0, 16);
+    else
+     sync_silent_chan(ch);
+   }
+
    switch(r&0x0f)
     {
      //------------------------------------------------// r volume
@@ -121,7 +135,10 @@ void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val,
     }
    return;
   }
- else if (0x0e00 <= r && r < 0x0e60)
+
+ do_samples_if_needed(cycles, 0, 16);
+
+ if (0x0e00 <= r && r < 0x0e60)
   {
    int ch = (r >> 2) & 0x1f;
    log_unhandled("c%02d w %cvol %04x\n", ch, (r & 2) ? 'r' : 'l', val);
@@ -138,6 +155,7 @@ void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val,
     //-------------------------------------------------//
     case H_SPUdata:
       *(unsigned short *)(spu.spuMemC + spu.spuAddr) = HTOLE16(val);
+      spu_irq_scan_invalidate(spu.spuAddr, spu.spuAddr + 2);
       spu.spuAddr += 2;
       spu.spuAddr &= 0x7fffe;
       check_irq_io(spu.spuAddr);
@@ -332,6 +350,8 @@ rvbd:
 unsigned short CALLBACK SPUreadRegister(unsigned long reg, unsigned int cycles)
 {
  const unsigned long r = reg & 0xffe;
+
+ spu_trace(SPUT_RREG, 0, cycles, reg, NULL, 0);
         
  if(r>=0x0c00 && r<0x0d80)
   {
@@ -351,6 +371,7 @@ unsigned short CALLBACK SPUreadRegister(unsigned long reg, unsigned int cycles)
      case 14:                                          // get loop address
       {
        const int ch=(r>>4)-0xc0;
+       sync_silent_chan(ch);
        return (unsigned short)((spu.s_chan[ch].pLoop-spu.spuMemC)>>3);
       }
     }
@@ -94,6 +94,26 @@ static void reverb_interpolate(sample_buf *sb, int curr_addr,
  }
 }
 
+// work area taps, see MixREVERB()
+enum {
+ RT_LSAME_M2, RT_RSAME_M2, RT_LDIFF_M2, RT_RDIFF_M2,
+ RT_DLSAME, RT_DRSAME, RT_DLDIFF, RT_DRDIFF,
+ RT_LSAME, RT_RSAME, RT_LDIFF, RT_RDIFF,
+ RT_LCOMB1, RT_LCOMB2, RT_LCOMB3, RT_LCOMB4,
+ RT_RCOMB1, RT_RCOMB2, RT_RCOMB3, RT_RCOMB4,
+ RT_LAPF1_D, RT_RAPF1_D, RT_LAPF2_D, RT_RAPF2_D,
+ RT_LAPF1, RT_RAPF1, RT_LAPF2, RT_RAPF2,
+ RT_CNT
+};
+
+// all taps move forward together, so instead of wrapping each of them
+// on every sample, run in segments where none of them hits the end of
+// the work area and just index from the segment start address
+#define r_tap(t) ((int)(signed short)LE16TOH(spuMem[a[t] + i]))
+#define w_tap(t, iVal) \
+ ssat32_to_16(iVal); \
+ spuMem[a[t] + i] = HTOLE16(iVal)
+
 static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr,
   int do_filter)
 {
@@ -111,7 +131,8 @@ static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr,
  int vLIN = rvb->vLIN >> 1, vRIN = rvb->vRIN >> 1;
  int vWALL = rvb->vWALL >> 1;
  int vIIR = rvb->vIIR;
- int ns;
+ int ofs[RT_CNT], a[RT_CNT];
+ int ns, i, t, cnt;
 
 #if P_HAVE_PTHREAD || defined(WANT_THREAD_CODE)
  sb = &spu.sb_thread[MAXCHAN];
@@ -121,51 +142,75 @@ static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr,
  if (mldiff_m2o >= space) mldiff_m2o -= space;
  if (mrdiff_m2o >= space) mrdiff_m2o -= space;
 
+ ofs[RT_LSAME_M2] = mlsame_m2o;     ofs[RT_RSAME_M2] = mrsame_m2o;
+ ofs[RT_LDIFF_M2] = mldiff_m2o;     ofs[RT_RDIFF_M2] = mrdiff_m2o;
+ ofs[RT_DLSAME]  = rvb->dLSAME;     ofs[RT_DRSAME]  = rvb->dRSAME;
+ ofs[RT_DLDIFF]  = rvb->dLDIFF;     ofs[RT_DRDIFF]  = rvb->dRDIFF;
+ ofs[RT_LSAME]   = rvb->mLSAME;     ofs[RT_RSAME]   = rvb->mRSAME;
+ ofs[RT_LDIFF]   = rvb->mLDIFF;     ofs[RT_RDIFF]   = rvb->mRDIFF;
+ ofs[RT_LCOMB1]  = rvb->mLCOMB1;    ofs[RT_LCOMB2]  = rvb->mLCOMB2;
+ ofs[RT_LCOMB3]  = rvb->mLCOMB3;    ofs[RT_LCOMB4]  = rvb->mLCOMB4;
+ ofs[RT_RCOMB1]  = rvb->mRCOMB1;    ofs[RT_RCOMB2]  = rvb->mRCOMB2;
+ ofs[RT_RCOMB3]  = rvb->mRCOMB3;    ofs[RT_RCOMB4]  = rvb->mRCOMB4;
+ ofs[RT_LAPF1_D] = rvb->mLAPF1_dAPF1; ofs[RT_RAPF1_D] = rvb->mRAPF1_dAPF1;
+ ofs[RT_LAPF2_D] = rvb->mLAPF2_dAPF2; ofs[RT_RAPF2_D] = rvb->mRAPF2_dAPF2;
+ ofs[RT_LAPF1]   = rvb->mLAPF1;     ofs[RT_RAPF1]   = rvb->mRAPF1;
+ ofs[RT_LAPF2]   = rvb->mLAPF2;     ofs[RT_RAPF2]   = rvb->mRAPF2;
+
  for (ns = 0; ns < ns_to * 2; )
+ {
+  cnt = (ns_to * 2 - ns + 3) / 4;
+  for (t = 0; t < RT_CNT; t++) {
+   a[t] = rvb2ram_offs(curr_addr, space, ofs[t]);
+   if (cnt > 0x40000 - a[t])
+    cnt = 0x40000 - a[t];
+  }
+
+  for (i = 0; i < cnt; i++)
   {
    int Lin = RVB[ns];
    int Rin = RVB[ns+1];
-   int mlsame_m2 = g_buffer(mlsame_m2o) << (15-1);
-   int mrsame_m2 = g_buffer(mrsame_m2o) << (15-1);
-   int mldiff_m2 = g_buffer(mldiff_m2o) << (15-1);
-   int mrdiff_m2 = g_buffer(mrdiff_m2o) << (15-1);
+   int mlsame_m2 = r_tap(RT_LSAME_M2) << (15-1);
+   int mrsame_m2 = r_tap(RT_RSAME_M2) << (15-1);
+   int mldiff_m2 = r_tap(RT_LDIFF_M2) << (15-1);
+   int mrdiff_m2 = r_tap(RT_RDIFF_M2) << (15-1);
    int Lout, Rout, out0[2], out1[2];
 
    ssat32_to_16(Lin); Lin *= vLIN;
    ssat32_to_16(Rin); Rin *= vRIN;
 
    // from nocash psx-spx
-   mlsame_m2 += ((Lin + g_buffer(rvb->dLSAME) * vWALL - mlsame_m2) >> 15) * vIIR;
-   mrsame_m2 += ((Rin + g_buffer(rvb->dRSAME) * vWALL - mrsame_m2) >> 15) * vIIR;
-   mldiff_m2 += ((Lin + g_buffer(rvb->dLDIFF) * vWALL - mldiff_m2) >> 15) * vIIR;
-   mrdiff_m2 += ((Rin + g_buffer(rvb->dRDIFF) * vWALL - mrdiff_m2) >> 15) * vIIR;
-   mlsame_m2 >>= (15-1); s_buffer_w(rvb->mLSAME, mlsame_m2);
-   mrsame_m2 >>= (15-1); s_buffer_w(rvb->mRSAME, mrsame_m2);
-   mldiff_m2 >>= (15-1); s_buffer_w(rvb->mLDIFF, mldiff_m2);
-   mrdiff_m2 >>= (15-1); s_buffer_w(rvb->mRDIFF, mrdiff_m2);
-
-   Lout = vCOMB1 * g_buffer(rvb->mLCOMB1) + vCOMB2 * g_buffer(rvb->mLCOMB2)
-        + vCOMB3 * g_buffer(rvb->mLCOMB3) + vCOMB4 * g_buffer(rvb->mLCOMB4);
-   Rout = vCOMB1 * g_buffer(rvb->mRCOMB1) + vCOMB2 * g_buffer(rvb->mRCOMB2)
-        + vCOMB3 * g_buffer(rvb->mRCOMB3) + vCOMB4 * g_buffer(rvb->mRCOMB4);
+   mlsame_m2 += ((Lin + r_tap(RT_DLSAME) * vWALL - mlsame_m2) >> 15) * vIIR;
+   mrsame_m2 += ((Rin + r_tap(RT_DRSAME) * vWALL - mrsame_m2) >> 15) * vIIR;
+   mldiff_m2 += ((Lin + r_tap(RT_DLDIFF) * vWALL - mldiff_m2) >> 15) * vIIR;
+   mrdiff_m2 += ((Rin + r_tap(RT_DRDIFF) * vWALL - mrdiff_m2) >> 15) * vIIR;
+   mlsame_m2 >>= (15-1); w_tap(RT_LSAME, mlsame_m2);
+   mrsame_m2 >>= (15-1); w_tap(RT_RSAME, mrsame_m2);
+   mldiff_m2 >>= (15-1); w_tap(RT_LDIFF, mldiff_m2);
+   mrdiff_m2 >>= (15-1); w_tap(RT_RDIFF, mrdiff_m2);
+
+   Lout = vCOMB1 * r_tap(RT_LCOMB1) + vCOMB2 * r_tap(RT_LCOMB2)
+        + vCOMB3 * r_tap(RT_LCOMB3) + vCOMB4 * r_tap(RT_LCOMB4);
+   Rout = vCOMB1 * r_tap(RT_RCOMB1) + vCOMB2 * r_tap(RT_RCOMB2)
+        + vCOMB3 * r_tap(RT_RCOMB3) + vCOMB4 * r_tap(RT_RCOMB4);
 
    preload(SSumLR + ns + 64*2/4 - 4);
 
-   Lout -= vAPF1 * g_buffer(rvb->mLAPF1_dAPF1); Lout >>= (15-1);
-   Rout -= vAPF1 * g_buffer(rvb->mRAPF1_dAPF1); Rout >>= (15-1);
-   s_buffer_w(rvb->mLAPF1, Lout);
-   s_buffer_w(rvb->mRAPF1, Rout);
-   Lout = Lout * vAPF1 + (g_buffer(rvb->mLAPF1_dAPF1) << (15-1));
-   Rout = Rout * vAPF1 + (g_buffer(rvb->mRAPF1_dAPF1) << (15-1));
+   Lout -= vAPF1 * r_tap(RT_LAPF1_D); Lout >>= (15-1);
+   Rout -= vAPF1 * r_tap(RT_RAPF1_D); Rout >>= (15-1);
+   w_tap(RT_LAPF1, Lout);
+   w_tap(RT_RAPF1, Rout);
+   Lout = Lout * vAPF1 + (r_tap(RT_LAPF1_D) << (15-1));
+   Rout = Rout * vAPF1 + (r_tap(RT_RAPF1_D) << (15-1));
 
    preload(RVB + ns + 64*2/4 - 4);
 
-   Lout -= vAPF2 * g_buffer(rvb->mLAPF2_dAPF2); Lout >>= (15-1);
-   Rout -= vAPF2 * g_buffer(rvb->mRAPF2_dAPF2); Rout >>= (15-1);
-   s_buffer_w(rvb->mLAPF2, Lout);
-   s_buffer_w(rvb->mRAPF2, Rout);
-   Lout = Lout * vAPF2 + (g_buffer(rvb->mLAPF2_dAPF2) << (15-1));
-   Rout = Rout * vAPF2 + (g_buffer(rvb->mRAPF2_dAPF2) << (15-1));
+   Lout -= vAPF2 * r_tap(RT_LAPF2_D); Lout >>= (15-1);
+   Rout -= vAPF2 * r_tap(RT_RAPF2_D); Rout >>= (15-1);
+   w_tap(RT_LAPF2, Lout);
+   w_tap(RT_RAPF2, Rout);
+   Lout = Lout * vAPF2 + (r_tap(RT_LAPF2_D) << (15-1));
+   Rout = Rout * vAPF2 + (r_tap(RT_RAPF2_D) << (15-1));
 
    out0[0] = out1[0] = (Lout >> (15-1)) * rvb->VolLeft  >> 15;
    out0[1] = out1[1] = (Rout >> (15-1)) * rvb->VolRight >> 15;
@@ -180,8 +225,12 @@ static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr,
    curr_addr++;
    curr_addr = rvb_wrap(curr_addr, space);
   }
+ }
 }
 
+#undef r_tap
+#undef w_tap
+
 static void MixREVERB_off(int *SSumLR, int ns_to, int curr_addr)
 {
  const REVERBInfo *rvb = spu.rvb;
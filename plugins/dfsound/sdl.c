@@ -17,31 +17,52 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <SDL.h>
 #include "out.h"
 
 #define BUFFER_SIZE		22050
 
+// aim for ~2 frames of stereo samples queued (in shorts), the rate
+// control in sdl_feed nudges the output rate to stay around it
+#define TARGET_FILL		(44100 / 60 * 2 * 2)
+// way too much queued (after a stall?), drop input to cut the latency
+#define MAX_FILL		(TARGET_FILL * 4)
+
+#define BARRIER()		__sync_synchronize()
+
+// single producer (sdl_feed) / single consumer (SOUND_FillAudio) ring,
+// each side only ever writes its own position
 short			*pSndBuffer = NULL;
 int				iBufSize = 0;
 volatile int	iReadPos = 0, iWritePos = 0;
 
+static struct out_resampler rs;
+
 static void SOUND_FillAudio(void *unused, Uint8 *stream, int len) {
 	short *p = (short *)stream;
+	int r = iReadPos, w = iWritePos;
+	int n, l;
 
+	BARRIER(); // data written before iWritePos was
 	len /= sizeof(short);
 
-	while (iReadPos != iWritePos && len > 0) {
-		*p++ = pSndBuffer[iReadPos++];
-		if (iReadPos >= iBufSize) iReadPos = 0;
-		--len;
-	}
+	n = w - r;
+	if (n < 0) n += iBufSize;
+	if (n > len) n = len;
+
+	l = iBufSize - r;
+	if (l > n) l = n;
+	memcpy(p, pSndBuffer + r, l * sizeof(short));
+	memcpy(p + l, pSndBuffer, (n - l) * sizeof(short));
+
+	r += n;
+	if (r >= iBufSize) r -= iBufSize;
+	BARRIER(); // done reading before the space is handed back
+	iReadPos = r;
 
 	// Fill remaining space with silence
-	while (len > 0) {
-		*p++ = 0;
-		--len;
-	}
+	memset(p + n, 0, (len - n) * sizeof(short));
 }
 
 static void InitSDL() {
@@ -61,12 +82,18 @@ static void DestroySDL() {
 }
 
 static int sdl_audio_opened = 0;
+static int sdl_audio_rate;
 
 static int sdl_init(void) {
 	SDL_AudioSpec				spec;
 
 	if (pSndBuffer != NULL) return -1;
 
+	if (sdl_audio_opened && sdl_audio_rate != out_rate) {
+		SDL_CloseAudio();
+		sdl_audio_opened = 0;
+	}
+
 	/* If audio is already open, just reinitialize the buffer */
 	if (sdl_audio_opened) {
 		SDL_PauseAudio(1);
@@ -75,13 +102,14 @@ static int sdl_init(void) {
 		if (pSndBuffer == NULL) return -1;
 		iReadPos = 0;
 		iWritePos = 0;
+		memset(&rs, 0, sizeof(rs));
 		SDL_PauseAudio(0);
 		return 0;
 	}
 
 	InitSDL();
 
-	spec.freq = 44100;
+	spec.freq = out_rate;
 	spec.format = AUDIO_S16SYS;
 	spec.channels = 2;
 	spec.samples = 512;
@@ -93,6 +121,7 @@ static int sdl_init(void) {
 	}
 
 	sdl_audio_opened = 1;
+	sdl_audio_rate = out_rate;
 	iBufSize = BUFFER_SIZE;
 
 	pSndBuffer = (short *)malloc(iBufSize * sizeof(short));
@@ -104,6 +133,7 @@ static int sdl_init(void) {
 
 	iReadPos = 0;
 	iWritePos = 0;
+	memset(&rs, 0, sizeof(rs));
 
 	SDL_PauseAudio(0);
 	return 0;
@@ -120,34 +150,40 @@ static void sdl_finish(void) {
 	pSndBuffer = NULL;
 }
 
-static int sdl_busy(void) {
-	int size;
-
-	if (pSndBuffer == NULL) return 1;
+// shorts queued, the unit of all the fill limits above
+static int sdl_used(void) {
+	int size = iWritePos - iReadPos;
+	if (size < 0) size += iBufSize;
+	return size;
+}
 
-	size = iReadPos - iWritePos;
-	if (size <= 0) size += iBufSize;
+static int sdl_fill(void) {
+	return sdl_used() * sizeof(short);
+}
 
-	if (size < iBufSize / 2) return 1;
+static int sdl_busy(void) {
+	if (pSndBuffer == NULL) return 1;
 
-	return 0;
+	return sdl_used() >= TARGET_FILL;
 }
 
 static void sdl_feed(void *pSound, int lBytes) {
-	short *p = (short *)pSound;
+	int frames = lBytes / (2 * sizeof(short));
+	int used, space, w;
 
-	if (pSndBuffer == NULL) return;
+	if (pSndBuffer == NULL || frames <= 0) return;
 
-	while (lBytes > 0) {
-		if (((iWritePos + 1) % iBufSize) == iReadPos) break;
+	used = sdl_used();
+	if (used > MAX_FILL) return;
 
-		pSndBuffer[iWritePos] = *p++;
+	// keep one frame free so that full != empty
+	space = (iBufSize - used) / 2 - 1;
 
-		++iWritePos;
-		if (iWritePos >= iBufSize) iWritePos = 0;
+	w = out_resample(&rs, pSndBuffer, iBufSize, iWritePos, space, pSound,
+		frames, out_rate_step(used, TARGET_FILL));
 
-		lBytes -= sizeof(short);
-	}
+	BARRIER(); // samples must be visible before the new position
+	iWritePos = w;
 }
 
 void out_register_sdl(struct out_driver *drv)
@@ -157,4 +193,5 @@ void out_register_sdl(struct out_driver *drv)
 	drv->finish = sdl_finish;
 	drv->busy = sdl_busy;
 	drv->feed = sdl_feed;
+	drv->fill = sdl_fill;
 }
@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <assert.h>
+#include <time.h>
 #include "stdafx.h"
 
 #define _IN_SPU
@@ -28,6 +29,9 @@
 #include "out.h"
 #include "spu_config.h"
 #include "spu.h"
+#include "spu_trace.h"
+#include "../../include/evtrace.h"
+#include "../../include/thread_wakeups.h"
 
 #ifdef __arm__
 #include "arm_features.h"
@@ -45,9 +49,6 @@
 
 #define PSXCLK	33868800	/* 33.8688 MHz */
 
-// intended to be ~1 frame
-#define IRQ_NEAR_BLOCKS 32
-
 /*
 #if defined (USEMACOSX)
 static char * libraryName     = N_("Mac OS X Sound");
@@ -73,10 +74,35 @@ SPUConfig       spu_config;
 
 static int iFMod[NSSIZE];
 static int RVB[NSSIZE * 2];
-int ChanBuf[NSSIZE];
+static int ChanBuf[NSSIZE];
 
 #define CDDA_BUFFER_SIZE (16384 * sizeof(uint32_t)) // must be power of 2
 
+// 44.1kHz -> out_rate conversion step (16.16), 0 if the driver runs at 44.1
+static unsigned int out_step, out_pos;
+static short out_last[2];
+
+// debug timing, off until the frontend asks for it with spu_get_prof_info()
+static int prof_on;
+static struct spu_prof prof;
+
+static unsigned int prof_ticks(void)
+{
+#ifndef _WIN32
+ struct timespec ts;
+
+ if (!prof_on)
+  return 0;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+ return 0;
+#endif
+}
+
+#define PROF_ADD(field, t0) \
+ if (unlikely(prof_on)) prof.field += prof_ticks() - (t0)
+
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
 ////////////////////////////////////////////////////////////////////////
@@ -271,6 +297,7 @@ static void StartSoundMain(int ch)
  s_chan->bStarting = 1;
 
  s_chan->pCurr = spu.spuMemC + ((regAreaGetCh(ch, 6) & ~1) << 3);
+ s_chan->silent_ns = 0;
 
  spu.dwNewChannel&=~(1<<ch);                           // clear new channel bit
  spu.dwChannelDead&=~(1<<ch);
@@ -350,31 +377,86 @@ static void decode_block_data(int *dest, const unsigned char *src, int predict_n
     {  122, -60 }
  };
  int nSample;
- int fa, s_1, s_2, d, s;
+ int fa, s_1, s_2, f0, f1;
 
  s_1 = dest[27];
  s_2 = dest[26];
 
- for (nSample = 0; nSample < 28; src++)
+ // nibble expansion and shift don't depend on the previous samples,
+ // keep them in a separate loop that the compiler can vectorize
+ for (nSample = 0; nSample < 28; nSample += 2)
  {
-  d = (int)*src;
-  s = (int)(signed short)((d & 0x0f) << 12);
+  int d = src[nSample / 2];
+  dest[nSample]     = (int)(signed short)((d & 0x0f) << 12) >> shift_factor;
+  dest[nSample + 1] = (int)(signed short)((d & 0xf0) << 8) >> shift_factor;
+ }
 
-  fa  = s >> shift_factor;
-  fa += ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
+ // filter 0 is common and leaves the samples as they are
+ // (they can't overflow either)
+ f0 = f[predict_nr][0];
+ f1 = f[predict_nr][1];
+ if (f0 == 0)
+  return;
+
+ for (nSample = 0; nSample < 28; nSample++)
+ {
+  fa  = dest[nSample];
+  fa += ((s_1 * f0)>>6) + ((s_2 * f1)>>6);
   ssat32_to_16(fa);
   s_2 = s_1; s_1 = fa;
 
-  dest[nSample++] = fa;
+  dest[nSample] = fa;
+ }
+}
 
-  s = (int)(signed short)((d & 0xf0) << 8);
-  fa  = s >> shift_factor;
-  fa += ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
-  ssat32_to_16(fa);
-  s_2 = s_1; s_1 = fa;
+// decoded blocks, looped instrument samples are decoded over and over,
+// often by several voices at once. Only blocks with a filter are kept,
+// as they depend on the two history samples, 0 ones decode as fast as
+// they copy. An entry is checked against the 16 block bytes, so spu ram
+// writes (dma, fifo, reverb, capture) don't have to invalidate anything.
+#define ADPCM_CACHE_BITS 9
+
+struct adpcm_cache {
+ struct {
+  uint32_t raw[4];
+  int s_1, s_2;
+  short pcm[28];
+ } e[1 << ADPCM_CACHE_BITS];
+};
+
+// one per thread that decodes, this is the emu thread one
+static struct adpcm_cache adpcm_cache;
+
+static void decode_block_cached(struct adpcm_cache *c, int *dest,
+ const unsigned char *start, int addr, int predict_nr, int shift_factor)
+{
+ int n, s_1 = dest[27], s_2 = dest[26];
+ uint32_t raw[4];
+ unsigned int i;
 
-  dest[nSample++] = fa;
+ if (predict_nr == 0 || predict_nr > 4) {
+  decode_block_data(dest, start + 2, predict_nr, shift_factor);
+  return;
  }
+
+ memcpy(raw, start, sizeof(raw));
+ i = ((unsigned int)addr >> 3) ^ ((unsigned int)s_1 * 0x9e3779b1u >> 16)
+   ^ (unsigned int)s_2;
+ i &= (1 << ADPCM_CACHE_BITS) - 1;
+ if (c->e[i].s_1 == s_1 && c->e[i].s_2 == s_2
+     && !memcmp(c->e[i].raw, raw, sizeof(raw))) {
+  for (n = 0; n < 28; n++)
+   dest[n] = c->e[i].pcm[n];
+  return;
+ }
+
+ decode_block_data(dest, start + 2, predict_nr, shift_factor);
+
+ memcpy(c->e[i].raw, raw, sizeof(raw));
+ c->e[i].s_1 = s_1;
+ c->e[i].s_2 = s_2;
+ for (n = 0; n < 28; n++)
+  c->e[i].pcm[n] = dest[n];
 }
 
 static int decode_block(void *unused, int ch, int *SB)
@@ -405,7 +487,8 @@ static int decode_block(void *unused, int ch, int *SB)
  shift_factor = predict_nr & 0xf;
  predict_nr >>= 4;
 
- decode_block_data(SB, start + 2, predict_nr, shift_factor);
+ decode_block_cached(&adpcm_cache, SB, start, start - spu.spuMemC,
+  predict_nr, shift_factor);
 
  flags = start[1];
  if (flags & 4 && !s_chan->bIgnoreLoop)
@@ -421,7 +504,7 @@ static int decode_block(void *unused, int ch, int *SB)
 }
 
 // do block, but ignore sample data
-static int skip_block(int ch)
+static int skip_block(int ch, int may_irq)
 {
  SPUCHAN *s_chan = &spu.s_chan[ch];
  unsigned char *start = s_chan->pCurr;
@@ -435,7 +518,8 @@ static int skip_block(int ch)
   start = s_chan->pLoop;
  }
 
- check_irq(ch, start);
+ if (may_irq)
+  check_irq(ch, start);
 
  flags = start[1];
  if (flags & 4 && !s_chan->bIgnoreLoop)
@@ -450,52 +534,151 @@ static int skip_block(int ch)
  return ret;
 }
 
+// blocks may start on any 8 byte boundary, so the phase must match too
+static int irq_scan_covers(const IRQSCAN *r, const unsigned char *p)
+{
+ return r->from <= p && p <= r->to && !((p - r->from) & 15);
+}
+
+// first stop/loop block in [p, lim) or NULL, the runs found are kept
+// per channel so a steady loop is only walked once
+static unsigned char *find_block_end(SPUCHAN *s_chan, int seg,
+ unsigned char *p, unsigned char *lim)
+{
+ IRQSCAN *r = &s_chan->irq_scan[seg];
+ unsigned char *q;
+
+ // the capture buffers are rewritten all the time, don't cache them
+ if (unlikely(p < spu.spuMemC + 0x1000))
+ {
+  for (q = p; q < lim; q += 16)
+   if (q[1] & 1)
+    return q;
+  return NULL;
+ }
+
+ if (!irq_scan_covers(r, p))
+ {
+  r = &s_chan->irq_scan[seg ^ 1];
+  if (!irq_scan_covers(r, p))
+  {
+   r = &s_chan->irq_scan[seg];
+   r->from = r->to = p;
+   r->end = 0;
+  }
+ }
+
+ if (r->end)
+  return r->to < lim ? r->to : NULL;
+
+ for (q = r->to; q < lim; q += 16)
+ {
+  if (q[1] & 1)
+  {
+   r->to = q;
+   r->end = 1;
+   return q;
+  }
+ }
+ r->to = q;
+ return NULL;
+}
+
+// how many blocks after 'block' the irq block gets played, ~0 if not
+// within max_blocks. Playback runs to the end of the current segment,
+// then repeats the loop one, so at most two segments need looking at.
+static unsigned int irq_blocks_away(SPUCHAN *s_chan, unsigned char *block,
+ unsigned int max_blocks)
+{
+ unsigned char *irq = spu.pSpuIrq, *lim, *e;
+ unsigned char *mem_end = spu.spuMemC + 0x80000 + 16;
+ unsigned int k = 0;
+ int seg, hit;
+
+ // irq must be on a block boundary of one of the segments
+ hit = irq >= s_chan->pLoop && !((irq - s_chan->pLoop) & 15);
+ if (!hit && !(irq >= block && !((irq - block) & 15)))
+  return ~0u;
+
+ for (seg = 0; seg < 2 && k < max_blocks; seg++)
+ {
+  lim = block + (max_blocks - k) * 16;
+  if (lim > mem_end)
+   lim = mem_end;
+  hit = irq >= block && irq < lim && !((irq - block) & 15);
+  if (hit)
+   lim = irq;
+
+  e = find_block_end(s_chan, seg, block, lim);
+  if (e == NULL)
+   return hit ? k + (irq - block) / 16 : ~0u;
+
+  k += (e - block) / 16 + 1;
+  block = s_chan->pLoop;
+ }
+
+ return ~0u;
+}
+
 // if irq is going to trigger sooner than in upd_samples, set upd_samples
 static void scan_for_irq(int ch, unsigned int *upd_samples)
 {
  SPUCHAN *s_chan = &spu.s_chan[ch];
- int pos, sinc, sinc_inv, end;
+ unsigned int first, span, max_blocks, k, pos;
  unsigned char *block;
- int flags;
+ int sinc_inv;
 
  block = s_chan->pCurr;
- pos = s_chan->spos;
- sinc = s_chan->sinc;
- end = pos + *upd_samples * sinc;
  if (s_chan->prevflags & 1)                 // 1: stop/loop
   block = s_chan->pLoop;
 
- pos += (28 - s_chan->iSBPos) << 16;
- while (pos < end)
- {
-  if (block == spu.pSpuIrq)
-   break;
-  flags = block[1];
-  block += 16;
-  if (flags & 1) {                          // 1: stop/loop
-   block = s_chan->pLoop;
-  }
-  pos += 28 << 16;
- }
+ // relative to spos: the first block starts at 'first', then every 28<<16
+ first = (28 - s_chan->iSBPos) << 16;
+ span = *upd_samples * (unsigned int)s_chan->sinc;
+ if (first >= span)
+  return;
+ max_blocks = (span - first + (28 << 16) - 1) / (28 << 16);
+
+ k = irq_blocks_away(s_chan, block, max_blocks);
+ if (k == ~0u)
+  return;
+
+ sinc_inv = s_chan->sinc_inv;
+ if (sinc_inv == 0)
+  sinc_inv = s_chan->sinc_inv = (0x80000000u / (uint32_t)s_chan->sinc) << 1;
+
+ pos = first + k * (28 << 16);
+ *upd_samples = (((uint64_t)pos * sinc_inv) >> 32) + 1;
+ //xprintf("ch%02d: irq sched: %3d %03d\n",
+ // ch, *upd_samples, *upd_samples * 60 * 263 / 44100);
+}
+
+// spu ram [start, end) changed, drop the runs that may have seen it
+void spu_irq_scan_invalidate(unsigned int start, unsigned int end)
+{
+ unsigned char *s = spu.spuMemC + start, *e = spu.spuMemC + end;
+ IRQSCAN *r;
+ int ch, i;
 
- if (pos < end)
+ for (ch = 0; ch < MAXCHAN; ch++)
  {
-  sinc_inv = s_chan->sinc_inv;
-  if (sinc_inv == 0)
-   sinc_inv = s_chan->sinc_inv = (0x80000000u / (uint32_t)sinc) << 1;
-
-  pos -= s_chan->spos;
-  *upd_samples = (((uint64_t)pos * sinc_inv) >> 32) + 1;
-  //xprintf("ch%02d: irq sched: %3d %03d\n",
-  // ch, *upd_samples, *upd_samples * 60 * 263 / 44100);
+  for (i = 0; i < 2; i++)
+  {
+   r = &spu.s_chan[ch].irq_scan[i];
+   if (r->from < e && s < r->to + 16)
+    r->from = r->to = NULL;
+  }
  }
 }
 
+// note: spos/sbpos are kept in locals, the compiler can't keep them in
+// regs by itself as dst and decode_f() might alias them
 #define make_do_samples(name, fmod_code, interp_start, interp_store, interp_get, interp_end) \
 static noinline int name(int *dst, \
  int (*decode_f)(void *context, int ch, int *SB), void *ctx, \
- int ch, int ns_to, sample_buf *sb, int sinc, int *spos, int *sbpos) \
+ int ch, int ns_to, sample_buf *sb, int sinc, int *spos_p, int *sbpos_p) \
 {                                            \
+ int spos = *spos_p, sbpos = *sbpos_p;       \
  int ns, d, fa;                              \
  int ret = ns_to;                            \
  interp_start;                               \
@@ -504,20 +687,20 @@ static noinline int name(int *dst, \
  {                                           \
   fmod_code;                                 \
                                              \
-  *spos += sinc;                             \
-  while (*spos >= 0x10000)                   \
+  spos += sinc;                              \
+  while (spos >= 0x10000)                    \
   {                                          \
-   fa = sb->SB[(*sbpos)++];                  \
-   if (*sbpos >= 28)                         \
+   fa = sb->SB[sbpos++];                     \
+   if (sbpos >= 28)                          \
    {                                         \
-    *sbpos = 0;                              \
+    sbpos = 0;                               \
     d = decode_f(ctx, ch, sb->SB);           \
     if (d && ns < ret)                       \
      ret = ns;                               \
    }                                         \
                                              \
    interp_store;                             \
-   *spos -= 0x10000;                         \
+   spos -= 0x10000;                          \
   }                                          \
                                              \
   interp_get;                                \
@@ -525,6 +708,8 @@ static noinline int name(int *dst, \
                                              \
  interp_end;                                 \
                                              \
+ *spos_p = spos;                             \
+ *sbpos_p = sbpos;                           \
  return ret;                                 \
 }
 
@@ -549,14 +734,14 @@ make_do_samples(do_samples_simple, , ,
   simple_interp_store, simple_interp_get, )
 make_do_samples(do_samples_gauss, , ,
   StoreInterpolationGaussCubic(sb, fa),
-  dst[ns] = GetInterpolationGauss(sb, *spos), )
+  dst[ns] = GetInterpolationGauss(sb, spos), )
 make_do_samples(do_samples_cubic, , ,
   StoreInterpolationGaussCubic(sb, fa),
-  dst[ns] = GetInterpolationCubic(sb, *spos), )
+  dst[ns] = GetInterpolationCubic(sb, spos), )
 make_do_samples(do_samples_fmod,
   sinc = FModChangeFrequency(spu.s_chan[ch].iRawPitch, ns, iFMod), ,
   StoreInterpolationGaussCubic(sb, fa),
-  dst[ns] = GetInterpolationGauss(sb, *spos), )
+  dst[ns] = GetInterpolationGauss(sb, spos), )
 
 INLINE int do_samples_adpcm(int *dst,
  int (*decode_f)(void *context, int ch, int *SB), void *ctx,
@@ -593,7 +778,7 @@ static int do_samples_skip(int ch, int ns_to)
   spos += sinc;
   while (spos >= 28*0x10000)
   {
-   d = skip_block(ch);
+   d = skip_block(ch, 1);
    if (d && ns < ret)
     ret = ns;
    spos -= 28*0x10000;
@@ -619,7 +804,7 @@ static int do_samples_skip_fmod(int ch, int ns_to, int *fmod_buf)
   spos += FModChangeFrequency(s_chan->iRawPitch, ns, fmod_buf);
   while (spos >= 28*0x10000)
   {
-   d = skip_block(ch);
+   d = skip_block(ch, 1);
    if (d && ns < ret)
     ret = ns;
    spos -= 28*0x10000;
@@ -676,12 +861,12 @@ static int do_samples_noise(int *dst, int ch, int ns_to)
 
 #ifdef HAVE_ARMV5
 // asm code; lv and rv must be 0-3fff
-extern void mix_chan(int *SSumLR, int count, int lv, int rv);
-extern void mix_chan_rvb(int *SSumLR, int count, int lv, int rv, int *rvb);
+extern void mix_chan(int *SSumLR, int count, int lv, int rv, const int *src);
+extern void mix_chan_rvb(int *SSumLR, int count, int lv, int rv, int *rvb,
+ const int *src);
 #else
-static void mix_chan(int *SSumLR, int count, int lv, int rv)
+static void mix_chan(int *SSumLR, int count, int lv, int rv, const int *src)
 {
- const int *src = ChanBuf;
  int l, r;
 
  while (count--)
@@ -695,9 +880,9 @@ static void mix_chan(int *SSumLR, int count, int lv, int rv)
   }
 }
 
-static void mix_chan_rvb(int *SSumLR, int count, int lv, int rv, int *rvb)
+static void mix_chan_rvb(int *SSumLR, int count, int lv, int rv, int *rvb,
+ const int *src)
 {
- const int *src = ChanBuf;
  int *dst = SSumLR;
  int *drvb = rvb;
  int l, r;
@@ -719,10 +904,9 @@ static void mix_chan_rvb(int *SSumLR, int count, int lv, int rv, int *rvb)
 // 0x0800-0x0bff  Voice 1
 // 0x0c00-0x0fff  Voice 3
 static noinline void do_decode_bufs(unsigned short *mem, int which,
- int count, int decode_pos)
+ int count, int decode_pos, const int *src)
 {
  unsigned short *dst = &mem[0x800/2 + which*0x400/2];
- const int *src = ChanBuf;
  int cursor = decode_pos;
 
  while (count-- > 0)
@@ -735,47 +919,81 @@ static noinline void do_decode_bufs(unsigned short *mem, int which,
  // decode_pos is updated and irqs are checked later, after voice loop
 }
 
+// Silent voices only matter for irqs and loop address reads, so the
+// ones that can't hit the irq address just count the elapsed samples
+// and skip all of their blocks in one go when something looks at them.
+// That catch-up doesn't raise irqs, those would be late anyway.
+#define SILENT_NS_MAX (44100 * 8)
+
+static void skip_silent_chan(int ch, int may_irq)
+{
+ SPUCHAN *s_chan = &spu.s_chan[ch];
+ uint64_t pos;
+ unsigned int blocks;
+
+ if (s_chan->silent_ns == 0)
+  return;
+
+ pos = (uint64_t)s_chan->sinc * s_chan->silent_ns
+     + s_chan->spos + (s_chan->iSBPos << 16);
+ blocks = pos / (28 * 0x10000);
+ s_chan->spos = pos - (uint64_t)blocks * (28 * 0x10000);
+ s_chan->iSBPos = 0;
+ s_chan->silent_ns = 0;
+
+ while (blocks-- > 0)
+  {
+   unsigned char *start = s_chan->pCurr;
+
+   skip_block(ch, may_irq);
+   if (start == s_chan->pCurr || start - spu.spuMemC < 0x1000)
+    {
+     // looping on self or stopped(?)
+     spu.dwChannelDead |= 1<<ch;
+     s_chan->spos = 0;
+     break;
+    }
+  }
+}
+
+void sync_silent_chan(int ch)
+{
+ if (spu.s_chan[ch].silent_ns)
+  skip_silent_chan(ch, 0);
+}
+
 static void do_silent_chans(int ns_to, int silentch)
 {
  unsigned int mask;
  SPUCHAN *s_chan;
  int ch;
 
- mask = silentch & 0xffffff;
+ mask = silentch & ~spu.dwChannelDead & 0xffffff;
  for (ch = 0; mask != 0; ch++, mask >>= 1)
   {
    if (!(mask & 1)) continue;
-   if (spu.dwChannelDead & (1<<ch)) continue;
 
    s_chan = &spu.s_chan[ch];
-   if (s_chan->pCurr > spu.pSpuIrq && s_chan->pLoop > spu.pSpuIrq)
-    continue;
-
-   s_chan->spos += s_chan->iSBPos << 16;
-   s_chan->iSBPos = 0;
-
-   s_chan->spos += s_chan->sinc * ns_to;
-   while (s_chan->spos >= 28 * 0x10000)
+   if (!(spu.spuCtrl & CTRL_IRQ)
+       || (s_chan->pCurr > spu.pSpuIrq && s_chan->pLoop > spu.pSpuIrq))
     {
-     unsigned char *start = s_chan->pCurr;
-
-     skip_block(ch);
-     if (start == s_chan->pCurr || start - spu.spuMemC < 0x1000)
-      {
-       // looping on self or stopped(?)
-       spu.dwChannelDead |= 1<<ch;
-       s_chan->spos = 0;
-       break;
-      }
-
-     s_chan->spos -= 28 * 0x10000;
+     s_chan->silent_ns += ns_to;
+     if (s_chan->silent_ns > SILENT_NS_MAX)
+      s_chan->silent_ns = SILENT_NS_MAX;
+     continue;
     }
+
+   sync_silent_chan(ch);
+   if (spu.dwChannelDead & (1<<ch))
+    continue;
+   s_chan->silent_ns = ns_to;
+   skip_silent_chan(ch, 1);
   }
 }
 
 static void do_channels(int ns_to)
 {
- unsigned int mask;
+ unsigned int mask, t0 = prof_ticks();
  int do_rvb, ch, d;
  SPUCHAN *s_chan;
 
@@ -822,7 +1040,7 @@ static void do_channels(int ns_to)
 
    if (ch == 1 || ch == 3)
     {
-     do_decode_bufs(spu.spuMem, ch/2, ns_to, spu.decode_pos);
+     do_decode_bufs(spu.spuMem, ch/2, ns_to, spu.decode_pos, ChanBuf);
      spu.decode_dirty_ch |= 1 << ch;
     }
 
@@ -831,16 +1049,22 @@ static void do_channels(int ns_to)
    if (!(spu.spuCtrl & CTRL_MUTE))
     ;
    else if (s_chan->bRVBActive && do_rvb)
-    mix_chan_rvb(spu.SSumLR, ns_to, s_chan->iLeftVolume, s_chan->iRightVolume, RVB);
+    mix_chan_rvb(spu.SSumLR, ns_to, s_chan->iLeftVolume, s_chan->iRightVolume,
+      RVB, ChanBuf);
    else
-    mix_chan(spu.SSumLR, ns_to, s_chan->iLeftVolume, s_chan->iRightVolume);
+    mix_chan(spu.SSumLR, ns_to, s_chan->iLeftVolume, s_chan->iRightVolume,
+      ChanBuf);
   }
 
   MixCD(spu.SSumLR, RVB, ns_to, spu.decode_pos);
+  PROF_ADD(chans, t0);
 
   if (spu.rvb->StartAddr) {
-   if (do_rvb)
+   if (do_rvb) {
+    t0 = prof_ticks();
     REVERBDo(spu.SSumLR, RVB, ns_to, spu.rvb->CurrAddr);
+    PROF_ADD(reverb, t0);
+   }
 
    spu.rvb->CurrAddr += ns_to / 2;
    while (spu.rvb->CurrAddr >= 0x40000)
@@ -913,12 +1137,22 @@ static void thread_work_start(void);
 static void thread_work_wait_sync(struct work_item *work, int force);
 static void thread_sync_caches(void);
 static int  thread_get_i_done(void);
+static void thread_set_workers(int count);
+
+// the worker's own cache, the helpers have theirs
+static struct adpcm_cache adpcm_cache_work;
+
+struct work_decode {
+ struct work_item *work;
+ struct adpcm_cache *cache;
+};
 
 static int decode_block_work(void *context, int ch, int *SB)
 {
  const unsigned char *ram = spu.spuMemC;
  int predict_nr, shift_factor, flags;
- struct work_item *work = context;
+ struct work_decode *wd = context;
+ struct work_item *work = wd->work;
  int start = work->ch[ch].start;
  int loop = work->ch[ch].loop;
 
@@ -926,7 +1160,7 @@ static int decode_block_work(void *context, int ch, int *SB)
  shift_factor = predict_nr & 0xf;
  predict_nr >>= 4;
 
- decode_block_data(SB, ram + start + 2, predict_nr, shift_factor);
+ decode_block_cached(wd->cache, SB, ram + start, start, predict_nr, shift_factor);
 
  flags = ram[start + 1];
  if (flags & 4)
@@ -1048,13 +1282,11 @@ static void queue_channel_work(int ns_to, unsigned int silentch)
  thread_work_start();
 }
 
-static void do_channel_work(struct work_item *work)
+// interpolation/voice start state, must be done before any of the voices
+static void do_channel_work_prep(struct work_item *work)
 {
  unsigned int mask;
- int spos, sbpos;
- int d, ch, ns_to;
-
- ns_to = work->ns_to;
+ int ch;
 
  if (unlikely(spu.interpolation != spu_config.iUseInterpolation))
  {
@@ -1066,15 +1298,26 @@ static void do_channel_work(struct work_item *work)
  }
 
  if (work->rvb_addr)
-  memset(RVB, 0, ns_to * sizeof(RVB[0]) * 2);
+  memset(RVB, 0, work->ns_to * sizeof(RVB[0]) * 2);
 
  mask = work->channels_new;
  for (ch = 0; mask != 0; ch++, mask >>= 1) {
   if (mask & 1)
    StartSoundSB(&spu.sb_thread[ch]);
  }
+}
+
+// renders the voices in mask into SSumLR and rvb,
+// may run for several disjoint masks of the same item at once
+static void do_channel_work_mask(struct work_item *work, unsigned int mask,
+ int *SSumLR, int *rvb, int *chan_buf, struct adpcm_cache *cache)
+{
+ struct work_decode wd = { work, cache };
+ int spos, sbpos;
+ int d, ch, ns_to;
+
+ ns_to = work->ns_to;
 
- mask = work->channels_on;
  for (ch = 0; mask != 0; ch++, mask >>= 1)
   {
    if (!(mask & 1)) continue;
@@ -1084,37 +1327,51 @@ static void do_channel_work(struct work_item *work)
    sbpos = work->ch[ch].sbpos;
 
    if (work->ch[ch].bNoise)
-    do_lsfr_samples(ChanBuf, d, work->ctrl, &spu.dwNoiseCount, &spu.dwNoiseVal);
+    do_lsfr_samples(chan_buf, d, work->ctrl, &spu.dwNoiseCount, &spu.dwNoiseVal);
    else
-    do_samples_adpcm(ChanBuf, decode_block_work, work, ch, d, work->ch[ch].bFMod,
+    do_samples_adpcm(chan_buf, decode_block_work, &wd, ch, d, work->ch[ch].bFMod,
           &spu.sb_thread[ch], work->ch[ch].sinc, &spos, &sbpos);
 
-   d = MixADSR(ChanBuf, &work->ch[ch].adsr, d);
+   d = MixADSR(chan_buf, &work->ch[ch].adsr, d);
    if (d < ns_to) {
     work->ch[ch].adsr.EnvelopeVol = 0;
-    memset(&ChanBuf[d], 0, (ns_to - d) * sizeof(ChanBuf[0]));
+    memset(&chan_buf[d], 0, (ns_to - d) * sizeof(chan_buf[0]));
    }
 
    if (ch == 1 || ch == 3)
-    do_decode_bufs(spu.spuMem, ch/2, ns_to, work->decode_pos);
+    do_decode_bufs(spu.spuMem, ch/2, ns_to, work->decode_pos, chan_buf);
 
    if (work->ch[ch].bFMod == 2)                         // fmod freq channel
-    memcpy(iFMod, &ChanBuf, ns_to * sizeof(iFMod[0]));
+    memcpy(iFMod, chan_buf, ns_to * sizeof(iFMod[0]));
    if (work->ch[ch].bRVBActive && work->rvb_addr)
-    mix_chan_rvb(work->SSumLR, ns_to,
-      work->ch[ch].vol_l, work->ch[ch].vol_r, RVB);
+    mix_chan_rvb(SSumLR, ns_to,
+      work->ch[ch].vol_l, work->ch[ch].vol_r, rvb, chan_buf);
    else
-    mix_chan(work->SSumLR, ns_to, work->ch[ch].vol_l, work->ch[ch].vol_r);
+    mix_chan(SSumLR, ns_to, work->ch[ch].vol_l, work->ch[ch].vol_r, chan_buf);
   }
+}
 
-  if (work->rvb_addr)
-   REVERBDo(work->SSumLR, RVB, ns_to, work->rvb_addr);
+static void do_channel_work(struct work_item *work)
+{
+ unsigned int t0 = prof_ticks();
+
+ do_channel_work_prep(work);
+ do_channel_work_mask(work, work->channels_on, work->SSumLR, RVB, ChanBuf,
+  &adpcm_cache_work);
+ PROF_ADD(chans, t0);
+
+ if (work->rvb_addr) {
+  t0 = prof_ticks();
+  REVERBDo(work->SSumLR, RVB, work->ns_to, work->rvb_addr);
+  PROF_ADD(reverb, t0);
+ }
 }
 
 static void sync_worker_thread(int force_no_thread)
 {
  int force = force_no_thread;
  struct work_item *work;
+ unsigned int t0;
  int done, used_space;
 
  // rvb offsets will change, thread may be using them
@@ -1128,7 +1385,9 @@ static void sync_worker_thread(int force_no_thread)
 
  while ((force && used_space > 0) || used_space >= WORK_MAXCNT || done > 0) {
   work = &worker->i[worker->i_reaped & WORK_I_MASK];
+  t0 = prof_ticks();
   thread_work_wait_sync(work, force);
+  PROF_ADD(wait, t0);
 
   MixCD(work->SSumLR, RVB, work->ns_to, work->decode_pos);
   do_samples_finish(work->SSumLR, work->ns_to,
@@ -1153,6 +1412,7 @@ static void sync_worker_thread(int force_no_thread)
 
 static void queue_channel_work(int ns_to, int silentch) {}
 static void sync_worker_thread(int force_no_thread) {}
+static void thread_set_workers(int count) {}
 
 static const void * const worker = NULL;
 
@@ -1192,6 +1452,7 @@ void do_samples(unsigned int cycles_to, int force_no_thread)
   log_unhandled("ns_to oflow %d %d\n", ns_to, NSSIZE);
   ns_to = NSSIZE;
  }
+ evtrace_begin(EVT_SPU, ns_to);
 
   //////////////////////////////////////////////////////
   // special irq handling in the decode buffers (0x0000-0x1000)
@@ -1234,18 +1495,19 @@ void do_samples(unsigned int cycles_to, int force_no_thread)
    do_samples_finish(spu.SSumLR, ns_to, silentch, spu.decode_pos);
   }
   else {
+   thread_set_workers(spu_config.iThreadWorkers);
    queue_channel_work(ns_to, silentch);
    //sync_worker_thread(1); // uncomment for debug
   }
 
-  // advance "stopped" channels that can cause irqs
+  // advance "stopped" channels that can cause irqs, others lazily
   // (all chans are always playing on the real thing..)
-  if (spu.spuCtrl & CTRL_IRQ)
-   do_silent_chans(ns_to, silentch);
+  do_silent_chans(ns_to, silentch);
 
   spu.cycles_played += ns_to * 768;
   spu.decode_pos = (spu.decode_pos + ns_to) & 0x1ff;
   spu.spuStat = (spu.spuStat & ~0x800) | ((spu.decode_pos << 3) & 0x800);
+  evtrace_end(EVT_SPU);
 #if 0
   static int ccount; static time_t ctime; ccount++;
   if (time(NULL) != ctime)
@@ -1253,11 +1515,35 @@ void do_samples(unsigned int cycles_to, int force_no_thread)
 #endif
 }
 
+// converts the native 44.1kHz output to out_rate, linear interpolation
+// with input frame 0 being the last one of the previous call
+static void resample_out(const short *src, int frames)
+{
+  unsigned int pos = out_pos, step = out_step;
+  short *dst = spu.pS;
+
+  for (; (pos >> 16) < frames; pos += step, dst += 2)
+   {
+    int i0 = (int)(pos >> 16) - 1, f = (pos & 0xffff) >> 1;
+    const short *a = i0 < 0 ? out_last : src + i0 * 2;
+    const short *b = src + (i0 + 1) * 2;
+
+    dst[0] = a[0] + (((b[0] - a[0]) * f) >> 15);
+    dst[1] = a[1] + (((b[1] - a[1]) * f) >> 15);
+   }
+  out_last[0] = src[frames * 2 - 2];
+  out_last[1] = src[frames * 2 - 1];
+  out_pos = pos - (frames << 16);
+  spu.pS = dst;
+}
+
 static void do_samples_finish(int *SSumLR, int ns_to,
  int silentch, int decode_pos)
 {
   int vol_l = ((int)regAreaGet(H_SPUcmvolL) << 16) >> 17;
   int vol_r = ((int)regAreaGet(H_SPUcmvolR) << 16) >> 17;
+  short rbuf[NSSIZE * 2];
+  short *pS = out_step ? rbuf : spu.pS;
   int ns;
   int d;
 
@@ -1279,9 +1565,9 @@ static void do_samples_finish(int *SSumLR, int ns_to,
   if (!(vol_l | vol_r))
    {
     // muted? (rare)
-    memset(spu.pS, 0, ns_to * 2 * sizeof(spu.pS[0]));
+    memset(pS, 0, ns_to * 2 * sizeof(pS[0]));
     memset(SSumLR, 0, ns_to * 2 * sizeof(SSumLR[0]));
-    spu.pS += ns_to * 2;
+    pS += ns_to * 2;
    }
   else
   for (ns = 0; ns < ns_to * 2; )
@@ -1289,15 +1575,20 @@ static void do_samples_finish(int *SSumLR, int ns_to,
     d = SSumLR[ns]; SSumLR[ns] = 0;
     d = d * vol_l >> 14;
     ssat32_to_16(d);
-    *spu.pS++ = d;
+    *pS++ = d;
     ns++;
 
     d = SSumLR[ns]; SSumLR[ns] = 0;
     d = d * vol_r >> 14;
     ssat32_to_16(d);
-    *spu.pS++ = d;
+    *pS++ = d;
     ns++;
    }
+
+  if (out_step)
+   resample_out(rbuf, ns_to);
+  else
+   spu.pS = pS;
 }
 
 void schedule_next_irq(void)
@@ -1314,9 +1605,6 @@ void schedule_next_irq(void)
  {
   if (spu.dwChannelDead & (1 << ch))
    continue;
-  if ((unsigned long)(spu.pSpuIrq - spu.s_chan[ch].pCurr) > IRQ_NEAR_BLOCKS * 16
-    && (unsigned long)(spu.pSpuIrq - spu.s_chan[ch].pLoop) > IRQ_NEAR_BLOCKS * 16)
-   continue;
   if (spu.s_chan[ch].sinc == 0)
    continue;
 
@@ -1344,14 +1632,22 @@ void schedule_next_irq(void)
 
 void CALLBACK SPUasync(unsigned int cycle, unsigned int flags)
 {
+ spu_trace(SPUT_ASYNC, 0, cycle, flags, NULL, 0);
  do_samples(cycle, 0);
 
  if (spu.spuCtrl & CTRL_IRQ)
   schedule_next_irq();
 
  if (flags & 1) {
+  unsigned int t0 = prof_ticks();
+  if (out_current->fill && out_current->fill() == 0)
+   spu_config.iUnderruns++;
+  if (spu_config.pFeedHook)
+   spu_config.pFeedHook(spu.pSpuBuffer,
+    (unsigned char *)spu.pS - spu.pSpuBuffer, out_rate);
   out_current->feed(spu.pSpuBuffer, (unsigned char *)spu.pS - spu.pSpuBuffer);
   spu.pS = (short *)spu.pSpuBuffer;
+  PROF_ADD(out, t0);
 
   if (spu_config.iTempo) {
    if (!out_current->busy())
@@ -1379,15 +1675,20 @@ void CALLBACK SPUupdate(void)
 
 void CALLBACK SPUplayADPCMchannel(xa_decode_t *xap, unsigned int cycle, int is_start)
 {
+ unsigned int t0;
+
  if(!xap)       return;
  if(!xap->freq) return;                // no xa freq ? bye
 
+ spu_trace(SPUT_XA, is_start, cycle, 0, xap, sizeof(*xap));
  if (is_start)
   spu.XAPlay = spu.XAFeed = spu.XAStart;
  if (spu.XAPlay == spu.XAFeed)
   do_samples(cycle, 1);                // catch up to prevent source underflows later
 
+ t0 = prof_ticks();
  FeedXA(xap);                          // call main XA feeder
+ PROF_ADD(xa, t0);
  spu.xapGlobal = xap;                  // store info for save states
  spu.cdClearSamples = 512;
 }
@@ -1395,13 +1696,18 @@ void CALLBACK SPUplayADPCMchannel(xa_decode_t *xap, unsigned int cycle, int is_s
 // CDDA AUDIO
 int CALLBACK SPUplayCDDAchannel(short *pcm, int nbytes, unsigned int cycle, int unused)
 {
+ unsigned int t0;
+
  if (!pcm)      return -1;
  if (nbytes<=0) return -1;
 
+ spu_trace(SPUT_CDDA, unused, cycle, 0, pcm, nbytes);
  if (spu.CDDAPlay == spu.CDDAFeed)
   do_samples(cycle, 1);                // catch up to prevent source underflows later
 
+ t0 = prof_ticks();
  FeedCDDA((unsigned char *)pcm, nbytes);
+ PROF_ADD(xa, t0);
  spu.cdClearSamples = 512;
  return 0;
 }
@@ -1409,6 +1715,8 @@ int CALLBACK SPUplayCDDAchannel(short *pcm, int nbytes, unsigned int cycle, int
 void CALLBACK SPUsetCDvol(unsigned char ll, unsigned char lr,
   unsigned char rl, unsigned char rr, unsigned int cycle)
 {
+ spu_trace(SPUT_CDVOL, 0, cycle, ll | (lr << 8) | (rl << 16) | (rr << 24),
+  NULL, 0);
  if (spu.XAPlay != spu.XAFeed || spu.CDDAPlay != spu.CDDAFeed)
   do_samples(cycle, 1);
  spu.cdv.ll = ll;
@@ -1467,10 +1775,33 @@ static void RemoveStreams(void)
 #include <semaphore.h>
 #include <unistd.h>
 
+// total worker threads, including the main one
+#define SPU_MAX_WORKERS 4
+// don't bother waking the helpers for just a few voices
+#define SPU_SPLIT_MIN_CHANS 8
+
+// extra workers, each renders a subset of the voices of the current
+// item into its own buffers, which the main worker then adds up
+struct spu_helper {
+ pthread_t thread;
+ sem_t sem_go;
+ unsigned int mask;
+ int ChanBuf[NSSIZE];
+ int SSumLR[NSSIZE * 2];
+ int RVB[NSSIZE * 2];
+ struct adpcm_cache cache;
+};
+
 static struct {
  pthread_t thread;
  sem_t sem_avail;
  sem_t sem_done;
+ sem_t sem_helpers_done;
+ struct work_item *work;
+ struct spu_helper *helpers;
+ int helper_cnt;
+ int workers_req; // spu_config.iThreadWorkers the helpers were made for
+ long cpus;
 } t;
 
 /* generic pthread implementation */
@@ -1494,17 +1825,112 @@ static void thread_sync_caches(void)
 {
 }
 
+static void *spu_helper_thread(void *arg)
+{
+ struct spu_helper *h = arg;
+ struct work_item *work;
+
+ if (spu_config.pThreadStart)
+  spu_config.pThreadStart(1);
+
+ while (1) {
+  sem_wait(&h->sem_go);
+  if (worker->exit_thread)
+   break;
+  twake_count(TWAKE_SPU_HELPER);
+
+  work = t.work;
+  memset(h->SSumLR, 0, work->ns_to * sizeof(h->SSumLR[0]) * 2);
+  if (work->rvb_addr)
+   memset(h->RVB, 0, work->ns_to * sizeof(h->RVB[0]) * 2);
+  do_channel_work_mask(work, h->mask, h->SSumLR, h->RVB, h->ChanBuf, &h->cache);
+
+  sem_post(&t.sem_helpers_done);
+ }
+
+ return NULL;
+}
+
+// Voices of one item are split here and joined before the next item,
+// as the voice's sample history must be processed in item order.
+static void do_channel_work_split(struct work_item *work)
+{
+ unsigned int part[SPU_MAX_WORKERS] = { 0, };
+ unsigned int mask = work->channels_on;
+ int parts = t.helper_cnt + 1;
+ int i, ch, n, cnt = 0;
+ unsigned int t0;
+
+ for (ch = 0; mask != 0; ch++, mask >>= 1) {
+  if (!(mask & 1)) continue;
+  // noise and fmod share state across voices, keep them in order here
+  if (work->ch[ch].bNoise || work->ch[ch].bFMod)
+   part[0] |= 1 << ch;
+  else
+   part[cnt % parts] |= 1 << ch;
+  cnt++;
+ }
+ if (t.helper_cnt == 0 || cnt < SPU_SPLIT_MIN_CHANS) {
+  do_channel_work(work);
+  return;
+ }
+
+ t0 = prof_ticks();
+ do_channel_work_prep(work);
+
+ // a helper without voices in this item stays parked
+ t.work = work;
+ for (i = n = 0; i < t.helper_cnt; i++) {
+  t.helpers[i].mask = part[i + 1];
+  if (part[i + 1]) {
+   sem_post(&t.helpers[i].sem_go);
+   n++;
+  }
+ }
+
+ do_channel_work_mask(work, part[0], work->SSumLR, RVB, ChanBuf,
+  &adpcm_cache_work);
+
+ for (i = 0; i < n; i++)
+  sem_wait(&t.sem_helpers_done);
+ n = work->ns_to * 2;
+ for (i = 0; i < t.helper_cnt; i++) {
+  const struct spu_helper *h = &t.helpers[i];
+  int j;
+  if (!h->mask)
+   continue;
+  for (j = 0; j < n; j++)
+   work->SSumLR[j] += h->SSumLR[j];
+  if (work->rvb_addr)
+   for (j = 0; j < n; j++)
+    RVB[j] += h->RVB[j];
+ }
+ PROF_ADD(chans, t0);
+
+ if (work->rvb_addr) {
+  t0 = prof_ticks();
+  REVERBDo(work->SSumLR, RVB, work->ns_to, work->rvb_addr);
+  PROF_ADD(reverb, t0);
+ }
+}
+
 static void *spu_worker_thread(void *unused)
 {
  struct work_item *work;
 
+ if (spu_config.pThreadStart)
+  spu_config.pThreadStart(0);
+
  while (1) {
   sem_wait(&t.sem_avail);
   if (worker->exit_thread)
    break;
+  twake_count(TWAKE_SPU);
 
   work = &worker->i[worker->i_done & WORK_I_MASK];
-  do_channel_work(work);
+  evtrace_begin(EVT_SPU_WORK, work->ns_to);
+  do_channel_work_split(work);
+  evtrace_end(EVT_SPU_WORK);
   worker->i_done++;
 
   sem_post(&t.sem_done);
@@ -1513,13 +1939,65 @@ static void *spu_worker_thread(void *unused)
  return NULL;
 }
 
+static void exit_spu_helpers(void)
+{
+ int i;
+
+ for (i = 0; i < t.helper_cnt; i++)
+  sem_post(&t.helpers[i].sem_go);
+ for (i = 0; i < t.helper_cnt; i++) {
+  pthread_join(t.helpers[i].thread, NULL);
+  sem_destroy(&t.helpers[i].sem_go);
+ }
+ if (t.helpers != NULL)
+  sem_destroy(&t.sem_helpers_done);
+ free(t.helpers);
+ t.helpers = NULL;
+ t.helper_cnt = 0;
+}
+
+// with no count requested leave a core for the emu thread and one
+// for the gpu thread
+static void init_spu_helpers(int workers)
+{
+ int i, cnt = workers > 0 ? workers : t.cpus - 2;
+
+ t.workers_req = workers;
+ if (cnt > SPU_MAX_WORKERS)
+  cnt = SPU_MAX_WORKERS;
+ cnt--; // the main worker
+ if (cnt <= 0)
+  return;
+
+ t.helpers = calloc(cnt, sizeof(t.helpers[0]));
+ if (t.helpers == NULL)
+  return;
+ if (sem_init(&t.sem_helpers_done, 0, 0) != 0) {
+  free(t.helpers);
+  t.helpers = NULL;
+  return;
+ }
+ for (i = 0; i < cnt; i++) {
+  struct spu_helper *h = &t.helpers[i];
+  if (sem_init(&h->sem_go, 0, 0) != 0)
+   break;
+  if (pthread_create(&h->thread, NULL, spu_helper_thread, h) != 0) {
+   sem_destroy(&h->sem_go);
+   break;
+  }
+  t.helper_cnt++;
+ }
+}
+
 static void init_spu_thread(void)
 {
+ long cpus;
  int ret;
 
  spu.sb_thread = spu.sb_thread_;
 
- if (sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+ cpus = sysconf(_SC_NPROCESSORS_ONLN);
+ if (cpus <= 1)
   return;
 
  worker = calloc(1, sizeof(*worker));
@@ -1532,6 +2010,9 @@ static void init_spu_thread(void)
  if (ret != 0)
   goto fail_sem_done;
 
+ t.cpus = cpus;
+ init_spu_helpers(spu_config.iThreadWorkers);
+
  ret = pthread_create(&t.thread, NULL, spu_worker_thread, NULL);
  if (ret != 0)
   goto fail_thread;
@@ -1540,6 +2021,8 @@ static void init_spu_thread(void)
  return;
 
 fail_thread:
+ worker->exit_thread = 1;
+ exit_spu_helpers();
  sem_destroy(&t.sem_done);
 fail_sem_done:
  sem_destroy(&t.sem_avail);
@@ -1549,6 +2032,17 @@ fail_sem_avail:
  spu_config.iThreadAvail = 0;
 }
 
+// the worker count can change while running, the helpers are only
+// touched by the worker thread, which is idle after a forced sync
+static void thread_set_workers(int count)
+{
+ if (count == t.workers_req)
+  return;
+ sync_worker_thread(1);
+ exit_spu_helpers();
+ init_spu_helpers(count);
+}
+
 static void exit_spu_thread(void)
 {
  if (worker == NULL)
@@ -1556,6 +2050,7 @@ static void exit_spu_thread(void)
  worker->exit_thread = 1;
  sem_post(&t.sem_avail);
  pthread_join(t.thread, NULL);
+ exit_spu_helpers();
  sem_destroy(&t.sem_done);
  sem_destroy(&t.sem_avail);
  free(worker);
@@ -1577,22 +2072,69 @@ static void exit_spu_thread(void)
 long CALLBACK SPUfreeze(unsigned int ulFreezeMode, struct SPUFreeze * pF,
  unsigned int cycles)
 {
+ int ch;
+
  if (worker != NULL)
   sync_worker_thread(1);
+ for (ch = 0; ch < MAXCHAN; ch++)
+  sync_silent_chan(ch);
  return DoFreeze(ulFreezeMode, pF, cycles);
 }
 
+#ifdef SPU_TRACE
+
+// all calls come from the emu thread
+static FILE *trace_f;
+
+void spu_trace_open(void)
+{
+ const char *path = getenv("PCSX_SPU_TRACE");
+ uint32_t hdr[2] = { SPUT_MAGIC, SPUT_VERSION };
+
+ spu_trace_close();
+ if (path == NULL || (trace_f = fopen(path, "wb")) == NULL)
+  return;
+ fwrite(hdr, 1, sizeof(hdr), trace_f);
+ printf("spu: tracing to %s\n", path);
+}
+
+void spu_trace_close(void)
+{
+ if (trace_f == NULL)
+  return;
+ fclose(trace_f);
+ trace_f = NULL;
+}
+
+void spu_trace(int type, unsigned int val, unsigned int cycles,
+ unsigned int arg, const void *data, unsigned int size)
+{
+ struct spu_trace_rec r = { type, val, cycles, arg, size };
+
+ if (trace_f == NULL)
+  return;
+ fwrite(&r, 1, sizeof(r), trace_f);
+ if (size)
+  fwrite(data, 1, size, trace_f);
+}
+
+#endif
+
 // SPUINIT: this func will be called first by the main emu
 long CALLBACK SPUinit(void)
 {
  int i;
 
+ spu_trace_open();
+
  memset(&spu, 0, sizeof(spu));
  spu.spuMemC = calloc(1, 512 * 1024 + 16);
  // a guard for runaway channels - End+Mute
  spu.spuMemC[512 * 1024 + 1] = 1;
 
- spu.s_chan = calloc(MAXCHAN+1, sizeof(spu.s_chan[0])); // channel + 1 infos (1 is security for fmod handling)
+ // channel + 1 infos (1 is security for fmod handling), cacheline aligned
+ spu.s_chan_mem = calloc(1, (MAXCHAN+1) * sizeof(spu.s_chan[0]) + 63);
+ spu.s_chan = (void *)(((uintptr_t)spu.s_chan_mem + 63) & ~(uintptr_t)63);
  spu.rvb = calloc(1, sizeof(REVERBInfo));
 
  spu.spuAddr = 0;
@@ -1627,6 +2169,12 @@ long CALLBACK SPUopen(void)
 
  SetupSound();                                         // setup sound (before init!)
 
+ out_step = 0;
+ if (out_rate != 44100)
+  out_step = (44100u << 16) / out_rate;
+ out_pos = 0;
+ out_last[0] = out_last[1] = 0;
+
  spu.bSPUIsOpen = 1;
 
  return PSE_SPU_ERR_SUCCESS;
@@ -1653,13 +2201,15 @@ long CALLBACK SPUshutdown(void)
 
  free(spu.spuMemC);
  spu.spuMemC = NULL;
- free(spu.s_chan);
+ free(spu.s_chan_mem);
+ spu.s_chan_mem = NULL;
  spu.s_chan = NULL;
  free(spu.rvb);
  spu.rvb = NULL;
 
  RemoveStreams();                                      // no more streaming
  spu.bSpuInit=0;
+ spu_trace_close();
 
  return 0;
 }
@@ -1734,4 +2284,16 @@ void spu_get_debug_info(int *chans_out, int *run_chans, int *fmod_chans_out, int
  (void)SkipADSR;
 }
 
+// returns the times accumulated since the last call and resets them,
+// the first call only turns profiling on
+void spu_get_prof_info(struct spu_prof *p)
+{
+ prof_on = 1;
+ *p = prof;
+ p->out_fill = -1;
+ if (out_current != NULL && out_current->fill != NULL)
+  p->out_fill = out_current->fill();
+ memset(&prof, 0, sizeof(prof));
+}
+
 // vim:shiftwidth=1:expandtab
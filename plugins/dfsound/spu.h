@@ -44,4 +44,15 @@ void CALLBACK SPUsetCDvol(unsigned char ll, unsigned char lr,
 void ClearWorkingState(void);
 long DoFreeze(unsigned int, struct SPUFreeze *, unsigned int);
 
+// debug, times in microseconds
+struct spu_prof {
+	unsigned int chans;  // voice decode, interpolation, envelope, mixing
+	unsigned int reverb;
+	unsigned int xa;     // xa and cdda feeding
+	unsigned int out;    // output driver feed
+	unsigned int wait;   // waiting for the worker thread
+	int out_fill;        // bytes buffered by the driver, -1 if unknown
+};
+void spu_get_prof_info(struct spu_prof *p);
+
 #endif /* __P_SPU_H__ */
@@ -185,6 +185,11 @@ static void thread_work_wait_sync(struct work_item *work, int force)
  }
 }
 
+static void thread_set_workers(int count)
+{
+ // the dsp is a single worker
+}
+
 static void thread_sync_caches(void)
 {
  if (f.stale_caches) {
@@ -283,7 +288,8 @@ static void init_spu_thread(void)
  free(spu.spuMemC);
  spu.spuMemC = mem->spu_ram;
  spu.sb_thread = mem->sb_thread;
- free(spu.s_chan);
+ free(spu.s_chan_mem);
+ spu.s_chan_mem = NULL;
  spu.s_chan = mem->in.s_chan;
  free(spu.rvb);
  spu.rvb = &mem->in.rvb;
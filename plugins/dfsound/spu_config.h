@@ -11,9 +11,18 @@ typedef struct
  int        iUseInterpolation;
  int        iTempo;
  int        iUseThread;
+ int        iThreadWorkers; // threads sharing the voices, 0 picks by core count
+ int        iNoOutput;     // force the "none" driver
+ int        iOutRate;      // output rate in Hz, 0 for the native 44100
 
  // status
  int        iThreadAvail;
+ unsigned int iUnderruns;  // feeds that found the driver's queue empty
+
+ // frontend hook, run first on the worker (helper = 0) and helper threads
+ void     (*pThreadStart)(int helper);
+ // frontend hook, sees everything fed to the sound driver (s16 stereo)
+ void     (*pFeedHook)(const void *data, int bytes, int rate);
 } SPUConfig;
 
 extern SPUConfig spu_config;
@@ -0,0 +1,52 @@
+#ifndef __P_SPU_TRACE_H__
+#define __P_SPU_TRACE_H__
+
+/*
+ * Records everything the emu feeds the spu (register and dma traffic,
+ * cd audio, state loads, async calls) to $PCSX_SPU_TRACE when built with
+ * -DSPU_TRACE, for tools/spubench to replay. Recording starts at SPUinit
+ * with the zeroed spu, so mid-game starts come in as a SPUT_LOAD.
+ */
+
+#include <stdint.h>
+
+#define SPUT_MAGIC	0x54555053 // "SPUT"
+#define SPUT_VERSION	1
+
+enum {
+ SPUT_WREG = 1,	// arg reg, val
+ SPUT_RREG,	// arg reg
+ SPUT_DMA_W,	// data
+ SPUT_DMA_R,	// arg halfwords
+ SPUT_ASYNC,	// arg flags
+ SPUT_XA,	// data xa_decode_t, val is_start
+ SPUT_CDDA,	// data pcm, val is_start
+ SPUT_CDVOL,	// arg ll | lr << 8 | rl << 16 | rr << 24
+ SPUT_LOAD,	// data freeze blob
+};
+
+// followed by size bytes of data
+struct spu_trace_rec {
+ uint16_t type, val;
+ uint32_t cycles;
+ uint32_t arg;
+ uint32_t size;
+};
+
+#ifdef SPU_TRACE
+
+void spu_trace_open(void);
+void spu_trace_close(void);
+void spu_trace(int type, unsigned int val, unsigned int cycles,
+ unsigned int arg, const void *data, unsigned int size);
+
+#else
+
+static inline void spu_trace_open(void) {}
+static inline void spu_trace_close(void) {}
+static inline void spu_trace(int type, unsigned int val, unsigned int cycles,
+ unsigned int arg, const void *data, unsigned int size) {}
+
+#endif
+
+#endif /* __P_SPU_TRACE_H__ */
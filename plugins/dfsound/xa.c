@@ -190,7 +190,7 @@ static unsigned long timeGetTime_spu()
 
 void FeedXA(const xa_decode_t *xap)
 {
- int sinc,spos,i,iSize,iPlace,vl,vr;
+ int sinc,spos,i,iSize,iPlace,vl,vr,full;
 
  if(!spu.bSPUIsOpen) return;
 
@@ -252,6 +252,10 @@ void FeedXA(const xa_decode_t *xap)
  spos=0x10000L;
  sinc = (xap->nsamples << 16) / iSize;                 // calc freq by num / size
 
+ // limit to the free space once instead of checking it for every sample
+ full = iSize >= iPlace;
+ if(full) iSize = iPlace;
+
  if(xap->stereo)
 {
    uint32_t * pS=(uint32_t *)xap->pcm;
@@ -318,49 +322,47 @@ void FeedXA(const xa_decode_t *xap)
     }
    else
 #endif
+   if(spu_config.iUseInterpolation==2)
     {
      for(i=0;i<iSize;i++)
       {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           gauss_window[gauss_ptr] = (short)LOWORD(l);
-           gauss_window[4+gauss_ptr] = (short)HIWORD(l);
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0) >> 15;
-         vr+=(gauss[vl+1]*gvall(1)) >> 15;
-         vr+=(gauss[vl+2]*gvall(2)) >> 15;
-         vr+=(gauss[vl+3]*gvall(3)) >> 15;
-         l= vr & 0xffff;
-         vr=(gauss[vl]*gvalr0) >> 15;
-         vr+=(gauss[vl+1]*gvalr(1)) >> 15;
-         vr+=(gauss[vl+2]*gvalr(2)) >> 15;
-         vr+=(gauss[vl+3]*gvalr(3)) >> 15;
-         l |= vr << 16;
-        }
-       else
+       while(spos>=0x10000L)
         {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           spos -= 0x10000L;
-          }
+         l = *pS++;
+         gauss_window[gauss_ptr] = (short)LOWORD(l);
+         gauss_window[4+gauss_ptr] = (short)HIWORD(l);
+         gauss_ptr = (gauss_ptr+1) & 3;
+         spos -= 0x10000L;
         }
+       vl = (spos >> 6) & ~3;
+       vr=(gauss[vl]*gvall0) >> 15;
+       vr+=(gauss[vl+1]*gvall(1)) >> 15;
+       vr+=(gauss[vl+2]*gvall(2)) >> 15;
+       vr+=(gauss[vl+3]*gvall(3)) >> 15;
+       l= vr & 0xffff;
+       vr=(gauss[vl]*gvalr0) >> 15;
+       vr+=(gauss[vl+1]*gvalr(1)) >> 15;
+       vr+=(gauss[vl+2]*gvalr(2)) >> 15;
+       vr+=(gauss[vl+3]*gvalr(3)) >> 15;
+       l |= vr << 16;
 
        *spu.XAFeed++=l;
-
        if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
+       spos += sinc;
+      }
+    }
+   else
+    {
+     for(i=0;i<iSize;i++)
+      {
+       while(spos>=0x10000L)
         {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
+         l = *pS++;
+         spos -= 0x10000L;
         }
 
+       *spu.XAFeed++=l;
+       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
        spos += sinc;
       }
     }
@@ -419,48 +421,48 @@ void FeedXA(const xa_decode_t *xap)
     }
    else
 #endif
+   if(spu_config.iUseInterpolation==2)
     {
      for(i=0;i<iSize;i++)
       {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           gauss_window[gauss_ptr] = (short)*pS++;
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0) >> 15;
-         vr+=(gauss[vl+1]*gvall(1)) >> 15;
-         vr+=(gauss[vl+2]*gvall(2)) >> 15;
-         vr+=(gauss[vl+3]*gvall(3)) >> 15;
-         l=s= vr;
-        }
-       else
+       while(spos>=0x10000L)
         {
-         while(spos>=0x10000L)
-          {
-           s = *pS++;
-           spos -= 0x10000L;
-          }
-         l=s;
+         gauss_window[gauss_ptr] = (short)*pS++;
+         gauss_ptr = (gauss_ptr+1) & 3;
+         spos -= 0x10000L;
         }
+       vl = (spos >> 6) & ~3;
+       vr=(gauss[vl]*gvall0) >> 15;
+       vr+=(gauss[vl+1]*gvall(1)) >> 15;
+       vr+=(gauss[vl+2]*gvall(2)) >> 15;
+       vr+=(gauss[vl+3]*gvall(3)) >> 15;
+       l = vr & 0xffff;
 
-       l &= 0xffff;
        *spu.XAFeed++=(l|(l<<16));
-
        if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
+       spos += sinc;
+      }
+    }
+   else
+    {
+     for(i=0;i<iSize;i++)
+      {
+       while(spos>=0x10000L)
         {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
+         s = *pS++;
+         spos -= 0x10000L;
         }
 
+       l = s & 0xffff;
+       *spu.XAFeed++=(l|(l<<16));
+       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
        spos += sinc;
       }
     }
   }
+
+ // ran into the play position? (same as the old per-sample check did)
+ if(full && spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
 }
 
 ////////////////////////////////////////////////////////////////////////
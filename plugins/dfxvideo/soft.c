@@ -56,6 +56,35 @@
 
 #define XPSXCOL(r,g,b) ((g&0x7c00)|(b&0x3e0)|(r&0x1f))
 
+// blending/mask check/dither state: the per pixel funcs take it as an
+// argument, so the hot drivers below can be compiled once for each state
+// and have all the per pixel checks of those globals folded away
+
+#define ST_ABR(st)    ((st)&3)
+#define ST_SEMI(st)   ((st)&4)
+#define ST_MASK(st)   ((st)&8)
+#define ST_DITHER(st) ((st)&16)
+
+#define SOFT_INLINE   static inline __attribute__((always_inline))
+#define SOFT_NOINLINE static __attribute__((__noinline__))
+
+// pick the copy of 'call' made for the current state, once per primitive;
+// 'call' gets the state as ST. Mask checking is rare, so it only gets the
+// one copy that looks at the state at runtime.
+#define SOFT_ST_CASE(s,call) case s: { enum { ST = s }; call; } break;
+#define SOFT_ST_CASES(d,call) \
+ SOFT_ST_CASE(d|0,call) SOFT_ST_CASE(d|4,call) SOFT_ST_CASE(d|5,call) \
+ SOFT_ST_CASE(d|6,call) SOFT_ST_CASE(d|7,call)
+
+#define SOFT_SPECIALIZE(call) { \
+ const int st_=soft_state(0); \
+ switch(st_) { SOFT_ST_CASES(0,call) \
+  default: { const int ST=st_; call; } break; } }
+#define SOFT_SPECIALIZE_D(dither,call) { \
+ const int st_=soft_state(dither); \
+ switch(st_) { SOFT_ST_CASES(0,call) SOFT_ST_CASES(16,call) \
+  default: { const int ST=st_; call; } break; } }
+
 // soft globals
 short g_m1=255,g_m2=255,g_m3=255;
 short DrawSemiTrans=FALSE;
@@ -65,6 +94,12 @@ short          ly0,lx0,ly1,lx1,ly2,lx2,ly3,lx3;        // global psx vertex coor
 int32_t           GlobalTextAddrX,GlobalTextAddrY,GlobalTextTP;
 int32_t           GlobalTextABR,GlobalTextPAGE;
 
+static inline int soft_state(int dither)
+{
+ return (DrawSemiTrans ? 4|GlobalTextABR : 0) | (bCheckMask ? 8 : 0) |
+        (dither ? 16 : 0);
+}
+
 ////////////////////////////////////////////////////////////////////////
 // POLYGON OFFSET FUNCS
 ////////////////////////////////////////////////////////////////////////
@@ -145,33 +180,33 @@ static inline void Dither16(unsigned short * pdest,uint32_t r,uint32_t g,uint32_
 /////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////
 
-static inline void GetShadeTransCol_Dither(unsigned short * pdest, int32_t m1, int32_t m2, int32_t m3)
+SOFT_INLINE void GetShadeTransCol_Dither(unsigned short * pdest, int32_t m1, int32_t m2, int32_t m3,int st)
 {
  int32_t r,g,b;
 
- if(bCheckMask && (*pdest & HOST2LE16(0x8000))) return;
+ if(ST_MASK(st) && (*pdest & HOST2LE16(0x8000))) return;
 
- if(DrawSemiTrans)
+ if(ST_SEMI(st))
   {
    r=((XCOL1D(GETLE16(pdest)))<<3);
    b=((XCOL2D(GETLE16(pdest)))<<3);
    g=((XCOL3D(GETLE16(pdest)))<<3);
 
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      r=(r>>1)+(m1>>1);
      b=(b>>1)+(m2>>1);
      g=(g>>1)+(m3>>1);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r+=m1;
      b+=m2;
      g+=m3;
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r-=m1;
      b-=m2;
@@ -209,28 +244,28 @@ static inline void GetShadeTransCol_Dither(unsigned short * pdest, int32_t m1, i
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetShadeTransCol(unsigned short * pdest,unsigned short color)
+SOFT_INLINE void GetShadeTransCol(unsigned short * pdest,unsigned short color,int st)
 {
- if(bCheckMask && (*pdest & HOST2LE16(0x8000))) return;
+ if(ST_MASK(st) && (*pdest & HOST2LE16(0x8000))) return;
 
- if(DrawSemiTrans)
+ if(ST_SEMI(st))
   {
    int32_t r,g,b;
  
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      PUTLE16(pdest, (((GETLE16(pdest)&0x7bde)>>1)+(((color)&0x7bde)>>1))|sSetMask);//0x8000;
      return;
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(XCOL1(GETLE16(pdest)))+((XCOL1(color)));
      b=(XCOL2(GETLE16(pdest)))+((XCOL2(color)));
      g=(XCOL3(GETLE16(pdest)))+((XCOL3(color)));
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r=(XCOL1(GETLE16(pdest)))-((XCOL1(color)));
      b=(XCOL2(GETLE16(pdest)))-((XCOL2(color)));
@@ -263,15 +298,15 @@ static inline void GetShadeTransCol(unsigned short * pdest,unsigned short color)
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetShadeTransCol32(uint32_t * pdest,uint32_t color)
+SOFT_INLINE void GetShadeTransCol32(uint32_t * pdest,uint32_t color,int st)
 {
- if(DrawSemiTrans)
+ if(ST_SEMI(st))
   {
    int32_t r,g,b;
  
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
-     if(!bCheckMask)
+     if(!ST_MASK(st))
       {
        PUTLE32(pdest, (((GETLE32(pdest)&0x7bde7bde)>>1)+(((color)&0x7bde7bde)>>1))|lSetMask);//0x80008000;
        return;
@@ -281,14 +316,14 @@ static inline void GetShadeTransCol32(uint32_t * pdest,uint32_t color)
      g=(X32ACOL3(GETLE32(pdest))>>1)+((X32ACOL3(color))>>1);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(X32COL1(GETLE32(pdest)))+((X32COL1(color)));
      b=(X32COL2(GETLE32(pdest)))+((X32COL2(color)));
      g=(X32COL3(GETLE32(pdest)))+((X32COL3(color)));
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      int32_t sr,sb,sg,src,sbc,sgc,c;
      src=XCOL1(color);sbc=XCOL2(color);sgc=XCOL3(color);
@@ -323,7 +358,7 @@ static inline void GetShadeTransCol32(uint32_t * pdest,uint32_t color)
    if(g&0x7FE00000) g=0x1f0000|(g&0xFFFF);
    if(g&0x7FE0)     g=0x1f    |(g&0xFFFF0000);
 
-   if(bCheckMask) 
+   if(ST_MASK(st)) 
     {
      uint32_t ma=GETLE32(pdest);
      PUTLE32(pdest, (X32PSXCOL(r,g,b))|lSetMask);//0x80008000;
@@ -335,7 +370,7 @@ static inline void GetShadeTransCol32(uint32_t * pdest,uint32_t color)
   }
  else 
   {
-   if(bCheckMask) 
+   if(ST_MASK(st)) 
     {
      uint32_t ma=GETLE32(pdest);
      PUTLE32(pdest, color|lSetMask);//0x80008000;
@@ -350,19 +385,19 @@ static inline void GetShadeTransCol32(uint32_t * pdest,uint32_t color)
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColG(unsigned short * pdest,unsigned short color)
+SOFT_INLINE void GetTextureTransColG(unsigned short * pdest,unsigned short color,int st)
 {
  int32_t r,g,b;unsigned short l;
 
  if(color==0) return;
 
- if(bCheckMask && (*pdest & HOST2LE16(0x8000))) return;
+ if(ST_MASK(st) && (*pdest & HOST2LE16(0x8000))) return;
 
  l=sSetMask|(color&0x8000);
 
- if(DrawSemiTrans && (color&0x8000))
+ if(ST_SEMI(st) && (color&0x8000))
   {
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      unsigned short d;
      d     =(GETLE16(pdest)&0x7bde)>>1;
@@ -372,14 +407,14 @@ static inline void GetTextureTransColG(unsigned short * pdest,unsigned short col
      g=(XCOL3(d))+((((XCOL3(color)))* g_m3)>>7);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(XCOL1(GETLE16(pdest)))+((((XCOL1(color)))* g_m1)>>7);
      b=(XCOL2(GETLE16(pdest)))+((((XCOL2(color)))* g_m2)>>7);
      g=(XCOL3(GETLE16(pdest)))+((((XCOL3(color)))* g_m3)>>7);
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r=(XCOL1(GETLE16(pdest)))-((((XCOL1(color)))* g_m1)>>7);
      b=(XCOL2(GETLE16(pdest)))-((((XCOL2(color)))* g_m2)>>7);
@@ -438,19 +473,19 @@ static inline void GetTextureTransColG_S(unsigned short * pdest,unsigned short c
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColG_SPR(unsigned short * pdest,unsigned short color)
+SOFT_INLINE void GetTextureTransColG_SPR(unsigned short * pdest,unsigned short color,int st)
 {
  int32_t r,g,b;unsigned short l;
 
  if(color==0) return;
 
- if(bCheckMask && (GETLE16(pdest) & 0x8000)) return;
+ if(ST_MASK(st) && (GETLE16(pdest) & 0x8000)) return;
 
  l=sSetMask|(color&0x8000);
 
- if(DrawSemiTrans && (color&0x8000))
+ if(ST_SEMI(st) && (color&0x8000))
   {
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      unsigned short d;
      d     =(GETLE16(pdest)&0x7bde)>>1;
@@ -460,14 +495,14 @@ static inline void GetTextureTransColG_SPR(unsigned short * pdest,unsigned short
      g=(XCOL3(d))+((((XCOL3(color)))* g_m3)>>7);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(XCOL1(GETLE16(pdest)))+((((XCOL1(color)))* g_m1)>>7);
      b=(XCOL2(GETLE16(pdest)))+((((XCOL2(color)))* g_m2)>>7);
      g=(XCOL3(GETLE16(pdest)))+((((XCOL3(color)))* g_m3)>>7);
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r=(XCOL1(GETLE16(pdest)))-((((XCOL1(color)))* g_m1)>>7);
      b=(XCOL2(GETLE16(pdest)))-((((XCOL2(color)))* g_m2)>>7);
@@ -505,7 +540,7 @@ static inline void GetTextureTransColG_SPR(unsigned short * pdest,unsigned short
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColG32(uint32_t * pdest,uint32_t color)
+SOFT_INLINE void GetTextureTransColG32(uint32_t * pdest,uint32_t color,int st)
 {
  int32_t r,g,b,l;
 
@@ -513,23 +548,23 @@ static inline void GetTextureTransColG32(uint32_t * pdest,uint32_t color)
 
  l=lSetMask|(color&0x80008000);
 
- if(DrawSemiTrans && (color&0x80008000))
+ if(ST_SEMI(st) && (color&0x80008000))
   {
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {                 
      r=((((X32TCOL1(GETLE32(pdest)))+((X32COL1(color)) * g_m1))&0xFF00FF00)>>8);
      b=((((X32TCOL2(GETLE32(pdest)))+((X32COL2(color)) * g_m2))&0xFF00FF00)>>8);
      g=((((X32TCOL3(GETLE32(pdest)))+((X32COL3(color)) * g_m3))&0xFF00FF00)>>8);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(X32COL1(GETLE32(pdest)))+(((((X32COL1(color)))* g_m1)&0xFF80FF80)>>7);
      b=(X32COL2(GETLE32(pdest)))+(((((X32COL2(color)))* g_m2)&0xFF80FF80)>>7);
      g=(X32COL3(GETLE32(pdest)))+(((((X32COL3(color)))* g_m3)&0xFF80FF80)>>7);
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      int32_t t;
      r=(((((X32COL1(color)))* g_m1)&0xFF80FF80)>>7);
@@ -588,7 +623,7 @@ static inline void GetTextureTransColG32(uint32_t * pdest,uint32_t color)
  if(g&0x7FE00000) g=0x1f0000|(g&0xFFFF);
  if(g&0x7FE0)     g=0x1f    |(g&0xFFFF0000);
          
- if(bCheckMask) 
+ if(ST_MASK(st)) 
   {
    uint32_t ma=GETLE32(pdest);
 
@@ -634,29 +669,29 @@ static inline void GetTextureTransColG32_S(uint32_t * pdest,uint32_t color)
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColG32_SPR(uint32_t * pdest,uint32_t color)
+SOFT_INLINE void GetTextureTransColG32_SPR(uint32_t * pdest,uint32_t color,int st)
 {
  int32_t r,g,b;
 
  if(color==0) return;
 
- if(DrawSemiTrans && (color&0x80008000))
+ if(ST_SEMI(st) && (color&0x80008000))
   {
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {                 
      r=((((X32TCOL1(GETLE32(pdest)))+((X32COL1(color)) * g_m1))&0xFF00FF00)>>8);
      b=((((X32TCOL2(GETLE32(pdest)))+((X32COL2(color)) * g_m2))&0xFF00FF00)>>8);
      g=((((X32TCOL3(GETLE32(pdest)))+((X32COL3(color)) * g_m3))&0xFF00FF00)>>8);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(X32COL1(GETLE32(pdest)))+(((((X32COL1(color)))* g_m1)&0xFF80FF80)>>7);
      b=(X32COL2(GETLE32(pdest)))+(((((X32COL2(color)))* g_m2)&0xFF80FF80)>>7);
      g=(X32COL3(GETLE32(pdest)))+(((((X32COL3(color)))* g_m3)&0xFF80FF80)>>7);
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      int32_t t;
      r=(((((X32COL1(color)))* g_m1)&0xFF80FF80)>>7);
@@ -715,7 +750,7 @@ static inline void GetTextureTransColG32_SPR(uint32_t * pdest,uint32_t color)
  if(g&0x7FE00000) g=0x1f0000|(g&0xFFFF);
  if(g&0x7FE0)     g=0x1f    |(g&0xFFFF0000);
          
- if(bCheckMask) 
+ if(ST_MASK(st)) 
   {
    uint32_t ma=GETLE32(pdest);
 
@@ -736,39 +771,39 @@ static inline void GetTextureTransColG32_SPR(uint32_t * pdest,uint32_t color)
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColGX_Dither(unsigned short * pdest,unsigned short color,int32_t m1,int32_t m2,int32_t m3)
+SOFT_INLINE void GetTextureTransColGX_Dither(unsigned short * pdest,unsigned short color,int32_t m1,int32_t m2,int32_t m3,int st)
 {
  int32_t r,g,b;
 
  if(color==0) return;
  
- if(bCheckMask && (*pdest & HOST2LE16(0x8000))) return;
+ if(ST_MASK(st) && (*pdest & HOST2LE16(0x8000))) return;
 
  m1=(((XCOL1D(color)))*m1)>>4;
  m2=(((XCOL2D(color)))*m2)>>4;
  m3=(((XCOL3D(color)))*m3)>>4;
 
- if(DrawSemiTrans && (color&0x8000))
+ if(ST_SEMI(st) && (color&0x8000))
   {
    r=((XCOL1D(GETLE16(pdest)))<<3);
    b=((XCOL2D(GETLE16(pdest)))<<3);
    g=((XCOL3D(GETLE16(pdest)))<<3);
 
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      r=(r>>1)+(m1>>1);
      b=(b>>1)+(m2>>1);
      g=(g>>1)+(m3>>1);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r+=m1;
      b+=m2;
      g+=m3;
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r-=m1;
      b-=m2;
@@ -807,19 +842,19 @@ static inline void GetTextureTransColGX_Dither(unsigned short * pdest,unsigned s
 
 ////////////////////////////////////////////////////////////////////////
 
-static inline void GetTextureTransColGX(unsigned short * pdest,unsigned short color,short m1,short m2,short m3)
+SOFT_INLINE void GetTextureTransColGX(unsigned short * pdest,unsigned short color,short m1,short m2,short m3,int st)
 {
  int32_t r,g,b;unsigned short l;
 
  if(color==0) return;
  
- if(bCheckMask && (*pdest & HOST2LE16(0x8000))) return;
+ if(ST_MASK(st) && (*pdest & HOST2LE16(0x8000))) return;
 
  l=sSetMask|(color&0x8000);
 
- if(DrawSemiTrans && (color&0x8000))
+ if(ST_SEMI(st) && (color&0x8000))
   {
-   if(GlobalTextABR==0)
+   if(ST_ABR(st)==0)
     {
      unsigned short d;
      d     =(GETLE16(pdest)&0x7bde)>>1;
@@ -829,14 +864,14 @@ static inline void GetTextureTransColGX(unsigned short * pdest,unsigned short co
      g=(XCOL3(d))+((((XCOL3(color)))* m3)>>7);
     }
    else
-   if(GlobalTextABR==1)
+   if(ST_ABR(st)==1)
     {
      r=(XCOL1(GETLE16(pdest)))+((((XCOL1(color)))* m1)>>7);
      b=(XCOL2(GETLE16(pdest)))+((((XCOL2(color)))* m2)>>7);
      g=(XCOL3(GETLE16(pdest)))+((((XCOL3(color)))* m3)>>7);
     }
    else
-   if(GlobalTextABR==2)
+   if(ST_ABR(st)==2)
     {
      r=(XCOL1(GETLE16(pdest)))-((((XCOL1(color)))* m1)>>7);
      b=(XCOL2(GETLE16(pdest)))-((((XCOL2(color)))* m2)>>7);
@@ -923,6 +958,7 @@ static inline void GetTextureTransColGX32_S(uint32_t * pdest,uint32_t color,shor
 static void FillSoftwareAreaTrans(short x0,short y0,short x1, // FILL AREA TRANS
                       short y1,unsigned short col)
 {
+ int st=soft_state(0);
  short j,i,dx,dy;
 
  if(y0>y1) return;
@@ -963,7 +999,7 @@ static void FillSoftwareAreaTrans(short x0,short y0,short x1, // FILL AREA TRANS
    for(i=0;i<dy;i++)
     {
      for(j=0;j<dx;j++)
-      GetShadeTransCol(DSTPtr++,col);
+      GetShadeTransCol(DSTPtr++,col,st);
      DSTPtr += LineOffset;
     } 
   }
@@ -990,7 +1026,7 @@ static void FillSoftwareAreaTrans(short x0,short y0,short x1, // FILL AREA TRANS
      for(i=0;i<dy;i++)
       {
        for(j=0;j<dx;j++) 
-        GetShadeTransCol32(DSTPtr++,lcol);
+        GetShadeTransCol32(DSTPtr++,lcol,st);
        DSTPtr += LineOffset;
       } 
     }
@@ -2376,7 +2412,7 @@ static inline BOOL SetupSections_GT4(short x1, short y1, short x2, short y2, sho
 // POLY 3/4 FLAT SHADED
 ////////////////////////////////////////////////////////////////////////
 
-static inline void drawPoly3Fi(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb)
+SOFT_INLINE void drawPoly3Fi_st(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  unsigned short color;uint32_t lcolor;
@@ -2400,7 +2436,7 @@ static inline void drawPoly3Fi(short x1,short y1,short x2,short y2,short x3,shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    lcolor = HOST2LE32(lcolor);
    for (i=ymin;i<=ymax;i++)
@@ -2428,15 +2464,20 @@ static inline void drawPoly3Fi(short x1,short y1,short x2,short y2,short x3,shor
 
    for(j=xmin;j<xmax;j+=2) 
     {
-     GetShadeTransCol32((uint32_t *)&psxVuw[(i<<10)+j],lcolor);
+     GetShadeTransCol32((uint32_t *)&psxVuw[(i<<10)+j],lcolor,st);
     }
    if(j==xmax)
-    GetShadeTransCol(&psxVuw[(i<<10)+j],color);
+    GetShadeTransCol(&psxVuw[(i<<10)+j],color,st);
 
    if(NextRow_F()) return;
   }
 }
 
+SOFT_NOINLINE void drawPoly3Fi(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb)
+{
+ SOFT_SPECIALIZE(drawPoly3Fi_st(x1,y1,x2,y2,x3,y3,rgb,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3F(int32_t rgb)
@@ -2456,7 +2497,7 @@ static void drawPoly4F_TRI(int32_t rgb)
 
 // more exact:
 
-static void drawPoly4F(int32_t rgb)
+SOFT_INLINE void drawPoly4F_st(int32_t rgb,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  unsigned short color;uint32_t lcolor;
@@ -2480,7 +2521,7 @@ static void drawPoly4F(int32_t rgb)
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    lcolor = HOST2LE32(lcolor);
    for (i=ymin;i<=ymax;i++)
@@ -2508,19 +2549,24 @@ static void drawPoly4F(int32_t rgb)
 
    for(j=xmin;j<xmax;j+=2) 
     {
-     GetShadeTransCol32((uint32_t *)&psxVuw[(i<<10)+j],lcolor);
+     GetShadeTransCol32((uint32_t *)&psxVuw[(i<<10)+j],lcolor,st);
     }
-   if(j==xmax) GetShadeTransCol(&psxVuw[(i<<10)+j],color);
+   if(j==xmax) GetShadeTransCol(&psxVuw[(i<<10)+j],color,st);
 
    if(NextRow_F4()) return;
   }
 }
 
+SOFT_NOINLINE void drawPoly4F(int32_t rgb)
+{
+ SOFT_SPECIALIZE(drawPoly4F_st(rgb,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 // POLY 3/4 F-SHADED TEX PAL 4
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
+SOFT_INLINE void drawPoly3TEx4_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
@@ -2551,7 +2597,7 @@ static void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -2629,7 +2675,7 @@ static void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, shor
 
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
            GETLE16(&psxVuw[clutP+tC1])|
-           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
 
        posX+=difX2;
        posY+=difY2;
@@ -2640,7 +2686,7 @@ static void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, shor
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+
                     (XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT()) 
@@ -2650,10 +2696,16 @@ static void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, shor
   }
 }
 
+SOFT_NOINLINE void drawPoly3TEx4(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
+{
+ SOFT_SPECIALIZE(drawPoly3TEx4_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,clX,clY,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TEx4_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
  int32_t posX,posY,YAdjust,XAdjust;
@@ -2766,7 +2818,7 @@ static void drawPoly3TEx4_TW(short x1, short y1, short x2, short y2, short x3, s
 
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
            GETLE16(&psxVuw[clutP+tC1])|
-           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
 
        posX+=difX2;
        posY+=difY2;
@@ -2777,7 +2829,7 @@ static void drawPoly3TEx4_TW(short x1, short y1, short x2, short y2, short x3, s
        tC1 = psxVub[(((posY>>16)&TWin.ymask)<<11)+
                     YAdjust+(XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT()) 
@@ -2805,7 +2857,7 @@ static void drawPoly4TEx4_TRI(short x1, short y1, short x2, short y2, short x3,
 
 // more exact:
 
-static void drawPoly4TEx4(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
+SOFT_INLINE void drawPoly4TEx4_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -2833,7 +2885,7 @@ static void drawPoly4TEx4(short x1, short y1, short x2, short y2, short x3, shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -2922,7 +2974,7 @@ static void drawPoly4TEx4(short x1, short y1, short x2, short y2, short x3, shor
 
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -2932,17 +2984,23 @@ static void drawPoly4TEx4(short x1, short y1, short x2, short y2, short x3, shor
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+
                     (XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
   }
 }
 
+SOFT_NOINLINE void drawPoly4TEx4(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
+{
+ SOFT_SPECIALIZE(drawPoly4TEx4_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,clX,clY,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TEx4_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -3060,7 +3118,7 @@ static void drawPoly4TEx4_TW(short x1, short y1, short x2, short y2, short x3, s
 
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3070,7 +3128,7 @@ static void drawPoly4TEx4_TW(short x1, short y1, short x2, short y2, short x3, s
        tC1 = psxVub[(((posY>>16)&TWin.ymask)<<11)+
                     YAdjust+(XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
@@ -3081,6 +3139,7 @@ static void drawPoly4TEx4_TW(short x1, short y1, short x2, short y2, short x3, s
 
 static void drawPoly4TEx4_TW_S(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -3198,7 +3257,7 @@ static void drawPoly4TEx4_TW_S(short x1, short y1, short x2, short y2, short x3,
 
        GetTextureTransColG32_SPR((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3208,7 +3267,7 @@ static void drawPoly4TEx4_TW_S(short x1, short y1, short x2, short y2, short x3,
        tC1 = psxVub[(((posY>>16)&TWin.ymask)<<11)+
                     YAdjust+(XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       GetTextureTransColG_SPR(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG_SPR(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
@@ -3218,7 +3277,7 @@ static void drawPoly4TEx4_TW_S(short x1, short y1, short x2, short y2, short x3,
 // POLY 3 F-SHADED TEX PAL 8
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
+SOFT_INLINE void drawPoly3TEx8_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
@@ -3248,7 +3307,7 @@ static void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -3313,7 +3372,7 @@ static void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, shor
                     ((posX+difX)>>16)];
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
            GETLE16(&psxVuw[clutP+tC1])|
-           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3321,7 +3380,7 @@ static void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, shor
      if(j==xmax)
       {
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+(posX>>16)];
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
 
     }
@@ -3332,10 +3391,16 @@ static void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, shor
   }
 }
 
+SOFT_NOINLINE void drawPoly3TEx8(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
+{
+ SOFT_SPECIALIZE(drawPoly3TEx8_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,clX,clY,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TEx8_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,short clX, short clY)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
  int32_t posX,posY,YAdjust,clutP;
@@ -3435,7 +3500,7 @@ static void drawPoly3TEx8_TW(short x1, short y1, short x2, short y2, short x3, s
                     YAdjust+(((posX+difX)>>16)&TWin.xmask)];
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
            GETLE16(&psxVuw[clutP+tC1])|
-           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+           ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3444,7 +3509,7 @@ static void drawPoly3TEx8_TW(short x1, short y1, short x2, short y2, short x3, s
       {
        tC1 = psxVub[(((posY>>16)&TWin.ymask)<<11)+
                     YAdjust+((posX>>16)&TWin.xmask)];
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
 
     }
@@ -3474,7 +3539,7 @@ static void drawPoly4TEx8_TRI(short x1, short y1, short x2, short y2, short x3,
 
 // more exact:
 
-static void drawPoly4TEx8(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
+SOFT_INLINE void drawPoly4TEx8_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -3502,7 +3567,7 @@ static void drawPoly4TEx8(short x1, short y1, short x2, short y2, short x3, shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -3577,24 +3642,30 @@ static void drawPoly4TEx8(short x1, short y1, short x2, short y2, short x3, shor
                      ((posX+difX)>>16)];
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
      if(j==xmax)
       {
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+(posX>>16)];
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
   }
 }
 
+SOFT_NOINLINE void drawPoly4TEx8(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
+{
+ SOFT_SPECIALIZE(drawPoly4TEx8_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,clX,clY,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TEx8_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -3701,7 +3772,7 @@ static void drawPoly4TEx8_TW(short x1, short y1, short x2, short y2, short x3, s
                      YAdjust+(((posX+difX)>>16)&TWin.xmask)];
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3709,7 +3780,7 @@ static void drawPoly4TEx8_TW(short x1, short y1, short x2, short y2, short x3, s
       {
        tC1 = psxVub[((((posY+difY)>>16)&TWin.ymask)<<11)+
                     YAdjust+((posX>>16)&TWin.xmask)];
-       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
@@ -3720,6 +3791,7 @@ static void drawPoly4TEx8_TW(short x1, short y1, short x2, short y2, short x3, s
 
 static void drawPoly4TEx8_TW_S(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,short clX, short clY)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -3826,7 +3898,7 @@ static void drawPoly4TEx8_TW_S(short x1, short y1, short x2, short y2, short x3,
                      YAdjust+(((posX+difX)>>16)&TWin.xmask)];
        GetTextureTransColG32_SPR((uint32_t *)&psxVuw[(i<<10)+j],
             GETLE16(&psxVuw[clutP+tC1])|
-            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16);
+            ((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16,st);
        posX+=difX2;
        posY+=difY2;
       }
@@ -3834,7 +3906,7 @@ static void drawPoly4TEx8_TW_S(short x1, short y1, short x2, short y2, short x3,
       {
        tC1 = psxVub[((((posY+difY)>>16)&TWin.ymask)<<11)+
                     YAdjust+((posX>>16)&TWin.xmask)];
-       GetTextureTransColG_SPR(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]));
+       GetTextureTransColG_SPR(&psxVuw[(i<<10)+j],GETLE16(&psxVuw[clutP+tC1]),st);
       }
     }
    if(NextRow_FT4()) return;
@@ -3845,7 +3917,7 @@ static void drawPoly4TEx8_TW_S(short x1, short y1, short x2, short y2, short x3,
 // POLY 3 F-SHADED TEX 15 BIT
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TD(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3)
+SOFT_INLINE void drawPoly3TD_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
@@ -3870,7 +3942,7 @@ static void drawPoly3TD(short x1, short y1, short x2, short y2, short x3, short
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -3927,14 +3999,14 @@ static void drawPoly3TD(short x1, short y1, short x2, short y2, short x3, short
       {
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             (((int32_t)GETLE16(&psxVuw[((((posY+difY)>>16)+GlobalTextAddrY)<<10)+((posX+difX)>>16)+GlobalTextAddrX]))<<16)|
-            GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+((posX)>>16)+GlobalTextAddrX]));
+            GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+((posX)>>16)+GlobalTextAddrX]),st);
 
        posX+=difX2;
        posY+=difY2;
       }
      if(j==xmax)
        GetTextureTransColG(&psxVuw[(i<<10)+j],
-           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]));
+           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),st);
     }
    if(NextRow_FT()) 
     {
@@ -3943,10 +4015,16 @@ static void drawPoly3TD(short x1, short y1, short x2, short y2, short x3, short
   }
 }
 
+SOFT_NOINLINE void drawPoly3TD(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3)
+{
+ SOFT_SPECIALIZE(drawPoly3TD_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TD_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY,difX2, difY2;
  int32_t posX,posY;
@@ -4032,7 +4110,7 @@ static void drawPoly3TD_TW(short x1, short y1, short x2, short y2, short x3, sho
             (((int32_t)GETLE16(&psxVuw[(((((posY+difY)>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
             (((posX+difX)>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]))<<16)|
             GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                   (((posX)>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                   (((posX)>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
 
        posX+=difX2;
        posY+=difY2;
@@ -4040,7 +4118,7 @@ static void drawPoly3TD_TW(short x1, short y1, short x2, short y2, short x3, sho
      if(j==xmax)
        GetTextureTransColG(&psxVuw[(i<<10)+j],
            GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                  ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                  ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
     }
    if(NextRow_FT()) 
     {
@@ -4066,7 +4144,7 @@ static void drawPoly4TD_TRI(short x1, short y1, short x2, short y2, short x3, sh
 
 // more exact:
 
-static void drawPoly4TD(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4)
+SOFT_INLINE void drawPoly4TD_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -4089,7 +4167,7 @@ static void drawPoly4TD(short x1, short y1, short x2, short y2, short x3, short
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans)
+ if(!ST_MASK(st) && !ST_SEMI(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -4157,23 +4235,29 @@ static void drawPoly4TD(short x1, short y1, short x2, short y2, short x3, short
       {
        GetTextureTransColG32((uint32_t *)&psxVuw[(i<<10)+j],
             (((int32_t)GETLE16(&psxVuw[((((posY+difY)>>16)+GlobalTextAddrY)<<10)+((posX+difX)>>16)+GlobalTextAddrX]))<<16)|
-            GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+((posX)>>16)+GlobalTextAddrX]));
+            GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+((posX)>>16)+GlobalTextAddrX]),st);
 
        posX+=difX2;
        posY+=difY2;
       }
      if(j==xmax)
       GetTextureTransColG(&psxVuw[(i<<10)+j],
-         GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]));
+         GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),st);
     }
    if(NextRow_FT4()) return;
   }
 }
 
+SOFT_NOINLINE void drawPoly4TD(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4)
+{
+ SOFT_SPECIALIZE(drawPoly4TD_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TD_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -4268,7 +4352,7 @@ static void drawPoly4TD_TW(short x1, short y1, short x2, short y2, short x3, sho
             (((int32_t)GETLE16(&psxVuw[(((((posY+difY)>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
                            (((posX+difX)>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]))<<16)|
             GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                   ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                   ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
 
        posX+=difX2;
        posY+=difY2;
@@ -4276,7 +4360,7 @@ static void drawPoly4TD_TW(short x1, short y1, short x2, short y2, short x3, sho
      if(j==xmax)
       GetTextureTransColG(&psxVuw[(i<<10)+j],
          GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
     }
    if(NextRow_FT4()) return;
   }
@@ -4286,6 +4370,7 @@ static void drawPoly4TD_TW(short x1, short y1, short x2, short y2, short x3, sho
 
 static void drawPoly4TD_TW_S(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4)
 {
+ int st=soft_state(0);
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
  int32_t difX, difY, difX2, difY2;
@@ -4380,7 +4465,7 @@ static void drawPoly4TD_TW_S(short x1, short y1, short x2, short y2, short x3, s
             (((int32_t)GETLE16(&psxVuw[(((((posY+difY)>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
                            (((posX+difX)>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]))<<16)|
             GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                   ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                   ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
 
        posX+=difX2;
        posY+=difY2;
@@ -4388,7 +4473,7 @@ static void drawPoly4TD_TW_S(short x1, short y1, short x2, short y2, short x3, s
      if(j==xmax)
       GetTextureTransColG_SPR(&psxVuw[(i<<10)+j],
          GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
-                ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]));
+                ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),st);
     }
    if(NextRow_FT4()) return;
   }
@@ -4398,7 +4483,7 @@ static void drawPoly4TD_TW_S(short x1, short y1, short x2, short y2, short x3, s
 // POLY 3/4 G-SHADED
 ////////////////////////////////////////////////////////////////////////
  
-static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb1, int32_t rgb2, int32_t rgb3)
+SOFT_INLINE void drawPoly3Gi_st(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb1, int32_t rgb2, int32_t rgb3,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
@@ -4427,7 +4512,7 @@ static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,shor
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && iDither!=2)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -4463,7 +4548,7 @@ static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,shor
 
 #endif
 
- if(iDither==2)
+ if(ST_DITHER(st))
  for (i=ymin;i<=ymax;i++)
   {
    xmin=(left_x >> 16);
@@ -4480,7 +4565,7 @@ static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,shor
 
      for(j=xmin;j<=xmax;j++) 
       {
-       GetShadeTransCol_Dither(&psxVuw[(i<<10)+j],(cB1>>16),(cG1>>16),(cR1>>16));
+       GetShadeTransCol_Dither(&psxVuw[(i<<10)+j],(cB1>>16),(cG1>>16),(cR1>>16),st);
 
        cR1+=difR;
        cG1+=difG;
@@ -4506,7 +4591,7 @@ static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,shor
 
      for(j=xmin;j<=xmax;j++) 
       {
-       GetShadeTransCol(&psxVuw[(i<<10)+j],((cR1 >> 9)&0x7c00)|((cG1 >> 14)&0x03e0)|((cB1 >> 19)&0x001f));
+       GetShadeTransCol(&psxVuw[(i<<10)+j],((cR1 >> 9)&0x7c00)|((cG1 >> 14)&0x03e0)|((cB1 >> 19)&0x001f),st);
 
        cR1+=difR;
        cG1+=difG;
@@ -4518,6 +4603,11 @@ static inline void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,shor
 
 }
 
+SOFT_NOINLINE void drawPoly3Gi(short x1,short y1,short x2,short y2,short x3,short y3,int32_t rgb1, int32_t rgb2, int32_t rgb3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly3Gi_st(x1,y1,x2,y2,x3,y3,rgb1,rgb2,rgb3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3G(int32_t rgb1, int32_t rgb2, int32_t rgb3)
@@ -4539,7 +4629,7 @@ static void drawPoly4G(int32_t rgb1, int32_t rgb2, int32_t rgb3, int32_t rgb4)
 // POLY 3/4 G-SHADED TEX PAL4
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TGEx4(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
+SOFT_INLINE void drawPoly3TGEx4_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
@@ -4578,7 +4668,7 @@ static void drawPoly3TGEx4(short x1, short y1, short x2, short y2, short x3, sho
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -4661,14 +4751,14 @@ static void drawPoly3TGEx4(short x1, short y1, short x2, short y2, short x3, sho
        XAdjust=(posX>>16);
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+(XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -4683,10 +4773,16 @@ static void drawPoly3TGEx4(short x1, short y1, short x2, short y2, short x3, sho
   }
 }
 
+SOFT_NOINLINE void drawPoly3TGEx4(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly3TGEx4_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,clX,clY,col1,col2,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TGEx4_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
  int32_t difR,difB,difG,difR2,difB2,difG2;
@@ -4813,11 +4909,11 @@ static void drawPoly3TGEx4_TW(short x1, short y1, short x2, short y2, short x3,
        if(iDither)
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -4860,10 +4956,10 @@ static void drawPoly4TGEx4_TRI(short x1, short y1, short x2, short y2, short x3,
                
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly4TGEx4(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
+SOFT_INLINE void drawPoly4TGEx4_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
                     short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, 
                     short clX, short clY,
-                    int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+                    int32_t col1, int32_t col2, int32_t col4, int32_t col3,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -4894,7 +4990,7 @@ static void drawPoly4TGEx4(short x1, short y1, short x2, short y2, short x3, sho
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -5005,14 +5101,14 @@ static void drawPoly4TGEx4(short x1, short y1, short x2, short y2, short x3, sho
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+
                     (XAdjust>>1)];
        tC1=(tC1>>((XAdjust&1)<<2))&0xf;
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
            GETLE16(&psxVuw[clutP+tC1]),
-           (cB1>>16),(cG1>>16),(cR1>>16));
+           (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
            GETLE16(&psxVuw[clutP+tC1]),
-           (cB1>>16),(cG1>>16),(cR1>>16));
+           (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5024,6 +5120,14 @@ static void drawPoly4TGEx4(short x1, short y1, short x2, short y2, short x3, sho
   }
 }
 
+SOFT_NOINLINE void drawPoly4TGEx4(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
+                    short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, 
+                    short clX, short clY,
+                    int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly4TGEx4_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,clX,clY,col1,col2,col4,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TGEx4_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
@@ -5046,7 +5150,7 @@ static void drawPoly4TGEx4_TW(short x1, short y1, short x2, short y2, short x3,
 // POLY 3/4 G-SHADED TEX PAL8
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TGEx8(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
+SOFT_INLINE void drawPoly3TGEx8_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
@@ -5084,7 +5188,7 @@ static void drawPoly3TGEx8(short x1, short y1, short x2, short y2, short x3, sho
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -5158,14 +5262,14 @@ static void drawPoly3TGEx8(short x1, short y1, short x2, short y2, short x3, sho
      for(j=xmin;j<=xmax;j++)
       {
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+((posX>>16))];
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5180,10 +5284,16 @@ static void drawPoly3TGEx8(short x1, short y1, short x2, short y2, short x3, sho
   }
 }
 
+SOFT_NOINLINE void drawPoly3TGEx8(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly3TGEx8_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,clX,clY,col1,col2,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TGEx8_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short clX, short clY,int32_t col1, int32_t col2, int32_t col3)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
  int32_t difR,difB,difG,difR2,difB2,difG2;
@@ -5302,11 +5412,11 @@ static void drawPoly3TGEx8_TW(short x1, short y1, short x2, short y2, short x3,
        if(iDither)
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-            (cB1>>16),(cG1>>16),(cR1>>16));
+            (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5344,10 +5454,10 @@ static void drawPoly4TGEx8_TRI(short x1, short y1, short x2, short y2, short x3,
 
 #endif
 
-static void drawPoly4TGEx8(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
+SOFT_INLINE void drawPoly4TGEx8_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
                    short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, 
                    short clX, short clY,
-                   int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+                   int32_t col1, int32_t col2, int32_t col4, int32_t col3,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -5377,7 +5487,7 @@ static void drawPoly4TGEx8(short x1, short y1, short x2, short y2, short x3, sho
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -5477,14 +5587,14 @@ static void drawPoly4TGEx8(short x1, short y1, short x2, short y2, short x3, sho
      for(j=xmin;j<=xmax;j++)
       {
        tC1 = psxVub[((posY>>5)&(int32_t)0xFFFFF800)+YAdjust+(posX>>16)];
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-           (cB1>>16),(cG1>>16),(cR1>>16));
+           (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j], 
             GETLE16(&psxVuw[clutP+tC1]),
-           (cB1>>16),(cG1>>16),(cR1>>16));
+           (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5496,6 +5606,14 @@ static void drawPoly4TGEx8(short x1, short y1, short x2, short y2, short x3, sho
   }
 }
 
+SOFT_NOINLINE void drawPoly4TGEx8(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
+                   short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, 
+                   short clX, short clY,
+                   int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly4TGEx8_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,clX,clY,col1,col2,col4,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TGEx8_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, 
@@ -5517,7 +5635,7 @@ static void drawPoly4TGEx8_TW(short x1, short y1, short x2, short y2, short x3,
 // POLY 3 G-SHADED TEX 15 BIT
 ////////////////////////////////////////////////////////////////////////
 
-static void drawPoly3TGD(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,int32_t col1, int32_t col2, int32_t col3)
+SOFT_INLINE void drawPoly3TGD_st(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,int32_t col1, int32_t col2, int32_t col3,int st)
 {
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
@@ -5550,7 +5668,7 @@ static void drawPoly3TGD(short x1, short y1, short x2, short y2, short x3, short
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {       
    for (i=ymin;i<=ymax;i++)
     {
@@ -5617,14 +5735,14 @@ static void drawPoly3TGD(short x1, short y1, short x2, short y2, short x3, short
 
      for(j=xmin;j<=xmax;j++)
       {
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5639,10 +5757,16 @@ static void drawPoly3TGD(short x1, short y1, short x2, short y2, short x3, short
   }
 }
 
+SOFT_NOINLINE void drawPoly3TGD(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,int32_t col1, int32_t col2, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly3TGD_st(x1,y1,x2,y2,x3,y3,tx1,ty1,tx2,ty2,tx3,ty3,col1,col2,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly3TGD_TW(short x1, short y1, short x2, short y2, short x3, short y3, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3,int32_t col1, int32_t col2, int32_t col3)
 {
+ int st=soft_state(0);
  int i,j,xmin,xmax,ymin,ymax;
  int32_t cR1,cG1,cB1;
  int32_t difR,difB,difG,difR2,difB2,difG2;
@@ -5748,12 +5872,12 @@ static void drawPoly3TGD_TW(short x1, short y1, short x2, short y2, short x3, sh
         GetTextureTransColGX_Dither(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
                  ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[((((posY>>16)&TWin.ymask)+GlobalTextAddrY+TWin.Position.y0)<<10)+
                  ((posX>>16)&TWin.xmask)+GlobalTextAddrX+TWin.Position.x0]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5786,7 +5910,7 @@ static void drawPoly4TGD_TRI(short x1, short y1, short x2, short y2, short x3, s
 
 #endif
 
-static void drawPoly4TGD(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+SOFT_INLINE void drawPoly4TGD_st(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, int32_t col1, int32_t col2, int32_t col4, int32_t col3,int st)
 {
  int32_t num; 
  int32_t i,j,xmin,xmax,ymin,ymax;
@@ -5811,7 +5935,7 @@ static void drawPoly4TGD(short x1, short y1, short x2, short y2, short x3, short
 
 #ifdef FASTSOLID
 
- if(!bCheckMask && !DrawSemiTrans && !iDither)
+ if(!ST_MASK(st) && !ST_SEMI(st) && !ST_DITHER(st))
   {
    for (i=ymin;i<=ymax;i++)
     {
@@ -5903,14 +6027,14 @@ static void drawPoly4TGD(short x1, short y1, short x2, short y2, short x3, short
 
      for(j=xmin;j<=xmax;j++)
       {
-       if(iDither)
+       if(ST_DITHER(st))
         GetTextureTransColGX(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        else
         GetTextureTransColGX(&psxVuw[(i<<10)+j],
           GETLE16(&psxVuw[(((posY>>16)+GlobalTextAddrY)<<10)+(posX>>16)+GlobalTextAddrX]),
-          (cB1>>16),(cG1>>16),(cR1>>16));
+          (cB1>>16),(cG1>>16),(cR1>>16),st);
        posX+=difX;
        posY+=difY;
        cR1+=difR;
@@ -5922,6 +6046,11 @@ static void drawPoly4TGD(short x1, short y1, short x2, short y2, short x3, short
   }
 }
 
+SOFT_NOINLINE void drawPoly4TGD(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, int32_t col1, int32_t col2, int32_t col4, int32_t col3)
+{
+ SOFT_SPECIALIZE_D(iDither, drawPoly4TGD_st(x1,y1,x2,y2,x3,y3,x4,y4,tx1,ty1,tx2,ty2,tx3,ty3,tx4,ty4,col1,col2,col4,col3,ST));
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 static void drawPoly4TGD_TW(short x1, short y1, short x2, short y2, short x3, short y3, short x4, short y4, short tx1, short ty1, short tx2, short ty2, short tx3, short ty3, short tx4, short ty4, int32_t col1, int32_t col2, int32_t col3, int32_t col4)
@@ -6259,6 +6388,7 @@ static void DrawSoftwareSpriteTWin(unsigned char * baseAddr,int32_t w,int32_t h)
 
 static void DrawSoftwareSpriteMirror(unsigned char * baseAddr,int32_t w,int32_t h)
 {
+ int st=soft_state(0);
  int32_t sprtY,sprtX,sprtW,sprtH,lXDir,lYDir;
  int32_t clutY0,clutX0,clutP,textX0,textY0,sprtYa,sprCY,sprCX,sprA;
  short tC;
@@ -6322,8 +6452,8 @@ static void DrawSoftwareSpriteMirror(unsigned char * baseAddr,int32_t w,int32_t
       {
        tC= psxVub[((textY0+(sprCY*lYDir))<<11) + textX0 +(sprCX*lXDir)];
        sprA=sprtYa+(sprCY<<10)+sprtX + (sprCX<<1);
-       GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+((tC>>4)&0xf)]));
-       GetTextureTransColG_SPR(&psxVuw[sprA+1],GETLE16(&psxVuw[clutP+(tC&0xf)]));
+       GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+((tC>>4)&0xf)]),st);
+       GetTextureTransColG_SPR(&psxVuw[sprA+1],GETLE16(&psxVuw[clutP+(tC&0xf)]),st);
       }
     }
     return;
@@ -6336,7 +6466,7 @@ static void DrawSoftwareSpriteMirror(unsigned char * baseAddr,int32_t w,int32_t
      for(sprCX=0;sprCX<sprtW;sprCX++)
       { 
        tC = psxVub[((textY0+(sprCY*lYDir))<<11)+(GlobalTextAddrX<<1) + textX0 + (sprCX*lXDir)] & 0xff;
-       GetTextureTransColG_SPR(&psxVuw[((sprtY+sprCY)<<10)+sprtX + sprCX],psxVuw[clutP+tC]);
+       GetTextureTransColG_SPR(&psxVuw[((sprtY+sprCY)<<10)+sprtX + sprCX],psxVuw[clutP+tC],st);
       }
     }
     return;
@@ -6348,7 +6478,7 @@ static void DrawSoftwareSpriteMirror(unsigned char * baseAddr,int32_t w,int32_t
      for (sprCX=0;sprCX<sprtW;sprCX++)
       { 
        GetTextureTransColG_SPR(&psxVuw[((sprtY+sprCY)<<10)+sprtX+sprCX],
-           GETLE16(&psxVuw[((textY0+(sprCY*lYDir))<<10)+GlobalTextAddrX + textX0 +(sprCX*lXDir)]));
+           GETLE16(&psxVuw[((textY0+(sprCY*lYDir))<<10)+GlobalTextAddrX + textX0 +(sprCX*lXDir)]),st);
       }
     }
     return;
@@ -6357,7 +6487,7 @@ static void DrawSoftwareSpriteMirror(unsigned char * baseAddr,int32_t w,int32_t
 
 ////////////////////////////////////////////////////////////////////////
 
-static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t tx,int32_t ty)
+SOFT_INLINE void DrawSoftwareSprite_st(unsigned char * baseAddr,short w,short h,int32_t tx,int32_t ty,int st)
 {
  int32_t sprtY,sprtX,sprtW,sprtH;
  int32_t clutY0,clutX0,clutP,textX0,textY0,sprtYa,sprCY,sprCX,sprA;
@@ -6429,7 +6559,7 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
 
 #ifdef FASTSOLID
  
-    if(!bCheckMask && !DrawSemiTrans)
+    if(!ST_MASK(st) && !ST_SEMI(st))
      {
       for (sprCY=0;sprCY<sprtH;sprCY++)
        {
@@ -6470,7 +6600,7 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
       if(bWS)
        {
         tC=*pV++;
-        GetTextureTransColG_SPR(&psxVuw[sprA++],GETLE16(&psxVuw[clutP+((tC>>4)&0xf)]));
+        GetTextureTransColG_SPR(&psxVuw[sprA++],GETLE16(&psxVuw[clutP+((tC>>4)&0xf)]),st);
        }
 
       for (sprCX=0;sprCX<sprtW;sprCX++,sprA+=2)
@@ -6479,13 +6609,13 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
 
         GetTextureTransColG32_SPR((uint32_t *)&psxVuw[sprA],
             (((int32_t)GETLE16(&psxVuw[clutP+((tC>>4)&0xf)])<<16))|
-            GETLE16(&psxVuw[clutP+(tC&0x0f)]));
+            GETLE16(&psxVuw[clutP+(tC&0x0f)]),st);
        }
 
       if(bWT)
        {
         tC=*pV;
-        GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+(tC&0x0f)]));
+        GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+(tC&0x0f)]),st);
        }
      }
     return;
@@ -6496,7 +6626,7 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
 
 #ifdef FASTSOLID
 
-    if(!bCheckMask && !DrawSemiTrans)
+    if(!ST_MASK(st) && !ST_SEMI(st))
      {
       for(sprCY=0;sprCY<sprtH;sprCY++)
        {
@@ -6526,10 +6656,10 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
         tC = *pV++;tC2 = *pV++;
         GetTextureTransColG32_SPR((uint32_t *)&psxVuw[sprA],
             (((int32_t)GETLE16(&psxVuw[clutP+tC2]))<<16)|
-            GETLE16(&psxVuw[clutP+tC]));
+            GETLE16(&psxVuw[clutP+tC]),st);
        }
       if(sprCX==sprtW)
-       GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+(*pV)]));
+       GetTextureTransColG_SPR(&psxVuw[sprA],GETLE16(&psxVuw[clutP+(*pV)]),st);
      }
     return;
 
@@ -6540,7 +6670,7 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
 
 #ifdef FASTSOLID
 
-    if(!bCheckMask && !DrawSemiTrans)
+    if(!ST_MASK(st) && !ST_SEMI(st))
      {
       for (sprCY=0;sprCY<sprtH;sprCY++)
        {
@@ -6570,16 +6700,21 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
        { 
         GetTextureTransColG32_SPR((uint32_t *)&psxVuw[sprA],
             (((int32_t)GETLE16(&psxVuw[(sprCY<<10) + textX0 + sprCX +1]))<<16)|
-            GETLE16(&psxVuw[(sprCY<<10) + textX0 + sprCX]));
+            GETLE16(&psxVuw[(sprCY<<10) + textX0 + sprCX]),st);
        }
       if(sprCX==sprtW)
        GetTextureTransColG_SPR(&psxVuw[sprA],
-            GETLE16(&psxVuw[(sprCY<<10) + textX0 + sprCX]));
+            GETLE16(&psxVuw[(sprCY<<10) + textX0 + sprCX]),st);
 
      }
     return;
    }                
 }
+
+SOFT_NOINLINE void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t tx,int32_t ty)
+{
+ SOFT_SPECIALIZE(DrawSoftwareSprite_st(baseAddr,w,h,tx,ty,ST));
+}
  
 ///////////////////////////////////////////////////////////////////////
 
@@ -6596,6 +6731,7 @@ static void DrawSoftwareSprite(unsigned char * baseAddr,short w,short h,int32_t
 
 static void Line_E_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint32_t rgb1)
 {
+    int st=soft_state(0);
     int dx, dy, incrE, incrSE, d;
 		uint32_t r0, g0, b0, r1, g1, b1;
 		int32_t dr, dg, db;
@@ -6628,7 +6764,7 @@ static void Line_E_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
     incrSE = 2*(dy - dx);       /* incr. used for move to SE */
 
 		if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     while(x0 < x1)
     {
         if (d <= 0)
@@ -6647,7 +6783,7 @@ static void Line_E_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 				b0+=db;
 
 				if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     }
 }
 
@@ -6655,6 +6791,7 @@ static void Line_E_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 
 static void Line_S_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint32_t rgb1)
 {
+    int st=soft_state(0);
     int dx, dy, incrS, incrSE, d;
 		uint32_t r0, g0, b0, r1, g1, b1;
 		int32_t dr, dg, db;
@@ -6687,7 +6824,7 @@ static void Line_S_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
     incrSE = 2*(dx - dy);       /* incr. used for move to SE */
 
 		if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     while(y0 < y1)
     {
         if (d <= 0)
@@ -6706,7 +6843,7 @@ static void Line_S_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 				b0+=db;
 
 				if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     }
 }
 
@@ -6714,6 +6851,7 @@ static void Line_S_SE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 
 static void Line_N_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint32_t rgb1)
 {
+    int st=soft_state(0);
     int dx, dy, incrN, incrNE, d;
 		uint32_t r0, g0, b0, r1, g1, b1;
 		int32_t dr, dg, db;
@@ -6746,7 +6884,7 @@ static void Line_N_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
     incrNE = 2*(dx - dy);       /* incr. used for move to NE */
 
 		if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     while(y0 > y1)
     {
         if (d <= 0)
@@ -6765,7 +6903,7 @@ static void Line_N_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 				b0+=db;
 
 				if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     }
 }
 
@@ -6773,6 +6911,7 @@ static void Line_N_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 
 static void Line_E_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint32_t rgb1)
 {
+    int st=soft_state(0);
     int dx, dy, incrE, incrNE, d;
 		uint32_t r0, g0, b0, r1, g1, b1;
 		int32_t dr, dg, db;
@@ -6805,7 +6944,7 @@ static void Line_E_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
     incrNE = 2*(dy - dx);       /* incr. used for move to NE */
 
 		if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+			GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     while(x0 < x1)
     {
         if (d <= 0)
@@ -6824,7 +6963,7 @@ static void Line_E_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 				b0+=db;
 
 				if ((x0>=drawX)&&(x0<drawW)&&(y0>=drawY)&&(y0<drawH))
-					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+					GetShadeTransCol(&psxVuw[(y0<<10)+x0],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
     }
 }
 
@@ -6832,6 +6971,7 @@ static void Line_E_NE_Shade(int x0, int y0, int x1, int y1, uint32_t rgb0, uint3
 
 static void VertLineShade(int x, int y0, int y1, uint32_t rgb0, uint32_t rgb1)
 {
+  int st=soft_state(0);
   int y, dy;
 	uint32_t r0, g0, b0, r1, g1, b1;
 	int32_t dr, dg, db;
@@ -6871,7 +7011,7 @@ static void VertLineShade(int x, int y0, int y1, uint32_t rgb0, uint32_t rgb1)
 
   for (y = y0; y <= y1; y++)
 	{
-		GetShadeTransCol(&psxVuw[(y<<10)+x],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+		GetShadeTransCol(&psxVuw[(y<<10)+x],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
 		r0+=dr;
 		g0+=dg;
 		b0+=db;
@@ -6882,6 +7022,7 @@ static void VertLineShade(int x, int y0, int y1, uint32_t rgb0, uint32_t rgb1)
 
 static void HorzLineShade(int y, int x0, int x1, uint32_t rgb0, uint32_t rgb1)
 {
+  int st=soft_state(0);
   int x, dx;
 	uint32_t r0, g0, b0, r1, g1, b1;
 	int32_t dr, dg, db;
@@ -6921,7 +7062,7 @@ static void HorzLineShade(int y, int x0, int x1, uint32_t rgb0, uint32_t rgb1)
 
   for (x = x0; x <= x1; x++)
 	{
-		GetShadeTransCol(&psxVuw[(y<<10)+x],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)));
+		GetShadeTransCol(&psxVuw[(y<<10)+x],(unsigned short)(((r0 >> 9)&0x7c00)|((g0 >> 14)&0x03e0)|((b0 >> 19)&0x001f)),st);
 		r0+=dr;
 		g0+=dg;
 		b0+=db;
@@ -6932,6 +7073,7 @@ static void HorzLineShade(int y, int x0, int x1, uint32_t rgb0, uint32_t rgb1)
 
 static void Line_E_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour)
 {
+    int st=soft_state(0);
     int dx, dy, incrE, incrSE, d, x, y;
 
     dx = x1 - x0;
@@ -6942,7 +7084,7 @@ static void Line_E_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
     x = x0;
     y = y0;
 		if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-			GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+			GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     while(x < x1)
     {
         if (d <= 0)
@@ -6957,7 +7099,7 @@ static void Line_E_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
             y++;
         }
 				if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-					GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+					GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     }
 }
 
@@ -6965,6 +7107,7 @@ static void Line_E_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
 
 static void Line_S_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour)
 {
+    int st=soft_state(0);
     int dx, dy, incrS, incrSE, d, x, y;
 
     dx = x1 - x0;
@@ -6975,7 +7118,7 @@ static void Line_S_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
     x = x0;
     y = y0;
 		if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-			GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+			GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     while(y < y1)
     {
         if (d <= 0)
@@ -6990,7 +7133,7 @@ static void Line_S_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
             y++;
         }
 				if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-					GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+					GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     }
 }
 
@@ -6998,6 +7141,7 @@ static void Line_S_SE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
 
 static void Line_N_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour)
 {
+    int st=soft_state(0);
     int dx, dy, incrN, incrNE, d, x, y;
 
     dx = x1 - x0;
@@ -7008,7 +7152,7 @@ static void Line_N_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
     x = x0;
     y = y0;
 		if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-			GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+			GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     while(y > y1)
     {
         if (d <= 0)
@@ -7023,7 +7167,7 @@ static void Line_N_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
             y--;
         }
 				if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-					GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+					GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     }
 }
 
@@ -7031,6 +7175,7 @@ static void Line_N_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
 
 static void Line_E_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour)
 {
+    int st=soft_state(0);
     int dx, dy, incrE, incrNE, d, x, y;
 
     dx = x1 - x0;
@@ -7041,7 +7186,7 @@ static void Line_E_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
     x = x0;
     y = y0;
 		if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-			GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+			GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     while(x < x1)
     {
         if (d <= 0)
@@ -7056,7 +7201,7 @@ static void Line_E_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
             y--;
         }
 				if ((x>=drawX)&&(x<drawW)&&(y>=drawY)&&(y<drawH))
-					GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+					GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
     }
 }
 
@@ -7064,6 +7209,7 @@ static void Line_E_NE_Flat(int x0, int y0, int x1, int y1, unsigned short colour
 
 static void VertLineFlat(int x, int y0, int y1, unsigned short colour)
 {
+	int st=soft_state(0);
 	int y;
 
 	if (y0 < drawY)
@@ -7073,13 +7219,14 @@ static void VertLineFlat(int x, int y0, int y1, unsigned short colour)
 		y1 = drawH;
 
   for (y = y0; y <= y1; y++)
-		GetShadeTransCol(&psxVuw[(y<<10)+x], colour);
+		GetShadeTransCol(&psxVuw[(y<<10)+x], colour,st);
 }
 
 ///////////////////////////////////////////////////////////////////////
 
 static void HorzLineFlat(int y, int x0, int x1, unsigned short colour)
 {
+	int st=soft_state(0);
 	int x;
 
 	if (x0 < drawX)
@@ -7089,7 +7236,7 @@ static void HorzLineFlat(int y, int x0, int x1, unsigned short colour)
 		x1 = drawW;
 
 	for (x = x0; x <= x1; x++)
-		GetShadeTransCol(&psxVuw[(y << 10) + x], colour);
+		GetShadeTransCol(&psxVuw[(y << 10) + x], colour,st);
 }
 
 ///////////////////////////////////////////////////////////////////////
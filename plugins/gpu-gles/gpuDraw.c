@@ -134,6 +134,19 @@ int            iDepthFunc=0;
 int            iZBufferDepth=0;
 GLbitfield     uiBufferBits=GL_COLOR_BUFFER_BIT;
 
+// offscreen rendering
+
+int            iUseFBO=0;
+static GLuint  uiFBO=0;
+static GLuint  uiFBOTex=0;
+static int     iFBOTexW,iFBOTexH;
+
+static PFNGLGENFRAMEBUFFERSOESPROC        pglGenFramebuffersOES;
+static PFNGLDELETEFRAMEBUFFERSOESPROC     pglDeleteFramebuffersOES;
+static PFNGLBINDFRAMEBUFFEROESPROC        pglBindFramebufferOES;
+static PFNGLFRAMEBUFFERTEXTURE2DOESPROC   pglFramebufferTexture2DOES;
+static PFNGLCHECKFRAMEBUFFERSTATUSOESPROC pglCheckFramebufferStatusOES;
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -435,6 +448,146 @@ static int initEGL(void)
 	return 0;
 }
 
+////////////////////////////////////////////////////////////////////////
+// Offscreen FBO: everything is drawn into a texture that keeps its
+// contents over swaps, and each flip shows it with one textured quad.
+// Framebuffer textures still copy (from the FBO now), as sampling the
+// texture that is being rendered to is undefined in GLES.
+////////////////////////////////////////////////////////////////////////
+
+static void FBOdestroy(void)
+{
+ if(uiFBO)
+  {
+   pglBindFramebufferOES(GL_FRAMEBUFFER_OES,0);
+   pglDeleteFramebuffersOES(1,&uiFBO);
+   uiFBO=0;
+  }
+ if(uiFBOTex)
+  {
+   if(gTexName==uiFBOTex) gTexName=0;
+   glDeleteTextures(1,&uiFBOTex); glError();
+   uiFBOTex=0;
+  }
+}
+
+static void FBOcreate(void)
+{
+ const char *ext=(const char *)glGetString(GL_EXTENSIONS);
+ GLenum status;
+
+ if(!iUseFBO || ext==NULL || !strstr(ext,"GL_OES_framebuffer_object"))
+  return;
+
+ pglGenFramebuffersOES=(void *)eglGetProcAddress("glGenFramebuffersOES");
+ pglDeleteFramebuffersOES=(void *)eglGetProcAddress("glDeleteFramebuffersOES");
+ pglBindFramebufferOES=(void *)eglGetProcAddress("glBindFramebufferOES");
+ pglFramebufferTexture2DOES=(void *)eglGetProcAddress("glFramebufferTexture2DOES");
+ pglCheckFramebufferStatusOES=(void *)eglGetProcAddress("glCheckFramebufferStatusOES");
+ if(!pglGenFramebuffersOES || !pglDeleteFramebuffersOES ||
+    !pglBindFramebufferOES || !pglFramebufferTexture2DOES ||
+    !pglCheckFramebufferStatusOES)
+  return;
+
+ for(iFBOTexW=64;iFBOTexW<iResX;iFBOTexW<<=1);         // gles1 wants pow2 textures
+ for(iFBOTexH=64;iFBOTexH<iResY;iFBOTexH<<=1);
+
+ glGenTextures(1,&uiFBOTex); glError();
+ gTexName=uiFBOTex;
+ glBindTexture(GL_TEXTURE_2D,uiFBOTex); glError();
+ glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST); glError();
+ glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST); glError();
+ glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE); glError();
+ glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE); glError();
+ glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,iFBOTexW,iFBOTexH,0,
+              GL_RGBA,GL_UNSIGNED_BYTE,NULL); glError();
+
+ pglGenFramebuffersOES(1,&uiFBO);
+ pglBindFramebufferOES(GL_FRAMEBUFFER_OES,uiFBO);
+ pglFramebufferTexture2DOES(GL_FRAMEBUFFER_OES,GL_COLOR_ATTACHMENT0_OES,
+                            GL_TEXTURE_2D,uiFBOTex,0);
+ status=pglCheckFramebufferStatusOES(GL_FRAMEBUFFER_OES);
+ if(status!=GL_FRAMEBUFFER_COMPLETE_OES)
+  {
+   printf("GLES fbo incomplete (%x), drawing to the window\n",status);
+   FBOdestroy();
+   return;
+  }
+ printf("GLES rendering to a %dx%d fbo\n",iFBOTexW,iFBOTexH);
+}
+
+void GLswapBuffers(void)
+{
+ GLfloat s,t;
+
+ if(!uiFBO)
+  {
+   eglSwapBuffers(display, surface);
+   return;
+  }
+
+ s=(GLfloat)iResX/(GLfloat)iFBOTexW;
+ t=(GLfloat)iResY/(GLfloat)iFBOTexH;
+
+ {
+  GLfloat vertex_array[2*4] = {
+   -1.0f,-1.0f,  1.0f,-1.0f,  -1.0f,1.0f,  1.0f,1.0f,
+  };
+  GLfloat tex_array[2*4] = {
+   0.0f,0.0f,  s,0.0f,  0.0f,t,  s,t,
+  };
+
+  glDisable(GL_SCISSOR_TEST);                          // plain copy, same as the hud
+  glDisable(GL_ALPHA_TEST);
+  if(bOldSmoothShaded) {glShadeModel(GL_FLAT);bOldSmoothShaded=FALSE;}
+  if(bBlendEnable)     {glDisable(GL_BLEND);bBlendEnable=FALSE;}
+  if(!bTexEnabled)     {glEnable(GL_TEXTURE_2D);bTexEnabled=TRUE;}
+
+  pglBindFramebufferOES(GL_FRAMEBUFFER_OES,0);         // -> window
+  glViewport(0,0,iResX,iResY); glError();
+
+  gTexName=uiFBOTex;
+  glBindTexture(GL_TEXTURE_2D,uiFBOTex); glError();
+
+  vertex[0].c.lcol=0xffffffff;
+  SETCOL(vertex[0]);
+
+  glMatrixMode(GL_TEXTURE);                            // no psx scales for this one
+  glPushMatrix();
+  glLoadIdentity();
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(2,GL_FLOAT,0,vertex_array);
+  glTexCoordPointer(2,GL_FLOAT,0,tex_array);
+  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  CSTEXTURE = CSVERTEX = CSCOLOR = 0;
+
+  glPopMatrix();
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glError();
+ }
+
+ eglSwapBuffers(display, surface);
+
+ pglBindFramebufferOES(GL_FRAMEBUFFER_OES,uiFBO);      // back to the fbo
+ glViewport(rRatioRect.left,
+            iResY-(rRatioRect.top+rRatioRect.bottom),
+            rRatioRect.right,
+            rRatioRect.bottom);
+ glEnable(GL_ALPHA_TEST);
+ glEnable(GL_SCISSOR_TEST);
+ glError();
+}
+
 static int created_gles_context;
 
 int GLinitialize(void *ext_gles_display, void *ext_gles_surface)
@@ -488,6 +641,8 @@ int GLinitialize(void *ext_gles_display, void *ext_gles_surface)
    glDisable(GL_DEPTH_TEST); glError();
   }
 
+ FBOcreate();                                          // offscreen target, if wanted
+
  glClearColor(0.0f, 0.0f, 0.0f, 0.0f); glError();      // first buffer clear
  glClear(uiBufferBits); glError();
 
@@ -539,6 +694,7 @@ int GLinitialize(void *ext_gles_display, void *ext_gles_surface)
 
 void GLcleanup() 
 {                                                     
+ FBOdestroy();                                         // back to the window
  CleanupTextureStore();                                // bye textures
 
  if(created_gles_context) {
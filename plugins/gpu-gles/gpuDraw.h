@@ -51,6 +51,7 @@ BOOL bSetupPixelFormat(HDC hDC);
 
 int  GLinitialize(void *ext_gles_display, void *ext_gles_surface);
 void GLcleanup();
+void GLswapBuffers(void);
 #ifdef _WINDOWS
 BOOL offset2(void);
 BOOL offset3(void);
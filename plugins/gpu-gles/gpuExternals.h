@@ -293,6 +293,7 @@ extern short          sprtY,sprtX,sprtH,sprtW;
 extern BOOL           bIsFirstFrame;
 extern int            iWinSize;
 extern int            iZBufferDepth;
+extern int            iUseFBO;
 extern GLbitfield     uiBufferBits;
 extern int            iUseMask;
 extern int            iSetMask;
@@ -398,6 +399,8 @@ extern GLuint         gTexFrameName;
 extern GLuint         gTexBlurName;
 extern int            iVRamSize;
 extern int            iTexGarbageCollection;
+extern int            iTexContentHash;
+extern int            iTexConvThread;
 extern int            iFTexA;
 extern int            iFTexB;
 extern BOOL           bIgnoreNextTile;
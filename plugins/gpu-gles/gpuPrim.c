@@ -169,6 +169,109 @@ unsigned short BGR24to16 (unsigned int BGR)
 }
 
 
+////////////////////////////////////////////////////////////////////////
+// Batching: consecutive prims with the same vertex format are collected
+// as plain triangles and drawn with one glDrawArrays. Every GL state
+// change flushes first (wrappers in gpuStdafx.h), so the draw order and
+// the state each prim sees stay the same as before.
+////////////////////////////////////////////////////////////////////////
+
+#define BATCH_TEX 1
+#define BATCH_COL 2
+#define MAXBATCHVERTS 1536
+
+static Vertex2 vBatch[MAXBATCHVERTS];
+static int iBatchVerts=0;
+static int iBatchFmt=0;
+
+void PRIMflushBatch(void)
+{
+ if(iBatchVerts==0) return;
+
+ if(CSVERTEX==0) (glEnableClientState)(GL_VERTEX_ARRAY);glError();
+ if(iBatchFmt&BATCH_TEX)
+  {if(CSTEXTURE==0) (glEnableClientState)(GL_TEXTURE_COORD_ARRAY);glError();}
+ else if(CSTEXTURE==1) (glDisableClientState)(GL_TEXTURE_COORD_ARRAY);glError();
+ if(iBatchFmt&BATCH_COL)
+  {if(CSCOLOR==0) (glEnableClientState)(GL_COLOR_ARRAY);glError();}
+ else if(CSCOLOR==1) (glDisableClientState)(GL_COLOR_ARRAY);glError();
+
+ (glVertexPointer)(3, GL_FLOAT, sizeof(vBatch[0]), &vBatch[0].xyz);glError();
+ if(iBatchFmt&BATCH_TEX)
+  (glTexCoordPointer)(2, GL_FLOAT, sizeof(vBatch[0]), &vBatch[0].st);glError();
+ if(iBatchFmt&BATCH_COL)
+  (glColorPointer)(4, GL_UNSIGNED_BYTE, sizeof(vBatch[0]), &vBatch[0].rgba);glError();
+
+ (glDrawArrays)(GL_TRIANGLES, 0, iBatchVerts);glError();
+
+ CSVERTEX=1;
+ CSTEXTURE=(iBatchFmt&BATCH_TEX)?1:0;
+ CSCOLOR=(iBatchFmt&BATCH_COL)?1:0;
+ iBatchVerts=0;
+}
+
+static Vertex2 * PRIMbatchAlloc(int fmt,int n)
+{
+ Vertex2 * v;
+
+ if(fmt!=iBatchFmt || iBatchVerts+n>MAXBATCHVERTS)
+  {
+   PRIMflushBatch();
+   iBatchFmt=fmt;
+  }
+
+ v=&vBatch[iBatchVerts];
+ iBatchVerts+=n;
+ return v;
+}
+
+static __inline void PRIMbatchVertex(Vertex2 * v,int fmt,OGLVertex * vtx,OGLVertex * col)
+{
+ v->xyz.x = fpoint(vtx->x);
+ v->xyz.y = fpoint(vtx->y);
+ v->xyz.z = fpoint(vtx->z);
+ if(fmt&BATCH_TEX)
+  {
+   v->st.x = fpoint(vtx->sow);
+   v->st.y = fpoint(vtx->tow);
+  }
+ if(fmt&BATCH_COL)
+  {
+   v->rgba.r = col->c.col[0];
+   v->rgba.g = col->c.col[1];
+   v->rgba.b = col->c.col[2];
+   v->rgba.a = col->c.col[3];
+  }
+}
+
+// col: take the color from each vertex if NULL, else this one for all
+
+static void PRIMbatchTri(int fmt,OGLVertex* vertex1,OGLVertex* vertex2,
+                         OGLVertex* vertex3,OGLVertex* col)
+{
+ Vertex2 * v=PRIMbatchAlloc(fmt,3);
+
+ PRIMbatchVertex(&v[0],fmt,vertex1,col?col:vertex1);
+ PRIMbatchVertex(&v[1],fmt,vertex2,col?col:vertex2);
+ PRIMbatchVertex(&v[2],fmt,vertex3,col?col:vertex3);
+}
+
+// 4 vertices in triangle strip order, split into 2 tris with the same
+// winding and provoking vertex as the strip had
+
+static void PRIMbatchStrip(int fmt,OGLVertex* vertex1,OGLVertex* vertex2,
+                           OGLVertex* vertex3,OGLVertex* vertex4,OGLVertex* col)
+{
+ Vertex2 * v=PRIMbatchAlloc(fmt,6);
+
+ PRIMbatchVertex(&v[0],fmt,vertex1,col?col:vertex1);
+ PRIMbatchVertex(&v[1],fmt,vertex2,col?col:vertex2);
+ PRIMbatchVertex(&v[2],fmt,vertex3,col?col:vertex3);
+ v[3]=v[2];
+ v[4]=v[1];
+ PRIMbatchVertex(&v[5],fmt,vertex4,col?col:vertex4);
+}
+
 ////////////////////////////////////////////////////////////////////////
 // OpenGL primitive drawing commands
 ////////////////////////////////////////////////////////////////////////
@@ -176,41 +279,7 @@ unsigned short BGR24to16 (unsigned int BGR)
 void PRIMdrawTexturedQuad(OGLVertex* vertex1, OGLVertex* vertex2,
                                    OGLVertex* vertex3, OGLVertex* vertex4) 
 {
-
-
-Vertex v[4];
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].st.x = fpoint(vertex1->sow);
-v[0].st.y = fpoint(vertex1->tow);
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].st.x = fpoint(vertex2->sow);
-v[1].st.y = fpoint(vertex2->tow);
-
-v[2].xyz.x = fpoint(vertex4->x);
-v[2].xyz.y = fpoint(vertex4->y);
-v[2].xyz.z = fpoint(vertex4->z);
-v[2].st.x = fpoint(vertex4->sow);
-v[2].st.y = fpoint(vertex4->tow);
-
-v[3].xyz.x = fpoint(vertex3->x);
-v[3].xyz.y = fpoint(vertex3->y);
-v[3].xyz.z = fpoint(vertex3->z);
-v[3].st.x = fpoint(vertex3->sow);
-v[3].st.y = fpoint(vertex3->tow);
-if (CSCOLOR==1) glDisableClientState(GL_COLOR_ARRAY);glError();
-if (CSTEXTURE==0) glEnableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-glTexCoordPointer(2, GL_FLOAT, sizeof(v[0]), &v[0].st);glError();
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSTEXTURE=CSVERTEX=1;
-CSCOLOR=0;
+ PRIMbatchStrip(BATCH_TEX,vertex1,vertex2,vertex4,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -218,35 +287,9 @@ CSCOLOR=0;
 void PRIMdrawTexturedTri(OGLVertex* vertex1, OGLVertex* vertex2,
                                   OGLVertex* vertex3) 
 {
-Vertex v[3];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].st.x = fpoint(vertex1->sow);
-v[0].st.y = fpoint(vertex1->tow);
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].st.x = fpoint(vertex2->sow);
-v[1].st.y = fpoint(vertex2->tow);
-
-v[2].xyz.x = fpoint(vertex3->x);
-v[2].xyz.y = fpoint(vertex3->y);
-v[2].xyz.z = fpoint(vertex3->z);
-v[2].st.x = fpoint(vertex3->sow);
-v[2].st.y = fpoint(vertex3->tow);
-if (CSCOLOR==1) glDisableClientState(GL_COLOR_ARRAY);glError();
-if (CSTEXTURE==0) glEnableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-glTexCoordPointer(2, GL_FLOAT, sizeof(v[0]), &v[0].st);glError();
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glDrawArrays(GL_TRIANGLES, 0, 3);glError();
-CSTEXTURE=CSVERTEX=1;
-CSCOLOR=0;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
 
+ PRIMbatchTri(BATCH_TEX,vertex1,vertex2,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -254,50 +297,9 @@ CSCOLOR=0;
 void PRIMdrawTexGouraudTriColor(OGLVertex* vertex1, OGLVertex* vertex2,
                                          OGLVertex* vertex3) 
 {
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
 
-Vertex2 v[3];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].st.x = fpoint(vertex1->sow);
-v[0].st.y = fpoint(vertex1->tow);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].st.x = fpoint(vertex2->sow);
-v[1].st.y = fpoint(vertex2->tow);
-v[1].rgba.r = vertex2->c.col[0];
-v[1].rgba.g = vertex2->c.col[1];
-v[1].rgba.b = vertex2->c.col[2];
-v[1].rgba.a = vertex2->c.col[3];
-
-v[2].xyz.x = fpoint(vertex3->x);
-v[2].xyz.y = fpoint(vertex3->y);
-v[2].xyz.z = fpoint(vertex3->z);
-v[2].st.x = fpoint(vertex3->sow);
-v[2].st.y = fpoint(vertex3->tow);
-v[2].rgba.r = vertex3->c.col[0];
-v[2].rgba.g = vertex3->c.col[1];
-v[2].rgba.b = vertex3->c.col[2];
-v[2].rgba.a = vertex3->c.col[3];
-
-if (CSTEXTURE==0) glEnableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-
-glTexCoordPointer(2, GL_FLOAT, sizeof(v[0]), &v[0].st);glError();
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLES, 0, 3);glError();
-CSTEXTURE=CSVERTEX=CSCOLOR=1;
+ PRIMbatchTri(BATCH_TEX|BATCH_COL,vertex1,vertex2,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -305,89 +307,18 @@ CSTEXTURE=CSVERTEX=CSCOLOR=1;
 void PRIMdrawTexGouraudTriColorQuad(OGLVertex* vertex1, OGLVertex* vertex2,
                                              OGLVertex* vertex3, OGLVertex* vertex4) 
 {
-Vertex2 v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].st.x = fpoint(vertex1->sow);
-v[0].st.y = fpoint(vertex1->tow);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].st.x = fpoint(vertex2->sow);
-v[1].st.y = fpoint(vertex2->tow);
-v[1].rgba.r = vertex2->c.col[0];
-v[1].rgba.g = vertex2->c.col[1];
-v[1].rgba.b = vertex2->c.col[2];
-v[1].rgba.a = vertex2->c.col[3];
-
-v[2].xyz.x = fpoint(vertex4->x);
-v[2].xyz.y = fpoint(vertex4->y);
-v[2].xyz.z = fpoint(vertex4->z);
-v[2].st.x = fpoint(vertex4->sow);
-v[2].st.y = fpoint(vertex4->tow);
-v[2].rgba.r = vertex4->c.col[0];
-v[2].rgba.g = vertex4->c.col[1];
-v[2].rgba.b = vertex4->c.col[2];
-v[2].rgba.a = vertex4->c.col[3];
-
-v[3].xyz.x = fpoint(vertex3->x);
-v[3].xyz.y = fpoint(vertex3->y);
-v[3].xyz.z = fpoint(vertex3->z);
-v[3].st.x = fpoint(vertex3->sow);
-v[3].st.y = fpoint(vertex3->tow);
-v[3].rgba.r = vertex3->c.col[0];
-v[3].rgba.g = vertex3->c.col[1];
-v[3].rgba.b = vertex3->c.col[2];
-v[3].rgba.a = vertex3->c.col[3];
-
-if (CSTEXTURE==0) glEnableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-
-glTexCoordPointer(2, GL_FLOAT, sizeof(v[0]), &v[0].st);glError();
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSTEXTURE=CSVERTEX=CSCOLOR=1;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
+
+ PRIMbatchStrip(BATCH_TEX|BATCH_COL,vertex1,vertex2,vertex4,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
 
 void PRIMdrawTri(OGLVertex* vertex1, OGLVertex* vertex2, OGLVertex* vertex3)
 {
-Vec3f v[3];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
-
-v[0].x = fpoint(vertex1->x);
-v[0].y = fpoint(vertex1->y);
-v[0].z = fpoint(vertex1->z);
-
-v[1].x = fpoint(vertex2->x);
-v[1].y = fpoint(vertex2->y);
-v[1].z = fpoint(vertex2->z);
-
-v[2].x = fpoint(vertex3->x);
-v[2].y = fpoint(vertex3->y);
-v[2].z = fpoint(vertex3->z);
-
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSCOLOR==1) glDisableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0]);glError();
-glDrawArrays(GL_TRIANGLES, 0, 3);glError();
-CSVERTEX=1;
-CSTEXTURE=CSCOLOR=0;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
 
+ PRIMbatchTri(0,vertex1,vertex2,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -395,33 +326,9 @@ CSTEXTURE=CSCOLOR=0;
 void PRIMdrawTri2(OGLVertex* vertex1, OGLVertex* vertex2,
                            OGLVertex* vertex3, OGLVertex* vertex4) 
 {
-Vec3f v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].x = fpoint(vertex1->x);
-v[0].y = fpoint(vertex1->y);
-v[0].z = fpoint(vertex1->z);
-
-v[1].x = fpoint(vertex3->x);
-v[1].y = fpoint(vertex3->y);
-v[1].z = fpoint(vertex3->z);
-
-v[2].x = fpoint(vertex2->x);
-v[2].y = fpoint(vertex2->y);
-v[2].z = fpoint(vertex2->z);
-
-v[3].x = fpoint(vertex4->x);
-v[3].y = fpoint(vertex4->y);
-v[3].z = fpoint(vertex4->z);
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
 
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSCOLOR==1) glDisableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0]);glError();
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSVERTEX=1;
-CSTEXTURE=CSCOLOR=0;
+ PRIMbatchStrip(0,vertex1,vertex3,vertex2,vertex4,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -429,43 +336,9 @@ CSTEXTURE=CSCOLOR=0;
 void PRIMdrawGouraudTriColor(OGLVertex* vertex1, OGLVertex* vertex2,
                                       OGLVertex* vertex3) 
 {
-Vertex2 v[3];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].rgba.r = vertex2->c.col[0];
-v[1].rgba.g = vertex2->c.col[1];
-v[1].rgba.b = vertex2->c.col[2];
-v[1].rgba.a = vertex2->c.col[3];
-
-v[2].xyz.x = fpoint(vertex3->x);
-v[2].xyz.y = fpoint(vertex3->y);
-v[2].xyz.z = fpoint(vertex3->z);
-v[2].rgba.r = vertex3->c.col[0];
-v[2].rgba.g = vertex3->c.col[1];
-v[2].rgba.b = vertex3->c.col[2];
-v[2].rgba.a = vertex3->c.col[3];
-
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLES, 0, 3);glError();
-CSVERTEX=CSCOLOR=1;
-CSTEXTURE=0;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0) return;
+
+ PRIMbatchTri(BATCH_COL,vertex1,vertex2,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -473,156 +346,27 @@ CSTEXTURE=0;
 void PRIMdrawGouraudTri2Color(OGLVertex* vertex1, OGLVertex* vertex2,
                                        OGLVertex* vertex3, OGLVertex* vertex4) 
 {
-Vertex2 v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].rgba.r = vertex2->c.col[0];
-v[1].rgba.g = vertex2->c.col[1];
-v[1].rgba.b = vertex2->c.col[2];
-v[1].rgba.a = vertex2->c.col[3];
-
-v[2].xyz.x = fpoint(vertex3->x);
-v[2].xyz.y = fpoint(vertex3->y);
-v[2].xyz.z = fpoint(vertex3->z);
-v[2].rgba.r = vertex3->c.col[0];
-v[2].rgba.g = vertex3->c.col[1];
-v[2].rgba.b = vertex3->c.col[2];
-v[2].rgba.a = vertex3->c.col[3];
-
-v[3].xyz.x = fpoint(vertex4->x);
-v[3].xyz.y = fpoint(vertex4->y);
-v[3].xyz.z = fpoint(vertex4->z);
-v[3].rgba.r = vertex4->c.col[0];
-v[3].rgba.g = vertex4->c.col[1];
-v[3].rgba.b = vertex4->c.col[2];
-v[3].rgba.a = vertex4->c.col[3];
-
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSTEXTURE=0;
-CSVERTEX=CSCOLOR=1;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
+
+ PRIMbatchStrip(BATCH_COL,vertex1,vertex2,vertex3,vertex4,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
 
 void PRIMdrawFlatLine(OGLVertex* vertex1, OGLVertex* vertex2,OGLVertex* vertex3, OGLVertex* vertex4)
 {
-Vertex2 v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].rgba.r = vertex1->c.col[0];
-v[1].rgba.g = vertex1->c.col[1];
-v[1].rgba.b = vertex1->c.col[2];
-v[1].rgba.a = vertex1->c.col[3];
-
-v[2].xyz.x = fpoint(vertex4->x);
-v[2].xyz.y = fpoint(vertex4->y);
-v[2].xyz.z = fpoint(vertex4->z);
-v[2].rgba.r = vertex1->c.col[0];
-v[2].rgba.g = vertex1->c.col[1];
-v[2].rgba.b = vertex1->c.col[2];
-v[2].rgba.a = vertex1->c.col[3];
-
-v[3].xyz.x = fpoint(vertex3->x);
-v[3].xyz.y = fpoint(vertex3->y);
-v[3].xyz.z = fpoint(vertex3->z);
-v[3].rgba.r = vertex1->c.col[0];
-v[3].rgba.g = vertex1->c.col[1];
-v[3].rgba.b = vertex1->c.col[2];
-v[3].rgba.a = vertex1->c.col[3];
-
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-
-CSTEXTURE=0;
-CSVERTEX=CSCOLOR=1;
-
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
 
+ PRIMbatchStrip(BATCH_COL,vertex1,vertex2,vertex4,vertex3,vertex1);
 }
 
 ///////////////////////////////////////////////////////// 
      
 void PRIMdrawGouraudLine(OGLVertex* vertex1, OGLVertex* vertex2,OGLVertex* vertex3, OGLVertex* vertex4)
 {
-	Vertex2 v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].xyz.x = fpoint(vertex1->x);
-v[0].xyz.y = fpoint(vertex1->y);
-v[0].xyz.z = fpoint(vertex1->z);
-v[0].rgba.r = vertex1->c.col[0];
-v[0].rgba.g = vertex1->c.col[1];
-v[0].rgba.b = vertex1->c.col[2];
-v[0].rgba.a = vertex1->c.col[3];
-
-v[1].xyz.x = fpoint(vertex2->x);
-v[1].xyz.y = fpoint(vertex2->y);
-v[1].xyz.z = fpoint(vertex2->z);
-v[1].rgba.r = vertex2->c.col[0];
-v[1].rgba.g = vertex2->c.col[1];
-v[1].rgba.b = vertex2->c.col[2];
-v[1].rgba.a = vertex2->c.col[3];
-
-v[3].xyz.x = fpoint(vertex3->x);
-v[3].xyz.y = fpoint(vertex3->y);
-v[3].xyz.z = fpoint(vertex3->z);
-v[3].rgba.r = vertex3->c.col[0];
-v[3].rgba.g = vertex3->c.col[1];
-v[3].rgba.b = vertex3->c.col[2];
-v[3].rgba.a = vertex3->c.col[3];
-
-v[2].xyz.x = fpoint(vertex4->x);
-v[2].xyz.y = fpoint(vertex4->y);
-v[2].xyz.z = fpoint(vertex4->z);
-v[2].rgba.r = vertex4->c.col[0];
-v[2].rgba.g = vertex4->c.col[1];
-v[2].rgba.b = vertex4->c.col[2];
-v[2].rgba.a = vertex4->c.col[3];
-
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==0) glEnableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0].xyz);glError();
-glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(v[0]), &v[0].rgba);glError();
-
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSTEXTURE=0;
-CSVERTEX=CSCOLOR=1;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
+
+ PRIMbatchStrip(BATCH_COL,vertex1,vertex2,vertex4,vertex3,NULL);
 }
 
 ///////////////////////////////////////////////////////// 
@@ -630,34 +374,9 @@ CSVERTEX=CSCOLOR=1;
 void PRIMdrawQuad(OGLVertex* vertex1, OGLVertex* vertex2,
                            OGLVertex* vertex3, OGLVertex* vertex4) 
 {
-Vec3f v[4];
-if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
-
-v[0].x = fpoint(vertex1->x);
-v[0].y = fpoint(vertex1->y);
-v[0].z = fpoint(vertex1->z);
-
-v[1].x = fpoint(vertex2->x);
-v[1].y = fpoint(vertex2->y);
-v[1].z = fpoint(vertex2->z);
-
-v[2].x = fpoint(vertex4->x);
-v[2].y = fpoint(vertex4->y);
-v[2].z = fpoint(vertex4->z);
-
-v[3].x = fpoint(vertex3->x);
-v[3].y = fpoint(vertex3->y);
-v[3].z = fpoint(vertex3->z);
-
-if (CSTEXTURE==1) glDisableClientState(GL_TEXTURE_COORD_ARRAY);glError();
-if (CSVERTEX==0) glEnableClientState(GL_VERTEX_ARRAY);glError();
-if (CSCOLOR==1) glDisableClientState(GL_COLOR_ARRAY);glError();
-
-glVertexPointer(3, GL_FLOAT, sizeof(v[0]), &v[0]);glError();
-glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);glError();
-CSTEXTURE=0;
-CSVERTEX=1;
-CSCOLOR=0;
+ if (vertex1->x==0&&vertex1->y==0&&vertex2->x==0&&vertex2->y==0&&vertex3->x==0&&vertex3->y==0&&vertex4->x==0&&vertex4->y==0) return;
+
+ PRIMbatchStrip(0,vertex1,vertex2,vertex4,vertex3,NULL);
 }
 
 ////////////////////////////////////////////////////////////////////////                                          
@@ -2130,7 +1849,7 @@ void CheckWriteUpdate()
  if(VRAMWrite.Width)   iX=1;
  if(VRAMWrite.Height)  iY=1;
 
- InvalidateTextureArea(VRAMWrite.x, VRAMWrite.y, VRAMWrite.Width-iX, VRAMWrite.Height-iY);
+ InvalidateTextureUpload(VRAMWrite.x, VRAMWrite.y, VRAMWrite.Width-iX, VRAMWrite.Height-iY);
 
  if(PSXDisplay.Interlaced && !iOffscreenDrawing) return;
 
@@ -67,6 +67,7 @@ extern "C" {
 #pragma softfp_linkage
 #endif
 #include <GLES/gl.h> // for opengl es types 
+#include <GLES/glext.h>
 //#include <GLES/egltypes.h>
 #include <EGL/egl.h>
 #ifdef SOFT_LINKAGE
@@ -79,6 +80,52 @@ extern "C" {
 
 #endif
 
+////////////////////////////////////////////////////////////////////////
+// prims are batched into one vertex array (see gpuPrim.c), so anything
+// that changes GL state or draws on its own has to flush that first.
+// The batch itself calls the real funcs as (glFoo)(...)
+////////////////////////////////////////////////////////////////////////
+
+void PRIMflushBatch(void);
+
+#define glEnable(a)                 (PRIMflushBatch(),glEnable(a))
+#define glDisable(a)                (PRIMflushBatch(),glDisable(a))
+#define glEnableClientState(a)      (PRIMflushBatch(),glEnableClientState(a))
+#define glDisableClientState(a)     (PRIMflushBatch(),glDisableClientState(a))
+#define glVertexPointer(a,b,c,d)    (PRIMflushBatch(),glVertexPointer(a,b,c,d))
+#define glTexCoordPointer(a,b,c,d)  (PRIMflushBatch(),glTexCoordPointer(a,b,c,d))
+#define glColorPointer(a,b,c,d)     (PRIMflushBatch(),glColorPointer(a,b,c,d))
+#define glDrawArrays(a,b,c)         (PRIMflushBatch(),glDrawArrays(a,b,c))
+#define glBindTexture(a,b)          (PRIMflushBatch(),glBindTexture(a,b))
+#define glDeleteTextures(a,b)       (PRIMflushBatch(),glDeleteTextures(a,b))
+#define glTexParameteri(a,b,c)      (PRIMflushBatch(),glTexParameteri(a,b,c))
+#define glTexEnvf(a,b,c)            (PRIMflushBatch(),glTexEnvf(a,b,c))
+#define glTexImage2D(a,b,c,d,e,f,g,h,i) (PRIMflushBatch(),glTexImage2D(a,b,c,d,e,f,g,h,i))
+#define glTexSubImage2D(a,b,c,d,e,f,g,h,i) (PRIMflushBatch(),glTexSubImage2D(a,b,c,d,e,f,g,h,i))
+#define glCopyTexSubImage2D(a,b,c,d,e,f,g,h) (PRIMflushBatch(),glCopyTexSubImage2D(a,b,c,d,e,f,g,h))
+#define glReadPixels(a,b,c,d,e,f,g) (PRIMflushBatch(),glReadPixels(a,b,c,d,e,f,g))
+#define glBlendFunc(a,b)            (PRIMflushBatch(),glBlendFunc(a,b))
+#define glAlphaFunc(a,b)            (PRIMflushBatch(),glAlphaFunc(a,b))
+#define glAlphaFuncx(a,b)           (PRIMflushBatch(),glAlphaFuncx(a,b))
+#define glColor4ub(a,b,c,d)         (PRIMflushBatch(),glColor4ub(a,b,c,d))
+#define glShadeModel(a)             (PRIMflushBatch(),glShadeModel(a))
+#define glDepthFunc(a)              (PRIMflushBatch(),glDepthFunc(a))
+#define glDepthRangef(a,b)          (PRIMflushBatch(),glDepthRangef(a,b))
+#define glPolygonOffset(a,b)        (PRIMflushBatch(),glPolygonOffset(a,b))
+#define glScissor(a,b,c,d)          (PRIMflushBatch(),glScissor(a,b,c,d))
+#define glViewport(a,b,c,d)         (PRIMflushBatch(),glViewport(a,b,c,d))
+#define glMatrixMode(a)             (PRIMflushBatch(),glMatrixMode(a))
+#define glLoadIdentity()            (PRIMflushBatch(),glLoadIdentity())
+#define glScalef(a,b,c)             (PRIMflushBatch(),glScalef(a,b,c))
+#define glOrthof(a,b,c,d,e,f)       (PRIMflushBatch(),glOrthof(a,b,c,d,e,f))
+#define glClear(a)                  (PRIMflushBatch(),glClear(a))
+#define glFlush()                   (PRIMflushBatch(),glFlush())
+#define glFinish()                  (PRIMflushBatch(),glFinish())
+#ifndef _WINDOWS
+#define eglSwapBuffers(a,b)         (PRIMflushBatch(),eglSwapBuffers(a,b))
+#define eglMakeCurrent(a,b,c,d)     (PRIMflushBatch(),eglMakeCurrent(a,b,c,d))
+#endif
+
 #define SHADETEXBIT(x) ((x>>24) & 0x1)
 #define SEMITRANSBIT(x) ((x>>25) & 0x1)
 
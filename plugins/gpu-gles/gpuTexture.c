@@ -75,6 +75,7 @@
 #include "gpuTexture.h"
 #include "gpuPlugin.h"
 #include "gpuPrim.h"
+#include <pthread.h>
 
 #define CLUTCHK   0x00060000
 #define CLUTSHIFT 17
@@ -88,6 +89,8 @@ GLuint        gTexMovieName=0;
 GLuint        gTexBlurName=0;
 GLuint        gTexFrameName=0;
 int           iTexGarbageCollection=1;
+int           iTexContentHash=0;
+int           iTexConvThread=0;
 unsigned int  dwTexPageComp=0;
 int           iVRamSize=0;
 int           iClampType=GL_CLAMP_TO_EDGE;
@@ -194,6 +197,25 @@ GLuint                   uiStexturePage[MAXSORTTEX_MAX];
 
 unsigned short           usLRUTexPage=0;
 
+// expanded palettes, shared by every sub texture load with the same
+// CLUT contents (and conversion), wherever in vram the CLUT sits
+
+#define PALPOOL_SIZE 16
+
+typedef struct palPoolEntryTag
+{
+ unsigned int   hash;
+ unsigned int  (*fn) (unsigned int);
+ short          count;
+ short          semi;
+ short          opaque;
+ unsigned short clut[256];
+ unsigned int   pal[256];
+} palPoolEntry;
+
+static palPoolEntry palPool[PALPOOL_SIZE];
+static int          iPalPoolTurn=0;
+
 int                      iMaxTexWnds=0;
 int                      iTexWndTurn=0;
 int                      iTexWndLimit=MAXWNDTEXCACHE/2;
@@ -208,6 +230,9 @@ unsigned short CLUTMASK      = 0x7fff;
 unsigned short CLUTYMASK     = 0x1ff;
 unsigned short MAXSORTTEX    = 196;
 
+// content hash of every 64x16 vram tile as the caches last saw it, 0: unknown
+unsigned int             uiVRamTileHash[64][16];
+
 ////////////////////////////////////////////////////////////////////////
 // Texture color conversions... all my ASM funcs are removed for easier
 // porting... and honestly: nowadays the speed gain would be pointless 
@@ -547,6 +572,7 @@ void InitializeTextureStore()
 
  memset(wcWndtexStore,0,sizeof(textureWndCacheEntry)*
                         MAXWNDTEXCACHE);
+ memset(uiVRamTileHash,0,sizeof(uiVRamTileHash));
  texturepart=(GLubyte *)malloc(256*256*4);
  memset(texturepart,0,256*256*4);
 	 texturebuffer=NULL;
@@ -576,6 +602,7 @@ void CleanupTextureStore()
  glBindTexture(GL_TEXTURE_2D,0);
  glError();
  //----------------------------------------------------//
+ TexConvStop();                                        // no helper writes anymore
  free(texturepart);                                    // free tex part
  texturepart=0;
  if(texturebuffer)
@@ -673,6 +700,9 @@ void ResetTextureArea(BOOL bDelTex)
    if(bDelTex && uiStexturePage[i])
     {glDeleteTextures(1,&uiStexturePage[i]); glError();uiStexturePage[i]=0;}
   }
+
+ for(i=0;i<PALPOOL_SIZE;i++)                          // conversion could change too
+  palPool[i].count=0;
 }
 
 
@@ -860,6 +890,64 @@ void InvalidateSubSTextureArea(int X,int Y,int W, int H)
 // Invalidate some parts of cache: main routine
 ////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////
+// vram tile hashes: lets an upload of texels identical to what is
+// already cached skip the invalidation. (X,Y)-(X+W,Y+H) inclusive,
+// like the invalidation funcs get it. Anything that touches vram
+// without an upload just forgets the tiles, so a stale hash never
+// vouches for cache entries loaded from different data.
+////////////////////////////////////////////////////////////////////////
+
+static void ForgetVRamHash(int X,int Y,int W,int H)
+{
+ int x,y,rows=iGPUHeight>>4;
+
+ if(W>1023) W=1023;
+ if(H>iGPUHeight-1) H=iGPUHeight-1;
+
+ for(y=Y>>4;y<=(Y+H)>>4;y++)
+  for(x=X>>6;x<=(X+W)>>6;x++)
+   uiVRamTileHash[y&(rows-1)][x&15]=0;
+}
+
+static unsigned int HashVRamTile(int tx,int ty)
+{
+ unsigned int h=0x811c9dc5,*p;
+ int x,y;
+
+ for(y=0;y<16;y++)
+  {
+   p=(unsigned int *)(psxVuw+(((ty<<4)+y)<<10)+(tx<<6));
+   for(x=0;x<32;x++)
+    h=(h^p[x])*0x01000193;
+  }
+
+ return h|1;
+}
+
+// rehash the tiles under an upload, TRUE if none of them changed
+static BOOL UpdateVRamHash(int X,int Y,int W,int H)
+{
+ int x,y,rows=iGPUHeight>>4;
+ unsigned int h,*t;
+ BOOL bSame=TRUE;
+
+ if(W>1023) W=1023;
+ if(H>iGPUHeight-1) H=iGPUHeight-1;
+
+ for(y=Y>>4;y<=(Y+H)>>4;y++)
+  for(x=X>>6;x<=(X+W)>>6;x++)
+   {
+    t=&uiVRamTileHash[y&(rows-1)][x&15];
+    h=HashVRamTile(x&15,y&(rows-1));
+    if(*t!=h) {*t=h;bSame=FALSE;}
+   }
+
+ return bSame;
+}
+
+////////////////////////////////////////////////////////////////////////
+
 void InvalidateTextureAreaEx(void)
 {
  short W=sxmax-sxmin;
@@ -867,6 +955,8 @@ void InvalidateTextureAreaEx(void)
 
  if(W==0 && H==0) return;
 
+ ForgetVRamHash(sxmin,symin,W,H);
+
  if(iMaxTexWnds) 
   InvalidateWndTextureArea(sxmin,symin,W,H);
 
@@ -879,6 +969,28 @@ void InvalidateTextureArea(int X,int Y,int W, int H)
 {
  if(W==0 && H==0) return;
 
+ ForgetVRamHash(X,Y,W,H);
+
+ if(iMaxTexWnds) InvalidateWndTextureArea(X,Y,W,H); 
+
+ InvalidateSubSTextureArea(X,Y,W,H);
+}
+
+////////////////////////////////////////////////////////////////////////
+// vram upload done: same as above, unless the content hash says the
+// game just sent the texels that were there already
+////////////////////////////////////////////////////////////////////////
+
+void InvalidateTextureUpload(int X,int Y,int W, int H)
+{
+ if(W==0 && H==0) return;
+
+ if(iTexContentHash)
+  {
+   if(UpdateVRamHash(X,Y,W,H)) return;
+  }
+ else ForgetVRamHash(X,Y,W,H);
+
  if(iMaxTexWnds) InvalidateWndTextureArea(X,Y,W,H); 
 
  InvalidateSubSTextureArea(X,Y,W,H);
@@ -2464,11 +2576,216 @@ GLuint Fake15BitTexture(void)
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////
+// palette content hash, the CLUT words are 32 bit aligned (x is 16*n)
+////////////////////////////////////////////////////////////////////////
+
+static unsigned int HashClut(unsigned short * clut,int count)
+{
+ unsigned int h=0x811c9dc5,*p=(unsigned int *)clut;
+ int i;
+
+ for(i=0;i<count/2;i++)
+  h=(h^p[i])*0x01000193;
+
+ return h;
+}
+
+// the 14 bits that go into ClutID, so changed contents miss the cache
+static unsigned int ClutKeyHash(unsigned short * clut,int count)
+{
+ unsigned int h=HashClut(clut,count);
+ return (h^(h>>14)^(h>>28))&0x3fff;
+}
+
+// look up (or convert into the pool) a 16/256 entry palette, keeps the
+// ubOpaqueDraw side effect of the conversion funcs
+static unsigned int * GetPoolPalette(unsigned short * clut,int count,unsigned int (*fn) (unsigned int))
+{
+ unsigned int h=HashClut(clut,count);
+ palPoolEntry * e;
+ int i,iOldOpaque;
+
+ for(i=0;i<PALPOOL_SIZE;i++)
+  {
+   e=&palPool[i];
+   if(e->count==count && e->hash==h && e->fn==fn && e->semi==DrawSemiTrans &&
+      !memcmp(e->clut,clut,count*2))
+    {
+     if(e->opaque) ubOpaqueDraw=1;
+     return e->pal;
+    }
+  }
+
+ e=&palPool[iPalPoolTurn];
+ iPalPoolTurn=(iPalPoolTurn+1)&(PALPOOL_SIZE-1);
+
+ iOldOpaque=ubOpaqueDraw;ubOpaqueDraw=0;
+ for(i=0;i<count;i++) e->pal[i]=fn(clut[i]);
+ e->opaque=ubOpaqueDraw;
+ ubOpaqueDraw|=iOldOpaque;
+
+ memcpy(e->clut,clut,count*2);
+ e->hash=h;e->fn=fn;e->count=count;e->semi=DrawSemiTrans;
+ return e->pal;
+}
+
+////////////////////////////////////////////////////////////////////////
+// palettized sub texture conversion, rows y1..y2 of the page at src
+// into ta, optionally split with a helper thread: the palette lookups
+// have no side effects, so the lower half of a big load is converted on
+// another core while the GL thread does the upper one and uploads after
+////////////////////////////////////////////////////////////////////////
+
+#define TEXCONV_SPLIT_ROWS 64
+
+typedef struct texConvJobTag
+{
+ int             mode;                                 // 0: 4 bit, 1: 8 bit
+ unsigned int  * pa;
+ unsigned int  * ta;
+ unsigned char * src;
+ unsigned int    x1,x2,y1,y2,xalign;
+} texConvJob;
+
+static struct
+{
+ pthread_t       thread;
+ pthread_mutex_t lock;
+ pthread_cond_t  cond;
+ int             started,busy,quit;
+ texConvJob      job;
+} tc;
+
+static void TexConvDo(texConvJob * jb)
+{
+ unsigned int * pa=jb->pa, * ta=jb->ta;
+ unsigned int x1=jb->x1,x2=jb->x2,dx=x2-x1+1;
+ unsigned int column,row,j,sxh,sxm,x2a;
+ unsigned char * cSRCPtr;
+
+ if(jb->mode==0)
+  {
+   x2a=x2?(x2-1):0;
+   sxm=x1&1;sxh=x1>>1;
+   j=sxm?(x1+1):x1;
+   for(column=jb->y1;column<=jb->y2;column++)
+    {
+     cSRCPtr = jb->src + (column<<11) + sxh;
+
+     if(sxm) *ta++=*(pa+((*cSRCPtr++ >> 4) & 0xF));
+
+     for(row=j;row<x2a;row+=2)
+      {
+       *ta    =*(pa+(*cSRCPtr & 0xF));
+       *(ta+1)=*(pa+((*cSRCPtr >> 4) & 0xF));
+       cSRCPtr++;ta+=2;
+      }
+
+     if(row<=x2)
+      {
+       *ta++=*(pa+(*cSRCPtr & 0xF)); row++;
+       if(row<=x2) *ta++=*(pa+((*cSRCPtr >> 4) & 0xF));
+      }
+
+     ta+=jb->xalign;
+    }
+  }
+ else
+  {
+   for(column=jb->y1;column<=jb->y2;column++)
+    {
+     cSRCPtr = jb->src + (column<<11) + x1;
+     row=dx;
+     do {*ta++=*(pa+(*cSRCPtr++));row--;} while(row);
+     ta+=jb->xalign;
+    }
+  }
+}
+
+static void * TexConvThread(void * arg)
+{
+ pthread_mutex_lock(&tc.lock);
+ for(;;)
+  {
+   while(!tc.busy && !tc.quit) pthread_cond_wait(&tc.cond,&tc.lock);
+   if(tc.quit) break;
+   pthread_mutex_unlock(&tc.lock);
+
+   TexConvDo(&tc.job);
+
+   pthread_mutex_lock(&tc.lock);
+   tc.busy=0;
+   pthread_cond_broadcast(&tc.cond);
+  }
+ pthread_mutex_unlock(&tc.lock);
+ return NULL;
+}
+
+static BOOL TexConvStart(void)
+{
+ if(tc.started) return TRUE;
+
+ pthread_mutex_init(&tc.lock,NULL);
+ pthread_cond_init(&tc.cond,NULL);
+ tc.busy=tc.quit=0;
+ if(pthread_create(&tc.thread,NULL,TexConvThread,NULL))
+  {
+   fprintf(stderr,"gles: no texture conversion thread\n");
+   pthread_cond_destroy(&tc.cond);
+   pthread_mutex_destroy(&tc.lock);
+   iTexConvThread=0;
+   return FALSE;
+  }
+ tc.started=1;
+ return TRUE;
+}
+
+void TexConvStop(void)
+{
+ if(!tc.started) return;
+
+ pthread_mutex_lock(&tc.lock);
+ tc.quit=1;
+ pthread_cond_broadcast(&tc.cond);
+ pthread_mutex_unlock(&tc.lock);
+ pthread_join(tc.thread,NULL);
+ pthread_cond_destroy(&tc.cond);
+ pthread_mutex_destroy(&tc.lock);
+ tc.started=0;
+}
+
+static void TexConvRun(texConvJob * jb)
+{
+ unsigned int rows=(jb->y2-jb->y1+1)/2;
+
+ if(!iTexConvThread || rows<TEXCONV_SPLIT_ROWS/2 || !TexConvStart())
+  {
+   TexConvDo(jb);
+   return;
+  }
+
+ pthread_mutex_lock(&tc.lock);
+ tc.job=*jb;
+ tc.job.y1=jb->y1+rows;
+ tc.job.ta=jb->ta+rows*(jb->x2-jb->x1+1+jb->xalign);
+ tc.busy=1;
+ pthread_cond_broadcast(&tc.cond);
+ pthread_mutex_unlock(&tc.lock);
+
+ jb->y2=jb->y1+rows-1;
+ TexConvDo(jb);
+
+ pthread_mutex_lock(&tc.lock);
+ while(tc.busy) pthread_cond_wait(&tc.cond,&tc.lock);
+ pthread_mutex_unlock(&tc.lock);
+}
+
 void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
 {
- unsigned int  start,row,column,j,sxh,sxm;
+ unsigned int  start,row,column;
  unsigned int   palstart;
- unsigned int  *px,*pa,*ta;
+ unsigned int  *pa,*ta;
  unsigned char  *cSRCPtr;
  unsigned short *wSRCPtr;
  unsigned int  LineOffset;
@@ -2483,10 +2800,11 @@ void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
  unsigned int (*LTCOL)(unsigned int);
  unsigned int a,r,g,b,cnt,h;
  unsigned int scol[8];
+ texConvJob jb;
  
  LTCOL=TCF[DrawSemiTrans];
 
- pa=px=(unsigned int *)ubPaletteBuffer;
+ pa=(unsigned int *)ubPaletteBuffer;
  ta=(unsigned int *)texturepart;
  palstart=cx+(cy<<10);
 
@@ -2504,17 +2822,7 @@ void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
      {
       unsigned int TXV,TXU,n_xi,n_yi;
 
-      wSRCPtr=psxVuw+palstart;
-
-      row=4;do
-       {
-        *px    =LTCOL(*wSRCPtr);
-        *(px+1)=LTCOL(*(wSRCPtr+1));
-        *(px+2)=LTCOL(*(wSRCPtr+2));
-        *(px+3)=LTCOL(*(wSRCPtr+3));
-        row--;px+=4;wSRCPtr+=4;
-       }
-      while (row);
+      pa=GetPoolPalette(psxVuw+palstart,16,LTCOL);
 
       for(TXV=y1;TXV<=y2;TXV++)
        {
@@ -2533,42 +2841,11 @@ void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
     start=((pageid-16*pmult)<<7)+524288*pmult;
     // convert CLUT to 32bits .. and then use THAT as a lookup table
 
-    wSRCPtr=psxVuw+palstart;
-
-    row=4;do
-     {
-      *px    =LTCOL(*wSRCPtr);
-      *(px+1)=LTCOL(*(wSRCPtr+1));
-      *(px+2)=LTCOL(*(wSRCPtr+2));
-      *(px+3)=LTCOL(*(wSRCPtr+3));
-      row--;px+=4;wSRCPtr+=4;
-     }
-    while (row);
+    pa=GetPoolPalette(psxVuw+palstart,16,LTCOL);
 
-    x2a=x2?(x2-1):0;//if(x2) x2a=x2-1; else x2a=0;
-    sxm=x1&1;sxh=x1>>1;
-    j=sxm?(x1+1):x1;//if(sxm) j=x1+1; else j=x1;
-    for(column=y1;column<=y2;column++)
-     {
-      cSRCPtr = psxVub + start + (column<<11) + sxh;
-    
-      if(sxm) *ta++=*(pa+((*cSRCPtr++ >> 4) & 0xF));
-
-      for(row=j;row<x2a;row+=2)
-       {
-        *ta    =*(pa+(*cSRCPtr & 0xF)); 
-        *(ta+1)=*(pa+((*cSRCPtr >> 4) & 0xF)); 
-        cSRCPtr++;ta+=2;
-       }
-
-      if(row<=x2) 
-       {
-        *ta++=*(pa+(*cSRCPtr & 0xF)); row++;
-        if(row<=x2) *ta++=*(pa+((*cSRCPtr >> 4) & 0xF));
-       }
-
-      ta+=xalign;
-     }
+    jb.mode=0;jb.pa=pa;jb.ta=ta;jb.src=psxVub+start;
+    jb.x1=x1;jb.x2=x2;jb.y1=y1;jb.y2=y2;jb.xalign=xalign;
+    TexConvRun(&jb);
 
     break;
    //--------------------------------------------------// 
@@ -2578,17 +2855,7 @@ void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
      {
       unsigned int TXV,TXU,n_xi,n_yi;
 
-      wSRCPtr=psxVuw+palstart;
-
-      row=64;do
-       {
-        *px    =LTCOL(*wSRCPtr);
-        *(px+1)=LTCOL(*(wSRCPtr+1));
-        *(px+2)=LTCOL(*(wSRCPtr+2));
-        *(px+3)=LTCOL(*(wSRCPtr+3));
-        row--;px+=4;wSRCPtr+=4;
-       }
-      while (row);
+      pa=GetPoolPalette(psxVuw+palstart,256,LTCOL);
 
       for(TXV=y1;TXV<=y2;TXV++)
        {
@@ -2612,26 +2879,11 @@ void LoadSubTexturePageSort(int pageid, int mode, short cx, short cy)
 
     if(dy*dx>384)
      {
-      wSRCPtr=psxVuw+palstart;
+      pa=GetPoolPalette(psxVuw+palstart,256,LTCOL);
 
-      row=64;do
-       {
-        *px    =LTCOL(*wSRCPtr);
-        *(px+1)=LTCOL(*(wSRCPtr+1));
-        *(px+2)=LTCOL(*(wSRCPtr+2));
-        *(px+3)=LTCOL(*(wSRCPtr+3));
-        row--;px+=4;wSRCPtr+=4;
-       }
-      while (row);
-
-      column=dy;do 
-       {
-        row=dx;
-        do {*ta++=*(pa+(*cSRCPtr++));row--;} while(row);
-        ta+=xalign;
-        cSRCPtr+=LineOffset;column--;
-       }
-      while(column);
+      jb.mode=1;jb.pa=pa;jb.ta=ta;jb.src=psxVub+start;
+      jb.x1=x1;jb.x2=x2;jb.y1=y1;jb.y2=y2;jb.xalign=xalign;
+      TexConvRun(&jb);
      }
     else
      {
@@ -4003,8 +4255,7 @@ void CompressTextureSpace(void)
  int i,j,k,m,n,iMax;EXLong * ul, r,opos;
  short sOldDST=DrawSemiTrans,cx,cy;
  int  lOGTP=GlobalTexturePage;
- unsigned int l,row;
- unsigned int * lSRCPtr;
+ unsigned int l;
 
  opos.l=*((unsigned int *)&gl_ux[4]);
 
@@ -4058,11 +4309,8 @@ void CompressTextureSpace(void)
 
              if(j!=2)
               {
-               // palette check sum
-               l=0;lSRCPtr=(unsigned int *)(psxVuw+cx+(cy*1024));
-               if(j==1) for(row=1;row<129;row++) l+=((*lSRCPtr++)-1)*row;
-               else     for(row=1;row<9;row++)   l+=((*lSRCPtr++)-1)<<row;
-               l=((l+HIWORD(l))&0x3fffL)<<16;
+               // palette content hash
+               l=ClutKeyHash(psxVuw+cx+(cy*1024),j==1?256:16)<<16;
                if(l!=(tsx->ClutID&(0x00003fff<<16)))
                 {
                  tsx->ClutID=0;continue;
@@ -4172,16 +4420,8 @@ GLuint SelectSubTextureS(int TextureMode, unsigned int GivenClutId)
    cy=((GivenClutId >> 6) & CLUTYMASK);
    GivenClutId=(GivenClutId&CLUTMASK)|(DrawSemiTrans<<30)|CLUTUSED;
 
-   // palette check sum.. removed MMX asm, this easy func works as well
-    {
-     unsigned int l=0,row;
-
-     unsigned int * lSRCPtr=(unsigned int *)(psxVuw+cx+(cy*1024));
-     if(TextureMode==1) for(row=1;row<129;row++) l+=((*lSRCPtr++)-1)*row;
-     else               for(row=1;row<9;row++)   l+=((*lSRCPtr++)-1)<<row;
-     l=(l+HIWORD(l))&0x3fffL;
-     GivenClutId|=(l<<16);
-    }
+   // palette content hash, a changed CLUT at the same place misses
+   GivenClutId|=ClutKeyHash(psxVuw+cx+(cy*1024),TextureMode==1?256:16)<<16;
 
   }
 
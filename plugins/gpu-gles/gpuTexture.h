@@ -40,8 +40,10 @@ GLuint         LoadTextureWnd(int pageid,int TextureMode,unsigned int GivenClutI
 GLuint         LoadTextureMovie(void);
 void           InvalidateTextureArea(int imageX0,int imageY0,int imageX1,int imageY1);
 void           InvalidateTextureAreaEx(void);
+void           InvalidateTextureUpload(int X,int Y,int W,int H);
 void           LoadTexturePage(int pageid, int mode, short cx, short cy);
 void           ResetTextureArea(BOOL bDelTex);
+void           TexConvStop(void);
 GLuint         SelectSubTextureS(int TextureMode, unsigned int GivenClutId);
 void           CheckTextureMemory(void);
 
@@ -24,6 +24,12 @@
 
 static int is_opened;
 
+// vram written through gpulib since the last vsync, and the rgb24 rect
+// that was last put on screen, to keep display uploads to what changed
+static PSXRect_t xrDirtyArea;
+static BOOL      bDirtyArea;
+static PSXRect_t xrLastUpload;
+
 static const short dispWidths[8] = {256,320,512,640,368,384,512,640};
 short g_m1,g_m2,g_m3;
 short DrawSemiTrans;
@@ -62,7 +68,16 @@ BOOL            bDisplayNotSet;
 BOOL            bNeedWriteUpload;
 int             iLastRGB24;
 
-// don't do GL vram read
+static int      iGLThread;
+
+static int  glq_on(void);
+static void glq_add(int op, const void *data, int words);
+enum { GLQ_PAD, GLQ_CMDS, GLQ_STATUS, GLQ_ECMDS, GLQ_CACHES, GLQ_VOUT };
+#define GLQ_CHUNK 4096 // max cmd words per queue entry
+
+// don't do GL vram read: gpulib serves reads from the soft copy in
+// psxVuw, so nothing here ever waits on glReadPixels. GLES 1.1 has no
+// pixel buffer objects, so an async read would be no cheaper anyway
 void CheckVRamRead(int x, int y, int dx, int dy, bool bFront)
 {
 }
@@ -90,6 +105,27 @@ static void PaintBlackBorders(void)
 
 static void fps_update(void);
 
+// a still rgb24 screen (paused or slower than vsync movies) is already
+// on screen, nothing else drew and no write hit it, so skip the reupload
+static BOOL RGB24ScreenUnchanged(void)
+{
+ if(bNeedRGB24Update || PSXDisplay.Interlaced) return FALSE;
+ if(iDrawnSomething || lClearOnSwap) return FALSE;
+ return xrUploadArea.x0==xrLastUpload.x0 && xrUploadArea.x1==xrLastUpload.x1 &&
+        xrUploadArea.y0==xrLastUpload.y0 && xrUploadArea.y1==xrLastUpload.y1;
+}
+
+// clip a full screen upload to the vram written since the last vsync
+static BOOL ClipUploadToDirty(void)
+{
+ if(!bDirtyArea) return FALSE;
+ xrUploadArea.x0=max(xrUploadArea.x0,xrDirtyArea.x0);
+ xrUploadArea.x1=min(xrUploadArea.x1,xrDirtyArea.x1);
+ xrUploadArea.y0=max(xrUploadArea.y0,xrDirtyArea.y0);
+ xrUploadArea.y1=min(xrUploadArea.y1,xrDirtyArea.y1);
+ return xrUploadArea.x0<xrUploadArea.x1 && xrUploadArea.y0<xrUploadArea.y1;
+}
+
 void updateDisplay(void)
 {
  bFakeFrontBuffer=FALSE;
@@ -98,7 +134,12 @@ void updateDisplay(void)
  if(PSXDisplay.RGB24)// && !bNeedUploadAfter)         // (mdec) upload wanted?
  {
   PrepareFullScreenUpload(-1);
-  UploadScreen(PSXDisplay.Interlaced);                // -> upload whole screen from psx vram
+  if(!RGB24ScreenUnchanged())
+   {
+    UploadScreen(PSXDisplay.Interlaced);              // -> upload whole screen from psx vram
+    if(!bSkipNextFrame && !bNeedRGB24Update) xrLastUpload=xrUploadArea;
+    else memset(&xrLastUpload,0,sizeof(xrLastUpload));
+   }
   bNeedUploadTest=FALSE;
   bNeedInterlaceUpdate=FALSE;
   bNeedUploadAfter=FALSE;
@@ -128,7 +169,7 @@ void updateDisplay(void)
  if(iDrawnSomething)
  {
   fps_update();
-  eglSwapBuffers(display, surface);
+  GLswapBuffers();
   iDrawnSomething=0;
  }
 
@@ -178,9 +219,12 @@ void updateDisplay(void)
      PreviousPSXDisplay.DisplayEnd.y==PSXDisplay.DisplayEnd.y)
    {
     PrepareFullScreenUpload(TRUE);
-    UploadScreen(TRUE);
+    if(ClipUploadToDirty())                           // -> only what was written
+     UploadScreen(TRUE);
    }
  }
+
+ bDirtyArea=FALSE;
 }
 
 void updateFrontDisplay(void)
@@ -193,7 +237,7 @@ void updateFrontDisplay(void)
  bRenderFrontBuffer=FALSE;
 
  if(iDrawnSomething)                                  // linux:
-  eglSwapBuffers(display, surface);
+  GLswapBuffers();
 }
 
 static void ChangeDispOffsetsX(void)                  // CENTER X
@@ -314,12 +358,21 @@ ChangeDispOffsetsX();
 if(bUp) updateDisplay();                              // yeah, real update (swap buffer)
 }
 
+static void DoWriteStatus(unsigned int gdata);
+
 #define GPUwriteStatus_ext GPUwriteStatus_ext // for gpulib to see this
 void GPUwriteStatus_ext(unsigned int gdata)
 {
  if (!is_opened)
   return;
+ if (glq_on())
+  glq_add(GLQ_STATUS, &gdata, 1);
+ else
+  DoWriteStatus(gdata);
+}
 
+static void DoWriteStatus(unsigned int gdata)
+{
 switch((gdata>>24)&0xff)
  {
   case 0x00:
@@ -481,6 +534,8 @@ switch((gdata>>24)&0xff)
 
 #include <stdint.h>
 
+// the flip and interlace changes are queued behind the prims (GL thread)
+#define RENDERER_ORDERED_DISPLAY
 #include "../gpulib/gpu.c"
 
 static void set_vram(void *vram)
@@ -548,8 +603,10 @@ void renderer_notify_screen_change(const struct psx_gpu_screen *screen)
 extern const unsigned char cmd_lengths[256];
 
 // XXX: mostly dupe code from soft peops
-int renderer_do_cmd_list(uint32_t *list, int list_len, uint32_t *ex_regs,
- int *cycles_sum_out, int *cycles_last, int *last_cmd)
+// !draw: only split the list up for the GL thread, tracking the texpage
+// bits that the prims would otherwise leave in lGPUstatusRet
+static int do_cmd_list(uint32_t *list, int list_len, uint32_t *ex_regs,
+ int *last_cmd, int draw)
 {
   unsigned int cmd, len;
   unsigned int *list_start = list;
@@ -571,7 +628,12 @@ int renderer_do_cmd_list(uint32_t *list, int list_len, uint32_t *ex_regs,
       ex_regs[cmd & 7] = list[0];
 #endif
 
-    primTableJ[cmd]((void *)list);
+    if (draw)
+      primTableJ[cmd]((void *)list);
+    else if (0x20 <= cmd && cmd < 0x40 && (cmd & 4)) {
+      ex_regs[1] &= ~0x1ff;
+      ex_regs[1] |= (list[4 + ((cmd >> 4) & 1)] >> 16) & 0x1ff;
+    }
 
     switch(cmd)
     {
@@ -637,14 +699,40 @@ int renderer_do_cmd_list(uint32_t *list, int list_len, uint32_t *ex_regs,
   }
 
 breakloop:
-  ex_regs[1] &= ~0x1ff;
-  ex_regs[1] |= lGPUstatusRet & 0x1ff;
+  if (draw) {
+    ex_regs[1] &= ~0x1ff;
+    ex_regs[1] |= lGPUstatusRet & 0x1ff;
+  }
 
   *last_cmd = cmd;
   return list - list_start;
 }
 
-void renderer_sync_ecmds(uint32_t *ecmds)
+int renderer_do_cmd_list(uint32_t *list, int list_len, uint32_t *ex_regs,
+ int *cycles_sum_out, int *cycles_last, int *last_cmd)
+{
+  int done = 0, left, max, n;
+
+  if (!glq_on())
+    return do_cmd_list(list, list_len, ex_regs, last_cmd, 1);
+
+  // queued in chunks that end on cmd boundaries
+  for (;;) {
+    left = list_len - done;
+    max = left < GLQ_CHUNK ? left : GLQ_CHUNK;
+    n = do_cmd_list(list + done, max, ex_regs, last_cmd, 0);
+    if (n == 0 && max < left) // a huge polyline
+      n = do_cmd_list(list + done, max = left, ex_regs, last_cmd, 0);
+    if (n)
+      glq_add(GLQ_CMDS, list + done, n);
+    done += n;
+    if (max == left || (n < max && *last_cmd != -1))
+      break; // the end, an incomplete cmd or image i/o
+  }
+  return done;
+}
+
+static void DoSyncEcmds(const uint32_t *ecmds)
 {
   cmdTexturePage((unsigned char *)&ecmds[1]);
   cmdTextureWindow((unsigned char *)&ecmds[2]);
@@ -654,18 +742,53 @@ void renderer_sync_ecmds(uint32_t *ecmds)
   cmdSTP((unsigned char *)&ecmds[6]);
 }
 
-void renderer_update_caches(int x, int y, int w, int h, int state_changed)
+void renderer_sync_ecmds(uint32_t *ecmds)
+{
+ if (glq_on())
+  glq_add(GLQ_ECMDS, ecmds, 7);
+ else
+  DoSyncEcmds(ecmds);
+}
+
+static void DoUpdateCaches(int x, int y, int w, int h)
 {
  VRAMWrite.x = x;
  VRAMWrite.y = y;
  VRAMWrite.Width = w;
  VRAMWrite.Height = h;
+ if(!bDirtyArea)
+  {
+   xrDirtyArea.x0=x;   xrDirtyArea.x1=x+w;
+   xrDirtyArea.y0=y;   xrDirtyArea.y1=y+h;
+   bDirtyArea=TRUE;
+  }
+ else
+  {
+   xrDirtyArea.x0=min(xrDirtyArea.x0,x);
+   xrDirtyArea.x1=max(xrDirtyArea.x1,x+w);
+   xrDirtyArea.y0=min(xrDirtyArea.y0,y);
+   xrDirtyArea.y1=max(xrDirtyArea.y1,y+h);
+  }
  if(is_opened)
   CheckWriteUpdate();
 }
 
+void renderer_update_caches(int x, int y, int w, int h, int state_changed)
+{
+ if (glq_on()) {
+  uint32_t d[2] = { x | (y << 16), w | (h << 16) };
+  glq_add(GLQ_CACHES, d, 2);
+ }
+ else
+  DoUpdateCaches(x, y, w, h);
+}
+
+static void glq_sync(void);
+
+// gpulib is about to access vram (dma, savestates)
 void renderer_flush_queues(void)
 {
+ glq_sync();
 }
 
 void renderer_set_interlace(int enable, int is_odd)
@@ -682,22 +805,42 @@ int vout_finish(void)
   return 0;
 }
 
-int vout_update(void)
+static int DoVoutUpdate(void)
 {
+ int ret = 0;
+
  if(PSXDisplay.Interlaced)                            // interlaced mode?
  {
   if(PSXDisplay.DisplayMode.x>0 && PSXDisplay.DisplayMode.y>0)
    {
     updateDisplay();                                  // -> swap buffers (new frame)
-    return 1;
+    ret = 1;
    }
  }
  else if(bRenderFrontBuffer)                          // no interlace mode? and some stuff in front has changed?
  {
   updateFrontDisplay();                               // -> update front buffer
-  return 1;
+  ret = 1;
  }
- return 0;
+ return ret;
+}
+
+// pacing and frameskip are gpulib's and the frontend's, like for the
+// other renderers, the screen uploads and swap go into the perf gpu time
+// (the GL thread's time into the async one)
+int vout_update(void)
+{
+ uint32_t t0;
+ int ret;
+
+ if (glq_on()) {
+  glq_add(GLQ_VOUT, NULL, 0);
+  return 1; // shown once the thread gets there
+ }
+ t0 = gpu_perf_ticks(&gpu);
+ ret = DoVoutUpdate();
+ gpu_perf_add(&gpu, us, t0);
+ return ret;
 }
 
 void vout_blank(void)
@@ -708,6 +851,212 @@ void vout_set_config(const struct rearmed_cbs *cbs)
 {
 }
 
+////////////////////////////////////////////////////////////////////////
+// GL thread: with iGLThread the entry points above only queue their work
+// (cmd words split up on cmd boundaries, gp1 writes, cache updates and the
+// flip) and a thread that has the GL context current replays it in order,
+// so GL calls and driver stalls stop delaying the emulation. gpulib calls
+// renderer_flush_queues() before it touches vram itself (image i/o,
+// savestates), that's the only place the emu thread waits, apart from a
+// full queue. Started and stopped with GPUopen()/GPUclose(), the frontend
+// gets its context back for the menu.
+////////////////////////////////////////////////////////////////////////
+
+#define GLQ_LEN (64*1024) // words, power of 2
+
+static struct
+{
+ pthread_t       thread;
+ pthread_mutex_t lock;
+ pthread_cond_t  cond_work;  // -> thread
+ pthread_cond_t  cond_done;  // -> emu thread
+ EGLContext      ctx;
+ uint32_t        pos_add, pos_use; // free running word counts
+ int             on, quit, idle, waiting, started, failed;
+ uint32_t        buf[GLQ_LEN];
+} glq;
+
+static int glq_on(void)
+{
+ return glq.on;
+}
+
+// with the lock held
+static void glq_wait(void)
+{
+ if(gpu.frameskip.async_waits)                         // lets frameskip see we're behind
+  (*gpu.frameskip.async_waits)++;
+ glq.waiting=1;
+ pthread_cond_wait(&glq.cond_done,&glq.lock);
+}
+
+// entries don't wrap, the end of the ring is padded instead
+static void glq_add(int op, const void *data, int words)
+{
+ uint32_t pos,left,need;
+
+ pthread_mutex_lock(&glq.lock);
+ for(;;)
+  {
+   pos=glq.pos_add&(GLQ_LEN-1);
+   left=GLQ_LEN-pos;
+   need=words+1;
+   if(left<need) need+=left;
+   if(GLQ_LEN-(glq.pos_add-glq.pos_use)>=need) break;
+   glq_wait();
+  }
+ if(left<(uint32_t)words+1)
+  {
+   glq.buf[pos]=(GLQ_PAD<<24)|(left-1);
+   glq.pos_add+=left;
+   pos=0;
+  }
+ glq.buf[pos]=(op<<24)|words;
+ if(words) memcpy(&glq.buf[pos+1],data,words*4);
+ glq.pos_add+=words+1;
+ if(glq.idle) pthread_cond_signal(&glq.cond_work);
+ pthread_mutex_unlock(&glq.lock);
+}
+
+static void glq_sync(void)
+{
+ if(!glq.on) return;
+ pthread_mutex_lock(&glq.lock);
+ while(glq.pos_use!=glq.pos_add)
+  glq_wait();
+ pthread_mutex_unlock(&glq.lock);
+}
+
+static void glq_run(int op, uint32_t *data, int words)
+{
+ switch(op)
+  {
+   case GLQ_CMDS:
+    {
+     uint32_t ex_regs[8] = { 0, };
+     int cmd;
+     do_cmd_list(data,words,ex_regs,&cmd,1);
+     break;
+    }
+   case GLQ_STATUS: DoWriteStatus(data[0]); break;
+   case GLQ_ECMDS:  DoSyncEcmds(data); break;
+   case GLQ_CACHES:
+    DoUpdateCaches(data[0]&0xffff,data[0]>>16,data[1]&0xffff,data[1]>>16);
+    break;
+   case GLQ_VOUT:   DoVoutUpdate(); break;
+  }
+}
+
+static void *GLthread(void *unused)
+{
+ uint32_t pos,end,hdr,t0;
+ int ok;
+
+ ok=eglMakeCurrent(display,surface,surface,glq.ctx);
+ pthread_mutex_lock(&glq.lock);
+ glq.failed=!ok;
+ glq.started=1;
+ pthread_cond_broadcast(&glq.cond_done);
+ while(ok && !glq.quit)
+  {
+   if(glq.pos_use==glq.pos_add)
+    {
+     glq.idle=1;
+     pthread_cond_wait(&glq.cond_work,&glq.lock);
+     glq.idle=0;
+     continue;
+    }
+   end=glq.pos_add;
+   pthread_mutex_unlock(&glq.lock);
+
+   t0=gpu_perf_ticks(&gpu);
+   for(pos=glq.pos_use;pos!=end;)
+    {
+     hdr=glq.buf[pos&(GLQ_LEN-1)];
+     glq_run(hdr>>24,&glq.buf[(pos+1)&(GLQ_LEN-1)],hdr&0xffffff);
+     pos+=(hdr&0xffffff)+1;
+     if(pos-glq.pos_use>=GLQ_LEN/4)                    // make room for a waiting emu thread
+      {
+       pthread_mutex_lock(&glq.lock);
+       glq.pos_use=pos;
+       if(glq.waiting && pos!=end)
+        {
+         glq.waiting=0;
+         pthread_cond_broadcast(&glq.cond_done);
+        }
+       pthread_mutex_unlock(&glq.lock);
+      }
+    }
+   gpu_perf_add(&gpu,async_us,t0);
+
+   pthread_mutex_lock(&glq.lock);
+   glq.pos_use=end;
+   if(glq.waiting)
+    {
+     glq.waiting=0;
+     pthread_cond_broadcast(&glq.cond_done);
+    }
+  }
+ pthread_mutex_unlock(&glq.lock);
+ if(ok) eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+ return NULL;
+}
+
+static void glq_destroy(void)
+{
+ pthread_cond_destroy(&glq.cond_done);
+ pthread_cond_destroy(&glq.cond_work);
+ pthread_mutex_destroy(&glq.lock);
+}
+
+// the context is handed over, so it's current on the calling thread
+static void glq_start(void)
+{
+ glq.ctx=eglGetCurrentContext();
+ if(glq.ctx==EGL_NO_CONTEXT) return;
+ glFinish();
+
+ glq.pos_add=glq.pos_use=0;
+ glq.quit=glq.idle=glq.waiting=glq.started=glq.failed=0;
+ pthread_mutex_init(&glq.lock,NULL);
+ pthread_cond_init(&glq.cond_work,NULL);
+ pthread_cond_init(&glq.cond_done,NULL);
+
+ eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+ if(pthread_create(&glq.thread,NULL,GLthread,NULL))
+  {
+   glq_destroy();
+   eglMakeCurrent(display,surface,surface,glq.ctx);
+   return;
+  }
+ pthread_mutex_lock(&glq.lock);
+ while(!glq.started) pthread_cond_wait(&glq.cond_done,&glq.lock);
+ pthread_mutex_unlock(&glq.lock);
+ if(glq.failed)
+  {
+   printf("GLES thread: can't make the context current, rendering inline\n");
+   pthread_join(glq.thread,NULL);
+   glq_destroy();
+   eglMakeCurrent(display,surface,surface,glq.ctx);
+   return;
+  }
+ glq.on=1;
+}
+
+static void glq_stop(void)
+{
+ if(!glq.on) return;
+ glq_sync();
+ pthread_mutex_lock(&glq.lock);
+ glq.quit=1;
+ pthread_cond_signal(&glq.cond_work);
+ pthread_mutex_unlock(&glq.lock);
+ pthread_join(glq.thread,NULL);
+ glq.on=0;
+ glq_destroy();
+ eglMakeCurrent(display,surface,surface,glq.ctx);      // back to the frontend's thread
+}
+
 static struct rearmed_cbs *cbs;
 
 long GPUopen(unsigned long *disp, char *cap, char *cfg)
@@ -727,11 +1076,14 @@ long GPUopen(unsigned long *disp, char *cap, char *cfg)
  bDisplayNotSet = TRUE; 
  bSetClip = TRUE;
  CSTEXTURE = CSVERTEX = CSCOLOR = 0;
+ memset(&xrLastUpload, 0, sizeof(xrLastUpload));       // new surface, nothing shown yet
 
  InitializeTextureStore();                             // init texture mem
 
  ret = GLinitialize(cbs->gles_display, cbs->gles_surface);
  MakeDisplayLists();
+ if (ret == 0 && iGLThread)
+  glq_start();
 
  is_opened = 1;
  return ret;
@@ -741,6 +1093,7 @@ long GPUclose(void)
 {
  if (!is_opened)
   return 0;
+ glq_stop();
  is_opened = 0;
 
  KillDisplayLists();
@@ -753,6 +1106,7 @@ long GPUclose(void)
 void renderer_set_config(const struct rearmed_cbs *cbs_)
 {
  cbs = (void *)cbs_; // ugh..
+ glq_sync();                                           // the thread reads the options
 
  iOffscreenDrawing = 0;
  iZBufferDepth = 0;
@@ -768,6 +1122,10 @@ void renderer_set_config(const struct rearmed_cbs *cbs_)
  bAdvancedBlend = cbs->gpu_peopsgl.bAdvancedBlend;
  bUseFastMdec = cbs->gpu_peopsgl.bUseFastMdec;
  iTexGarbageCollection = cbs->gpu_peopsgl.iTexGarbageCollection;
+ iTexContentHash = cbs->gpu_peopsgl.iTexContentHash;
+ iTexConvThread = cbs->gpu_peopsgl.iTexConvThread;
+ iGLThread = cbs->gpu_peopsgl.iGLThread;              // from the next GPUopen()
+ iUseFBO = cbs->gpu_peopsgl.iUseFBO;
  iVRamSize = cbs->gpu_peopsgl.iVRamSize;
 
  if (cbs->pl_set_gpu_caps)
@@ -60,7 +60,6 @@ u32 left_split_triangles = 0;
 u32 flat_triangles = 0;
 u32 clipped_triangles = 0;
 u32 zero_block_spans = 0;
-u32 texture_cache_loads = 0;
 u32 false_modulated_blocks = 0;
 
 #define stats_add(stat, count) // stat += count
@@ -263,51 +262,73 @@ u32 invalidate_texture_cache_region_viewport(psx_gpu_struct *psx_gpu, u32 x1,
   return mask;
 }
 
-static void update_texture_cache_region_(psx_gpu_struct *psx_gpu,
- u32 x1, u32 y1, u32 x2, u32 y2)
+// re-expand the 4x16 halfword vram block at x, y (block aligned)
+static void update_texture_4bpp_cache_block(psx_gpu_struct *psx_gpu,
+ u32 x, u32 y)
 {
-  u32 mask = texture_region_mask(x1, y1, x2, y2);
-  u32 texture_page;
-  u8 *texture_page_ptr;
-  u16 *vram_ptr;
+  u32 texture_page = ((x / 64) & 15) + (y / 256) * 16;
+  u8 *texture_page_ptr = psx_gpu->texture_4bpp_cache[texture_page];
+  u16 *vram_ptr = psx_gpu->vram_ptr + x + y * 1024;
   u32 texel_block;
   u32 sub_x, sub_y;
 
-  psx_gpu->dirty_textures_8bpp_mask |= mask;
-  psx_gpu->dirty_textures_8bpp_alternate_mask |= mask;
+  texture_page_ptr += (x / 4 & 15) * 16*16 + (y / 16 & 15) * 16*16*16;
+  sub_x = 4;
+  sub_y = 16;
 
-  if ((psx_gpu->dirty_textures_4bpp_mask & mask) == 0 &&
-      (x1 & 3) == 0 && (y1 & 15) == 0 && x2 - x1 < 4 && y2 - y1 < 16)
+  while(sub_y)
   {
-    texture_page = ((x1 / 64) & 15) + (y1 / 256) * 16;
-    texture_page_ptr = psx_gpu->texture_4bpp_cache[texture_page];
-    texture_page_ptr += (x1 / 4 & 15) * 16*16 + (y1 / 16 & 15) * 16*16*16;
-    vram_ptr = psx_gpu->vram_ptr + x1 + y1 * 1024;
+    while(sub_x)
+    {
+      texel_block = *vram_ptr;
+
+      texture_page_ptr[0] = texel_block & 0xF;
+      texture_page_ptr[1] = (texel_block >> 4) & 0xF;
+      texture_page_ptr[2] = (texel_block >> 8) & 0xF;
+      texture_page_ptr[3] = texel_block >> 12;
+      
+      vram_ptr++;
+      texture_page_ptr += 4;
+
+      sub_x--;          
+    }
+
+    vram_ptr -= 4;
     sub_x = 4;
-    sub_y = 16;
 
-    while(sub_y)
-    {
-      while(sub_x)
-      {
-        texel_block = *vram_ptr;
+    sub_y--;
+    vram_ptr += 1024;
+  }
+}
 
-        texture_page_ptr[0] = texel_block & 0xF;
-        texture_page_ptr[1] = (texel_block >> 4) & 0xF;
-        texture_page_ptr[2] = (texel_block >> 8) & 0xF;
-        texture_page_ptr[3] = texel_block >> 12;
-        
-        vram_ptr++;
-        texture_page_ptr += 4;
+// Uploads of up to a 64x64 texel tile (16 4bpp cache blocks) into a page
+// that is otherwise clean are expanded right away, so that small per frame
+// updates (animated sprites and such) don't have the whole page expanded
+// again on next use.  8bpp caches follow the current texture page and are
+// always redone whole.
+#define TEXTURE_CACHE_PARTIAL_BLOCKS 16
 
-        sub_x--;          
-      }
+static void update_texture_cache_region_(psx_gpu_struct *psx_gpu,
+ u32 x1, u32 y1, u32 x2, u32 y2)
+{
+  u32 mask = texture_region_mask(x1, y1, x2, y2);
+  u32 blocks_x = (x2 >> 2) - (x1 >> 2) + 1;
+  u32 blocks_y = (y2 >> 4) - (y1 >> 4) + 1;
+  u32 x, y;
+
+  psx_gpu->dirty_textures_8bpp_mask |= mask;
+  psx_gpu->dirty_textures_8bpp_alternate_mask |= mask;
 
-      vram_ptr -= 4;
-      sub_x = 4;
+  if ((psx_gpu->dirty_textures_4bpp_mask & mask) == 0 &&
+      (x1 >> 6) == (x2 >> 6) && (y1 >> 8) == (y2 >> 8) &&
+      blocks_x * blocks_y <= TEXTURE_CACHE_PARTIAL_BLOCKS)
+  {
+    psx_gpu->texture_cache_stats[1]++;
 
-      sub_y--;
-      vram_ptr += 1024;
+    for(y = y1 & ~15; y <= y2; y += 16)
+    {
+      for(x = x1 & ~3; x <= x2; x += 4)
+        update_texture_4bpp_cache_block(psx_gpu, x, y);
     }
   }
   else
@@ -347,7 +368,7 @@ void update_texture_4bpp_cache(psx_gpu_struct *psx_gpu)
   vram_ptr += (current_texture_page >> 4) * 256 * 1024;
   vram_ptr += (current_texture_page & 0xF) * 64;
 
-  texture_cache_loads++;
+  psx_gpu->texture_cache_stats[0]++;
 
   tile_y = 16;
   tile_x = 16;
@@ -408,7 +429,7 @@ void update_texture_8bpp_cache_slice(psx_gpu_struct *psx_gpu,
 
   vec_8x16u texels;
 
-  texture_cache_loads++;
+  psx_gpu->texture_cache_stats[0]++;
 
   vram_ptr += (texture_page >> 4) * 256 * 1024;
   vram_ptr += (texture_page & 0xF) * 64;
@@ -4274,6 +4295,37 @@ render_block_handler_struct render_sprite_block_handlers[] =
   render_sprite_blocks_switch_block()
 };
 
+// Raw, opaque 16bpp sprites with no window or wrap are a straight copy,
+// only the 0x0000 texels are skipped. The select in the loop is done for
+// every pixel so that the compiler can vectorize it.
+static noinline void render_sprite_16bpp_direct(psx_gpu_struct *psx_gpu,
+ s32 x, s32 y, u32 u, u32 v, s32 width, s32 height)
+{
+  const u16 *texture_ptr =
+   (u16 *)psx_gpu->texture_page_ptr + u + (v * 1024);
+  u16 *fb_ptr = psx_gpu->vram_out_ptr + x + (y * 1024);
+  u16 mask_msb = psx_gpu->mask_msb;
+  s32 i;
+
+  if(psx_gpu->num_blocks)
+    flush_render_block_buffer(psx_gpu);
+
+  stats_add(sprites_16bpp, 1);
+
+  while(height)
+  {
+    for(i = 0; i < width; i++)
+    {
+      u16 texel = texture_ptr[i];
+      fb_ptr[i] = texel ? (texel | mask_msb) : fb_ptr[i];
+    }
+
+    texture_ptr += 1024;
+    fb_ptr += 1024;
+    height--;
+  }
+}
+
 
 void render_sprite(psx_gpu_struct *psx_gpu, s32 x, s32 y, u32 u, u32 v,
  s32 *width, s32 *height, u32 flags, u32 color)
@@ -4354,6 +4406,18 @@ void render_sprite(psx_gpu_struct *psx_gpu, s32 x, s32 y, u32 u, u32 v,
   if(color == 0x808080)
     render_state |= RENDER_FLAGS_MODULATE_TEXELS;
 
+  if((render_state & (RENDER_FLAGS_MODULATE_TEXELS | RENDER_FLAGS_BLEND |
+   RENDER_FLAGS_TEXTURE_MAP | RENDER_STATE_MASK_EVALUATE |
+   (TEXTURE_MODE_16BPP << 8))) == (RENDER_FLAGS_MODULATE_TEXELS |
+   RENDER_FLAGS_TEXTURE_MAP | (TEXTURE_MODE_16BPP << 8)) &&
+   (psx_gpu->render_mode & RENDER_INTERLACE_ENABLED) == 0 &&
+   (psx_gpu->texture_mask_width & psx_gpu->texture_mask_height) == 0xFF &&
+   (u + *width <= 256) && (v + *height <= 256))
+  {
+    render_sprite_16bpp_direct(psx_gpu, x, y, u, v, *width, *height);
+    return;
+  }
+
   render_block_handler_struct *render_block_handler =
    &(render_sprite_block_handlers[render_state]);
   psx_gpu->render_block_handler = render_block_handler;
@@ -4373,12 +4437,18 @@ void render_sprite(psx_gpu_struct *psx_gpu, s32 x, s32 y, u32 u, u32 v,
   color_r = fixed_to_int(current_r);                                           \
   color_g = fixed_to_int(current_g);                                           \
   color_b = fixed_to_int(current_b);                                           \
-                                                                               \
+}                                                                              \
+
+// done for every pixel, also the clipped and masked ones
+#define draw_pixel_line_step_shaded()                                          \
+{                                                                              \
   current_r += gradient_r;                                                     \
   current_g += gradient_g;                                                     \
   current_b += gradient_b;                                                     \
 }                                                                              \
 
+#define draw_pixel_line_step_unshaded()                                        \
+
 #define draw_pixel_line_unshaded()                                             \
 {                                                                              \
   color_r = color & 0xFF;                                                      \
@@ -4501,6 +4571,7 @@ void render_sprite(psx_gpu_struct *psx_gpu, s32 x, s32 y, u32 u, u32 v,
        psx_gpu->mask_msb;                                                      \
     }                                                                          \
   }                                                                            \
+  draw_pixel_line_step_##shading()                                             \
 
 #define update_increment(value)                                                \
   value++                                                                      \
@@ -5065,6 +5136,11 @@ void initialize_psx_gpu(psx_gpu_struct *psx_gpu, u16 *vram)
 
   psx_gpu->viewport_start_x = psx_gpu->viewport_start_y = 0;
   psx_gpu->viewport_end_x = psx_gpu->viewport_end_y = 0;
+  psx_gpu->saved_viewport_start_x = psx_gpu->saved_viewport_start_y = 0;
+  psx_gpu->saved_viewport_end_x = psx_gpu->saved_viewport_end_y = 0;
+  psx_gpu->band_start_y = psx_gpu->band_end_y = 0;
+  psx_gpu->band_index = 0;
+  psx_gpu->band_count = 1;
   psx_gpu->mask_msb = 0;
 
   psx_gpu->texture_window_x = 0;
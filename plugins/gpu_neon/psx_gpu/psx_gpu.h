@@ -216,9 +216,21 @@ typedef struct
   u32 hack_disable_main:1;
   u32 hack_texture_adj:1;
 
+  // horizontal band of the drawing area this instance renders,
+  // see update_viewport_band()
+  s16 band_start_y;
+  s16 band_end_y;
+  u8 band_index;
+  u8 band_count;
+  u16 band_reserved;
+
+  // texture cache expansions, running totals: [0] whole pages,
+  // [1] partial 4bpp updates done by update_texture_cache_region()
+  u32 texture_cache_stats[2];
+
   // Align up to 64 byte boundary to keep the upcoming buffers cache line
   // aligned, also make reachable with single immediate addition
-  u8 reserved_a[68 + 9*4 - 9*sizeof(void *)];
+  u8 reserved_a[52 + 9*4 - 9*sizeof(void *)];
 
   // space for saving regs on c call to flush_render_block_buffer() and asm
   u32 saved_tmp[48 / sizeof(u32)];
@@ -50,7 +50,6 @@ extern u32 left_split_triangles;
 extern u32 flat_triangles;
 extern u32 clipped_triangles;
 extern u32 zero_block_spans;
-extern u32 texture_cache_loads;
 extern u32 false_modulated_blocks;
 
 static u32 mismatches;
@@ -98,7 +97,8 @@ void clear_stats(void)
   flat_triangles = 0;
   clipped_triangles = 0;
   zero_block_spans = 0;
-  texture_cache_loads = 0;
+  _psx_gpu.texture_cache_stats[0] = 0;
+  _psx_gpu.texture_cache_stats[1] = 0;
   false_modulated_blocks = 0;
 }
 
@@ -313,8 +313,9 @@ int main(int argc, char *argv[])
   printf("  %lf blocks per render buffer flush\n", (double)span_pixel_blocks /
    render_buffer_flushes);
   printf("  %d zero block spans\n", zero_block_spans);
-  printf("  %d state changes, %d texture cache loads\n", state_changes,
-   texture_cache_loads);
+  printf("  %d state changes, %d texture cache loads, %d partial\n",
+   state_changes, _psx_gpu.texture_cache_stats[0],
+   _psx_gpu.texture_cache_stats[1]);
   if(sprites)
   {
     printf("  %d sprites\n"
@@ -77,6 +77,7 @@ int main()
 	//WRITE_OFFSET(f, texture_settings);
 	WRITE_OFFSET(f, reciprocal_table_ptr);
 	WRITE_OFFSET(f, hacks_active);
+	WRITE_OFFSET(f, texture_cache_stats);
 	WRITE_OFFSET(f, saved_tmp);
 	//WRITE_OFFSET(f, saved_q4_q7);
 	WRITE_OFFSET(f, blocks);
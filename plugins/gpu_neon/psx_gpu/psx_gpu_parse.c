@@ -251,6 +251,30 @@ static void textured_sprite(psx_gpu_struct *psx_gpu, const u32 *list,
   gput_sum(*cpu_cycles_sum, *cpu_cycles, gput_sprite(width, height));
 }
 
+// Runs of the same textured sprite command (tile maps, text) are drawn
+// here without going back through the dispatch. Returns the last command
+// of the run, width 0 means each one has its own size.
+static u32 *textured_sprite_run(psx_gpu_struct *psx_gpu, u32 *list,
+  const u32 *list_end, s32 width, s32 height, u32 *cpu_cycles_sum,
+  u32 *cpu_cycles)
+{
+  u32 command = list[0] >> 24;
+  u32 length = 1 + command_lengths[command];
+
+  for(;;)
+  {
+    if(width == 0)
+      textured_sprite(psx_gpu, list, list[3] & 0x3FF, (list[3] >> 16) & 0x1FF,
+        cpu_cycles_sum, cpu_cycles);
+    else
+      textured_sprite(psx_gpu, list, width, height, cpu_cycles_sum, cpu_cycles);
+
+    if(list + length * 2 > list_end || (list[length] >> 24) != command)
+      return list;
+    list += length;
+  }
+}
+
 static void undo_offset(vertex_struct *vertexes, prepared_triangle *triangle)
 {
   s32 i;
@@ -282,6 +306,30 @@ static void do_quad(psx_gpu_struct *psx_gpu, vertex_struct *vertexes,
     render_triangle_p(psx_gpu, triangle.vertexes, current_command);
 }
 
+// The drawing area as set by E3/E4 lives in saved_viewport_*, the viewport
+// used for clipping is the part of it this instance renders (all of it
+// unless the area is split between several instances by rows).
+static void update_viewport_band(psx_gpu_struct *psx_gpu)
+{
+  s32 start = psx_gpu->saved_viewport_start_y;
+  s32 end = psx_gpu->saved_viewport_end_y;
+  s32 n = psx_gpu->band_count;
+
+  psx_gpu->band_start_y = start;
+  psx_gpu->band_end_y = end;
+  if(n > 1 && start <= end)
+  {
+    s32 h = end - start + 1, i = psx_gpu->band_index;
+    psx_gpu->band_start_y = start + h * i / n;
+    psx_gpu->band_end_y = start + h * (i + 1) / n - 1;
+  }
+
+  psx_gpu->viewport_start_x = psx_gpu->saved_viewport_start_x;
+  psx_gpu->viewport_end_x = psx_gpu->saved_viewport_end_x;
+  psx_gpu->viewport_start_y = psx_gpu->band_start_y;
+  psx_gpu->viewport_end_y = psx_gpu->band_end_y;
+}
+
 u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
  s32 *cpu_cycles_sum_out, s32 *cpu_cycles_last, u32 *last_command)
 {
@@ -302,6 +350,8 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
       current_command = (u32)-1;
       break;
     }
+    // long OT chains don't stay in cache, get the next packets coming
+    __builtin_prefetch(list + 16);
 
     switch(current_command)
     {
@@ -585,7 +635,7 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
       }
 
       case 0x64 ... 0x67:
-        textured_sprite(psx_gpu, list, list[3] & 0x3FF, (list[3] >> 16) & 0x1FF,
+        list = textured_sprite_run(psx_gpu, list, list_end, 0, 0,
           &cpu_cycles_sum, &cpu_cycles);
         break;
 
@@ -614,7 +664,8 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
       }
 
       case 0x74 ... 0x77:
-        textured_sprite(psx_gpu, list, 8, 8, &cpu_cycles_sum, &cpu_cycles);
+        list = textured_sprite_run(psx_gpu, list, list_end, 8, 8,
+          &cpu_cycles_sum, &cpu_cycles);
         break;
 
       case 0x78 ... 0x7B:
@@ -630,7 +681,8 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
       }
   
       case 0x7C ... 0x7F:
-        textured_sprite(psx_gpu, list, 16, 16, &cpu_cycles_sum, &cpu_cycles);
+        list = textured_sprite_run(psx_gpu, list, list_end, 16, 16,
+          &cpu_cycles_sum, &cpu_cycles);
         break;
   
 #ifdef PCSX
@@ -730,20 +782,22 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
         s16 viewport_start_x = list[0] & 0x3FF;
         s16 viewport_start_y = (list[0] >> 10) & 0x1FF;
 
-        if(viewport_start_x == psx_gpu->viewport_start_x &&
-         viewport_start_y == psx_gpu->viewport_start_y)
+        if(viewport_start_x == psx_gpu->saved_viewport_start_x &&
+         viewport_start_y == psx_gpu->saved_viewport_start_y)
         {
           break;
         }
   
-        psx_gpu->viewport_start_x = viewport_start_x;
-        psx_gpu->viewport_start_y = viewport_start_y;
+        psx_gpu->saved_viewport_start_x = viewport_start_x;
+        psx_gpu->saved_viewport_start_y = viewport_start_y;
+        update_viewport_band(psx_gpu);
 
 #ifdef TEXTURE_CACHE_4BPP
+        // whole area, so that all bands invalidate their caches alike
         psx_gpu->viewport_mask =
-         texture_region_mask(psx_gpu->viewport_start_x,
-         psx_gpu->viewport_start_y, psx_gpu->viewport_end_x,
-         psx_gpu->viewport_end_y);
+         texture_region_mask(psx_gpu->saved_viewport_start_x,
+         psx_gpu->saved_viewport_start_y, psx_gpu->saved_viewport_end_x,
+         psx_gpu->saved_viewport_end_y);
 #endif
         ex_regs[3] = list[0];
         break;
@@ -754,20 +808,22 @@ u32 gpu_parse(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_regs,
         s16 viewport_end_x = list[0] & 0x3FF;
         s16 viewport_end_y = (list[0] >> 10) & 0x1FF;
 
-        if(viewport_end_x == psx_gpu->viewport_end_x &&
-         viewport_end_y == psx_gpu->viewport_end_y)
+        if(viewport_end_x == psx_gpu->saved_viewport_end_x &&
+         viewport_end_y == psx_gpu->saved_viewport_end_y)
         {
           break;
         }
-
-        psx_gpu->viewport_end_x = viewport_end_x;
-        psx_gpu->viewport_end_y = viewport_end_y;
+  
+        psx_gpu->saved_viewport_end_x = viewport_end_x;
+        psx_gpu->saved_viewport_end_y = viewport_end_y;
+        update_viewport_band(psx_gpu);
 
 #ifdef TEXTURE_CACHE_4BPP
+        // whole area, so that all bands invalidate their caches alike
         psx_gpu->viewport_mask =
-         texture_region_mask(psx_gpu->viewport_start_x,
-         psx_gpu->viewport_start_y, psx_gpu->viewport_end_x,
-         psx_gpu->viewport_end_y);
+         texture_region_mask(psx_gpu->saved_viewport_start_x,
+         psx_gpu->saved_viewport_start_y, psx_gpu->saved_viewport_end_x,
+         psx_gpu->saved_viewport_end_y);
 #endif
         ex_regs[4] = list[0];
         break;
@@ -1228,6 +1284,8 @@ u32 gpu_parse_enhanced(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_reg
       current_command = (u32)-1;
       break;
     }
+    // long OT chains don't stay in cache, get the next packets coming
+    __builtin_prefetch(list + 16);
 
     enhancement_disable();
 
@@ -1756,9 +1814,9 @@ u32 gpu_parse_enhanced(psx_gpu_struct *psx_gpu, u32 *list, u32 size, u32 *ex_reg
     }
   }
 
+breakloop:
   enhancement_disable();
 
-breakloop:
   *cpu_cycles_sum_out += cpu_cycles_sum;
   *cpu_cycles_last = cpu_cycles;
   *last_command = current_command;
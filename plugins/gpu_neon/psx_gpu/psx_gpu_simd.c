@@ -2377,6 +2377,7 @@ static void update_texture_4bpp_cache(psx_gpu_struct *psx_gpu)
 
   gvdupq_n_u16(c_0x00f0, 0x00f0);
 
+  psx_gpu->texture_cache_stats[0]++;
   psx_gpu->dirty_textures_4bpp_mask &= ~(psx_gpu->current_texture_mask);
 
   for (tile_y = 16; tile_y; tile_y--)
@@ -2429,6 +2430,8 @@ void update_texture_8bpp_cache_slice(psx_gpu_struct *psx_gpu,
   u32 tile_x, tile_y;
   u32 sub_y;
 
+  psx_gpu->texture_cache_stats[0]++;
+
   vram_ptr += (texture_page >> 4) * 256 * 1024;
   vram_ptr += (texture_page & 0xF) * 64;
 
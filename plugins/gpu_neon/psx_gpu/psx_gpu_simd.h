@@ -1,91 +1,100 @@
 #include "vector_types.h"
 
-#ifdef ASM_PROTOTYPES
-#define compute_all_gradients compute_all_gradients_
-#define update_texture_8bpp_cache_slice update_texture_8bpp_cache_slice_
-#define setup_spans_up_left setup_spans_up_left_
-#define setup_spans_up_right setup_spans_up_right_
-#define setup_spans_down_left setup_spans_down_left_
-#define setup_spans_down_right setup_spans_down_right_
-#define setup_spans_up_a setup_spans_up_a_
-#define setup_spans_up_b setup_spans_up_b_
-#define setup_spans_down_a setup_spans_down_a_
-#define setup_spans_down_b setup_spans_down_b_
-#define setup_spans_up_down setup_spans_up_down_
+#if defined(ASM_PROTOTYPES)
+#define simd_name(n) n##_
+#elif defined(SIMD_VARIANT)
+// x86 builds the C code once per instruction set, see psx_gpu_simd_x86.c
+#define simd_name__(n, v) n##_##v
+#define simd_name_(n, v) simd_name__(n, v)
+#define simd_name(n) simd_name_(n, SIMD_VARIANT)
+#endif
+
+#ifdef simd_name
+#define compute_all_gradients simd_name(compute_all_gradients)
+#define update_texture_8bpp_cache_slice simd_name(update_texture_8bpp_cache_slice)
+#define setup_spans_up_left simd_name(setup_spans_up_left)
+#define setup_spans_up_right simd_name(setup_spans_up_right)
+#define setup_spans_down_left simd_name(setup_spans_down_left)
+#define setup_spans_down_right simd_name(setup_spans_down_right)
+#define setup_spans_up_a simd_name(setup_spans_up_a)
+#define setup_spans_up_b simd_name(setup_spans_up_b)
+#define setup_spans_down_a simd_name(setup_spans_down_a)
+#define setup_spans_down_b simd_name(setup_spans_down_b)
+#define setup_spans_up_down simd_name(setup_spans_up_down)
 #define setup_blocks_shaded_textured_dithered_unswizzled_indirect \
-	setup_blocks_shaded_textured_dithered_unswizzled_indirect_
+	simd_name(setup_blocks_shaded_textured_dithered_unswizzled_indirect)
 #define setup_blocks_shaded_untextured_dithered_unswizzled_indirect \
-	setup_blocks_shaded_untextured_dithered_unswizzled_indirect_
+	simd_name(setup_blocks_shaded_untextured_dithered_unswizzled_indirect)
 #define setup_blocks_shaded_untextured_undithered_unswizzled_indirect \
-	setup_blocks_shaded_untextured_undithered_unswizzled_indirect_
+	simd_name(setup_blocks_shaded_untextured_undithered_unswizzled_indirect)
 #define setup_blocks_shaded_untextured_dithered_unswizzled_direct \
-	setup_blocks_shaded_untextured_dithered_unswizzled_direct_
+	simd_name(setup_blocks_shaded_untextured_dithered_unswizzled_direct)
 #define setup_blocks_shaded_untextured_undithered_unswizzled_direct \
-	setup_blocks_shaded_untextured_undithered_unswizzled_direct_
+	simd_name(setup_blocks_shaded_untextured_undithered_unswizzled_direct)
 #define setup_blocks_unshaded_textured_dithered_unswizzled_indirect \
-	setup_blocks_unshaded_textured_dithered_unswizzled_indirect_
+	simd_name(setup_blocks_unshaded_textured_dithered_unswizzled_indirect)
 #define setup_blocks_unshaded_untextured_undithered_unswizzled_indirect \
-	setup_blocks_unshaded_untextured_undithered_unswizzled_indirect_
+	simd_name(setup_blocks_unshaded_untextured_undithered_unswizzled_indirect)
 #define setup_blocks_unshaded_untextured_undithered_unswizzled_direct \
-	setup_blocks_unshaded_untextured_undithered_unswizzled_direct_
+	simd_name(setup_blocks_unshaded_untextured_undithered_unswizzled_direct)
 #define setup_blocks_shaded_textured_dithered_swizzled_indirect \
-	setup_blocks_shaded_textured_dithered_swizzled_indirect_
+	simd_name(setup_blocks_shaded_textured_dithered_swizzled_indirect)
 #define setup_blocks_unshaded_textured_dithered_swizzled_indirect \
-	setup_blocks_unshaded_textured_dithered_swizzled_indirect_
-#define texture_blocks_untextured texture_blocks_untextured_
-#define texture_blocks_4bpp texture_blocks_4bpp_
-#define texture_blocks_8bpp texture_blocks_8bpp_
-#define texture_blocks_16bpp texture_blocks_16bpp_
+	simd_name(setup_blocks_unshaded_textured_dithered_swizzled_indirect)
+#define texture_blocks_untextured simd_name(texture_blocks_untextured)
+#define texture_blocks_4bpp simd_name(texture_blocks_4bpp)
+#define texture_blocks_8bpp simd_name(texture_blocks_8bpp)
+#define texture_blocks_16bpp simd_name(texture_blocks_16bpp)
 #define shade_blocks_shaded_textured_modulated_dithered_direct \
-	shade_blocks_shaded_textured_modulated_dithered_direct_
+	simd_name(shade_blocks_shaded_textured_modulated_dithered_direct)
 #define shade_blocks_shaded_textured_modulated_undithered_direct \
-	shade_blocks_shaded_textured_modulated_undithered_direct_
+	simd_name(shade_blocks_shaded_textured_modulated_undithered_direct)
 #define shade_blocks_unshaded_textured_modulated_dithered_direct \
-	shade_blocks_unshaded_textured_modulated_dithered_direct_
+	simd_name(shade_blocks_unshaded_textured_modulated_dithered_direct)
 #define shade_blocks_unshaded_textured_modulated_undithered_direct \
-	shade_blocks_unshaded_textured_modulated_undithered_direct_
+	simd_name(shade_blocks_unshaded_textured_modulated_undithered_direct)
 #define shade_blocks_shaded_textured_modulated_dithered_indirect \
-	shade_blocks_shaded_textured_modulated_dithered_indirect_
+	simd_name(shade_blocks_shaded_textured_modulated_dithered_indirect)
 #define shade_blocks_shaded_textured_modulated_undithered_indirect \
-	shade_blocks_shaded_textured_modulated_undithered_indirect_
+	simd_name(shade_blocks_shaded_textured_modulated_undithered_indirect)
 #define shade_blocks_unshaded_textured_modulated_dithered_indirect \
-	shade_blocks_unshaded_textured_modulated_dithered_indirect_
+	simd_name(shade_blocks_unshaded_textured_modulated_dithered_indirect)
 #define shade_blocks_unshaded_textured_modulated_undithered_indirect \
-	shade_blocks_unshaded_textured_modulated_undithered_indirect_
+	simd_name(shade_blocks_unshaded_textured_modulated_undithered_indirect)
 #define shade_blocks_textured_unmodulated_indirect \
-	shade_blocks_textured_unmodulated_indirect_
+	simd_name(shade_blocks_textured_unmodulated_indirect)
 #define shade_blocks_textured_unmodulated_direct \
-	shade_blocks_textured_unmodulated_direct_
+	simd_name(shade_blocks_textured_unmodulated_direct)
 #define shade_blocks_unshaded_untextured_indirect \
-	shade_blocks_unshaded_untextured_indirect_
-#define shade_blocks_unshaded_untextured_direct shade_blocks_unshaded_untextured_direct_
-#define blend_blocks_textured_average_off blend_blocks_textured_average_off_
-#define blend_blocks_textured_average_on blend_blocks_textured_average_on_
-#define blend_blocks_textured_add_off blend_blocks_textured_add_off_
-#define blend_blocks_textured_add_on blend_blocks_textured_add_on_
-#define blend_blocks_textured_subtract_off blend_blocks_textured_subtract_off_
-#define blend_blocks_textured_subtract_on blend_blocks_textured_subtract_on_
-#define blend_blocks_textured_add_fourth_off blend_blocks_textured_add_fourth_off_
-#define blend_blocks_textured_add_fourth_on blend_blocks_textured_add_fourth_on_
-#define blend_blocks_untextured_average_off blend_blocks_untextured_average_off_
-#define blend_blocks_untextured_average_on blend_blocks_untextured_average_on_
-#define blend_blocks_untextured_add_off blend_blocks_untextured_add_off_
-#define blend_blocks_untextured_add_on blend_blocks_untextured_add_on_
-#define blend_blocks_untextured_subtract_off blend_blocks_untextured_subtract_off_
-#define blend_blocks_untextured_subtract_on blend_blocks_untextured_subtract_on_
-#define blend_blocks_untextured_add_fourth_off blend_blocks_untextured_add_fourth_off_
-#define blend_blocks_untextured_add_fourth_on blend_blocks_untextured_add_fourth_on_
-#define blend_blocks_textured_unblended_off blend_blocks_textured_unblended_off_
-#define blend_blocks_textured_unblended_on blend_blocks_textured_unblended_on_
-#define texture_sprite_blocks_8bpp texture_sprite_blocks_8bpp_
-#define setup_sprite_4bpp setup_sprite_4bpp_
-#define setup_sprite_8bpp setup_sprite_8bpp_
-#define setup_sprite_16bpp setup_sprite_16bpp_
-#define setup_sprite_4bpp_4x setup_sprite_4bpp_4x_
-#define setup_sprite_8bpp_4x setup_sprite_8bpp_4x_
-#define setup_sprite_16bpp_4x setup_sprite_16bpp_4x_
-#define setup_sprite_untextured_512 setup_sprite_untextured_512_
-#define scale2x_tiles8 scale2x_tiles8_
+	simd_name(shade_blocks_unshaded_untextured_indirect)
+#define shade_blocks_unshaded_untextured_direct simd_name(shade_blocks_unshaded_untextured_direct)
+#define blend_blocks_textured_average_off simd_name(blend_blocks_textured_average_off)
+#define blend_blocks_textured_average_on simd_name(blend_blocks_textured_average_on)
+#define blend_blocks_textured_add_off simd_name(blend_blocks_textured_add_off)
+#define blend_blocks_textured_add_on simd_name(blend_blocks_textured_add_on)
+#define blend_blocks_textured_subtract_off simd_name(blend_blocks_textured_subtract_off)
+#define blend_blocks_textured_subtract_on simd_name(blend_blocks_textured_subtract_on)
+#define blend_blocks_textured_add_fourth_off simd_name(blend_blocks_textured_add_fourth_off)
+#define blend_blocks_textured_add_fourth_on simd_name(blend_blocks_textured_add_fourth_on)
+#define blend_blocks_untextured_average_off simd_name(blend_blocks_untextured_average_off)
+#define blend_blocks_untextured_average_on simd_name(blend_blocks_untextured_average_on)
+#define blend_blocks_untextured_add_off simd_name(blend_blocks_untextured_add_off)
+#define blend_blocks_untextured_add_on simd_name(blend_blocks_untextured_add_on)
+#define blend_blocks_untextured_subtract_off simd_name(blend_blocks_untextured_subtract_off)
+#define blend_blocks_untextured_subtract_on simd_name(blend_blocks_untextured_subtract_on)
+#define blend_blocks_untextured_add_fourth_off simd_name(blend_blocks_untextured_add_fourth_off)
+#define blend_blocks_untextured_add_fourth_on simd_name(blend_blocks_untextured_add_fourth_on)
+#define blend_blocks_textured_unblended_off simd_name(blend_blocks_textured_unblended_off)
+#define blend_blocks_textured_unblended_on simd_name(blend_blocks_textured_unblended_on)
+#define texture_sprite_blocks_8bpp simd_name(texture_sprite_blocks_8bpp)
+#define setup_sprite_4bpp simd_name(setup_sprite_4bpp)
+#define setup_sprite_8bpp simd_name(setup_sprite_8bpp)
+#define setup_sprite_16bpp simd_name(setup_sprite_16bpp)
+#define setup_sprite_4bpp_4x simd_name(setup_sprite_4bpp_4x)
+#define setup_sprite_8bpp_4x simd_name(setup_sprite_8bpp_4x)
+#define setup_sprite_16bpp_4x simd_name(setup_sprite_16bpp_4x)
+#define setup_sprite_untextured_512 simd_name(setup_sprite_untextured_512)
+#define scale2x_tiles8 simd_name(scale2x_tiles8)
 #endif
 
 void compute_all_gradients(psx_gpu_struct * __restrict__ psx_gpu,
@@ -0,0 +1,7 @@
+/*
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+// the C simd code again, built with -mavx2 (see psx_gpu_simd_x86.c)
+#include "psx_gpu_simd.c"
@@ -0,0 +1,88 @@
+/*
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * psx_gpu_simd.c is built twice on x86_64: with the baseline flags and
+ * with -mavx2 (which also brings SSSE3 shuffles, SSE4.1 widening and
+ * variable 64bit shifts to the gv* wrappers).  The entry points here
+ * are ifuncs, so the dynamic linker checks cpuid once and binds every
+ * caller straight to the right build, without any per-call dispatch.
+ */
+#include "psx_gpu.h"
+#include "psx_gpu_simd.h"
+
+#define simd_funcs(f) \
+  f(compute_all_gradients) \
+  f(update_texture_8bpp_cache_slice) \
+  f(setup_spans_up_left) \
+  f(setup_spans_up_right) \
+  f(setup_spans_down_left) \
+  f(setup_spans_down_right) \
+  f(setup_spans_up_a) \
+  f(setup_spans_up_b) \
+  f(setup_spans_down_a) \
+  f(setup_spans_down_b) \
+  f(setup_spans_up_down) \
+  f(setup_blocks_shaded_textured_dithered_swizzled_indirect) \
+  f(setup_blocks_shaded_textured_dithered_unswizzled_indirect) \
+  f(setup_blocks_unshaded_textured_dithered_swizzled_indirect) \
+  f(setup_blocks_unshaded_textured_dithered_unswizzled_indirect) \
+  f(setup_blocks_unshaded_untextured_undithered_unswizzled_indirect) \
+  f(setup_blocks_unshaded_untextured_undithered_unswizzled_direct) \
+  f(setup_blocks_shaded_untextured_undithered_unswizzled_indirect) \
+  f(setup_blocks_shaded_untextured_dithered_unswizzled_indirect) \
+  f(setup_blocks_shaded_untextured_undithered_unswizzled_direct) \
+  f(setup_blocks_shaded_untextured_dithered_unswizzled_direct) \
+  f(texture_blocks_untextured) \
+  f(texture_blocks_4bpp) \
+  f(texture_blocks_8bpp) \
+  f(texture_blocks_16bpp) \
+  f(shade_blocks_shaded_textured_modulated_dithered_direct) \
+  f(shade_blocks_shaded_textured_modulated_undithered_direct) \
+  f(shade_blocks_unshaded_textured_modulated_dithered_direct) \
+  f(shade_blocks_unshaded_textured_modulated_undithered_direct) \
+  f(shade_blocks_shaded_textured_modulated_dithered_indirect) \
+  f(shade_blocks_shaded_textured_modulated_undithered_indirect) \
+  f(shade_blocks_unshaded_textured_modulated_dithered_indirect) \
+  f(shade_blocks_unshaded_textured_modulated_undithered_indirect) \
+  f(shade_blocks_textured_unmodulated_indirect) \
+  f(shade_blocks_textured_unmodulated_direct) \
+  f(shade_blocks_unshaded_untextured_indirect) \
+  f(shade_blocks_unshaded_untextured_direct) \
+  f(blend_blocks_textured_average_off) \
+  f(blend_blocks_textured_average_on) \
+  f(blend_blocks_textured_add_off) \
+  f(blend_blocks_textured_add_on) \
+  f(blend_blocks_textured_subtract_off) \
+  f(blend_blocks_textured_subtract_on) \
+  f(blend_blocks_textured_add_fourth_off) \
+  f(blend_blocks_textured_add_fourth_on) \
+  f(blend_blocks_untextured_average_off) \
+  f(blend_blocks_untextured_average_on) \
+  f(blend_blocks_untextured_add_off) \
+  f(blend_blocks_untextured_add_on) \
+  f(blend_blocks_untextured_subtract_off) \
+  f(blend_blocks_untextured_subtract_on) \
+  f(blend_blocks_untextured_add_fourth_off) \
+  f(blend_blocks_untextured_add_fourth_on) \
+  f(blend_blocks_textured_unblended_off) \
+  f(blend_blocks_textured_unblended_on) \
+  f(setup_sprite_untextured_512) \
+  f(setup_sprite_4bpp) \
+  f(setup_sprite_8bpp) \
+  f(setup_sprite_4bpp_4x) \
+  f(setup_sprite_8bpp_4x) \
+  f(scale2x_tiles8)
+
+#define simd_ifunc(n) \
+  extern __typeof__(n) n##_sse2, n##_avx2; \
+  static __typeof__(n) *n##_resolve(void) \
+  { \
+    __builtin_cpu_init(); \
+    return __builtin_cpu_supports("avx2") ? n##_avx2 : n##_sse2; \
+  } \
+  __typeof__(n) n __attribute__((ifunc(#n "_resolve")));
+
+simd_funcs(simd_ifunc)
@@ -35,14 +35,541 @@ static noinline void sync_enhancement_buffers(int x, int y, int w, int h);
 
 static psx_gpu_struct egpu __attribute__((aligned(256)));
 
+#ifdef USE_ASYNC_GPU
+
+/*
+ * Band rendering: the drawing area is split into horizontal bands, egpu
+ * draws the first one on the calling thread and each of the others has
+ * its own psx_gpu_struct (and so its own texture caches) and thread.
+ * All instances parse the same commands and only clip differently, so
+ * their state stays the same.  The list is cut into segments that are
+ * drawn by all bands at once; segments end before fills (these ignore the
+ * drawing area, so egpu does them alone), before textured prims that
+ * sample something drawn earlier in the same segment and before the
+ * drawing area moves vertically.  A prim that samples its own drawing
+ * area may read rows another band draws, so egpu draws it whole and the
+ * workers are then cloned again.
+ */
+#include <stddef.h>
+#include "../../frontend/pcsxr-threads.h"
+#include "../../include/thread_wakeups.h"
+
+#define BAND_MAX 4
+#define BAND_MIN_WORDS 64 // shorter segments are not worth waking threads
+
+static struct
+{
+  psx_gpu_struct *gpus[BAND_MAX];
+  u32 ex_regs[BAND_MAX][8]; // scratch, parse only writes them
+  sthread_t *threads[BAND_MAX];
+  slock_t *lock;
+  scond_t *cond_job;
+  scond_t *cond_done;
+  u32 *list;
+  int words;
+  u32 job_seq;
+  int pending;
+  int started;
+  int count;
+  u8 stale;  // workers need a fresh copy of egpu
+  u8 exit;
+} bands;
+
+struct band_box {
+  s32 x0, y0, x1, y1;
+};
+
+static void band_parse(int i, u32 *list, int words)
+{
+  s32 dummy0 = 0;
+  u32 dummy1 = 0;
+  gpu_parse(bands.gpus[i], list, words * 4, bands.ex_regs[i],
+    &dummy0, &dummy0, &dummy1);
+  flush_render_block_buffer(bands.gpus[i]);
+}
+
+static STRHEAD_RET_TYPE band_thread(void *unused)
+{
+  u32 seq = 0;
+  int i;
+
+  slock_lock(bands.lock);
+  i = ++bands.started;
+  while (1)
+  {
+    while (bands.job_seq == seq && !bands.exit)
+      scond_wait(bands.cond_job, bands.lock);
+    if (bands.exit)
+      break;
+    twake_count(TWAKE_GPU_BAND);
+    seq = bands.job_seq;
+    slock_unlock(bands.lock);
+
+    band_parse(i, bands.list, bands.words);
+
+    slock_lock(bands.lock);
+    if (--bands.pending == 0)
+      scond_signal(bands.cond_done);
+  }
+  slock_unlock(bands.lock);
+  STRHEAD_RETURN();
+}
+
+// make the workers continue from where egpu is
+static void band_clone(void)
+{
+  size_t head = offsetof(psx_gpu_struct, blocks);
+  int i;
+
+  flush_render_block_buffer(&egpu);
+  for (i = 1; i < bands.count; i++)
+  {
+    psx_gpu_struct *w = bands.gpus[i];
+    memcpy(w, &egpu, head);
+    w->dirty_textures_4bpp_mask = ~0;
+    w->dirty_textures_8bpp_mask = ~0;
+    w->dirty_textures_8bpp_alternate_mask = ~0;
+    w->num_blocks = 0;
+    w->enhancement_buf_ptr = NULL;
+    w->enhancement_current_buf_ptr = NULL;
+    w->band_index = i;
+    update_texture_ptr(w);
+    update_viewport_band(w);
+  }
+  bands.stale = 0;
+}
+
+#define bands_active() (bands.count > 1)
+
+// the enhanced renderer can't split its viewport
+static void band_stop_enhanced(void)
+{
+  if (egpu.band_count > 1) {
+    egpu.band_count = 1;
+    update_viewport_band(&egpu);
+    bands.stale = 1;
+  }
+}
+
+static void band_invalidate(void)
+{
+  bands.stale = 1;
+}
+
+static void band_stop(void)
+{
+  int i;
+
+  if (bands.lock) {
+    slock_lock(bands.lock);
+    bands.exit = 1;
+    scond_broadcast(bands.cond_job);
+    slock_unlock(bands.lock);
+  }
+  for (i = 1; i < BAND_MAX; i++) {
+    if (bands.threads[i]) {
+      sthread_join(bands.threads[i]);
+      bands.threads[i] = NULL;
+    }
+    if (bands.gpus[i]) {
+      gpu.munmap(bands.gpus[i], sizeof(psx_gpu_struct));
+      bands.gpus[i] = NULL;
+    }
+  }
+  if (bands.cond_done) { scond_free(bands.cond_done); bands.cond_done = NULL; }
+  if (bands.cond_job)  { scond_free(bands.cond_job); bands.cond_job = NULL; }
+  if (bands.lock)      { slock_free(bands.lock); bands.lock = NULL; }
+  bands.started = bands.pending = 0;
+  bands.job_seq = 0;
+  bands.exit = 0;
+  bands.count = 1;
+
+  egpu.band_index = 0;
+  egpu.band_count = 1;
+  update_viewport_band(&egpu);
+}
+
+static void band_start(int count)
+{
+  int i;
+
+  if (count > BAND_MAX)
+    count = BAND_MAX;
+  if (count < 1)
+    count = 1;
+  if (count == max(bands.count, 1))
+    return;
+
+  band_stop();
+  if (count == 1 || gpu.mmap == NULL)
+    return;
+
+  bands.lock = slock_new();
+  bands.cond_job = scond_new();
+  bands.cond_done = scond_new();
+  if (!bands.lock || !bands.cond_job || !bands.cond_done)
+    goto fail;
+  for (i = 1; i < count; i++) {
+    void *p = gpu.mmap(sizeof(psx_gpu_struct));
+    if (p == NULL || p == (void *)(intptr_t)-1)
+      goto fail;
+    bands.gpus[i] = p;
+  }
+  for (i = 1; i < count; i++) {
+    bands.threads[i] = pcsxr_sthread_create(band_thread, PCSXRT_GPU_BAND);
+    if (bands.threads[i] == NULL)
+      goto fail;
+  }
+
+  bands.count = count;
+  bands.stale = 1;
+  egpu.band_count = count;
+  update_viewport_band(&egpu);
+  return;
+
+fail:
+  SysPrintf("gpu band init failed\n");
+  band_stop();
+}
+
+static int band_box_hit(const struct band_box *b, s32 x, s32 y, s32 w, s32 h)
+{
+  if (b->x0 > b->x1 || y > b->y1 || y + h - 1 < b->y0)
+    return 0;
+  if (x <= b->x1 && x + w - 1 >= b->x0)
+    return 1;
+  // texture pages and cluts wrap around horizontally
+  return x + w > 1024 && x + w - 1 - 1024 >= b->x0;
+}
+
+static int band_tex_hit(const struct band_box *b, u32 tp, u32 clut)
+{
+  u32 depth = (tp >> 7) & 3;
+  s32 x = (tp & 0xf) * 64, y = ((tp >> 4) & 1) * 256;
+
+  if (band_box_hit(b, x, y, depth ? (depth == 1 ? 128 : 256) : 64, 256))
+    return 1;
+  if (depth < 2 && band_box_hit(b, (clut & 0x3f) * 16, (clut >> 6) & 0x1ff,
+        depth ? 256 : 16, 1))
+    return 1;
+  return 0;
+}
+
+// textured prim, may it read pixels drawn in this segment or by itself?
+static int band_tex_hazard(const struct band_box *drawn,
+ const struct band_box *area, u32 tp, u32 clut)
+{
+  if (band_tex_hit(drawn, tp, clut))
+    return 1;
+  return area->y0 <= area->y1 && band_tex_hit(area, tp, clut);
+}
+
+// returns how many words can be drawn as one segment, 0 if the list
+// starts with a fill or -len if it starts with a prim egpu must draw alone
+static int band_scan(const u32 *list, int words)
+{
+  struct band_box area = { egpu.saved_viewport_start_x,
+    egpu.saved_viewport_start_y, egpu.saved_viewport_end_x,
+    egpu.saved_viewport_end_y };
+  struct band_box drawn = { 1, 1, 0, 0 };
+  u32 tp = egpu.texture_settings;
+  int pos, len, cmd, v;
+
+  for (pos = 0; pos < words; pos += len)
+  {
+    cmd = list[pos] >> 24;
+    len = 1 + cmd_lengths[cmd];
+    if (pos + len > words)
+      return words; // incomplete, the parsers will stop there
+
+    switch (cmd)
+    {
+      case 0x02:
+        return pos;
+      case 0x1f:
+      case 0x80 ... 0xdf:
+        return pos + len;
+      case 0x24 ... 0x27:
+      case 0x2c ... 0x2f:
+      case 0x34 ... 0x37:
+      case 0x3c ... 0x3f:
+        v = (list[pos + 4 + ((cmd >> 4) & 1)] >> 16) & 0x1ff;
+        if (band_tex_hazard(&drawn, &area, v, list[pos + 2] >> 16))
+          return pos ? pos : -len;
+        tp = v;
+        break;
+      case 0x48 ... 0x4f:
+        for (v = 2; ; v++)
+        {
+          if (pos + v + 1 >= words)
+            return words;
+          if ((list[pos + v + 1] & 0xf000f000) == 0x50005000)
+            break;
+        }
+        len += v - 2;
+        break;
+      case 0x58 ... 0x5f:
+        for (v = 2; ; v++)
+        {
+          if (pos + v * 2 >= words)
+            return words;
+          if ((list[pos + v * 2] & 0xf000f000) == 0x50005000)
+            break;
+        }
+        len += (v - 2) * 2;
+        break;
+      case 0x64 ... 0x67:
+      case 0x6c ... 0x6f:
+      case 0x74 ... 0x77:
+      case 0x7c ... 0x7f:
+        if (band_tex_hazard(&drawn, &area, tp, list[pos + 2] >> 16))
+          return pos ? pos : -len;
+        break;
+      case 0xe1:
+        tp = list[pos] & 0x1ff;
+        break;
+      // rows move between bands when the area changes vertically,
+      // so pixels drawn so far may be drawn over by another thread
+      case 0xe3:
+        v = (list[pos] >> 10) & 0x1ff;
+        if (v != area.y0 && drawn.x0 <= drawn.x1)
+          return pos;
+        area.x0 = list[pos] & 0x3ff;
+        area.y0 = v;
+        break;
+      case 0xe4:
+        v = (list[pos] >> 10) & 0x1ff;
+        if (v != area.y1 && drawn.x0 <= drawn.x1)
+          return pos;
+        area.x1 = list[pos] & 0x3ff;
+        area.y1 = v;
+        break;
+      default:
+        break;
+    }
+    if (0x20 <= cmd && cmd < 0x80 && area.x0 <= area.x1 && area.y0 <= area.y1)
+    {
+      if (drawn.x0 > drawn.x1)
+        drawn = area;
+      else {
+        drawn.x0 = min(drawn.x0, area.x0);
+        drawn.y0 = min(drawn.y0, area.y0);
+        drawn.x1 = max(drawn.x1, area.x1);
+        drawn.y1 = max(drawn.y1, area.y1);
+      }
+    }
+  }
+  return words;
+}
+
+static int band_segment(u32 *list, int words, u32 *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  int i, ret, threaded = words >= BAND_MIN_WORDS;
+
+  if (threaded) {
+    slock_lock(bands.lock);
+    bands.list = list;
+    bands.words = words;
+    bands.pending = bands.count - 1;
+    bands.job_seq++;
+    scond_broadcast(bands.cond_job);
+    slock_unlock(bands.lock);
+  }
+  else {
+    for (i = 1; i < bands.count; i++)
+      band_parse(i, list, words);
+  }
+
+  ret = gpu_parse(&egpu, list, words * 4, ex_regs,
+          cycles_sum, cycles_last, (u32 *)last_cmd);
+  flush_render_block_buffer(&egpu);
+
+  if (threaded) {
+    slock_lock(bands.lock);
+    while (bands.pending > 0)
+      scond_wait(bands.cond_done, bands.lock);
+    slock_unlock(bands.lock);
+  }
+  return ret;
+}
+
+static int band_fill(u32 *list, u32 *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  const s16 *slist = (void *)list;
+  u32 x = slist[2] & 0x3f0, y = slist[3] & 0x1ff;
+  u32 w = ((slist[4] & 0x3ff) + 0xf) & ~0xf, h = slist[5] & 0x1ff;
+  int i, ret;
+
+  ret = gpu_parse(&egpu, list, 3 * 4, ex_regs,
+          cycles_sum, cycles_last, (u32 *)last_cmd);
+  flush_render_block_buffer(&egpu);
+  if (w == 0 || h == 0)
+    return ret;
+  if (x + w > 1024 || y + h > 512)
+    x = y = 0, w = 1024, h = 512;
+  for (i = 1; i < bands.count; i++)
+    invalidate_texture_cache_region(bands.gpus[i], x, y, x + w - 1, y + h - 1);
+  return ret;
+}
+
+static int band_solo(u32 *list, int words, u32 *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  int ret;
+
+  egpu.band_count = 1;
+  update_viewport_band(&egpu);
+  ret = gpu_parse(&egpu, list, words * 4, ex_regs,
+          cycles_sum, cycles_last, (u32 *)last_cmd);
+  flush_render_block_buffer(&egpu);
+  egpu.band_count = bands.count;
+  update_viewport_band(&egpu);
+  bands.stale = 1;
+  return ret;
+}
+
+static int band_do_cmd_list(u32 *list, int count, u32 *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  int pos = 0, len, ret;
+
+  if (egpu.band_count != bands.count) {
+    egpu.band_count = bands.count;
+    update_viewport_band(&egpu);
+  }
+
+  while (pos < count)
+  {
+    if (bands.stale)
+      band_clone();
+    len = band_scan(list + pos, count - pos);
+    if (len == 0) {
+      len = 3;
+      ret = band_fill(list + pos, ex_regs, cycles_sum, cycles_last, last_cmd);
+    }
+    else if (len < 0) {
+      len = -len;
+      ret = band_solo(list + pos, len, ex_regs,
+              cycles_sum, cycles_last, last_cmd);
+    }
+    else
+      ret = band_segment(list + pos, len, ex_regs,
+              cycles_sum, cycles_last, last_cmd);
+    pos += ret;
+    if (ret < len)
+      break;
+  }
+  return pos;
+}
+
+// keep the workers in sync with what is done to egpu outside of cmd lists
+static void band_sync_ecmds(u32 *ecmds)
+{
+  int i;
+  if (!bands.stale)
+    for (i = 1; i < bands.count; i++)
+      band_parse(i, ecmds + 1, 6);
+}
+
+static void band_update_caches(int x, int y, int w, int h)
+{
+  int i;
+  if (!bands.stale)
+    for (i = 1; i < bands.count; i++)
+      update_texture_cache_region(bands.gpus[i], x, y, x + w - 1, y + h - 1);
+}
+
+static void band_set_render_mode(void)
+{
+  int i;
+  if (!bands.stale)
+    for (i = 1; i < bands.count; i++)
+      bands.gpus[i]->render_mode = egpu.render_mode;
+}
+
+#else
+
+#define bands_active() 0
+#define band_stop_enhanced()
+#define band_sync_ecmds(ecmds)
+#define band_update_caches(x, y, w, h)
+#define band_set_render_mode()
+#define band_start(count)
+#define band_stop()
+#define band_invalidate()
+#define band_do_cmd_list(list, count, ex_regs, sum, last, cmd) 0
+
+#endif // USE_ASYNC_GPU
+
+/*
+ * VRAM uploads and copies don't upscale into the enhancement buffers right
+ * away, the 64x16 tiles they touch (same grid as gpulib's vram_dirty) are
+ * collected here and done once before anything draws or shows enhanced.
+ * FMVs and 2D overlays tend to write the same area many times in small
+ * parts between those points. The native vram is always up to date so
+ * the other direction never needs anything.
+ */
+static u16 enh_pending[32];
+static int enh_pending_any;
+
+static void enhancement_mark_pending(int x, int y, int w, int h)
+{
+  int x1 = x >> 6, x2 = (x + w - 1) >> 6;
+  int y1 = y >> 4, y2 = (y + h - 1) >> 4;
+  u16 cols;
+
+  if (w <= 0 || h <= 0)
+    return;
+  if (x2 > 15)
+    x2 = 15;
+  cols = (u16)((2u << x2) - (1u << x1));
+  for (; y1 <= y2 && y1 < 32; y1++)
+    enh_pending[y1] |= cols;
+  enh_pending_any = 1;
+}
+
+static void enhancement_flush_pending(void)
+{
+  int y, y2, x, x2;
+  u16 cols;
+
+  if (!enh_pending_any)
+    return;
+  enh_pending_any = 0;
+  for (y = 0; y < 32; y = y2) {
+    cols = enh_pending[y];
+    // rows with the same tiles go as one rectangle
+    for (y2 = y + 1; y2 < 32 && enh_pending[y2] == cols; y2++)
+      enh_pending[y2] = 0;
+    enh_pending[y] = 0;
+    for (x = 0; cols >> x; x = x2) {
+      if (!((cols >> x) & 1)) {
+        x2 = x + 1;
+        continue;
+      }
+      for (x2 = x + 1; x2 < 16 && ((cols >> x2) & 1); x2++)
+        ;
+      sync_enhancement_buffers(x * 64, y * 16, (x2 - x) * 64, (y2 - y) * 16);
+    }
+  }
+}
+
 int renderer_do_cmd_list(uint32_t *list, int count, uint32_t *ex_regs,
  int *cycles_sum, int *cycles_last, int *last_cmd)
 {
   int ret;
 
-  if (gpu.state.enhancement_active)
+  if (gpu.state.enhancement_active) {
+    enhancement_flush_pending();
+    band_stop_enhanced();
     ret = gpu_parse_enhanced(&egpu, list, count * 4, ex_regs,
             cycles_sum, cycles_last, (u32 *)last_cmd);
+  }
+  else if (bands_active())
+    ret = band_do_cmd_list(list, count, ex_regs,
+            cycles_sum, cycles_last, last_cmd);
   else
     ret = gpu_parse(&egpu, list, count * 4, ex_regs,
             cycles_sum, cycles_last, (u32 *)last_cmd);
@@ -57,7 +584,10 @@ int renderer_do_cmd_list(uint32_t *list, int count, uint32_t *ex_regs,
 static void *get_enhancement_bufer(int *x, int *y, int *w, int *h,
  int *vram_h)
 {
-  uint16_t *ret = select_enhancement_buf_ptr(&egpu, *x, *y);
+  uint16_t *ret;
+
+  enhancement_flush_pending();
+  ret = select_enhancement_buf_ptr(&egpu, *x, *y);
   if (ret == NULL)
     return NULL;
 
@@ -90,10 +620,14 @@ int renderer_init(void)
 {
   if (gpu.vram != NULL) {
     initialize_psx_gpu(&egpu, gpu.vram);
+    band_invalidate();
     initialized = 1;
   }
 
-  if (gpu.mmap != NULL && egpu.enhancement_buf_ptr == NULL)
+  // the 16MB buffer is only mapped once enhancement gets enabled,
+  // see renderer_set_config()
+  if (gpu.state.enhancement_enable && gpu.mmap != NULL &&
+      egpu.enhancement_buf_ptr == NULL)
     map_enhancement_buffer();
 
   return 0;
@@ -101,6 +635,7 @@ int renderer_init(void)
 
 void renderer_finish(void)
 {
+  band_stop();
   if (egpu.enhancement_buf_ptr != NULL) {
     egpu.enhancement_buf_ptr -= 4096 / 2;
     gpu.munmap(egpu.enhancement_buf_ptr, ENHANCEMENT_BUF_SIZE);
@@ -147,24 +682,29 @@ void renderer_sync_ecmds(uint32_t *ecmds)
   s32 dummy0 = 0;
   u32 dummy1 = 0;
   gpu_parse(&egpu, ecmds + 1, 6 * 4, ecmds, &dummy0, &dummy0, &dummy1);
+  band_sync_ecmds(ecmds);
 }
 
 void renderer_update_caches(int x, int y, int w, int h, int state_changed)
 {
   update_texture_cache_region(&egpu, x, y, x + w - 1, y + h - 1);
+  band_update_caches(x, y, w, h);
 
   if (gpu.state.enhancement_active) {
     if (state_changed) {
       int vres = gpu.screen.vres;
       if (gpu.screen.y < 0)
         vres -= gpu.screen.y;
+      // the new scanout is upscaled whole, the old ones are gone
+      memset(enh_pending, 0, sizeof(enh_pending));
+      enh_pending_any = 0;
       memset(egpu.enhancement_scanouts, 0, sizeof(egpu.enhancement_scanouts));
       egpu.enhancement_scanout_eselect = 0;
       update_enhancement_buf_scanouts(&egpu,
         gpu.screen.src_x, gpu.screen.src_y, gpu.screen.hres, vres);
       return;
     }
-    sync_enhancement_buffers(x, y, w, h);
+    enhancement_mark_pending(x, y, w, h);
   }
 }
 
@@ -180,6 +720,7 @@ void renderer_set_interlace(int enable, int is_odd)
     egpu.render_mode |= RENDER_INTERLACE_ENABLED;
   if (is_odd)
     egpu.render_mode |= RENDER_INTERLACE_ODD;
+  band_set_render_mode();
 }
 
 void renderer_notify_screen_change(const struct psx_gpu_screen *screen)
@@ -191,6 +732,8 @@ void renderer_notify_screen_change(const struct psx_gpu_screen *screen)
 
   if (screen->y < 0)
     vres -= screen->y;
+  // into the scanouts as they were, these may get trimmed or evicted
+  enhancement_flush_pending();
   update_enhancement_buf_scanouts(&egpu, x, y, screen->hres, vres);
 }
 
@@ -200,10 +743,13 @@ void renderer_set_config(const struct rearmed_cbs *cbs)
 {
   if (!initialized) {
     initialize_psx_gpu(&egpu, gpu.vram);
+    band_invalidate();
     initialized = 1;
   }
   if (cbs->pl_set_gpu_caps)
     cbs->pl_set_gpu_caps(GPU_CAP_SUPPORTS_2X);
+  // egpu's only, band_clone() overwrites what the workers count
+  ((struct rearmed_cbs *)cbs)->gpu_tex_stats = egpu.texture_cache_stats;
   
   egpu.allow_dithering = cbs->dithering;
   egpu.force_dithering = cbs->dithering >> 1;
@@ -223,6 +769,8 @@ void renderer_set_config(const struct rearmed_cbs *cbs)
 
   egpu.hack_disable_main = cbs->gpu_neon.enhancement_no_main;
   egpu.hack_texture_adj = cbs->gpu_neon.enhancement_tex_adj;
+  band_start(cbs->gpu_neon.render_bands);
+  band_invalidate();
   if (gpu.state.enhancement_enable) {
     if (gpu.mmap != NULL && egpu.enhancement_buf_ptr == NULL)
       map_enhancement_buffer();
@@ -83,6 +83,7 @@ static void gpuReset(void)
 	gpu_unai.GPU_GP1 = 0x14802000;
 	gpu_unai.DrawingArea[2] = 256;
 	gpu_unai.DrawingArea[3] = 240;
+	gpu_unai.BandRows[1] = FRAME_HEIGHT;
 	gpu_unai.DisplayArea[2] = 256;
 	gpu_unai.DisplayArea[3] = 240;
 	gpu_unai.DisplayArea[5] = 240;
@@ -157,7 +158,7 @@ long GPU_freeze(u32 bWrite, GPUFreeze_t* p2)
 		GPU_writeStatus((5 << 24) | p2->ulControl[5]);
 		GPU_writeStatus((7 << 24) | p2->ulControl[7]);
 		GPU_writeStatus((8 << 24) | p2->ulControl[8]);
-		gpuSetTexture(gpu_unai.GPU_GP1);
+		gpuSetTexture(gpu_unai, gpu_unai.GPU_GP1);
 		return (1);
 	}
 	return (0);
@@ -23,7 +23,7 @@
 #define __GPU_UNAI_GPU_COMMAND_H__
 
 ///////////////////////////////////////////////////////////////////////////////
-void gpuSetTexture(u16 tpage)
+void gpuSetTexture(gpu_unai_t &gpu_unai, u16 tpage)
 {
 	u32 tmode, tx, ty;
 	gpu_unai.GPU_GP1 = (gpu_unai.GPU_GP1 & ~0x1FF) | (tpage & 0x1FF);
@@ -49,7 +49,7 @@ void gpuSetTexture(u16 tpage)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-INLINE void gpuSetCLUT(u16 clut)
+INLINE void gpuSetCLUT(gpu_unai_t &gpu_unai, u16 clut)
 {
 	gpu_unai.inn.CBA = &gpu_unai.vram[(clut & 0x7FFF) << 4];
 }
@@ -92,7 +92,7 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, u32 cmd_word)
 			u32 new_texpage = cmd_word & 0x7FF;
 			if (cur_texpage != new_texpage) {
 				gpu_unai.GPU_GP1 = (gpu_unai.GPU_GP1 & ~0x7FF) | new_texpage;
-				gpuSetTexture(gpu_unai.GPU_GP1);
+				gpuSetTexture(gpu_unai, gpu_unai.GPU_GP1);
 			}
 		} break;
 
@@ -117,7 +117,7 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, u32 cmd_word)
 				gpu_unai.u_msk = (((u32)gpu_unai.TextureWindow[2]) << fb) | ((1 << fb) - 1);
 				gpu_unai.v_msk = (((u32)gpu_unai.TextureWindow[3]) << fb) | ((1 << fb) - 1);
 
-				gpuSetTexture(gpu_unai.GPU_GP1);
+				gpuSetTexture(gpu_unai, gpu_unai.GPU_GP1);
 			}
 		} break;
 
@@ -163,7 +163,7 @@ void gpuSendPacketFunction(const int PRIM)
 	{
 		case 0x02: {
 			NULL_GPU();
-			gpuClearImage(packet);    //  prim handles updateLace && skip
+			gpuClearImage(gpu_unai, packet);    //  prim handles updateLace && skip
 			gpu_unai.fb_dirty = true;
 			DO_LOG(("gpuClearImage(0x%x)\n",PRIM));
 		} break;
@@ -180,7 +180,7 @@ void gpuSendPacketFunction(const int PRIM)
 					Blending_Mode |
 					gpu_unai.Masking | Blending | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyF(packet, driver, false);
+				gpuDrawPolyF(gpu_unai, packet, driver, false);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyF(0x%x)\n",PRIM));
 			}
@@ -193,8 +193,8 @@ void gpuSendPacketFunction(const int PRIM)
 			if (!gpu_unai.frameskip.skipGPU)
 			{
 				NULL_GPU();
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-				gpuSetTexture (le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetTexture (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
 
 				u32 driver_idx =
 					(gpu_unai.blit_mask?1024:0) |
@@ -210,7 +210,7 @@ void gpuSendPacketFunction(const int PRIM)
 				}
 
 				PP driver = gpuPolySpanDrivers[driver_idx];
-				gpuDrawPolyFT(packet, driver, false);
+				gpuDrawPolyFT(gpu_unai, packet, driver, false);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyFT(0x%x)\n",PRIM));
 			}
@@ -228,7 +228,7 @@ void gpuSendPacketFunction(const int PRIM)
 					Blending_Mode |
 					gpu_unai.Masking | Blending | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyF(packet, driver, true); // is_quad = true
+				gpuDrawPolyF(gpu_unai, packet, driver, true); // is_quad = true
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyF(0x%x) (4-pt QUAD)\n",PRIM));
 			}
@@ -241,8 +241,8 @@ void gpuSendPacketFunction(const int PRIM)
 			if (!gpu_unai.frameskip.skipGPU)
 			{
 				NULL_GPU();
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-				gpuSetTexture (le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetTexture (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
 
 				u32 driver_idx =
 					(gpu_unai.blit_mask?1024:0) |
@@ -258,7 +258,7 @@ void gpuSendPacketFunction(const int PRIM)
 				}
 
 				PP driver = gpuPolySpanDrivers[driver_idx];
-				gpuDrawPolyFT(packet, driver, true); // is_quad = true
+				gpuDrawPolyFT(gpu_unai, packet, driver, true); // is_quad = true
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyFT(0x%x) (4-pt QUAD)\n",PRIM));
 			}
@@ -281,7 +281,7 @@ void gpuSendPacketFunction(const int PRIM)
 					Blending_Mode |
 					gpu_unai.Masking | Blending | 129 | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyG(packet, driver, false);
+				gpuDrawPolyG(gpu_unai, packet, driver, false);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyG(0x%x)\n",PRIM));
 			}
@@ -294,15 +294,15 @@ void gpuSendPacketFunction(const int PRIM)
 			if (!gpu_unai.frameskip.skipGPU)
 			{
 				NULL_GPU();
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-				gpuSetTexture (le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetTexture (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
 				PP driver = gpuPolySpanDrivers[
 					(gpu_unai.blit_mask?1024:0) |
 					Dithering |
 					Blending_Mode | gpu_unai.TEXT_MODE |
 					gpu_unai.Masking | Blending | ((Lighting)?129:0) | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyGT(packet, driver, false);
+				gpuDrawPolyGT(gpu_unai, packet, driver, false);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyGT(0x%x)\n",PRIM));
 			}
@@ -322,7 +322,7 @@ void gpuSendPacketFunction(const int PRIM)
 					Blending_Mode |
 					gpu_unai.Masking | Blending | 129 | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyG(packet, driver, true); // is_quad = true
+				gpuDrawPolyG(gpu_unai, packet, driver, true); // is_quad = true
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyG(0x%x) (4-pt QUAD)\n",PRIM));
 			}
@@ -335,15 +335,15 @@ void gpuSendPacketFunction(const int PRIM)
 			if (!gpu_unai.frameskip.skipGPU)
 			{
 				NULL_GPU();
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-				gpuSetTexture (le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetTexture (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
 				PP driver = gpuPolySpanDrivers[
 					(gpu_unai.blit_mask?1024:0) |
 					Dithering |
 					Blending_Mode | gpu_unai.TEXT_MODE |
 					gpu_unai.Masking | Blending | ((Lighting)?129:0) | gpu_unai.PixelMSB
 				];
-				gpuDrawPolyGT(packet, driver, true); // is_quad = true
+				gpuDrawPolyGT(gpu_unai, packet, driver, true); // is_quad = true
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawPolyGT(0x%x) (4-pt QUAD)\n",PRIM));
 			}
@@ -359,7 +359,7 @@ void gpuSendPacketFunction(const int PRIM)
 				// Shift index right by one, as untextured prims don't use lighting
 				u32 driver_idx = (Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1;
 				PSD driver = gpuPixelSpanDrivers[driver_idx];
-				gpuDrawLineF(packet, driver);
+				gpuDrawLineF(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawLineF(0x%x)\n",PRIM));
 			}
@@ -379,7 +379,7 @@ void gpuSendPacketFunction(const int PRIM)
 				// Shift index right by one, as untextured prims don't use lighting
 				u32 driver_idx = (Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1;
 				PSD driver = gpuPixelSpanDrivers[driver_idx];
-				gpuDrawLineF(packet, driver);
+				gpuDrawLineF(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawLineF(0x%x)\n",PRIM));
 			}
@@ -404,7 +404,7 @@ void gpuSendPacketFunction(const int PRIM)
 				// Index MSB selects Gouraud-shaded PixelSpanDriver:
 				driver_idx |= (1 << 5);
 				PSD driver = gpuPixelSpanDrivers[driver_idx];
-				gpuDrawLineG(packet, driver);
+				gpuDrawLineG(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawLineG(0x%x)\n",PRIM));
 			}
@@ -426,7 +426,7 @@ void gpuSendPacketFunction(const int PRIM)
 				// Index MSB selects Gouraud-shaded PixelSpanDriver:
 				driver_idx |= (1 << 5);
 				PSD driver = gpuPixelSpanDrivers[driver_idx];
-				gpuDrawLineG(packet, driver);
+				gpuDrawLineG(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawLineG(0x%x)\n",PRIM));
 			}
@@ -449,7 +449,7 @@ void gpuSendPacketFunction(const int PRIM)
 			{
 				NULL_GPU();
 				PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-				gpuDrawT(packet, driver);
+				gpuDrawT(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawT(0x%x)\n",PRIM));
 			}
@@ -462,7 +462,7 @@ void gpuSendPacketFunction(const int PRIM)
 			if (!gpu_unai.frameskip.skipGPU)
 			{
 				NULL_GPU();
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
 				u32 driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
 
 				// This fixes Silent Hill running animation on loading screens:
@@ -481,7 +481,7 @@ void gpuSendPacketFunction(const int PRIM)
 				if ((le32_raw(gpu_unai.PacketBuffer.U4[0]) & HTOLE32(0xF8F8F8)) != HTOLE32(0x808080))
 					driver_idx |= Lighting;
 				PS driver = gpuSpriteSpanDrivers[driver_idx];
-				gpuDrawS(packet, driver);
+				gpuDrawS(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawS(0x%x)\n",PRIM));
 			}
@@ -496,7 +496,7 @@ void gpuSendPacketFunction(const int PRIM)
 				NULL_GPU();
 				gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00010001);
 				PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-				gpuDrawT(packet, driver);
+				gpuDrawT(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawT(0x%x)\n",PRIM));
 			}
@@ -511,7 +511,7 @@ void gpuSendPacketFunction(const int PRIM)
 				NULL_GPU();
 				gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00080008);
 				PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-				gpuDrawT(packet, driver);
+				gpuDrawT(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawT(0x%x)\n",PRIM));
 			}
@@ -525,7 +525,7 @@ void gpuSendPacketFunction(const int PRIM)
 			{
 				NULL_GPU();
 				gpu_unai.PacketBuffer.U4[3] = u32_to_le32(0x00080008);
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
 				u32 driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
 
 				//senquack - Only color 808080h-878787h allows skipping lighting calculation:
@@ -534,7 +534,7 @@ void gpuSendPacketFunction(const int PRIM)
 				if ((le32_raw(gpu_unai.PacketBuffer.U4[0]) & HTOLE32(0xF8F8F8)) != HTOLE32(0x808080))
 					driver_idx |= Lighting;
 				PS driver = gpuSpriteSpanDrivers[driver_idx];
-				gpuDrawS(packet, driver);
+				gpuDrawS(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawS(0x%x)\n",PRIM));
 			}
@@ -549,7 +549,7 @@ void gpuSendPacketFunction(const int PRIM)
 				NULL_GPU();
 				gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00100010);
 				PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-				gpuDrawT(packet, driver);
+				gpuDrawT(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawT(0x%x)\n",PRIM));
 			}
@@ -561,7 +561,7 @@ void gpuSendPacketFunction(const int PRIM)
 			/* Notaz 4bit sprites optimization */
 			if ((!gpu_unai.frameskip.skipGPU) && (!(gpu_unai.GPU_GP1&0x180)) && (!(gpu_unai.Masking|gpu_unai.PixelMSB)))
 			{
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
 				gpuDrawS16(packet);
 				gpu_unai.fb_dirty = true;
 				break;
@@ -573,7 +573,7 @@ void gpuSendPacketFunction(const int PRIM)
 			{
 				NULL_GPU();
 				gpu_unai.PacketBuffer.U4[3] = u32_to_le32(0x00100010);
-				gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+				gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
 				u32 driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
 
 				//senquack - Only color 808080h-878787h allows skipping lighting calculation:
@@ -582,14 +582,14 @@ void gpuSendPacketFunction(const int PRIM)
 				if ((le32_raw(gpu_unai.PacketBuffer.U4[0]) & HTOLE32(0xF8F8F8)) != HTOLE32(0x808080))
 					driver_idx |= Lighting;
 				PS driver = gpuSpriteSpanDrivers[driver_idx];
-				gpuDrawS(packet, driver);
+				gpuDrawS(gpu_unai, packet, driver);
 				gpu_unai.fb_dirty = true;
 				DO_LOG(("gpuDrawS(0x%x)\n",PRIM));
 			}
 		} break;
 
 		case 0x80:          //  vid -> vid
-			gpuMoveImage(packet);   //  prim handles updateLace && skip
+			gpuMoveImage(gpu_unai, packet);   //  prim handles updateLace && skip
 			if ((!gpu_unai.frameskip.skipCount) && (gpu_unai.DisplayArea[3] == 480)) // Tekken 3 hack
 			{
 				if (!gpu_unai.frameskip.skipGPU) gpu_unai.fb_dirty = true;
@@ -601,11 +601,11 @@ void gpuSendPacketFunction(const int PRIM)
 			DO_LOG(("gpuMoveImage(0x%x)\n",PRIM));
 			break;
 		case 0xA0:          //  sys ->vid
-			gpuLoadImage(packet);   //  prim handles updateLace && skip
+			gpuLoadImage(gpu_unai, packet);   //  prim handles updateLace && skip
 			DO_LOG(("gpuLoadImage(0x%x)\n",PRIM));
 			break;
 		case 0xC0:          //  vid -> sys
-			gpuStoreImage(packet);  //  prim handles updateLace && skip
+			gpuStoreImage(gpu_unai, packet);  //  prim handles updateLace && skip
 			DO_LOG(("gpuStoreImage(0x%x)\n",PRIM));
 			break;
 		case 0xE1 ... 0xE6: { // Draw settings
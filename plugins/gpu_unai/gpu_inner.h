@@ -436,6 +436,8 @@ static noinline void gpuSpriteDriverFn(le16_t *pPixel, u32 count, const u8 *pTxt
 	const le16_t *CBA_; if (CF_TEXTMODE!=3) CBA_ = inn.CBA;
 	const u32 v0_mask = inn.v_msk >> 10;
 	s32 y0 = inn.y0, y1 = inn.y1, li = inn.ilace_mask;
+	const int pi=(ProgressiveInterlaceEnabled()?(gpu_unai.inn.ilace_mask+1):0);
+	const int pif=(ProgressiveInterlaceEnabled()?(gpu_unai.prog_ilace_flag?(gpu_unai.inn.ilace_mask+1):0):1);
 	u32 u0_ = inn.u, v0 = inn.v;
 
 	if (CF_TEXTMODE==3) {
@@ -447,6 +449,7 @@ static noinline void gpuSpriteDriverFn(le16_t *pPixel, u32 count, const u8 *pTxt
 	for (; y0 < y1; ++y0, pPixel += FRAME_WIDTH, ++v0)
 	{
 	  if (y0 & li) continue;
+	  if ((y0 & pi) == pif) continue;
 	  const u8 *pTxt = pTxt_base + ((v0 & v0_mask) * 2048);
 	  le16_t *pDst = pPixel;
 	  u32 u0 = u0_;
@@ -827,6 +830,12 @@ static void PolySpanMaybeAsm(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count
 }
 #endif
 
+#if (defined(__aarch64__) || defined(__SSE2__)) \
+    && __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+#define GPU_UNAI_SIMD_SPANS
+#include "gpu_inner_simd.h"
+#endif
+
 static void PolyNULL(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count)
 {
 	#ifdef ENABLE_GPU_LOG_SUPPORT
@@ -839,7 +848,11 @@ static void PolyNULL(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count)
 typedef void (*PP)(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count);
 
 // Template instantiation helper macros
+#ifdef GPU_UNAI_SIMD_SPANS
+#define TI(cf) PolySpanMaybeSimd<(cf)>
+#else
 #define TI(cf) gpuPolySpanFn<(cf)>
+#endif
 #define TN     PolyNULL
 #ifdef __arm__
 #define TA(cf) PolySpanMaybeAsm<(cf)>
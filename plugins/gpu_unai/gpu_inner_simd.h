@@ -0,0 +1,261 @@
+/***************************************************************************
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+***************************************************************************/
+
+#ifndef __GPU_UNAI_GPU_INNER_SIMD_H__
+#define __GPU_UNAI_GPU_INNER_SIMD_H__
+
+///////////////////////////////////////////////////////////////////////////////
+// 8 pixels at a time versions of gpuPolySpanFn<> for AArch64 NEON and SSE2.
+//  Same math as the C code (which stays as the reference), so the output is
+//  bit-exact: Blargg's blending works in 16 bit lanes as nothing above bit 15
+//  reaches the result, LightLUT[] is just min(t * l / 16, 31), and the
+//  Gouraud color is stepped in 64 bit lanes to keep the carries between the
+//  packed r, g, b that gCol.raw += gInc.raw has. Texels are still fetched
+//  one at a time, everything after that is vectored.
+//  Dithering and blit_mask (both need the pixel address) stay in C.
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#else
+#include <emmintrin.h>
+#endif
+
+typedef u16 gvu16  __attribute__((vector_size(16),aligned(16)));
+typedef u16 gvu16u __attribute__((vector_size(16),aligned(2)));
+typedef s16 gvs16  __attribute__((vector_size(16),aligned(16)));
+typedef u64 gvu64  __attribute__((vector_size(16),aligned(16)));
+#define gdup(v_) {v_, v_, v_, v_, v_, v_, v_, v_}
+
+// all ones in the lanes that have bit 15 set
+#define gmsb(v_) ((gvu16)((gvs16)(v_) >> 15))
+
+GPU_INLINE gvu16 gsel(gvu16 m, gvu16 a, gvu16 b)
+{
+	return (m & a) | (~m & b);
+}
+
+// CF combinations gpuPolySpanSimd() can do, plain texture copies are
+//  left to C as there's nothing to gain past the fetch
+#define CF_SIMD_OK (!CF_DITHER && (!CF_TEXTMODE \
+	|| (!CF_BLITMASK && (CF_LIGHT || CF_BLEND))))
+
+// bgr555 of 8 pixels, from 4x2 gcol_t.raw
+GPU_INLINE gvu16 gpuGouraudSimd(const gvu64 *g)
+{
+	gvu64 c[4];
+	for (int i = 0; i < 4; i++)
+		c[i] = ((g[i] >> 11) & 0x1f) | ((g[i] >> 22) & 0x3e0)
+		     | ((g[i] >> 33) & 0x7c00);
+#if defined(__aarch64__)
+	uint16x4_t lo = vmovn_u32(vcombine_u32(vmovn_u64((uint64x2_t)c[0]),
+		vmovn_u64((uint64x2_t)c[1])));
+	uint16x4_t hi = vmovn_u32(vcombine_u32(vmovn_u64((uint64x2_t)c[2]),
+		vmovn_u64((uint64x2_t)c[3])));
+	return (gvu16)vcombine_u16(lo, hi);
+#else
+	// values are below 0x8000, so the signed pack doesn't saturate
+	__m128i lo = _mm_unpacklo_epi64(
+		_mm_shuffle_epi32((__m128i)c[0], _MM_SHUFFLE(3,1,2,0)),
+		_mm_shuffle_epi32((__m128i)c[1], _MM_SHUFFLE(3,1,2,0)));
+	__m128i hi = _mm_unpacklo_epi64(
+		_mm_shuffle_epi32((__m128i)c[2], _MM_SHUFFLE(3,1,2,0)),
+		_mm_shuffle_epi32((__m128i)c[3], _MM_SHUFFLE(3,1,2,0)));
+	return (gvu16)_mm_packs_epi32(lo, hi);
+#endif
+}
+
+// gpuBlendingGeneric<>() for 8 pixels
+template <int BLENDMODE, bool SKIP_USRC_MSB_MASK>
+GPU_INLINE gvu16 gpuBlendingSimd(gvu16 uSrc, gvu16 uDst)
+{
+	gvu16 mix;
+
+	if (BLENDMODE==0) {
+#ifdef GPU_UNAI_USE_ACCURATE_BLENDING
+		uDst &= 0x7fff;
+		if (!SKIP_USRC_MSB_MASK)
+			uSrc &= 0x7fff;
+		mix = ((uSrc + uDst) - ((uSrc ^ uDst) & 0x0421)) >> 1;
+#else
+		mix = ((uDst & 0x7bde) + (uSrc & 0x7bde)) >> 1;
+#endif
+	}
+
+	if (BLENDMODE==1 || BLENDMODE==3) {
+		uDst &= 0x7fff;
+		if (BLENDMODE==3)
+			uSrc = (uSrc >> 2) & 0x1ce7;
+		else if (!SKIP_USRC_MSB_MASK)
+			uSrc &= 0x7fff;
+		gvu16 sum      = uSrc + uDst;
+		gvu16 low_bits = (uSrc ^ uDst) & 0x0421;
+		gvu16 carries  = (sum - low_bits) & 0x8420;
+		gvu16 modulo   = sum - carries;
+		gvu16 clamp    = carries - (carries >> 5);
+		mix = modulo | clamp;
+	}
+
+	if (BLENDMODE==2) {
+		uDst &= 0x7fff;
+		if (!SKIP_USRC_MSB_MASK)
+			uSrc &= 0x7fff;
+		gvu16 diff     = uDst - uSrc + 0x8420;
+		gvu16 low_bits = (uDst ^ uSrc) & 0x8420;
+		gvu16 borrows  = (diff - low_bits) & 0x8420;
+		gvu16 modulo   = diff - borrows;
+		gvu16 clamp    = borrows - (borrows >> 5);
+		mix = modulo & clamp;
+	}
+
+	return mix;
+}
+
+// gpuLightingTXTGeneric() for 8 pixels, light is bgr555 like the texels.
+//  A product is at most 31*31/16 = 60, so bit 5 tells it needs clamping.
+GPU_INLINE gvu16 gpuLightingTXTSimd(gvu16 uSrc, gvu16 light)
+{
+	gvu16 r = ((uSrc & 0x1f) * (light & 0x1f)) >> 4;
+	gvu16 g = (((uSrc >> 5) & 0x1f) * ((light >> 5) & 0x1f)) >> 4;
+	gvu16 b = (((uSrc >> 10) & 0x1f) * ((light >> 10) & 0x1f)) >> 4;
+	r = (r | -(r >> 5)) & 0x1f;
+	g = (g | -(g >> 5)) & 0x1f;
+	b = (b | -(b >> 5)) & 0x1f;
+	return r | (g << 5) | (b << 10) | (uSrc & 0x8000);
+}
+
+// Everything past fetching the source color. Lanes that the C code skips
+//  (mask bit set in dst, transparent texel) get their dst back.
+template<int CF>
+GPU_INLINE gvu16 gpuPixelsSimd(gvu16 uSrc, gvu16 uDst, gvu16 light)
+{
+	const bool skip_uSrc_mask = !CF_TEXTMODE;
+	gvu16 zero = gdup(0);
+	gvu16 keep = zero;
+
+	if (CF_TEXTMODE) {
+		keep = (gvu16)(uSrc == zero);
+		if (CF_LIGHT)
+			uSrc = gpuLightingTXTSimd(uSrc, light);
+		if (CF_BLEND)
+			uSrc = gsel(gmsb(uSrc),
+				gpuBlendingSimd<CF_BLENDMODE, skip_uSrc_mask>(uSrc, uDst), uSrc);
+	}
+	else if (CF_BLEND)
+		uSrc = gpuBlendingSimd<CF_BLENDMODE, skip_uSrc_mask>(uSrc, uDst);
+
+	if (CF_MASKSET)
+		uSrc |= 0x8000;
+	if (CF_MASKCHECK)
+		keep |= gmsb(uDst);
+	return gsel(keep, uDst, uSrc);
+}
+
+template<int CF>
+static noinline void gpuPolySpanSimd(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count)
+{
+	gvu16 uSrc = gdup(0), light = gdup(0);
+	gvu64 gc[4], g_step;
+
+	if (!CF_TEXTMODE && !CF_GOURAUD)
+		uSrc = (gvu16)gdup(gpu_unai.inn.PixelData);
+
+	if (CF_TEXTMODE && CF_LIGHT && !CF_GOURAUD) {
+		u16 l = gpu_unai.inn.r5 | (gpu_unai.inn.g5 << 5) | (gpu_unai.inn.b5 << 10);
+		light = (gvu16)gdup(l);
+	}
+
+	if (CF_GOURAUD && (!CF_TEXTMODE || CF_LIGHT)) {
+		u64 raw = gpu_unai.inn.gCol.raw, inc = gpu_unai.inn.gInc.raw;
+		for (int i = 0; i < 4; i++) {
+			gc[i][0] = raw + inc * (i * 2);
+			gc[i][1] = raw + inc * (i * 2 + 1);
+		}
+		g_step = (gvu64){ inc * 8, inc * 8 };
+	}
+
+	u32 l_u_msk = gpu_unai.inn.u_msk;     u32 l_v_msk = gpu_unai.inn.v_msk;
+	u32 l_u = gpu_unai.inn.u & l_u_msk;   u32 l_v = gpu_unai.inn.v & l_v_msk;
+	s32 l_u_inc = gpu_unai.inn.u_inc;     s32 l_v_inc = gpu_unai.inn.v_inc;
+	l_v <<= 1;
+	l_v_inc <<= 1;
+	l_v_msk = (l_v_msk & (0xff<<10)) << 1;
+
+	const le16_t* TBA_ = gpu_unai.inn.TBA;
+	const le16_t* CBA_ = gpu_unai.inn.CBA;
+
+	for (;;)
+	{
+		u32 n = count < 8 ? count : 8;
+		le16_t tmp[8], *p = pDst;
+		if (n < 8) {
+			memcpy(tmp, pDst, n * 2);
+			p = tmp;
+		}
+
+		if (CF_TEXTMODE) {
+			u16 tex[8] = { 0, };
+			for (u32 i = 0; i < n; i++) {
+				if (CF_TEXTMODE==1) {  //  4bpp (CLUT)
+					u32 tu=(l_u>>10);
+					u32 tv=l_v&l_v_msk;
+					u8 rgb=((u8*)TBA_)[tv+(tu>>1)];
+					tex[i]=le16_to_u16(CBA_[(rgb>>((tu&1)<<2))&0xf]);
+				}
+				if (CF_TEXTMODE==2) {  //  8bpp (CLUT)
+					u32 tv=l_v&l_v_msk;
+					tex[i]=le16_to_u16(CBA_[((u8*)TBA_)[tv+(l_u>>10)]]);
+				}
+				if (CF_TEXTMODE==3) {  // 16bpp
+					u32 tv=(l_v&l_v_msk)>>1;
+					tex[i]=le16_to_u16(TBA_[tv+(l_u>>10)]);
+				}
+				l_u = (l_u + l_u_inc) & l_u_msk;
+				l_v += l_v_inc;
+			}
+			uSrc = *(gvu16u *)tex;
+		}
+
+		if (CF_GOURAUD && (!CF_TEXTMODE || CF_LIGHT)) {
+			if (CF_TEXTMODE)
+				light = gpuGouraudSimd(gc);
+			else
+				uSrc = gpuGouraudSimd(gc);
+			for (int i = 0; i < 4; i++)
+				gc[i] += g_step;
+		}
+
+		*(gvu16u *)p = gpuPixelsSimd<CF>(uSrc, *(gvu16u *)p, light);
+
+		if (n < 8) {
+			memcpy(pDst, tmp, n * 2);
+			break;
+		}
+		pDst += 8;
+		if (!(count -= 8))
+			break;
+	}
+}
+
+template<int CF>
+static void PolySpanMaybeSimd(const gpu_unai_t &gpu_unai, le16_t *pDst, u32 count)
+{
+	if (CF_SIMD_OK)
+		gpuPolySpanSimd<CF_SIMD_OK ? CF : 0>(gpu_unai, pDst, count);
+	else
+		gpuPolySpanFn<CF>(gpu_unai, pDst, count);
+}
+
+#undef CF_SIMD_OK
+#undef gmsb
+#undef gdup
+
+#endif /* __GPU_UNAI_GPU_INNER_SIMD_H__ */
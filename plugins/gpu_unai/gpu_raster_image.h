@@ -23,7 +23,7 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 #ifndef USE_GPULIB
-void gpuLoadImage(PtrUnion packet)
+void gpuLoadImage(gpu_unai_t &gpu_unai, PtrUnion packet)
 {
 	u16 x0, y0, w0, h0;
 	x0 = le16_to_u16(packet.U2[2]) & 1023;
@@ -50,7 +50,7 @@ void gpuLoadImage(PtrUnion packet)
 
 ///////////////////////////////////////////////////////////////////////////////
 #ifndef USE_GPULIB
-void gpuStoreImage(PtrUnion packet)
+void gpuStoreImage(gpu_unai_t &gpu_unai, PtrUnion packet)
 {
 	u16 x0, y0, w0, h0;
 	x0 = le16_to_u16(packet.U2[2]) & 1023;
@@ -74,7 +74,7 @@ void gpuStoreImage(PtrUnion packet)
 }
 #endif // !USE_GPULIB
 
-void gpuMoveImage(PtrUnion packet)
+void gpuMoveImage(gpu_unai_t &gpu_unai, PtrUnion packet)
 {
 	u32 x0, y0, x1, y1;
 	s32 w0, h0;
@@ -154,7 +154,7 @@ void gpuMoveImage(PtrUnion packet)
 	}
 }
 
-void gpuClearImage(PtrUnion packet)
+void gpuClearImage(gpu_unai_t &gpu_unai, PtrUnion packet)
 {
 	s32   x0, y0, w0, h0;
 	x0 = le16_to_s16(packet.U2[2]);
@@ -171,8 +171,8 @@ void gpuClearImage(PtrUnion packet)
 	w0 -= x0;
 	if (w0 <= 0) return;
 	h0 += y0;
-	if (y0 < 0) y0 = 0;
-	if (h0 > FRAME_HEIGHT) h0 = FRAME_HEIGHT;
+	if (y0 < gpu_unai.BandRows[0]) y0 = gpu_unai.BandRows[0];
+	if (h0 > gpu_unai.BandRows[1]) h0 = gpu_unai.BandRows[1];
 	h0 -= y0;
 	if (h0 <= 0) return;
 
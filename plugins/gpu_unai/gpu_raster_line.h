@@ -56,7 +56,7 @@
 //////////////////////
 // Flat-shaded line //
 //////////////////////
-void gpuDrawLineF(PtrUnion packet, const PSD gpuPixelSpanDriver)
+void gpuDrawLineF(gpu_unai_t &gpu_unai, PtrUnion packet, const PSD gpuPixelSpanDriver)
 {
 	int x0, y0, x1, y1;
 	int dx, dy;
@@ -299,7 +299,7 @@ void gpuDrawLineF(PtrUnion packet, const PSD gpuPixelSpanDriver)
 /////////////////////////
 // Gouraud-shaded line //
 /////////////////////////
-void gpuDrawLineG(PtrUnion packet, const PSD gpuPixelSpanDriver)
+void gpuDrawLineG(gpu_unai_t &gpu_unai, PtrUnion packet, const PSD gpuPixelSpanDriver)
 {
 	int x0, y0, x1, y1;
 	int dx, dy, dr, dg, db;
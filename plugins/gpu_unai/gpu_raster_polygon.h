@@ -172,7 +172,7 @@ static inline int vertIdxOfHighestYCoord3(const T *Tptr)
 //   or 1 for second triangle of a quad (idx 1,2,3 of vbuf[]).
 //  Returns true if triangle should be rendered, false if not.
 ///////////////////////////////////////////////////////////////////////////////
-static bool polyUseTriangle(const PolyVertex *vbuf, int tri_num, const PolyVertex **vert_ptrs, s32 &x_off, s32 &y_off)
+static bool polyUseTriangle(gpu_unai_t &gpu_unai, const PolyVertex *vbuf, int tri_num, const PolyVertex **vert_ptrs, s32 &x_off, s32 &y_off)
 {
 	// Using verts 0,1,2 or is this the 2nd pass of a quad (verts 1,2,3)?
 	const PolyVertex *tri_ptr = &vbuf[(tri_num == 0) ? 0 : 1];
@@ -202,7 +202,8 @@ static bool polyUseTriangle(const PolyVertex *vbuf, int tri_num, const PolyVerte
 	// Determine if triangle is completely outside clipping range
 	s32 xmin, xmax, ymin, ymax;
 	xmin = gpu_unai.DrawingArea[0];  xmax = gpu_unai.DrawingArea[2];
-	ymin = gpu_unai.DrawingArea[1];  ymax = gpu_unai.DrawingArea[3];
+	ymin = Max2<s32>(gpu_unai.DrawingArea[1], gpu_unai.BandRows[0]);
+	ymax = Min2<s32>(gpu_unai.DrawingArea[3], gpu_unai.BandRows[1]);
 	int clipped_lowest_x  = Max2(xmin, lowest_x + x_off);
 	int clipped_lowest_y  = Max2(ymin, lowest_y + y_off);
 	int clipped_highest_x = Min2(xmax, highest_x + x_off);
@@ -227,7 +228,7 @@ static bool polyUseTriangle(const PolyVertex *vbuf, int tri_num, const PolyVerte
 /*----------------------------------------------------------------------
 gpuDrawPolyF - Flat-shaded, untextured poly
 ----------------------------------------------------------------------*/
-void gpuDrawPolyF(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad,
+void gpuDrawPolyF(gpu_unai_t &gpu_unai, const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad,
 	PolyType ptype = POLYTYPE_F)
 {
 	// Set up bgr555 color to be used across calls in inner driver
@@ -242,7 +243,7 @@ void gpuDrawPolyF(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 	{
 		const PolyVertex* vptrs[3];
 		s32 x_off, y_off;
-		if (!polyUseTriangle(vbuf, cur_pass, vptrs, x_off, y_off))
+		if (!polyUseTriangle(gpu_unai, vbuf, cur_pass, vptrs, x_off, y_off))
 			continue;
 
 		s32 xa, xb, ya, yb;
@@ -342,7 +343,8 @@ void gpuDrawPolyF(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 
 			s32 xmin, xmax, ymin, ymax;
 			xmin = gpu_unai.DrawingArea[0];  xmax = gpu_unai.DrawingArea[2];
-			ymin = gpu_unai.DrawingArea[1];  ymax = gpu_unai.DrawingArea[3];
+			ymin = Max2<s32>(gpu_unai.DrawingArea[1], gpu_unai.BandRows[0]);
+			ymax = Min2<s32>(gpu_unai.DrawingArea[3], gpu_unai.BandRows[1]);
 
 			if ((ymin - ya) > 0) {
 				x3 += (dx3 * (ymin - ya));
@@ -380,7 +382,7 @@ void gpuDrawPolyF(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 /*----------------------------------------------------------------------
 gpuDrawPolyFT - Flat-shaded, textured poly
 ----------------------------------------------------------------------*/
-void gpuDrawPolyFT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad,
+void gpuDrawPolyFT(gpu_unai_t &gpu_unai, const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad,
 	PolyType ptype = POLYTYPE_FT)
 {
 	// r8/g8/b8 used if texture-blending & dithering is applied (24-bit light)
@@ -401,7 +403,7 @@ void gpuDrawPolyFT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_qua
 	{
 		const PolyVertex* vptrs[3];
 		s32 x_off, y_off;
-		if (!polyUseTriangle(vbuf, cur_pass, vptrs, x_off, y_off))
+		if (!polyUseTriangle(gpu_unai, vbuf, cur_pass, vptrs, x_off, y_off))
 			continue;
 
 		s32 xa, xb, ya, yb;
@@ -652,7 +654,8 @@ void gpuDrawPolyFT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_qua
 
 			s32 xmin, xmax, ymin, ymax;
 			xmin = gpu_unai.DrawingArea[0];  xmax = gpu_unai.DrawingArea[2];
-			ymin = gpu_unai.DrawingArea[1];  ymax = gpu_unai.DrawingArea[3];
+			ymin = Max2<s32>(gpu_unai.DrawingArea[1], gpu_unai.BandRows[0]);
+			ymax = Min2<s32>(gpu_unai.DrawingArea[3], gpu_unai.BandRows[1]);
 
 			if ((ymin - ya) > 0) {
 				x3 += dx3 * (ymin - ya);
@@ -715,7 +718,7 @@ void gpuDrawPolyFT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_qua
 /*----------------------------------------------------------------------
 gpuDrawPolyG - Gouraud-shaded, untextured poly
 ----------------------------------------------------------------------*/
-void gpuDrawPolyG(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad)
+void gpuDrawPolyG(gpu_unai_t &gpu_unai, const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad)
 {
 	PolyVertex vbuf[4];
 	polyInitVertexBuffer(vbuf, packet, POLYTYPE_G, is_quad);
@@ -726,7 +729,7 @@ void gpuDrawPolyG(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 	{
 		const PolyVertex* vptrs[3];
 		s32 x_off, y_off;
-		if (!polyUseTriangle(vbuf, cur_pass, vptrs, x_off, y_off))
+		if (!polyUseTriangle(gpu_unai, vbuf, cur_pass, vptrs, x_off, y_off))
 			continue;
 
 		s32 xa, xb, ya, yb;
@@ -997,7 +1000,8 @@ void gpuDrawPolyG(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 
 			s32 xmin, xmax, ymin, ymax;
 			xmin = gpu_unai.DrawingArea[0];  xmax = gpu_unai.DrawingArea[2];
-			ymin = gpu_unai.DrawingArea[1];  ymax = gpu_unai.DrawingArea[3];
+			ymin = Max2<s32>(gpu_unai.DrawingArea[1], gpu_unai.BandRows[0]);
+			ymax = Min2<s32>(gpu_unai.DrawingArea[3], gpu_unai.BandRows[1]);
 
 			if ((ymin - ya) > 0) {
 				x3 += (dx3 * (ymin - ya));
@@ -1064,7 +1068,7 @@ void gpuDrawPolyG(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad
 /*----------------------------------------------------------------------
 gpuDrawPolyGT - Gouraud-shaded, textured poly
 ----------------------------------------------------------------------*/
-void gpuDrawPolyGT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad)
+void gpuDrawPolyGT(gpu_unai_t &gpu_unai, const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_quad)
 {
 	PolyVertex vbuf[4];
 	polyInitVertexBuffer(vbuf, packet, POLYTYPE_GT, is_quad);
@@ -1075,7 +1079,7 @@ void gpuDrawPolyGT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_qua
 	{
 		const PolyVertex* vptrs[3];
 		s32 x_off, y_off;
-		if (!polyUseTriangle(vbuf, cur_pass, vptrs, x_off, y_off))
+		if (!polyUseTriangle(gpu_unai, vbuf, cur_pass, vptrs, x_off, y_off))
 			continue;
 
 		s32 xa, xb, ya, yb;
@@ -1391,7 +1395,8 @@ void gpuDrawPolyGT(const PtrUnion packet, const PP gpuPolySpanDriver, u32 is_qua
 
 			s32 xmin, xmax, ymin, ymax;
 			xmin = gpu_unai.DrawingArea[0];  xmax = gpu_unai.DrawingArea[2];
-			ymin = gpu_unai.DrawingArea[1];  ymax = gpu_unai.DrawingArea[3];
+			ymin = Max2<s32>(gpu_unai.DrawingArea[1], gpu_unai.BandRows[0]);
+			ymax = Min2<s32>(gpu_unai.DrawingArea[3], gpu_unai.BandRows[1]);
 
 			if ((ymin - ya) > 0) {
 				x3 += (dx3 * (ymin - ya));
@@ -24,7 +24,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 //  GPU internal sprite drawing functions
 
-void gpuDrawS(PtrUnion packet, const PS gpuSpriteDriver, s32 *w_out, s32 *h_out)
+void gpuDrawS(gpu_unai_t &gpu_unai, PtrUnion packet, const PS gpuSpriteDriver, s32 *w_out, s32 *h_out)
 {
 	s32 x0, x1, y0, y1;
 	u32 u0, v0;
@@ -61,6 +61,12 @@ void gpuDrawS(PtrUnion packet, const PS gpuSpriteDriver, s32 *w_out, s32 *h_out)
 	*w_out = x1;
 	*h_out = y1 - y0;
 
+	// Band rendering: the timing above is for the whole sprite
+	temp = gpu_unai.BandRows[0] - y0;
+	if (temp > 0) { y0 = gpu_unai.BandRows[0]; v0 += temp; }
+	if (y1 > gpu_unai.BandRows[1]) y1 = gpu_unai.BandRows[1];
+	if (y1 <= y0) return;
+
 	le16_t *Pixel = &gpu_unai.vram[FRAME_OFFSET(x0, y0)];
 
 	gpu_unai.inn.r5 = packet.U1[0] >> 3;
@@ -73,7 +79,7 @@ void gpuDrawS(PtrUnion packet, const PS gpuSpriteDriver, s32 *w_out, s32 *h_out)
 	gpuSpriteDriver(Pixel, x1, (u8 *)gpu_unai.inn.TBA, gpu_unai.inn);
 }
 
-void gpuDrawT(PtrUnion packet, const PT gpuTileDriver, s32 *w_out, s32 *h_out)
+void gpuDrawT(gpu_unai_t &gpu_unai, PtrUnion packet, const PT gpuTileDriver, s32 *w_out, s32 *h_out)
 {
 	s32 x0, x1, y0, y1;
 
@@ -101,6 +107,10 @@ void gpuDrawT(PtrUnion packet, const PT gpuTileDriver, s32 *w_out, s32 *h_out)
 	*w_out = x1;
 	*h_out = y1 - y0;
 
+	if (y0 < gpu_unai.BandRows[0]) y0 = gpu_unai.BandRows[0];
+	if (y1 > gpu_unai.BandRows[1]) y1 = gpu_unai.BandRows[1];
+	if (y1 <= y0) return;
+
 	const u16 Data = GPU_RGB16(le32_to_u32(packet.U4[0]));
 	le16_t *Pixel = &gpu_unai.vram[FRAME_OFFSET(x0, y0)];
 
@@ -308,6 +308,13 @@ struct gpu_unai_t {
 	s16 DrawingOffset[2];  // [0] : Drawing offset X (signed)
 	                       // [1] : Drawing offset Y (signed)
 
+	u16 BandRows[2];       // [0] : First VRAM row this instance draws
+	                       // [1] : One past the last row
+	                       // 0, 512 unless band rendering (gpulib_if.cpp)
+	                       //  gives each instance a slice of the area
+	u8  band_index;        // Band rendering: slice this instance draws
+	u8  band_count;        //  and how many slices the area is split into
+
 	////////////////////////////////////////////////////////////////////////////
 	//  Inner Loop parameters
 
@@ -318,6 +325,8 @@ struct gpu_unai_t {
 	////////////////////////////////////////////////////////////////////////////
 
 	bool prog_ilace_flag;   // Tracks successive frames for 'prog_ilace' option
+	                        //  and with gpulib, the field that is skipped
+	bool field_render;      // gpulib interlace, draw lines of one field only
 
 	u8 BLEND_MODE;
 	u8 TEXT_MODE;
@@ -368,9 +377,9 @@ static inline bool ForcedDitheringEnabled()
 static inline bool ProgressiveInterlaceEnabled()
 {
 #ifdef USE_GPULIB
-	// Using this old option greatly decreases quality of image. Disabled
-	//  for now when using new gpulib, since it also adds more work in loops.
-	return false;
+	// The old option greatly decreases quality of image, so with gpulib
+	//  this is only on when it asks for interlace (renderer_set_interlace)
+	return gpu_unai.field_render;
 #else
 	return gpu_unai.config.prog_ilace;
 #endif
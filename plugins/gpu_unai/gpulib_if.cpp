@@ -59,10 +59,34 @@
 #define IS_OLD_RENDERER() false
 #endif
 
+#ifdef USE_ASYNC_GPU
+static void band_stop(void);
+static void band_invalidate(void);
+#else
+#define band_stop()
+#define band_invalidate()
+#endif
+
+// Rows of VRAM this instance draws: band rendering gives each of band_count
+//  instances a slice of the drawing area, the first and the last also get
+//  everything above/below it as fills ignore the drawing area.
+static void gpuUpdateBandRows(gpu_unai_t &gpu_unai)
+{
+  s32 y0 = gpu_unai.DrawingArea[1], h = gpu_unai.DrawingArea[3] - y0;
+  u32 i = gpu_unai.band_index, n = gpu_unai.band_count;
+
+  if (h < 0)
+    h = 0;
+  gpu_unai.BandRows[0] = i == 0 ? 0 : y0 + h * i / n;
+  gpu_unai.BandRows[1] = i + 1 >= n ? FRAME_HEIGHT : y0 + h * (i + 1) / n;
+}
+
 int renderer_init(void)
 {
   memset((void*)&gpu_unai, 0, sizeof(gpu_unai));
   gpu_unai.vram = (le16_t *)gpu.vram;
+  gpu_unai.band_count = 1;
+  gpuUpdateBandRows(gpu_unai);
 
   // Original standalone gpu_unai initialized TextureWindow[]. I added the
   //  same behavior here, since it seems unsafe to leave [2],[3] unset when
@@ -101,12 +125,14 @@ int renderer_init(void)
 
   SetupLightLUT();
   SetupDitheringConstants();
+  band_invalidate();
 
   return 0;
 }
 
 void renderer_finish(void)
 {
+  band_stop();
 }
 
 void renderer_notify_screen_change(const struct psx_gpu_screen *screen)
@@ -117,6 +143,10 @@ void renderer_notify_screen_change(const struct psx_gpu_screen *screen)
   {
     gpu_unai.inn.ilace_mask |= !!(gpu.status & PSX_GPU_STATUS_INTERLACE);
   }
+  // line skipping already drops a field
+  if (gpu_unai.inn.ilace_mask)
+    gpu_unai.field_render = false;
+  band_invalidate();
 
   /*
   printf("res change hres: %d   vres: %d   depth: %d   ilace_mask: %d\n",
@@ -138,7 +168,7 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, u32 cmd_word)
       u32 new_texpage = cmd_word & 0x7FF;
       if (cur_texpage != new_texpage) {
         gpu_unai.GPU_GP1 = (gpu_unai.GPU_GP1 & ~0x7FF) | new_texpage;
-        gpuSetTexture(gpu_unai.GPU_GP1);
+        gpuSetTexture(gpu_unai, gpu_unai.GPU_GP1);
       }
     } break;
 
@@ -162,7 +192,7 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, u32 cmd_word)
         gpu_unai.inn.u_msk = (((u32)gpu_unai.TextureWindow[2]) << fb) | ((1 << fb) - 1);
         gpu_unai.inn.v_msk = (((u32)gpu_unai.TextureWindow[3]) << fb) | ((1 << fb) - 1);
 
-        gpuSetTexture(gpu_unai.GPU_GP1);
+        gpuSetTexture(gpu_unai, gpu_unai.GPU_GP1);
       }
     } break;
 
@@ -170,12 +200,14 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, u32 cmd_word)
       // GP0(E3h) - Set Drawing Area top left (X1,Y1)
       gpu_unai.DrawingArea[0] = cmd_word         & 0x3FF;
       gpu_unai.DrawingArea[1] = (cmd_word >> 10) & 0x3FF;
+      gpuUpdateBandRows(gpu_unai);
     } break;
 
     case 4: {
       // GP0(E4h) - Set Drawing Area bottom right (X2,Y2)
       gpu_unai.DrawingArea[2] = (cmd_word         & 0x3FF) + 1;
       gpu_unai.DrawingArea[3] = ((cmd_word >> 10) & 0x3FF) + 1;
+      gpuUpdateBandRows(gpu_unai);
     } break;
 
     case 5: {
@@ -201,10 +233,11 @@ static inline bool need_lighting(u32 rgb_raw)
   return (rgb_raw & HTOLE32(0xF8F8F8)) != HTOLE32(0x808080);
 }
 
-static inline void textured_sprite(int &cpu_cycles_sum, int &cpu_cycles)
+static inline void textured_sprite(gpu_unai_t &gpu_unai,
+ int &cpu_cycles_sum, int &cpu_cycles)
 {
   u32 PRIM = le32_to_u32(gpu_unai.PacketBuffer.U4[0]) >> 24;
-  gpuSetCLUT(le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+  gpuSetCLUT(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
   u32 driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
   s32 w = 0, h = 0;
 
@@ -224,26 +257,21 @@ static inline void textured_sprite(int &cpu_cycles_sum, int &cpu_cycles)
     driver_idx |= Lighting;
   PS driver = gpuSpriteDrivers[driver_idx];
   PtrUnion packet = { .ptr = (void*)&gpu_unai.PacketBuffer };
-  gpuDrawS(packet, driver, &w, &h);
+  gpuDrawS(gpu_unai, packet, driver, &w, &h);
   gput_sum(cpu_cycles_sum, cpu_cycles, gput_sprite(w, h));
 }
 
 extern const unsigned char cmd_lengths[256];
 
-int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
- int *cycles_sum_out, int *cycles_last, int *last_cmd)
+// Draws the list with one gpu_unai_t, the main one or a band's
+static int do_cmd_list(gpu_unai_t &gpu_unai, le32_t *list, int list_len,
+ uint32_t *ex_regs, int *cycles_sum_out, int *cycles_last, int *last_cmd)
 {
   int cpu_cycles_sum = 0, cpu_cycles = *cycles_last;
   u32 cmd = 0, len, i;
-  le32_t *list = (le32_t *)list_;
   le32_t *list_start = list;
   le32_t *list_end = list + list_len;
 
-  if (IS_OLD_RENDERER()) {
-    return oldunai_do_cmd_list(list_, list_len, ex_regs,
-             cycles_sum_out, cycles_last, last_cmd);
-  }
-
   for (; list < list_end; list += 1 + len)
   {
     cmd = le32_to_u32(*list) >> 24;
@@ -263,7 +291,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
     switch (cmd)
     {
       case 0x02:
-        gpuClearImage(packet);
+        gpuClearImage(gpu_unai, packet);
         gput_sum(cpu_cycles_sum, cpu_cycles,
            gput_fill(le16_to_s16(packet.U2[4]) & 0x3ff, le16_to_s16(packet.U2[5]) & 0x1ff));
         break;
@@ -277,7 +305,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           Blending_Mode |
           gpu_unai.Masking | Blending | gpu_unai.PixelMSB
         ];
-        gpuDrawPolyF(packet, driver, false);
+        gpuDrawPolyF(gpu_unai, packet, driver, false);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_poly_base());
       } break;
 
@@ -285,8 +313,8 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x25:
       case 0x26:
       case 0x27: {          // Textured 3-pt poly
-        gpuSetCLUT   (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-        gpuSetTexture(le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
+        gpuSetCLUT   (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+        gpuSetTexture(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
 
         u32 driver_idx =
           //(gpu_unai.blit_mask?1024:0) |
@@ -302,7 +330,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         }
 
         PP driver = gpuPolySpanDrivers[driver_idx];
-        gpuDrawPolyFT(packet, driver, false);
+        gpuDrawPolyFT(gpu_unai, packet, driver, false);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_poly_base_t());
       } break;
 
@@ -315,7 +343,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           Blending_Mode |
           gpu_unai.Masking | Blending | gpu_unai.PixelMSB
         ];
-        gpuDrawPolyF(packet, driver, true); // is_quad = true
+        gpuDrawPolyF(gpu_unai, packet, driver, true); // is_quad = true
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_quad_base());
       } break;
 
@@ -324,19 +352,19 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x2E:
       case 0x2F: {          // Textured 4-pt poly
         u32 simplified_count;
-        gpuSetTexture(le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
+        gpuSetTexture(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[4]) >> 16);
         if ((simplified_count = prim_try_simplify_quad_t(gpu_unai.PacketBuffer.U4,
               gpu_unai.PacketBuffer.U4)))
         {
           for (i = 0;; ) {
-            textured_sprite(cpu_cycles_sum, cpu_cycles);
+            textured_sprite(gpu_unai, cpu_cycles_sum, cpu_cycles);
             if (++i >= simplified_count)
               break;
             memcpy(&gpu_unai.PacketBuffer.U4[0], &gpu_unai.PacketBuffer.U4[i * 4], 16);
           }
           break;
         }
-        gpuSetCLUT(le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+        gpuSetCLUT(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
 
         u32 driver_idx =
           //(gpu_unai.blit_mask?1024:0) |
@@ -352,7 +380,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         }
 
         PP driver = gpuPolySpanDrivers[driver_idx];
-        gpuDrawPolyFT(packet, driver, true); // is_quad = true
+        gpuDrawPolyFT(gpu_unai, packet, driver, true); // is_quad = true
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_quad_base_t());
       } break;
 
@@ -377,9 +405,9 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           gpu_unai.Masking | Blending | gouraud | gpu_unai.PixelMSB
         ];
         if (gouraud)
-          gpuDrawPolyG(packet, driver, false);
+          gpuDrawPolyG(gpu_unai, packet, driver, false);
         else
-          gpuDrawPolyF(packet, driver, false, POLYTYPE_G);
+          gpuDrawPolyF(gpu_unai, packet, driver, false, POLYTYPE_G);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_poly_base_g());
       } break;
 
@@ -387,8 +415,8 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x35:
       case 0x36:
       case 0x37: {          // Gouraud-shaded, textured 3-pt poly
-        gpuSetCLUT    (le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
-        gpuSetTexture (le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
+        gpuSetCLUT    (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+        gpuSetTexture (gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
         u8 lighting = Lighting;
         u8 gouraud = lighting ? (1<<7) : 0;
         if (lighting) {
@@ -408,9 +436,9 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           gpu_unai.Masking | Blending | gouraud | lighting | gpu_unai.PixelMSB
         ];
         if (gouraud)
-          gpuDrawPolyGT(packet, driver, false); // is_quad = true
+          gpuDrawPolyGT(gpu_unai, packet, driver, false); // is_quad = true
         else
-          gpuDrawPolyFT(packet, driver, false, POLYTYPE_GT);
+          gpuDrawPolyFT(gpu_unai, packet, driver, false, POLYTYPE_GT);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_poly_base_gt());
       } break;
 
@@ -432,9 +460,9 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           gpu_unai.Masking | Blending | gouraud | gpu_unai.PixelMSB
         ];
         if (gouraud)
-          gpuDrawPolyG(packet, driver, true); // is_quad = true
+          gpuDrawPolyG(gpu_unai, packet, driver, true); // is_quad = true
         else
-          gpuDrawPolyF(packet, driver, true, POLYTYPE_G);
+          gpuDrawPolyF(gpu_unai, packet, driver, true, POLYTYPE_G);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_quad_base_g());
       } break;
 
@@ -443,19 +471,19 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x3E:
       case 0x3F: {          // Gouraud-shaded, textured 4-pt poly
         u32 simplified_count;
-        gpuSetTexture(le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
+        gpuSetTexture(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[5]) >> 16);
         if ((simplified_count = prim_try_simplify_quad_gt(gpu_unai.PacketBuffer.U4,
               gpu_unai.PacketBuffer.U4)))
         {
           for (i = 0;; ) {
-            textured_sprite(cpu_cycles_sum, cpu_cycles);
+            textured_sprite(gpu_unai, cpu_cycles_sum, cpu_cycles);
             if (++i >= simplified_count)
               break;
             memcpy(&gpu_unai.PacketBuffer.U4[0], &gpu_unai.PacketBuffer.U4[i * 4], 16);
           }
           break;
         }
-        gpuSetCLUT(le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
+        gpuSetCLUT(gpu_unai, le32_to_u32(gpu_unai.PacketBuffer.U4[2]) >> 16);
         u8 lighting = Lighting;
         u8 gouraud = lighting ? (1<<7) : 0;
         if (lighting) {
@@ -475,9 +503,9 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           gpu_unai.Masking | Blending | gouraud | lighting | gpu_unai.PixelMSB
         ];
         if (gouraud)
-          gpuDrawPolyGT(packet, driver, true); // is_quad = true
+          gpuDrawPolyGT(gpu_unai, packet, driver, true); // is_quad = true
         else
-          gpuDrawPolyFT(packet, driver, true, POLYTYPE_GT);
+          gpuDrawPolyFT(gpu_unai, packet, driver, true, POLYTYPE_GT);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_quad_base_gt());
       } break;
 
@@ -488,7 +516,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         // Shift index right by one, as untextured prims don't use lighting
         u32 driver_idx = (Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1;
         PSD driver = gpuPixelSpanDrivers[driver_idx];
-        gpuDrawLineF(packet, driver);
+        gpuDrawLineF(gpu_unai, packet, driver);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_line(0));
       } break;
 
@@ -499,13 +527,13 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         // Shift index right by one, as untextured prims don't use lighting
         u32 driver_idx = (Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1;
         PSD driver = gpuPixelSpanDrivers[driver_idx];
-        gpuDrawLineF(packet, driver);
+        gpuDrawLineF(gpu_unai, packet, driver);
 
         while(1)
         {
           gpu_unai.PacketBuffer.U4[1] = gpu_unai.PacketBuffer.U4[2];
           gpu_unai.PacketBuffer.U4[2] = *list_position++;
-          gpuDrawLineF(packet, driver);
+          gpuDrawLineF(gpu_unai, packet, driver);
           gput_sum(cpu_cycles_sum, cpu_cycles, gput_line(0));
 
           num_vertexes++;
@@ -529,7 +557,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         // Index MSB selects Gouraud-shaded PixelSpanDriver:
         driver_idx |= (1 << 5);
         PSD driver = gpuPixelSpanDrivers[driver_idx];
-        gpuDrawLineG(packet, driver);
+        gpuDrawLineG(gpu_unai, packet, driver);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_line(0));
       } break;
 
@@ -542,7 +570,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         // Index MSB selects Gouraud-shaded PixelSpanDriver:
         driver_idx |= (1 << 5);
         PSD driver = gpuPixelSpanDrivers[driver_idx];
-        gpuDrawLineG(packet, driver);
+        gpuDrawLineG(gpu_unai, packet, driver);
 
         while(1)
         {
@@ -550,7 +578,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
           gpu_unai.PacketBuffer.U4[1] = gpu_unai.PacketBuffer.U4[3];
           gpu_unai.PacketBuffer.U4[2] = *list_position++;
           gpu_unai.PacketBuffer.U4[3] = *list_position++;
-          gpuDrawLineG(packet, driver);
+          gpuDrawLineG(gpu_unai, packet, driver);
           gput_sum(cpu_cycles_sum, cpu_cycles, gput_line(0));
 
           num_vertexes++;
@@ -571,7 +599,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x63: {          // Monochrome rectangle (variable size)
         PT driver = gpuTileDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
         s32 w = 0, h = 0;
-        gpuDrawT(packet, driver, &w, &h);
+        gpuDrawT(gpu_unai, packet, driver, &w, &h);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_sprite(w, h));
       } break;
 
@@ -579,7 +607,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x65:
       case 0x66:
       case 0x67:            // Textured rectangle (variable size)
-        textured_sprite(cpu_cycles_sum, cpu_cycles);
+        textured_sprite(gpu_unai, cpu_cycles_sum, cpu_cycles);
         break;
 
       case 0x68:
@@ -589,7 +617,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00010001);
         PT driver = gpuTileDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
         s32 w = 0, h = 0;
-        gpuDrawT(packet, driver, &w, &h);
+        gpuDrawT(gpu_unai, packet, driver, &w, &h);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_sprite(1, 1));
       } break;
 
@@ -600,7 +628,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00080008);
         PT driver = gpuTileDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
         s32 w = 0, h = 0;
-        gpuDrawT(packet, driver, &w, &h);
+        gpuDrawT(gpu_unai, packet, driver, &w, &h);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_sprite(w, h));
       } break;
 
@@ -609,7 +637,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x76:
       case 0x77: {          // Textured rectangle (8x8)
         gpu_unai.PacketBuffer.U4[3] = u32_to_le32(0x00080008);
-        textured_sprite(cpu_cycles_sum, cpu_cycles);
+        textured_sprite(gpu_unai, cpu_cycles_sum, cpu_cycles);
       } break;
 
       case 0x78:
@@ -619,7 +647,7 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
         gpu_unai.PacketBuffer.U4[2] = u32_to_le32(0x00100010);
         PT driver = gpuTileDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
         s32 w = 0, h = 0;
-        gpuDrawT(packet, driver, &w, &h);
+        gpuDrawT(gpu_unai, packet, driver, &w, &h);
         gput_sum(cpu_cycles_sum, cpu_cycles, gput_sprite(w, h));
       } break;
 
@@ -628,18 +656,18 @@ int renderer_do_cmd_list(u32 *list_, int list_len, uint32_t *ex_regs,
       case 0x7E:
       case 0x7F: {          // Textured rectangle (16x16)
         gpu_unai.PacketBuffer.U4[3] = u32_to_le32(0x00100010);
-        textured_sprite(cpu_cycles_sum, cpu_cycles);
+        textured_sprite(gpu_unai, cpu_cycles_sum, cpu_cycles);
       } break;
 
 #ifdef TEST
       case 0x80:          //  vid -> vid
-        gpuMoveImage(packet);
+        gpuMoveImage(gpu_unai, packet);
         break;
 
       case 0xA0:          //  sys -> vid
       {
-        u32 load_width = list[2] & 0xffff;
-        u32 load_height = list[2] >> 16;
+        u32 load_width = le32_to_u32(list[2]) & 0xffff;
+        u32 load_height = le32_to_u32(list[2]) >> 16;
         u32 load_size = load_width * load_height;
 
         len += load_size / 2;
@@ -673,6 +701,460 @@ breakloop:
   return list - list_start;
 }
 
+#ifdef USE_ASYNC_GPU
+
+/*
+ * Band rendering, same idea as gpu_neon's: the drawing area is split into
+ * horizontal bands, gpu_unai draws the first one on the calling thread and
+ * each of the others has its own gpu_unai_t and thread.  All instances
+ * parse the same commands and only clip differently (BandRows[]), so their
+ * state stays the same, and the cycle counts come from gpu_unai alone,
+ * which clips to its band only after taking them.  Polys, sprites, tiles
+ * and fills clip rows exactly, so the bands together draw what a single
+ * instance would.  Lines clip by slope and would not, so runs of them are
+ * drawn whole by gpu_unai while the workers sit out.  The list is cut into
+ * segments that end before textured prims that read something written in
+ * the segment (or their own drawing area), before writes to something read
+ * in it, before the drawing area moves vertically and at the commands
+ * gpulib handles (VRAM copies and transfers) - everything between segments
+ * is done with the workers idle.
+ */
+extern "C" {
+#include "../../frontend/pcsxr-threads.h"
+}
+
+#define BAND_MAX 4
+#define BAND_MIN_WORDS 64 // shorter segments are not worth waking threads
+
+static struct
+{
+  gpu_unai_t gpus[BAND_MAX]; // [0] is unused, that's gpu_unai
+  uint32_t ex_regs[BAND_MAX][8]; // scratch, parse only writes them
+  sthread_t *threads[BAND_MAX];
+  slock_t *lock;
+  scond_t *cond_job;
+  scond_t *cond_done;
+  le32_t *list;
+  int words;
+  u32 job_seq;
+  int pending;
+  int started;
+  int count;
+  u8 stale;  // workers need a fresh copy of gpu_unai
+  u8 exit;
+} bands __attribute__((aligned(32)));
+
+struct band_box {
+  s32 x0, y0, x1, y1;
+};
+
+static void band_parse(int i, le32_t *list, int words)
+{
+  int dummy0 = 0, dummy1 = 0, dummy2 = 0;
+  do_cmd_list(bands.gpus[i], list, words, bands.ex_regs[i],
+    &dummy0, &dummy1, &dummy2);
+}
+
+static STRHEAD_RET_TYPE band_thread(void *unused)
+{
+  u32 seq = 0;
+  int i;
+
+  slock_lock(bands.lock);
+  i = ++bands.started;
+  while (1)
+  {
+    while (bands.job_seq == seq && !bands.exit)
+      scond_wait(bands.cond_job, bands.lock);
+    if (bands.exit)
+      break;
+    seq = bands.job_seq;
+    slock_unlock(bands.lock);
+
+    band_parse(i, bands.list, bands.words);
+
+    slock_lock(bands.lock);
+    if (--bands.pending == 0)
+      scond_signal(bands.cond_done);
+  }
+  slock_unlock(bands.lock);
+  STRHEAD_RETURN();
+}
+
+// make the workers continue from where gpu_unai is
+static void band_clone(void)
+{
+  int i;
+
+  for (i = 1; i < bands.count; i++)
+  {
+    gpu_unai_t &w = bands.gpus[i];
+    memcpy((void *)&w, (void *)&gpu_unai, sizeof(w));
+    w.band_index = i;
+    gpuUpdateBandRows(w);
+  }
+  bands.stale = 0;
+}
+
+#define bands_active() (bands.count > 1)
+
+static void band_invalidate(void)
+{
+  bands.stale = 1;
+}
+
+static void band_stop(void)
+{
+  int i;
+
+  if (bands.lock) {
+    slock_lock(bands.lock);
+    bands.exit = 1;
+    scond_broadcast(bands.cond_job);
+    slock_unlock(bands.lock);
+  }
+  for (i = 1; i < BAND_MAX; i++) {
+    if (bands.threads[i]) {
+      sthread_join(bands.threads[i]);
+      bands.threads[i] = NULL;
+    }
+  }
+  if (bands.cond_done) { scond_free(bands.cond_done); bands.cond_done = NULL; }
+  if (bands.cond_job)  { scond_free(bands.cond_job); bands.cond_job = NULL; }
+  if (bands.lock)      { slock_free(bands.lock); bands.lock = NULL; }
+  bands.started = bands.pending = 0;
+  bands.job_seq = 0;
+  bands.exit = 0;
+  bands.count = 1;
+
+  gpu_unai.band_index = 0;
+  gpu_unai.band_count = 1;
+  gpuUpdateBandRows(gpu_unai);
+}
+
+static void band_start(int count)
+{
+  int i;
+
+  if (count > BAND_MAX)
+    count = BAND_MAX;
+  if (count < 1)
+    count = 1;
+  if (count == Max2(bands.count, 1))
+    return;
+
+  band_stop();
+  if (count == 1)
+    return;
+
+  bands.lock = slock_new();
+  bands.cond_job = scond_new();
+  bands.cond_done = scond_new();
+  if (!bands.lock || !bands.cond_job || !bands.cond_done)
+    goto fail;
+  for (i = 1; i < count; i++) {
+    bands.threads[i] = pcsxr_sthread_create(band_thread, PCSXRT_GPU_BAND);
+    if (bands.threads[i] == NULL)
+      goto fail;
+  }
+
+  bands.count = count;
+  bands.stale = 1;
+  gpu_unai.band_count = count;
+  gpuUpdateBandRows(gpu_unai);
+  return;
+
+fail:
+  SysPrintf("gpu band init failed\n");
+  band_stop();
+}
+
+static int band_box_hit(const struct band_box *b, s32 x, s32 y, s32 w, s32 h)
+{
+  if (b->x0 > b->x1 || y > b->y1 || y + h - 1 < b->y0)
+    return 0;
+  if (x <= b->x1 && x + w - 1 >= b->x0)
+    return 1;
+  // texture pages and cluts wrap around horizontally
+  return x + w > 1024 && x + w - 1 - 1024 >= b->x0;
+}
+
+static void band_box_add(struct band_box *b, s32 x, s32 y, s32 w, s32 h)
+{
+  if (x + w > 1024)
+    x = 0, w = 1024;
+  if (b->x0 > b->x1) {
+    b->x0 = x;  b->y0 = y;
+    b->x1 = x + w - 1;  b->y1 = y + h - 1;
+    return;
+  }
+  b->x0 = Min2(b->x0, x);  b->y0 = Min2(b->y0, y);
+  b->x1 = Max2(b->x1, x + w - 1);  b->y1 = Max2(b->y1, y + h - 1);
+}
+
+// texture page and clut boxes as band_box_hit() takes them
+static void band_tex_boxes(u32 tp, u32 clut, s32 *b)
+{
+  u32 depth = (tp >> 7) & 3;
+
+  b[0] = (tp & 0xf) * 64;  b[1] = ((tp >> 4) & 1) * 256;
+  b[2] = depth ? (depth == 1 ? 128 : 256) : 64;  b[3] = 256;
+  b[4] = (clut & 0x3f) * 16;  b[5] = (clut >> 6) & 0x1ff;
+  b[6] = depth < 2 ? (depth ? 256 : 16) : 0;  b[7] = 1;
+}
+
+// textured prim: may it read pixels written in this segment or by itself?
+//  If not, add what it reads to 'read'.
+static int band_tex_read(const struct band_box *drawn,
+ const struct band_box *area, struct band_box *read, u32 tp, u32 clut)
+{
+  s32 b[8];
+  int i;
+
+  band_tex_boxes(tp, clut, b);
+  for (i = 0; i < 8; i += 4) {
+    if (b[i + 2] == 0)
+      continue;
+    if (band_box_hit(drawn, b[i], b[i + 1], b[i + 2], b[i + 3])
+        || band_box_hit(area, b[i], b[i + 1], b[i + 2], b[i + 3]))
+      return 1;
+  }
+  for (i = 0; i < 8; i += 4)
+    if (b[i + 2] != 0)
+      band_box_add(read, b[i], b[i + 1], b[i + 2], b[i + 3]);
+  return 0;
+}
+
+static int band_box_overlap(const struct band_box *a, const struct band_box *b)
+{
+  return a->x0 <= a->x1 && b->x0 <= b->x1
+    && a->x0 <= b->x1 && b->x0 <= a->x1
+    && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+// length of the line cmd at list[pos], 0 if the list ends before it does
+static int band_line_len(const le32_t *list, int pos, int words, u32 cmd)
+{
+  int len = 1 + cmd_lengths[cmd], step = (cmd & 0x10) ? 2 : 1;
+
+  if (!(cmd & 0x08))
+    return len;
+  // strips run until the terminator, see the 0x48/0x58 cases
+  for (len--; ; len += step) {
+    if (pos + len >= words)
+      return 0;
+    if ((le32_raw(list[pos + len]) & HTOLE32(0xf000f000)) == HTOLE32(0x50005000))
+      return len + 1;
+  }
+}
+
+// returns how many words can be drawn as one segment,
+//  or -len if the list starts with prims gpu_unai must draw alone
+static int band_scan(const le32_t *list, int words)
+{
+  struct band_box area = { gpu_unai.DrawingArea[0], gpu_unai.DrawingArea[1],
+    gpu_unai.DrawingArea[2] - 1, gpu_unai.DrawingArea[3] - 1 };
+  struct band_box drawn = { 1, 1, 0, 0 }, read = { 1, 1, 0, 0 };
+  u32 tp = gpu_unai.GPU_GP1 & 0x1ff, cmd, w0;
+  int pos, len, v, area_moved = 0;
+
+  for (pos = 0; pos < words; pos += len)
+  {
+    w0 = le32_to_u32(list[pos]);
+    cmd = w0 >> 24;
+    len = 1 + cmd_lengths[cmd];
+    if (pos + len > words)
+      return words; // incomplete, the parsers will stop there
+
+    switch (cmd)
+    {
+      case 0x02: {
+        const le16_t *l16 = (const le16_t *)&list[pos];
+        s32 x = le16_to_s16(l16[2]) & ~0xf, y = le16_to_s16(l16[3]);
+        s32 w = ((le16_to_s16(l16[4]) & 0x3ff) + 0xf) & ~0xf;
+        s32 h = le16_to_s16(l16[5]) & 0x1ff;
+        struct band_box fill = { Max2<s32>(x, 0), Max2<s32>(y, 0),
+          Min2<s32>(x + w, FRAME_WIDTH) - 1, Min2<s32>(y + h, FRAME_HEIGHT) - 1 };
+        if (band_box_overlap(&read, &fill))
+          return pos;
+        if (fill.x0 <= fill.x1 && fill.y0 <= fill.y1)
+          band_box_add(&drawn, fill.x0, fill.y0,
+            fill.x1 - fill.x0 + 1, fill.y1 - fill.y0 + 1);
+        continue;
+      }
+      case 0x1f:
+      case 0x80 ... 0xdf:
+        return pos + len;
+      case 0x24 ... 0x27:
+      case 0x2c ... 0x2f:
+      case 0x34 ... 0x37:
+      case 0x3c ... 0x3f:
+        v = (le32_to_u32(list[pos + 4 + ((cmd >> 4) & 1)]) >> 16) & 0x1ff;
+        if (band_tex_read(&drawn, &area, &read, v,
+              le32_to_u32(list[pos + 2]) >> 16))
+          return pos ? pos : -len;
+        tp = v;
+        break;
+      case 0x40 ... 0x5f:
+        if (pos)
+          return pos;
+        for (; pos < words; pos += len) {
+          cmd = le32_to_u32(list[pos]) >> 24;
+          if (cmd < 0x40 || cmd > 0x5f)
+            break;
+          len = band_line_len(list, pos, words, cmd);
+          if (len == 0 || pos + len > words)
+            return -words;
+        }
+        return -pos;
+      case 0x64 ... 0x67:
+      case 0x6c ... 0x6f:
+      case 0x74 ... 0x77:
+      case 0x7c ... 0x7f:
+        if (band_tex_read(&drawn, &area, &read, tp,
+              le32_to_u32(list[pos + 2]) >> 16))
+          return pos ? pos : -len;
+        break;
+      case 0xe1:
+        tp = w0 & 0x1ff;
+        break;
+      // rows move between bands when the area changes vertically,
+      //  so pixels drawn so far may be drawn over by another thread
+      case 0xe3:
+        v = (w0 >> 10) & 0x3ff;
+        if (v != area.y0 && drawn.x0 <= drawn.x1)
+          return pos;
+        area_moved |= v != area.y0 || (s32)(w0 & 0x3ff) != area.x0;
+        area.x0 = w0 & 0x3ff;
+        area.y0 = v;
+        break;
+      case 0xe4:
+        v = (w0 >> 10) & 0x3ff;
+        if (v != area.y1 && drawn.x0 <= drawn.x1)
+          return pos;
+        area_moved |= v != area.y1 || (s32)(w0 & 0x3ff) != area.x1;
+        area.x1 = w0 & 0x3ff;
+        area.y1 = v;
+        break;
+      default:
+        break;
+    }
+    if (0x20 <= cmd && cmd < 0x80 && area.x0 <= area.x1 && area.y0 <= area.y1)
+    {
+      // the textured prims checked 'read' against the area they are in,
+      //  but not against one it has moved to since
+      if (area_moved && band_box_overlap(&read, &area))
+        return pos;
+      area_moved = 0;
+      band_box_add(&drawn, area.x0, area.y0,
+        area.x1 - area.x0 + 1, area.y1 - area.y0 + 1);
+    }
+  }
+  return words;
+}
+
+static int band_segment(le32_t *list, int words, uint32_t *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  int i, ret, threaded = words >= BAND_MIN_WORDS;
+
+  if (threaded) {
+    slock_lock(bands.lock);
+    bands.list = list;
+    bands.words = words;
+    bands.pending = bands.count - 1;
+    bands.job_seq++;
+    scond_broadcast(bands.cond_job);
+    slock_unlock(bands.lock);
+  }
+  else {
+    for (i = 1; i < bands.count; i++)
+      band_parse(i, list, words);
+  }
+
+  ret = do_cmd_list(gpu_unai, list, words, ex_regs,
+          cycles_sum, cycles_last, last_cmd);
+
+  if (threaded) {
+    slock_lock(bands.lock);
+    while (bands.pending > 0)
+      scond_wait(bands.cond_done, bands.lock);
+    slock_unlock(bands.lock);
+  }
+  return ret;
+}
+
+// lines leave no state behind, the workers can just skip them, anything
+//  else done here has to be copied over
+static int band_solo(le32_t *list, int words, uint32_t *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  u32 cmd = le32_to_u32(list[0]) >> 24;
+  int ret;
+
+  gpu_unai.band_count = 1;
+  gpuUpdateBandRows(gpu_unai);
+  ret = do_cmd_list(gpu_unai, list, words, ex_regs,
+          cycles_sum, cycles_last, last_cmd);
+  gpu_unai.band_count = bands.count;
+  gpuUpdateBandRows(gpu_unai);
+  if (cmd < 0x40 || cmd > 0x5f)
+    bands.stale = 1;
+  return ret;
+}
+
+static int band_do_cmd_list(le32_t *list, int count, uint32_t *ex_regs,
+ int *cycles_sum, int *cycles_last, int *last_cmd)
+{
+  int pos = 0, len, ret;
+
+  if (gpu_unai.band_count != bands.count) {
+    gpu_unai.band_count = bands.count;
+    gpuUpdateBandRows(gpu_unai);
+  }
+
+  while (pos < count)
+  {
+    if (bands.stale)
+      band_clone();
+    len = band_scan(list + pos, count - pos);
+    if (len < 0) {
+      len = -len;
+      ret = band_solo(list + pos, len, ex_regs,
+              cycles_sum, cycles_last, last_cmd);
+    }
+    else
+      ret = band_segment(list + pos, len, ex_regs,
+              cycles_sum, cycles_last, last_cmd);
+    pos += ret;
+    if (ret < len)
+      break;
+  }
+  return pos;
+}
+
+#else
+
+#define bands_active() 0
+#define band_start(count)
+#define band_do_cmd_list(list, count, ex_regs, sum, last, cmd) 0
+
+#endif // USE_ASYNC_GPU
+
+int renderer_do_cmd_list(u32 *list, int list_len, uint32_t *ex_regs,
+ int *cycles_sum_out, int *cycles_last, int *last_cmd)
+{
+  if (IS_OLD_RENDERER()) {
+    return oldunai_do_cmd_list(list, list_len, ex_regs,
+             cycles_sum_out, cycles_last, last_cmd);
+  }
+  if (bands_active())
+    return band_do_cmd_list((le32_t *)list, list_len, ex_regs,
+             cycles_sum_out, cycles_last, last_cmd);
+  return do_cmd_list(gpu_unai, (le32_t *)list, list_len, ex_regs,
+           cycles_sum_out, cycles_last, last_cmd);
+}
+
 void renderer_sync_ecmds(u32 *ecmds)
 {
   if (!IS_OLD_RENDERER()) {
@@ -693,6 +1175,9 @@ void renderer_flush_queues(void)
 
 void renderer_set_interlace(int enable, int is_odd)
 {
+  // like gpu_neon: only the field that's displayed next gets drawn
+  gpu_unai.field_render = enable;
+  gpu_unai.prog_ilace_flag = !is_odd;
   renderer_notify_screen_change(&gpu.screen);
 }
 
@@ -710,6 +1195,8 @@ void renderer_set_config(const struct rearmed_cbs *cbs)
   gpu_unai.config.force_dithering = cbs->dithering >> 1;
 
   renderer_notify_screen_change(&gpu.screen);
+  band_start(cbs->gpu_unai.render_bands);
+  band_invalidate();
   oldunai_renderer_set_config(cbs);
 }
 
@@ -18,11 +18,20 @@
 #include "../../libpcsxcore/gpu.h" // meh
 #include "../../frontend/plugin_lib.h"
 #include "../../include/compiler_features.h"
+#include "../../include/evtrace.h"
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 #endif
 
+#if (defined(__clang_major__) && __clang_major__ >= 4) \
+    || (defined(__GNUC__) && __GNUC__ >= 5)
+// generic vectors, become NEON or SSE2 depending on the target
+typedef uint16_t gvu16u __attribute__((vector_size(16),aligned(2)));
+typedef int16_t  gvs16u __attribute__((vector_size(16),aligned(2)));
+#define HAVE_GVEC
+#endif
+
 //#define log_io gpu_log
 #define log_io(...)
 
@@ -31,6 +40,8 @@ struct psx_gpu gpu;
 static noinline int do_cmd_buffer(struct psx_gpu *gpu, uint32_t *data, int count,
     int *cycles_sum, int *cycles_last);
 static noinline void finish_vram_transfer(struct psx_gpu *gpu, int is_read, int is_async);
+static noinline void mark_cmd_list_dirty(struct psx_gpu *gpu,
+    const uint32_t *list, int count, uint32_t e3, uint32_t e4);
 
 static void sync_renderer(struct psx_gpu *gpu)
 {
@@ -197,6 +208,7 @@ static noinline void decide_frameskip(struct psx_gpu *gpu)
     else
       renderer_do_cmd_list(gpu->frameskip.pending_fill, 3, gpu->ex_regs,
         &dummy, &dummy, &dummy);
+    mark_cmd_list_dirty(gpu, gpu->frameskip.pending_fill, 3, 0, 0);
     gpu->frameskip.pending_fill[0] = 0;
   }
 }
@@ -216,6 +228,19 @@ static noinline int decide_frameskip_allow(struct psx_gpu *gpu)
 
 static void flush_cmd_buffer(struct psx_gpu *gpu);
 
+// for field rendering, which must stop while the game looks at the
+// other field of what it displays
+static void check_fb_read(struct psx_gpu *gpu, int x, int y, int w, int h)
+{
+  int dw = gpu->screen.hres, dh = gpu->screen.vres;
+
+  if (gpu->status & PSX_GPU_STATUS_RGB24)
+    dw = dw * 3 / 2;
+  if (x < gpu->screen.src_x + dw && gpu->screen.src_x < x + w
+      && y < gpu->screen.src_y + dh && gpu->screen.src_y < y + h)
+    gpu->state.last_fb_read_frame = *gpu->state.frame_count;
+}
+
 static noinline void get_gpu_info(struct psx_gpu *gpu, uint32_t data)
 {
   if (unlikely(gpu->cmd_len > 0))
@@ -286,6 +311,98 @@ static int map_vram(void)
   }
 }
 
+/*
+ * Command recording, for plugins/gpulib/test_bench.sh corpora. A capture
+ * starts on a frame boundary and is 3 files at the frontend's path prefix:
+ *  dump3.dump: vram, gp1 regs 0-14 and status at the start (test.c's state)
+ *  list.dump: the ecmds at the start, then every gp0 word consumed
+ *  gp1.dump: le32 pairs { word position in list.dump, gp1 write },
+ *            position with bit31 set is the end of a frame instead
+ */
+static FILE *record_open(struct psx_gpu *gpu, const char *name)
+{
+  char buf[512];
+  FILE *f;
+
+  snprintf(buf, sizeof(buf), "%s%s", *gpu->record.path, name);
+  f = fopen(buf, "wb");
+  if (f == NULL)
+    SysPrintf("gpu record: can't create %s\n", buf);
+  return f;
+}
+
+static void record_gp1(struct psx_gpu *gpu, uint32_t pos, uint32_t data)
+{
+  uint32_t e[2] = { HTOLE32(pos), HTOLE32(data) };
+  fwrite(e, 1, sizeof(e), gpu->record.gp1);
+}
+
+static noinline void record_stop(struct psx_gpu *gpu)
+{
+  if (gpu->record.list == NULL)
+    return;
+  fclose(gpu->record.list);
+  fclose(gpu->record.gp1);
+  gpu->record.list = gpu->record.gp1 = NULL;
+  if (gpu->record.request)
+    *gpu->record.request = 0;
+  SysPrintf("gpu record: %u frames, %u words\n", gpu->record.frame,
+    gpu->record.words);
+}
+
+static noinline void record_start(struct psx_gpu *gpu)
+{
+  uint32_t regs[16], e;
+  FILE *f;
+  int i;
+
+  // needs a clean start, no transfer going on
+  if (gpu->dma.h || gpu->cmd_len || gpu->record.path == NULL
+      || *gpu->record.path == NULL)
+    return;
+  gpu_async_sync(gpu);
+
+  if ((f = record_open(gpu, "dump3.dump")) == NULL)
+    goto fail;
+  for (i = 0; i < 15; i++)
+    regs[i] = HTOLE32(gpu->regs[i]);
+  regs[15] = HTOLE32(gpu->status);
+  fwrite(gpu->vram, 1, 1024 * 512 * 2, f);
+  fwrite(regs, 1, sizeof(regs), f);
+  fclose(f);
+
+  gpu->record.list = record_open(gpu, "list.dump");
+  gpu->record.gp1 = record_open(gpu, "gp1.dump");
+  if (gpu->record.list == NULL || gpu->record.gp1 == NULL) {
+    if (gpu->record.list) fclose(gpu->record.list);
+    if (gpu->record.gp1) fclose(gpu->record.gp1);
+    gpu->record.list = gpu->record.gp1 = NULL;
+    goto fail;
+  }
+  for (i = 1; i <= 6; i++) {
+    e = HTOLE32(((0xe0 + i) << 24) | (gpu->ex_regs[i] & 0xffffff));
+    fwrite(&e, 1, 4, gpu->record.list);
+  }
+  gpu->record.words = 6;
+  gpu->record.frame = 0;
+  return;
+
+fail:
+  *gpu->record.request = 0;
+}
+
+// on every vsync while a recording is requested
+static noinline void record_frame(struct psx_gpu *gpu)
+{
+  if (gpu->record.list == NULL) {
+    record_start(gpu);
+    return;
+  }
+  record_gp1(gpu, gpu->record.words | 0x80000000, gpu->record.frame);
+  if (++gpu->record.frame >= *gpu->record.request)
+    record_stop(gpu);
+}
+
 long GPUinit(void)
 {
   int ret;
@@ -307,6 +424,7 @@ long GPUshutdown(void)
 {
   long ret;
 
+  record_stop(&gpu);
   gpu_async_stop(&gpu);
   renderer_finish();
   ret = vout_finish();
@@ -329,6 +447,9 @@ void GPUwriteStatus(uint32_t data)
   uint32_t fb_dirty = 1;
   int src_x, src_y;
 
+  if (unlikely(gpu.record.list != NULL))
+    record_gp1(&gpu, gpu.record.words, data);
+
   if (cmd < ARRAY_SIZE(gpu.regs)) {
     if (cmd > 1 && cmd != 5 && gpu.regs[cmd] == data)
       return;
@@ -427,23 +548,158 @@ const unsigned char cmd_lengths[256] =
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 };
 
+const unsigned short gput_cmd_cycles[256] =
+{
+	[0x02]          = gput_fill_base(),
+	[0x20 ... 0x23] = gput_poly_base(),
+	[0x24 ... 0x27] = gput_poly_base_t(),
+	[0x28 ... 0x2b] = gput_quad_base(),
+	[0x2c ... 0x2f] = gput_quad_base_t(),
+	[0x30 ... 0x33] = gput_poly_base_g(),
+	[0x34 ... 0x37] = gput_poly_base_gt(),
+	[0x38 ... 0x3b] = gput_quad_base_g(),
+	[0x3c ... 0x3f] = gput_quad_base_gt(),
+	[0x40 ... 0x5f] = gput_line(0), // polylines: first segment
+	[0x60 ... 0x67] = gput_sprite_base(),
+	[0x68 ... 0x6b] = gput_sprite(1, 1),
+	[0x70 ... 0x77] = gput_sprite(8, 8),
+	[0x78 ... 0x7f] = gput_sprite(16, 16),
+};
+
 // this isn't very useful so should be rare
+// note: forward only, also used for overlapping copies with dst < src
 void cpy_mask(uint16_t *dst, const uint16_t *src, int l, uint32_t r6)
 {
-  int i;
+  int i = 0;
   if (r6 == 1) {
-    for (i = 0; i < l; i++)
+#ifdef HAVE_GVEC
+    for (; i + 8 <= l; i += 8)
+      *(gvu16u *)&dst[i] = *(const gvu16u *)&src[i] | 0x8000;
+#endif
+    for (; i < l; i++)
       dst[i] = src[i] | 0x8000;
   }
   else {
     uint16_t msb = r6 << 15;
-    for (i = 0; i < l; i++) {
+#ifdef HAVE_GVEC
+    for (; i + 8 <= l; i += 8) {
+      gvu16u d = *(gvu16u *)&dst[i];
+      gvu16u mask = (gvu16u)(*(gvs16u *)&dst[i] >> 15);
+      *(gvu16u *)&dst[i] = (d & mask) | ((*(const gvu16u *)&src[i] | msb) & ~mask);
+    }
+#endif
+    for (; i < l; i++) {
       uint16_t mask = (int16_t)dst[i] >> 15;
       dst[i] = (dst[i] & mask) | ((src[i] | msb) & ~mask);
     }
   }
 }
 
+// coarse map of vram written since the last flip, so that a screen
+// nothing was drawn to doesn't have to be converted and output again
+static void mark_vram_dirty(struct psx_gpu *gpu, int x, int y, int w, int h)
+{
+  uint32_t cols;
+  int i;
+
+  if (w <= 0 || h <= 0)
+    return;
+  x &= 0x3ff;
+  y &= 0x1ff;
+  if (x + w > 1024)
+    cols = 0xffff; // wraps, don't bother
+  else
+    cols = (2u << ((x + w - 1) >> 6)) - (1u << (x >> 6));
+  if (h > 512)
+    h = 512;
+  for (i = y >> 4; i <= (y + h - 1) >> 4; i++)
+    gpu->vram_dirty[i & 31] |= cols;
+}
+
+static int is_vram_dirty(const struct psx_gpu *gpu, int x, int y, int w, int h)
+{
+  uint32_t cols, rows = 0;
+  int i;
+
+  if (w <= 0 || h <= 0)
+    return 0;
+  x &= 0x3ff;
+  y &= 0x1ff;
+  if (x + w > 1024)
+    cols = 0xffff;
+  else
+    cols = (2u << ((x + w - 1) >> 6)) - (1u << (x >> 6));
+  if (h > 512)
+    h = 512;
+  for (i = y >> 4; i <= (y + h - 1) >> 4; i++)
+    rows |= gpu->vram_dirty[i & 31];
+  return (rows & cols) != 0;
+}
+
+// what a cmd list handed to the renderer may have drawn to:
+// the drawing area(s) for prims and the target of fills and copies
+static noinline void mark_cmd_list_dirty(struct psx_gpu *gpu,
+    const uint32_t *list, int count, uint32_t e3, uint32_t e4)
+{
+  int pos, len, cmd, v, drew = 0;
+
+  for (pos = 0; pos < count; pos += len)
+  {
+    const uint32_t *l = list + pos;
+    const int16_t *slist = (void *)l;
+
+    cmd = LE32TOH(l[0]) >> 24;
+    len = 1 + cmd_lengths[cmd];
+    switch (cmd) {
+      case 0x02:
+        mark_vram_dirty(gpu, LE16TOH(slist[2]) & 0x3f0, LE16TOH(slist[3]) & 0x1ff,
+          ((LE16TOH(slist[4]) & 0x3ff) + 0xf) & ~0xf, LE16TOH(slist[5]) & 0x1ff);
+        break;
+      case 0x48 ... 0x4f:
+        for (v = 2; pos + v + 1 < count; v++)
+          if ((l[v + 1] & LE32TOH(0xf000f000)) == LE32TOH(0x50005000))
+            break;
+        len += v - 2;
+        drew = 1;
+        break;
+      case 0x58 ... 0x5f:
+        for (v = 2; pos + v * 2 < count; v++)
+          if ((l[v * 2] & LE32TOH(0xf000f000)) == LE32TOH(0x50005000))
+            break;
+        len += (v - 2) * 2;
+        drew = 1;
+        break;
+      case 0x20 ... 0x47:
+      case 0x50 ... 0x57:
+      case 0x60 ... 0x7f:
+        drew = 1;
+        break;
+      case 0x80 ... 0x9f:
+        mark_vram_dirty(gpu, LE16TOH(slist[4]), LE16TOH(slist[5]),
+          ((LE16TOH(slist[6]) - 1) & 0x3ff) + 1,
+          ((LE16TOH(slist[7]) - 1) & 0x1ff) + 1);
+        break;
+      case 0xe3:
+      case 0xe4:
+        if (drew) {
+          mark_vram_dirty(gpu, e3 & 0x3ff, (e3 >> 10) & 0x1ff,
+            (e4 & 0x3ff) - (e3 & 0x3ff) + 1,
+            ((e4 >> 10) & 0x1ff) - ((e3 >> 10) & 0x1ff) + 1);
+          drew = 0;
+        }
+        if (cmd == 0xe3)
+          e3 = LE32TOH(l[0]);
+        else
+          e4 = LE32TOH(l[0]);
+        break;
+    }
+  }
+  if (drew)
+    mark_vram_dirty(gpu, e3 & 0x3ff, (e3 >> 10) & 0x1ff,
+      (e4 & 0x3ff) - (e3 & 0x3ff) + 1,
+      ((e4 >> 10) & 0x1ff) - ((e3 >> 10) & 0x1ff) + 1);
+}
+
 static int do_vram_io(struct psx_gpu *gpu, uint32_t *data, int count, int is_read)
 {
   int count_initial = count;
@@ -455,16 +711,20 @@ static int do_vram_io(struct psx_gpu *gpu, uint32_t *data, int count, int is_rea
   int o = gpu->dma.offset;
   int l, async_queued = 0;
 
-  if (gpu_async_enabled(gpu) && !is_read && o == 0 &&
-      count <= AGPU_DMA_MAX && w * h == count * 2)
+  if (gpu_async_enabled(gpu) && !is_read && o == 0 && w * h == count * 2)
     async_queued = gpu_async_try_dma(gpu, data, count);
   if (async_queued) {
     gpu->dma.h = 0;
     finish_vram_transfer(gpu, 0, 1);
     return count;
   }
-  if (o == 0)
-    sync_renderer(gpu);
+  if (o == 0) {
+    // reads only need what was queued for the area to be done
+    if (is_read && gpu_async_enabled(gpu))
+      gpu_async_sync_area(gpu, x, y, w, h);
+    else
+      sync_renderer(gpu);
+  }
 
   count *= 2; // operate in 16bpp pixels
   if (gpu->dma.offset) {
@@ -485,6 +745,22 @@ static int do_vram_io(struct psx_gpu *gpu, uint32_t *data, int count, int is_rea
     count -= l;
   }
 
+  if (x == 0 && w == 1024) {
+    // full width rows are contiguous in vram, do them in one go
+    y &= 511;
+    l = count / w;
+    if (l > h)
+      l = h;
+    if (l > 512 - y)
+      l = 512 - y;
+    if (l > 0) {
+      do_vram_line(vram, 0, y, sdata, w * l, is_read, r6);
+      sdata += w * l;
+      count -= w * l;
+      y += l;
+      h -= l;
+    }
+  }
   for (; h > 0 && count >= w; sdata += w, count -= w, y++, h--) {
     y &= 511;
     do_vram_line(vram, x, y, sdata, w, is_read, r6);
@@ -530,6 +806,7 @@ static noinline void start_vram_transfer(struct psx_gpu *gpu, uint32_t pos_word,
     // XXX: wrong for width 1
     gpu->gp0 = LE16TOH(mem[0]) | ((uint32_t)LE16TOH(mem[1]) << 16);
     gpu->state.last_vram_read_frame = *gpu->state.frame_count;
+    check_fb_read(gpu, gpu->dma.x, gpu->dma.y, gpu->dma.w, gpu->dma.h);
   }
 
   if (gpu->dma.x + gpu->dma.w > 1024)
@@ -547,20 +824,11 @@ static void finish_vram_transfer(struct psx_gpu *gpu, int is_read, int is_async)
   if (is_read)
     gpu->status &= ~PSX_GPU_STATUS_IMG;
   else {
-    int32_t screen_r = gpu->screen.src_x + gpu->screen.hres;
-    int32_t screen_b = gpu->screen.src_y + gpu->screen.vres;
-    int32_t dma_r = gpu->dma_start.x + gpu->dma_start.w;
-    int32_t dma_b = gpu->dma_start.y + gpu->dma_start.h;
-    int32_t not_dirty;
-    not_dirty  = screen_r - gpu->dma_start.x - 1;
-    not_dirty |= screen_b - gpu->dma_start.y - 1;
-    not_dirty |= dma_r - gpu->screen.src_x - 1;
-    not_dirty |= dma_b - gpu->screen.src_y - 1;
-    not_dirty >>= 31;
-    log_io(gpu, "dma %3d,%3d %dx%d scr %3d,%3d %3dx%3d -> dirty %d\n",
+    log_io(gpu, "dma %3d,%3d %dx%d scr %3d,%3d %3dx%3d\n",
       gpu->dma_start.x, gpu->dma_start.y, gpu->dma_start.w, gpu->dma_start.h,
-      gpu->screen.src_x, gpu->screen.src_y, gpu->screen.hres, gpu->screen.vres, !not_dirty);
-    gpu->state.fb_dirty |= !not_dirty;
+      gpu->screen.src_x, gpu->screen.src_y, gpu->screen.hres, gpu->screen.vres);
+    mark_vram_dirty(gpu, gpu->dma_start.x, gpu->dma_start.y,
+      gpu->dma_start.w, gpu->dma_start.h);
     if (!is_async)
       renderer_update_caches(gpu->dma_start.x, gpu->dma_start.y,
                              gpu->dma_start.w, gpu->dma_start.h, 0);
@@ -588,7 +856,7 @@ int do_vram_copy(uint16_t *vram, const uint32_t *ex_regs,
 
   renderer_flush_queues();
 
-  if (unlikely((sx < dx && dx < sx + w) || sx + w > 1024 || dx + w > 1024 || msb))
+  if (unlikely((sx < dx && dx < sx + w) || sx + w > 1024 || dx + w > 1024))
   {
     for (y = 0; y < h; y++)
     {
@@ -606,6 +874,15 @@ int do_vram_copy(uint16_t *vram, const uint32_t *ex_regs,
       }
     }
   }
+  else if (msb)
+  {
+    // no wrap and no forward overlap, so a plain forward copy + msb will do
+    uint32_t sy1 = sy, dy1 = dy;
+    for (y = 0; y < h; y++, sy1++, dy1++) {
+      cpy_mask(VRAM_MEM_XY(vram, dx, dy1 & 0x1ff),
+               VRAM_MEM_XY(vram, sx, sy1 & 0x1ff), w, 1);
+    }
+  }
   else
   {
     uint32_t sy1 = sy, dy1 = dy;
@@ -623,6 +900,7 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
     int *cpu_cycles_sum_out, int *cpu_cycles_last, int *last_cmd)
 {
   uint32_t cyc_sum = 0, cyc = *cpu_cycles_last;
+  uint32_t ex_changed = 0, tp;
   int cmd = 0, pos, len;
   int skip = 1;
 
@@ -642,6 +920,7 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
       break; // incomplete cmd
     }
 
+    gput_sum_cmd(cyc_sum, cyc, cmd);
     switch (cmd) {
       case 0x02:
         w = ((LE16TOH(slist[4]) & 0x3ff) + 0xf) & ~0xf;
@@ -656,29 +935,24 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
         }
         else
           memcpy(gpu->frameskip.pending_fill, list, 3 * 4);
-        gput_sum(cyc_sum, cyc, gput_fill(w, h));
+        cyc += gput_fill_area(w, h);
         break;
       case 0x1f: // irq?
         goto breakloop;
-      case 0x20 ... 0x23: gput_sum(cyc_sum, cyc, gput_poly_base());    break;
-      case 0x24 ... 0x27: gput_sum(cyc_sum, cyc, gput_poly_base_t());  goto do_texpage;
-      case 0x28 ... 0x2b: gput_sum(cyc_sum, cyc, gput_quad_base());    break;
-      case 0x2c ... 0x2f: gput_sum(cyc_sum, cyc, gput_quad_base_t());  goto do_texpage;
-      case 0x30 ... 0x33: gput_sum(cyc_sum, cyc, gput_poly_base_g());  break;
-      case 0x34 ... 0x37: gput_sum(cyc_sum, cyc, gput_poly_base_gt()); goto do_texpage;
-      case 0x38 ... 0x3b: gput_sum(cyc_sum, cyc, gput_quad_base_g());  break;
-      case 0x3c ... 0x3f: gput_sum(cyc_sum, cyc, gput_quad_base_gt());
-      do_texpage:
-        gpu->ex_regs[1] &= ~0x1ff;
-        gpu->ex_regs[1] |= (LE32TOH(list[4 + ((cmd >> 4) & 1)]) >> 16) & 0x1ff;
-        break;
-      case 0x40 ... 0x47:
-        gput_sum(cyc_sum, cyc, gput_line(0));
+      case 0x24 ... 0x27:
+      case 0x2c ... 0x2f:
+      case 0x34 ... 0x37:
+      case 0x3c ... 0x3f:
+        tp = gpu->ex_regs[1] & ~0x1ff;
+        tp |= (LE32TOH(list[4 + ((cmd >> 4) & 1)]) >> 16) & 0x1ff;
+        ex_changed |= tp ^ gpu->ex_regs[1];
+        gpu->ex_regs[1] = tp;
         break;
       case 0x48 ... 0x4F:
         for (num_vertexes = 2; ; num_vertexes++)
         {
-          gput_sum(cyc_sum, cyc, gput_line(0));
+          if (num_vertexes > 2)
+            gput_sum(cyc_sum, cyc, gput_line(0));
           if (pos + num_vertexes + 1 >= list_len) {
             cmd = -1;
             goto breakloop;
@@ -688,13 +962,11 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
         }
         len += (num_vertexes - 2);
         break;
-      case 0x50 ... 0x57:
-        gput_sum(cyc_sum, cyc, gput_line(0));
-        break;
       case 0x58 ... 0x5f:
         for (num_vertexes = 2; ; num_vertexes++)
         {
-          gput_sum(cyc_sum, cyc, gput_line(0));
+          if (num_vertexes > 2)
+            gput_sum(cyc_sum, cyc, gput_line(0));
           if (pos + num_vertexes*2 >= list_len) {
             cmd = -1;
             goto breakloop;
@@ -707,18 +979,13 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
       case 0x60 ... 0x63:
         w = LE16TOH(slist[4]) & 0x3FF;
         h = LE16TOH(slist[5]) & 0x1FF;
-        gput_sum(cyc_sum, cyc, gput_sprite(w, h));
+        cyc += gput_sprite_area(w, h);
         break;
       case 0x64 ... 0x67:
         w = LE16TOH(slist[6]) & 0x3FF;
         h = LE16TOH(slist[7]) & 0x1FF;
-        gput_sum(cyc_sum, cyc, gput_sprite(w, h));
+        cyc += gput_sprite_area(w, h);
         break;
-      case 0x68 ... 0x6b: gput_sum(cyc_sum, cyc, gput_sprite(1, 1));   break;
-      case 0x70 ... 0x73:
-      case 0x74 ... 0x77: gput_sum(cyc_sum, cyc, gput_sprite(8, 8));   break;
-      case 0x78 ... 0x7b:
-      case 0x7C ... 0x7f: gput_sum(cyc_sum, cyc, gput_sprite(16, 16)); break;
       case 0x80 ... 0x9f: // vid -> vid
         w = ((LE16TOH(slist[6]) - 1) & 0x3ff) + 1;
         h = ((LE16TOH(slist[7]) - 1) & 0x1ff) + 1;
@@ -732,6 +999,7 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
         // fallthrough
       case 0xe0 ... 0xe2:
       case 0xe4 ... 0xe7:
+        ex_changed |= gpu->ex_regs[cmd & 7] ^ LE32TOH(list[0]);
         gpu->ex_regs[cmd & 7] = LE32TOH(list[0]);
         break;
       default:
@@ -740,10 +1008,14 @@ static noinline int do_cmd_list_skip(struct psx_gpu *gpu, uint32_t *data, int li
   }
 
 breakloop:
-  if (gpu_async_enabled(gpu))
-    gpu_async_sync_ecmds(gpu);
-  else
-    renderer_sync_ecmds(gpu->ex_regs);
+  // the renderer only needs to hear about the state, and only if it moved;
+  // skipped frames come here a lot, often with nothing changed
+  if (ex_changed) {
+    if (gpu_async_enabled(gpu))
+      gpu_async_sync_ecmds(gpu);
+    else
+      renderer_sync_ecmds(gpu->ex_regs);
+  }
   *cpu_cycles_sum_out += cyc_sum;
   *cpu_cycles_last = cyc;
   *last_cmd = cmd;
@@ -753,15 +1025,17 @@ breakloop:
 static noinline int do_cmd_buffer(struct psx_gpu *gpu, uint32_t *data, int count,
     int *cycles_sum, int *cycles_last)
 {
-  int cmd, pos;
+  int cmd, pos, len;
   uint32_t old_e3 = gpu->ex_regs[3];
-  int vram_dirty = 0;
+  uint32_t e3, e4;
+
+  evtrace_begin(EVT_GPU_CMD, count);
 
   // process buffer
   for (pos = 0; pos < count; )
   {
     if (gpu->dma.h && !gpu->dma_start.is_read) { // XXX: need to verify
-      // vram_dirty = 1; // handled in finish_vram_transfer()
+      // dirty vram is marked in finish_vram_transfer()
       pos += do_vram_io(gpu, data + pos, count - pos, 0);
       if (pos == count)
         break;
@@ -795,12 +1069,17 @@ static noinline int do_cmd_buffer(struct psx_gpu *gpu, uint32_t *data, int count
         cmd = -1; // incomplete cmd, can't consume yet
         break;
       }
+      if (gpu->state.allow_interlace == 3)
+        check_fb_read(gpu, LE32TOH(data[pos + 1]) & 0x3ff,
+          (LE32TOH(data[pos + 1]) >> 16) & 0x1ff,
+          ((LE32TOH(data[pos + 3]) - 1) & 0x3ff) + 1,
+          (((LE32TOH(data[pos + 3]) >> 16) - 1) & 0x1ff) + 1);
       if (gpu_async_enabled(gpu))
         break;
       *cycles_sum += *cycles_last;
       *cycles_last = 0;
       do_vram_copy(gpu->vram, gpu->ex_regs, data + pos, cycles_last);
-      vram_dirty = 1;
+      mark_cmd_list_dirty(gpu, data + pos, 4, 0, 0); // just the copy
       pos += 4;
       continue;
     case 0x00:
@@ -818,15 +1097,17 @@ static noinline int do_cmd_buffer(struct psx_gpu *gpu, uint32_t *data, int count
       pos += do_cmd_list_skip(gpu, data + pos, count - pos,
                cycles_sum, cycles_last, &cmd);
     }
-    else if (gpu_async_enabled(gpu)) {
-      pos += gpu_async_do_cmd_list(gpu, data + pos, count - pos,
-               cycles_sum, cycles_last, &cmd);
-      vram_dirty = 1;
-    }
     else {
-      pos += renderer_do_cmd_list(data + pos, count - pos, gpu->ex_regs,
-               cycles_sum, cycles_last, &cmd);
-      vram_dirty = 1;
+      e3 = gpu->ex_regs[3];
+      e4 = gpu->ex_regs[4];
+      if (gpu_async_enabled(gpu))
+        len = gpu_async_do_cmd_list(gpu, data + pos, count - pos,
+                cycles_sum, cycles_last, &cmd);
+      else
+        len = renderer_do_cmd_list(data + pos, count - pos, gpu->ex_regs,
+                cycles_sum, cycles_last, &cmd);
+      mark_cmd_list_dirty(gpu, data + pos, len, e3, e4);
+      pos += len;
     }
 
     if (cmd == -1)
@@ -838,11 +1119,15 @@ static noinline int do_cmd_buffer(struct psx_gpu *gpu, uint32_t *data, int count
   gpu->status |= gpu->ex_regs[1] & 0x7ff;
   gpu->status |= (gpu->ex_regs[6] & 3) << 11;
 
-  gpu->state.fb_dirty |= vram_dirty;
-
   if (old_e3 != gpu->ex_regs[3])
     decide_frameskip_allow(gpu);
 
+  if (unlikely(gpu->record.list != NULL) && pos > 0) {
+    fwrite(data, 4, pos, gpu->record.list);
+    gpu->record.words += pos;
+  }
+
+  evtrace_end(EVT_GPU_CMD);
   return count - pos;
 }
 
@@ -862,6 +1147,7 @@ static noinline void flush_cmd_buffer(struct psx_gpu *gpu)
 
 void GPUwriteDataMem(uint32_t *mem, int count)
 {
+  uint32_t t0 = gpu_perf_ticks(&gpu);
   int dummy = 0, left;
 
   log_io(&gpu, "gpu_dma_write %p %d cached %d\n", mem, count, gpu.cmd_len);
@@ -872,6 +1158,7 @@ void GPUwriteDataMem(uint32_t *mem, int count)
   left = do_cmd_buffer(&gpu, mem, count, &dummy, &dummy);
   if (left)
     log_anomaly(&gpu, "GPUwriteDataMem: discarded %d/%d words\n", left, count);
+  gpu_perf_add(&gpu, us, t0);
 }
 
 void GPUwriteData(uint32_t data)
@@ -882,19 +1169,49 @@ void GPUwriteData(uint32_t data)
     flush_cmd_buffer(&gpu);
 }
 
+// Packets of consecutive list nodes are gathered here and handled by one
+// do_cmd_buffer() call, saving the per-call ecmd sync and the small
+// gpu_async queue additions on OT heavy games. Only when the walk doesn't
+// have to stop part way (no progress emulation) and frameskip isn't
+// active, as that decides on e3 changes between calls.
+// With gpu_async the packets go straight from psx ram to its queue as
+// they are, so that the words are only copied once, and chain_buf just
+// collects a cmd that's split between packets.
+static uint32_t chain_buf[CMD_BUFFER_LEN * 4];
+
+static int chain_flush(int len, int *cycles_sum, int *cycles_last)
+{
+  int left = do_cmd_buffer(&gpu, chain_buf, len, cycles_sum, cycles_last);
+  if (left > 0)
+    memmove(chain_buf, chain_buf + len - left, left * 4);
+  return left;
+}
+
 long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
   uint32_t *progress_addr, int32_t *cycles_last_cmd)
 {
+  uint32_t t0 = gpu_perf_ticks(&gpu);
   uint32_t addr, *list, ld_addr;
   int len, left, count, ld_count = 32;
   int cpu_cycles_sum = 0;
   int cpu_cycles_last = 0;
+  int batch, direct, blen = 0;
 
   preload(rambase + (start_addr & 0x1fffff) / 4);
 
   if (unlikely(gpu.cmd_len > 0))
     flush_cmd_buffer(&gpu);
 
+  batch = progress_addr == NULL && !gpu.frameskip.active;
+  direct = batch && gpu_async_enabled(&gpu);
+  if (direct)
+    gpu_async_batch(&gpu, 1);
+  if (batch && gpu.cmd_len > 0) {
+    memcpy(chain_buf, gpu.cmd_buffer, gpu.cmd_len * 4);
+    blen = gpu.cmd_len;
+    gpu.cmd_len = 0;
+  }
+
   log_io(&gpu, "gpu_dma_chain\n");
   addr = ld_addr = start_addr & 0xffffff;
   for (count = 0; (addr & 0x800000) == 0; count++)
@@ -910,7 +1227,28 @@ long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
 
     log_io(&gpu, ".chain %08lx #%d+%d %u+%u\n",
       (long)(list - rambase) * 4, len, gpu.cmd_len, cpu_cycles_sum, cpu_cycles_last);
-    if (unlikely(gpu.cmd_len > 0)) {
+    if (direct && blen == 0) {
+      if (len) {
+        left = do_cmd_buffer(&gpu, list + 1, len, &cpu_cycles_sum, &cpu_cycles_last);
+        if (left) {
+          memcpy(chain_buf, list + 1 + len - left, left * 4);
+          blen = left;
+        }
+      }
+    }
+    else if (batch) {
+      if (blen + len > ARRAY_SIZE(chain_buf))
+        blen = chain_flush(blen, &cpu_cycles_sum, &cpu_cycles_last);
+      if (blen + len > ARRAY_SIZE(chain_buf)) {
+        log_anomaly(&gpu, "chain_buf overflow, likely garbage commands\n");
+        blen = 0;
+      }
+      memcpy(chain_buf + blen, list + 1, len * 4);
+      blen += len;
+      if (direct)
+        blen = chain_flush(blen, &cpu_cycles_sum, &cpu_cycles_last);
+    }
+    else if (unlikely(gpu.cmd_len > 0)) {
       if (gpu.cmd_len + len > ARRAY_SIZE(gpu.cmd_buffer)) {
         log_anomaly(&gpu, "cmd_buffer overflow, likely garbage commands\n");
         gpu.cmd_len = 0;
@@ -920,8 +1258,7 @@ long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
       flush_cmd_buffer(&gpu);
       continue;
     }
-
-    if (len) {
+    else if (len) {
       left = do_cmd_buffer(&gpu, list + 1, len, &cpu_cycles_sum, &cpu_cycles_last);
       if (left) {
         memcpy(gpu.cmd_buffer, list + 1 + len - left, left * 4);
@@ -947,6 +1284,19 @@ long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
     }
   }
 
+  if (blen > 0) {
+    left = chain_flush(blen, &cpu_cycles_sum, &cpu_cycles_last);
+    if (left) {
+      if (left > ARRAY_SIZE(gpu.cmd_buffer))
+        left = ARRAY_SIZE(gpu.cmd_buffer);
+      memcpy(gpu.cmd_buffer, chain_buf + blen - left, left * 4);
+      gpu.cmd_len = left;
+      log_anomaly(&gpu, "GPUdmaChain: %d/%d words left\n", left, blen);
+    }
+  }
+  if (direct)
+    gpu_async_batch(&gpu, 0);
+
   //printf(" -> %d %d\n", cpu_cycles_sum, cpu_cycles_last);
   gpu.state.last_list.frame = *gpu.state.frame_count;
   gpu.state.last_list.hcnt = *gpu.state.hcnt;
@@ -956,6 +1306,7 @@ long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
   if (progress_addr)
     *progress_addr = addr;
   *cycles_last_cmd = cpu_cycles_last;
+  gpu_perf_add(&gpu, us, t0);
   return cpu_cycles_sum;
 }
 
@@ -1033,12 +1384,31 @@ long GPUfreeze(uint32_t type, GPUFreeze_t *freeze)
   return 1;
 }
 
+// was anything in the displayed part of vram written since the last flip?
+static int is_screen_dirty(const struct psx_gpu *gpu)
+{
+  int w = gpu->screen.w;
+  int h = gpu->screen.h + 1; // vout_update() may skip an odd line
+  if (gpu->screen.x < 0)
+    w -= gpu->screen.x;
+  if (gpu->screen.y < 0)
+    h -= gpu->screen.y;
+  if (gpu->status & PSX_GPU_STATUS_RGB24)
+    w = w * 3 / 2 + 1;
+  return is_vram_dirty(gpu, gpu->screen.src_x, gpu->screen.src_y, w, h);
+}
+
 void GPUupdateLace(void)
 {
+  uint16_t *vram = NULL;
   int updated = 0;
+  int dirty = 1;
 
   if (gpu.cmd_len > 0)
     flush_cmd_buffer(&gpu);
+  if (unlikely(gpu.record.list != NULL
+               || (gpu.record.request && *gpu.record.request)))
+    record_frame(&gpu);
 
 #ifndef RAW_FB_DISPLAY
   if (gpu.status & PSX_GPU_STATUS_BLANKING) {
@@ -1050,10 +1420,16 @@ void GPUupdateLace(void)
     return;
   }
 
-  if (!gpu.state.fb_dirty)
+  dirty = gpu.state.fb_dirty || is_screen_dirty(&gpu);
+  // a queued frame copy still has to be shown even if nothing has changed
+  if (!dirty && !gpu_async_frame_pending(&gpu))
     return;
 #endif
 
+  // nobody will see this frame, leave it dirty for the next one
+  if (gpu.frameskip.vout_skip && *gpu.frameskip.vout_skip)
+    return;
+
   if (gpu.frameskip.set) {
     if (!gpu.frameskip.frame_ready) {
       if (*gpu.state.frame_count - gpu.frameskip.last_flip_frame < 9)
@@ -1063,12 +1439,21 @@ void GPUupdateLace(void)
     gpu.frameskip.frame_ready = 0;
   }
 
-  if (gpu_async_enabled(&gpu))
-    gpu_async_sync_scanout(&gpu);
-  else
+  if (!gpu_async_enabled(&gpu)) {
+#ifndef RENDERER_ORDERED_DISPLAY // else it queues vout_update() after them
     renderer_flush_queues();
+#endif
+  }
+  else if (gpu.state.async_frames && !gpu.state.enhancement_active)
+    vram = gpu_async_scanout_frame(&gpu, dirty);
+  else
+    gpu_async_sync_scanout(&gpu);
 
+  evtrace_begin(EVT_VOUT, 0);
+  gpu.state.scanout_vram = vram;
   updated = vout_update();
+  gpu.state.scanout_vram = NULL;
+  evtrace_end(EVT_VOUT);
   if (gpu.state.enhancement_active && !gpu.state.enhancement_was_active) {
     gpu_async_sync(&gpu);
     renderer_update_caches(0, 0, 1024, 512, 1);
@@ -1077,6 +1462,7 @@ void GPUupdateLace(void)
   if (updated) {
     gpu.state.fb_dirty = 0;
     gpu.state.blanked = 0;
+    memset(gpu.vram_dirty, 0, sizeof(gpu.vram_dirty));
   }
 }
 
@@ -1092,6 +1478,13 @@ void GPUvBlank(int is_vblank, int lcf)
   {
     interlace = 0;
   }
+  // "fields" mode draws just the field that's shown next for speed, all of
+  // it while the game reads the display back (screen transitions and such)
+  if (gpu.state.allow_interlace == 3
+      && *gpu.state.frame_count - gpu.state.last_fb_read_frame <= 2)
+  {
+    interlace = 0;
+  }
   if (interlace || interlace != gpu.state.old_interlace) {
     gpu.state.old_interlace = interlace;
 
@@ -1100,7 +1493,9 @@ void GPUvBlank(int is_vblank, int lcf)
     if (gpu_async_enabled(&gpu))
       gpu_async_set_interlace(&gpu, interlace, !lcf);
     else {
+#ifndef RENDERER_ORDERED_DISPLAY
       renderer_flush_queues();
+#endif
       renderer_set_interlace(interlace, !lcf);
     }
   }
@@ -1120,6 +1515,13 @@ void GPUrearmedCallbacks(const struct rearmed_cbs *cbs)
   gpu.frameskip.advice = &cbs->fskip_advice;
   gpu.frameskip.force = &cbs->fskip_force;
   gpu.frameskip.dirty = (void *)&cbs->fskip_dirty;
+  gpu.frameskip.vout_skip = &cbs->vout_skip;
+  gpu.frameskip.async_waits = (void *)&cbs->gpu_async_waits;
+  gpu.perf.on = &cbs->perf_on;
+  gpu.perf.us = (void *)&cbs->gpu_us;
+  gpu.perf.async_us = (void *)&cbs->gpu_async_us;
+  gpu.record.request = (void *)&cbs->gpu_record_frames;
+  gpu.record.path = &cbs->gpu_record_path;
   gpu.frameskip.active = 0;
   gpu.frameskip.frame_ready = 1;
   gpu.state.hcnt = (uint32_t *)cbs->gpu_hcnt;
@@ -1127,6 +1529,7 @@ void GPUrearmedCallbacks(const struct rearmed_cbs *cbs)
   gpu.state.allow_interlace = cbs->gpu_neon.allow_interlace;
   gpu.state.enhancement_enable = cbs->gpu_neon.enhancement_enable;
   gpu.state.downscale_enable = cbs->scale_hires;
+  gpu.state.async_frames = cbs->thread_frames;
   gpu.state.screen_centering_type_default = cbs->screen_centering_type_default;
   if (gpu.state.screen_centering_type != cbs->screen_centering_type
       || gpu.state.screen_centering_x != cbs->screen_centering_x
@@ -13,6 +13,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include "../../include/compiler_features.h"
 
 //#define RAW_FB_DISPLAY
@@ -90,6 +91,7 @@ struct psx_gpu {
     uint32_t downscale_enable:1;
     uint32_t dims_changed:1;
     uint32_t show_overscan:2;
+    uint32_t async_frames:1; // scan out gpu_async frame copies
     uint32_t *frame_count;
     uint32_t *hcnt; /* hsync count */
     struct {
@@ -99,7 +101,9 @@ struct psx_gpu {
       uint32_t hcnt;
     } last_list;
     uint32_t last_vram_read_frame;
+    uint32_t last_fb_read_frame; // read or copy out of the display area
     uint32_t w_out_old, h_out_old, status_vo_old;
+    uint16_t *scanout_vram; // for vout_update() if not gpu.vram
     short screen_centering_type;
     short screen_centering_type_default;
     short screen_centering_x;
@@ -115,10 +119,25 @@ struct psx_gpu {
     const int *advice;
     const int *force;
     int *dirty;
+    const int *vout_skip;
+    uint32_t *async_waits;
     uint32_t last_flip_frame;
     uint32_t pending_fill[3];
   } frameskip;
+  struct {
+    const int *on;      // frontend's perf graph is shown
+    uint32_t *us;       // usecs in the emu thread
+    uint32_t *async_us; // usecs in the gpu thread
+  } perf;
+  struct {
+    void *list, *gp1;          // FILE *, open while recording
+    uint32_t words;            // written to list so far
+    uint32_t frame;
+    int *request;              // frames to record, frontend clears to stop
+    const char * const *path;  // file name prefix
+  } record;
   uint32_t cmd_buffer[CMD_BUFFER_LEN];
+  uint16_t vram_dirty[32]; // 64x16 pixel tiles written since the last flip
   struct psx_gpu_async *async;
   void *(*get_enhancement_bufer)
     (int *x, int *y, int *w, int *h, int *vram_h);
@@ -200,6 +219,23 @@ void GPUrearmedCallbacks(const struct rearmed_cbs *cbs_);
 
 void SysPrintf(const char *fmt, ...);
 
+static inline uint32_t gpu_perf_ticks(const struct psx_gpu *gpu)
+{
+#ifndef _WIN32
+  struct timespec ts;
+
+  if (likely(!gpu->perf.on || !*gpu->perf.on))
+    return 0;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return 0;
+#endif
+}
+
+#define gpu_perf_add(gpu, field, t0) \
+  if (unlikely(t0)) *(gpu)->perf.field += gpu_perf_ticks(gpu) - (t0)
+
 #ifdef __cplusplus
 }
 #endif
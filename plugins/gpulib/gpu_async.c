@@ -16,6 +16,8 @@
 #include "gpu_timing.h"
 #include "../../include/arm_features.h"
 #include "../../include/compiler_features.h"
+#include "../../include/evtrace.h"
+#include "../../include/thread_wakeups.h"
 #include "../../frontend/pcsxr-threads.h"
 
 //#define agpu_log gpu_log
@@ -24,8 +26,6 @@
 // these constants must be power of 2
 #define AGPU_BUF_LEN    (128*1024/4u)
 #define AGPU_BUF_MASK   (AGPU_BUF_LEN - 1)
-#define AGPU_AREAS_CNT  8u
-#define AGPU_AREAS_MASK (AGPU_AREAS_CNT - 1)
 
 #ifndef min
 #define min(a, b) ((b) < (a) ? (b) : (a))
@@ -37,6 +37,9 @@
 #define FAKECMD_SET_INTERLACE 0xdeu
 #define FAKECMD_DMA_WRITE     0xddu
 #define FAKECMD_BREAK         0xdcu
+#define FAKECMD_COPY_FRAME    0xdbu
+
+#define AGPU_FRAMES 2
 
 #if defined(__aarch64__) || defined(HAVE_ARMV7)
 #define BARRIER() __asm__ __volatile__ ("dmb ishst" ::: "memory")
@@ -45,6 +48,8 @@
 #else
 #define BARRIER() __asm__ __volatile__ ("" ::: "memory")
 #endif
+// store->load ordering for the idle/wait_mode handshakes below
+#define FULL_BARRIER() __sync_synchronize()
 #define RDPOS(pos_) *(volatile uint32_t *)&(pos_)
 #define WRPOS(pos_, d_) *(volatile uint32_t *)&(pos_) = (d_)
 
@@ -55,10 +60,13 @@ enum waitmode {
   waitmode_full,
 };
 
-struct pos_drawarea {
-  uint32_t pos;
-  uint16_t x0, y0;
-  uint16_t x1, y1;
+// a copy of the display area for pipelined scanout
+struct agpu_frame
+{
+  uint16_t *vram; // 1024x512, only the copied area is valid
+  struct psx_gpu_screen screen;
+  uint32_t status;
+  uint32_t pos; // pos_added after the copy cmd
 };
 
 struct psx_gpu_async
@@ -66,17 +74,26 @@ struct psx_gpu_async
   uint32_t pos_added;
   uint32_t pos_used;
   uint32_t pos_target;
+  uint32_t pos_flushed; // everything before it has reached vram
   enum waitmode wait_mode;
-  uint8_t exit;
-  uint8_t idle;
+  uint32_t exit;
+  uint32_t idle;
   sthread_t *thread;
   slock_t *lock;
   scond_t *cond_use;
   scond_t *cond_add;
   uint32_t ex_regs[8]; // used by vram copy at least
   uint32_t cmd_buffer[AGPU_BUF_LEN];
-  uint32_t pos_area;
-  struct pos_drawarea draw_areas[AGPU_AREAS_CNT];
+  // main thread only: pos_added after the last queued cmd that may
+  // write to each 64x16 vram tile, see gpu_async_sync_area()
+  uint32_t tile_pos[32][16];
+  uint16_t tiles[32]; // touched by cmds not in tile_pos yet
+  int batch;          // see gpu_async_batch()
+  // main thread only except for frames[].vram contents, see
+  // gpu_async_scanout_frame()
+  struct agpu_frame frames[AGPU_FRAMES];
+  uint32_t frame_cnt;
+  int frame_pending; // the last queued frame hasn't been scanned out
 };
 
 // cmd_* must be at least 3 words long
@@ -114,12 +131,24 @@ struct cmd_break
   uint32_t u32s[3];
 };
 
+union cmd_copy_frame
+{
+  uint32_t u32s[4];
+  struct {
+    uint32_t cmd;
+    short x, y, w, h;
+    uint32_t slot;
+  };
+};
+
 static int noinline do_notify_screen_change(struct psx_gpu *gpu,
     const union cmd_screen_change *cmd);
 static int do_set_interlace(struct psx_gpu *gpu,
     const union cmd_set_interlace *cmd);
 static int do_dma_write(struct psx_gpu *gpu,
     const union cmd_dma_write *cmd, uint32_t pos);
+static int do_copy_frame(struct psx_gpu *gpu,
+    const union cmd_copy_frame *cmd);
 
 static void run_thread_nolock(struct psx_gpu_async *agpu)
 {
@@ -129,8 +158,17 @@ static void run_thread_nolock(struct psx_gpu_async *agpu)
   }
 }
 
+// The ring itself is lock-free: the main thread only moves pos_added and
+// the gpu thread only moves pos_used. The lock is only taken to sleep or
+// to wake the other side, which only happens when the ring changes from
+// empty to non-empty or an explicit wait is pending.
 static void run_thread(struct psx_gpu_async *agpu)
 {
+  // pairs with the barrier in wait_for_work(): either we see idle set
+  // or the thread sees the new pos_added and doesn't sleep
+  FULL_BARRIER();
+  if (!RDPOS(agpu->idle))
+    return;
   slock_lock(agpu->lock);
   run_thread_nolock(agpu);
   slock_unlock(agpu->lock);
@@ -182,44 +220,93 @@ static int do_add(struct psx_gpu_async *agpu, const void *list, int list_words)
   return ret;
 }
 
+// called with the lock held and wait_mode set, counting lets the
+// frontend's frameskip logic see that the gpu thread is behind
+static void wait_for_thread(struct psx_gpu_async *agpu)
+{
+  if (gpu.frameskip.async_waits)
+    (*gpu.frameskip.async_waits)++;
+  evtrace_begin(EVT_GPU_WAIT, agpu->wait_mode);
+  scond_wait(agpu->cond_add, agpu->lock);
+  evtrace_end(EVT_GPU_WAIT);
+}
+
+static void wait_for_space(struct psx_gpu_async *agpu, int words)
+{
+  slock_lock(agpu->lock);
+  run_thread_nolock(agpu);
+  while (words > AGPU_BUF_LEN - (agpu->pos_added - RDPOS(agpu->pos_used))) {
+    assert(!agpu->idle);
+    assert(agpu->wait_mode == waitmode_none);
+    agpu->wait_mode = waitmode_progress;
+    wait_for_thread(agpu);
+  }
+  slock_unlock(agpu->lock);
+}
+
 static void do_add_with_wait(struct psx_gpu_async *agpu,
     const void *list, int list_words)
 {
-  for (;;)
-  {
-    if (do_add(agpu, list, list_words))
-      break;
-    slock_lock(agpu->lock);
-    run_thread_nolock(agpu);
-    while (list_words > AGPU_BUF_LEN - (agpu->pos_added - RDPOS(agpu->pos_used))) {
-      assert(!agpu->idle);
-      assert(agpu->wait_mode == waitmode_none);
-      agpu->wait_mode = waitmode_progress;
-      scond_wait(agpu->cond_add, agpu->lock);
+  while (!do_add(agpu, list, list_words))
+    wait_for_space(agpu, list_words);
+}
+
+// tile bitmap (a row of 16 columns per 16 lines) of an area,
+// x in 0..1023, y in 0..511, the end may wrap
+static void area_tiles(uint16_t *rows, int x, int y, int w, int h)
+{
+  uint32_t cols;
+  int i;
+
+  if (w <= 0 || h <= 0)
+    return;
+  if (x + w > 1024)
+    cols = 0xffff;
+  else
+    cols = (2u << ((x + w - 1) >> 6)) - (1u << (x >> 6));
+  if (h > 512)
+    h = 512;
+  for (i = y >> 4; i <= (y + h - 1) >> 4; i++)
+    rows[i & 31] |= cols;
+}
+
+static void area_tiles_e(uint16_t *rows, const uint32_t *ex_regs)
+{
+  int x0 = ex_regs[3] & 0x3ff, y0 = (ex_regs[3] >> 10) & 0x1ff;
+  int x1 = ex_regs[4] & 0x3ff, y1 = (ex_regs[4] >> 10) & 0x1ff;
+  area_tiles(rows, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+static void set_tiles(struct psx_gpu_async *agpu, const uint16_t *rows,
+    uint32_t pos)
+{
+  uint32_t cols;
+  int i, c;
+
+  for (i = 0; i < 32; i++)
+    for (cols = rows[i]; cols; cols &= cols - 1) {
+      c = __builtin_ctz(cols);
+      agpu->tile_pos[i][c] = pos;
     }
-    slock_unlock(agpu->lock);
-  }
 }
 
-static void add_draw_area(struct psx_gpu_async *agpu, uint32_t pos, int force,
-    uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+static void commit_tiles(struct psx_gpu_async *agpu)
 {
-  uint32_t pos_area = agpu->pos_area;
-  if (pos - agpu->draw_areas[pos_area].pos > 1u || force)
-    pos_area = agpu->pos_area = (pos_area + 1) & AGPU_AREAS_MASK;
-  agpu->draw_areas[pos_area].pos = pos;
-  agpu->draw_areas[pos_area].x0 = x0;
-  agpu->draw_areas[pos_area].y0 = y0;
-  agpu->draw_areas[pos_area].x1 = x1;
-  agpu->draw_areas[pos_area].y1 = y1;
+  set_tiles(agpu, agpu->tiles, agpu->pos_added);
+  memset(agpu->tiles, 0, sizeof(agpu->tiles));
 }
 
-static void add_draw_area_e(struct psx_gpu_async *agpu, uint32_t pos, int force,
-    const uint32_t *ex_regs)
+// Consecutive gpu_async_do_cmd_list() calls (like the packets of a dma
+// chain handed over straight from psx ram) only update tile_pos when
+// the batch ends or something needs it.
+void gpu_async_batch(struct psx_gpu *gpu, int on)
 {
-  add_draw_area(agpu, pos, force,
-       ex_regs[3] & 0x3ff,       (ex_regs[3] >> 10) & 0x1ff,
-      (ex_regs[4] & 0x3ff) + 1, ((ex_regs[4] >> 10) & 0x1ff) + 1);
+  struct psx_gpu_async *agpu = gpu->async;
+  if (!agpu)
+    return;
+  agpu->batch = on;
+  if (!on)
+    commit_tiles(agpu);
 }
 
 int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int list_len,
@@ -231,13 +318,15 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
   int rendered_anything = 0;
   int insert_break = 0;
   int cmd = -1, pos, len;
+  uint16_t *tiles;
+  int drew = 0;
 
   assert(agpu);
+  tiles = agpu->tiles;
   for (pos = 0; pos < list_len; pos += len)
   {
     const uint32_t *list = list_data + pos;
     const int16_t *slist = (void *)list;
-    const struct pos_drawarea *darea;
     int rendered = 1, skip = 0;
     int num_vertexes, x, y, w, h;
 
@@ -248,43 +337,37 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
       break; // incomplete cmd
     }
 
+    gput_sum_cmd(cyc_sum, cyc, cmd);
     switch (cmd) {
       case 0x02:
         x =  (LE16TOH(slist[2]) & 0x3ff) & ~0xf;
         y =   LE16TOH(slist[3]) & 0x1ff;
         w = ((LE16TOH(slist[4]) & 0x3ff) + 0xf) & ~0xf;
         h =   LE16TOH(slist[5]) & 0x1ff;
-        darea = &agpu->draw_areas[agpu->pos_area];
-        if (x < darea->x0 || x + w > darea->x1 || y < darea->y0 || y + h > darea->y1) {
-          // let the main thread know about changes outside of drawing area
-          agpu_log(gpu, "agpu: fill %d,%d %dx%d vs area %d,%d %dx%d\n", x, y, w, h,
-            darea->x0, darea->y0, darea->x1 - darea->x0, darea->y1 - darea->y0);
-          add_draw_area(agpu, agpu->pos_added, 1, x, y, x + w, y + h);
-          add_draw_area_e(agpu, agpu->pos_added + 1, 1, gpu->ex_regs);
-        }
-        gput_sum(cyc_sum, cyc, gput_fill(w, h));
+        area_tiles(tiles, x, y, w, h);
+        cyc += gput_fill_area(w, h);
         break;
       case 0x1f: // irq?
         goto breakloop;
-      case 0x20 ... 0x23: gput_sum(cyc_sum, cyc, gput_poly_base());    break;
-      case 0x24 ... 0x27: gput_sum(cyc_sum, cyc, gput_poly_base_t());  goto do_texpage;
-      case 0x28 ... 0x2b: gput_sum(cyc_sum, cyc, gput_quad_base());    break;
-      case 0x2c ... 0x2f: gput_sum(cyc_sum, cyc, gput_quad_base_t());  goto do_texpage;
-      case 0x30 ... 0x33: gput_sum(cyc_sum, cyc, gput_poly_base_g());  break;
-      case 0x34 ... 0x37: gput_sum(cyc_sum, cyc, gput_poly_base_gt()); goto do_texpage;
-      case 0x38 ... 0x3b: gput_sum(cyc_sum, cyc, gput_quad_base_g());  break;
-      case 0x3c ... 0x3f: gput_sum(cyc_sum, cyc, gput_quad_base_gt());
-      do_texpage:
+      case 0x20 ... 0x23:
+      case 0x28 ... 0x2b:
+      case 0x30 ... 0x33:
+      case 0x38 ... 0x3b:
+        break;
+      case 0x24 ... 0x27:
+      case 0x2c ... 0x2f:
+      case 0x34 ... 0x37:
+      case 0x3c ... 0x3f:
         gpu->ex_regs[1] &= ~0x1ff;
         gpu->ex_regs[1] |= (LE32TOH(list[4 + ((cmd >> 4) & 1)]) >> 16) & 0x1ff;
         break;
       case 0x40 ... 0x47:
-        gput_sum(cyc_sum, cyc, gput_line(0));
         break;
       case 0x48 ... 0x4F:
         for (num_vertexes = 2; ; num_vertexes++)
         {
-          gput_sum(cyc_sum, cyc, gput_line(0));
+          if (num_vertexes > 2)
+            gput_sum(cyc_sum, cyc, gput_line(0));
           if (pos + num_vertexes + 1 >= list_len) {
             cmd = -1;
             goto breakloop;
@@ -295,12 +378,12 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
         len += (num_vertexes - 2);
         break;
       case 0x50 ... 0x57:
-        gput_sum(cyc_sum, cyc, gput_line(0));
         break;
       case 0x58 ... 0x5f:
         for (num_vertexes = 2; ; num_vertexes++)
         {
-          gput_sum(cyc_sum, cyc, gput_line(0));
+          if (num_vertexes > 2)
+            gput_sum(cyc_sum, cyc, gput_line(0));
           if (pos + num_vertexes*2 >= list_len) {
             cmd = -1;
             goto breakloop;
@@ -313,30 +396,22 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
       case 0x60 ... 0x63:
         w = LE16TOH(slist[4]) & 0x3FF;
         h = LE16TOH(slist[5]) & 0x1FF;
-        gput_sum(cyc_sum, cyc, gput_sprite(w, h));
+        cyc += gput_sprite_area(w, h);
         break;
       case 0x64 ... 0x67:
         w = LE16TOH(slist[6]) & 0x3FF;
         h = LE16TOH(slist[7]) & 0x1FF;
-        gput_sum(cyc_sum, cyc, gput_sprite(w, h));
+        cyc += gput_sprite_area(w, h);
+        break;
+      case 0x68 ... 0x6b:
+      case 0x70 ... 0x7f:
         break;
-      case 0x68 ... 0x6b: gput_sum(cyc_sum, cyc, gput_sprite(1, 1));   break;
-      case 0x70 ... 0x73:
-      case 0x74 ... 0x77: gput_sum(cyc_sum, cyc, gput_sprite(8, 8));   break;
-      case 0x78 ... 0x7b:
-      case 0x7C ... 0x7f: gput_sum(cyc_sum, cyc, gput_sprite(16, 16)); break;
       case 0x80 ... 0x9f: // vid -> vid
         x =   LE16TOH(slist[4]) & 0x3ff;
         y =   LE16TOH(slist[5]) & 0x1ff;
         w = ((LE16TOH(slist[6]) - 1) & 0x3ff) + 1;
         h = ((LE16TOH(slist[7]) - 1) & 0x1ff) + 1;
-        darea = &agpu->draw_areas[agpu->pos_area];
-        if ((w > 2 || h > 1) &&
-            (x < darea->x0 || x + w > darea->x1 || y < darea->y0 || y + h > darea->y1))
-        {
-          add_draw_area(agpu, agpu->pos_added, 1, x, y, x + w, y + h);
-          add_draw_area_e(agpu, agpu->pos_added + 1, 1, gpu->ex_regs);
-        }
+        area_tiles(tiles, x, y, w, h);
         gput_sum(cyc_sum, cyc, gput_copy(w, h));
         break;
       case 0xa0 ... 0xbf: // sys -> vid
@@ -354,8 +429,10 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
           skip = 1;
           break;
         }
+        if (drew)
+          area_tiles_e(tiles, gpu->ex_regs);
+        drew = 0;
         gpu->ex_regs[cmd & 7] = LE32TOH(list[0]);
-        add_draw_area_e(agpu, agpu->pos_added, 0, gpu->ex_regs);
         insert_break = 1;
         break;
       default:
@@ -364,6 +441,7 @@ int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list_data, int li
         break;
     }
     rendered_anything |= rendered;
+    drew |= rendered && 0x20 <= cmd && cmd < 0x80;
     if (dst_can_add) {
       if (!skip) {
         int added = dst_can_add = do_add(agpu, list, len);
@@ -377,7 +455,6 @@ breakloop:
   if (pos_handled && (rendered_anything || pos_handled < pos))
     run_thread(agpu);
   if (pos_handled < pos) {
-    // note: this is poorly implemented (wrong pos_added for draw_areas)
     int left = pos - pos_handled;
     agpu_log(gpu, "agpu: full %d left %d\n", agpu->pos_added - agpu->pos_used, left);
     do_add_with_wait(agpu, list_data + pos_handled, left);
@@ -386,6 +463,10 @@ breakloop:
     struct cmd_break cmd = {{ HTOLE32(FAKECMD_BREAK << 24), }};
     do_add(agpu, cmd.u32s, sizeof(cmd.u32s) / sizeof(cmd.u32s[0]));
   }
+  if (drew)
+    area_tiles_e(tiles, gpu->ex_regs);
+  if (!agpu->batch)
+    commit_tiles(agpu);
 
   *cpu_cycles_sum_out += cyc_sum;
   *cpu_cycles_last = cyc;
@@ -396,9 +477,12 @@ breakloop:
 int gpu_async_try_dma(struct psx_gpu *gpu, const uint32_t *data, int words)
 {
   struct psx_gpu_async *agpu = gpu->async;
-  int used, w = gpu->dma.w, h = gpu->dma.h;
-  uint32_t pos_added = agpu->pos_added;
+  int used, w = gpu->dma.w, h = gpu->dma.h, y = gpu->dma.y;
+  int stride = (w + 1) / 2, rows, hc, need, l;
+  const uint16_t *sdata = (const uint16_t *)data;
+  uint32_t pos_added;
   union cmd_dma_write cmd;
+  uint16_t tiles[32];
   int bad = 0;
 
   if (!agpu)
@@ -408,33 +492,81 @@ int gpu_async_try_dma(struct psx_gpu *gpu, const uint32_t *data, int words)
   if (RDPOS(agpu->idle) && used == 0)
     return 0;
   // only proceed if there is space to avoid messy sync
-  if (AGPU_BUF_LEN - used < sizeof(cmd) / 4 + ((w + 1) / 2) * (h + 1)) {
-    agpu_log(gpu, "agpu: dma: used %d\n", used);
-    return 0;
+  if (words <= AGPU_DMA_MAX) {
+    if (AGPU_BUF_LEN - used < sizeof(cmd) / 4 + stride * (h + 1)) {
+      agpu_log(gpu, "agpu: dma: used %d\n", used);
+      return 0;
+    }
+    rows = h;
   }
+  else {
+    // large uploads (FMV frames) are queued in row chunks, waiting for the
+    // thread to make room, instead of draining it and writing vram here
+    rows = AGPU_DMA_MAX / stride;
+  }
+
+  for (; h > 0; h -= hc, y += hc) {
+    hc = min(h, rows);
+    need = sizeof(cmd) / 4 + stride * (hc + 1);
+    if (AGPU_BUF_LEN - (agpu->pos_added - RDPOS(agpu->pos_used)) < need)
+      wait_for_space(agpu, need);
+
+    pos_added = agpu->pos_added;
+    cmd.cmd = HTOLE32(FAKECMD_DMA_WRITE << 24);
+    cmd.x = gpu->dma.x; cmd.y = y & 511;
+    cmd.w = w; cmd.h = hc;
+    bad |= !do_add_pos(agpu, cmd.u32s, sizeof(cmd) / 4, &pos_added);
+    // lines are padded to psx dma word units when w is odd
+    for (l = 0; l < hc; l++, sdata += w)
+      bad |= !do_add_pos(agpu, sdata, stride, &pos_added);
+    assert(!bad); (void)bad;
+
+    BARRIER();
+    WRPOS(agpu->pos_added, pos_added);
+    run_thread(agpu);
 
-  cmd.cmd = HTOLE32(FAKECMD_DMA_WRITE << 24);
-  cmd.x = gpu->dma.x; cmd.y = gpu->dma.y;
-  cmd.w = gpu->dma.w; cmd.h = gpu->dma.h;
-  bad |= !do_add_pos(agpu, cmd.u32s, sizeof(cmd) / 4, &pos_added);
-  if (w & 1) {
-    // align lines to psx dma word units
-    const uint16_t *sdata = (const uint16_t *)data;
-    for (; h > 0; sdata += w, h--)
-      bad |= !do_add_pos(agpu, sdata, w / 2 + 1, &pos_added);
+    memset(tiles, 0, sizeof(tiles));
+    area_tiles(tiles, gpu->dma.x, y & 511, w, hc);
+    set_tiles(agpu, tiles, pos_added);
   }
-  else {
-    for (; h > 0; data += w / 2, h--)
-      bad |= !do_add_pos(agpu, data, w / 2, &pos_added);
+
+  return 1;
+}
+
+// called with the lock held
+static void wake_waiter(struct psx_gpu_async *agpu, int drained)
+{
+  switch (agpu->wait_mode) {
+    case waitmode_target:
+      if (!drained && (int32_t)(agpu->pos_flushed - agpu->pos_target) < 0)
+        break;
+      // fallthrough
+    case waitmode_progress:
+      agpu->wait_mode = waitmode_none;
+      scond_signal(agpu->cond_add);
+      break;
+    case waitmode_full:
+      if (!drained)
+        break;
+      agpu->wait_mode = waitmode_none;
+      scond_signal(agpu->cond_add);
+      break;
+    default:
+      break;
   }
-  assert(!bad); (void)bad;
+}
 
+static void wait_for_work(struct psx_gpu_async *agpu)
+{
   slock_lock(agpu->lock);
-  agpu->pos_added = pos_added;
-  run_thread_nolock(agpu);
+  wake_waiter(agpu, 1);
+  agpu->idle = 1;
+  FULL_BARRIER();
+  while (agpu->idle && !agpu->exit && RDPOS(agpu->pos_added) == agpu->pos_used)
+    scond_wait(agpu->cond_use, agpu->lock);
+  agpu->idle = 0;
+  twake_count(TWAKE_GPU);
   slock_unlock(agpu->lock);
-
-  return 1;
 }
 
 static STRHEAD_RET_TYPE gpu_async_thread(void *unused)
@@ -444,39 +576,30 @@ static STRHEAD_RET_TYPE gpu_async_thread(void *unused)
   int dirty = 0;
 
   assert(agpu);
-  slock_lock(agpu->lock);
-  while (!agpu->exit)
+  while (!RDPOS(agpu->exit))
   {
     int len = RDPOS(agpu->pos_added) - agpu->pos_used;
     int pos = agpu->pos_used & AGPU_BUF_MASK;
     int done, cycles_dummy = 0, cmd = -1;
+    uint32_t t0;
     assert(len >= 0);
-    if (len == 0 && !dirty) {
-      switch (agpu->wait_mode) {
-        case waitmode_full:
-        case waitmode_target:
-          agpu->wait_mode = waitmode_none;
-          scond_signal(agpu->cond_add);
-          break;
-        case waitmode_none:
-          break;
-        default:
-          assert(0);
+    if (len == 0) {
+      if (dirty) {
+        t0 = gpu_perf_ticks(gpup);
+        renderer_flush_queues();
+        gpu_perf_add(gpup, async_us, t0);
+        WRPOS(agpu->pos_flushed, agpu->pos_used);
+        dirty = 0;
       }
-      agpu->idle = 1;
-      scond_wait(agpu->cond_use, agpu->lock);
-      continue;
-    }
-    slock_unlock(agpu->lock);
-
-    if (len == 0 && dirty) {
-      renderer_flush_queues();
-      dirty = 0;
-      slock_lock(agpu->lock);
+      else
+        wait_for_work(agpu);
       continue;
     }
+    FULL_BARRIER(); // see the cmds that pos_added covers
 
+    t0 = gpu_perf_ticks(gpup);
     len = min(len, AGPU_BUF_LEN - pos);
+    evtrace_begin(EVT_GPU_CMD, len);
     done = renderer_do_cmd_list(agpu->cmd_buffer + pos, len, agpu->ex_regs,
              &cycles_dummy, &cycles_dummy, &cmd);
     if (done != len) {
@@ -497,6 +620,9 @@ static STRHEAD_RET_TYPE gpu_async_thread(void *unused)
         case FAKECMD_BREAK:
           done += sizeof(struct cmd_break) / 4;
           break;
+        case FAKECMD_COPY_FRAME:
+          done += do_copy_frame(gpup, list);
+          break;
         default:
           assert(0);
           if (!done)
@@ -506,23 +632,27 @@ static STRHEAD_RET_TYPE gpu_async_thread(void *unused)
     }
 
     dirty = 1;
+    evtrace_end(EVT_GPU_CMD);
+    gpu_perf_add(gpup, async_us, t0);
     assert(done > 0);
-    slock_lock(agpu->lock);
-    agpu->pos_used += done;
-    switch (agpu->wait_mode) {
-      case waitmode_target:
-        if ((int32_t)(agpu->pos_used - agpu->pos_target) < 0)
-          break;
-        // fallthrough
-      case waitmode_progress:
-        agpu->wait_mode = waitmode_none;
-        scond_signal(agpu->cond_add);
-        break;
-      default:
-        break;
+    FULL_BARRIER(); // done reading before the slots can be reused
+    WRPOS(agpu->pos_used, agpu->pos_used + done);
+    FULL_BARRIER();
+    // a waiter missed here is woken after the next batch or when idling
+    if (RDPOS(agpu->wait_mode) != waitmode_none) {
+      slock_lock(agpu->lock);
+      // the waiter is going to read vram, the renderer may still
+      // have the relevant prims queued
+      if (agpu->wait_mode == waitmode_target
+          && (int32_t)(agpu->pos_used - agpu->pos_target) >= 0) {
+        renderer_flush_queues();
+        agpu->pos_flushed = agpu->pos_used;
+        dirty = 0;
+      }
+      wake_waiter(agpu, 0);
+      slock_unlock(agpu->lock);
     }
   }
-  slock_unlock(agpu->lock);
   STRHEAD_RETURN();
 }
 
@@ -615,6 +745,22 @@ static int do_dma_write(struct psx_gpu *gpu,
   return done;
 }
 
+// rows are copied as vout_update() reads them, linearly from the
+// start offset and wrapping around the bottom of vram
+static int do_copy_frame(struct psx_gpu *gpu,
+    const union cmd_copy_frame *cmd)
+{
+  uint16_t *dst = gpu->async->frames[cmd->slot].vram;
+  int i, o;
+
+  renderer_flush_queues();
+  for (i = 0; i < cmd->h; i++) {
+    o = ((cmd->y + i) & 511) * 1024 + cmd->x;
+    memcpy(dst + o, gpu->vram + o, min(cmd->w, 1024 * 512 - o) * 2);
+  }
+  return sizeof(*cmd) / 4;
+}
+
 void gpu_async_sync(struct psx_gpu *gpu)
 {
   struct psx_gpu_async *agpu = gpu->async;
@@ -630,73 +776,134 @@ void gpu_async_sync(struct psx_gpu *gpu)
   if (!agpu->idle) {
     assert(agpu->wait_mode == waitmode_none);
     agpu->wait_mode = waitmode_full;
-    scond_wait(agpu->cond_add, agpu->lock);
+    wait_for_thread(agpu);
   }
   slock_unlock(agpu->lock);
   assert(agpu->pos_added == agpu->pos_used);
   assert(agpu->idle);
 }
 
-void gpu_async_sync_scanout(struct psx_gpu *gpu)
+// waits until everything queued before target has reached vram
+static void wait_for_pos(struct psx_gpu_async *agpu, uint32_t target)
+{
+  slock_lock(agpu->lock);
+  if (agpu->idle && agpu->pos_added != RDPOS(agpu->pos_used))
+    run_thread_nolock(agpu);
+  while (!agpu->idle && (int32_t)(target - agpu->pos_flushed) > 0) {
+    assert(agpu->wait_mode == waitmode_none);
+    agpu->pos_target = target;
+    agpu->wait_mode = waitmode_target;
+    wait_for_thread(agpu);
+  }
+  slock_unlock(agpu->lock);
+}
+
+// Waits only for the queued cmds that may have written to the area (and
+// for them to leave the renderer's queues), as tracked per 64x16 tile by
+// the main thread when adding them. Polling readbacks and the scanout of
+// the previous frame then don't have to drain whatever is queued after.
+void gpu_async_sync_area(struct psx_gpu *gpu, int x, int y, int w, int h)
 {
   struct psx_gpu_async *agpu = gpu->async;
-  int so_x0 = gpu->screen.src_x, so_y0 = gpu->screen.src_y;
-  int so_x1 = so_x0 + gpu->screen.hres, so_y1 = so_y0 + gpu->screen.vres;
-  uint32_t pos;
-  int c, i;
+  uint32_t target, cols, flushed;
+  uint16_t tiles[32] = { 0, };
+  int i, c, found = 0;
 
   if (!agpu)
     return;
-  pos = RDPOS(agpu->pos_used);
-  if (RDPOS(agpu->idle) && agpu->pos_added == pos)
+  commit_tiles(agpu);
+  flushed = RDPOS(agpu->pos_flushed);
+  if (RDPOS(agpu->idle) && agpu->pos_added == flushed)
     return;
-  i = agpu->pos_area;
-  if (agpu->idle)
-    /* unlikely but possible - do a full sync */;
-  else if (so_x1 > 1024 || so_y1 > 512) {
-    agpu_log(gpu, "agpu: wrap %d,%d %dx%d\n",
-      so_x0, so_y0, so_x1 - so_x0, so_y1 - so_y0);
-  }
-  else if (agpu->draw_areas[(i+1) & AGPU_AREAS_MASK].pos > pos) {
-    agpu_log(gpu, "agpu: oldest draw area %d > %d\n",
-      agpu->draw_areas[(i+1) & AGPU_AREAS_MASK].pos, pos);
-  }
-  else {
-    for (c = 0, i = agpu->pos_area; c < AGPU_AREAS_CNT;
-         c++, i = (i - 1) & AGPU_AREAS_MASK)
-    {
-      int area_x0 = agpu->draw_areas[i].x0, area_y0 = agpu->draw_areas[i].y0;
-      int area_x1 = agpu->draw_areas[i].x1, area_y1 = agpu->draw_areas[i].y1;
-      if (so_x1 <= area_x0 || area_x1 <= so_x0)
-        /* no x intersect */;
-      else if (so_y1 <= area_y0 || area_y1 <= so_y0)
-        /* no y intersect */;
-      else {
-        agpu_log(gpu, "agpu: scanout #%d %d,%d %dx%d hit %d,%d %dx%d\n",
-          c, so_x0, so_y0, so_x1 - so_x0, so_y1 - so_y0,
-          area_x0, area_y0, area_x1 - area_x0, area_y1 - area_y0);
-        break;
-      }
-      pos = RDPOS(agpu->pos_used);
-      if (pos >= agpu->draw_areas[i].pos)
-        return;
-    }
-    if (c > 0) {
-      i = (i + 1) & AGPU_AREAS_MASK;
-      agpu_log(gpu, "agpu: wait %d/%d\n", agpu->draw_areas[i].pos - agpu->pos_used,
-          agpu->pos_added - agpu->pos_used);
-      slock_lock(agpu->lock);
-      if (!agpu->idle) {
-        assert(agpu->wait_mode == waitmode_none);
-        agpu->pos_target = agpu->draw_areas[i].pos + 1;
-        agpu->wait_mode = waitmode_target;
-        scond_wait(agpu->cond_add, agpu->lock);
+  area_tiles(tiles, x & 0x3ff, y & 0x1ff, w, h);
+  target = flushed;
+  for (i = 0; i < 32; i++)
+    for (cols = tiles[i]; cols; cols &= cols - 1) {
+      c = __builtin_ctz(cols);
+      if ((int32_t)(agpu->tile_pos[i][c] - target) > 0) {
+        target = agpu->tile_pos[i][c];
+        found = 1;
       }
-      slock_unlock(agpu->lock);
-      return;
     }
+  if (!found)
+    return;
+
+  agpu_log(gpu, "agpu: sync area %d,%d %dx%d: %d/%d\n", x, y, w, h,
+    target - flushed, agpu->pos_added - flushed);
+  wait_for_pos(agpu, target);
+}
+
+static int scanout_width(const struct psx_gpu *gpu)
+{
+  int w = gpu->screen.hres;
+  if (gpu->status & PSX_GPU_STATUS_RGB24)
+    w = w * 3 / 2 + 1;
+  return w;
+}
+
+void gpu_async_sync_scanout(struct psx_gpu *gpu)
+{
+  if (!gpu->async)
+    return;
+  // vram is scanned out directly, a queued frame copy is stale now
+  gpu->async->frame_pending = 0;
+  gpu_async_sync_area(gpu, gpu->screen.src_x, gpu->screen.src_y,
+    scanout_width(gpu), gpu->screen.vres);
+}
+
+int gpu_async_frame_pending(struct psx_gpu *gpu)
+{
+  return gpu->async && gpu->async->frame_pending;
+}
+
+// Pipelined scanout: queue a copy of the display area to be made by the
+// gpu thread when it gets there (if queue is set), and return the copy
+// queued on the previous call to be scanned out instead, waiting for it
+// if needed. vout then shows frame N-1 while the thread still draws
+// frame N, at the cost of a frame of latency. If the display setup has
+// changed since (or there's no copy) it syncs and returns vram instead.
+uint16_t *gpu_async_scanout_frame(struct psx_gpu *gpu, int queue)
+{
+  struct psx_gpu_async *agpu = gpu->async;
+  struct agpu_frame *prev = NULL, *f;
+  union cmd_copy_frame cmd;
+
+  if (!agpu)
+    return gpu->vram;
+  if (agpu->frame_pending)
+    prev = &agpu->frames[(agpu->frame_cnt - 1) % AGPU_FRAMES];
+  agpu->frame_pending = 0;
+  if (prev && (memcmp(&prev->screen, &gpu->screen, sizeof(prev->screen))
+               || (prev->status ^ gpu->status) & PSX_GPU_STATUS_RGB24))
+    prev = NULL;
+
+  f = &agpu->frames[agpu->frame_cnt % AGPU_FRAMES];
+  if (queue && f->vram == NULL)
+    f->vram = malloc(1024 * 512 * 2);
+  if (queue && f->vram != NULL) {
+    cmd.cmd = HTOLE32(FAKECMD_COPY_FRAME << 24);
+    cmd.x = gpu->screen.src_x & 0x3ff;
+    cmd.y = gpu->screen.src_y & 0x1ff;
+    cmd.w = scanout_width(gpu);
+    cmd.h = gpu->screen.vres + 1; // vout_update() may skip an odd line
+    cmd.slot = agpu->frame_cnt % AGPU_FRAMES;
+    do_add_with_wait(agpu, cmd.u32s, sizeof(cmd) / 4);
+    run_thread(agpu);
+    f->screen = gpu->screen;
+    f->status = gpu->status;
+    f->pos = agpu->pos_added;
+    agpu->frame_cnt++;
+    agpu->frame_pending = 1;
+  }
+
+  if (prev == NULL) {
+    gpu_async_sync_area(gpu, gpu->screen.src_x, gpu->screen.src_y,
+      scanout_width(gpu), gpu->screen.vres);
+    return gpu->vram;
   }
-  gpu_async_sync(gpu);
+  if ((int32_t)(prev->pos - RDPOS(agpu->pos_flushed)) > 0)
+    wait_for_pos(agpu, prev->pos);
+  return prev->vram;
 }
 
 void gpu_async_sync_ecmds(struct psx_gpu *gpu)
@@ -712,6 +919,8 @@ void gpu_async_sync_ecmds(struct psx_gpu *gpu)
 
 static void psx_gpu_async_free(struct psx_gpu_async *agpu)
 {
+  int i;
+
   agpu->exit = 1;
   if (agpu->lock) {
     slock_lock(agpu->lock);
@@ -726,6 +935,8 @@ static void psx_gpu_async_free(struct psx_gpu_async *agpu)
   if (agpu->cond_add) { scond_free(agpu->cond_add); agpu->cond_add = NULL; }
   if (agpu->cond_use) { scond_free(agpu->cond_use); agpu->cond_use = NULL; }
   if (agpu->lock)     { slock_free(agpu->lock); agpu->lock = NULL; }
+  for (i = 0; i < AGPU_FRAMES; i++)
+    free(agpu->frames[i].vram);
   free(agpu);
 }
 
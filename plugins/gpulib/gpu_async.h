@@ -15,10 +15,14 @@ struct psx_gpu_async;
 int gpu_async_do_cmd_list(struct psx_gpu *gpu, const uint32_t *list, int list_len,
       int *cycles_sum_out, int *cycles_last, int *last_cmd);
 int gpu_async_try_dma(struct psx_gpu *gpu, const uint32_t *data, int words);
+void gpu_async_batch(struct psx_gpu *gpu, int on);
 void gpu_async_start(struct psx_gpu *gpu);
 void gpu_async_stop(struct psx_gpu *gpu);
 void gpu_async_sync(struct psx_gpu *gpu);
 void gpu_async_sync_scanout(struct psx_gpu *gpu);
+int gpu_async_frame_pending(struct psx_gpu *gpu);
+uint16_t *gpu_async_scanout_frame(struct psx_gpu *gpu, int queue);
+void gpu_async_sync_area(struct psx_gpu *gpu, int x, int y, int w, int h);
 void gpu_async_sync_ecmds(struct psx_gpu *gpu);
 void gpu_async_notify_screen_change(struct psx_gpu *gpu);
 void gpu_async_set_interlace(struct psx_gpu *gpu, int enable, int is_odd);
@@ -28,10 +32,14 @@ void gpu_async_set_interlace(struct psx_gpu *gpu, int enable, int is_odd);
 #define gpu_async_enabled(gpu) 0
 #define gpu_async_do_cmd_list(gpu, list, list_len, c0, c1, cmd) (list_len)
 #define gpu_async_try_dma(gpu, data, words) 0
+#define gpu_async_batch(gpu, on)
 #define gpu_async_start(gpu)
 #define gpu_async_stop(gpu)
 #define gpu_async_sync(gpu) do {} while (0)
 #define gpu_async_sync_scanout(gpu) do {} while (0)
+#define gpu_async_frame_pending(gpu) 0
+#define gpu_async_scanout_frame(gpu, queue) ((gpu)->vram)
+#define gpu_async_sync_area(gpu, x, y, w, h) do {} while (0)
 #define gpu_async_sync_ecmds(gpu)
 #define gpu_async_notify_screen_change(gpu)
 #define gpu_async_set_interlace(gpu, enable, is_odd)
@@ -1,6 +1,8 @@
 
 // very conservative and wrong
-#define gput_fill(w, h)     (23 + (4 + ((w) + 15) / 16u) * (h))
+#define gput_fill_base()    (23)
+#define gput_fill_area(w, h) ((4 + ((w) + 15) / 16u) * (h))
+#define gput_fill(w, h)     (gput_fill_base() + gput_fill_area(w, h))
 #define gput_copy(w, h)     ((w) * (h))
 #define gput_poly_base()    (23)
 #define gput_poly_base_t()  (gput_poly_base() + 90)
@@ -11,9 +13,23 @@
 #define gput_quad_base_g()  gput_poly_base_g()
 #define gput_quad_base_gt() gput_poly_base_gt()
 #define gput_line(k)        (8 + (k))
-#define gput_sprite(w, h)   (8 + ((w) / 2u) * (h))
+#define gput_sprite_base()  (8)
+#define gput_sprite_area(w, h) (((w) / 2u) * (h))
+#define gput_sprite(w, h)   (gput_sprite_base() + gput_sprite_area(w, h))
+
+// the above by command, for the size dependent ones (fill and variable
+// sized sprites) only the base, the caller adds the *_area() part from
+// the size it has decoded anyway; 0 means no cost, copies included
+extern const unsigned short gput_cmd_cycles[256];
 
 // sort of a workaround for lack of proper fifo emulation
 #define gput_sum(sum, cnt, new_cycles) do { \
   sum += cnt; cnt = new_cycles; \
 } while (0)
+
+// gput_sum() for the fixed part of cmd, if it has one
+#define gput_sum_cmd(sum, cnt, cmd) do { \
+  unsigned int c_ = gput_cmd_cycles[cmd]; \
+  if (c_) \
+    gput_sum(sum, cnt, c_); \
+} while (0)
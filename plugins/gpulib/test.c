@@ -1,6 +1,14 @@
+/*
+ * Replays a gpu dump (vram + registers state and a command list) through
+ * the renderer it's linked with, see Makefile.test and test_bench.sh.
+ * Prints one line of key=value results.
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
 #include "gpu.h"
 
 static inline unsigned int pcnt_get(void)
@@ -58,53 +66,248 @@ typedef struct
 
 static gpu_dump_struct state;
 
+// gpulib's layout, the renderers may read or write a bit past 1024x512
+static uint16_t vram_buf[1024 * 512 * 2] __attribute__((aligned(4096)));
+
+void SysPrintf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static int is_polyline_end(uint32_t w)
+{
+	return (w & 0xf000f000) == 0x50005000;
+}
+
+// length of the command at list, including the data words of
+// polylines and images, 0 if it runs past the end
+static int cmd_len(const uint32_t *list, int words, int *prims)
+{
+	int cmd = list[0] >> 24, len = 1 + cmd_lengths[cmd];
+	int step;
+
+	switch (cmd) {
+	case 0x02:
+	case 0x20 ... 0x3f:
+	case 0x40 ... 0x47:
+	case 0x50 ... 0x57:
+	case 0x60 ... 0x7f:
+		(*prims)++;
+		break;
+	case 0x48 ... 0x4f:
+	case 0x58 ... 0x5f:
+		step = (cmd & 0x10) ? 2 : 1;
+		for (len = 1 + step; len < words && !is_polyline_end(list[len]);
+		     len += step)
+			(*prims)++;
+		len++;
+		break;
+	case 0x80 ... 0x9f:
+		len = 4;
+		break;
+	case 0xc0 ... 0xdf:
+		len = 3;
+		break;
+	case 0xa0 ... 0xbf:
+		if (words >= 3) {
+			int w = ((list[2] & 0x3ff) - 1) & 0x3ff;
+			int h = (((list[2] >> 16) & 0x1ff) - 1) & 0x1ff;
+			len = 3 + ((w + 1) * (h + 1) + 1) / 2;
+		}
+		break;
+	}
+	return len <= words ? len : 0;
+}
+
+// the renderers leave vram transfers to gpulib, do them here
+static void do_vram_cmd(const uint32_t *list)
+{
+	int cmd = list[0] >> 24, x, y, w, h, i, j;
+	const uint16_t *src = (const uint16_t *)(list + 3);
+	uint16_t *vram = (uint16_t *)gpu.vram;
+
+	if (cmd < 0x80 || cmd >= 0xc0)
+		return;
+	x = list[cmd < 0xa0 ? 2 : 1] & 0x3ff;
+	y = (list[cmd < 0xa0 ? 2 : 1] >> 16) & 0x1ff;
+	w = ((((list[3 - (cmd >= 0xa0)] & 0x3ff) - 1) & 0x3ff) + 1);
+	h = (((((list[3 - (cmd >= 0xa0)] >> 16) & 0x1ff) - 1) & 0x1ff) + 1);
+	if (cmd < 0xa0) {
+		int sx = list[1] & 0x3ff, sy = (list[1] >> 16) & 0x1ff;
+		for (j = 0; j < h; j++)
+			for (i = 0; i < w; i++)
+				vram[((y + j) & 511) * 1024 + ((x + i) & 1023)] =
+					vram[((sy + j) & 511) * 1024 + ((sx + i) & 1023)];
+	}
+	else {
+		for (j = 0; j < h; j++)
+			for (i = 0; i < w; i++)
+				vram[((y + j) & 511) * 1024 + ((x + i) & 1023)] = *src++;
+	}
+	renderer_update_caches(x, y, w, h, 0);
+}
+
+static void do_cmd_list(uint32_t *list, int words, uint32_t *ex_regs)
+{
+	int dummy = 0, last_cmd, done;
+
+	while (words > 0) {
+		done = renderer_do_cmd_list(list, words, ex_regs,
+			&dummy, &dummy, &last_cmd);
+		if (done <= 0)
+			break;
+		list += done;
+		words -= done;
+	}
+}
+
+// the renderers see the drawing commands only, vram transfers are done
+// here between them like gpulib would
+static int run_list(uint32_t *list, int words)
+{
+	uint32_t ex_regs[8] = { 0, };
+	int pos = 0, start = 0, len, prims = 0;
+
+	while (pos < words && (len = cmd_len(list + pos, words - pos, &prims))) {
+		int cmd = list[pos] >> 24;
+		if (0x80 <= cmd && cmd < 0xe0) {
+			do_cmd_list(list + start, pos - start, ex_regs);
+			do_vram_cmd(list + pos);
+			start = pos + len;
+		}
+		pos += len;
+	}
+	do_cmd_list(list + start, pos - start, ex_regs);
+	renderer_flush_queues();
+	return prims;
+}
+
+static void *load_file(const char *name, int *size)
+{
+	FILE *f = fopen(name, "rb");
+	void *buf;
+
+	if (f == NULL) {
+		perror(name);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(*size + 4);
+	if (buf != NULL && fread(buf, 1, *size, f) != (size_t)*size) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	return buf;
+}
+
 int main(int argc, char *argv[])
 {
-  unsigned int start_cycles;
-  uint32_t ex_regs[8] = { 0, };
+  const char *ref_name = NULL;
+  unsigned int start_cycles, cycles;
+  uint16_t *ref = NULL;
   uint32_t *list;
-  int size, dummy;
+  int size, prims, repeats = 1, diff = 0;
+  double start, us;
   FILE *state_file;
-  FILE *list_file;
   FILE *out_file;
+  int c, i;
 
-  if (argc != 3 && argc != 4)
+  while ((c = getopt(argc, argv, "n:r:")) != -1)
   {
-    printf("usage:\n%s <state> <list> [vram_out]\n", argv[0]);
-    return 1;
+    if (c == 'n')
+      repeats = atoi(optarg);
+    else if (c == 'r')
+      ref_name = optarg;
+    else
+      goto usage;
   }
+  if (argc - optind != 2 && argc - optind != 3)
+    goto usage;
+  if (repeats < 1)
+    repeats = 1;
 
-  state_file = fopen(argv[1], "rb");
-  fread(&state, 1, sizeof(gpu_dump_struct), state_file);
+  state_file = fopen(argv[optind], "rb");
+  if (state_file == NULL || fread(&state, 1, sizeof(state), state_file) != sizeof(state))
+  {
+    fprintf(stderr, "can't read state %s\n", argv[optind]);
+    return 1;
+  }
   fclose(state_file);
+
+  list = (uint32_t *)load_file(argv[optind + 1], &size);
+  if (list == NULL)
+    return 1;
+  if (ref_name != NULL)
+  {
+    ref = (uint16_t *)load_file(ref_name, &i);
+    if (ref == NULL || i < 1024*512*2)
+    {
+      fprintf(stderr, "bad reference vram %s\n", ref_name);
+      return 1;
+    }
+  }
   
-  list_file = fopen(argv[2], "rb");
-  fseek(list_file, 0, SEEK_END);
-  size = ftell(list_file);
-  fseek(list_file, 0, SEEK_SET);
-
-  list = (uint32_t *)malloc(size);
-  fread(list, 1, size, list_file);
-  fclose(list_file);
- 
   pcnt_init();
+  gpu.vram = vram_buf + 4096 / 2;
   renderer_init();
-  memcpy(gpu.vram, state.vram, 1024*512*2);
   if ((state.gpu_register[8] & 0x24) == 0x24)
     renderer_set_interlace(1, !(state.status >> 31));
 
-  start_cycles = pcnt_get();
+  // the renderers are timed with the vram reset at each repeat
+  // so that every run draws the same thing
+  cycles = 0;
+  us = 0;
+  for (i = 0; i < repeats; i++)
+  {
+    memcpy(gpu.vram, state.vram, 1024*512*2);
+    renderer_update_caches(0, 0, 1024, 512, 1);
 
-  renderer_do_cmd_list(list, size / 4, ex_regs, &dummy, &dummy, &dummy);
-  renderer_flush_queues();
+    start = now_us();
+    start_cycles = pcnt_get();
+    prims = run_list(list, size / 4);
+    cycles += pcnt_get() - start_cycles;
+    us += now_us() - start;
+  }
+  us /= repeats;
 
-  printf("%u\n", pcnt_get() - start_cycles);
+  if (ref != NULL)
+  {
+    const uint16_t *vram = (uint16_t *)gpu.vram;
+    for (i = 0; i < 1024*512; i++)
+      diff += vram[i] != ref[i];
+  }
 
-  if (argc >= 4) {
-    out_file = fopen(argv[3], "wb");
-    fwrite(gpu.vram, 1, sizeof(gpu.vram), out_file);
+  printf("cycles=%u us=%.1f prims=%d prims_per_sec=%.0f", cycles / repeats,
+    us, prims, us > 0 ? prims * 1000000.0 / us : 0.0);
+  if (ref != NULL)
+    printf(" diff=%d", diff);
+  printf("\n");
+
+  if (argc - optind >= 3) {
+    out_file = fopen(argv[optind + 2], "wb");
+    fwrite(gpu.vram, 1, 1024*512*2, out_file);
     fclose(out_file);
   }
 
-  return 0;
+  return diff ? 2 : 0;
+
+usage:
+  printf("usage:\n%s [-n repeats] [-r ref_vram] <state> <list> [vram_out]\n"
+    "exits with 2 if the output differs from ref_vram\n", argv[0]);
+  return 1;
 }
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Replays every dump of a corpus through the test_* renderers built by
+# Makefile.test and prints one CSV line per dump and renderer. The vram
+# result of $REF (test_peops by default) is what the others are diffed
+# against, the diff column counts the pixels that differ.
+#
+# usage: [REF=test_x] [RENDERERS="test_x test_y"] test_bench.sh <dump_dir> [repeats]
+# <dump_dir>/<name>/ has dump3.dump (state) and list.dump, same as what
+# gpu_neon/psx_gpu/tests/psx_dump_check.sh uses, and what the frontend's
+# "GPU record" key writes (gp1.dump is ignored here)
+
+if test -z "$1"; then
+  echo "usage: $0 <dump_dir> [repeats]"
+  exit 1
+fi
+
+bin=$(dirname "$0")
+repeats=${2:-10}
+ref=${REF:-test_peops}
+renderers=${RENDERERS:-"test_neon test_peops test_unai"}
+commit=$(git -C "$bin" rev-parse --short HEAD 2>/dev/null)
+ref_vram=${TMPDIR:-/tmp}/test_bench.$$.vram
+
+echo "commit,dump,renderer,us,prims,prims_per_sec,cycles,diff"
+for dump in "$1"/*
+do
+  if [ ! -e $dump/dump3.dump -o ! -e $dump/list.dump ]; then
+    continue
+  fi
+  if ! "$bin/$ref" $dump/dump3.dump $dump/list.dump $ref_vram > /dev/null; then
+    echo "$ref failed on $dump" >&2
+    continue
+  fi
+  for r in $renderers
+  do
+    [ -x "$bin/$r" ] || continue
+    # test.c prints cycles= us= prims= prims_per_sec= diff=
+    diff=
+    eval $("$bin/$r" -n $repeats -r $ref_vram $dump/dump3.dump $dump/list.dump)
+    echo "$commit,$(basename $dump),$r,$us,$prims,$prims_per_sec,$cycles,$diff"
+  done
+done
+rm -f $ref_vram
@@ -68,7 +68,8 @@ static void check_mode_change(int force)
 int vout_update(void)
 {
   int bpp = (gpu.status & PSX_GPU_STATUS_RGB24) ? 24 : 16;
-  uint8_t *vram = (uint8_t *)gpu.vram;
+  uint8_t *vram = (uint8_t *)(gpu.state.scanout_vram
+    ? gpu.state.scanout_vram : gpu.vram);
   int src_x = gpu.screen.src_x;
   int src_y = gpu.screen.src_y;
   int x = gpu.screen.x;
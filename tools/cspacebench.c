@@ -0,0 +1,123 @@
+/*
+ * Checks the frontend/cspace.c conversions that have vector versions
+ * against plain C references and times both.
+ *
+ * usage: cspacebench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../frontend/cspace.h"
+
+#define SRC_W 640
+#define ROWS 240
+
+static uint16_t ref_555(uint16_t p)
+{
+	return ((p & 0x1f) << 11) | ((p & 0x3e0) << 1) | ((p >> 10) & 0x1f);
+}
+
+static uint16_t ref_888(const uint8_t *s)
+{
+	return ((s[0] & 0xf8) << 8) | ((s[1] & 0xfc) << 3) | (s[2] >> 3);
+}
+
+static void ref_bgr555_640(void *dst_, const void *src_, int dpixels)
+{
+	const uint16_t *src = src_;
+	uint16_t *dst = dst_;
+	int i;
+
+	for (i = 0; i < dpixels; i++)
+		dst[i] = ref_555(src[i * 2]);
+}
+
+static void ref_bgr555_512(void *dst_, const void *src_, int dpixels)
+{
+	static const int pick[10] = { 0, 2, 4, 5, 7, 8, 10, 12, 13, 15 };
+	const uint16_t *src = src_;
+	uint16_t *dst = dst_;
+	int i;
+
+	for (i = 0; i < dpixels / 10 * 10; i++)
+		dst[i] = ref_555(src[i / 10 * 16 + pick[i % 10]]);
+}
+
+static void ref_bgr888_640(void *dst_, const void *src_, int dpixels)
+{
+	const uint8_t *src = src_;
+	uint16_t *dst = dst_;
+	int i;
+
+	for (i = 0; i < dpixels; i++)
+		dst[i] = ref_888(src + i * 2 * 3);
+}
+
+static const struct {
+	const char *name;
+	void (*func)(void *dst, const void *src, int dst_pixels);
+	void (*ref)(void *dst, const void *src, int dst_pixels);
+	int src_w, bpp;
+} tests[] = {
+	{ "bgr555_to_rgb565_640_to_320", bgr555_to_rgb565_640_to_320, ref_bgr555_640, 640, 16 },
+	{ "bgr555_to_rgb565_512_to_320", bgr555_to_rgb565_512_to_320, ref_bgr555_512, 512, 16 },
+	{ "bgr888_to_rgb565_640_to_320", bgr888_to_rgb565_640_to_320, ref_bgr888_640, 640, 24 },
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(void (*f)(void *, const void *, int), uint16_t *dst,
+	const uint8_t *src, int src_stride, int iters)
+{
+	double t = now_sec();
+	int i, y;
+
+	for (i = 0; i < iters; i++)
+		for (y = 0; y < ROWS; y++)
+			f(dst + y * 320, src + y * src_stride, 320);
+	return now_sec() - t;
+}
+
+int main(int argc, char *argv[])
+{
+	int iters = argc > 1 ? atoi(argv[1]) : 200;
+	int src_stride = SRC_W * 3;
+	uint8_t *src = malloc(src_stride * ROWS);
+	uint16_t *dst = malloc(320 * ROWS * 2), *dref = malloc(320 * ROWS * 2);
+	int i, ret = 0;
+
+	if (!src || !dst || !dref)
+		return 1;
+	srand(1);
+	for (i = 0; i < src_stride * ROWS; i++)
+		src[i] = rand();
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		double t, tref;
+
+		memset(dst, 0, 320 * ROWS * 2);
+		memset(dref, 0, 320 * ROWS * 2);
+		run(tests[i].func, dst, src, src_stride, 1);
+		run(tests[i].ref, dref, src, src_stride, 1);
+		if (memcmp(dst, dref, 320 * ROWS * 2) != 0) {
+			printf("%s: MISMATCH\n", tests[i].name);
+			ret = 1;
+			continue;
+		}
+		t = run(tests[i].func, dst, src, src_stride, iters);
+		tref = run(tests[i].ref, dref, src, src_stride, iters);
+		printf("%-30s %7.1f us/frame, C %7.1f us/frame, %.2fx\n",
+			tests[i].name, t * 1e6 / iters, tref * 1e6 / iters, tref / t);
+	}
+	free(src);
+	free(dst);
+	free(dref);
+	return ret;
+}
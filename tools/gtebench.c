@@ -0,0 +1,322 @@
+/*
+ * Runs recorded (or random) cop2 ops through every GTE implementation
+ * linked in, checks the results against gte.c and times them.
+ * Flagless backends are compared with FLAG masked out.
+ *
+ * usage: gtebench [-i iterations] [trace ...]
+ * traces come from an interpreter built with -DGTE_TRACE and run with
+ * PCSX_GTE_TRACE=file, see psxinterpreter.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libpcsxcore/gte.h"
+#if defined(__arm__)
+#include "arm_features.h"
+#include "../libpcsxcore/gte_arm.h"
+#include "../libpcsxcore/new_dynarec/linkage_offsets.h"
+#endif
+#if defined(__ARM_NEON__)
+#include "../libpcsxcore/gte_neon.h"
+#endif
+
+#define FLAG_REG	(32 + 31)
+#define RANDOM_OPS	4096
+
+psxRegisters psxRegs;
+
+#define GTE_OPS \
+	X(0x01, RTPS) X(0x06, NCLIP) X(0x0c, OP) X(0x10, DPCS) X(0x11, INTPL) \
+	X(0x12, MVMVA) X(0x13, NCDS) X(0x14, CDP) X(0x16, NCDT) X(0x1b, NCCS) \
+	X(0x1c, CC) X(0x1e, NCS) X(0x20, NCT) X(0x28, SQR) X(0x29, DCPL) \
+	X(0x2a, DPCT) X(0x2d, AVSZ3) X(0x2e, AVSZ4) X(0x30, RTPT) X(0x3d, GPF) \
+	X(0x3e, GPL) X(0x3f, NCCT)
+
+// gte.h can only declare one of the sets
+#define X(f, n) void gte##n##_nf(struct psxCP2Regs *regs);
+GTE_OPS
+#undef X
+
+typedef void (*asm_fn)(void *regs, int opcode);
+
+struct backend {
+	const char *name;
+	struct {
+		void (*c_fn)(struct psxCP2Regs *regs);
+		asm_fn a_fn;
+		int flags; // computes FLAG
+	} op[64];
+};
+
+static struct backend backends[4];
+static int backend_cnt;
+static const char *op_names[64];
+
+// the asm reaches its scratch buffer through the dynarec linkage layout
+static union {
+	psxCP2Regs r;
+#if defined(__arm__)
+	unsigned char b[LO_cop2_to_scratch_buf + sizeof(void *)];
+#endif
+} __attribute__((aligned(64))) work;
+static uint32_t scratch[8*8*2] __attribute__((aligned(64)));
+
+struct rec {
+	uint32_t code;
+	psxCP2Regs regs;
+};
+
+static struct rec *recs;
+static int rec_cnt, rec_max;
+
+static void init_backends(void)
+{
+	struct backend *b;
+
+#define X(f, n) op_names[f] = #n;
+	GTE_OPS
+#undef X
+	b = &backends[backend_cnt++];
+	b->name = "c";
+#define X(f, n) b->op[f].c_fn = gte##n; b->op[f].flags = 1;
+	GTE_OPS
+#undef X
+	b = &backends[backend_cnt++];
+	b->name = "nf";
+#define X(f, n) b->op[f].c_fn = gte##n##_nf;
+	GTE_OPS
+#undef X
+#if defined(__arm__)
+	b = &backends[backend_cnt++];
+	b->name = "arm";
+	b->op[0x06].a_fn = gteNCLIP_arm; b->op[0x06].flags = 1;
+#ifdef HAVE_ARMV5
+	b->op[0x01].a_fn = gteRTPS_nf_arm;
+	b->op[0x30].a_fn = gteRTPT_nf_arm;
+#endif
+	memcpy(work.b + LO_cop2_to_scratch_buf, &(void *){ scratch }, sizeof(void *));
+#endif
+#if defined(__ARM_NEON__)
+	b = &backends[backend_cnt++];
+	b->name = "neon";
+	b->op[0x01].a_fn = gteRTPS_neon; b->op[0x01].flags = 1;
+	b->op[0x30].a_fn = gteRTPT_neon; b->op[0x30].flags = 1;
+#endif
+	(void)scratch;
+}
+
+static int has_op(const struct backend *b, int f)
+{
+	return b->op[f].c_fn != NULL || b->op[f].a_fn != NULL;
+}
+
+static void run_op(const struct backend *b, int f, uint32_t code)
+{
+	if (b->op[f].a_fn)
+		b->op[f].a_fn(&work.r, code);
+	else {
+		psxRegs.code = code;
+		b->op[f].c_fn(&work.r);
+	}
+}
+
+static struct rec *new_rec(void)
+{
+	if (rec_cnt == rec_max) {
+		rec_max = rec_max ? rec_max * 2 : 4096;
+		recs = realloc(recs, rec_max * sizeof(recs[0]));
+		if (recs == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	return &recs[rec_cnt++];
+}
+
+static int load_trace(const char *path)
+{
+	uint32_t hdr[3];
+	struct rec *r;
+	FILE *f;
+	int n = 0;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || hdr[0] != 0x54455447
+	    || hdr[1] != 1 || hdr[2] != sizeof(*r)) {
+		fprintf(stderr, "%s: not a gte trace\n", path);
+		fclose(f);
+		return -1;
+	}
+	for (;;) {
+		r = new_rec();
+		if (fread(r, 1, sizeof(*r), f) != sizeof(*r)) {
+			rec_cnt--;
+			break;
+		}
+		n++;
+	}
+	fclose(f);
+	printf("%s: %d ops\n", path, n);
+	return 0;
+}
+
+// register values as MTC2/CTC2 would leave them, random op fields
+static void gen_random(void)
+{
+	static const uint32_t field_mask = (1 << 19) | (1 << 10) | (0x1f << 13);
+	struct rec *r;
+	int f, i, j;
+
+	srand(1);
+	for (f = 0; f < 64; f++) {
+		if (op_names[f] == NULL)
+			continue;
+		for (i = 0; i < RANDOM_OPS; i++) {
+			r = new_rec();
+			memset(&r->regs, 0, sizeof(r->regs));
+			for (j = 0; j < 32; j++) {
+				uint32_t v = rand() ^ (rand() << 15) ^ (rand() << 30);
+				// mostly small values, saturation is covered too
+				if (rand() & 1)
+					v = (int32_t)v >> (rand() & 15);
+				MTC2(&r->regs, v, j);
+				CTC2(&r->regs, rand() ^ (rand() << 15), j);
+			}
+			r->code = 0x4a000000 | (rand() & field_mask) | f;
+		}
+	}
+	printf("random: %d ops\n", rec_cnt);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check(const struct backend *b, int f, int *total)
+{
+	psxCP2Regs ref;
+	int i, j, bad = 0;
+
+	for (i = 0; i < rec_cnt; i++) {
+		const struct rec *r = &recs[i];
+		if ((r->code & 0x3f) != f)
+			continue;
+		(*total)++;
+		work.r = r->regs;
+		run_op(&backends[0], f, r->code);
+		ref = work.r;
+		work.r = r->regs;
+		run_op(b, f, r->code);
+		for (j = 0; j < 64; j++) {
+			uint32_t x = ((uint32_t *)&work.r)[j];
+			uint32_t y = ((uint32_t *)&ref)[j];
+			if (j == FLAG_REG && !b->op[f].flags)
+				continue;
+			if (x == y)
+				continue;
+			if (bad++ < 3)
+				printf("  %s %s op %08x: %s%d %08x, expected %08x\n",
+					b->name, op_names[f], r->code, j < 32 ? "d" : "c",
+					j & 31, x, y);
+			break;
+		}
+	}
+	return bad;
+}
+
+#define BENCH_ROUNDS 5
+
+// ns per op, the register copy in between is subtracted; both loops are
+// timed in turns and the best of each taken so that noise in one of them
+// doesn't show up as a (negative) op cost
+static double bench(const struct backend *b, int f, int iters)
+{
+	double t0, t1, t2, base = 1e30, op = 1e30;
+	int i, k, r, n = 0;
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		n = 0;
+		t0 = now();
+		for (k = 0; k < iters; k++)
+			for (i = 0; i < rec_cnt; i++)
+				if ((recs[i].code & 0x3f) == f) {
+					work.r = recs[i].regs;
+					__asm__ volatile("" ::: "memory");
+					n++;
+				}
+		t1 = now();
+		for (k = 0; k < iters; k++)
+			for (i = 0; i < rec_cnt; i++)
+				if ((recs[i].code & 0x3f) == f) {
+					work.r = recs[i].regs;
+					run_op(b, f, recs[i].code);
+				}
+		t2 = now();
+		if (t1 - t0 < base)
+			base = t1 - t0;
+		if (t2 - t1 < op)
+			op = t2 - t1;
+	}
+	if (n == 0 || op <= base)
+		return 0;
+	return (op - base) * 1e9 / n;
+}
+
+int main(int argc, char *argv[])
+{
+	int iters = 20, ret = 0;
+	int b, f, i, n, bad;
+
+	init_backends();
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			iters = atoi(argv[++i]);
+		else if (load_trace(argv[i]) != 0)
+			return 1;
+	}
+	if (rec_cnt == 0)
+		gen_random();
+
+	printf("%-6s %7s", "op", "count");
+	for (b = 0; b < backend_cnt; b++)
+		printf(" %8s ns", backends[b].name);
+	printf("\n");
+	for (f = 0; f < 64; f++) {
+		if (op_names[f] == NULL)
+			continue;
+		for (i = n = 0; i < rec_cnt; i++)
+			n += (recs[i].code & 0x3f) == f;
+		if (n == 0)
+			continue;
+		for (b = 1; b < backend_cnt; b++) {
+			if (!has_op(&backends[b], f))
+				continue;
+			i = 0;
+			bad = check(&backends[b], f, &i);
+			if (bad) {
+				printf("  %s %s: %d of %d MISMATCH\n", backends[b].name,
+					op_names[f], bad, i);
+				ret = 1;
+			}
+		}
+		printf("%-6s %7d", op_names[f], n);
+		for (b = 0; b < backend_cnt; b++) {
+			if (has_op(&backends[b], f))
+				printf(" %11.1f", bench(&backends[b], f, iters));
+			else
+				printf(" %11s", "-");
+		}
+		printf("\n");
+	}
+	free(recs);
+	return ret;
+}
@@ -0,0 +1,250 @@
+/*
+ * Decodes recorded mdec input through rl2blk/idct/yuv2rgb in 15 and 24bpp
+ * modes (whatever the game used), reports macroblocks/sec and, with -c,
+ * compares the pixels to golden output written earlier with -w.
+ * Build with -DNO_MDEC_SIMD for the plain C reference.
+ *
+ * usage: mdecbench [-i iterations] [-w dir | -c dir] trace
+ * traces come from a core built with -DMDEC_TRACE and run with
+ * PCSX_MDEC_TRACE=file, see mdec.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libpcsxcore/mdec.c"
+
+// what mdec.c links against
+psxRegisters psxRegs;
+PcsxConfig Config;
+struct PcsxSaveFuncs SaveFuncs;
+s8 *psxM, *psxH;
+
+void events_queue(u32 e, u32 abs)
+{
+}
+
+// a decode never needs to look further, see rl2blk()
+#define RL_PAD		16
+
+struct stream {
+	u32 cmd;
+	u32 words;
+	u16 *data;	// followed by RL_PAD end codes
+};
+
+static struct stream *streams;
+static int stream_cnt, stream_max;
+static u8 *out;
+
+static int load_trace(const char *path)
+{
+	u32 hdr[2], rec[2];
+	struct stream *s;
+	FILE *f;
+	int i;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || hdr[0] != 0x5443444d
+	    || hdr[1] != 1) {
+		fprintf(stderr, "%s: not a mdec trace\n", path);
+		fclose(f);
+		return -1;
+	}
+	while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+		if (stream_cnt == stream_max) {
+			stream_max = stream_max ? stream_max * 2 : 256;
+			streams = realloc(streams, stream_max * sizeof(streams[0]));
+			if (streams == NULL)
+				goto oom;
+		}
+		s = &streams[stream_cnt];
+		s->cmd = rec[0];
+		s->words = rec[1];
+		s->data = malloc(s->words * 4 + RL_PAD * 2);
+		if (s->data == NULL)
+			goto oom;
+		if (fread(s->data, 1, s->words * 4, f) != s->words * 4) {
+			free(s->data);
+			break;
+		}
+		for (i = 0; i < RL_PAD; i++)
+			s->data[s->words * 2 + i] = SWAP16(MDEC_END_OF_DATA);
+		stream_cnt++;
+	}
+	fclose(f);
+	return 0;
+
+oom:
+	fprintf(stderr, "out of memory\n");
+	exit(1);
+}
+
+// returns the macroblocks decoded to out
+static int decode_stream(const struct stream *s, int rgb24)
+{
+	const u16 *rl = s->data, *rl_end = s->data + s->words * 2;
+	int blk[DSIZE2 * 6];
+	int n = 0;
+
+	if ((s->cmd >> 28) == 4) {
+		iqtab_init(iq_y, (const u8 *)s->data);
+		iqtab_init(iq_uv, (const u8 *)s->data + 64);
+		return 0;
+	}
+	while (rl < rl_end && SWAP16(*rl) != MDEC_END_OF_DATA) {
+		rl = rl2blk(blk, rl);
+		if (rgb24)
+			yuv2rgb24(blk, out + n * SIZE_OF_24B_BLOCK);
+		else
+			yuv2rgb15(blk, (u16 *)(out + n * SIZE_OF_16B_BLOCK));
+		n++;
+	}
+	return n;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int channel_diff(const u8 *a, const u8 *b, int bytes, int rgb24)
+{
+	int i, c, d, maxd = 0;
+
+	for (i = 0; i < bytes; i += rgb24 ? 1 : 2) {
+		if (rgb24) {
+			d = abs(a[i] - b[i]);
+			if (d > maxd)
+				maxd = d;
+			continue;
+		}
+		for (c = 0; c < 15; c += 5) {
+			int x = ((a[i] | (a[i + 1] << 8)) >> c) & 0x1f;
+			int y = ((b[i] | (b[i + 1] << 8)) >> c) & 0x1f;
+			if (abs(x - y) > maxd)
+				maxd = abs(x - y);
+		}
+	}
+	return maxd;
+}
+
+// one pass through the trace, writing or checking the pixels
+static int verify(const char *dir, int write, int rgb24)
+{
+	int bsize = rgb24 ? SIZE_OF_24B_BLOCK : SIZE_OF_16B_BLOCK;
+	int i, b, n, d, bad = 0, maxd = 0, first_s = -1, first_b = -1;
+	u8 mb[SIZE_OF_24B_BLOCK];
+	char path[512];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/mdec_%d.raw", dir, rgb24 ? 24 : 15);
+	f = fopen(path, write ? "wb" : "rb");
+	if (f == NULL) {
+		perror(path);
+		return 1;
+	}
+	for (i = 0; i < stream_cnt; i++) {
+		n = decode_stream(&streams[i], rgb24);
+		if (write) {
+			fwrite(out, 1, n * bsize, f);
+			continue;
+		}
+		for (b = 0; b < n; b++) {
+			if (fread(mb, 1, bsize, f) != bsize) {
+				printf("  %s: ends at stream %d block %d\n", path, i, b);
+				fclose(f);
+				return 1;
+			}
+			if (memcmp(mb, out + b * bsize, bsize) == 0)
+				continue;
+			if (bad++ == 0) {
+				first_s = i;
+				first_b = b;
+			}
+			d = channel_diff(mb, out + b * bsize, bsize, rgb24);
+			if (d > maxd)
+				maxd = d;
+		}
+	}
+	if (!write && fread(mb, 1, 1, f) == 1) {
+		printf("  %s: has more data\n", path);
+		bad++;
+	}
+	fclose(f);
+	if (bad)
+		printf("  %dbpp: %d macroblocks MISMATCH, first stream %d block %d,"
+			" max channel diff %d\n", rgb24 ? 24 : 15, bad, first_s,
+			first_b, maxd);
+	return bad != 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *golden_dir = NULL, *trace_path = NULL;
+	int iters = 5, write = 0, ret = 0;
+	u32 max_words = 0;
+	int i, k, rgb24;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			iters = atoi(argv[++i]);
+		else if ((!strcmp(argv[i], "-w") || !strcmp(argv[i], "-c")) && i + 1 < argc) {
+			write = argv[i][1] == 'w';
+			golden_dir = argv[++i];
+		}
+		else
+			trace_path = argv[i];
+	}
+	if (trace_path == NULL) {
+		fprintf(stderr, "usage: %s [-i iterations] [-w dir | -c dir] trace\n", argv[0]);
+		return 1;
+	}
+	if (load_trace(trace_path) != 0)
+		return 1;
+	for (i = 0; i < stream_cnt; i++)
+		if (streams[i].words > max_words)
+			max_words = streams[i].words;
+	// a macroblock takes at least 6 dc + 6 end codes
+	out = malloc((max_words * 2 / 12 + 1) * SIZE_OF_24B_BLOCK);
+	if (out == NULL)
+		return 1;
+#ifdef MDEC_SIMD
+	printf("%d dma0 records, simd build\n", stream_cnt);
+#else
+	printf("%d dma0 records, C build\n", stream_cnt);
+#endif
+
+	printf("%-5s %10s %12s %8s\n", "mode", "blocks", "blocks/s", "ns/block");
+	for (rgb24 = 0; rgb24 < 2; rgb24++) {
+		double best = 0, t0, t1;
+		int blocks = 0;
+
+		for (k = 0; k < iters; k++) {
+			blocks = 0;
+			t0 = now();
+			for (i = 0; i < stream_cnt; i++)
+				blocks += decode_stream(&streams[i], rgb24);
+			t1 = now();
+			if (k == 0 || t1 - t0 < best)
+				best = t1 - t0;
+		}
+		printf("%2dbpp %10d %12.0f %8.1f\n", rgb24 ? 24 : 15, blocks,
+			blocks / best, best * 1e9 / (blocks ? blocks : 1));
+		if (golden_dir)
+			ret |= verify(golden_dir, write, rgb24);
+	}
+
+	for (i = 0; i < stream_cnt; i++)
+		free(streams[i].data);
+	free(streams);
+	free(out);
+	return ret;
+}
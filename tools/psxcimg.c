@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #define CD_FRAMESIZE_RAW 2352
 
@@ -10,6 +14,231 @@ struct ztab_entry {
 	unsigned short size;
 } __attribute__((packed));
 
+// .cbin output, as read by handlecbin() in libpcsxcore/cdriso.c
+struct ciso_header {
+	char magic[4];
+	unsigned int header_size;
+	unsigned long long total_bytes;
+	unsigned int block_size;
+	unsigned char ver;
+	unsigned char align;
+	unsigned char rsv_06[2];	// [0] - codec
+};
+
+enum {
+	CODEC_DEFLATE = 0,
+	CODEC_ZSTD = 1,
+};
+
+// sectors compressed per batch, split between the threads
+#define BATCH_SECTORS 4096
+
+struct batch {
+	unsigned char *in;
+	unsigned char (*out)[CD_FRAMESIZE_RAW * 2];
+	unsigned int *out_size;	// 0 - store the sector uncompressed
+	long count;
+	int codec, threads;
+};
+
+struct worker {
+	pthread_t thread;
+	struct batch *b;
+	int index;
+	int failed;
+};
+
+static int compress_sector(int codec, unsigned char *out, unsigned int *out_size,
+	const unsigned char *in)
+{
+	unsigned long dest_len = CD_FRAMESIZE_RAW * 2;
+	z_stream z;
+	int ret;
+
+#ifdef HAVE_ZSTD
+	if (codec == CODEC_ZSTD) {
+		size_t r = ZSTD_compress(out, dest_len, in, CD_FRAMESIZE_RAW, 19);
+		if (ZSTD_isError(r))
+			return -1;
+		*out_size = r;
+		return 0;
+	}
+#endif
+	// raw deflate, no zlib header
+	memset(&z, 0, sizeof(z));
+	ret = deflateInit2(&z, 9, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
+	if (ret != Z_OK)
+		return -1;
+	z.next_in = (unsigned char *)in;
+	z.avail_in = CD_FRAMESIZE_RAW;
+	z.next_out = out;
+	z.avail_out = dest_len;
+	ret = deflate(&z, Z_FINISH);
+	*out_size = dest_len - z.avail_out;
+	deflateEnd(&z);
+	return ret == Z_STREAM_END ? 0 : -1;
+}
+
+static void *compress_thread(void *arg)
+{
+	struct worker *w = arg;
+	struct batch *b = w->b;
+	long i;
+
+	for (i = w->index; i < b->count; i += b->threads) {
+		if (compress_sector(b->codec, b->out[i], &b->out_size[i],
+				b->in + i * CD_FRAMESIZE_RAW)) {
+			w->failed = 1;
+			break;
+		}
+		if (b->out_size[i] >= CD_FRAMESIZE_RAW)
+			b->out_size[i] = 0;
+	}
+	return NULL;
+}
+
+static int write_cbin(FILE *fin, const char *out_basename, int codec, int threads)
+{
+	struct ciso_header hdr;
+	struct worker *workers;
+	struct batch b;
+	unsigned int *index;
+	unsigned long long out_bytes;
+	char *out_fname;
+	FILE *fout;
+	long s, i, total_sectors;
+	int t, len;
+
+	if (fseek(fin, 0, SEEK_END) != 0) {
+		fprintf(stderr, "fseek failed: ");
+		perror(NULL);
+		return 1;
+	}
+	total_sectors = ftell(fin) / CD_FRAMESIZE_RAW;
+	if (ftell(fin) % CD_FRAMESIZE_RAW)
+		fprintf(stderr, "warning: input size is not multiple of sector size\n");
+	fseek(fin, 0, SEEK_SET);
+	if (total_sectors == 0) {
+		fprintf(stderr, "empty input\n");
+		return 1;
+	}
+
+	len = strlen(out_basename) + 6;
+	out_fname = malloc(len);
+	index = calloc(total_sectors + 1, sizeof(index[0]));
+	workers = calloc(threads, sizeof(workers[0]));
+	b.in = malloc(BATCH_SECTORS * CD_FRAMESIZE_RAW);
+	b.out = malloc(BATCH_SECTORS * sizeof(b.out[0]));
+	b.out_size = malloc(BATCH_SECTORS * sizeof(b.out_size[0]));
+	if (!out_fname || !index || !workers || !b.in || !b.out || !b.out_size) {
+		fprintf(stderr, "OOM\n");
+		return 1;
+	}
+	b.codec = codec;
+	b.threads = threads;
+	snprintf(out_fname, len, "%s.cbin", out_basename);
+
+	fout = fopen(out_fname, "wb");
+	if (fout == NULL) {
+		fprintf(stderr, "fopen %s: ", out_fname);
+		perror(NULL);
+		return 1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, "CISO", 4);
+	hdr.header_size = sizeof(hdr);
+	hdr.total_bytes = (unsigned long long)total_sectors * CD_FRAMESIZE_RAW;
+	hdr.block_size = CD_FRAMESIZE_RAW;
+	hdr.ver = 1;
+	hdr.rsv_06[0] = codec;
+
+	// index is filled in at the end
+	out_bytes = sizeof(hdr) + (total_sectors + 1) * sizeof(index[0]);
+	if (fseek(fout, out_bytes, SEEK_SET) != 0) {
+		fprintf(stderr, "fseek failed: ");
+		perror(NULL);
+		return 1;
+	}
+
+	for (s = 0; s < total_sectors; s += b.count) {
+		b.count = total_sectors - s;
+		if (b.count > BATCH_SECTORS)
+			b.count = BATCH_SECTORS;
+		if (fread(b.in, CD_FRAMESIZE_RAW, b.count, fin) != b.count) {
+			printf("\n");
+			fprintf(stderr, "fread failed\n");
+			return 1;
+		}
+
+		for (t = 0; t < threads; t++) {
+			workers[t].b = &b;
+			workers[t].index = t;
+			if (pthread_create(&workers[t].thread, NULL, compress_thread, &workers[t])) {
+				fprintf(stderr, "pthread_create failed\n");
+				return 1;
+			}
+		}
+		for (t = 0; t < threads; t++) {
+			pthread_join(workers[t].thread, NULL);
+			if (workers[t].failed) {
+				printf("\n");
+				fprintf(stderr, "compression failed\n");
+				return 1;
+			}
+		}
+
+		for (i = 0; i < b.count; i++) {
+			const void *data = b.out_size[i] ? b.out[i] : b.in + i * CD_FRAMESIZE_RAW;
+			unsigned int size = b.out_size[i] ? b.out_size[i] : CD_FRAMESIZE_RAW;
+
+			if (out_bytes > 0x7fffffff) {
+				printf("\n");
+				fprintf(stderr, "output too large\n");
+				return 1;
+			}
+			index[s + i] = out_bytes | (b.out_size[i] ? 0 : 0x80000000);
+			if (fwrite(data, 1, size, fout) != size) {
+				printf("\n");
+				fprintf(stderr, "fwrite failed\n");
+				return 1;
+			}
+			out_bytes += size;
+		}
+
+		// print progress
+		printf("\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
+		printf("%3ld%% %ld/%ld", (s + b.count) * 100 / total_sectors,
+			s + b.count, total_sectors);
+		fflush(stdout);
+	}
+	index[total_sectors] = out_bytes;
+
+	if (fseek(fout, 0, SEEK_SET) != 0
+	    || fwrite(&hdr, sizeof(hdr), 1, fout) != 1
+	    || fwrite(index, sizeof(index[0]), total_sectors + 1, fout) != total_sectors + 1) {
+		printf("\n");
+		fprintf(stderr, "failed to write the header\n");
+		return 1;
+	}
+	fclose(fout);
+
+	printf("\n%llu bytes from %llu (%.1f%%)\n", out_bytes, hdr.total_bytes,
+		(double)out_bytes * 100.0 / hdr.total_bytes);
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "usage:\n%s [-c <codec>] [-j <threads>] <cd_img> [out_basename]\n"
+		"  without -c the old .Z + .Z.table pair is written,\n"
+		"  -c zlib"
+#ifdef HAVE_ZSTD
+		"|zstd"
+#endif
+		" writes a .cbin instead\n", argv0);
+}
+
 int main(int argc, char *argv[])
 {
 	unsigned char outbuf[CD_FRAMESIZE_RAW * 2];
@@ -19,10 +248,32 @@ int main(int argc, char *argv[])
 	FILE *fin, *fout;
 	long in_bytes, out_bytes;
 	long s, total_sectors;
+	const char *argv0 = argv[0];
+	int codec = -1, threads = 4;
 	int ret, len;
 
-	if (argc < 2) {
-		fprintf(stderr, "usage:\n%s <cd_img> [out_basename]\n", argv[0]);
+	while (argc > 2 && argv[1][0] == '-') {
+		if (!strcmp(argv[1], "-c")) {
+			if (!strcmp(argv[2], "zlib"))
+				codec = CODEC_DEFLATE;
+#ifdef HAVE_ZSTD
+			else if (!strcmp(argv[2], "zstd"))
+				codec = CODEC_ZSTD;
+#endif
+			else {
+				usage(argv0);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[1], "-j"))
+			threads = atoi(argv[2]);
+		else
+			break;
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2 || argv[1][0] == '-' || threads < 1) {
+		usage(argv0);
 		return 1;
 	}
 
@@ -38,6 +289,9 @@ int main(int argc, char *argv[])
 	else
 		out_basename = argv[1];
 
+	if (codec >= 0)
+		return write_cbin(fin, out_basename, codec, threads);
+
 	len = strlen(out_basename) + 3;
 	out_fname = malloc(len);
 	if (out_fname == NULL) {
@@ -0,0 +1,168 @@
+/*
+ * Reads the psxheat.bin written by a -DPSXMEM_HEATMAP build
+ * (see psxHeatDump() in libpcsxcore/psxmem.c), prints the busiest
+ * regions and optionally writes the RAM part as a .pgm image.
+ *
+ * usage: psxheat [-n top] [-p out.pgm] [psxheat.bin]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+enum { HEAT_READ, HEAT_WRITE, HEAT_INVAL, HEAT_TYPES };
+
+struct heat_header {
+	char magic[8];		// "PSXHEAT\0"
+	unsigned int version;	// 1
+	unsigned int region_size;
+	unsigned int n_ram, n_scratch, n_io;
+	unsigned int n_types;
+};
+
+static const char *type_names[HEAT_TYPES] = { "read", "write", "inval" };
+
+static unsigned int le32(unsigned int v)
+{
+	const unsigned char *b = (const unsigned char *)&v;
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static unsigned int region_addr(const struct heat_header *h, unsigned int i)
+{
+	if (i < h->n_ram)
+		return 0x80000000 + i * h->region_size;
+	i -= h->n_ram;
+	if (i < h->n_scratch)
+		return 0x1f800000 + i * h->region_size;
+	i -= h->n_scratch;
+	return 0x1f801000 + i * h->region_size;
+}
+
+static void print_top(const struct heat_header *h, const unsigned int *counts,
+	unsigned int regions, int type, int top)
+{
+	unsigned int *c = malloc(regions * sizeof(*c));
+	unsigned long long total = 0;
+	unsigned int i, best, n;
+	int j;
+
+	if (c == NULL)
+		return;
+	memcpy(c, counts, regions * sizeof(*c));
+	for (i = 0; i < regions; i++)
+		total += c[i];
+	printf("%s: %llu total\n", type_names[type], total);
+	for (j = 0; j < top; j++) {
+		best = 0;
+		for (i = 1; i < regions; i++)
+			if (c[i] > c[best])
+				best = i;
+		n = c[best];
+		if (n == 0)
+			break;
+		printf("  %08x %12u %5.1f%%\n", region_addr(h, best), n,
+			100.0 * n / total);
+		c[best] = 0;
+	}
+	free(c);
+}
+
+// RAM only, 128 regions per row, log scale of reads + writes
+static int write_pgm(const char *fname, const struct heat_header *h,
+	const unsigned int *counts, unsigned int regions)
+{
+	unsigned int w = 128, rows = (h->n_ram + w - 1) / w;
+	unsigned int i, max = 0, v;
+	FILE *f;
+
+	for (i = 0; i < h->n_ram; i++) {
+		v = counts[HEAT_READ * regions + i] + counts[HEAT_WRITE * regions + i];
+		if (v > max)
+			max = v;
+	}
+	f = fopen(fname, "wb");
+	if (f == NULL) {
+		perror(fname);
+		return 1;
+	}
+	fprintf(f, "P5\n%u %u\n255\n", w, rows);
+	for (i = 0; i < w * rows; i++) {
+		v = 0;
+		if (i < h->n_ram && max > 0) {
+			v = counts[HEAT_READ * regions + i] + counts[HEAT_WRITE * regions + i];
+			v = (unsigned int)(255.0 * log1p(v) / log1p(max));
+		}
+		fputc(v, f);
+	}
+	fclose(f);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *fname = "psxheat.bin", *pgm = NULL;
+	struct heat_header h;
+	unsigned int *counts, regions, i;
+	int top = 16, c, ret = 0;
+	FILE *f;
+
+	while ((c = getopt(argc, argv, "n:p:")) != -1) {
+		switch (c) {
+		case 'n': top = atoi(optarg); break;
+		case 'p': pgm = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-n top] [-p out.pgm] [psxheat.bin]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		fname = argv[optind];
+
+	f = fopen(fname, "rb");
+	if (f == NULL) {
+		perror(fname);
+		return 1;
+	}
+	if (fread(&h, 1, sizeof(h), f) != sizeof(h)
+	    || memcmp(h.magic, "PSXHEAT", 8) != 0) {
+		fprintf(stderr, "%s: not a heatmap file\n", fname);
+		fclose(f);
+		return 1;
+	}
+	h.version = le32(h.version);
+	h.region_size = le32(h.region_size);
+	h.n_ram = le32(h.n_ram);
+	h.n_scratch = le32(h.n_scratch);
+	h.n_io = le32(h.n_io);
+	h.n_types = le32(h.n_types);
+	if (h.version != 1 || h.n_types != HEAT_TYPES) {
+		fprintf(stderr, "%s: unsupported version %u\n", fname, h.version);
+		fclose(f);
+		return 1;
+	}
+
+	regions = h.n_ram + h.n_scratch + h.n_io;
+	counts = malloc(regions * HEAT_TYPES * sizeof(*counts));
+	if (counts == NULL
+	    || fread(counts, sizeof(*counts), regions * HEAT_TYPES, f)
+	       != regions * HEAT_TYPES) {
+		fprintf(stderr, "%s: short file\n", fname);
+		fclose(f);
+		free(counts);
+		return 1;
+	}
+	fclose(f);
+	for (i = 0; i < regions * HEAT_TYPES; i++)
+		counts[i] = le32(counts[i]);
+
+	for (c = 0; c < HEAT_TYPES; c++)
+		print_top(&h, counts + c * regions, regions, c, top);
+	if (pgm)
+		ret = write_pgm(pgm, &h, counts, regions);
+
+	free(counts);
+	return ret;
+}
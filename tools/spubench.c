@@ -0,0 +1,328 @@
+/*
+ * Replays a spu trace through dfsound headless with every interpolation
+ * mode, reverb on and off and the thread setups, reports samples/sec and
+ * checks the pcm: threaded runs against the unthreaded one and, with -c,
+ * everything against golden output written earlier with -w.
+ *
+ * usage: spubench [-i iterations] [-w dir | -c dir] trace
+ * traces come from a dfsound built with -DSPU_TRACE and run with
+ * PCSX_SPU_TRACE=file, see spu_trace.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "psemu_plugin_defs.h"
+#include "../plugins/dfsound/spu.h"
+#include "../plugins/dfsound/spu_config.h"
+#include "../plugins/dfsound/spu_trace.h"
+#include "thread_wakeups.h"
+
+// what spu.c links against
+unsigned int twake_counts[TWAKE_COUNT];
+
+#define FREEZE_MAX	(1024 * 1024)
+
+static const char *interp_names[] = { "none", "simple", "gauss", "cubic" };
+static const struct {
+	const char *name;
+	int use, workers;
+} thread_modes[] = {
+	{ "nothread", 0, 0 },
+	{ "thread",   1, 1 },
+	{ "thread4",  1, 4 },
+};
+#define THREAD_MODES (int)(sizeof(thread_modes) / sizeof(thread_modes[0]))
+
+static unsigned char *trace;
+static long trace_size;
+
+static struct {
+	short *data;
+	size_t bytes, max;
+} pcm;
+
+static void feed_hook(const void *data, int bytes, int rate)
+{
+	if (pcm.bytes + bytes > pcm.max) {
+		pcm.max = (pcm.bytes + bytes) * 2;
+		pcm.data = realloc(pcm.data, pcm.max);
+		if (pcm.data == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	memcpy((char *)pcm.data + pcm.bytes, data, bytes);
+	pcm.bytes += bytes;
+}
+
+static void irq_cb(int cycles_after)
+{
+}
+
+static void schedule_cb(unsigned int cycles_after)
+{
+}
+
+static int load_trace(const char *path)
+{
+	uint32_t hdr[2];
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	trace_size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	trace = malloc(trace_size);
+	if (trace == NULL || fread(trace, 1, trace_size, f) != trace_size) {
+		fprintf(stderr, "%s: read failed\n", path);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	memcpy(hdr, trace, sizeof(hdr));
+	if (trace_size < sizeof(hdr) || hdr[0] != SPUT_MAGIC || hdr[1] != SPUT_VERSION) {
+		fprintf(stderr, "%s: not a spu trace\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+// returns the emulated cycles covered
+static unsigned int replay(void)
+{
+	static xa_decode_t xa;
+	static void *freeze;
+	struct spu_trace_rec r;
+	unsigned int cycles = 0;
+	long pos;
+
+	if (freeze == NULL && (freeze = malloc(FREEZE_MAX)) == NULL)
+		return 0;
+	for (pos = 8; pos + sizeof(r) <= trace_size; pos += sizeof(r) + r.size) {
+		unsigned char *data = trace + pos + sizeof(r);
+
+		memcpy(&r, trace + pos, sizeof(r));
+		if (pos + sizeof(r) + r.size > trace_size)
+			break;
+		cycles = r.cycles;
+		switch (r.type) {
+		case SPUT_WREG:
+			SPUwriteRegister(r.arg, r.val, r.cycles);
+			break;
+		case SPUT_RREG:
+			SPUreadRegister(r.arg, r.cycles);
+			break;
+		case SPUT_DMA_W:
+			SPUwriteDMAMem((unsigned short *)data, r.size / 2, r.cycles);
+			break;
+		case SPUT_DMA_R: {
+			static unsigned short dummy[0x40000];
+			SPUreadDMAMem(dummy, r.arg < 0x40000 ? r.arg : 0x40000, r.cycles);
+			break;
+		}
+		case SPUT_ASYNC:
+			SPUasync(r.cycles, r.arg);
+			break;
+		case SPUT_XA:
+			// dfsound keeps the pointer for savestates
+			memcpy(&xa, data, r.size < sizeof(xa) ? r.size : sizeof(xa));
+			SPUplayADPCMchannel(&xa, r.cycles, r.val);
+			break;
+		case SPUT_CDDA:
+			SPUplayCDDAchannel((short *)data, r.size, r.cycles, r.val);
+			break;
+		case SPUT_CDVOL:
+			SPUsetCDvol(r.arg, r.arg >> 8, r.arg >> 16, r.arg >> 24, r.cycles);
+			break;
+		case SPUT_LOAD:
+			if (r.size > FREEZE_MAX)
+				break;
+			memcpy(freeze, data, r.size);
+			SPUfreeze(0, freeze, r.cycles);
+			break;
+		default:
+			fprintf(stderr, "bad record type %d at %ld\n", r.type, pos);
+			return cycles;
+		}
+	}
+	// collect whatever the worker still has
+	SPUfreeze(1, freeze, cycles);
+	SPUasync(cycles, 1);
+	return cycles;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int diff_pcm(const char *what, const short *a, size_t a_bytes,
+	const short *b, size_t b_bytes)
+{
+	size_t i, n = (a_bytes < b_bytes ? a_bytes : b_bytes) / 2;
+	size_t first = (size_t)-1, cnt = 0;
+	int d, maxd = 0;
+
+	for (i = 0; i < n; i++) {
+		if (a[i] == b[i])
+			continue;
+		if (first == (size_t)-1)
+			first = i;
+		d = abs(a[i] - b[i]);
+		if (d > maxd)
+			maxd = d;
+		cnt++;
+	}
+	if (cnt == 0 && a_bytes == b_bytes)
+		return 0;
+	printf("  %s: MISMATCH", what);
+	if (a_bytes != b_bytes)
+		printf(" %zu frames vs %zu", a_bytes / 4, b_bytes / 4);
+	if (cnt)
+		printf(" %zu samples differ, first at frame %zu, max diff %d",
+			cnt, first / 2, maxd);
+	printf("\n");
+	return 1;
+}
+
+static char *golden_path(const char *dir, int interp, int reverb)
+{
+	static char path[512];
+	snprintf(path, sizeof(path), "%s/spu_%s_%s.raw", dir,
+		interp_names[interp], reverb ? "rvb" : "dry");
+	return path;
+}
+
+static int golden(const char *dir, int write, int interp, int reverb)
+{
+	const char *path = golden_path(dir, interp, reverb);
+	short *ref;
+	long size;
+	FILE *f;
+	int ret;
+
+	f = fopen(path, write ? "wb" : "rb");
+	if (f == NULL) {
+		perror(path);
+		return 1;
+	}
+	if (write) {
+		ret = fwrite(pcm.data, 1, pcm.bytes, f) != pcm.bytes;
+		fclose(f);
+		return ret;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	ref = malloc(size + 1);
+	if (ref == NULL || fread(ref, 1, size, f) != size) {
+		fprintf(stderr, "%s: read failed\n", path);
+		fclose(f);
+		free(ref);
+		return 1;
+	}
+	fclose(f);
+	ret = diff_pcm(path, pcm.data, pcm.bytes, ref, size);
+	free(ref);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *golden_dir = NULL, *trace_path = NULL;
+	int iters = 3, write = 0, ret = 0;
+	int interp, reverb, t, i;
+	short *base = NULL;
+	size_t base_bytes = 0;
+	char what[64];
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			iters = atoi(argv[++i]);
+		else if ((!strcmp(argv[i], "-w") || !strcmp(argv[i], "-c")) && i + 1 < argc) {
+			write = argv[i][1] == 'w';
+			golden_dir = argv[++i];
+		}
+		else
+			trace_path = argv[i];
+	}
+	if (trace_path == NULL) {
+		fprintf(stderr, "usage: %s [-i iterations] [-w dir | -c dir] trace\n", argv[0]);
+		return 1;
+	}
+	if (load_trace(trace_path) != 0)
+		return 1;
+	if (iters < 1)
+		iters = 1;
+
+	spu_config.iNoOutput = 1;
+	spu_config.iVolume = 1024;
+	spu_config.pFeedHook = feed_hook;
+
+	printf("%-7s %-4s %-9s %12s %8s\n", "interp", "rvb", "threads",
+		"samples/s", "x rt");
+	for (interp = 0; interp < 4; interp++) {
+		for (reverb = 0; reverb < 2; reverb++) {
+			for (t = 0; t < THREAD_MODES; t++) {
+				unsigned int cycles = 0;
+				double best = 0, t0, t1;
+
+				spu_config.iUseInterpolation = interp;
+				spu_config.iUseReverb = reverb;
+				spu_config.iUseThread = thread_modes[t].use;
+				spu_config.iThreadWorkers = thread_modes[t].workers;
+				for (i = 0; i < iters; i++) {
+					pcm.bytes = 0;
+					SPUinit();
+					if (thread_modes[t].use && !spu_config.iThreadAvail) {
+						SPUshutdown();
+						break;
+					}
+					SPUregisterCallback(irq_cb);
+					SPUregisterScheduleCb(schedule_cb);
+					SPUopen();
+					t0 = now();
+					cycles = replay();
+					t1 = now();
+					SPUshutdown();
+					if (i == 0 || t1 - t0 < best)
+						best = t1 - t0;
+				}
+				if (i == 0)
+					continue;
+				printf("%-7s %-4s %-9s %12.0f %8.1f\n", interp_names[interp],
+					reverb ? "on" : "off", thread_modes[t].name,
+					pcm.bytes / 4 / best,
+					(double)cycles / 33868800 / best);
+
+				if (t == 0) {
+					free(base);
+					base = malloc(pcm.bytes + 1);
+					if (base == NULL)
+						return 1;
+					memcpy(base, pcm.data, pcm.bytes);
+					base_bytes = pcm.bytes;
+					if (golden_dir)
+						ret |= golden(golden_dir, write, interp, reverb);
+				}
+				else {
+					snprintf(what, sizeof(what), "%s vs %s",
+						thread_modes[t].name, thread_modes[0].name);
+					ret |= diff_pcm(what, pcm.data, pcm.bytes, base, base_bytes);
+				}
+			}
+		}
+	}
+	free(base);
+	free(pcm.data);
+	free(trace);
+	return ret;
+}